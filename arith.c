@@ -0,0 +1,66 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of integer arithmetic functions.
+ *
+ * The ARM926EJ-S does not have a divide instruction and the application is
+ * not linked to any library that would provide division routines.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+
+#include "arith.h"
+
+
+/**
+ * Unsigned integer division ("shift and subtract", one bit of the
+ * quotient per iteration).
+ *
+ * @param n - dividend
+ * @param d - divisor (must not be 0, 0xFFFFFFFF is returned in this case)
+ *
+ * @return n / d
+ */
+uint32_t arith_udiv(uint32_t n, uint32_t d)
+{
+    uint32_t q = 0;
+    uint32_t r = 0;
+    int8_t i;
+
+    if ( 0 == d )
+    {
+        return 0xFFFFFFFF;
+    }
+
+    for ( i=31; i>=0; --i )
+    {
+        r = (r << 1) | ((n >> i) & 0x01);
+        if ( r >= d )
+        {
+            r -= d;
+            q |= (1UL << i);
+        }
+    }
+
+    return q;
+}
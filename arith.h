@@ -0,0 +1,36 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of integer arithmetic functions that are not provided by the
+ * CPU and would otherwise require a support library (e.g. libgcc).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _ARITH_H_
+#define _ARITH_H_
+
+#include <stdint.h>
+
+
+uint32_t arith_udiv(uint32_t n, uint32_t d);
+
+#endif  /* _ARITH_H_ */
@@ -0,0 +1,600 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the block cache.
+ *
+ * All buffers are statically allocated. Valid buffers are chained into
+ * hash buckets (by their block numbers), all buffers are linked into
+ * a single list, ordered from the most to the least recently used one.
+ * Lists are linked by indices, so links only take a byte each.
+ *
+ * Consecutive blocks are transferred by a single (multiple block) command
+ * of the device via a staging buffer: runs of missing blocks (including
+ * read-ahead blocks) and runs of dirty blocks when they are written back.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bcache.h"
+#include "blk.h"
+#include "clocksource.h"
+#include "mem.h"
+
+
+#if ( 0 != (BCACHE_NR_BUCKETS & (BCACHE_NR_BUCKETS - 1)) )
+#error BCACHE_NR_BUCKETS must be a power of 2
+#endif
+
+#if ( BCACHE_NR_BUFFERS > 254 || BCACHE_MAX_RUN > BCACHE_NR_BUFFERS )
+#error Invalid BCACHE_NR_BUFFERS or BCACHE_MAX_RUN
+#endif
+
+
+/* "Null pointer" of lists: */
+#define NIL                  0xFF
+
+/* Flags of buffers: */
+#define FL_VALID             0x01
+#define FL_DIRTY             0x02
+
+/* Number of words per block: */
+#define BLK_WORDS            ( BLK_SIZE / sizeof(uint32_t) )
+
+
+/*
+ * A buffer with a cached block.
+ */
+typedef struct _bcacheBuf
+{
+    uint32_t data[BLK_WORDS];        /* contents of the block (word aligned) */
+    uint32_t lba;                    /* number of the block, valid if FL_VALID is set */
+    uint32_t dirtySince;             /* clock value, when the block became dirty */
+    uint8_t flags;                   /* FL_* */
+    uint8_t hashNext;                /* next buffer in the same hash bucket */
+    uint8_t prev;                    /* previous (more recently used) buffer */
+    uint8_t next;                    /* next (less recently used) buffer */
+} bcacheBuf;
+
+
+static bcacheBuf __bufs[BCACHE_NR_BUFFERS];
+static uint8_t __buckets[BCACHE_NR_BUCKETS];
+static uint8_t __mru;                /* the most recently used buffer */
+static uint8_t __lru;                /* the least recently used buffer */
+static uint32_t __nrDirty;
+static uint32_t __nextSeq;           /* block, following the last read request */
+static bcacheStats __stats;
+
+/* Staging buffer of multiple block transfers: */
+static uint32_t __stage[BCACHE_MAX_RUN * BLK_WORDS];
+
+
+/*
+ * @param lba - number of a block
+ *
+ * @return index of the buffer with the block or NIL if the block is not cached
+ */
+static uint8_t __lookup(uint32_t lba)
+{
+    uint8_t i;
+
+    for ( i = __buckets[lba & (BCACHE_NR_BUCKETS - 1)];
+          NIL != i && __bufs[i].lba != lba;
+          i = __bufs[i].hashNext );
+
+    return i;
+}
+
+
+/*
+ * Removes a valid buffer from its hash bucket.
+ *
+ * @param idx - index of the buffer
+ */
+static void __hashRemove(uint8_t idx)
+{
+    uint8_t* p = &__buckets[__bufs[idx].lba & (BCACHE_NR_BUCKETS - 1)];
+
+    while ( *p != idx )
+    {
+        p = &__bufs[*p].hashNext;
+    }
+
+    *p = __bufs[idx].hashNext;
+}
+
+
+/*
+ * Marks a buffer as the most recently used one.
+ *
+ * @param idx - index of the buffer
+ */
+static void __touch(uint8_t idx)
+{
+    bcacheBuf* b = &__bufs[idx];
+
+    if ( __mru == idx )
+    {
+        return;
+    }
+
+    /* Unlink... */
+    __bufs[b->prev].next = b->next;
+    if ( NIL != b->next )
+    {
+        __bufs[b->next].prev = b->prev;
+    }
+    else
+    {
+        __lru = b->prev;
+    }
+
+    /* ... and insert at the head */
+    b->prev = NIL;
+    b->next = __mru;
+    __bufs[__mru].prev = idx;
+    __mru = idx;
+}
+
+
+/*
+ * Writes a dirty block and its consecutive dirty successors (max.
+ * BCACHE_MAX_RUN blocks) to the device by a single command.
+ *
+ * @param idx - index of the first dirty buffer
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* otherwise (blocks remain dirty)
+ */
+static int8_t __writeBack(uint8_t idx)
+{
+    const uint32_t lba = __bufs[idx].lba;
+    uint32_t n;
+    uint8_t i;
+    int8_t rc;
+
+    for ( n=0, i=idx;
+          n < BCACHE_MAX_RUN && NIL != i && (__bufs[i].flags & FL_DIRTY);
+          ++n, i=__lookup(lba + n) )
+    {
+        memcpy(&__stage[n * BLK_WORDS], __bufs[i].data, BLK_SIZE);
+    }
+
+    rc = blk_write(lba, __stage, n);
+    ++__stats.devWrites;
+    if ( BLK_OK != rc )
+    {
+        return rc;
+    }
+
+    __stats.writeBacks += n;
+    __nrDirty -= n;
+    while ( n-- > 0 )
+    {
+        __bufs[__lookup(lba + n)].flags &= ~FL_DIRTY;
+    }
+
+    return BLK_OK;
+}
+
+
+/*
+ * Obtains the least recently used buffer for a new block. Its current
+ * block is written back first if it is dirty.
+ *
+ * The buffer becomes the most recently used one, it is invalid and not
+ * in any hash bucket.
+ *
+ * @param idx - the buffer's index is written here
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* if the dirty block could not be written
+ */
+static int8_t __alloc(uint8_t* idx)
+{
+    const uint8_t i = __lru;
+    bcacheBuf* b = &__bufs[i];
+    int8_t rc;
+
+    if ( b->flags & FL_DIRTY )
+    {
+        rc = __writeBack(i);
+        if ( BLK_OK != rc )
+        {
+            return rc;
+        }
+    }
+
+    if ( b->flags & FL_VALID )
+    {
+        __hashRemove(i);
+    }
+
+    b->flags = 0;
+    __touch(i);
+    *idx = i;
+
+    return BLK_OK;
+}
+
+
+/*
+ * Assigns a block to an allocated buffer.
+ *
+ * @param idx - index of the buffer, obtained by __alloc()
+ * @param lba - number of the block
+ */
+static void __insert(uint8_t idx, uint32_t lba)
+{
+    const uint8_t bucket = lba & (BCACHE_NR_BUCKETS - 1);
+
+    __bufs[idx].lba = lba;
+    __bufs[idx].flags = FL_VALID;
+    __bufs[idx].hashNext = __buckets[bucket];
+    __buckets[bucket] = idx;
+}
+
+
+/*
+ * Reads consecutive missing blocks into the staging buffer by a single
+ * command and inserts them into the cache.
+ *
+ * @param lba - number of the first block
+ * @param n - number of blocks (max. BCACHE_MAX_RUN)
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* otherwise
+ */
+static int8_t __fill(uint32_t lba, uint32_t n)
+{
+    uint8_t idx[BCACHE_MAX_RUN];
+    uint32_t i;
+    int8_t rc;
+
+    /* Buffers are obtained first, as write-backs also use the staging buffer */
+    for ( i=0; i<n; ++i )
+    {
+        rc = __alloc(&idx[i]);
+        if ( BLK_OK != rc )
+        {
+            return rc;
+        }
+    }
+
+    rc = blk_read(lba, __stage, n);
+    ++__stats.devReads;
+    if ( BLK_OK != rc )
+    {
+        return rc;
+    }
+
+    for ( i=0; i<n; ++i )
+    {
+        memcpy(__bufs[idx[i]].data, &__stage[i * BLK_WORDS], BLK_SIZE);
+        __insert(idx[i], lba + i);
+    }
+
+    return BLK_OK;
+}
+
+
+/*
+ * Checks whether a request is within the device's capacity.
+ *
+ * @return BLK_OK if the request is valid, one of BLK_ERR_* otherwise
+ */
+static int8_t __check(uint32_t lba, const void* buf, uint32_t count)
+{
+    const uint32_t nr = blk_getNrBlocks();
+
+    if ( 0 == nr )
+    {
+        return BLK_ERR_NODEV;
+    }
+
+    if ( NULL == buf || 0 == count || lba >= nr || count > nr - lba )
+    {
+        return BLK_ERR_PARAM;
+    }
+
+    return BLK_OK;
+}
+
+
+/**
+ * Initializes the cache: all buffers become empty and statistics are reset.
+ *
+ * Cached blocks are discarded, so the cache should be flushed (see
+ * bcache_invalidate()) before it is reinitialized.
+ */
+void bcache_init(void)
+{
+    uint8_t i;
+
+    clocksource_init();
+
+    for ( i=0; i<BCACHE_NR_BUCKETS; ++i )
+    {
+        __buckets[i] = NIL;
+    }
+
+    for ( i=0; i<BCACHE_NR_BUFFERS; ++i )
+    {
+        __bufs[i].flags = 0;
+        __bufs[i].hashNext = NIL;
+        __bufs[i].prev = ( 0 == i ? NIL : i-1 );
+        __bufs[i].next = ( BCACHE_NR_BUFFERS-1 == i ? NIL : i+1 );
+    }
+
+    __mru = 0;
+    __lru = BCACHE_NR_BUFFERS - 1;
+    __nrDirty = 0;
+    __nextSeq = 0xFFFFFFFF;
+
+    bcache_resetStats();
+}
+
+
+/**
+ * Reads consecutive blocks via the cache.
+ *
+ * Missing blocks are read from the device. If the request continues the
+ * previous one, up to BCACHE_READ_AHEAD following blocks are read as well.
+ *
+ * @param lba - number of the first block
+ * @param buf - buffer (at least count*BLK_SIZE bytes)
+ * @param count - number of blocks
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* otherwise
+ */
+int8_t bcache_read(uint32_t lba, void* buf, uint32_t count)
+{
+    const int8_t seq = ( lba == __nextSeq ? 1 : 0 );
+    const uint32_t end = blk_getNrBlocks();
+    uint8_t* p = (uint8_t*) buf;
+    uint32_t n;
+    uint32_t req;
+    uint8_t idx;
+    int8_t rc;
+
+    rc = __check(lba, buf, count);
+    if ( BLK_OK != rc )
+    {
+        return rc;
+    }
+
+    __nextSeq = lba + count;
+
+    while ( count > 0 )
+    {
+        idx = __lookup(lba);
+        if ( NIL != idx )
+        {
+            memcpy(p, __bufs[idx].data, BLK_SIZE);
+            __touch(idx);
+            ++__stats.hits;
+
+            ++lba;
+            p += BLK_SIZE;
+            --count;
+            continue;
+        }
+
+        /* A run of missing requested blocks... */
+        for ( req=1; req<count && req<BCACHE_MAX_RUN && NIL==__lookup(lba+req); ++req );
+
+        /* ... extended by missing blocks that follow a sequential request */
+        for ( n=req;
+              0 != seq && n < req + BCACHE_READ_AHEAD && n < BCACHE_MAX_RUN &&
+              lba + n < end && NIL == __lookup(lba + n);
+              ++n );
+
+        rc = __fill(lba, n);
+        if ( BLK_OK != rc )
+        {
+            return rc;
+        }
+
+        memcpy(p, __stage, req * BLK_SIZE);
+        __stats.misses += req;
+        __stats.readAhead += n - req;
+
+        lba += req;
+        p += req * BLK_SIZE;
+        count -= req;
+    }
+
+    return BLK_OK;
+}
+
+
+/**
+ * Writes consecutive blocks into the cache. The blocks are written to
+ * the device when their buffers are reused, when the cache is flushed
+ * or by bcache_poll().
+ *
+ * @param lba - number of the first block
+ * @param buf - buffer (at least count*BLK_SIZE bytes)
+ * @param count - number of blocks
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* otherwise
+ */
+int8_t bcache_write(uint32_t lba, const void* buf, uint32_t count)
+{
+    const uint8_t* p = (const uint8_t*) buf;
+    uint8_t idx;
+    int8_t rc;
+
+    rc = __check(lba, buf, count);
+
+    for ( ; BLK_OK == rc && count > 0; ++lba, p += BLK_SIZE, --count )
+    {
+        idx = __lookup(lba);
+        if ( NIL == idx )
+        {
+            rc = __alloc(&idx);
+            if ( BLK_OK != rc )
+            {
+                break;  /* out of for */
+            }
+
+            __insert(idx, lba);
+        }
+
+        memcpy(__bufs[idx].data, p, BLK_SIZE);
+        __touch(idx);
+
+        if ( 0 == (__bufs[idx].flags & FL_DIRTY) )
+        {
+            __bufs[idx].flags |= FL_DIRTY;
+            __bufs[idx].dirtySince = clocksource_read();
+            ++__nrDirty;
+        }
+    }
+
+    return rc;
+}
+
+
+/**
+ * Writes all dirty blocks to the device. Consecutive blocks are written
+ * by single commands, in the ascending order of their numbers.
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* otherwise
+ */
+int8_t bcache_flush(void)
+{
+    uint8_t i;
+    uint8_t first;
+    int8_t rc;
+
+    while ( __nrDirty > 0 )
+    {
+        first = NIL;
+        for ( i=0; i<BCACHE_NR_BUFFERS; ++i )
+        {
+            if ( (__bufs[i].flags & FL_DIRTY) &&
+                 ( NIL == first || __bufs[i].lba < __bufs[first].lba ) )
+            {
+                first = i;
+            }
+        }
+
+        rc = __writeBack(first);
+        if ( BLK_OK != rc )
+        {
+            return rc;
+        }
+    }
+
+    return BLK_OK;
+}
+
+
+/**
+ * Flushes the cache and discards all cached blocks, e.g. when the
+ * card has been replaced. Statistics are preserved.
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* if the cache could not be flushed (nothing is discarded)
+ */
+int8_t bcache_invalidate(void)
+{
+    bcacheStats stats;
+    int8_t rc;
+
+    rc = bcache_flush();
+    if ( BLK_OK != rc )
+    {
+        return rc;
+    }
+
+    stats = __stats;
+    bcache_init();
+    __stats = stats;
+
+    return BLK_OK;
+}
+
+
+/**
+ * Periodic write-back, should be called regularly (e.g. from the
+ * application's main loop). If any block has been dirty for more than
+ * BCACHE_WRITEBACK_MS milliseconds, all dirty blocks are written back.
+ *
+ * @return BLK_OK on success (or if nothing was written), one of BLK_ERR_* otherwise
+ */
+int8_t bcache_poll(void)
+{
+    const uint32_t now = clocksource_read();
+    const uint32_t age = BCACHE_WRITEBACK_MS * (clocksource_getFrequency() / 1000);
+    uint8_t i;
+
+    if ( 0 == __nrDirty )
+    {
+        return BLK_OK;
+    }
+
+    for ( i=0; i<BCACHE_NR_BUFFERS; ++i )
+    {
+        if ( (__bufs[i].flags & FL_DIRTY) && now - __bufs[i].dirtySince > age )
+        {
+            return bcache_flush();
+        }
+    }
+
+    return BLK_OK;
+}
+
+
+/**
+ * @return number of dirty blocks in the cache
+ */
+uint32_t bcache_getNrDirty(void)
+{
+    return __nrDirty;
+}
+
+
+/**
+ * Copies the cache's statistics.
+ *
+ * @param stats - the statistics are copied here
+ */
+void bcache_getStats(bcacheStats* stats)
+{
+    if ( NULL != stats )
+    {
+        *stats = __stats;
+    }
+}
+
+
+/**
+ * Resets all counters of the cache's statistics.
+ */
+void bcache_resetStats(void)
+{
+    __stats.hits = 0;
+    __stats.misses = 0;
+    __stats.readAhead = 0;
+    __stats.writeBacks = 0;
+    __stats.devReads = 0;
+    __stats.devWrites = 0;
+}
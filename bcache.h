@@ -0,0 +1,92 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the block cache.
+ *
+ * The cache sits between a filesystem (or any other user of blocks) and
+ * the block device (see blk.h). It keeps BCACHE_NR_BUFFERS blocks, found
+ * by a hash of their numbers and replaced in the least recently used
+ * order. Written blocks remain in the cache (dirty) until they are
+ * replaced, flushed explicitly or written back by bcache_poll() after
+ * BCACHE_WRITEBACK_MS milliseconds. Sequential reads are detected and
+ * up to BCACHE_READ_AHEAD following blocks are read by the same command.
+ *
+ * The cache is not reentrant and must not be accessed from ISRs.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _BCACHE_H_
+#define _BCACHE_H_
+
+#include <stdint.h>
+
+
+/* Number of cached blocks (max. 254): */
+#define BCACHE_NR_BUFFERS        32
+
+/* Number of hash buckets, must be a power of 2: */
+#define BCACHE_NR_BUCKETS        16
+
+/* Max. number of blocks, read ahead of a sequential read: */
+#define BCACHE_READ_AHEAD        8
+
+/* Max. number of blocks, transferred by a single device command of the cache: */
+#define BCACHE_MAX_RUN           16
+
+/* Dirty blocks are written back by bcache_poll() after (in milliseconds): */
+#define BCACHE_WRITEBACK_MS      1000
+
+
+/**
+ * Statistics of the cache, all counters start at 0 when the cache
+ * is initialized or its statistics are reset.
+ */
+typedef struct _bcacheStats
+{
+    uint32_t hits;              /* requested blocks, found in the cache */
+    uint32_t misses;            /* requested blocks, read from the device */
+    uint32_t readAhead;         /* blocks, read ahead of sequential requests */
+    uint32_t writeBacks;        /* dirty blocks, written to the device */
+    uint32_t devReads;          /* read commands, issued to the device */
+    uint32_t devWrites;         /* write commands, issued to the device */
+} bcacheStats;
+
+
+void bcache_init(void);
+
+int8_t bcache_read(uint32_t lba, void* buf, uint32_t count);
+
+int8_t bcache_write(uint32_t lba, const void* buf, uint32_t count);
+
+int8_t bcache_flush(void);
+
+int8_t bcache_invalidate(void);
+
+int8_t bcache_poll(void);
+
+uint32_t bcache_getNrDirty(void);
+
+void bcache_getStats(bcacheStats* stats);
+
+void bcache_resetStats(void);
+
+#endif  /* _BCACHE_H_ */
@@ -0,0 +1,222 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the micro benchmark harness. Benchmarks themselves
+ * are typically run by the BENCH macro, declared in bench.h.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bench.h"
+#include "clocksource.h"
+#include "uart.h"
+
+
+/* Number of samples, taken to calibrate the overhead of reading the clock: */
+#define NR_CALIB_SAMPLES     32
+
+
+/* UART where benchmark results are reported: */
+static uint8_t __benchUart = 0;
+
+/* Calibrated overhead of a pair of clock readings in ticks: */
+static uint32_t __benchOverhead = 0;
+
+/* Median time of the most recently completed benchmark: */
+static uint32_t __benchLastMedian = 0;
+
+
+/**
+ * Converts an unsigned long value into a string with its decimal representation,
+ * without any leading spaces or zeros.
+ *
+ * @param buf - pointer to a string buffer (at least 11 characters)
+ * @param val - unsigned long (4 bytes) value to be converted
+ */
+void bench_ul2dec(char* buf, uint32_t val)
+{
+    char tmp[10];
+    uint8_t i = 0;
+    uint8_t j;
+
+    do
+    {
+        tmp[i++] = '0' + (val % 10);
+        val /= 10;
+    } while ( val>0 );
+
+    /* digits were obtained in reverse order */
+    for ( j=0; j<i; ++j )
+    {
+        buf[j] = tmp[i-j-1];
+    }
+
+    buf[i] = '\0';
+}
+
+
+/*
+ * Outputs " key=value" to the benchmark UART.
+ *
+ * @param key - name of the value
+ * @param val - value to be printed
+ */
+static void __printKeyVal(const char* key, uint32_t val)
+{
+    char buf[11];
+
+    bench_ul2dec(buf, val);
+    uart_print(__benchUart, " ");
+    uart_print(__benchUart, key);
+    uart_print(__benchUart, "=");
+    uart_print(__benchUart, buf);
+}
+
+
+/**
+ * Initializes (and starts) the clock and calibrates the overhead of timing.
+ * Must be called before any benchmark is run.
+ *
+ * @param uart - number of the UART (between 0 and 2) where results are reported
+ */
+void bench_init(uint8_t uart)
+{
+    uint8_t i;
+    uint32_t t0;
+    uint32_t dt;
+
+    __benchUart = uart;
+
+    clocksource_init();
+
+    /* The overhead is the shortest time between two consecutive readings of the clock */
+    __benchOverhead = 0xFFFFFFFF;
+    for ( i=0; i<NR_CALIB_SAMPLES; ++i )
+    {
+        t0 = clocksource_read();
+        dt = clocksource_read() - t0;
+
+        if ( dt < __benchOverhead )
+        {
+            __benchOverhead = dt;
+        }
+    }
+}
+
+
+/**
+ * @return calibrated overhead of timing in ticks
+ */
+uint32_t bench_getOverhead(void)
+{
+    return __benchOverhead;
+}
+
+
+/**
+ * Prepares a benchmark's state. Typically called by the BENCH macro.
+ *
+ * @param res - state of the benchmark
+ * @param name - name of the benchmark (a string without spaces)
+ */
+void bench_begin(benchResult* res, const char* name)
+{
+    res->name = name;
+    res->nrSamples = 0;
+}
+
+
+/**
+ * Records a sample. The calibrated overhead is subtracted from it.
+ * Typically called by the BENCH macro.
+ *
+ * Nothing is done if BENCH_MAX_SAMPLES samples have already been recorded.
+ *
+ * @param res - state of the benchmark
+ * @param ticks - measured time in ticks
+ */
+void bench_sample(benchResult* res, uint32_t ticks)
+{
+    if ( res->nrSamples >= BENCH_MAX_SAMPLES )
+    {
+        return;
+    }
+
+    res->samples[res->nrSamples++] = ( ticks>__benchOverhead ? ticks-__benchOverhead : 0 );
+}
+
+
+/**
+ * Sorts all samples and reports min/median/max times of the benchmark.
+ * Typically called by the BENCH macro.
+ *
+ * @param res - state of the benchmark
+ */
+void bench_end(benchResult* res)
+{
+    uint16_t i;
+    uint16_t j;
+    uint32_t tmp;
+    const uint16_t n = res->nrSamples;
+
+    /* Insertion sort, the number of samples is small */
+    for ( i=1; i<n; ++i )
+    {
+        tmp = res->samples[i];
+        for ( j=i; j>0 && res->samples[j-1]>tmp; --j )
+        {
+            res->samples[j] = res->samples[j-1];
+        }
+        res->samples[j] = tmp;
+    }
+
+    __benchLastMedian = ( n > 0 ? res->samples[n/2] : 0 );
+
+    uart_print(__benchUart, "BENCH name=");
+    uart_print(__benchUart, res->name);
+    __printKeyVal("samples", n);
+
+    if ( n > 0 )
+    {
+        __printKeyVal("min", res->samples[0]);
+        __printKeyVal("med", res->samples[n/2]);
+        __printKeyVal("max", res->samples[n-1]);
+    }
+
+    __printKeyVal("overhead", __benchOverhead);
+    __printKeyVal("freq", clocksource_getFrequency());
+    uart_print(__benchUart, "\r\n");
+}
+
+
+/**
+ * Median time of the most recently completed benchmark, allows the application
+ * to compare benchmarks (e.g. to find a crossover point of two implementations).
+ *
+ * @return median time in ticks, 0 if no benchmark has been completed or it had no samples
+ */
+uint32_t bench_getLastMedian(void)
+{
+    return __benchLastMedian;
+}
@@ -0,0 +1,112 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of the micro benchmark harness and the BENCH macro.
+ *
+ * Usage:
+ *     bench_init(0);
+ *     BENCH("timer_read", 64, timer_getValue(0, 0));
+ *
+ * Each benchmark outputs a single machine readable line to the selected UART, e.g.:
+ *     BENCH name=timer_read samples=64 min=3 med=3 max=5 overhead=2 freq=24000000
+ *
+ * All times are expressed in clock ticks (see clocksource.h), calibrated overhead
+ * of reading the clock is already subtracted.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdint.h>
+
+#include "clocksource.h"
+
+
+/* Max. number of samples per benchmark, additional iterations are ignored: */
+#define BENCH_MAX_SAMPLES      128
+
+/* Number of untimed warmup iterations before samples are taken: */
+#define BENCH_WARMUP           4
+
+
+/**
+ * State of a single benchmark. Should only be accessed via bench_* functions.
+ */
+typedef struct _benchResult
+{
+    const char* name;                        /* name of the benchmark */
+    uint16_t nrSamples;                      /* number of samples taken so far */
+    uint32_t samples[BENCH_MAX_SAMPLES];     /* measured times in ticks */
+} benchResult;
+
+
+void bench_init(uint8_t uart);
+
+uint32_t bench_getOverhead(void);
+
+void bench_begin(benchResult* res, const char* name);
+
+void bench_sample(benchResult* res, uint32_t ticks);
+
+void bench_end(benchResult* res);
+
+uint32_t bench_getLastMedian(void);
+
+void bench_ul2dec(char* buf, uint32_t val);
+
+
+/**
+ * Runs 'body' BENCH_WARMUP times without timing and then 'iterations' times
+ * (max. BENCH_MAX_SAMPLES), timing each execution separately. Finally min/median/max
+ * times are reported.
+ *
+ * @param name - name of the benchmark (a string without spaces)
+ * @param iterations - number of timed executions of 'body'
+ * @param body - statement(s) to be benchmarked
+ */
+#define BENCH(name, iterations, body)                                   \
+    do                                                                  \
+    {                                                                   \
+        static benchResult __benchRes;                                  \
+        uint32_t __benchIter;                                           \
+        uint32_t __benchT0;                                             \
+                                                                        \
+        bench_begin(&__benchRes, (name));                               \
+                                                                        \
+        for ( __benchIter=0; __benchIter<BENCH_WARMUP; ++__benchIter )  \
+        {                                                               \
+            body;                                                       \
+        }                                                               \
+                                                                        \
+        for ( __benchIter=0; __benchIter<(iterations) &&                \
+                             __benchIter<BENCH_MAX_SAMPLES; ++__benchIter ) \
+        {                                                               \
+            __benchT0 = clocksource_read();                             \
+            body;                                                       \
+            bench_sample(&__benchRes, clocksource_read() - __benchT0);  \
+        }                                                               \
+                                                                        \
+        bench_end(&__benchRes);                                         \
+    } while (0)
+
+#endif  /* _BENCH_H_ */
@@ -0,0 +1,189 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the block device API on top of the SD card driver.
+ *
+ * Requests are validated against the device's capacity and split into
+ * transfers of at most MMCI_MAX_BLOCKS blocks, each of them performed
+ * by a single (multiple block) command.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "blk.h"
+#include "mmci.h"
+
+
+#if ( BLK_SIZE != MMCI_BLOCK_SIZE )
+#error BLK_SIZE must be equal to MMCI_BLOCK_SIZE
+#endif
+
+
+/*
+ * Converts a return value of mmci_* functions into BLK_* values.
+ *
+ * @param rc - value, returned by a mmci_* function
+ *
+ * @return equivalent BLK_* value
+ */
+static int8_t __status(int8_t rc)
+{
+    switch ( rc )
+    {
+        case MMCI_OK:
+            return BLK_OK;
+
+        case MMCI_ERR_PARAM:
+            return BLK_ERR_PARAM;
+
+        case MMCI_ERR_TIMEOUT:
+        case MMCI_ERR_CARD:
+            return BLK_ERR_NODEV;
+
+        default:
+            return BLK_ERR_IO;
+    }
+}
+
+
+/*
+ * Checks whether a request is within the device's capacity.
+ *
+ * @param lba - number of the first block
+ * @param buf - buffer
+ * @param count - number of blocks
+ *
+ * @return BLK_OK if the request is valid, one of BLK_ERR_* otherwise
+ */
+static int8_t __check(uint32_t lba, const void* buf, uint32_t count)
+{
+    const uint32_t nr = mmci_getNrBlocks();
+
+    if ( 0 == nr )
+    {
+        return BLK_ERR_NODEV;
+    }
+
+    if ( NULL == buf || 0 == count || lba >= nr || count > nr - lba )
+    {
+        return BLK_ERR_PARAM;
+    }
+
+    return BLK_OK;
+}
+
+
+/**
+ * Initializes the block device, i.e. the MMCI and the inserted SD card.
+ *
+ * @note Must be called after the interrupt controller has been initialized.
+ *
+ * @param priority - priority of the device's IRQ (see pic_registerNonVectoredIrq())
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* otherwise (BLK_ERR_NODEV if no card is inserted)
+ */
+int8_t blk_init(uint8_t priority)
+{
+    int8_t rc;
+
+    rc = mmci_init(priority);
+    if ( MMCI_OK != rc )
+    {
+        return __status(rc);
+    }
+
+    return __status(mmci_initCard());
+}
+
+
+/**
+ * @return capacity of the device in blocks, 0 if it is not initialized
+ */
+uint32_t blk_getNrBlocks(void)
+{
+    return mmci_getNrBlocks();
+}
+
+
+/**
+ * Reads consecutive blocks from the device.
+ *
+ * @param lba - number of the first block
+ * @param buf - buffer (at least count*BLK_SIZE bytes, word aligned buffers are faster)
+ * @param count - number of blocks
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* otherwise
+ */
+int8_t blk_read(uint32_t lba, void* buf, uint32_t count)
+{
+    uint8_t* p = (uint8_t*) buf;
+    uint32_t n;
+    int8_t rc;
+
+    rc = __check(lba, buf, count);
+
+    while ( BLK_OK == rc && count > 0 )
+    {
+        n = ( count < MMCI_MAX_BLOCKS ? count : MMCI_MAX_BLOCKS );
+        rc = __status(mmci_readBlocks(lba, p, n));
+
+        lba += n;
+        p += n * BLK_SIZE;
+        count -= n;
+    }
+
+    return rc;
+}
+
+
+/**
+ * Writes consecutive blocks to the device. The function returns when
+ * all blocks have been written.
+ *
+ * @param lba - number of the first block
+ * @param buf - buffer (at least count*BLK_SIZE bytes, word aligned buffers are faster)
+ * @param count - number of blocks
+ *
+ * @return BLK_OK on success, one of BLK_ERR_* otherwise
+ */
+int8_t blk_write(uint32_t lba, const void* buf, uint32_t count)
+{
+    const uint8_t* p = (const uint8_t*) buf;
+    uint32_t n;
+    int8_t rc;
+
+    rc = __check(lba, buf, count);
+
+    while ( BLK_OK == rc && count > 0 )
+    {
+        n = ( count < MMCI_MAX_BLOCKS ? count : MMCI_MAX_BLOCKS );
+        rc = __status(mmci_writeBlocks(lba, p, n));
+
+        lba += n;
+        p += n * BLK_SIZE;
+        count -= n;
+    }
+
+    return rc;
+}
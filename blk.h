@@ -0,0 +1,55 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions of the block device API.
+ *
+ * The block device (currently the SD card, see mmci.h) is accessed in
+ * blocks of BLK_SIZE bytes, addressed by their numbers (LBA).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _BLK_H_
+#define _BLK_H_
+
+#include <stdint.h>
+
+
+/* Size of a block in bytes: */
+#define BLK_SIZE              512
+
+
+/* Return values of blk_* functions: */
+#define BLK_OK                0
+#define BLK_ERR_PARAM        -1    /* invalid parameter (e.g. blocks beyond the device's end) */
+#define BLK_ERR_NODEV        -2    /* no device, or it is not initialized */
+#define BLK_ERR_IO           -3    /* the device reported an error */
+
+
+int8_t blk_init(uint8_t priority);
+
+uint32_t blk_getNrBlocks(void);
+
+int8_t blk_read(uint32_t lba, void* buf, uint32_t count);
+
+int8_t blk_write(uint32_t lba, const void* buf, uint32_t count);
+
+#endif  /* _BLK_H_ */
@@ -57,12 +57,18 @@ limitations under the License.
 
 
 
+/* Base address of the status and system control registers (see section 4.3 of the DUI0225D): */
+#define BSP_SYSREG_BASE_ADDRESS     0x10000000
+
 /* Base address of the Primary Interrupt Controller (see page 4-44 of the DUI0225D): */
 #define BSP_PIC_BASE_ADDRESS        0x10140000
 
 /* Base address of the Secondary Interrupt Controller (see page 4-44 of the DUI0225D): */
 #define BSP_SIC_BASE_ADDRESS        0x10003000
 
+/* Interrupt request line of the PIC, triggered by the SIC (see page 4-46 of the DUI0225D): */
+#define BSP_SIC_IRQ                 31
+
 
 
 
@@ -118,6 +124,93 @@ limitations under the License.
 
 
 
+/*
+ * Base address and IRQ of the PL080 DMA controller
+ * (see the memory map and the interrupt assignments in DUI0225D):
+ */
+#define BSP_DMA_BASE_ADDRESS        0x10130000
+
+#define BSP_DMA_IRQ                 17
+
+
+
+/*
+ * Base address and IRQ of the PL181 multimedia card interface (MMCI0).
+ * Its interrupt is a source of the SIC that must be passed through to
+ * the PIC's interrupt request line with the same number
+ * (see the memory map and the interrupt assignments in DUI0225D):
+ */
+#define BSP_MMCI_BASE_ADDRESS       0x10005000
+
+#define BSP_MMCI_IRQ                22
+
+
+
+/*
+ * Base addresses and interrupt sources of both PL050 keyboard/mouse
+ * interfaces (KMI). The interrupts are sources of the SIC and are
+ * signalled to the PIC by BSP_SIC_IRQ (see the memory map and the
+ * SIC's interrupt assignments in DUI0225D):
+ */
+
+#define BSP_NR_KMIS         2
+
+#define BSP_KMI_BASE_ADDRESSES(CAST) \
+    CAST(0x10006000) \
+    CAST(0x10007000)
+
+#define BSP_KMI_SIC_IRQS    { 3, 4 }
+
+
+
+/*
+ * Base addresses and IRQs of all 4 PL061 GPIO controllers
+ * (see the memory map and the interrupt assignments in DUI0225D):
+ */
+
+#define BSP_NR_GPIOS        4
+
+#define BSP_GPIO_BASE_ADDRESSES(CAST) \
+    CAST(0x101E4000) \
+    CAST(0x101E5000) \
+    CAST(0x101E6000) \
+    CAST(0x101E7000)
+
+#define BSP_GPIO_IRQS       { 6, 7, 8, 9 }
+
+
+
+/*
+ * Base address and IRQ of the PL022 synchronous serial port (SSP)
+ * (see the memory map and the interrupt assignments in DUI0225D):
+ */
+#define BSP_SSP_BASE_ADDRESS        0x101F4000
+
+#define BSP_SSP_IRQ                 11
+
+
+
+/*
+ * Base address and IRQ of the PL110 color LCD controller (CLCDC)
+ * (see the memory map and the interrupt assignments in DUI0225D):
+ */
+#define BSP_CLCD_BASE_ADDRESS       0x10120000
+
+#define BSP_CLCD_IRQ                16
+
+
+
+/*
+ * Base address and size of the NOR flash bank (two interleaved 16-bit devices,
+ * Intel/Sharp command set, accessed by 32-bit words, see the memory map
+ * in DUI0225D). Its geometry is read from the devices' CFI tables.
+ */
+#define BSP_FLASH_BASE_ADDRESS      0x34000000
+
+#define BSP_FLASH_SIZE              0x04000000
+
+
+
 /*
  * IRQ, reserved for software generated interrupts.
  * See pp.4-46 to 4-48 of the DUI0225D.
@@ -126,4 +219,14 @@ limitations under the License.
 #define BSP_SOFTWARE_IRQ            1
 
 
+
+/*
+ * Host (unit test) build: base addresses are redefined to point into
+ * simulated register blocks, IRQs remain the same. See host/sim_bsp.h.
+ */
+#ifdef BSP_HOST_SIM
+#include "host/sim_bsp.h"
+#endif
+
+
 #endif   /* _BSP_H_ */
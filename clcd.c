@@ -0,0 +1,911 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the PL110 color LCD controller (CLCD) driver.
+ *
+ * The pixel clock is provided by the board's oscillator OSC4 and bypasses
+ * the controller's divider. The board's CLCD control register (SYS_CLCD)
+ * multiplexes 16 bpp pixels as RGB 5:6:5 with blue at the LSB.
+ *
+ * Buffers are swapped by writing the back buffer's address into the Upper
+ * Panel Base Address Register. The controller loads it at the beginning
+ * of the next frame and raises the "next base address update" interrupt,
+ * whose ISR completes the swap. The interrupt is only unmasked while a
+ * swap is pending.
+ *
+ * Rows are filled and copied by bursts of 8 words (STMIA/LDMIA of 8
+ * registers), only their unaligned first and last pixels are accessed
+ * individually. clcd_blitAsync() copies rows by the PL080 DMA controller
+ * instead, each transfer is started from the previous one's callback.
+ *
+ * More info about the board and the controller:
+ * - Versatile Application Baseboard for ARM926EJ-S, HBI 0118 (DUI0225D):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.dui0225d/DUI0225D_versatile_application_baseboard_arm926ej_s_ug.pdf
+ * - ARM PrimeCell Color LCD Controller (PL110) Technical Reference Manual (DDI0161):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.ddi0161e/DDI0161.pdf
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "clcd.h"
+#include "sysreg.h"
+#include "interrupt.h"
+#include "cpuload.h"
+#include "dma.h"
+
+
+/*
+ * In the host (unit test) build, register writes are only applied when
+ * the simulated controller is notified, and a busy wait must advance
+ * the simulated time (and thus frames).
+ */
+#ifdef BSP_HOST_SIM
+extern void sim_sync(void);
+extern void sim_timerAdvance(uint32_t ticks);
+#define CLEAR_INT(FLAGS)     do { pReg->LCDICR = (FLAGS); sim_sync(); } while (0)
+#define POLL_DELAY()         sim_timerAdvance(POLL_US)
+#else
+#define CLEAR_INT(FLAGS)     ( pReg->LCDICR = (FLAGS) )
+#define POLL_DELAY()
+#endif
+
+/* Period of polling when the IRQ mode is disabled, only relevant for the host build: */
+#define POLL_US              100
+
+
+/*
+ * Bit masks of the Control Register (LCDControl), see page 3-13 of DDI0161:
+ *
+ *  13:12 LcdVComp (generation of the vertical compare interrupt)
+ *     11 LcdPwr (power to the display's signals)
+ *      8 BGR (swaps red and blue)
+ *      5 LcdTFT
+ *    3:1 LcdBpp (100: 16 bpp)
+ *      0 LcdEn
+ */
+#define CTRL_ENABLE          0x00000001
+#define CTRL_BPP16           0x00000008
+#define CTRL_TFT             0x00000020
+#define CTRL_POWER           0x00000800
+
+
+/*
+ * Bit masks of the interrupt registers (LCDIMSC, LCDRIS, LCDMIS, LCDICR),
+ * see page 3-14 of DDI0161:
+ */
+#define INT_FIFO_UNDERFLOW   0x00000002
+#define INT_BASE_UPDATE      0x00000004
+#define INT_VCOMP            0x00000008
+#define INT_BUS_ERROR        0x00000010
+#define INT_ALL              0x0000001E
+
+
+/* Bit masks of the Timing 2 Register, see page 3-8 of DDI0161: */
+#define TIM2_BYPASS_DIV      0x04000000
+#define TIM2_IHS             0x00001000      /* horizontal sync is active low */
+#define TIM2_IVS             0x00000800      /* vertical sync is active low */
+
+
+/*
+ * 32-bit registers of the PL110, relative to the base address.
+ *
+ * Note: the Versatile's controller has Control and Interrupt Mask
+ * registers at the PL111's locations (swapped compared to DDI0161).
+ */
+typedef struct _ARM926EJS_CLCD_REGS
+{
+    uint32_t LCDTIMING0;          /* Horizontal axis panel control */
+    uint32_t LCDTIMING1;          /* Vertical axis panel control */
+    uint32_t LCDTIMING2;          /* Clock and signal polarity control */
+    uint32_t LCDTIMING3;          /* Line end control */
+    uint32_t LCDUPBASE;           /* Upper panel frame base address */
+    uint32_t LCDLPBASE;           /* Lower panel frame base address */
+    uint32_t LCDCONTROL;          /* Control */
+    uint32_t LCDIMSC;             /* Interrupt mask set/clear */
+    const uint32_t LCDRIS;        /* Raw interrupt status, read only */
+    const uint32_t LCDMIS;        /* Masked interrupt status, read only */
+    uint32_t LCDICR;              /* Interrupt clear, write only */
+    const uint32_t LCDUPCURR;     /* Upper panel current address, read only */
+    const uint32_t LCDLPCURR;     /* Lower panel current address, read only */
+} ARM926EJS_CLCD_REGS;
+
+static volatile ARM926EJS_CLCD_REGS* const pReg = (ARM926EJS_CLCD_REGS*) (BSP_CLCD_BASE_ADDRESS);
+
+
+/*
+ * Geometry and timing of display modes. Margins and sync pulses are given
+ * in pixel clocks (horizontal) and lines (vertical), the oscillator's
+ * settings are described at sysreg_setOscillator().
+ */
+typedef struct _clcdModeInfo
+{
+    uint16_t width;               /* must be a multiple of 16 */
+    uint16_t height;
+    uint32_t osc;                 /* pixel clock */
+    uint8_t hsw;                  /* horizontal sync pulse width */
+    uint8_t hfp;                  /* horizontal front porch */
+    uint8_t hbp;                  /* horizontal back porch */
+    uint8_t vsw;                  /* vertical sync pulse width */
+    uint8_t vfp;                  /* vertical front porch */
+    uint8_t vbp;                  /* vertical back porch */
+} clcdModeInfo;
+
+static const clcdModeInfo __modes[CLCD_NR_MODES] =
+{
+    /* CLCD_MODE_QVGA: 10 MHz = 48 MHz * 50 / (24 * 10) */
+    { 320, 240, 0x00002C2A,  6,  6,  6, 6,  5,  5 },
+
+    /* CLCD_MODE_VGA: 25.17 MHz = 48 MHz * 193 / (46 * 8) */
+    { 640, 480, 0x000258B9, 96, 24, 40, 2, 11, 32 }
+};
+
+
+/* Framebuffers, __fb[__front] is displayed: */
+static clcdSurface __fb[2];
+static uint8_t __front;
+static uint8_t __nrBuffers = 0;         /* 0 if the driver is not initialized */
+
+static volatile int8_t __swapPending = 0;
+static volatile uint32_t __nrSwaps = 0;
+
+
+/* State of the asynchronous copy, see clcd_blitAsync(): */
+typedef struct _clcdBlit
+{
+    uint16_t* dst;                /* first pixel of the current row */
+    const uint16_t* src;
+    uint32_t rowBytes;            /* bytes of a row */
+    uint32_t done;                /* bytes of the current row, already copied */
+    uint32_t chunk;               /* bytes of the DMA transfer in progress */
+    uint32_t rows;                /* remaining rows, including the current one */
+    uint16_t dstStride;           /* pixels between rows */
+    uint16_t srcStride;
+    clcdCallback callback;
+    void* param;
+} clcdBlit;
+
+static clcdBlit __blit;
+static volatile int8_t __blitBusy = 0;
+
+
+/*
+ * Fills words with a pattern, 8 words per store instruction.
+ *
+ * @param dst - first word
+ * @param pattern - the value to store
+ * @param n - number of words
+ */
+static void __fillWords(uint32_t* dst, uint32_t pattern, uint32_t n)
+{
+#ifndef BSP_HOST_SIM
+    uint32_t bursts = n >> 3;
+
+    if ( bursts > 0 )
+    {
+        __asm volatile(
+            "MOV r3, %2 \n\t"
+            "MOV r4, %2 \n\t"
+            "MOV r5, %2 \n\t"
+            "MOV r6, %2 \n\t"
+            "MOV r7, %2 \n\t"
+            "MOV r8, %2 \n\t"
+            "MOV r9, %2 \n\t"
+            "MOV r10, %2 \n\t"
+            "1: \n\t"
+            "STMIA %0!, {r3-r10} \n\t"
+            "SUBS %1, %1, #1 \n\t"
+            "BNE 1b \n\t"
+            : "+r" (dst), "+r" (bursts)
+            : "r" (pattern)
+            : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory" );
+    }
+
+    n &= 0x07;
+#endif
+
+    for ( ; n>0; --n )
+    {
+        *dst++ = pattern;
+    }
+}
+
+
+/*
+ * Copies words, 8 words per load and store instruction. The blocks may
+ * overlap if 'dst' precedes 'src'.
+ *
+ * @param dst - destination
+ * @param src - source
+ * @param n - number of words
+ */
+static void __copyWords(uint32_t* dst, const uint32_t* src, uint32_t n)
+{
+#ifndef BSP_HOST_SIM
+    uint32_t bursts = n >> 3;
+
+    if ( bursts > 0 )
+    {
+        __asm volatile(
+            "1: \n\t"
+            "LDMIA %1!, {r3-r10} \n\t"
+            "STMIA %0!, {r3-r10} \n\t"
+            "SUBS %2, %2, #1 \n\t"
+            "BNE 1b \n\t"
+            : "+r" (dst), "+r" (src), "+r" (bursts)
+            :
+            : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory" );
+    }
+
+    n &= 0x07;
+#endif
+
+    for ( ; n>0; --n )
+    {
+        *dst++ = *src++;
+    }
+}
+
+
+/*
+ * Fills a row of pixels.
+ *
+ * @param p - first pixel
+ * @param n - number of pixels
+ * @param color - the pixel value
+ */
+static void __fillRow(uint16_t* p, uint32_t n, uint16_t color)
+{
+    if ( 0 != ((uint32_t) p & 0x02) && n > 0 )
+    {
+        *p++ = color;
+        --n;
+    }
+
+    __fillWords((uint32_t*) p, color | ((uint32_t) color << 16), n >> 1);
+
+    if ( 0 != (n & 1) )
+    {
+        p[n - 1] = color;
+    }
+}
+
+
+/*
+ * Copies a row of pixels from the first to the last one. The rows may
+ * overlap if 'dst' precedes 'src'.
+ *
+ * @param dst - first destination pixel
+ * @param src - first source pixel
+ * @param n - number of pixels
+ */
+static void __copyRow(uint16_t* dst, const uint16_t* src, uint32_t n)
+{
+    /* Words can only be copied if both rows are equally aligned */
+    if ( 0 != (((uint32_t) dst ^ (uint32_t) src) & 0x02) )
+    {
+        for ( ; n>0; --n )
+        {
+            *dst++ = *src++;
+        }
+        return;
+    }
+
+    if ( 0 != ((uint32_t) dst & 0x02) && n > 0 )
+    {
+        *dst++ = *src++;
+        --n;
+    }
+
+    __copyWords((uint32_t*) dst, (const uint32_t*) src, n >> 1);
+
+    if ( 0 != (n & 1) )
+    {
+        dst[n - 1] = src[n - 1];
+    }
+}
+
+
+/*
+ * Clips a rectangle, copied between two surfaces, to both of them.
+ *
+ * @param dst - destination surface
+ * @param dx - x coordinate of the destination rectangle
+ * @param dy - y coordinate of the destination rectangle
+ * @param src - source surface
+ * @param sx - x coordinate of the source rectangle
+ * @param sy - y coordinate of the source rectangle
+ * @param w - width of the rectangle, reduced if necessary
+ * @param h - height of the rectangle, reduced if necessary
+ *
+ * @return a nonzero value if anything remains to be copied, 0 otherwise
+ */
+static int8_t __clip(const clcdSurface* dst, uint16_t dx, uint16_t dy,
+                     const clcdSurface* src, uint16_t sx, uint16_t sy, uint16_t* w, uint16_t* h)
+{
+    if ( dx >= dst->width || dy >= dst->height || sx >= src->width || sy >= src->height )
+    {
+        return 0;
+    }
+
+    if ( *w > dst->width - dx )
+    {
+        *w = dst->width - dx;
+    }
+
+    if ( *w > src->width - sx )
+    {
+        *w = src->width - sx;
+    }
+
+    if ( *h > dst->height - dy )
+    {
+        *h = dst->height - dy;
+    }
+
+    if ( *h > src->height - sy )
+    {
+        *h = src->height - sy;
+    }
+
+    return ( 0 != *w && 0 != *h ? 1 : 0 );
+}
+
+
+/*
+ * @return a nonzero value if the surface is valid, 0 otherwise
+ */
+static int8_t __isValid(const clcdSurface* s)
+{
+    return ( NULL != s && NULL != s->pixels ? 1 : 0 );
+}
+
+
+/*
+ * ISR of the CLCD, completes a pending swap when the controller
+ * has loaded the new base address.
+ *
+ * @param param - unused
+ */
+static void __clcdIsr(void* param)
+{
+    const uint32_t mis = pReg->LCDMIS;
+
+    if ( 0 == (mis & INT_BASE_UPDATE) )
+    {
+        return;
+    }
+
+    CLEAR_INT(INT_BASE_UPDATE);
+
+    if ( 0 != __swapPending )
+    {
+        __front ^= 1;
+        ++__nrSwaps;
+        __swapPending = 0;
+        pReg->LCDIMSC = 0;
+    }
+}
+
+
+/**
+ * Initializes the CLCD: sets the display mode and the pixel clock, clears
+ * the framebuffers, displays the first one and registers the driver's ISR
+ * (as a nonvectored IRQ) and enables it at the interrupt controller.
+ *
+ * Each framebuffer must be 8-byte aligned and at least CLCD_FB_SIZE(w, h)
+ * bytes large, where w and h are the mode's dimensions.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param mode - display mode (one of CLCD_MODE_*)
+ * @param fb0 - the first framebuffer
+ * @param fb1 - the second framebuffer, NULL if only one is used
+ * @param priority - priority of the CLCD's IRQ (see pic_registerNonVectoredIrq())
+ *
+ * @return CLCD_OK on success, CLCD_ERR_PARAM if any parameter is invalid or the ISR could not be registered
+ */
+int8_t clcd_init(uint8_t mode, void* fb0, void* fb1, uint8_t priority)
+{
+    const clcdModeInfo* m;
+    uint8_t i;
+
+    if ( mode >= CLCD_NR_MODES || NULL == fb0 ||
+         0 != ((uint32_t) fb0 & 0x07) || 0 != ((uint32_t) fb1 & 0x07) )
+    {
+        return CLCD_ERR_PARAM;
+    }
+
+    /* The controller is stopped while it is reconfigured */
+    pReg->LCDIMSC = 0;
+    pReg->LCDCONTROL &= ~CTRL_POWER;
+    pReg->LCDCONTROL &= ~CTRL_ENABLE;
+    CLEAR_INT(INT_ALL);
+
+    m = &__modes[mode];
+    __nrBuffers = ( NULL == fb1 ? 1 : 2 );
+    __front = 0;
+    __swapPending = 0;
+    __nrSwaps = 0;
+    __blitBusy = 0;
+    __fb[0].pixels = (uint16_t*) fb0;
+    __fb[1].pixels = (uint16_t*) ( NULL == fb1 ? fb0 : fb1 );
+
+    for ( i=0; i<2; ++i )
+    {
+        __fb[i].width = m->width;
+        __fb[i].height = m->height;
+        __fillWords((uint32_t*) __fb[i].pixels, 0, CLCD_FB_SIZE(m->width, m->height) >> 2);
+    }
+
+    sysreg_setOscillator(SYSREG_OSC_CLCD, m->osc);
+    sysreg_setClcdControl(SYSREG_CLCD_MODE_565_BLSB | SYSREG_CLCD_NLCDIOON | SYSREG_CLCD_PWR3V5SWITCH);
+
+    pReg->LCDTIMING0 = ((uint32_t) (m->hbp - 1) << 24) | ((uint32_t) (m->hfp - 1) << 16) |
+                       ((uint32_t) (m->hsw - 1) << 8) | ((uint32_t) (m->width / 16 - 1) << 2);
+    pReg->LCDTIMING1 = ((uint32_t) m->vbp << 24) | ((uint32_t) m->vfp << 16) |
+                       ((uint32_t) (m->vsw - 1) << 10) | (m->height - 1);
+    pReg->LCDTIMING2 = TIM2_BYPASS_DIV | ((uint32_t) (m->width - 1) << 16) | TIM2_IHS | TIM2_IVS;
+    pReg->LCDTIMING3 = 0;
+    pReg->LCDUPBASE = (uint32_t) __fb[0].pixels;
+    pReg->LCDLPBASE = 0;
+
+    if ( pic_registerNonVectoredIrq(BSP_CLCD_IRQ, &__clcdIsr, NULL, priority) < 0 )
+    {
+        __nrBuffers = 0;
+        return CLCD_ERR_PARAM;
+    }
+
+    pic_enableInterrupt(BSP_CLCD_IRQ);
+
+    /* The display's signals are powered after the controller is enabled */
+    pReg->LCDCONTROL = CTRL_TFT | CTRL_BPP16 | CTRL_ENABLE;
+    pReg->LCDCONTROL |= CTRL_POWER;
+
+    return CLCD_OK;
+}
+
+
+/**
+ * Disables the controller and its interrupt. A pending swap is discarded.
+ */
+void clcd_disable(void)
+{
+    pReg->LCDIMSC = 0;
+    pReg->LCDCONTROL &= ~CTRL_POWER;
+    pReg->LCDCONTROL &= ~CTRL_ENABLE;
+    CLEAR_INT(INT_ALL);
+
+    pic_disableInterrupt(BSP_CLCD_IRQ);
+
+    __swapPending = 0;
+}
+
+
+/**
+ * The buffer to draw into. It must not be modified while a swap is
+ * pending (see clcd_waitSwap()). If only one framebuffer is used,
+ * it is the displayed one.
+ *
+ * @return the back buffer, NULL if the driver is not initialized
+ */
+clcdSurface* clcd_getBack(void)
+{
+    if ( 0 == __nrBuffers )
+    {
+        return NULL;
+    }
+
+    return &__fb[ 2 == __nrBuffers ? __front ^ 1 : __front ];
+}
+
+
+/**
+ * @return the displayed buffer, NULL if the driver is not initialized
+ */
+const clcdSurface* clcd_getFront(void)
+{
+    return ( 0 == __nrBuffers ? NULL : &__fb[__front] );
+}
+
+
+/**
+ * Requests the back buffer to be displayed from the next frame on. The
+ * buffers are exchanged when the controller has loaded its address.
+ *
+ * Has no effect if only one framebuffer is used.
+ *
+ * @return CLCD_OK on success, CLCD_ERR_BUSY if a swap is already pending, CLCD_ERR_NOINIT if the driver is not initialized
+ */
+int8_t clcd_swap(void)
+{
+    if ( 0 == __nrBuffers )
+    {
+        return CLCD_ERR_NOINIT;
+    }
+
+    if ( 1 == __nrBuffers )
+    {
+        return CLCD_OK;
+    }
+
+    if ( 0 != __swapPending )
+    {
+        return CLCD_ERR_BUSY;
+    }
+
+    /*
+     * The interrupt is cleared after the address is written, so it can
+     * only be raised again by a load of the new address. If the load
+     * occurs in between, the swap is completed a frame later.
+     */
+    pReg->LCDUPBASE = (uint32_t) __fb[__front ^ 1].pixels;
+    CLEAR_INT(INT_BASE_UPDATE);
+    __swapPending = 1;
+    pReg->LCDIMSC = INT_BASE_UPDATE;
+
+    return CLCD_OK;
+}
+
+
+/**
+ * @return a nonzero value (typically 1) if a swap is pending, 0 otherwise
+ */
+int8_t clcd_isSwapPending(void)
+{
+    return ( 0 != __swapPending ? 1 : 0 );
+}
+
+
+/**
+ * Waits until the pending swap (if any) completes.
+ *
+ * If the IRQ mode is enabled, the CPU waits in its low power state.
+ * Otherwise the controller's interrupt status is polled.
+ */
+void clcd_waitSwap(void)
+{
+    if ( 0 == irq_isIrqModeEnabled() )
+    {
+        while ( 0 != __swapPending )
+        {
+            POLL_DELAY();
+            __clcdIsr(NULL);
+        }
+
+        return;
+    }
+
+    for ( ; ; )
+    {
+        irq_disableIrqMode();
+
+        if ( 0 == __swapPending )
+        {
+            break;  /* out of for */
+        }
+
+        cpuload_idle();
+        irq_enableIrqMode();
+    }
+
+    irq_enableIrqMode();
+}
+
+
+/**
+ * @return number of completed swaps since the driver was initialized
+ */
+uint32_t clcd_getNrSwaps(void)
+{
+    return __nrSwaps;
+}
+
+
+/**
+ * Fills a rectangle with a color.
+ *
+ * @param dst - surface to draw into
+ * @param x - x coordinate of the rectangle's top left pixel
+ * @param y - y coordinate of the rectangle's top left pixel
+ * @param w - width of the rectangle
+ * @param h - height of the rectangle
+ * @param color - the pixel value (see CLCD_RGB())
+ *
+ * @return CLCD_OK on success, CLCD_ERR_PARAM if the surface is invalid
+ */
+int8_t clcd_fillRect(clcdSurface* dst, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+{
+    uint16_t* p;
+
+    if ( 0 == __isValid(dst) )
+    {
+        return CLCD_ERR_PARAM;
+    }
+
+    if ( 0 == __clip(dst, x, y, dst, x, y, &w, &h) )
+    {
+        return CLCD_OK;
+    }
+
+    for ( p = dst->pixels + (uint32_t) y * dst->width + x; h>0; --h, p += dst->width )
+    {
+        __fillRow(p, w, color);
+    }
+
+    return CLCD_OK;
+}
+
+
+/**
+ * Copies a rectangle of pixels. The source and destination may be the
+ * same surface and their rectangles may overlap (e.g. when scrolling).
+ *
+ * @param dst - destination surface
+ * @param dx - x coordinate of the destination rectangle
+ * @param dy - y coordinate of the destination rectangle
+ * @param src - source surface
+ * @param sx - x coordinate of the source rectangle
+ * @param sy - y coordinate of the source rectangle
+ * @param w - width of the rectangle
+ * @param h - height of the rectangle
+ *
+ * @return CLCD_OK on success, CLCD_ERR_PARAM if any surface is invalid
+ */
+int8_t clcd_blit(clcdSurface* dst, uint16_t dx, uint16_t dy,
+                 const clcdSurface* src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h)
+{
+    uint16_t* d;
+    const uint16_t* s;
+    uint32_t i;
+
+    if ( 0 == __isValid(dst) || 0 == __isValid(src) )
+    {
+        return CLCD_ERR_PARAM;
+    }
+
+    if ( 0 == __clip(dst, dx, dy, src, sx, sy, &w, &h) )
+    {
+        return CLCD_OK;
+    }
+
+    d = dst->pixels + (uint32_t) dy * dst->width + dx;
+    s = src->pixels + (uint32_t) sy * src->width + sx;
+
+    if ( d <= s || d >= s + (uint32_t) (h - 1) * src->width + w )
+    {
+        /* The destination precedes the source (or they do not overlap) */
+        for ( ; h>0; --h, d += dst->width, s += src->width )
+        {
+            __copyRow(d, s, w);
+        }
+    }
+    else if ( dy > sy )
+    {
+        /* Rows are copied from the last one */
+        d += (uint32_t) (h - 1) * dst->width;
+        s += (uint32_t) (h - 1) * src->width;
+        for ( ; h>0; --h, d -= dst->width, s -= src->width )
+        {
+            __copyRow(d, s, w);
+        }
+    }
+    else
+    {
+        /* The same rows, moved to the right: pixels are copied from the last one */
+        for ( ; h>0; --h, d += dst->width, s += src->width )
+        {
+            for ( i=w; i>0; --i )
+            {
+                d[i - 1] = s[i - 1];
+            }
+        }
+    }
+
+    return CLCD_OK;
+}
+
+
+/*
+ * Completes the asynchronous copy and calls its callback.
+ *
+ * @param status - status of the copy (CLCD_OK or CLCD_ERR_DMA)
+ */
+static void __blitFinish(int8_t status)
+{
+    const clcdCallback cb = __blit.callback;
+    void* const param = __blit.param;
+
+    /* The copy is released before the callback, so it may start another one */
+    __blitBusy = 0;
+
+    if ( NULL != cb )
+    {
+        cb(status, param);
+    }
+}
+
+
+static void __blitDmaDone(int8_t status, void* param);
+
+
+/*
+ * Starts the DMA transfer of the next chunk of the current row. If no
+ * transfer can be started (e.g. no DMA channel is available), the rest
+ * is copied by the CPU and the copy is completed.
+ */
+static void __blitNext(void)
+{
+    uint8_t* const d = (uint8_t*) __blit.dst + __blit.done;
+    const uint8_t* const s = (const uint8_t*) __blit.src + __blit.done;
+    uint32_t max = dma_maxTransferSize();
+    uint32_t chunk = __blit.rowBytes - __blit.done;
+
+    /* Transfers of halfwords are limited to a half */
+    if ( 0 != (((uint32_t) d | (uint32_t) s | chunk) & 0x03) )
+    {
+        max >>= 1;
+    }
+
+    __blit.chunk = ( chunk > max ? max : chunk );
+
+    if ( dma_memcpyAsync(d, s, __blit.chunk, &__blitDmaDone, NULL) >= 0 )
+    {
+        return;
+    }
+
+    /* No transfer could be started, the rest is copied by the CPU */
+    __copyRow((uint16_t*) d, (const uint16_t*) s, chunk >> 1);
+    while ( --__blit.rows > 0 )
+    {
+        __blit.dst += __blit.dstStride;
+        __blit.src += __blit.srcStride;
+        __copyRow(__blit.dst, __blit.src, __blit.rowBytes >> 1);
+    }
+
+    __blitFinish(CLCD_OK);
+}
+
+
+/*
+ * Callback of the DMA transfers, advances the asynchronous copy.
+ *
+ * @param status - status of the transfer
+ * @param param - unused
+ */
+static void __blitDmaDone(int8_t status, void* param)
+{
+    if ( DMA_STATUS_OK != status )
+    {
+        __blitFinish(CLCD_ERR_DMA);
+        return;
+    }
+
+    __blit.done += __blit.chunk;
+    if ( __blit.done == __blit.rowBytes )
+    {
+        if ( --__blit.rows == 0 )
+        {
+            __blitFinish(CLCD_OK);
+            return;
+        }
+
+        __blit.dst += __blit.dstStride;
+        __blit.src += __blit.srcStride;
+        __blit.done = 0;
+    }
+
+    __blitNext();
+}
+
+
+/**
+ * Copies a rectangle of pixels by the DMA controller. Rows are copied
+ * one after another, a rectangle that spans whole rows of both surfaces
+ * is copied as a single block. The callback is called when the copy
+ * completes (immediately if nothing is to be copied).
+ *
+ * The DMA controller must be initialized (see dma_init()). Overlapping
+ * rectangles are not supported. Neither rectangle should be accessed
+ * until the copy completes.
+ *
+ * @param dst - destination surface
+ * @param dx - x coordinate of the destination rectangle
+ * @param dy - y coordinate of the destination rectangle
+ * @param src - source surface
+ * @param sx - x coordinate of the source rectangle
+ * @param sy - y coordinate of the source rectangle
+ * @param w - width of the rectangle
+ * @param h - height of the rectangle
+ * @param callback - function to be called when the copy completes (may be NULL)
+ * @param param - parameter, passed to the callback
+ *
+ * @return CLCD_OK if the copy was started, CLCD_ERR_BUSY if another copy is in progress, CLCD_ERR_PARAM if parameters are invalid (the callback is not called then)
+ */
+int8_t clcd_blitAsync(clcdSurface* dst, uint16_t dx, uint16_t dy,
+                      const clcdSurface* src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h,
+                      clcdCallback callback, void* param)
+{
+    uint16_t* d;
+    const uint16_t* s;
+
+    if ( 0 == __isValid(dst) || 0 == __isValid(src) )
+    {
+        return CLCD_ERR_PARAM;
+    }
+
+    if ( 0 != __blitBusy )
+    {
+        return CLCD_ERR_BUSY;
+    }
+
+    __blit.callback = callback;
+    __blit.param = param;
+
+    if ( 0 == __clip(dst, dx, dy, src, sx, sy, &w, &h) )
+    {
+        __blitFinish(CLCD_OK);
+        return CLCD_OK;
+    }
+
+    d = dst->pixels + (uint32_t) dy * dst->width + dx;
+    s = src->pixels + (uint32_t) sy * src->width + sx;
+
+    if ( d < s + (uint32_t) (h - 1) * src->width + w && s < d + (uint32_t) (h - 1) * dst->width + w )
+    {
+        return CLCD_ERR_PARAM;
+    }
+
+    __blitBusy = 1;
+    __blit.dst = d;
+    __blit.src = s;
+    __blit.done = 0;
+    __blit.dstStride = dst->width;
+    __blit.srcStride = src->width;
+
+    if ( w == dst->width && w == src->width )
+    {
+        __blit.rowBytes = CLCD_FB_SIZE(w, h);
+        __blit.rows = 1;
+    }
+    else
+    {
+        __blit.rowBytes = (uint32_t) w * 2;
+        __blit.rows = h;
+    }
+
+    __blitNext();
+
+    return CLCD_OK;
+}
+
+
+/**
+ * @return a nonzero value (typically 1) if an asynchronous copy is in progress, 0 otherwise
+ */
+int8_t clcd_isBlitBusy(void)
+{
+    return ( 0 != __blitBusy ? 1 : 0 );
+}
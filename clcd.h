@@ -0,0 +1,112 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the PL110 color LCD
+ * controller (CLCD) driver.
+ *
+ * The display is driven in 16 bpp (RGB 5:6:5) TFT mode from one or two
+ * framebuffers, provided by the application. With two framebuffers, the
+ * application draws into the back buffer and calls clcd_swap(). The
+ * buffers are exchanged at the beginning of the next frame (when the
+ * controller reports that it has loaded the new base address), so the
+ * display never shows a partially drawn buffer.
+ *
+ * Drawing functions clip rectangles to both surfaces.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _CLCD_H_
+#define _CLCD_H_
+
+#include <stdint.h>
+
+
+/* Supported display modes: */
+#define CLCD_MODE_QVGA           0     /* 320 x 240 */
+#define CLCD_MODE_VGA            1     /* 640 x 480, 60 Hz */
+#define CLCD_NR_MODES            2
+
+/* Size of a framebuffer in bytes (must be 8-byte aligned): */
+#define CLCD_FB_SIZE(W, H)       ( (uint32_t) (W) * (H) * 2 )
+
+/* Converts 8-bit color components into a pixel: */
+#define CLCD_RGB(R, G, B)        ( (uint16_t) ( (((R) & 0xF8) << 8) | (((G) & 0xFC) << 3) | (((B) & 0xF8) >> 3) ) )
+
+
+/* Return values of clcd_* functions and status of completed asynchronous copies: */
+#define CLCD_OK                  0
+#define CLCD_ERR_PARAM          -1     /* invalid mode, buffer, surface or overlapping rectangles */
+#define CLCD_ERR_NOINIT         -2     /* the driver is not initialized */
+#define CLCD_ERR_BUSY           -3     /* another asynchronous copy is in progress */
+#define CLCD_ERR_DMA            -4     /* a DMA transfer failed */
+
+
+/**
+ * A rectangular area of pixels, e.g. a framebuffer.
+ * Rows are stored consecutively without any padding.
+ */
+typedef struct _clcdSurface
+{
+    uint16_t* pixels;             /* the top left pixel */
+    uint16_t width;
+    uint16_t height;
+} clcdSurface;
+
+
+/**
+ * Required prototype of callbacks, called (typically from the DMA ISR)
+ * when an asynchronous copy completes.
+ *
+ * @param status - CLCD_OK if the copy completed successfully, CLCD_ERR_DMA otherwise
+ * @param param - parameter, passed to clcd_blitAsync()
+ */
+typedef void (*clcdCallback)(int8_t status, void* param);
+
+
+int8_t clcd_init(uint8_t mode, void* fb0, void* fb1, uint8_t priority);
+
+void clcd_disable(void);
+
+clcdSurface* clcd_getBack(void);
+
+const clcdSurface* clcd_getFront(void);
+
+int8_t clcd_swap(void);
+
+int8_t clcd_isSwapPending(void);
+
+void clcd_waitSwap(void);
+
+uint32_t clcd_getNrSwaps(void);
+
+int8_t clcd_fillRect(clcdSurface* dst, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+
+int8_t clcd_blit(clcdSurface* dst, uint16_t dx, uint16_t dy,
+                 const clcdSurface* src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h);
+
+int8_t clcd_blitAsync(clcdSurface* dst, uint16_t dx, uint16_t dy,
+                      const clcdSurface* src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h,
+                      clcdCallback callback, void* param);
+
+int8_t clcd_isBlitBusy(void);
+
+#endif  /* _CLCD_H_ */
@@ -0,0 +1,164 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the high resolution free running clock.
+ *
+ * Two backends are available:
+ * - SYS_24MHZ (default): the board's 24 MHz counter in the system registers.
+ *   It counts up, requires no setup and does not occupy any timer.
+ * - SP804 (if CLOCKSOURCE_SP804 is defined): one counter of a SP804 timer,
+ *   running in periodic mode with the maximum load value, which is equivalent
+ *   to the free running mode. As the counter counts down, its value is
+ *   complemented, so the clock counts up.
+ *
+ * With both backends, differences of two readings are correct even if
+ * the counter wraps around (after approx. 179 s with SYS_24MHZ and after
+ * approx. 71 minutes with SP804).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef CLOCKSOURCE_SP804
+
+#include "timer.h"
+
+/* Timer and counter, dedicated to the clock: */
+#define CS_TIMER            1
+#define CS_COUNTER          1
+
+/* Frequency of the SP804 reference clock (TIMCLK) in Hz: */
+#define CS_FREQUENCY        1000000UL
+
+/* The counter counts down, its value is XOR'ed by this mask, so the clock counts up: */
+#define CS_COUNTER_MASK     0xFFFFFFFFUL
+
+#else
+
+#include "sysreg.h"
+
+#define CS_FREQUENCY        SYSREG_24MHZ_FREQUENCY
+
+/* The counter counts up: */
+#define CS_COUNTER_MASK     0x00000000UL
+
+#endif
+
+
+/* Address of the counter, set by clocksource_init() */
+static const volatile uint32_t* __csValue = NULL;
+
+
+/**
+ * Initializes and starts the clock.
+ *
+ * The clock is shared by several modules, each of them initializes it. If the clock
+ * is already running, it is not restarted, so its readings remain monotonic.
+ *
+ * @note With the SP804 backend, the timer's counter, dedicated to the clock, must not
+ * be used for any other purpose!
+ */
+void clocksource_init(void)
+{
+#ifdef CLOCKSOURCE_SP804
+    if ( NULL != __csValue && 0 != timer_isEnabled(CS_TIMER, CS_COUNTER) )
+    {
+        return;
+    }
+
+    timer_init(CS_TIMER, CS_COUNTER);
+    timer_setLoad(CS_TIMER, CS_COUNTER, 0xFFFFFFFF);
+    timer_start(CS_TIMER, CS_COUNTER);
+
+    __csValue = timer_getValueAddr(CS_TIMER, CS_COUNTER);
+#else
+    /* SYS_24MHZ is always running */
+    __csValue = sysreg_get24MHzAddr();
+#endif
+}
+
+
+/**
+ * Reads the current value of the clock. It counts up and wraps around
+ * to 0 after 0xFFFFFFFF.
+ *
+ * 0 is returned if the clock has not been initialized yet.
+ *
+ * @return current value of the clock in ticks (see clocksource_getFrequency())
+ */
+uint32_t clocksource_read(void)
+{
+    return ( NULL==__csValue ? 0 : *__csValue ^ CS_COUNTER_MASK );
+}
+
+
+/**
+ * @return frequency of the clock in Hz
+ */
+uint32_t clocksource_getFrequency(void)
+{
+    return CS_FREQUENCY;
+}
+
+
+/**
+ * Address of the clock's hardware counter. Together with clocksource_getCounterMask()
+ * it allows time critical code (e.g. trace points) to read the clock without
+ * the overhead of a function call:
+ *
+ *     ticks = *addr ^ mask;
+ *
+ * NULL is returned if the clock has not been initialized yet.
+ *
+ * @note Contents at this address are read only and should not be modified.
+ *
+ * @return read-only address of the clock's counter
+ */
+const volatile uint32_t* clocksource_getCounterAddr(void)
+{
+    return __csValue;
+}
+
+
+/**
+ * @return mask that must be XOR'ed to the counter's value to obtain the clock (see clocksource_getCounterAddr())
+ */
+uint32_t clocksource_getCounterMask(void)
+{
+    return CS_COUNTER_MASK;
+}
+
+
+/**
+ * Converts a number of clock ticks (e.g. a difference of two readings)
+ * into micro seconds.
+ *
+ * @param ticks - number of clock ticks
+ *
+ * @return number of micro seconds (rounded down)
+ */
+uint32_t clocksource_ticksToUs(uint32_t ticks)
+{
+    /* The divisor is a constant, so the compiler does not need a division routine */
+    return ticks / (CS_FREQUENCY / 1000000UL);
+}
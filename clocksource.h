@@ -0,0 +1,50 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions that handle the high resolution
+ * free running clock, used for profiling and benchmarks.
+ *
+ * By default, the clock is the board's SYS_24MHZ counter (see sysreg.h).
+ * If CLOCKSOURCE_SP804 is defined, one counter of a SP804 timer (1 MHz)
+ * is used instead.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _CLOCKSOURCE_H_
+#define _CLOCKSOURCE_H_
+
+#include <stdint.h>
+
+
+void clocksource_init(void);
+
+uint32_t clocksource_read(void);
+
+uint32_t clocksource_getFrequency(void);
+
+const volatile uint32_t* clocksource_getCounterAddr(void);
+
+uint32_t clocksource_getCounterMask(void);
+
+uint32_t clocksource_ticksToUs(uint32_t ticks);
+
+#endif  /* _CLOCKSOURCE_H_ */
@@ -0,0 +1,355 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the dirty rectangle compositor.
+ *
+ * Dirty rectangles are kept as boxes with exclusive right and bottom
+ * edges in a small unordered array. Boxes in the array never overlap.
+ * A new rectangle is merged with any box it overlaps or may be merged
+ * with, the result is removed from the array and checked again, as the
+ * bounding box may now overlap or be merged with other boxes.
+ * Dirty areas are copied by clcd_blit(), i.e. by bursts of the CPU.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "comp.h"
+#include "clcd.h"
+
+
+/*
+ * A rectangle, (x0, y0) is its top left pixel,
+ * x1 and y1 are exclusive.
+ */
+typedef struct _compBox
+{
+    uint32_t x0;
+    uint32_t y0;
+    uint32_t x1;
+    uint32_t y1;
+} compBox;
+
+
+static clcdSurface* __front = NULL;
+static const clcdSurface* __back = NULL;
+static compBox __boxes[COMP_MAX_RECTS];
+static uint8_t __nrBoxes = 0;
+static compStats __stats;
+
+
+/*
+ * @param b - a box
+ *
+ * @return number of pixels of the box
+ */
+static inline uint32_t __area(const compBox* b)
+{
+    return (b->x1 - b->x0) * (b->y1 - b->y0);
+}
+
+
+/*
+ * Calculates the bounding box of two boxes.
+ *
+ * @param u - the bounding box
+ * @param a - the first box
+ * @param b - the second box
+ */
+static void __union(compBox* u, const compBox* a, const compBox* b)
+{
+    u->x0 = ( a->x0 < b->x0 ? a->x0 : b->x0 );
+    u->y0 = ( a->y0 < b->y0 ? a->y0 : b->y0 );
+    u->x1 = ( a->x1 > b->x1 ? a->x1 : b->x1 );
+    u->y1 = ( a->y1 > b->y1 ? a->y1 : b->y1 );
+}
+
+
+/*
+ * @param a - a box
+ * @param b - another box
+ *
+ * @return a nonzero value if the boxes have at least one common pixel, 0 otherwise
+ */
+static inline int8_t __overlaps(const compBox* a, const compBox* b)
+{
+    return ( a->x0 < b->x1 && b->x0 < a->x1 && a->y0 < b->y1 && b->y0 < a->y1 ? 1 : 0 );
+}
+
+
+/*
+ * Removes a box from the array, the last box takes its place.
+ *
+ * @param idx - index of the box
+ */
+static void __remove(uint8_t idx)
+{
+    --__nrBoxes;
+    __boxes[idx] = __boxes[__nrBoxes];
+}
+
+
+/*
+ * Merges 'b' with all boxes it overlaps or whose bounding box with 'b'
+ * is not larger than both boxes together. Merged boxes are removed from
+ * the array, the remaining ones do not overlap 'b'.
+ *
+ * @param b - the box, enlarged by merges
+ */
+static void __mergeAll(compBox* b)
+{
+    compBox u;
+    uint8_t i = 0;
+
+    while ( i < __nrBoxes )
+    {
+        __union(&u, b, &__boxes[i]);
+
+        if ( 0 != __overlaps(b, &__boxes[i]) ||
+             __area(&u) <= __area(b) + __area(&__boxes[i]) )
+        {
+            *b = u;
+            __remove(i);
+            ++__stats.merges;
+
+            /* The larger box may now be merged with already checked boxes */
+            i = 0;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+
+/**
+ * Initializes the compositor and marks the whole front surface dirty,
+ * so the first comp_present() copies the complete back surface.
+ *
+ * Both surfaces must be of the same dimensions, e.g. a framebuffer of
+ * the CLCD (see clcd_getFront()) and an off-screen buffer. The
+ * surfaces' descriptors must remain valid while the compositor is used.
+ *
+ * @param front - the displayed surface
+ * @param back - the surface, the application draws into
+ *
+ * @return COMP_OK on success, COMP_ERR_PARAM if the surfaces are invalid
+ */
+int8_t comp_init(clcdSurface* front, const clcdSurface* back)
+{
+    if ( NULL == front || NULL == back || NULL == front->pixels || NULL == back->pixels ||
+         front->pixels == back->pixels ||
+         front->width != back->width || front->height != back->height )
+    {
+        return COMP_ERR_PARAM;
+    }
+
+    __front = front;
+    __back = back;
+    __nrBoxes = 0;
+    comp_resetStats();
+
+    return comp_markAll();
+}
+
+
+/**
+ * Marks a rectangle of the back surface as modified. The rectangle is
+ * clipped to the surface.
+ *
+ * @param x - left edge of the rectangle
+ * @param y - top edge of the rectangle
+ * @param w - width of the rectangle
+ * @param h - height of the rectangle
+ *
+ * @return COMP_OK on success, COMP_ERR_NOINIT if the compositor is not initialized
+ */
+int8_t comp_markDirty(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    compBox b;
+    compBox u;
+    uint32_t best;
+    uint32_t grow;
+    uint8_t bestIdx;
+    uint8_t i;
+
+    if ( NULL == __front )
+    {
+        return COMP_ERR_NOINIT;
+    }
+
+    if ( x >= __front->width || y >= __front->height || 0 == w || 0 == h )
+    {
+        return COMP_OK;
+    }
+
+    b.x0 = x;
+    b.y0 = y;
+    b.x1 = (uint32_t) x + w;
+    b.y1 = (uint32_t) y + h;
+    b.x1 = ( b.x1 > __front->width ? __front->width : b.x1 );
+    b.y1 = ( b.y1 > __front->height ? __front->height : b.y1 );
+
+    __mergeAll(&b);
+
+    if ( COMP_MAX_RECTS == __nrBoxes )
+    {
+        /* Merge with the box, whose bounding box grows the least */
+        best = 0xFFFFFFFF;
+        bestIdx = 0;
+        for ( i=0; i<__nrBoxes; ++i )
+        {
+            __union(&u, &b, &__boxes[i]);
+            grow = __area(&u) - __area(&__boxes[i]);
+            if ( grow < best )
+            {
+                best = grow;
+                bestIdx = i;
+            }
+        }
+
+        __union(&b, &b, &__boxes[bestIdx]);
+        __remove(bestIdx);
+        ++__stats.overflows;
+
+        __mergeAll(&b);
+    }
+
+    __boxes[__nrBoxes++] = b;
+
+    return COMP_OK;
+}
+
+
+/**
+ * Marks the whole back surface as modified.
+ *
+ * @return COMP_OK on success, COMP_ERR_NOINIT if the compositor is not initialized
+ */
+int8_t comp_markAll(void)
+{
+    if ( NULL == __front )
+    {
+        return COMP_ERR_NOINIT;
+    }
+
+    __nrBoxes = 0;
+
+    return comp_markDirty(0, 0, __front->width, __front->height);
+}
+
+
+/**
+ * Copies the current dirty rectangles (e.g. for debugging or for
+ * additional processing by the application).
+ *
+ * @param rects - buffer to copy rectangles into
+ * @param max - max. number of rectangles to copy
+ *
+ * @return number of dirty rectangles (may exceed 'max')
+ */
+uint8_t comp_getDirty(compRect* rects, uint8_t max)
+{
+    uint8_t i;
+
+    for ( i=0; NULL!=rects && i<__nrBoxes && i<max; ++i )
+    {
+        rects[i].x = (uint16_t) __boxes[i].x0;
+        rects[i].y = (uint16_t) __boxes[i].y0;
+        rects[i].w = (uint16_t) (__boxes[i].x1 - __boxes[i].x0);
+        rects[i].h = (uint16_t) (__boxes[i].y1 - __boxes[i].y0);
+    }
+
+    return __nrBoxes;
+}
+
+
+/**
+ * Copies all dirty rectangles from the back to the front surface and
+ * clears them.
+ *
+ * @note The front surface is modified while it may be displayed. To
+ *       avoid tearing, call the function just after a frame has started.
+ *
+ * @return number of copied pixels, 0 if the compositor is not initialized
+ */
+uint32_t comp_present(void)
+{
+    uint32_t pixels = 0;
+    uint8_t i;
+
+    if ( NULL == __front )
+    {
+        return 0;
+    }
+
+    for ( i=0; i<__nrBoxes; ++i )
+    {
+        const compBox* b = &__boxes[i];
+
+        clcd_blit(__front, (uint16_t) b->x0, (uint16_t) b->y0,
+                  __back, (uint16_t) b->x0, (uint16_t) b->y0,
+                  (uint16_t) (b->x1 - b->x0), (uint16_t) (b->y1 - b->y0));
+        pixels += __area(b);
+    }
+
+    ++__stats.frames;
+    __stats.rects += __nrBoxes;
+    __stats.pixels += pixels;
+    __stats.lastPixels = pixels;
+    __stats.maxPixels = ( pixels > __stats.maxPixels ? pixels : __stats.maxPixels );
+
+    __nrBoxes = 0;
+
+    return pixels;
+}
+
+
+/**
+ * Copies statistics of the compositor.
+ *
+ * @param stats - address where the statistics will be copied to
+ */
+void comp_getStats(compStats* stats)
+{
+    if ( NULL != stats )
+    {
+        *stats = __stats;
+    }
+}
+
+
+/**
+ * Resets all counters of the compositor's statistics.
+ */
+void comp_resetStats(void)
+{
+    __stats.frames = 0;
+    __stats.rects = 0;
+    __stats.pixels = 0;
+    __stats.lastPixels = 0;
+    __stats.maxPixels = 0;
+    __stats.merges = 0;
+    __stats.overflows = 0;
+}
@@ -0,0 +1,105 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the dirty rectangle
+ * compositor.
+ *
+ * The application draws into an off-screen back surface and marks the
+ * modified areas by comp_markDirty(). comp_present() then copies only
+ * the dirty rectangles to the displayed (front) surface, so the cost of
+ * a frame is proportional to the amount of change rather than to the
+ * size of the display.
+ *
+ * Two dirty rectangles are merged into their bounding box when the box
+ * is not larger than both rectangles together, i.e. when merging does
+ * not copy any pixel that would not be copied anyway (e.g. contained
+ * or adjacent rectangles of the same height). Overlapping rectangles are
+ * always merged, so dirty rectangles never overlap and no pixel is
+ * copied twice within a frame. When all COMP_MAX_RECTS
+ * slots are used, a new rectangle is merged with the one whose bounding
+ * box grows the least.
+ *
+ * The compositor is not reentrant and must not be accessed from ISRs.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _COMP_H_
+#define _COMP_H_
+
+#include <stdint.h>
+
+#include "clcd.h"
+
+
+/* Max. number of dirty rectangles per frame: */
+#define COMP_MAX_RECTS           16
+
+
+/* Return values of comp_* functions: */
+#define COMP_OK                  0
+#define COMP_ERR_PARAM          -1     /* invalid surfaces */
+#define COMP_ERR_NOINIT         -2     /* the compositor is not initialized */
+
+
+/**
+ * A rectangle, its top left pixel is (x, y).
+ */
+typedef struct _compRect
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+} compRect;
+
+
+/**
+ * Statistics of the compositor, all counters start at 0 when the
+ * compositor is initialized or its statistics are reset.
+ */
+typedef struct _compStats
+{
+    uint32_t frames;            /* calls of comp_present() */
+    uint32_t rects;             /* copied rectangles */
+    uint32_t pixels;            /* copied pixels */
+    uint32_t lastPixels;        /* pixels, copied by the last frame */
+    uint32_t maxPixels;         /* max. pixels, copied by a single frame */
+    uint32_t merges;            /* rectangles, merged to reduce their number */
+    uint32_t overflows;         /* rectangles, merged because all slots were used */
+} compStats;
+
+
+int8_t comp_init(clcdSurface* front, const clcdSurface* back);
+
+int8_t comp_markDirty(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+int8_t comp_markAll(void);
+
+uint8_t comp_getDirty(compRect* rects, uint8_t max);
+
+uint32_t comp_present(void);
+
+void comp_getStats(compStats* stats);
+
+void comp_resetStats(void);
+
+#endif  /* _COMP_H_ */
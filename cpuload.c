@@ -0,0 +1,358 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the CPU load accounting.
+ *
+ * The current context and the clock at its last change are maintained.
+ * At each change of the context (entry to and exit from the IRQ handler or
+ * cpuload_idle()), the time since the last change is charged to the previous
+ * context. Charged intervals are split at bucket boundaries, so even a long
+ * idle period is accounted correctly.
+ *
+ * Accounting is performed either by the IRQ handler or with the CPU's IRQ
+ * mode disabled, so its state is never modified concurrently.
+ *
+ * @note The clock wraps around (after approx. 179 s with the default SYS_24MHZ
+ * backend, see clocksource.h), so the CPU should not remain in a single context
+ * for so long.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cpuload.h"
+#include "clocksource.h"
+#include "interrupt.h"
+#include "arith.h"
+
+
+/*
+ * On the ARM926EJ-S, "wait for interrupt" is a CP15 operation (see the
+ * description of the register c7 in DDI0198). The CPU is woken up by an interrupt request, even if IRQs
+ * are masked in the CPSR. CP15 is only accessible in privileged modes, so
+ * the application (running in the User mode) requests the wait by a software
+ * interrupt (see swi_handler in exception.c) that calls _cpuload_idleHandler().
+ * In the host (unit test) build, the simulated CPU is notified instead.
+ */
+#ifdef BSP_HOST_SIM
+extern void sim_cpu_wfi(void);
+extern void sim_cpu_swi(uint32_t nr);
+#define WFI()           sim_cpu_wfi()
+#define SWI(NR)         sim_cpu_swi(NR)
+#else
+#define WFI()           __asm volatile("MCR p15, 0, %0, c7, c0, 4" : : "r" (0))
+#define SWI(NR)         __asm volatile("SWI #" #NR)
+#endif
+
+
+/* Number of buckets per second and the total number of buckets (+1 for the current one): */
+#define BUCKETS_PER_SEC     10
+#define NR_BUCKETS          ( CPULOAD_WINDOW_10S * BUCKETS_PER_SEC + 1 )
+
+/* Contexts: */
+#define CTX_TASK            0
+#define CTX_IDLE            1
+#define CTX_IRQ             2
+
+
+/*
+ * Time (in clock ticks), spent in the idle and IRQ contexts during a bucket.
+ * The rest of the bucket was spent in the task context.
+ */
+typedef struct _cpuloadBucket
+{
+    uint32_t idle;
+    uint32_t irq;
+} cpuloadBucket;
+
+
+static cpuloadBucket __buckets[NR_BUCKETS];
+
+/* Length of a bucket in clock ticks, 0 if the accounting is not initialized: */
+static volatile uint32_t __bucketLen = 0;
+
+/* Index of the current (incomplete) bucket: */
+static uint8_t __cur;
+
+/* Number of completed buckets, at most NR_BUCKETS-1 (the current bucket excluded): */
+static uint8_t __nrFull;
+
+/* Clock ticks until the end of the current bucket: */
+static uint32_t __remaining;
+
+/* Clock at the last accounting: */
+static uint32_t __stamp;
+
+/* Current context and the context, interrupted by the IRQ handler: */
+static uint8_t __ctx;
+static uint8_t __irqPrevCtx;
+
+
+/*
+ * Charges the time since the last accounting to the current context.
+ *
+ * @param now - current value of the clock
+ */
+static void __account(uint32_t now)
+{
+    uint32_t elapsed = now - __stamp;
+
+    __stamp = now;
+
+    for ( ; ; )
+    {
+        const uint32_t part = ( elapsed < __remaining ? elapsed : __remaining );
+
+        if ( CTX_IDLE == __ctx )
+        {
+            __buckets[__cur].idle += part;
+        }
+        else if ( CTX_IRQ == __ctx )
+        {
+            __buckets[__cur].irq += part;
+        }
+
+        __remaining -= part;
+        elapsed -= part;
+
+        if ( __remaining > 0 )
+        {
+            break;  /* out of for */
+        }
+
+        /* The current bucket is completed, proceed to the next one */
+        __cur = ( __cur < NR_BUCKETS-1 ? __cur+1 : 0 );
+        __buckets[__cur].idle = 0;
+        __buckets[__cur].irq = 0;
+        __remaining = __bucketLen;
+        if ( __nrFull < NR_BUCKETS-1 )
+        {
+            ++__nrFull;
+        }
+    }
+}
+
+
+/**
+ * Initializes (or restarts) the accounting and the clock. All previously
+ * accounted time is discarded.
+ *
+ * The caller is considered to be in the task context.
+ */
+void cpuload_init(void)
+{
+    uint8_t i;
+    const int8_t irqMode = irq_saveIrqMode();
+
+    clocksource_init();
+
+    for ( i=0; i<NR_BUCKETS; ++i )
+    {
+        __buckets[i].idle = 0;
+        __buckets[i].irq = 0;
+    }
+
+    __cur = 0;
+    __nrFull = 0;
+    __ctx = CTX_TASK;
+    __irqPrevCtx = CTX_TASK;
+    __bucketLen = arith_udiv(clocksource_getFrequency(), BUCKETS_PER_SEC);
+    __remaining = __bucketLen;
+    __stamp = clocksource_read();
+
+    irq_restoreIrqMode(irqMode);
+}
+
+
+/**
+ * Waits (in the CPU's low power state) for an interrupt. The time is
+ * accounted as idle. Busy waiting loops should call this function instead
+ * of polling, e.g.:
+ *
+ *     while ( 0 == flag )
+ *     {
+ *         cpuload_idle();
+ *     }
+ *
+ * If the IRQ mode is enabled, the interrupt is serviced before the function
+ * returns.
+ *
+ * @note An interrupt that occurs between the check of a condition and the call
+ * of this function does not wake the CPU, so another interrupt must follow
+ * (e.g. a periodic tick). If the condition is checked with the IRQ mode
+ * disabled and the function is called before it is enabled again, a pending
+ * request wakes the CPU immediately and is serviced when the IRQ mode is
+ * enabled.
+ */
+void cpuload_idle(void)
+{
+    /* A single software interrupt, see _cpuload_idleHandler() */
+    SWI(2);
+}
+
+
+/**
+ * Waits for an interrupt and accounts the time as idle.
+ *
+ * @note This function is called by the SWI handler (see exception.c) in the
+ * Supervisor mode with IRQs masked, so the idle time is accounted before the
+ * interrupt is serviced. It should not be called by any other code.
+ */
+void _cpuload_idleHandler(void)
+{
+    if ( 0 == __bucketLen )
+    {
+        /* Not initialized, just wait */
+        WFI();
+        return;
+    }
+
+    __account(clocksource_read());
+    __ctx = CTX_IDLE;
+
+    WFI();
+
+    __account(clocksource_read());
+    __ctx = CTX_TASK;
+}
+
+
+/**
+ * Obtains the time, spent in each context during the most recent window.
+ *
+ * The window consists of the most recent completed buckets (of 100 ms each),
+ * so it slides with the resolution of 100 ms. Until enough buckets have been
+ * completed since cpuload_init(), the window is shorter (see 'stats->window').
+ *
+ * @param window - length of the window in seconds (CPULOAD_WINDOW_1S or CPULOAD_WINDOW_10S)
+ * @param stats - address where the results will be written to
+ *
+ * @return 0 on success, a negative value if the accounting is not initialized or any parameter is invalid
+ */
+int8_t cpuload_getStats(uint8_t window, cpuloadStats* stats)
+{
+    uint8_t nr;
+    uint8_t idx;
+    uint8_t i;
+    int8_t irqMode;
+
+    if ( 0 == __bucketLen || NULL == stats ||
+         ( CPULOAD_WINDOW_1S != window && CPULOAD_WINDOW_10S != window ) )
+    {
+        return -1;
+    }
+
+    /* Accounting also completes buckets that ended since the last change of the context */
+    irqMode = irq_saveIrqMode();
+    __account(clocksource_read());
+
+    nr = window * BUCKETS_PER_SEC;
+    nr = ( nr > __nrFull ? __nrFull : nr );
+
+    stats->idle = 0;
+    stats->irq = 0;
+    idx = __cur;
+    for ( i=0; i<nr; ++i )
+    {
+        idx = ( idx > 0 ? idx-1 : NR_BUCKETS-1 );
+        stats->idle += __buckets[idx].idle;
+        stats->irq += __buckets[idx].irq;
+    }
+
+    stats->window = nr * __bucketLen;
+
+    irq_restoreIrqMode(irqMode);
+
+    stats->task = stats->window - stats->idle - stats->irq;
+
+    return 0;
+}
+
+
+/**
+ * CPU load (time spent in the task and IRQ contexts) during the most recent window.
+ *
+ * @param window - length of the window in seconds (CPULOAD_WINDOW_1S or CPULOAD_WINDOW_10S)
+ *
+ * @return load in per mille (between 0 and 1000), 0 if not available
+ */
+uint16_t cpuload_getLoad(uint8_t window)
+{
+    cpuloadStats stats;
+    uint32_t busy;
+    uint32_t total;
+
+    if ( 0 != cpuload_getStats(window, &stats) || 0 == stats.window )
+    {
+        return 0;
+    }
+
+    busy = stats.task + stats.irq;
+    total = stats.window;
+
+    /* Scale both values, so that 'busy*1000' does not overflow */
+    while ( total >= 0x00400000 )
+    {
+        busy >>= 1;
+        total >>= 1;
+    }
+
+    return (uint16_t) arith_udiv(busy * 1000 + total / 2, total);
+}
+
+
+/**
+ * Accounts the entry to the IRQ handler.
+ *
+ * @note This function is called by the IRQ handler (see interrupt.c) and
+ * should not be called by any other code.
+ */
+void cpuload_irqEnter(void)
+{
+    if ( 0 == __bucketLen )
+    {
+        return;
+    }
+
+    __account(clocksource_read());
+    __irqPrevCtx = __ctx;
+    __ctx = CTX_IRQ;
+}
+
+
+/**
+ * Accounts the exit from the IRQ handler.
+ *
+ * @note This function is called by the IRQ handler (see interrupt.c) and
+ * should not be called by any other code.
+ */
+void cpuload_irqExit(void)
+{
+    if ( 0 == __bucketLen || CTX_IRQ != __ctx )
+    {
+        return;
+    }
+
+    __account(clocksource_read());
+    __ctx = __irqPrevCtx;
+}
@@ -0,0 +1,69 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the CPU load accounting.
+ *
+ * The CPU's time is split into three contexts: idle (waiting for an
+ * interrupt in cpuload_idle()), IRQ (the IRQ handler, including all ISRs)
+ * and task (everything else, including busy waiting loops). Time is measured
+ * by the high resolution clock (see clocksource.h) and accumulated into
+ * 100 ms buckets, so the load is available over sliding windows of 1 s and
+ * 10 s with the resolution of one bucket.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _CPULOAD_H_
+#define _CPULOAD_H_
+
+#include <stdint.h>
+
+
+/* Supported windows (in seconds): */
+#define CPULOAD_WINDOW_1S         1
+#define CPULOAD_WINDOW_10S        10
+
+
+/**
+ * Time, spent in each context during a window, in clock ticks
+ */
+typedef struct _cpuloadStats
+{
+    uint32_t window;              /* accounted time, less than the window's length until the window is filled */
+    uint32_t idle;                /* time, spent in cpuload_idle() */
+    uint32_t irq;                 /* time, spent in the IRQ handler */
+    uint32_t task;                /* remaining time */
+} cpuloadStats;
+
+
+void cpuload_init(void);
+
+void cpuload_idle(void);
+
+int8_t cpuload_getStats(uint8_t window, cpuloadStats* stats);
+
+uint16_t cpuload_getLoad(uint8_t window);
+
+void cpuload_irqEnter(void);
+
+void cpuload_irqExit(void);
+
+#endif  /* _CPULOAD_H_ */
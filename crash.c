@@ -0,0 +1,385 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the crash dump handler for undefined instructions,
+ * prefetch aborts and data aborts.
+ *
+ * Entry stubs of all three exceptions are implemented in vectors.s. They store
+ * the CPU state to the exception mode's stack and call _crash_handler() that
+ * copies the state (together with a short backtrace) into the section .noinit
+ * (see qemu.ld) that is not touched by the startup code, so the dump survives a
+ * warm reset. The dump is protected by a CRC checksum. Finally the dump is
+ * emitted to the UART0 and the CPU is stopped in an infinite loop (until a
+ * reset, e.g. by a watchdog).
+ *
+ * More details about the fault status and address registers:
+ * - ARM926EJ-S Technical Reference Manual (DDI0198):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.ddi0198e/DDI0198E_arm926ejs_r0p5_trm.pdf
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "crash.h"
+#include "crc.h"
+#include "uart.h"
+
+
+/* A "signature" of a valid crash dump: */
+#define CRASH_MAGIC              0xDEADC0DE
+
+/* Max. number of stack words, scanned by the backtrace: */
+#define BT_SCAN_WORDS            256
+
+/* End of the RAM (128 MB, see qemu.ld), stack addresses beyond it are invalid: */
+#define RAM_END                  0x08000000
+
+/* Bit mask and value of BL instructions (condition bits are ignored): */
+#define BM_BL                    0x0F000000
+#define INSTR_BL                 0x0B000000
+
+/* Bit mask and value of BLX <register> instructions (condition bits are ignored): */
+#define BM_BLX_REG               0x0FFFFFF0
+#define INSTR_BLX_REG            0x012FFF30
+
+
+/* UART where the crash dump is emitted: */
+#define CRASH_UART               0
+
+
+/*
+ * Stack frame, stored by crash_entry in vectors.s (lowest address first).
+ * The layout must match the order of registers, pushed by the stubs!
+ */
+typedef struct _excFrame
+{
+    uint32_t spsr;                 /* SPSR of the exception mode */
+    uint32_t cpsr;                 /* CPSR of the exception mode */
+    uint32_t sp;                   /* faulted mode's banked stack pointer */
+    uint32_t lr;                   /* faulted mode's banked link register */
+    uint32_t dfsr;                 /* Data Fault Status Register */
+    uint32_t far;                  /* Fault Address Register */
+    uint32_t ifsr;                 /* Instruction Fault Status Register */
+    uint32_t r[13];                /* r0 - r12 at the moment of the exception */
+    uint32_t excLr;                /* exception mode's link register */
+} excFrame;
+
+
+/* Code boundaries are defined in qemu.ld (or xip.ld, the second range is hot code in RAM): */
+extern uint32_t __ld_Text_Start;
+extern uint32_t __ld_Text_End;
+extern uint32_t __ld_RamText_Start;
+extern uint32_t __ld_RamText_End;
+
+/* The crash dump is placed into the section that is never initialized (see qemu.ld): */
+static crashDump __dump __attribute__((section(".noinit")));
+static crashDump* const pDump = &__dump;
+
+/*
+ * Nonzero while a crash is being handled. A nested fault (e.g. a corrupted
+ * stack pointer, referenced by the backtrace) must not restart the handler.
+ */
+static volatile int8_t __crash_inProgress = 0;
+
+
+/*
+ * Converts an unsigned long value into a string with its HEX representation.
+ *
+ * @param buf - pointer to a string buffer (at least 11 characters)
+ * @param val - unsigned long (4 bytes) value to be converted
+ */
+static void __ul2hex(char* buf, uint32_t val)
+{
+    uint8_t i;
+    uint8_t digit;
+
+    buf[0] = '0';
+    buf[1] = 'x';
+
+    for ( i=0; i<8; ++i )
+    {
+        digit = (uint8_t) (val & 0x0F);
+        buf[9-i] = ( digit<10 ? '0' + digit : 'A' + digit - 10 );
+        val >>= 4;
+    }
+
+    buf[10] = '\0';
+}
+
+
+/*
+ * Outputs a label, followed by a HEX value, to the specified UART.
+ *
+ * @param uart - number of the UART (between 0 and 2)
+ * @param label - label in front of the value
+ * @param val - value to be printed
+ */
+static void __printVal(uint8_t uart, const char* label, uint32_t val)
+{
+    char buf[11];
+
+    __ul2hex(buf, val);
+    uart_print(uart, label);
+    uart_print(uart, buf);
+}
+
+
+/*
+ * Marks the crash dump as valid and updates its checksum.
+ * Must be called after each modification of the dump.
+ */
+static void __sealDump(void)
+{
+    pDump->magic = CRASH_MAGIC;
+    pDump->crc = crc32(CRC32_INIT, &(pDump->type), sizeof(crashDump) - 2*sizeof(uint32_t) );
+}
+
+
+/*
+ * Checks whether 'addr' is a probable return address, i.e. whether it points
+ * into the code and the preceding instruction is a subroutine call.
+ *
+ * @param addr - address to be checked
+ *
+ * @return a nonzero value if 'addr' is a probable return address, 0 otherwise
+ */
+static int8_t __isReturnAddr(uint32_t addr)
+{
+    const uint32_t textStart = (uint32_t) &__ld_Text_Start;
+    const uint32_t textEnd = (uint32_t) &__ld_Text_End;
+    const uint32_t ramTextStart = (uint32_t) &__ld_RamText_Start;
+    const uint32_t ramTextEnd = (uint32_t) &__ld_RamText_End;
+    uint32_t instr;
+
+    /* Only word aligned (ARM) addresses within the code are considered */
+    if ( 0 != (addr & 0x03) )
+    {
+        return 0;
+    }
+
+    if ( (addr<=textStart+4 || addr>textEnd) &&
+         (addr<=ramTextStart+4 || addr>ramTextEnd) )
+    {
+        return 0;
+    }
+
+    instr = *( (const uint32_t*) addr - 1 );
+
+    return ( INSTR_BL==(instr & BM_BL) || INSTR_BLX_REG==(instr & BM_BLX_REG) ? 1 : 0 );
+}
+
+
+/*
+ * Scans the faulted mode's stack for probable return addresses and
+ * stores up to CRASH_BT_DEPTH of them into the crash dump.
+ *
+ * Frame pointers are not required, so the backtrace is heuristic and
+ * may contain a few stale return addresses.
+ *
+ * @param sp - faulted mode's stack pointer
+ */
+static void __backtrace(uint32_t sp)
+{
+    const uint32_t* p;
+    uint16_t i;
+
+    /* The scan is skipped if the stack pointer is obviously invalid */
+    if ( 0!=(sp & 0x03) || sp>=RAM_END )
+    {
+        return;
+    }
+
+    p = (const uint32_t*) sp;
+    for ( i=0; i<BT_SCAN_WORDS && pDump->nrFrames<CRASH_BT_DEPTH; ++i, ++p )
+    {
+        /* never read beyond the end of the RAM */
+        if ( (uint32_t) p >= RAM_END )
+        {
+            break;  /* out of for i */
+        }
+
+        if ( __isReturnAddr(*p) )
+        {
+            pDump->backtrace[pDump->nrFrames++] = *p;
+            __sealDump();
+        }
+    }
+}
+
+
+/*
+ * Crash dump handler, called by the entry stubs in vectors.s
+ * Prototype of this function is not public and should not be exposed in a .h file.
+ *
+ * The function never returns.
+ *
+ * @param type - type of the exception (one of CRASH_*)
+ * @param frame - CPU state as stored by the entry stubs
+ */
+void _crash_handler(uint32_t type, const excFrame* frame)
+{
+    uint8_t i;
+
+    /*
+     * A nested fault (most likely while the backtrace was being obtained).
+     * Registers of the original fault are already in place, so just emit them.
+     */
+    if ( 0 != __crash_inProgress )
+    {
+        crash_printDump(CRASH_UART);
+        for ( ; ; );
+    }
+    __crash_inProgress = 1;
+
+    pDump->magic = 0;
+    pDump->type = type;
+
+    for ( i=0; i<13; ++i )
+    {
+        pDump->r[i] = frame->r[i];
+    }
+    pDump->r[13] = frame->sp;
+    pDump->r[14] = frame->lr;
+
+    /*
+     * Address of the faulting instruction (ARM state), see exceptions in DDI0222:
+     * - data abort: lr - 8
+     * - prefetch abort and undefined instruction: lr - 4
+     */
+    pDump->r[15] = frame->excLr - ( CRASH_DATA_ABORT==type ? 8 : 4 );
+
+    pDump->cpsr = frame->cpsr;
+    pDump->spsr = frame->spsr;
+
+    switch (type)
+    {
+        case CRASH_DATA_ABORT :
+            pDump->fsr = frame->dfsr;
+            pDump->far = frame->far;
+            break;
+
+        case CRASH_PREFETCH_ABORT :
+            /* FAR is not updated on prefetch aborts, the faulting address is the PC */
+            pDump->fsr = frame->ifsr;
+            pDump->far = pDump->r[15];
+            break;
+
+        default :
+            pDump->fsr = 0;
+            pDump->far = 0;
+    }
+
+    /* Registers are stored, mark the dump as valid before the backtrace is attempted */
+    pDump->nrFrames = 0;
+    __sealDump();
+
+    __backtrace(frame->sp);
+
+    crash_printDump(CRASH_UART);
+
+    /* Wait for a reset */
+    for ( ; ; );
+}
+
+
+/**
+ * @return pointer to the crash dump area (the dump may not be valid, see crash_isDumpValid())
+ */
+const crashDump* crash_getDump(void)
+{
+    return pDump;
+}
+
+
+/**
+ * Checks whether the crash dump area contains a valid crash dump,
+ * e.g. a dump of a crash that occurred before a warm reset.
+ *
+ * @return a nonzero value (typically 1) if the dump is valid, 0 otherwise
+ */
+int8_t crash_isDumpValid(void)
+{
+    return ( CRASH_MAGIC==pDump->magic &&
+             pDump->crc==crc32(CRC32_INIT, &(pDump->type), sizeof(crashDump) - 2*sizeof(uint32_t)) &&
+             pDump->type>=CRASH_UNDEF && pDump->type<=CRASH_DATA_ABORT &&
+             pDump->nrFrames<=CRASH_BT_DEPTH ? 1 : 0 );
+}
+
+
+/**
+ * Emits the crash dump to the specified UART using polled output.
+ *
+ * Nothing is done if the crash dump is not valid.
+ *
+ * @param uart - number of the UART (between 0 and 2)
+ */
+void crash_printDump(uint8_t uart)
+{
+    const char* const types[] = { "undefined instruction", "prefetch abort", "data abort" };
+    const char* const regNames[] = { " r0=", " r1=", " r2=", " r3=",
+                                     " r4=", " r5=", " r6=", " r7=",
+                                     " r8=", " r9=", " r10=", " r11=",
+                                     " r12=", " sp=", " lr=", " pc=" };
+    uint8_t i;
+
+    if ( !crash_isDumpValid() )
+    {
+        return;
+    }
+
+    uart_print(uart, "\r\n*** CRASH: ");
+    uart_print(uart, types[pDump->type - CRASH_UNDEF]);
+    uart_print(uart, " ***\r\n");
+
+    for ( i=0; i<16; ++i )
+    {
+        __printVal(uart, regNames[i], pDump->r[i]);
+        if ( 3 == (i & 0x03) )
+        {
+            uart_print(uart, "\r\n");
+        }
+    }
+
+    __printVal(uart, " cpsr=", pDump->cpsr);
+    __printVal(uart, " spsr=", pDump->spsr);
+    uart_print(uart, "\r\n");
+    __printVal(uart, " fsr=", pDump->fsr);
+    __printVal(uart, " far=", pDump->far);
+    uart_print(uart, "\r\n backtrace:");
+
+    for ( i=0; i<pDump->nrFrames; ++i )
+    {
+        __printVal(uart, " ", pDump->backtrace[i]);
+    }
+
+    uart_print(uart, "\r\n*** END OF CRASH DUMP ***\r\n");
+}
+
+
+/**
+ * Invalidates the crash dump, typically after it has been reported.
+ */
+void crash_clearDump(void)
+{
+    pDump->magic = 0;
+}
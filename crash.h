@@ -0,0 +1,70 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types that handle
+ * crash dumps of undefined instructions, prefetch and data aborts.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _CRASH_H_
+#define _CRASH_H_
+
+#include <stdint.h>
+
+
+/* Types of exceptions that produce a crash dump (also used by vectors.s): */
+#define CRASH_UNDEF              1
+#define CRASH_PREFETCH_ABORT     2
+#define CRASH_DATA_ABORT         3
+
+
+/* Max. number of return addresses, recorded by the backtrace */
+#define CRASH_BT_DEPTH           8
+
+
+/**
+ * Contents of a crash dump.
+ */
+typedef struct _crashDump
+{
+    uint32_t magic;                          /* CRASH_MAGIC if the dump is valid */
+    uint32_t crc;                            /* CRC-32 of all subsequent fields */
+    uint32_t type;                           /* type of the exception, one of CRASH_* */
+    uint32_t r[16];                          /* r0 - r15 of the faulted mode, r15 is the faulting instruction */
+    uint32_t cpsr;                           /* CPSR of the exception mode */
+    uint32_t spsr;                           /* SPSR of the exception mode, i.e. CPSR of the faulted mode */
+    uint32_t fsr;                            /* fault status (CP15 c5), not applicable to CRASH_UNDEF */
+    uint32_t far;                            /* fault address (CP15 c6), not applicable to CRASH_UNDEF */
+    uint32_t nrFrames;                       /* number of valid entries in 'backtrace' */
+    uint32_t backtrace[CRASH_BT_DEPTH];      /* return addresses, found on the faulted mode's stack */
+} crashDump;
+
+
+const crashDump* crash_getDump(void);
+
+int8_t crash_isDumpValid(void);
+
+void crash_printDump(uint8_t uart);
+
+void crash_clearDump(void);
+
+#endif  /* _CRASH_H_ */
@@ -0,0 +1,73 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the CRC-32 checksum (IEEE 802.3 polynomial, reflected,
+ * as used by Ethernet, zlib, etc.).
+ *
+ * A table of 16 entries is used, i.e. the checksum is calculated one nibble at
+ * a time. This is a reasonable compromise between speed and memory consumption.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+
+#include "crc.h"
+
+
+/* CRC-32 remainders of all 4-bit values (reflected polynomial 0xEDB88320): */
+static const uint32_t crcTable[16] =
+    {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+
+/**
+ * Calculates (or continues calculation of) the CRC-32 checksum of a buffer.
+ *
+ * To calculate a checksum of a single buffer, pass CRC32_INIT as 'crc'.
+ * To calculate a checksum of several buffers, pass the checksum of previous
+ * buffers as 'crc'.
+ *
+ * @param crc - checksum of previous data or CRC32_INIT
+ * @param buf - pointer to the buffer
+ * @param len - length of the buffer in bytes
+ *
+ * @return CRC-32 checksum
+ */
+uint32_t crc32(uint32_t crc, const void* buf, uint32_t len)
+{
+    const uint8_t* p = (const uint8_t*) buf;
+
+    crc = ~crc;
+
+    for ( ; len>0; --len, ++p )
+    {
+        crc ^= *p;
+        crc = crcTable[crc & 0x0F] ^ (crc >> 4);
+        crc = crcTable[crc & 0x0F] ^ (crc >> 4);
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,38 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of the CRC-32 checksum function.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _CRC_H_
+#define _CRC_H_
+
+#include <stdint.h>
+
+
+/* Initial value of a CRC-32 calculation: */
+#define CRC32_INIT        0x00000000
+
+uint32_t crc32(uint32_t crc, const void* buf, uint32_t len);
+
+#endif  /* _CRC_H_ */
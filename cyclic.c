@@ -0,0 +1,394 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the time-triggered cyclic executive.
+ *
+ * Each expiration of a periodic SP804 counter starts the next minor frame
+ * of the schedule. Its jobs are called directly from the counter's ISR,
+ * one after another, so the start of a frame is only delayed by the IRQ
+ * latency (the counter's IRQ should be given the highest priority). Every
+ * job's execution time is measured by the clocksource.
+ *
+ * If the jobs of a frame do not complete within the frame (an overrun),
+ * the pending expiration starts the next frame late. If more expirations
+ * have been missed meanwhile, their frames are skipped, so the following
+ * frames remain aligned to the counter's time base.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "cyclic.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "clocksource.h"
+#include "arith.h"
+#include "trace.h"
+
+
+/* Frames after an overrun, whose intervals are not sampled for jitter: */
+#define OVERRUN_NO_SAMPLES    2
+
+
+static const cyclicSchedule* __sched = NULL;
+static uint8_t __timerNr;
+static uint8_t __counterNr;
+static volatile uint8_t __running = 0;
+
+static volatile uint8_t __frame;         /* index of the next minor frame */
+static uint32_t __lastStart;             /* clocksource's time of the previous frame's start */
+static uint8_t __noSamples;              /* following intervals, not sampled for jitter */
+
+static cyclicStats __stats;
+static cyclicJobStats __jobStats[CYCLIC_MAX_JOBS];
+
+
+/*
+ * Advances the index of the next minor frame.
+ *
+ * @param n - number of frames to advance
+ */
+static void __advance(uint32_t n)
+{
+    for ( ; n>0; --n )
+    {
+        if ( ++__frame >= __sched->nrFrames )
+        {
+            __frame = 0;
+            ++__stats.majorFrames;
+        }
+    }
+}
+
+
+/*
+ * Updates the max. jitter by the interval since the previous frame's start.
+ *
+ * @param start - clocksource's time of the current frame's start
+ */
+static void __sampleJitter(uint32_t start)
+{
+    const uint32_t interval = clocksource_ticksToUs(start - __lastStart);
+    const uint32_t minorUs = __sched->minorUs;
+    uint32_t jitter;
+
+    __lastStart = start;
+
+    if ( __noSamples > 0 )
+    {
+        --__noSamples;
+        return;
+    }
+
+    jitter = ( interval > minorUs ? interval - minorUs : minorUs - interval );
+    __stats.maxJitterUs = ( jitter > __stats.maxJitterUs ? jitter : __stats.maxJitterUs );
+}
+
+
+/*
+ * Callback of the counter's expiration, executes jobs of the next minor frame.
+ *
+ * @param param - unused
+ */
+static void __tickIsr(void* param)
+{
+    const cyclicFrame* f;
+    cyclicJobStats* js;
+    const cyclicJob* job;
+    uint32_t start;
+    uint32_t t0;
+    uint32_t t1;
+    uint32_t us;
+    uint32_t elapsed;
+    uint32_t lost;
+    uint8_t i;
+
+    if ( 0 == __running )
+    {
+        return;
+    }
+
+    start = clocksource_read();
+    __sampleJitter(start);
+
+    f = &__sched->frames[__frame];
+    t0 = start;
+
+    for ( i=0; i<f->nrJobs; ++i )
+    {
+        job = &__sched->jobs[f->jobs[i]];
+        trace_event(TRACE_EV_CTX_SWITCH, TRACE_CTX_CYCLIC(f->jobs[i]));
+        ( *job->func )( job->param );
+
+        t1 = clocksource_read();
+        us = clocksource_ticksToUs(t1 - t0);
+        t0 = t1;
+
+        js = &__jobStats[f->jobs[i]];
+        ++js->runs;
+        js->lastUs = us;
+        js->wcetUs = ( us > js->wcetUs ? us : js->wcetUs );
+    }
+
+    ++__stats.minorFrames;
+    __advance(1);
+
+    elapsed = clocksource_ticksToUs(t0 - start);
+    if ( elapsed >= __sched->minorUs )
+    {
+        /* The pending expiration starts the next frame, frames of further expirations are skipped */
+        lost = arith_udiv(elapsed, __sched->minorUs) - 1;
+
+        ++__stats.overruns;
+        __stats.skipped += lost;
+        __advance(lost);
+        __noSamples = OVERRUN_NO_SAMPLES;
+    }
+}
+
+
+/*
+ * Checks the schedule's tables.
+ *
+ * @param sched - the schedule
+ *
+ * @return 1 if the schedule is valid, 0 otherwise
+ */
+static uint8_t __isValid(const cyclicSchedule* sched)
+{
+    const cyclicFrame* f;
+    uint8_t i;
+    uint8_t j;
+
+    if ( NULL == sched || NULL == sched->jobs || NULL == sched->frames ||
+         0 == sched->nrJobs || sched->nrJobs > CYCLIC_MAX_JOBS ||
+         0 == sched->nrFrames || sched->minorUs < 2 )
+    {
+        return 0;
+    }
+
+    for ( i=0; i<sched->nrJobs; ++i )
+    {
+        if ( NULL == sched->jobs[i].func )
+        {
+            return 0;
+        }
+    }
+
+    for ( i=0; i<sched->nrFrames; ++i )
+    {
+        f = &sched->frames[i];
+
+        if ( f->nrJobs > 0 && NULL == f->jobs )
+        {
+            return 0;
+        }
+
+        for ( j=0; j<f->nrJobs; ++j )
+        {
+            if ( f->jobs[j] >= sched->nrJobs )
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * Initializes the executive with a schedule and a SP804 counter, whose
+ * callback is registered and enabled. A running executive is stopped first.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param sched - the schedule, it must remain valid while the executive runs
+ * @param timerNr - number of the timer
+ * @param counterNr - number of the timer's counter
+ * @param priority - priority of the timer's IRQ (see timer_registerCallback()), should be the highest one
+ *
+ * @return CYCLIC_OK on success, CYCLIC_ERR_PARAM if any parameter or the schedule is invalid or the ISR could not be registered
+ */
+int8_t cyclic_init(const cyclicSchedule* sched, uint8_t timerNr, uint8_t counterNr, uint8_t priority)
+{
+
+    if ( timerNr >= BSP_NR_TIMERS || counterNr >= timer_countersPerTimer() || 0 == __isValid(sched) )
+    {
+        return CYCLIC_ERR_PARAM;
+    }
+
+    cyclic_stop();
+    __sched = NULL;
+
+    __timerNr = timerNr;
+    __counterNr = counterNr;
+
+    timer_init(timerNr, counterNr);
+    clocksource_init();
+
+    if ( timer_registerCallback(timerNr, counterNr, &__tickIsr, NULL, priority) < 0 )
+    {
+        return CYCLIC_ERR_PARAM;
+    }
+
+    __sched = sched;
+
+    return CYCLIC_OK;
+}
+
+
+/**
+ * Starts the executive at the first minor frame, which starts when the
+ * counter expires for the first time, i.e. after one minor frame.
+ * Statistics are reset.
+ *
+ * @return CYCLIC_OK on success, CYCLIC_ERR_NOINIT if no schedule is initialized
+ */
+int8_t cyclic_start(void)
+{
+    if ( NULL == __sched )
+    {
+        return CYCLIC_ERR_NOINIT;
+    }
+
+    cyclic_stop();
+
+    __frame = 0;
+    __noSamples = 1;
+    cyclic_resetStats();
+    __running = 1;
+
+    /* A periodic counter reloads at the tick after reaching 0, so its period is one tick longer than its load */
+    timer_setLoad(__timerNr, __counterNr, __sched->minorUs - 1);
+    timer_enableInterrupt(__timerNr, __counterNr);
+    timer_start(__timerNr, __counterNr);
+
+    return CYCLIC_OK;
+}
+
+
+/**
+ * Stops the executive. The frame in progress (if any) is completed.
+ */
+void cyclic_stop(void)
+{
+    if ( 0 == __running )
+    {
+        return;
+    }
+
+    __running = 0;
+
+    timer_stop(__timerNr, __counterNr);
+    timer_disableInterrupt(__timerNr, __counterNr);
+    timer_clearInterrupt(__timerNr, __counterNr);
+}
+
+
+/**
+ * @return 1 if the executive is running, 0 otherwise
+ */
+int8_t cyclic_isRunning(void)
+{
+    return ( 0 != __running ? 1 : 0 );
+}
+
+
+/**
+ * @return index of the next minor frame within the major frame
+ */
+uint8_t cyclic_getMinorFrame(void)
+{
+    return __frame;
+}
+
+
+/**
+ * Copies statistics of the executive.
+ *
+ * @param stats - the statistics are copied here
+ *
+ * @return CYCLIC_OK on success, CYCLIC_ERR_PARAM if 'stats' is NULL
+ */
+int8_t cyclic_getStats(cyclicStats* stats)
+{
+    if ( NULL == stats )
+    {
+        return CYCLIC_ERR_PARAM;
+    }
+
+    *stats = __stats;
+
+    return CYCLIC_OK;
+}
+
+
+/**
+ * Copies execution times of a job.
+ *
+ * @param job - index of the job within the schedule's table of jobs
+ * @param stats - the execution times are copied here
+ *
+ * @return CYCLIC_OK on success, CYCLIC_ERR_PARAM if 'job' is invalid or 'stats' is NULL, CYCLIC_ERR_NOINIT if no schedule is initialized
+ */
+int8_t cyclic_getJobStats(uint8_t job, cyclicJobStats* stats)
+{
+    if ( NULL == __sched )
+    {
+        return CYCLIC_ERR_NOINIT;
+    }
+
+    if ( job >= __sched->nrJobs || NULL == stats )
+    {
+        return CYCLIC_ERR_PARAM;
+    }
+
+    *stats = __jobStats[job];
+
+    return CYCLIC_OK;
+}
+
+
+/**
+ * Resets statistics of the executive and execution times of all jobs.
+ */
+void cyclic_resetStats(void)
+{
+    uint8_t i;
+
+    __stats.minorFrames = 0;
+    __stats.majorFrames = 0;
+    __stats.overruns = 0;
+    __stats.skipped = 0;
+    __stats.maxJitterUs = 0;
+
+    for ( i=0; i<CYCLIC_MAX_JOBS; ++i )
+    {
+        __jobStats[i].runs = 0;
+        __jobStats[i].lastUs = 0;
+        __jobStats[i].wcetUs = 0;
+    }
+}
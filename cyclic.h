@@ -0,0 +1,139 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the time-triggered
+ * cyclic executive.
+ *
+ * A schedule (defined at compile time, typically as static const tables)
+ * consists of jobs and a major frame of minor frames of equal length.
+ * Each minor frame runs a fixed list of jobs, the major frame repeats
+ * forever. Minor frames are started by a periodic SP804 counter, e.g.:
+ *
+ *     static const cyclicJob jobs[] = { { &control, NULL }, { &log, NULL } };
+ *     static const uint8_t f0[] = { 0, 1 };
+ *     static const uint8_t f1[] = { 0 };
+ *     static const cyclicFrame frames[] = { { f0, 2 }, { f1, 1 } };
+ *     static const cyclicSchedule sched = { jobs, 2, frames, 2, 1000 };
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _CYCLIC_H_
+#define _CYCLIC_H_
+
+#include <stdint.h>
+
+
+/* Max. number of jobs of a schedule: */
+#define CYCLIC_MAX_JOBS          32
+
+
+/* Return values of cyclic_* functions: */
+#define CYCLIC_OK                0
+#define CYCLIC_ERR_PARAM        -1     /* invalid parameter or schedule, or the ISR could not be registered */
+#define CYCLIC_ERR_NOINIT       -2     /* no schedule is initialized */
+
+
+/**
+ * Required prototype of jobs, called from the counter's ISR.
+ *
+ * @param param - parameter of the job
+ */
+typedef void (*cyclicJobFunc)(void* param);
+
+
+/**
+ * A job of the schedule.
+ */
+typedef struct _cyclicJob
+{
+    cyclicJobFunc func;           /* the job's function */
+    void* param;                  /* parameter of the function */
+} cyclicJob;
+
+
+/**
+ * A minor frame: indices of jobs (into the schedule's table of jobs)
+ * in the order of their execution.
+ */
+typedef struct _cyclicFrame
+{
+    const uint8_t* jobs;          /* indices of jobs */
+    uint8_t nrJobs;               /* number of jobs of the frame, may be 0 */
+} cyclicFrame;
+
+
+/**
+ * A schedule. The schedule and all its tables must remain valid
+ * while the executive runs.
+ */
+typedef struct _cyclicSchedule
+{
+    const cyclicJob* jobs;        /* table of jobs */
+    uint8_t nrJobs;               /* number of jobs (max. CYCLIC_MAX_JOBS) */
+    const cyclicFrame* frames;    /* minor frames of the major frame */
+    uint8_t nrFrames;             /* number of minor frames */
+    uint32_t minorUs;             /* length of a minor frame in micro seconds */
+} cyclicSchedule;
+
+
+/**
+ * Statistics of the executive, all counters start at 0 when it is
+ * started or its statistics are reset.
+ */
+typedef struct _cyclicStats
+{
+    uint32_t minorFrames;         /* executed minor frames */
+    uint32_t majorFrames;         /* completed major frames */
+    uint32_t overruns;            /* minor frames whose jobs did not complete within the frame */
+    uint32_t skipped;             /* minor frames, skipped after overruns to retain the time base */
+    uint32_t maxJitterUs;         /* max. deviation of the interval between starts of minor frames */
+} cyclicStats;
+
+
+/**
+ * Execution times of a job, measured by the clocksource.
+ */
+typedef struct _cyclicJobStats
+{
+    uint32_t runs;                /* number of executions */
+    uint32_t lastUs;              /* execution time of the last execution */
+    uint32_t wcetUs;              /* max. measured execution time */
+} cyclicJobStats;
+
+
+int8_t cyclic_init(const cyclicSchedule* sched, uint8_t timerNr, uint8_t counterNr, uint8_t priority);
+
+int8_t cyclic_start(void);
+
+void cyclic_stop(void);
+
+int8_t cyclic_isRunning(void);
+
+uint8_t cyclic_getMinorFrame(void);
+
+int8_t cyclic_getStats(cyclicStats* stats);
+
+int8_t cyclic_getJobStats(uint8_t job, cyclicJobStats* stats);
+
+void cyclic_resetStats(void);
+
+#endif  /* _CYCLIC_H_ */
@@ -0,0 +1,465 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the PL080 DMA controller driver.
+ *
+ * Only memory to memory transfers are currently supported. A transfer is split
+ * into a chain of linked list items (LLIs), each of them transfers at most
+ * 4095 elements. The widest element (word, halfword or byte) that is permitted
+ * by the alignment of both addresses and the size is used.
+ *
+ * Each channel has its own static pool of LLIs. The terminal count interrupt
+ * is only triggered by the last LLI of a chain, the driver's ISR then calls
+ * the transfer's callback.
+ *
+ * @note Caches are not enabled by this application, so no cache maintenance
+ * is performed before or after transfers.
+ *
+ * More info about the board and the DMA controller:
+ * - Versatile Application Baseboard for ARM926EJ-S, HBI 0118 (DUI0225D):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.dui0225d/DUI0225D_versatile_application_baseboard_arm926ej_s_ug.pdf
+ * - ARM PrimeCell DMA Controller (PL080) Technical Reference Manual (DDI0196):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.ddi0196g/DDI0196.pdf
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "dma.h"
+#include "interrupt.h"
+
+
+/* Number of DMA channels: */
+#define NR_CHANNELS          8
+
+/* Number of LLIs per channel: */
+#define NR_LLIS              16
+
+/* Max. number of elements, transferred by a LLI (width of the TransferSize field): */
+#define MAX_TRANSFERS        0x00000FFF
+
+
+/*
+ * Bit masks of the Configuration Register (DMACConfiguration),
+ * see chapter 3 of DDI0196:
+ *
+ *  31:3 reserved
+ *   2: AHB master 2 endianness (0: little endian)
+ *   1: AHB master 1 endianness (0: little endian)
+ *   0: DMA controller enable
+ */
+#define CONFIG_ENABLE        0x00000001
+
+
+/*
+ * Bit masks and shifts of the Channel Control Register (DMACCxControl),
+ * see chapter 3 of DDI0196:
+ *
+ *   31: terminal count interrupt enable
+ *  30:28 protection
+ *   27: destination increment
+ *   26: source increment
+ *   25: destination AHB master
+ *   24: source AHB master
+ *  23:21 destination width (0: byte, 1: halfword, 2: word)
+ *  20:18 source width
+ *  17:15 destination burst size (1: 4 transfers)
+ *  14:12 source burst size
+ *  11:0 transfer size (number of source width transfers)
+ */
+#define CTRL_TC_INT          0x80000000
+#define CTRL_DI              0x08000000
+#define CTRL_SI              0x04000000
+#define CTRL_DWIDTH_SHIFT    21
+#define CTRL_SWIDTH_SHIFT    18
+#define CTRL_DBSIZE_4        0x00008000
+#define CTRL_SBSIZE_4        0x00001000
+
+
+/*
+ * Bit masks of the Channel Configuration Register (DMACCxConfiguration),
+ * see chapter 3 of DDI0196:
+ *
+ *  31:19 reserved
+ *   18: halt (ignore further source DMA requests)
+ *   17: active (read only, data in the channel's FIFO)
+ *   16: lock
+ *   15: terminal count interrupt mask (1: not masked)
+ *   14: error interrupt mask (1: not masked)
+ *  13:11 flow control and transfer type (0: memory to memory)
+ *  10:1 peripherals, not used by memory to memory transfers
+ *    0: channel enable
+ */
+#define CCFG_ITC             0x00008000
+#define CCFG_IE              0x00004000
+#define CCFG_ENABLE          0x00000001
+
+
+/* Element widths: */
+#define WIDTH_BYTE           0
+#define WIDTH_HALFWORD       1
+#define WIDTH_WORD           2
+
+
+/*
+ * 32-bit registers of each DMA channel,
+ * see chapter 3 of DDI0196:
+ */
+typedef struct _PL080_CHANNEL_REGS
+{
+    uint32_t SRCADDR;                /* Channel Source Address Register, DMACCxSrcAddr */
+    uint32_t DESTADDR;               /* Channel Destination Address Register, DMACCxDestAddr */
+    uint32_t LLI;                    /* Channel Linked List Item Register, DMACCxLLI */
+    uint32_t CONTROL;                /* Channel Control Register, DMACCxControl */
+    uint32_t CONFIGURATION;          /* Channel Configuration Register, DMACCxConfiguration */
+    const uint32_t Reserved[3];      /* Reserved, should not be modified */
+} PL080_CHANNEL_REGS;
+
+
+/*
+ * 32-bit registers of the DMA controller,
+ * relative to the controller's base address.
+ * See chapter 3 of DDI0196:
+ */
+typedef struct _ARM926EJS_DMA_REGS
+{
+    const uint32_t INTSTATUS;                 /* Interrupt Status Register, read only */
+    const uint32_t INTTCSTATUS;               /* Interrupt Terminal Count Status Register, read only */
+    uint32_t INTTCCLEAR;                      /* Interrupt Terminal Count Clear Register, write only */
+    const uint32_t INTERRORSTATUS;            /* Interrupt Error Status Register, read only */
+    uint32_t INTERRCLR;                       /* Interrupt Error Clear Register, write only */
+    const uint32_t RAWINTTCSTATUS;            /* Raw Interrupt Terminal Count Status Register, read only */
+    const uint32_t RAWINTERRORSTATUS;         /* Raw Error Interrupt Status Register, read only */
+    const uint32_t ENBLDCHNS;                 /* Enabled Channel Register, read only */
+    uint32_t SOFTBREQ;                        /* Software Burst Request Register */
+    uint32_t SOFTSREQ;                        /* Software Single Request Register */
+    uint32_t SOFTLBREQ;                       /* Software Last Burst Request Register */
+    uint32_t SOFTLSREQ;                       /* Software Last Single Request Register */
+    uint32_t CONFIGURATION;                   /* Configuration Register */
+    uint32_t SYNC;                            /* Synchronization Register */
+    const uint32_t Reserved1[50];             /* Reserved, should not be modified */
+    PL080_CHANNEL_REGS CH[NR_CHANNELS];       /* Registers of each channel */
+    const uint32_t Reserved2[192];            /* Reserved, should not be modified */
+    uint32_t ITCR;                            /* Test Control Register */
+    uint32_t ITOP[3];                         /* Test Output Registers */
+    const uint32_t Reserved3[692];            /* Reserved, should not be modified */
+    const uint32_t PERIPHID[4];               /* Peripheral ID, read only */
+    const uint32_t CELLID[4];                 /* PrimeCell ID, read only */
+} ARM926EJS_DMA_REGS;
+
+/*
+ * Pointer to the DMA controller's base address:
+ */
+static volatile ARM926EJS_DMA_REGS* const pReg = (ARM926EJS_DMA_REGS*) (BSP_DMA_BASE_ADDRESS);
+
+
+/*
+ * A linked list item, read by the controller (must be word aligned),
+ * see chapter 3 of DDI0196:
+ */
+typedef struct _dmaLli
+{
+    uint32_t src;                    /* source address */
+    uint32_t dst;                    /* destination address */
+    uint32_t next;                   /* address of the next LLI, 0 if this is the last one */
+    uint32_t control;                /* value of the Channel Control Register */
+} dmaLli;
+
+
+/* States of channels: */
+#define CH_FREE              0       /* available for allocation */
+#define CH_ALLOCATED         1       /* allocated, no transfer in progress */
+#define CH_BUSY              2       /* transfer in progress */
+
+/* State of each channel: */
+typedef struct _dmaChannel
+{
+    volatile uint8_t state;          /* one of CH_* */
+    uint8_t autoFree;                /* nonzero if the channel is freed when its transfer completes */
+    dmaCallback callback;            /* called when the transfer completes */
+    void* param;                     /* parameter of the callback */
+} dmaChannel;
+
+
+static dmaChannel __ch[NR_CHANNELS];
+
+static dmaLli __lli[NR_CHANNELS][NR_LLIS];
+
+
+/*
+ * ISR, triggered by the DMA controller when any channel completes
+ * its transfer or encounters an error.
+ *
+ * @param param - unused
+ */
+static void __dmaIsr(void* param)
+{
+    const uint32_t tc = pReg->INTTCSTATUS;
+    const uint32_t err = pReg->INTERRORSTATUS;
+    dmaCallback cb;
+    void* cbParam;
+    uint8_t ch;
+
+    pReg->INTTCCLEAR = tc;
+    pReg->INTERRCLR = err;
+
+    for ( ch=0; ch<NR_CHANNELS; ++ch )
+    {
+        const uint32_t mask = 1UL << ch;
+
+        if ( 0 == ((tc | err) & mask) || CH_BUSY != __ch[ch].state )
+        {
+            continue;
+        }
+
+        if ( err & mask )
+        {
+            /* The controller disables the channel, just make sure */
+            pReg->CH[ch].CONFIGURATION &= ~CCFG_ENABLE;
+        }
+
+        cb = __ch[ch].callback;
+        cbParam = __ch[ch].param;
+
+        /* The channel is released before the callback, so it may start another transfer */
+        __ch[ch].state = ( __ch[ch].autoFree ? CH_FREE : CH_ALLOCATED );
+
+        if ( NULL != cb )
+        {
+            cb( (err & mask ? DMA_STATUS_ERROR : DMA_STATUS_OK), cbParam );
+        }
+    }
+}
+
+
+/**
+ * Initializes the DMA controller: all channels are disabled, pending interrupts
+ * are cleared, the controller is enabled and its ISR is registered (as a
+ * nonvectored IRQ) and enabled at the interrupt controller.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param priority - priority of the DMA's IRQ (see pic_registerNonVectoredIrq())
+ *
+ * @return 0 on success, a negative value if the ISR could not be registered
+ */
+int8_t dma_init(uint8_t priority)
+{
+    uint8_t ch;
+
+    pReg->CONFIGURATION = 0;
+
+    for ( ch=0; ch<NR_CHANNELS; ++ch )
+    {
+        pReg->CH[ch].CONFIGURATION = 0;
+        __ch[ch].state = CH_FREE;
+        __ch[ch].autoFree = 0;
+        __ch[ch].callback = NULL;
+        __ch[ch].param = NULL;
+    }
+
+    pReg->INTTCCLEAR = (1UL << NR_CHANNELS) - 1;
+    pReg->INTERRCLR = (1UL << NR_CHANNELS) - 1;
+
+    /* Enable the controller, both AHB masters are little endian */
+    pReg->CONFIGURATION = CONFIG_ENABLE;
+
+    if ( pic_registerNonVectoredIrq(BSP_DMA_IRQ, &__dmaIsr, NULL, priority) < 0 )
+    {
+        return -1;
+    }
+
+    pic_enableInterrupt(BSP_DMA_IRQ);
+
+    return 0;
+}
+
+
+/**
+ * @return number of DMA channels
+ */
+uint8_t dma_nrChannels(void)
+{
+    return NR_CHANNELS;
+}
+
+
+/**
+ * @return max. size (in bytes) of a single transfer if both addresses and the size are word aligned
+ */
+uint32_t dma_maxTransferSize(void)
+{
+    return (NR_LLIS * MAX_TRANSFERS) << WIDTH_WORD;
+}
+
+
+/**
+ * Allocates a DMA channel. Channels with lower numbers have higher priorities,
+ * the free channel with the highest priority is allocated.
+ *
+ * @note The function may be called by tasks and ISRs (e.g. by a DMA callback
+ *       that starts the next transfer), the IRQ mode is disabled while the
+ *       channels are scanned.
+ *
+ * @return number of the allocated channel, a negative value if no channel is available
+ */
+int8_t dma_allocChannel(void)
+{
+    const int8_t irqMode = irq_saveIrqMode();
+    int8_t ch;
+
+    for ( ch=0; ch<NR_CHANNELS; ++ch )
+    {
+        if ( CH_FREE == __ch[ch].state )
+        {
+            __ch[ch].state = CH_ALLOCATED;
+            __ch[ch].autoFree = 0;
+            break;
+        }
+    }
+
+    irq_restoreIrqMode(irqMode);
+
+    return ( ch < NR_CHANNELS ? ch : -1 );
+}
+
+
+/**
+ * Releases a channel, allocated by dma_allocChannel().
+ *
+ * Nothing is done if 'ch' is invalid or a transfer is in progress on the channel.
+ *
+ * @param ch - DMA channel
+ */
+void dma_freeChannel(uint8_t ch)
+{
+    if ( ch >= NR_CHANNELS || CH_ALLOCATED != __ch[ch].state )
+    {
+        return;
+    }
+
+    __ch[ch].state = CH_FREE;
+}
+
+
+/**
+ * @param ch - DMA channel
+ *
+ * @return a nonzero value (typically 1) if a transfer is in progress on the channel, 0 otherwise
+ */
+int8_t dma_isBusy(uint8_t ch)
+{
+    if ( ch >= NR_CHANNELS )
+    {
+        return 0;
+    }
+
+    return ( CH_BUSY == __ch[ch].state ? 1 : 0 );
+}
+
+
+/**
+ * Starts an asynchronous copy of a memory block. A channel is allocated for
+ * the transfer and released when it completes. The callback is then called
+ * from the DMA's ISR, so the CPU is free for other work during the transfer.
+ *
+ * The source and destination blocks should not overlap. Neither block may be
+ * accessed until the transfer completes.
+ *
+ * @param dst - address of the destination block
+ * @param src - address of the source block
+ * @param size - number of bytes to copy (at most dma_maxTransferSize() if all of 'dst', 'src' and 'size' are word aligned, 4 times less if they are byte aligned)
+ * @param callback - function to be called when the transfer completes (may be NULL)
+ * @param param - parameter, passed to the callback
+ *
+ * @return number of the channel, performing the transfer, a negative value if the transfer could not be started
+ */
+int8_t dma_memcpyAsync(void* dst, const void* src, uint32_t size, dmaCallback callback, void* param)
+{
+    const uint32_t align = (uint32_t) dst | (uint32_t) src | size;
+    uint8_t width;
+    uint32_t elements;
+    uint32_t chunk;
+    uint32_t srcAddr = (uint32_t) src;
+    uint32_t dstAddr = (uint32_t) dst;
+    dmaLli* lli;
+    int8_t ch;
+    uint8_t i;
+
+    /* Select the widest element, permitted by the alignment */
+    width = ( 0 == (align & 0x03) ? WIDTH_WORD : ( 0 == (align & 0x01) ? WIDTH_HALFWORD : WIDTH_BYTE ) );
+    elements = size >> width;
+
+    if ( NULL == dst || NULL == src || 0 == size || elements > NR_LLIS * MAX_TRANSFERS )
+    {
+        return -1;
+    }
+
+    ch = dma_allocChannel();
+    if ( ch < 0 )
+    {
+        return -1;
+    }
+
+    /* Build the chain of LLIs */
+    lli = __lli[ch];
+    for ( i=0; elements>0; ++i )
+    {
+        chunk = ( elements > MAX_TRANSFERS ? MAX_TRANSFERS : elements );
+
+        lli[i].src = srcAddr;
+        lli[i].dst = dstAddr;
+        lli[i].control = chunk |
+                         CTRL_SBSIZE_4 | CTRL_DBSIZE_4 |
+                         ( (uint32_t) width << CTRL_SWIDTH_SHIFT ) |
+                         ( (uint32_t) width << CTRL_DWIDTH_SHIFT ) |
+                         CTRL_SI | CTRL_DI;
+        lli[i].next = (uint32_t) &lli[i+1];
+
+        srcAddr += chunk << width;
+        dstAddr += chunk << width;
+        elements -= chunk;
+    }
+
+    /* Only the last LLI triggers the terminal count interrupt */
+    lli[i-1].next = 0;
+    lli[i-1].control |= CTRL_TC_INT;
+
+    __ch[ch].autoFree = 1;
+    __ch[ch].callback = callback;
+    __ch[ch].param = param;
+    __ch[ch].state = CH_BUSY;
+
+    /* The first LLI is loaded into the channel's registers */
+    pReg->INTTCCLEAR = 1UL << ch;
+    pReg->INTERRCLR = 1UL << ch;
+    pReg->CH[ch].SRCADDR = lli[0].src;
+    pReg->CH[ch].DESTADDR = lli[0].dst;
+    pReg->CH[ch].LLI = lli[0].next;
+    pReg->CH[ch].CONTROL = lli[0].control;
+    pReg->CH[ch].CONFIGURATION = CCFG_ITC | CCFG_IE | CCFG_ENABLE;
+
+    return ch;
+}
@@ -0,0 +1,61 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the PL080 DMA controller driver.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _DMA_H_
+#define _DMA_H_
+
+#include <stdint.h>
+
+
+/* Status of a completed transfer, passed to its callback: */
+#define DMA_STATUS_OK             0
+#define DMA_STATUS_ERROR          -1
+
+
+/**
+ * Required prototype of callbacks, called (from the DMA ISR) when a transfer completes.
+ *
+ * @param status - DMA_STATUS_OK if the transfer completed successfully, DMA_STATUS_ERROR otherwise
+ * @param param - parameter, passed to dma_memcpyAsync()
+ */
+typedef void (*dmaCallback)(int8_t status, void* param);
+
+
+int8_t dma_init(uint8_t priority);
+
+uint8_t dma_nrChannels(void);
+
+uint32_t dma_maxTransferSize(void);
+
+int8_t dma_allocChannel(void);
+
+void dma_freeChannel(uint8_t ch);
+
+int8_t dma_isBusy(uint8_t ch);
+
+int8_t dma_memcpyAsync(void* dst, const void* src, uint32_t size, dmaCallback callback, void* param);
+
+#endif  /* _DMA_H_ */
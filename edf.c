@@ -0,0 +1,562 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the earliest deadline first (EDF) dispatcher of
+ * periodic tasks.
+ *
+ * All times are kept in ticks of the clocksource and compared by signed
+ * differences, so they may wrap around. A periodic SP804 counter (the
+ * "tick") only triggers checks for due releases, it is not a time base,
+ * so missed ticks do not delay the schedule. A release is delayed by at
+ * most one tick, the job's absolute deadline is still computed from its
+ * nominal release time.
+ *
+ * Released jobs are stored in a binary min-heap, keyed by their absolute
+ * deadlines. Jobs are not preempted (there is no task layer to switch
+ * contexts), so a job may be blocked by a longer job of a later deadline
+ * that has started earlier.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "edf.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "clocksource.h"
+#include "arith.h"
+#include "trace.h"
+
+
+/* Times in ticks of the clocksource must not exceed this to be comparable by signed differences: */
+#define MAX_TICKS             0x40000000UL
+
+
+/*
+ * Internal state of a task, all times are in ticks of the clocksource
+ */
+typedef struct _edfTcb
+{
+    uint32_t period;              /* period */
+    uint32_t relDeadline;         /* relative deadline */
+    uint32_t release;             /* time of the next release */
+    uint32_t deadline;            /* absolute deadline of the pending job */
+    volatile uint8_t pending;     /* 1 if a job is released and not completed yet */
+} edfTcb;
+
+
+static const edfTask* __tasks = NULL;
+static uint8_t __nrTasks;
+static uint8_t __timerNr;
+static uint8_t __counterNr;
+static uint32_t __tickUs;
+static volatile uint8_t __running = 0;
+
+static edfTcb __tcb[EDF_MAX_TASKS];
+static uint32_t __nextRelease;           /* the earliest release of all tasks */
+
+/* Ready queue, a binary heap of tasks' indices: */
+static uint8_t __heap[EDF_MAX_TASKS];
+static volatile uint8_t __heapSize = 0;
+
+static edfStats __stats;
+static edfTaskStats __taskStats[EDF_MAX_TASKS];
+
+
+/*
+ * @param a - index of a task
+ * @param b - index of another task
+ *
+ * @return 1 if the job of 'a' precedes the job of 'b', 0 otherwise
+ */
+static uint8_t __precedes(uint8_t a, uint8_t b)
+{
+    const int32_t diff = (int32_t) (__tcb[a].deadline - __tcb[b].deadline);
+
+    /* Jobs with equal deadlines are executed in order of tasks */
+    return ( diff < 0 || ( 0 == diff && a < b ) ? 1 : 0 );
+}
+
+
+/*
+ * Inserts a task's job into the ready queue.
+ *
+ * @param task - index of the task
+ */
+static void __push(uint8_t task)
+{
+    uint8_t i = __heapSize++;
+    uint8_t parent;
+
+    while ( i > 0 )
+    {
+        parent = (i - 1) / 2;
+
+        if ( 0 == __precedes(task, __heap[parent]) )
+        {
+            break;  /* out of while */
+        }
+
+        __heap[i] = __heap[parent];
+        i = parent;
+    }
+
+    __heap[i] = task;
+}
+
+
+/*
+ * Removes the job with the earliest deadline from the ready queue,
+ * which must not be empty.
+ *
+ * @return index of the job's task
+ */
+static uint8_t __pop(void)
+{
+    const uint8_t top = __heap[0];
+    const uint8_t last = __heap[--__heapSize];
+    const uint8_t n = __heapSize;
+    uint8_t i = 0;
+    uint8_t child;
+
+    for ( ; ; )
+    {
+        child = 2 * i + 1;
+
+        if ( child >= n )
+        {
+            break;  /* out of for */
+        }
+
+        if ( child + 1 < n && 0 != __precedes(__heap[child + 1], __heap[child]) )
+        {
+            ++child;
+        }
+
+        if ( 0 == __precedes(__heap[child], last) )
+        {
+            break;  /* out of for */
+        }
+
+        __heap[i] = __heap[child];
+        i = child;
+    }
+
+    __heap[i] = last;
+
+    return top;
+}
+
+
+/*
+ * Releases jobs of all tasks whose releases are due and updates
+ * the earliest next release.
+ *
+ * @param now - current time of the clocksource
+ */
+static void __releaseDue(uint32_t now)
+{
+    edfTcb* tcb;
+    uint32_t next = now + MAX_TICKS;
+    uint8_t i;
+
+    for ( i=0; i<__nrTasks; ++i )
+    {
+        tcb = &__tcb[i];
+
+        while ( (int32_t) (now - tcb->release) >= 0 )
+        {
+            if ( 0 != tcb->pending )
+            {
+                /* The previous job is still pending, it has already missed this deadline */
+                ++__stats.dropped;
+                ++__taskStats[i].dropped;
+            }
+            else
+            {
+                tcb->deadline = tcb->release + tcb->relDeadline;
+                tcb->pending = 1;
+                __push(i);
+                ++__stats.released;
+            }
+
+            tcb->release += tcb->period;
+        }
+
+        if ( (int32_t) (tcb->release - next) < 0 )
+        {
+            next = tcb->release;
+        }
+    }
+
+    __nextRelease = next;
+}
+
+
+/*
+ * Callback of the counter's expiration, releases due jobs.
+ *
+ * @param param - unused
+ */
+static void __tickIsr(void* param)
+{
+    uint32_t now;
+
+    if ( 0 == __running )
+    {
+        return;
+    }
+
+    now = clocksource_read();
+    if ( (int32_t) (now - __nextRelease) >= 0 )
+    {
+        __releaseDue(now);
+    }
+}
+
+
+/**
+ * Initializes the dispatcher with a table of tasks and a SP804 counter,
+ * whose callback is registered and enabled. A running dispatcher is stopped
+ * first.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param tasks - table of tasks, it must remain valid while the dispatcher runs
+ * @param nrTasks - number of tasks (max. EDF_MAX_TASKS)
+ * @param tickUs - period of the counter in micro seconds, i.e. the max. delay of releases, may not exceed any task's period
+ * @param timerNr - number of the timer
+ * @param counterNr - number of the timer's counter
+ * @param priority - priority of the timer's IRQ (see timer_registerCallback())
+ *
+ * @return EDF_OK on success, EDF_ERR_PARAM if any parameter or task is invalid or the ISR could not be registered
+ */
+int8_t edf_init(const edfTask* tasks, uint8_t nrTasks, uint32_t tickUs, uint8_t timerNr, uint8_t counterNr, uint8_t priority)
+{
+    const uint32_t ticksPerUs = arith_udiv(clocksource_getFrequency(), 1000000);
+    const uint32_t maxUs = arith_udiv(MAX_TICKS, ticksPerUs);
+    const edfTask* t;
+    uint8_t i;
+
+    if ( NULL == tasks || 0 == nrTasks || nrTasks > EDF_MAX_TASKS || tickUs < 2 ||
+         timerNr >= BSP_NR_TIMERS || counterNr >= timer_countersPerTimer() )
+    {
+        return EDF_ERR_PARAM;
+    }
+
+    for ( i=0; i<nrTasks; ++i )
+    {
+        t = &tasks[i];
+
+        if ( NULL == t->func || t->periodUs < tickUs || t->periodUs > maxUs ||
+             t->deadlineUs > t->periodUs )
+        {
+            return EDF_ERR_PARAM;
+        }
+    }
+
+    edf_stop();
+    __tasks = NULL;
+
+    for ( i=0; i<nrTasks; ++i )
+    {
+        t = &tasks[i];
+        __tcb[i].period = t->periodUs * ticksPerUs;
+        __tcb[i].relDeadline = ( 0 == t->deadlineUs ? t->periodUs : t->deadlineUs ) * ticksPerUs;
+        __tcb[i].pending = 0;
+    }
+
+    __nrTasks = nrTasks;
+    __tickUs = tickUs;
+    __timerNr = timerNr;
+    __counterNr = counterNr;
+
+    timer_init(timerNr, counterNr);
+    clocksource_init();
+
+    if ( timer_registerCallback(timerNr, counterNr, &__tickIsr, NULL, priority) < 0 )
+    {
+        return EDF_ERR_PARAM;
+    }
+
+    __tasks = tasks;
+
+    return EDF_OK;
+}
+
+
+/**
+ * Starts the dispatcher, the first jobs of all tasks are released
+ * immediately. Statistics are reset.
+ *
+ * @return EDF_OK on success, EDF_ERR_NOINIT if no tasks are initialized
+ */
+int8_t edf_start(void)
+{
+    uint32_t now;
+    uint8_t i;
+
+    if ( NULL == __tasks )
+    {
+        return EDF_ERR_NOINIT;
+    }
+
+    edf_stop();
+    edf_resetStats();
+
+    now = clocksource_read();
+    for ( i=0; i<__nrTasks; ++i )
+    {
+        __tcb[i].release = now;
+    }
+
+    __releaseDue(now);
+    __running = 1;
+
+    /* A periodic counter reloads at the tick after reaching 0, so its period is one tick longer than its load */
+    timer_setLoad(__timerNr, __counterNr, __tickUs - 1);
+    timer_enableInterrupt(__timerNr, __counterNr);
+    timer_start(__timerNr, __counterNr);
+
+    return EDF_OK;
+}
+
+
+/**
+ * Stops the dispatcher and discards all ready jobs. The job in progress
+ * (if any) is completed.
+ */
+void edf_stop(void)
+{
+    int8_t irqMode;
+    uint8_t i;
+
+    if ( 0 == __running )
+    {
+        return;
+    }
+
+    __running = 0;
+
+    timer_stop(__timerNr, __counterNr);
+    timer_disableInterrupt(__timerNr, __counterNr);
+    timer_clearInterrupt(__timerNr, __counterNr);
+
+    irqMode = irq_saveIrqMode();
+
+    __heapSize = 0;
+    for ( i=0; i<__nrTasks; ++i )
+    {
+        __tcb[i].pending = 0;
+    }
+
+    irq_restoreIrqMode(irqMode);
+}
+
+
+/**
+ * @return 1 if the dispatcher is running, 0 otherwise
+ */
+int8_t edf_isRunning(void)
+{
+    return ( 0 != __running ? 1 : 0 );
+}
+
+
+/**
+ * Executes the ready job with the earliest absolute deadline (if any)
+ * and checks whether it has completed by its deadline.
+ *
+ * @note Must not be called from ISRs or from tasks.
+ *
+ * @return 1 if a job was executed, 0 if no job is ready, EDF_ERR_NOINIT if no tasks are initialized
+ */
+int8_t edf_runNext(void)
+{
+    edfTcb* tcb;
+    edfTaskStats* ts;
+    const edfTask* t;
+    int8_t irqMode;
+    uint8_t task;
+    uint32_t t0;
+    uint32_t t1;
+    uint32_t us;
+
+    if ( NULL == __tasks )
+    {
+        return EDF_ERR_NOINIT;
+    }
+
+    /* The counter's ISR must not modify the ready queue meanwhile */
+    irqMode = irq_saveIrqMode();
+
+    if ( 0 == __heapSize )
+    {
+        irq_restoreIrqMode(irqMode);
+        return 0;
+    }
+
+    task = __pop();
+
+    irq_restoreIrqMode(irqMode);
+
+    t = &__tasks[task];
+    tcb = &__tcb[task];
+    ts = &__taskStats[task];
+
+    trace_event(TRACE_EV_CTX_SWITCH, TRACE_CTX_EDF(task));
+
+    t0 = clocksource_read();
+    ( *t->func )( t->param );
+    t1 = clocksource_read();
+
+    us = clocksource_ticksToUs(t1 - t0);
+    ts->wcetUs = ( us > ts->wcetUs ? us : ts->wcetUs );
+
+    /* The job's release time is derived from its deadline */
+    us = clocksource_ticksToUs(t1 - (tcb->deadline - tcb->relDeadline));
+    ts->maxResponseUs = ( us > ts->maxResponseUs ? us : ts->maxResponseUs );
+
+    if ( (int32_t) (t1 - tcb->deadline) > 0 )
+    {
+        us = clocksource_ticksToUs(t1 - tcb->deadline);
+        __stats.maxLatenessUs = ( us > __stats.maxLatenessUs ? us : __stats.maxLatenessUs );
+        ++__stats.misses;
+        ++ts->misses;
+    }
+
+    ++ts->runs;
+    ++__stats.completed;
+    tcb->pending = 0;
+
+    return 1;
+}
+
+
+/**
+ * @return number of released jobs, waiting for execution
+ */
+uint8_t edf_getNrReady(void)
+{
+    return __heapSize;
+}
+
+
+/**
+ * Sums utilizations of all tasks, i.e. their measured max. execution
+ * times relative to their periods. The sum should not exceed 1000 for
+ * all deadlines to be met (if deadlines equal periods).
+ *
+ * @return total utilization of tasks in per mille, 0 if no tasks are initialized
+ */
+uint32_t edf_getUtilization(void)
+{
+    uint32_t sum = 0;
+    uint32_t wcet;
+    uint8_t i;
+
+    if ( NULL == __tasks )
+    {
+        return 0;
+    }
+
+    for ( i=0; i<__nrTasks; ++i )
+    {
+        wcet = __taskStats[i].wcetUs;
+        sum += ( wcet >= __tasks[i].periodUs ? 1000 : arith_udiv(wcet * 1000, __tasks[i].periodUs) );
+    }
+
+    return sum;
+}
+
+
+/**
+ * Copies statistics of the dispatcher.
+ *
+ * @param stats - the statistics are copied here
+ *
+ * @return EDF_OK on success, EDF_ERR_PARAM if 'stats' is NULL
+ */
+int8_t edf_getStats(edfStats* stats)
+{
+    if ( NULL == stats )
+    {
+        return EDF_ERR_PARAM;
+    }
+
+    *stats = __stats;
+
+    return EDF_OK;
+}
+
+
+/**
+ * Copies statistics of a task.
+ *
+ * @param task - index of the task within the table of tasks
+ * @param stats - the statistics are copied here
+ *
+ * @return EDF_OK on success, EDF_ERR_PARAM if 'task' is invalid or 'stats' is NULL, EDF_ERR_NOINIT if no tasks are initialized
+ */
+int8_t edf_getTaskStats(uint8_t task, edfTaskStats* stats)
+{
+    if ( NULL == __tasks )
+    {
+        return EDF_ERR_NOINIT;
+    }
+
+    if ( task >= __nrTasks || NULL == stats )
+    {
+        return EDF_ERR_PARAM;
+    }
+
+    *stats = __taskStats[task];
+
+    return EDF_OK;
+}
+
+
+/**
+ * Resets statistics of the dispatcher and of all tasks.
+ */
+void edf_resetStats(void)
+{
+    uint8_t i;
+
+    __stats.released = 0;
+    __stats.completed = 0;
+    __stats.misses = 0;
+    __stats.dropped = 0;
+    __stats.maxLatenessUs = 0;
+
+    for ( i=0; i<EDF_MAX_TASKS; ++i )
+    {
+        __taskStats[i].runs = 0;
+        __taskStats[i].misses = 0;
+        __taskStats[i].dropped = 0;
+        __taskStats[i].wcetUs = 0;
+        __taskStats[i].maxResponseUs = 0;
+    }
+}
@@ -0,0 +1,130 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the earliest deadline
+ * first (EDF) dispatcher of periodic tasks.
+ *
+ * Each task declares its period and relative deadline. Its jobs are
+ * released periodically by a SP804 counter's ISR and executed, run to
+ * completion, by edf_runNext(), always the ready job with the earliest
+ * absolute deadline first, e.g.:
+ *
+ *     static const edfTask tasks[] = { { &control, NULL, 2000, 1000 }, { &log, NULL, 10000, 0 } };
+ *
+ *     edf_init(tasks, 2, 100, 1, 0, 20);
+ *     edf_start();
+ *     for ( ; ; )
+ *     {
+ *         if ( 0 == edf_runNext() )
+ *         {
+ *             cpuload_idle();
+ *         }
+ *     }
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _EDF_H_
+#define _EDF_H_
+
+#include <stdint.h>
+
+
+/* Max. number of tasks: */
+#define EDF_MAX_TASKS            32
+
+
+/* Return values of edf_* functions: */
+#define EDF_OK                   0
+#define EDF_ERR_PARAM           -1     /* invalid parameter or task, or the ISR could not be registered */
+#define EDF_ERR_NOINIT          -2     /* no tasks are initialized */
+
+
+/**
+ * Required prototype of tasks' functions, each call executes one job.
+ *
+ * @param param - parameter of the task
+ */
+typedef void (*edfTaskFunc)(void* param);
+
+
+/**
+ * A periodic task. Its relative deadline may not exceed its period,
+ * so at most one job of a task is pending at any time.
+ */
+typedef struct _edfTask
+{
+    edfTaskFunc func;             /* the task's function */
+    void* param;                  /* parameter of the function */
+    uint32_t periodUs;            /* period in micro seconds */
+    uint32_t deadlineUs;          /* relative deadline in micro seconds, 0 for the period */
+} edfTask;
+
+
+/**
+ * Statistics of the dispatcher, all counters start at 0 when it is
+ * started or its statistics are reset.
+ */
+typedef struct _edfStats
+{
+    uint32_t released;            /* released jobs */
+    uint32_t completed;           /* completed jobs */
+    uint32_t misses;              /* jobs, completed after their deadlines */
+    uint32_t dropped;             /* releases, dropped as the previous job was still pending */
+    uint32_t maxLatenessUs;       /* max. time by which a job missed its deadline */
+} edfStats;
+
+
+/**
+ * Statistics of a task, execution and response times are measured by
+ * the clocksource.
+ */
+typedef struct _edfTaskStats
+{
+    uint32_t runs;                /* completed jobs */
+    uint32_t misses;              /* jobs, completed after their deadlines */
+    uint32_t dropped;             /* dropped releases */
+    uint32_t wcetUs;              /* max. measured execution time */
+    uint32_t maxResponseUs;       /* max. time from a job's release till its completion */
+} edfTaskStats;
+
+
+int8_t edf_init(const edfTask* tasks, uint8_t nrTasks, uint32_t tickUs, uint8_t timerNr, uint8_t counterNr, uint8_t priority);
+
+int8_t edf_start(void);
+
+void edf_stop(void);
+
+int8_t edf_isRunning(void);
+
+int8_t edf_runNext(void);
+
+uint8_t edf_getNrReady(void);
+
+uint32_t edf_getUtilization(void);
+
+int8_t edf_getStats(edfStats* stats);
+
+int8_t edf_getTaskStats(uint8_t task, edfTaskStats* stats);
+
+void edf_resetStats(void);
+
+#endif  /* _EDF_H_ */
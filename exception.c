@@ -18,7 +18,8 @@ limitations under the License.
 /**
  * @file
  *
- * Implementation of ARM exception handlers (except the reset handler which is 
+ * Implementation of ARM exception handlers (except the reset handler and
+ * entry stubs of the abort and undefined instruction handlers which are
  * implemented in vector.s). Implementation of handlers inside C functions
  * is handy as attributes ("__attribute__((interrupt))") take care of
  * handlers' necessary "boiler plate code".
@@ -50,6 +51,9 @@ void __attribute__((interrupt("IRQ"))) irq_handler(void)
 }
 
 
+/* Declaration of the idle handler, implemented in cpuload.c */
+extern void _cpuload_idleHandler(void);
+
 /*
  * Whenver a SWI (or its equivalent SVC) instruction is called, the CPU
  * switches into the Supervisor mode and executes this handler. It is
@@ -57,26 +61,39 @@ void __attribute__((interrupt("IRQ"))) irq_handler(void)
  * register's bits) is required from an unprivileged mode (e.g. User).
  * 
  * This implementation is very trivial. It checks the immediate value,
- * "appended" to the SWI instruction. If it equals 0, caller mode's CSPR's 
- * I bit will be set (i.e. IRQ handler will be disabled), otherwise it will
- * be cleared.
+ * "appended" to the SWI instruction:
+ * - 0: caller mode's CSPR's I bit will be set (i.e. IRQ handler will be disabled)
+ * - 1: the I bit will be cleared
+ * - 2: the CPU waits for an interrupt (a privileged CP15 operation) within
+ *      _cpuload_idleHandler(). IRQs are masked in the Supervisor mode, so
+ *      the interrupt is serviced after the handler returns (if the caller's
+ *      IRQ mode is enabled).
  */
 void __attribute__((interrupt("SWI"))) swi_handler(void) 
 {
+    uint32_t nr;
+
     /*
      * CSPR ans SPSR can only be accessed via assembler.
      */
     
     /* Extract the immediate value (lower 24 bits of the actual instruction ): */
-    __asm volatile("LDR r0, [lr, #-4]");         /* load the actual SWI instruction */
-    __asm volatile("BIC r0, r0, #0xFF000000");   /* clear the highest 8 bits */
-    
-    __asm volatile("MRS r1, spsr");              /* load the SPSR into r1 */
+    __asm volatile("LDR %0, [lr, #-4]" : "=r" (nr));   /* load the actual SWI instruction */
+    nr &= 0x00FFFFFF;                                  /* clear the highest 8 bits */
+
+    if ( 2 == nr )
+    {
+        _cpuload_idleHandler();
+        return;
+    }
     
-    __asm volatile("TST r0, #0xFF");             /* test whether the immed. value equals 0 */
-    __asm volatile("ORREQ r1, r1, #0x80");       /* if yes, set the I bit */
-    __asm volatile("BICNE r1, r1, #0x80");       /* otherwise clear the I bit */
-    __asm volatile("MSR spsr_cxsf, r1");         /* finally update the SPSR */
+    /* Set the I bit of the SPSR if the immed. value equals 0, clear it otherwise */
+    __asm volatile("MRS r1, spsr            \n\t"
+                   "CMP %0, #0              \n\t"
+                   "ORREQ r1, r1, #0x80     \n\t"
+                   "BICNE r1, r1, #0x80     \n\t"
+                   "MSR spsr_cxsf, r1"
+                   : : "r" (nr) : "r1", "cc");
     
     /* TODO add support for Thumb mode (16 bit) */
 }
@@ -84,7 +101,11 @@ void __attribute__((interrupt("SWI"))) swi_handler(void)
 
 
 /*
- * All other exception handlers are implemented as infinite loops. 
+ * The FIQ handler is implemented as an infinite loop.
+ *
+ * Undefined instruction, prefetch abort and data abort handlers are implemented
+ * as assembler stubs in vectors.s that store the CPU state and call the crash dump
+ * handler, implemented in crash.c.
  */
 
 void __attribute__((interrupt("FIQ"))) fiq_handler(void) 
@@ -92,21 +113,6 @@ void __attribute__((interrupt("FIQ"))) fiq_handler(void)
     for( ; ; ); 
 }
 
-void __attribute__((interrupt("UNDEF"))) undef_handler(void) 
-{ 
-    for( ; ; ); 
-}
-
-void __attribute__((interrupt("ABORT"))) prefetch_abort_handler(void)
-{ 
-    for( ; ; ); 
-}
-
-void __attribute__((interrupt("ABORT"))) data_abort_handler(void)
-{ 
-    for( ; ; ); 
-}
-
 
 /*
  * 'vectors_start' and 'vectors_end' with exception handling vectors are placed
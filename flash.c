@@ -0,0 +1,721 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the CFI NOR flash driver.
+ *
+ * The flash bank is accessed by 32-bit words. Commands of the Intel/Sharp
+ * command set are replicated into both halfwords, so they are accepted by
+ * a bank of two interleaved 16-bit devices (the Versatile's) as well as by
+ * a single 32-bit device (Qemu's model), status is checked in both halves.
+ *
+ * Geometry and timing are read from the CFI table (query mode). Only
+ * devices with uniform sectors (a single erase block region) are supported.
+ * If a device's size is half of BSP_FLASH_SIZE, the bank is assumed to
+ * consist of two interleaved devices.
+ *
+ * Each sector is unlocked before it is erased or programmed. Data are
+ * programmed by "write to buffer" commands, each of them programs up to
+ * a write buffer of words within an aligned buffer sized block.
+ *
+ * If the image executes in place from the same flash (FLASH_XIP is defined,
+ * see xip.ld), nothing may be fetched from the flash until it returns to
+ * read array mode. The driver is placed into RAM then and each operation
+ * is completed, with the CPU's IRQ mode disabled, before flash_eraseAsync()
+ * or flash_programAsync() returns.
+ *
+ * More info about the flash and the CFI:
+ * - Versatile Application Baseboard for ARM926EJ-S, HBI 0118 (DUI0225D):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.dui0225d/DUI0225D_versatile_application_baseboard_arm926ej_s_ug.pdf
+ * - Common Flash Memory Interface Specification, JEDEC JESD68.01
+ * - Intel StrataFlash Wireless Memory (L18) datasheet, order number 251902
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "flash.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "clocksource.h"
+
+
+/*
+ * Access to the flash bank. In the host (unit test) build, the simulated
+ * devices must see each access (see host/sim.c), and a busy wait must
+ * advance the simulated time.
+ */
+#ifdef BSP_HOST_SIM
+extern uint32_t sim_flashRead(uint32_t offset);
+extern void sim_flashWrite(uint32_t offset, uint32_t val);
+extern void sim_timerAdvance(uint32_t ticks);
+#define FLASH_READ(OFF)          sim_flashRead(OFF)
+#define FLASH_WRITE(OFF, VAL)    sim_flashWrite((OFF), (VAL))
+#define POLL_DELAY()             sim_timerAdvance(FLASH_POLL_US)
+#else
+static volatile uint32_t* const pFlash = (volatile uint32_t*) (BSP_FLASH_BASE_ADDRESS);
+#define FLASH_READ(OFF)          ( pFlash[(OFF) >> 2] )
+#define FLASH_WRITE(OFF, VAL)    ( pFlash[(OFF) >> 2] = (VAL) )
+#define POLL_DELAY()
+#endif
+
+
+/*
+ * Commands of the Intel/Sharp command set (see the L18 datasheet),
+ * replicated for both devices of the bank:
+ */
+#define CMD(C)                   ( (uint32_t) (C) * 0x00010001 )
+#define CMD_READ_ARRAY           CMD(0xFF)
+#define CMD_READ_STATUS          CMD(0x70)
+#define CMD_CLEAR_STATUS         CMD(0x50)
+#define CMD_QUERY                CMD(0x98)
+#define CMD_ERASE                CMD(0x20)
+#define CMD_WRITE_BUFFER         CMD(0xE8)
+#define CMD_LOCK_SETUP           CMD(0x60)
+#define CMD_CONFIRM              CMD(0xD0)
+
+/* The query command must be written to this word offset: */
+#define QUERY_ADDR               0x55
+
+/*
+ * Bits of the status register (of both devices):
+ *   7: write state machine ready
+ *   5: erase error
+ *   4: program error
+ *   3: program/erase voltage error
+ *   1: block locked
+ */
+#define SR_READY                 CMD(0x80)
+#define SR_ERRORS                CMD(0x3A)
+
+
+/*
+ * Word offsets of the CFI table's fields (see JESD68.01),
+ * only the least significant byte of each word is valid:
+ */
+#define CFI_QRY                  0x10     /* "QRY" */
+#define CFI_CMD_SET              0x13     /* primary command set, 2 bytes */
+#define CFI_TYP_BUFFER           0x20     /* typical buffer program time, 2^n us */
+#define CFI_TYP_ERASE            0x21     /* typical sector erase time, 2^n ms */
+#define CFI_MAX_BUFFER           0x24     /* max. buffer program time, 2^n times typical */
+#define CFI_MAX_ERASE            0x25     /* max. sector erase time, 2^n times typical */
+#define CFI_SIZE                 0x27     /* size of the device, 2^n bytes */
+#define CFI_BUFFER_SIZE          0x2A     /* size of the write buffer, 2^n bytes, 2 bytes */
+#define CFI_NR_REGIONS           0x2C     /* number of erase block regions */
+#define CFI_REGION               0x2D     /* number of sectors - 1 (2 bytes), sector size / 256 (2 bytes) */
+
+/* Intel/Sharp extended and standard command sets: */
+#define CMD_SET_INTEL_EXT        0x0001
+#define CMD_SET_INTEL_STD        0x0003
+
+
+/* States of the driver: */
+#define ST_NODEV                 0        /* not initialized */
+#define ST_IDLE                  1
+#define ST_ERASE                 2        /* erasing sectors */
+#define ST_PROGRAM               3        /* programming buffers */
+
+/* Max. number of status reads until the write buffer becomes available: */
+#define BUFFER_POLLS             1000
+
+
+static volatile uint8_t __state = ST_NODEV;
+static flashInfo __info;
+static uint8_t __interleaved;            /* nonzero for two interleaved 16-bit devices */
+
+/* The operation in progress: */
+static uint32_t __offset;                /* offset of the current sector or buffer */
+static uint32_t __size;                  /* remaining bytes, including the current step */
+static uint32_t __step;                  /* bytes of the current step */
+static const uint8_t* __src;             /* data to program, at __offset */
+static uint32_t __start;                 /* clocksource_read() when the current step started */
+static uint32_t __timeoutUs;             /* max. time of the current step */
+static flashCallback __callback;
+static void* __param;
+static volatile int8_t __lastStatus;
+
+/* The poll timer: */
+static int8_t __useTimer = 0;
+static uint8_t __timerNr;
+static uint8_t __counterNr;
+
+
+/*
+ * Reads a byte of the CFI table. The flash must be in query mode.
+ *
+ * @param idx - word offset of the field
+ *
+ * @return value of the byte
+ */
+static uint8_t __cfi(uint32_t idx)
+{
+    return (uint8_t) ( FLASH_READ(idx << 2) & 0xFF );
+}
+
+
+/*
+ * Reads a 16-bit field of the CFI table (least significant byte first).
+ *
+ * @param idx - word offset of the field
+ *
+ * @return value of the field
+ */
+static uint16_t __cfi16(uint32_t idx)
+{
+    return (uint16_t) ( __cfi(idx) | (__cfi(idx + 1) << 8) );
+}
+
+
+#ifndef FLASH_XIP
+/*
+ * Starts the poll timer (if used).
+ */
+static void __startTimer(void)
+{
+    if ( 0 != __useTimer )
+    {
+        timer_setLoad(__timerNr, __counterNr, FLASH_POLL_US - 1);
+        timer_enableInterrupt(__timerNr, __counterNr);
+        timer_start(__timerNr, __counterNr);
+    }
+}
+#endif
+
+
+/*
+ * Stops the poll timer (if used).
+ */
+static void __stopTimer(void)
+{
+    if ( 0 != __useTimer )
+    {
+        timer_stop(__timerNr, __counterNr);
+        timer_disableInterrupt(__timerNr, __counterNr);
+        timer_clearInterrupt(__timerNr, __counterNr);
+    }
+}
+
+
+/*
+ * Completes the operation in progress: the flash returns to the read array
+ * mode and the operation's callback is called.
+ *
+ * @param status - status of the operation (FLASH_OK or one of FLASH_ERR_*)
+ */
+static void __finish(int8_t status)
+{
+    const flashCallback cb = __callback;
+    void* const param = __param;
+
+    /* The read array mode is restored first, the timer's code may be in the flash */
+    if ( FLASH_OK != status )
+    {
+        FLASH_WRITE(__offset, CMD_CLEAR_STATUS);
+    }
+    FLASH_WRITE(__offset, CMD_READ_ARRAY);
+
+    __stopTimer();
+
+    /* The driver is released before the callback, so it may start another operation */
+    __lastStatus = status;
+    __state = ST_IDLE;
+
+    if ( NULL != cb )
+    {
+        cb(status, param);
+    }
+}
+
+
+/*
+ * Issues commands of the next step of the operation: unlocks and erases
+ * the sector at __offset or loads and programs the write buffer.
+ *
+ * @return FLASH_OK if the step was started, FLASH_ERR_TIMEOUT if the write buffer was not available
+ */
+static int8_t __startStep(void)
+{
+    const uint32_t sector = __offset & ~(__info.sectorSize - 1);
+    uint32_t i;
+    uint32_t word;
+    uint32_t polls;
+
+    FLASH_WRITE(sector, CMD_LOCK_SETUP);
+    FLASH_WRITE(sector, CMD_CONFIRM);
+    FLASH_WRITE(sector, CMD_CLEAR_STATUS);
+
+    if ( ST_ERASE == __state )
+    {
+        __step = __info.sectorSize;
+        __timeoutUs = __info.eraseTimeoutUs;
+        FLASH_WRITE(sector, CMD_ERASE);
+        FLASH_WRITE(sector, CMD_CONFIRM);
+    }
+    else
+    {
+        /* Up to the end of the aligned buffer sized block */
+        __step = __info.bufferSize - (__offset & (__info.bufferSize - 1));
+        if ( __step > __size )
+        {
+            __step = __size;
+        }
+        __timeoutUs = __info.programTimeoutUs;
+
+        FLASH_WRITE(__offset, CMD_WRITE_BUFFER);
+        for ( polls=0; SR_READY != (FLASH_READ(__offset) & SR_READY); ++polls )
+        {
+            if ( polls >= BUFFER_POLLS )
+            {
+                return FLASH_ERR_TIMEOUT;
+            }
+            FLASH_WRITE(__offset, CMD_WRITE_BUFFER);
+        }
+
+        /* Number of words - 1, for each device */
+        word = (__step >> 2) - 1;
+        FLASH_WRITE(__offset, ( __interleaved ? CMD(word) : word ));
+
+        /* The source may be unaligned */
+        for ( i=0; i<__step; i+=4 )
+        {
+            word = __src[i] | (__src[i+1] << 8) | (__src[i+2] << 16) | ((uint32_t) __src[i+3] << 24);
+            FLASH_WRITE(__offset + i, word);
+        }
+
+        FLASH_WRITE(__offset, CMD_CONFIRM);
+    }
+
+    __start = clocksource_read();
+
+    return FLASH_OK;
+}
+
+
+/*
+ * Checks the status of the current step. When it is completed,
+ * the next step is started or the operation is completed.
+ *
+ * Must only be called when an operation is in progress.
+ */
+static void __advance(void)
+{
+    const uint32_t st = FLASH_READ(__offset);
+    int8_t rc;
+
+    if ( SR_READY != (st & SR_READY) )
+    {
+        if ( clocksource_ticksToUs(clocksource_read() - __start) > __timeoutUs )
+        {
+            __finish(FLASH_ERR_TIMEOUT);
+        }
+        return;
+    }
+
+    if ( 0 != (st & SR_ERRORS) )
+    {
+        __finish(FLASH_ERR_DEVICE);
+        return;
+    }
+
+    if ( __step == __size )
+    {
+        __finish(FLASH_OK);
+        return;
+    }
+
+    __offset += __step;
+    __size -= __step;
+    if ( ST_PROGRAM == __state )
+    {
+        __src += __step;
+    }
+
+    rc = __startStep();
+    if ( FLASH_OK != rc )
+    {
+        __finish(rc);
+    }
+}
+
+
+#ifndef FLASH_XIP
+/*
+ * Callback of the poll timer's expiration.
+ *
+ * @param param - unused
+ */
+static void __timerIsr(void* param)
+{
+    if ( ST_ERASE == __state || ST_PROGRAM == __state )
+    {
+        __advance();
+    }
+}
+#endif
+
+
+/*
+ * Starts an operation, the driver must be idle. In XIP images,
+ * the operation is completed before the function returns.
+ *
+ * @return FLASH_OK or FLASH_ERR_TIMEOUT
+ */
+static int8_t __startOperation(uint8_t state, uint32_t offset, uint32_t size,
+                               const void* buf, flashCallback callback, void* param)
+{
+    int8_t rc;
+
+#ifdef FLASH_XIP
+    /* ISRs may be executed from the flash */
+    const int8_t irqMode = irq_saveIrqMode();
+#endif
+
+    __offset = offset;
+    __size = size;
+    __src = (const uint8_t*) buf;
+    __callback = callback;
+    __param = param;
+    __lastStatus = FLASH_BUSY;
+    __state = state;
+
+    rc = __startStep();
+    if ( FLASH_OK != rc )
+    {
+        /* The callback is not called, the error is returned instead */
+        __callback = NULL;
+        __finish(rc);
+    }
+    else
+    {
+#ifdef FLASH_XIP
+        while ( ST_ERASE == __state || ST_PROGRAM == __state )
+        {
+            POLL_DELAY();
+            __advance();
+        }
+#else
+        __startTimer();
+#endif
+    }
+
+#ifdef FLASH_XIP
+    irq_restoreIrqMode(irqMode);
+#endif
+
+    return rc;
+}
+
+
+/**
+ * Reads the flash's CFI table and initializes the driver. The flash is
+ * left in read array mode. Operations are advanced by flash_poll() until
+ * flash_usePollTimer() is called.
+ *
+ * @return FLASH_OK on success, FLASH_ERR_NODEV if no supported CFI flash was found, FLASH_ERR_BUSY if an operation is in progress
+ */
+int8_t flash_init(void)
+{
+    uint16_t cmdSet;
+    uint32_t devSize;
+    uint32_t nrSectors;
+    uint32_t sectorSize;
+
+    if ( ST_ERASE == __state || ST_PROGRAM == __state )
+    {
+        return FLASH_ERR_BUSY;
+    }
+
+    __state = ST_NODEV;
+    __useTimer = 0;
+
+    FLASH_WRITE(QUERY_ADDR << 2, CMD_QUERY);
+
+    cmdSet = __cfi16(CFI_CMD_SET);
+    if ( 'Q' != __cfi(CFI_QRY) || 'R' != __cfi(CFI_QRY + 1) || 'Y' != __cfi(CFI_QRY + 2) ||
+         ( CMD_SET_INTEL_EXT != cmdSet && CMD_SET_INTEL_STD != cmdSet ) ||
+         1 != __cfi(CFI_NR_REGIONS) || 0 == __cfi(CFI_TYP_BUFFER) || __cfi(CFI_SIZE) > 31 )
+    {
+        FLASH_WRITE(0, CMD_READ_ARRAY);
+        return FLASH_ERR_NODEV;
+    }
+
+    devSize = 1UL << __cfi(CFI_SIZE);
+    nrSectors = __cfi16(CFI_REGION) + 1;
+    sectorSize = __cfi16(CFI_REGION + 2) << 8;
+
+    __interleaved = ( 2 * devSize == BSP_FLASH_SIZE ? 1 : 0 );
+    __info.size = devSize << __interleaved;
+    __info.sectorSize = sectorSize << __interleaved;
+    __info.nrSectors = nrSectors;
+    __info.bufferSize = (1UL << __cfi16(CFI_BUFFER_SIZE)) << __interleaved;
+    __info.programTimeoutUs = (1UL << __cfi(CFI_TYP_BUFFER)) << __cfi(CFI_MAX_BUFFER);
+    __info.eraseTimeoutUs = ((1UL << __cfi(CFI_TYP_ERASE)) << __cfi(CFI_MAX_ERASE)) * 1000;
+
+    FLASH_WRITE(0, CMD_READ_ARRAY);
+
+    if ( __info.size > BSP_FLASH_SIZE || nrSectors * sectorSize != devSize || __info.bufferSize < 4 )
+    {
+        return FLASH_ERR_NODEV;
+    }
+
+    clocksource_init();
+    __lastStatus = FLASH_OK;
+    __state = ST_IDLE;
+
+    return FLASH_OK;
+}
+
+
+/**
+ * Operations will be advanced from the ISR of a SP804 counter, that runs
+ * (every FLASH_POLL_US micro seconds) only while an operation is in progress.
+ * Callbacks are then called from the ISR.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param timerNr - timer number (between 0 and 1)
+ * @param counterNr - counter number of the selected timer (between 0 and 1)
+ * @param priority - priority of the timer's IRQ (see timer_registerCallback())
+ *
+ * @return FLASH_OK on success, FLASH_ERR_PARAM if the timer is invalid or its ISR could not be registered (always in XIP images), FLASH_ERR_BUSY if an operation is in progress
+ */
+int8_t flash_usePollTimer(uint8_t timerNr, uint8_t counterNr, uint8_t priority)
+{
+#ifdef FLASH_XIP
+    /* Operations complete before they return, the timer would never be needed */
+    (void) timerNr;
+    (void) counterNr;
+    (void) priority;
+    return FLASH_ERR_PARAM;
+#else
+    if ( timerNr >= BSP_NR_TIMERS || counterNr >= timer_countersPerTimer() )
+    {
+        return FLASH_ERR_PARAM;
+    }
+
+    if ( ST_ERASE == __state || ST_PROGRAM == __state )
+    {
+        return FLASH_ERR_BUSY;
+    }
+
+    __useTimer = 0;
+    __timerNr = timerNr;
+    __counterNr = counterNr;
+
+    timer_init(timerNr, counterNr);
+
+    if ( timer_registerCallback(timerNr, counterNr, &__timerIsr, NULL, priority) < 0 )
+    {
+        return FLASH_ERR_PARAM;
+    }
+
+    __useTimer = 1;
+
+    return FLASH_OK;
+#endif
+}
+
+
+/**
+ * @return geometry and timing of the flash, NULL if the driver is not initialized
+ */
+const flashInfo* flash_getInfo(void)
+{
+    return ( ST_NODEV == __state ? NULL : &__info );
+}
+
+
+/**
+ * Copies data from the flash.
+ *
+ * @param offset - offset of the first byte within the flash
+ * @param buf - buffer to copy the data to
+ * @param size - number of bytes to copy
+ *
+ * @return FLASH_OK on success, one of FLASH_ERR_* otherwise
+ */
+int8_t flash_read(uint32_t offset, void* buf, uint32_t size)
+{
+    uint8_t* dst = (uint8_t*) buf;
+    uint32_t word;
+    uint32_t i;
+
+    if ( ST_NODEV == __state )
+    {
+        return FLASH_ERR_NODEV;
+    }
+
+    if ( ST_IDLE != __state )
+    {
+        return FLASH_ERR_BUSY;
+    }
+
+    if ( NULL == buf || offset >= __info.size || size > __info.size - offset )
+    {
+        return FLASH_ERR_PARAM;
+    }
+
+    for ( i=0; i<size; ++i )
+    {
+        word = FLASH_READ((offset + i) & ~3UL);
+        dst[i] = (uint8_t) ( word >> (((offset + i) & 3) << 3) );
+    }
+
+    return FLASH_OK;
+}
+
+
+/**
+ * Starts erasing whole sectors. All bytes of erased sectors are set to 0xFF.
+ *
+ * @param offset - offset of the first sector within the flash (must be sector aligned)
+ * @param size - number of bytes to erase (a multiple of the sector size)
+ * @param callback - function to be called when the operation completes (may be NULL)
+ * @param param - parameter, passed to the callback
+ *
+ * @return FLASH_OK if the operation was started, one of FLASH_ERR_* otherwise (the callback is not called then)
+ */
+int8_t flash_eraseAsync(uint32_t offset, uint32_t size, flashCallback callback, void* param)
+{
+    if ( ST_NODEV == __state )
+    {
+        return FLASH_ERR_NODEV;
+    }
+
+    if ( ST_IDLE != __state )
+    {
+        return FLASH_ERR_BUSY;
+    }
+
+    if ( 0 == size || 0 != ((offset | size) & (__info.sectorSize - 1)) ||
+         offset >= __info.size || size > __info.size - offset )
+    {
+        return FLASH_ERR_PARAM;
+    }
+
+    return __startOperation(ST_ERASE, offset, size, NULL, callback, param);
+}
+
+
+/**
+ * Starts programming data. Programming can only clear bits, so the area
+ * should be erased first.
+ *
+ * The data must not be modified until the operation completes.
+ *
+ * @param offset - offset of the first byte within the flash (must be word aligned)
+ * @param buf - data to program (may be unaligned, must not be in the flash)
+ * @param size - number of bytes to program (a multiple of 4)
+ * @param callback - function to be called when the operation completes (may be NULL)
+ * @param param - parameter, passed to the callback
+ *
+ * @return FLASH_OK if the operation was started, one of FLASH_ERR_* otherwise (the callback is not called then)
+ */
+int8_t flash_programAsync(uint32_t offset, const void* buf, uint32_t size, flashCallback callback, void* param)
+{
+    if ( ST_NODEV == __state )
+    {
+        return FLASH_ERR_NODEV;
+    }
+
+    if ( ST_IDLE != __state )
+    {
+        return FLASH_ERR_BUSY;
+    }
+
+    if ( NULL == buf || 0 == size || 0 != ((offset | size) & 3) ||
+         offset >= __info.size || size > __info.size - offset )
+    {
+        return FLASH_ERR_PARAM;
+    }
+
+    /* The data cannot be read from the flash while it is programmed */
+    if ( (const uint8_t*) buf < (const uint8_t*) BSP_FLASH_BASE_ADDRESS + BSP_FLASH_SIZE &&
+         (const uint8_t*) buf + size > (const uint8_t*) BSP_FLASH_BASE_ADDRESS )
+    {
+        return FLASH_ERR_PARAM;
+    }
+
+    return __startOperation(ST_PROGRAM, offset, size, buf, callback, param);
+}
+
+
+/**
+ * Advances the operation in progress (if any). Needs not be called if
+ * the poll timer is used.
+ *
+ * @return FLASH_BUSY if an operation is in progress, otherwise the status of the last completed operation (FLASH_OK if there was none)
+ */
+int8_t flash_poll(void)
+{
+    if ( ST_NODEV == __state )
+    {
+        return FLASH_ERR_NODEV;
+    }
+
+    /* The timer's ISR must not advance the operation at the same time */
+    if ( 0 != __useTimer )
+    {
+        timer_disableInterrupt(__timerNr, __counterNr);
+    }
+
+    if ( ST_ERASE == __state || ST_PROGRAM == __state )
+    {
+        __advance();
+    }
+
+    if ( 0 != __useTimer && ST_IDLE != __state )
+    {
+        timer_enableInterrupt(__timerNr, __counterNr);
+    }
+
+    return ( ST_IDLE == __state ? __lastStatus : FLASH_BUSY );
+}
+
+
+/**
+ * @return a nonzero value (typically 1) if an operation is in progress, 0 otherwise
+ */
+int8_t flash_isBusy(void)
+{
+    return ( ST_ERASE == __state || ST_PROGRAM == __state ? 1 : 0 );
+}
+
+
+/**
+ * Waits until the operation in progress (if any) completes.
+ *
+ * @return status of the last completed operation (FLASH_OK if there was none), FLASH_ERR_NODEV if the driver is not initialized
+ */
+int8_t flash_wait(void)
+{
+    int8_t rc;
+
+    while ( FLASH_BUSY == (rc = flash_poll()) )
+    {
+        POLL_DELAY();
+    }
+
+    return rc;
+}
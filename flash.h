@@ -0,0 +1,102 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the CFI NOR flash driver.
+ *
+ * Erasing and programming are started by flash_eraseAsync() and
+ * flash_programAsync() and run in the background, one sector or one
+ * write buffer at a time. The driver advances an operation whenever
+ * flash_poll() is called or, if flash_usePollTimer() was called, from
+ * the ISR of a SP804 counter every FLASH_POLL_US micro seconds. The
+ * operation's callback is called when it completes.
+ *
+ * The flash cannot be read while an operation is in progress, so data
+ * to program must not be in the flash. If the image executes in place
+ * from the flash (FLASH_XIP, see xip.ld), operations complete before
+ * flash_eraseAsync() and flash_programAsync() return, so the callback is
+ * called (with IRQs disabled) before that and the poll timer is not used.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _FLASH_H_
+#define _FLASH_H_
+
+#include <stdint.h>
+
+
+/* Period of the poll timer in micro seconds: */
+#define FLASH_POLL_US            100
+
+
+/* Return values of flash_* functions and status of completed operations: */
+#define FLASH_OK                 0
+#define FLASH_BUSY               1     /* an operation is in progress (flash_poll()) */
+#define FLASH_ERR_PARAM         -1     /* invalid or misaligned parameters */
+#define FLASH_ERR_NODEV         -2     /* no CFI flash found or the driver is not initialized */
+#define FLASH_ERR_BUSY          -3     /* another operation is in progress */
+#define FLASH_ERR_DEVICE        -4     /* the device reported an erase or program failure */
+#define FLASH_ERR_TIMEOUT       -5     /* the device did not complete in its max. time */
+
+
+/**
+ * Geometry and timing of the flash, read from the CFI tables.
+ */
+typedef struct _flashInfo
+{
+    uint32_t size;                /* size of the flash bank in bytes */
+    uint32_t sectorSize;          /* size of an erase sector in bytes */
+    uint32_t nrSectors;           /* number of erase sectors */
+    uint32_t bufferSize;          /* max. number of bytes, programmed by one write buffer command */
+    uint32_t eraseTimeoutUs;      /* max. time of a sector erase */
+    uint32_t programTimeoutUs;    /* max. time of a buffer program */
+} flashInfo;
+
+
+/**
+ * Required prototype of callbacks, called when an operation completes
+ * (from the poll timer's ISR if the timer is used).
+ *
+ * @param status - FLASH_OK if the operation completed successfully, one of FLASH_ERR_* otherwise
+ * @param param - parameter, passed to flash_eraseAsync() or flash_programAsync()
+ */
+typedef void (*flashCallback)(int8_t status, void* param);
+
+
+int8_t flash_init(void);
+
+int8_t flash_usePollTimer(uint8_t timerNr, uint8_t counterNr, uint8_t priority);
+
+const flashInfo* flash_getInfo(void);
+
+int8_t flash_read(uint32_t offset, void* buf, uint32_t size);
+
+int8_t flash_eraseAsync(uint32_t offset, uint32_t size, flashCallback callback, void* param);
+
+int8_t flash_programAsync(uint32_t offset, const void* buf, uint32_t size, flashCallback callback, void* param);
+
+int8_t flash_poll(void);
+
+int8_t flash_isBusy(void);
+
+int8_t flash_wait(void);
+
+#endif  /* _FLASH_H_ */
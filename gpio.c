@@ -0,0 +1,462 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the PL061 GPIO driver.
+ *
+ * The PL061's data register is mapped to 256 consecutive words. Bits
+ * [9:2] of the accessed address are a mask of pins: a write only modifies
+ * pins whose bits are set in the mask, and a read returns 0 for all other
+ * pins. Any combination of pins is thus set and cleared by a single store
+ * (gpio_modify()) without a read-modify-write sequence, which would need
+ * to be protected against ISRs modifying other pins.
+ *
+ * Each controller has its own IRQ. Its ISR clears all pending edges
+ * before callbacks are called, so edges that occur meanwhile trigger
+ * another IRQ. Level triggered pins cannot be cleared, their condition
+ * must be removed by callbacks.
+ *
+ * More info about the controller:
+ * - ARM PrimeCell General Purpose Input/Output (PL061) Technical Reference Manual (DDI0190):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.ddi0190b/DDI0190.pdf
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "gpio.h"
+#include "interrupt.h"
+
+
+/*
+ * Accesses of the data register at the address, masked by 'PINS'.
+ *
+ * In the host (unit test) build, reads and writes of plain memory have no
+ * side effects, so the simulated controller is notified instead.
+ */
+#ifdef BSP_HOST_SIM
+extern uint32_t sim_gpioRead(uint8_t nr, uint8_t pins);
+extern void sim_gpioWrite(uint8_t nr, uint8_t pins, uint32_t val);
+#define DATA_READ(NR, PINS)          sim_gpioRead((NR), (PINS))
+#define DATA_WRITE(NR, PINS, VAL)    sim_gpioWrite((NR), (PINS), (VAL))
+#else
+#define DATA_READ(NR, PINS)          ( pReg[(NR)]->GPIODATA[(PINS)] )
+#define DATA_WRITE(NR, PINS, VAL)    ( pReg[(NR)]->GPIODATA[(PINS)] = (VAL) )
+#endif
+
+
+/*
+ * 32-bit registers of the PL061, relative to the controller's base address.
+ * See page 3-3 of DDI0190.
+ */
+typedef struct _ARM926EJS_GPIO_REGS
+{
+    uint32_t GPIODATA[256];            /* Data Register, bits [9:2] of the address mask pins */
+    uint32_t GPIODIR;                  /* Data Direction Register (1: output) */
+    uint32_t GPIOIS;                   /* Interrupt Sense Register (1: level, 0: edge) */
+    uint32_t GPIOIBE;                  /* Interrupt Both Edges Register */
+    uint32_t GPIOIEV;                  /* Interrupt Event Register (1: rising edge or high level) */
+    uint32_t GPIOIE;                   /* Interrupt Mask Register (1: enabled) */
+    const uint32_t GPIORIS;            /* Raw Interrupt Status Register, read only */
+    const uint32_t GPIOMIS;            /* Masked Interrupt Status Register, read only */
+    uint32_t GPIOIC;                   /* Interrupt Clear Register, write only */
+    uint32_t GPIOAFSEL;                /* Mode Control Select Register (1: hardware control) */
+} ARM926EJS_GPIO_REGS;
+
+
+/* Bit mask of all pins: */
+#define ALL_PINS             0x000000FF
+
+
+/*
+ * State of a controller: callbacks of its pins and
+ * the number of its ISR's invocations.
+ */
+typedef struct _gpioState
+{
+    gpioCallback callback[GPIO_NR_PINS];
+    void* param[GPIO_NR_PINS];
+    uint32_t irqs;
+    uint8_t nr;
+} gpioState;
+
+static gpioState __gpio[BSP_NR_GPIOS];
+
+static const uint8_t __irqs[BSP_NR_GPIOS] = BSP_GPIO_IRQS;
+
+
+#define GEN_CAST_ADDR(ADDR)    (ARM926EJS_GPIO_REGS*) (ADDR),
+
+static volatile ARM926EJS_GPIO_REGS* const  pReg[BSP_NR_GPIOS]=
+                         {
+                             BSP_GPIO_BASE_ADDRESSES(GEN_CAST_ADDR)
+                         };
+
+#undef GEN_CAST_ADDR
+
+
+/*
+ * ISR of a controller, calls callbacks of all pins with pending interrupts
+ * in ascending order of pins. Interrupts of pins without a callback are
+ * disabled.
+ *
+ * @param param - pointer to the controller's state
+ */
+static void __gpioIsr(void* param)
+{
+    gpioState* const g = (gpioState*) param;
+    volatile ARM926EJS_GPIO_REGS* const r = pReg[g->nr];
+    uint8_t pending;
+    uint8_t pin;
+
+    ++g->irqs;
+
+    pending = (uint8_t) (r->GPIOMIS & ALL_PINS);
+
+    /* Only edges are cleared, levels are not latched */
+    r->GPIOIC = pending;
+
+    for ( pin=0; pin<GPIO_NR_PINS && 0!=pending; ++pin, pending >>= 1 )
+    {
+        if ( 0 == (pending & 0x01) )
+        {
+            continue;
+        }
+
+        if ( NULL == g->callback[pin] )
+        {
+            r->GPIOIE &= ~(1UL << pin);
+            continue;
+        }
+
+        ( *g->callback[pin] )( pin, g->param[pin] );
+    }
+}
+
+
+/**
+ * Initializes a GPIO controller: all pins are configured as inputs,
+ * controlled by software, their interrupts are disabled and callbacks
+ * unregistered. The controller's ISR is registered and its IRQ enabled.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param nr - number of the controller
+ * @param priority - priority of the controller's IRQ (see pic_registerNonVectoredIrq())
+ *
+ * @return GPIO_OK on success, GPIO_ERR_PARAM if 'nr' is invalid or the ISR could not be registered
+ */
+int8_t gpio_init(uint8_t nr, uint8_t priority)
+{
+    volatile ARM926EJS_GPIO_REGS* r;
+    gpioState* g;
+    uint8_t pin;
+
+    if ( nr >= BSP_NR_GPIOS )
+    {
+        return GPIO_ERR_PARAM;
+    }
+
+    r = pReg[nr];
+    g = &__gpio[nr];
+
+    r->GPIOIE = 0;
+    r->GPIODIR = 0;
+    r->GPIOAFSEL = 0;
+    r->GPIOIS = 0;
+    r->GPIOIBE = 0;
+    r->GPIOIEV = 0;
+    r->GPIOIC = ALL_PINS;
+
+    for ( pin=0; pin<GPIO_NR_PINS; ++pin )
+    {
+        g->callback[pin] = NULL;
+        g->param[pin] = NULL;
+    }
+
+    g->irqs = 0;
+    g->nr = nr;
+
+    if ( pic_registerNonVectoredIrq(__irqs[nr], &__gpioIsr, (void*) g, priority) < 0 )
+    {
+        return GPIO_ERR_PARAM;
+    }
+
+    pic_enableInterrupt(__irqs[nr]);
+
+    return GPIO_OK;
+}
+
+
+/**
+ * Disables all interrupts of a controller and its IRQ. Pins
+ * remain configured as they are.
+ *
+ * Nothing is done if 'nr' is invalid.
+ *
+ * @param nr - number of the controller
+ */
+void gpio_disable(uint8_t nr)
+{
+    if ( nr >= BSP_NR_GPIOS )
+    {
+        return;
+    }
+
+    pReg[nr]->GPIOIE = 0;
+    pic_disableInterrupt(__irqs[nr]);
+    pic_unregisterNonVectoredIrq(__irqs[nr]);
+}
+
+
+/**
+ * Configures pins as outputs, other pins are not affected.
+ *
+ * Nothing is done if 'nr' is invalid.
+ *
+ * @param nr - number of the controller
+ * @param pins - bit mask of pins
+ */
+void gpio_setOutputs(uint8_t nr, uint8_t pins)
+{
+    if ( nr < BSP_NR_GPIOS )
+    {
+        pReg[nr]->GPIODIR |= pins;
+    }
+}
+
+
+/**
+ * Configures pins as inputs, other pins are not affected.
+ *
+ * Nothing is done if 'nr' is invalid.
+ *
+ * @param nr - number of the controller
+ * @param pins - bit mask of pins
+ */
+void gpio_setInputs(uint8_t nr, uint8_t pins)
+{
+    if ( nr < BSP_NR_GPIOS )
+    {
+        pReg[nr]->GPIODIR &= ~((uint32_t) pins);
+    }
+}
+
+
+/**
+ * Sets output pins of the mask to their values by a single store.
+ * Pins outside of the mask and input pins are not affected.
+ *
+ * Nothing is done if 'nr' is invalid.
+ *
+ * @param nr - number of the controller
+ * @param pins - bit mask of pins to be modified
+ * @param values - new values of pins (bit n is the value of pin n)
+ */
+void gpio_write(uint8_t nr, uint8_t pins, uint8_t values)
+{
+    if ( nr < BSP_NR_GPIOS )
+    {
+        DATA_WRITE(nr, pins, values);
+    }
+}
+
+
+/**
+ * Sets output pins to 1 by a single store.
+ *
+ * @param nr - number of the controller
+ * @param pins - bit mask of pins to be set
+ */
+void gpio_set(uint8_t nr, uint8_t pins)
+{
+    gpio_write(nr, pins, ALL_PINS);
+}
+
+
+/**
+ * Clears output pins to 0 by a single store.
+ *
+ * @param nr - number of the controller
+ * @param pins - bit mask of pins to be cleared
+ */
+void gpio_clear(uint8_t nr, uint8_t pins)
+{
+    gpio_write(nr, pins, 0);
+}
+
+
+/**
+ * Sets and clears output pins at once, i.e. by a single store.
+ * Pins in both masks are set.
+ *
+ * @param nr - number of the controller
+ * @param setPins - bit mask of pins to be set
+ * @param clearPins - bit mask of pins to be cleared
+ */
+void gpio_modify(uint8_t nr, uint8_t setPins, uint8_t clearPins)
+{
+    gpio_write(nr, setPins | clearPins, setPins);
+}
+
+
+/**
+ * Reads levels of pins (of both inputs and outputs).
+ *
+ * @param nr - number of the controller
+ * @param pins - bit mask of pins to be read
+ *
+ * @return levels of pins of the mask (other bits are 0), 0 if 'nr' is invalid
+ */
+uint8_t gpio_read(uint8_t nr, uint8_t pins)
+{
+    return ( nr < BSP_NR_GPIOS ? (uint8_t) (DATA_READ(nr, pins) & pins) : 0 );
+}
+
+
+/**
+ * Registers a callback of a pin's interrupt, configures its trigger
+ * and enables the pin's interrupt. An interrupt, pending before the
+ * call, is discarded.
+ *
+ * @param nr - number of the controller
+ * @param pin - number of the pin (between 0 and 7)
+ * @param trigger - one of GPIO_IRQ_*
+ * @param callback - function, called (from the ISR) when the interrupt is triggered
+ * @param param - parameter, passed to the callback
+ *
+ * @return GPIO_OK on success, GPIO_ERR_PARAM if any parameter is invalid
+ */
+int8_t gpio_registerIrq(uint8_t nr, uint8_t pin, uint8_t trigger, gpioCallback callback, void* param)
+{
+    volatile ARM926EJS_GPIO_REGS* r;
+    uint32_t bit;
+
+    if ( nr >= BSP_NR_GPIOS || pin >= GPIO_NR_PINS || trigger > GPIO_IRQ_LOW || NULL == callback )
+    {
+        return GPIO_ERR_PARAM;
+    }
+
+    r = pReg[nr];
+    bit = 1UL << pin;
+
+    /* The trigger may only be modified while the interrupt is disabled */
+    r->GPIOIE &= ~bit;
+
+    __gpio[nr].callback[pin] = callback;
+    __gpio[nr].param[pin] = param;
+
+    switch ( trigger )
+    {
+        case GPIO_IRQ_RISING:
+        case GPIO_IRQ_FALLING:
+            r->GPIOIS &= ~bit;
+            r->GPIOIBE &= ~bit;
+            r->GPIOIEV = ( GPIO_IRQ_RISING == trigger ? r->GPIOIEV | bit : r->GPIOIEV & ~bit );
+            break;
+
+        case GPIO_IRQ_BOTH:
+            r->GPIOIS &= ~bit;
+            r->GPIOIBE |= bit;
+            break;
+
+        default:
+            r->GPIOIS |= bit;
+            r->GPIOIBE &= ~bit;
+            r->GPIOIEV = ( GPIO_IRQ_HIGH == trigger ? r->GPIOIEV | bit : r->GPIOIEV & ~bit );
+            break;
+    }
+
+    r->GPIOIC = bit;
+    r->GPIOIE |= bit;
+
+    return GPIO_OK;
+}
+
+
+/**
+ * Disables a pin's interrupt and unregisters its callback.
+ *
+ * Nothing is done if any parameter is invalid.
+ *
+ * @param nr - number of the controller
+ * @param pin - number of the pin (between 0 and 7)
+ */
+void gpio_unregisterIrq(uint8_t nr, uint8_t pin)
+{
+    if ( nr >= BSP_NR_GPIOS || pin >= GPIO_NR_PINS )
+    {
+        return;
+    }
+
+    gpio_disableIrq(nr, pin);
+    __gpio[nr].callback[pin] = NULL;
+    __gpio[nr].param[pin] = NULL;
+}
+
+
+/**
+ * Enables a pin's interrupt (its trigger must be configured
+ * by gpio_registerIrq()).
+ *
+ * Nothing is done if any parameter is invalid.
+ *
+ * @param nr - number of the controller
+ * @param pin - number of the pin (between 0 and 7)
+ */
+void gpio_enableIrq(uint8_t nr, uint8_t pin)
+{
+    if ( nr < BSP_NR_GPIOS && pin < GPIO_NR_PINS )
+    {
+        pReg[nr]->GPIOIE |= ( 1UL << pin );
+    }
+}
+
+
+/**
+ * Disables a pin's interrupt, its callback remains registered.
+ *
+ * Nothing is done if any parameter is invalid.
+ *
+ * @param nr - number of the controller
+ * @param pin - number of the pin (between 0 and 7)
+ */
+void gpio_disableIrq(uint8_t nr, uint8_t pin)
+{
+    if ( nr < BSP_NR_GPIOS && pin < GPIO_NR_PINS )
+    {
+        pReg[nr]->GPIOIE &= ~(1UL << pin);
+    }
+}
+
+
+/**
+ * @param nr - number of the controller
+ *
+ * @return number of the controller ISR's invocations since gpio_init(), 0 if 'nr' is invalid
+ */
+uint32_t gpio_getNrIrqs(uint8_t nr)
+{
+    return ( nr < BSP_NR_GPIOS ? __gpio[nr].irqs : 0 );
+}
@@ -0,0 +1,98 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the PL061 GPIO driver.
+ *
+ * Each controller drives 8 pins, identified by bit masks (bit n is pin n).
+ * Writes of output pins modify only the pins of the mask, in a single
+ * store to the controller's address masked data register, i.e. without
+ * reading the current state of other pins. Several pins may thus be set
+ * and cleared at once, even if other pins of the same controller are
+ * modified by ISRs.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _GPIO_H_
+#define _GPIO_H_
+
+#include <stdint.h>
+
+
+/* Number of pins of each controller: */
+#define GPIO_NR_PINS             8
+
+
+/* Return values of gpio_* functions: */
+#define GPIO_OK                  0
+#define GPIO_ERR_PARAM          -1     /* invalid controller, pin or mode, or the ISR could not be registered */
+
+
+/* Interrupt triggers of pins: */
+#define GPIO_IRQ_RISING          0     /* rising edge */
+#define GPIO_IRQ_FALLING         1     /* falling edge */
+#define GPIO_IRQ_BOTH            2     /* both edges */
+#define GPIO_IRQ_HIGH            3     /* high level */
+#define GPIO_IRQ_LOW             4     /* low level */
+
+
+/**
+ * Required prototype of callbacks, called (from the controller's ISR)
+ * when a pin's interrupt is triggered.
+ *
+ * A callback of a level triggered pin must remove the condition (or
+ * disable the pin's interrupt), otherwise it is called again immediately.
+ *
+ * @param pin - number of the pin (between 0 and 7)
+ * @param param - parameter, passed to gpio_registerIrq()
+ */
+typedef void (*gpioCallback)(uint8_t pin, void* param);
+
+
+int8_t gpio_init(uint8_t nr, uint8_t priority);
+
+void gpio_disable(uint8_t nr);
+
+void gpio_setOutputs(uint8_t nr, uint8_t pins);
+
+void gpio_setInputs(uint8_t nr, uint8_t pins);
+
+void gpio_write(uint8_t nr, uint8_t pins, uint8_t values);
+
+void gpio_set(uint8_t nr, uint8_t pins);
+
+void gpio_clear(uint8_t nr, uint8_t pins);
+
+void gpio_modify(uint8_t nr, uint8_t setPins, uint8_t clearPins);
+
+uint8_t gpio_read(uint8_t nr, uint8_t pins);
+
+int8_t gpio_registerIrq(uint8_t nr, uint8_t pin, uint8_t trigger, gpioCallback callback, void* param);
+
+void gpio_unregisterIrq(uint8_t nr, uint8_t pin);
+
+void gpio_enableIrq(uint8_t nr, uint8_t pin);
+
+void gpio_disableIrq(uint8_t nr, uint8_t pin);
+
+uint32_t gpio_getNrIrqs(uint8_t nr);
+
+#endif  /* _GPIO_H_ */
@@ -0,0 +1,2211 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Simulated register blocks and small behavioral models of the system
+ * registers, PL190 VIC, SP804 timers, PL011 UARTs, the PL031 RTC, the
+ * PL080 DMA controller, the PL181 MMCI with a SD card, the PL110 CLCD,
+ * PL050 KMIs, PL061 GPIOs and the PL022 SSP for the host (unit test) build.
+ *
+ * The models only implement behaviour that the drivers rely on:
+ * - system registers: the ID, SYS_24MHZ and SYS_100HZ counters that advance
+ *   together with the timers (whose reference clock is 1 MHz)
+ * - PL190: enable/clear and soft interrupt set/clear registers, IRQ status,
+ *   vector address of the highest priority active vectored IRQ
+ * - SIC: enable/clear and soft interrupt set/clear registers, status of the
+ *   MMCI's and KMIs' sources, triggering the PL190's line 31, and the
+ *   pass-through of its sources 21 to 30 to the PL190
+ * - SP804: reloading at writes to the Load Register, counting down in
+ *   periodic, free running and one shot mode (32-bit only, no prescaling),
+ *   raw/masked interrupt status and interrupt clearing
+ * - PL011: the transmit FIFO is never full. Characters, sent by the device
+ *   (see sim_uartInject()), fill the receive FIFO (characters that do not
+ *   fit into it raise the overrun interrupt) and are read one by one via
+ *   sim_uartRead(). The receive interrupt follows the FIFO level, selected
+ *   by UARTIFLS, the receive timeout is raised whenever the FIFO is not
+ *   empty. Interrupt clearing.
+ * - PL031: loading, counting, match interrupts and interrupt clearing
+ * - PL080: memory to memory transfers, including linked lists, are completed
+ *   at once when a channel is enabled, terminal count and error interrupts
+ * - PL181: commands are completed at sync, data are moved between the card
+ *   and the FIFO whenever possible. The driver accesses the FIFO via
+ *   sim_mmciFifoRead() and sim_mmciFifoWrite().
+ * - SD card: identification (CMD0, CMD8, ACMD41, CMD2, CMD3, CMD9, CMD7),
+ *   CMD12, CMD13, CMD16 and single/multiple block reads and writes of a
+ *   standard or high capacity card, whose contents are sim_sdData
+ * - NOR flash: a single 32-bit device of the Intel/Sharp command set with
+ *   a CFI table, accessed by the driver via sim_flashRead() and
+ *   sim_flashWrite(). Sectors are locked at reset. Erase and buffer program
+ *   commands are executed at once, but the device remains busy for their
+ *   typical time (measured by SYS_24MHZ).
+ * - PL110: while enabled, a frame starts every SIM_CLCD_FRAME_US timer
+ *   ticks. The upper panel's base address is loaded then and both the base
+ *   update and the vertical compare interrupts are raised.
+ * - PL050: bytes, sent by the device (see sim_kmiInject()), are queued and
+ *   read one by one from the data register via sim_kmiRead(). The transmit
+ *   register is always empty, the device acknowledges each written byte by
+ *   0xFA (see sim_kmiWrite()).
+ * - PL061: levels of input pins are set by sim_gpioSetInputs(), output pins
+ *   are written via sim_gpioWrite() with the address mask. Edges of any pin
+ *   (input or output) are latched, levels are reported while they last.
+ * - PL022: while enabled, frames of the transmit FIFO are shifted out at
+ *   once (at sync) and the response of the device (or the frame itself in
+ *   the loop back mode) is pushed into the receive FIFO, or lost if it is
+ *   full. The receive timeout is raised while the receive FIFO is not
+ *   empty and the transmit FIFO is. The driver accesses the FIFOs via
+ *   sim_sspRead() and sim_sspWrite().
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+
+#include "sim.h"
+
+
+/* Simulated register blocks, their addresses are used by sim_bsp.h: */
+uint32_t sim_sysRegs[SIM_REG_WORDS];
+uint32_t sim_picRegs[SIM_REG_WORDS];
+uint32_t sim_sicRegs[SIM_REG_WORDS];
+uint32_t sim_uartRegs[BSP_NR_UARTS][SIM_REG_WORDS];
+uint32_t sim_timerRegs[BSP_NR_TIMERS][SIM_REG_WORDS];
+uint32_t sim_rtcRegs[SIM_REG_WORDS];
+uint32_t sim_dmaRegs[SIM_REG_WORDS];
+uint32_t sim_mmciRegs[SIM_REG_WORDS];
+uint32_t sim_clcdRegs[SIM_REG_WORDS];
+uint32_t sim_kmiRegs[BSP_NR_KMIS][SIM_REG_WORDS];
+uint32_t sim_gpioRegs[BSP_NR_GPIOS][SIM_REG_WORDS];
+uint32_t sim_sspRegs[SIM_REG_WORDS];
+
+/* The simulated SD card: */
+uint8_t sim_sdData[SIM_SD_NR_BLOCKS * SIM_SD_BLOCK_SIZE];
+int8_t sim_sdInserted;
+int8_t sim_sdHighCapacity;
+uint32_t sim_sdNrCommands[64];
+uint32_t sim_mmciDataErrors;
+
+/* The simulated flash: */
+uint32_t sim_flashData[SIM_FLASH_SIZE / 4];
+uint32_t sim_flashLocked;
+uint32_t sim_flashNrErases;
+uint32_t sim_flashNrBuffers;
+uint32_t sim_flashFailNext;
+uint32_t sim_flashProtocolErrors;
+
+/* The simulated display: */
+uint32_t sim_clcdNrFrames;
+
+/* The simulated keyboard/mouse interfaces: */
+uint8_t sim_kmiTxLast[BSP_NR_KMIS];
+uint32_t sim_kmiNrTx[BSP_NR_KMIS];
+
+/* The simulated GPIO controllers: */
+uint32_t sim_gpioNrWrites[BSP_NR_GPIOS];
+uint32_t sim_gpioNrReads[BSP_NR_GPIOS];
+
+/* The simulated synchronous serial port: */
+uint16_t sim_sspTxLog[SIM_SSP_LOG_SIZE];
+uint32_t sim_sspNrFrames;
+uint32_t sim_sspNrOverruns;
+
+
+#define NR_COUNTERS           2
+#define NR_VECTORS            16
+
+#define UL1                   0x00000001
+
+#define TIM_CTL_ENABLE        0x00000080
+#define TIM_CTL_MODE          0x00000040
+#define TIM_CTL_INTR          0x00000020
+#define TIM_CTL_ONESHOT       0x00000001
+
+#define VECT_ENABLE           0x00000020
+#define BM_VECT_IRQ           0x0000001F
+
+#define SYS_ID_VERSATILE_PB   0x41007004
+#define SYS_24MHZ_PER_TICK    24
+#define SYS_TICKS_PER_100HZ   10000
+
+#define UART_FR_RXFE          0x00000010
+#define UART_FR_RXFF          0x00000040
+#define UART_FR_TXFE          0x00000080
+#define UART_INT_RX           0x00000010
+#define UART_INT_RT           0x00000040
+#define UART_INT_OE           0x00000400
+#define UART_IFLS_RX_SHIFT    3
+
+#define RTC_START             0x00000001
+#define RTC_INT               0x00000001
+
+#define NR_DMA_CHANNELS       8
+#define DMA_CONFIG_ENABLE     0x00000001
+#define DMA_CCFG_ENABLE       0x00000001
+#define DMA_CCFG_IE           0x00004000
+#define DMA_CCFG_ITC          0x00008000
+#define DMA_CTRL_TC_INT       0x80000000
+#define DMA_CTRL_DI           0x08000000
+#define DMA_CTRL_SI           0x04000000
+#define DMA_BM_SIZE           0x00000FFF
+#define DMA_SWIDTH(c)         ( ((c) >> 18) & 0x07 )
+#define DMA_DWIDTH(c)         ( ((c) >> 21) & 0x07 )
+
+#define SIC_BM_PASS_THROUGH   0x7FE00000
+
+#define KMI_CR_EN             0x00000004
+#define KMI_CR_TXINTREN       0x00000008
+#define KMI_CR_RXINTREN       0x00000010
+#define KMI_STAT_RXFULL       0x00000010
+#define KMI_STAT_TXEMPTY      0x00000040
+#define KMI_IR_RX             0x00000001
+#define KMI_IR_TX             0x00000002
+#define KMI_ACK               0xFA
+
+#define GPIO_ALL_PINS         0x000000FF
+
+#define SSP_FIFO_DEPTH        8
+#define SSP_CR1_LBM           0x00000001
+#define SSP_CR1_SSE           0x00000002
+#define SSP_SR_TFE            0x00000001
+#define SSP_SR_TNF            0x00000002
+#define SSP_SR_RNE            0x00000004
+#define SSP_SR_RFF            0x00000008
+#define SSP_INT_ROR           0x00000001
+#define SSP_INT_RT            0x00000002
+#define SSP_INT_RX            0x00000004
+#define SSP_INT_TX            0x00000008
+#define SSP_BM_DSS            0x0000000F
+
+#define MMCI_FIFO_WORDS       16
+#define MMCI_CMD_ENABLE       0x00000400
+#define MMCI_CMD_RESPONSE     0x00000040
+#define MMCI_CMD_LONG_RSP     0x00000080
+#define MMCI_BM_CMD_INDEX     0x0000003F
+#define MMCI_DCTRL_ENABLE     0x00000001
+#define MMCI_DCTRL_DIRECTION  0x00000002
+#define MMCI_ST_CMD_TIMEOUT   0x00000004
+#define MMCI_ST_CMD_RESP_END  0x00000040
+#define MMCI_ST_CMD_SENT      0x00000080
+#define MMCI_ST_DATA_END      0x00000100
+#define MMCI_ST_BLOCK_END     0x00000400
+#define MMCI_ST_TX_ACTIVE     0x00001000
+#define MMCI_ST_RX_ACTIVE     0x00002000
+#define MMCI_ST_TX_HALF_EMPTY 0x00004000
+#define MMCI_ST_RX_HALF_FULL  0x00008000
+#define MMCI_ST_TX_FULL       0x00010000
+#define MMCI_ST_RX_FULL       0x00020000
+#define MMCI_ST_TX_EMPTY      0x00040000
+#define MMCI_ST_RX_EMPTY      0x00080000
+#define MMCI_ST_TX_AVLBL      0x00100000
+#define MMCI_ST_RX_AVLBL      0x00200000
+#define MMCI_BM_ST_FIFO       0x003FF000
+#define MMCI_BM_CLEAR         0x000007FF
+
+#define SD_STATE_IDLE         0
+#define SD_STATE_READY        1
+#define SD_STATE_IDENT        2
+#define SD_STATE_STBY         3
+#define SD_STATE_TRAN         4
+#define SD_STATE_DATA         5
+#define SD_STATE_RCV          6
+#define SD_RCA                0x4567
+#define SD_OCR                0x00FF8000
+#define SD_OCR_BUSY           0x80000000
+#define SD_OCR_CCS            0x40000000
+#define SD_R1_OUT_OF_RANGE    0x80000000
+#define SD_R1_ADDRESS_ERROR   0x40000000
+#define SD_R1_BLOCK_LEN_ERROR 0x20000000
+#define SD_R1_READY_FOR_DATA  0x00000100
+#define SD_R1_APP_CMD         0x00000020
+#define SD_CAPACITY           ( SIM_SD_NR_BLOCKS * SIM_SD_BLOCK_SIZE )
+
+#define CLCD_CTRL_ENABLE      0x00000001
+#define CLCD_INT_BASE_UPDATE  0x00000004
+#define CLCD_INT_VCOMP        0x00000008
+
+#define FLASH_NR_SECTORS      ( SIM_FLASH_SIZE / SIM_FLASH_SECTOR_SIZE )
+#define FLASH_SR_READY        0x80
+#define FLASH_SR_ERASE_ERR    0x20
+#define FLASH_SR_PROGRAM_ERR  0x10
+#define FLASH_SR_LOCKED       0x02
+
+/* Read modes and states of command sequences of the simulated flash: */
+#define FLASH_MODE_ARRAY      0
+#define FLASH_MODE_STATUS     1
+#define FLASH_MODE_QUERY      2
+#define FLASH_MODE_ERASE      3       /* erase setup, waiting for the confirmation */
+#define FLASH_MODE_LOCK       4       /* lock setup, waiting for the (un)lock command */
+#define FLASH_MODE_COUNT      5       /* write to buffer, waiting for the word count */
+#define FLASH_MODE_DATA       6       /* loading the write buffer */
+#define FLASH_MODE_CONFIRM    7       /* the buffer is loaded, waiting for the confirmation */
+
+/* Responses of the simulated card: */
+#define SD_RSP_NONE           -1      /* the card does not respond */
+#define SD_RSP_ACCEPTED       0       /* the command was accepted, without a response */
+#define SD_RSP_SHORT          1
+#define SD_RSP_LONG           2
+
+
+/* IRQ of the other peripherals, set by sim_setIrqLine(): */
+static uint32_t __extLines;
+
+/* Last values written into the load registers, writes are detected by comparison: */
+static uint32_t __timerLoad[BSP_NR_TIMERS][NR_COUNTERS];
+static uint32_t __rtcLoad;
+
+/* Timer ticks since the last increment of SYS_100HZ: */
+static uint32_t __sys100HzTicks;
+
+/* SIC's sources, passed through to the VIC, enabled sources and soft interrupts: */
+static uint32_t __sicPassThrough;
+static uint32_t __sicEnable;
+static uint32_t __sicSoft;
+
+/* State of the MMCI's data path and its FIFO (a ring of words): */
+static int8_t __mmciDataActive;
+static uint32_t __mmciDataCnt;
+static uint32_t __mmciFifo[MMCI_FIFO_WORDS];
+static uint8_t __mmciFifoHead;
+static uint8_t __mmciFifoLen;
+
+/* State of the SD card: */
+static uint8_t __sdState;
+static int8_t __sdAppCmd;
+static uint8_t __sdOpCondPolls;
+static uint32_t __sdErrors;          /* reported (and cleared) by the next R1 response */
+static uint32_t __sdAddr;            /* byte address of the next transferred byte */
+static int8_t __sdMultiple;          /* nonzero during multiple block transfers */
+
+/* State of the flash: */
+static uint8_t __flashMode;
+static uint8_t __flashStatus;
+static uint32_t __flashBusyUntil;    /* SYS_24MHZ value when the current operation completes */
+static uint32_t __flashBufOffset;    /* offset of the first word of the write buffer */
+static uint32_t __flashBufWords;
+static uint32_t __flashBufLoaded;
+static uint32_t __flashBuf[SIM_FLASH_BUFFER_SIZE / 4];
+
+/* CFI table of the flash (word offsets 0x10 to 0x30), see JESD68.01: */
+static const uint8_t __flashCfi[] =
+{
+    'Q', 'R', 'Y', 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      /* 0x10: Intel/Sharp extended command set */
+    0x00, 0x00, 0x17, 0x19, 0x00, 0x00,                     /* 0x19: no alternate table, voltages */
+    0x04, SIM_FLASH_BUFFER_LOG2_US, SIM_FLASH_ERASE_LOG2_MS, 0x00,  /* 0x1F: typical times */
+    0x04, 0x03, 0x03, 0x00,                                 /* 0x23: max. times (multipliers) */
+    SIM_FLASH_SIZE_LOG2, 0x03, 0x00,                        /* 0x27: size, x32 interface */
+    SIM_FLASH_BUFFER_LOG2, 0x00,                            /* 0x2A: write buffer */
+    0x01,                                                   /* 0x2C: a single erase block region */
+    FLASH_NR_SECTORS - 1, 0x00,
+    (SIM_FLASH_SECTOR_SIZE >> 8) & 0xFF, SIM_FLASH_SECTOR_SIZE >> 16
+};
+
+/* Timer ticks since the start of the current frame: */
+static uint32_t __clcdTicks;
+
+/* Receive FIFOs of the UARTs (rings of characters): */
+static uint8_t __uartRxFifo[BSP_NR_UARTS][SIM_UART_FIFO_DEPTH];
+static uint32_t __uartRxHead[BSP_NR_UARTS];
+static uint32_t __uartRxLen[BSP_NR_UARTS];
+
+/* Receive interrupt FIFO levels, selected by UARTIFLS's RXIFLSEL (1/8, 1/4, 1/2, 3/4, 7/8): */
+static const uint32_t __uartRxLevels[8] = { 2, 4, 8, 12, 14, 14, 14, 14 };
+
+/* Receive queues of the KMIs (rings of bytes): */
+static uint8_t __kmiQueue[BSP_NR_KMIS][SIM_KMI_QUEUE_SIZE];
+static uint32_t __kmiHead[BSP_NR_KMIS];
+static uint32_t __kmiLen[BSP_NR_KMIS];
+
+/* Levels of GPIO pins: driven by the device (inputs), output latches, current levels: */
+static uint8_t __gpioExt[BSP_NR_GPIOS];
+static uint8_t __gpioOut[BSP_NR_GPIOS];
+static uint8_t __gpioLevel[BSP_NR_GPIOS];
+
+/* Latched edge interrupts of GPIO pins: */
+static uint8_t __gpioEdges[BSP_NR_GPIOS];
+
+/* FIFOs of the SSP (rings of frames) and its latched overrun interrupt: */
+static uint16_t __sspTxFifo[SSP_FIFO_DEPTH];
+static uint32_t __sspTxHead;
+static uint32_t __sspTxLen;
+static uint16_t __sspRxFifo[SSP_FIFO_DEPTH];
+static uint32_t __sspRxHead;
+static uint32_t __sspRxLen;
+static uint32_t __sspOverrun;
+
+/* Nonzero when the simulated CPU's IRQ mode is enabled */
+static int8_t __irqMode;
+
+/* Defined in interrupt.c: */
+extern void _pic_IrqHandler(void);
+
+/* Defined in cpuload.c: */
+extern void _cpuload_idleHandler(void);
+
+
+/**
+ * Resets all simulated peripherals (all their registers are cleared)
+ * and disables the simulated CPU's IRQ mode.
+ */
+void sim_reset(void)
+{
+    uint8_t i;
+
+    memset(sim_sysRegs, 0, sizeof(sim_sysRegs));
+    memset(sim_picRegs, 0, sizeof(sim_picRegs));
+    memset(sim_sicRegs, 0, sizeof(sim_sicRegs));
+    memset(sim_uartRegs, 0, sizeof(sim_uartRegs));
+    memset(sim_timerRegs, 0, sizeof(sim_timerRegs));
+    memset(sim_rtcRegs, 0, sizeof(sim_rtcRegs));
+    memset(sim_dmaRegs, 0, sizeof(sim_dmaRegs));
+    memset(sim_mmciRegs, 0, sizeof(sim_mmciRegs));
+    memset(sim_clcdRegs, 0, sizeof(sim_clcdRegs));
+    memset(sim_kmiRegs, 0, sizeof(sim_kmiRegs));
+    memset(sim_gpioRegs, 0, sizeof(sim_gpioRegs));
+    memset(sim_sspRegs, 0, sizeof(sim_sspRegs));
+    memset(sim_sdData, 0, sizeof(sim_sdData));
+    memset(sim_sdNrCommands, 0, sizeof(sim_sdNrCommands));
+    memset(__timerLoad, 0, sizeof(__timerLoad));
+
+    for ( i=0; i<BSP_NR_UARTS; ++i )
+    {
+        sim_uartRegs[i][PL011_FR] = UART_FR_TXFE | UART_FR_RXFE;
+        __uartRxHead[i] = 0;
+        __uartRxLen[i] = 0;
+    }
+
+    sim_sysRegs[SYS_ID] = SYS_ID_VERSATILE_PB;
+
+    __extLines = 0;
+    __rtcLoad = 0;
+    __sys100HzTicks = 0;
+    __sicPassThrough = 0;
+    __sicEnable = 0;
+    __sicSoft = 0;
+
+    __mmciDataActive = 0;
+    __mmciDataCnt = 0;
+    __mmciFifoHead = 0;
+    __mmciFifoLen = 0;
+
+    sim_mmciDataErrors = 0;
+    sim_sdInserted = 1;
+    sim_sdHighCapacity = 1;
+    __sdState = SD_STATE_IDLE;
+    __sdAppCmd = 0;
+    __sdOpCondPolls = 0;
+    __sdErrors = 0;
+    __sdAddr = 0;
+    __sdMultiple = 0;
+
+    memset(sim_flashData, 0xFF, sizeof(sim_flashData));
+    sim_flashLocked = (UL1 << FLASH_NR_SECTORS) - 1;
+    sim_flashNrErases = 0;
+    sim_flashNrBuffers = 0;
+    sim_flashFailNext = 0;
+    sim_flashProtocolErrors = 0;
+    __flashMode = FLASH_MODE_ARRAY;
+    __flashStatus = FLASH_SR_READY;
+    __flashBusyUntil = 0;
+
+    sim_clcdNrFrames = 0;
+    __clcdTicks = 0;
+
+    for ( i=0; i<BSP_NR_KMIS; ++i )
+    {
+        sim_kmiTxLast[i] = 0;
+        sim_kmiNrTx[i] = 0;
+        __kmiHead[i] = 0;
+        __kmiLen[i] = 0;
+        sim_kmiRegs[i][PL050_STAT] = KMI_STAT_TXEMPTY;
+    }
+
+    for ( i=0; i<BSP_NR_GPIOS; ++i )
+    {
+        sim_gpioNrWrites[i] = 0;
+        sim_gpioNrReads[i] = 0;
+        __gpioExt[i] = 0;
+        __gpioOut[i] = 0;
+        __gpioLevel[i] = 0;
+        __gpioEdges[i] = 0;
+    }
+
+    memset(sim_sspTxLog, 0, sizeof(sim_sspTxLog));
+    sim_sspNrFrames = 0;
+    sim_sspNrOverruns = 0;
+    __sspTxHead = 0;
+    __sspTxLen = 0;
+    __sspRxHead = 0;
+    __sspRxLen = 0;
+    __sspOverrun = 0;
+    sim_sspRegs[PL022_SR] = SSP_SR_TFE | SSP_SR_TNF;
+
+    __irqMode = 0;
+}
+
+
+/*
+ * Applies writes to the timers' registers and updates their interrupt status.
+ */
+static void __syncTimers(void)
+{
+    uint8_t t;
+    uint8_t c;
+    uint32_t* r;
+
+    for ( t=0; t<BSP_NR_TIMERS; ++t )
+    {
+        for ( c=0; c<NR_COUNTERS; ++c )
+        {
+            r = &sim_timerRegs[t][SP804_CNTR(c)];
+
+            /* A write to the Load Register immediately reloads the counter */
+            if ( r[SP804_LOAD] != __timerLoad[t][c] )
+            {
+                __timerLoad[t][c] = r[SP804_LOAD];
+                r[SP804_VALUE] = r[SP804_LOAD];
+            }
+
+            /* Any write to the Interrupt Clear Register clears the interrupt */
+            if ( 0 != r[SP804_INTCLR] )
+            {
+                r[SP804_INTCLR] = 0;
+                r[SP804_RIS] = 0;
+            }
+
+            r[SP804_MIS] = ( r[SP804_CONTROL] & TIM_CTL_INTR ? r[SP804_RIS] : 0 );
+        }
+    }
+}
+
+
+/*
+ * Applies writes to the UARTs' registers and updates their interrupt status.
+ */
+static void __syncUarts(void)
+{
+    uint8_t i;
+    uint32_t* r;
+
+    for ( i=0; i<BSP_NR_UARTS; ++i )
+    {
+        r = sim_uartRegs[i];
+
+        r[PL011_RIS] &= ~r[PL011_ICR];
+        r[PL011_ICR] = 0;
+
+        /* Receive interrupts are not latched, they follow the FIFO level */
+        r[PL011_RIS] &= ~(UART_INT_RX | UART_INT_RT);
+        r[PL011_RIS] |= ( __uartRxLen[i] >= __uartRxLevels[(r[PL011_IFLS] >> UART_IFLS_RX_SHIFT) & 0x07] ? UART_INT_RX : 0 );
+        r[PL011_RIS] |= ( __uartRxLen[i] > 0 ? UART_INT_RT : 0 );
+
+        r[PL011_FR] &= ~(UART_FR_RXFE | UART_FR_RXFF);
+        r[PL011_FR] |= ( 0 == __uartRxLen[i] ? UART_FR_RXFE : 0 );
+        r[PL011_FR] |= ( SIM_UART_FIFO_DEPTH == __uartRxLen[i] ? UART_FR_RXFF : 0 );
+
+        r[PL011_MIS] = r[PL011_RIS] & r[PL011_IMSC];
+    }
+}
+
+
+/*
+ * Applies writes to the RTC's registers and updates its interrupt status.
+ */
+static void __syncRtc(void)
+{
+    uint32_t* r = sim_rtcRegs;
+
+    if ( r[PL031_LR] != __rtcLoad )
+    {
+        __rtcLoad = r[PL031_LR];
+        r[PL031_DR] = r[PL031_LR];
+    }
+
+    r[PL031_RIS] &= ~r[PL031_ICR];
+    r[PL031_ICR] = 0;
+    r[PL031_MIS] = r[PL031_RIS] & r[PL031_IMSC];
+}
+
+
+/*
+ * Performs a transfer of an enabled DMA channel, including all its LLIs.
+ * The source and destination widths must be equal (as set by the driver),
+ * otherwise the transfer is aborted with an error.
+ *
+ * @param ch - DMA channel
+ */
+static void __dmaTransfer(uint8_t ch)
+{
+    uint32_t* r = &sim_dmaRegs[PL080_CH(ch)];
+    const uint32_t* lli;
+    uint32_t ctrl;
+    uint32_t n;
+    uint8_t width;
+
+    for ( ; ; )
+    {
+        ctrl = r[PL080_CH_CONTROL];
+        width = DMA_SWIDTH(ctrl);
+
+        if ( width > 2 || width != DMA_DWIDTH(ctrl) || 0 != (r[PL080_CH_LLI] & 0x03) )
+        {
+            sim_dmaRegs[PL080_RAWINTERRSTATUS] |= UL1 << ch;
+            break;  /* out of for */
+        }
+
+        for ( n=ctrl & DMA_BM_SIZE; n>0; --n )
+        {
+            memcpy((void*) (uintptr_t) r[PL080_CH_DST], (const void*) (uintptr_t) r[PL080_CH_SRC], UL1 << width);
+            r[PL080_CH_SRC] += ( ctrl & DMA_CTRL_SI ? UL1 << width : 0 );
+            r[PL080_CH_DST] += ( ctrl & DMA_CTRL_DI ? UL1 << width : 0 );
+        }
+
+        if ( ctrl & DMA_CTRL_TC_INT )
+        {
+            sim_dmaRegs[PL080_RAWINTTCSTATUS] |= UL1 << ch;
+        }
+
+        if ( 0 == r[PL080_CH_LLI] )
+        {
+            break;  /* out of for */
+        }
+
+        /* Load the next LLI */
+        lli = (const uint32_t*) (uintptr_t) r[PL080_CH_LLI];
+        r[PL080_CH_SRC] = lli[0];
+        r[PL080_CH_DST] = lli[1];
+        r[PL080_CH_LLI] = lli[2];
+        r[PL080_CH_CONTROL] = lli[3];
+    }
+
+    /* The channel is disabled when its transfer completes or fails */
+    r[PL080_CH_CONFIG] &= ~DMA_CCFG_ENABLE;
+}
+
+
+/*
+ * Applies writes to the DMA controller's registers, performs transfers
+ * of enabled channels and updates the interrupt status.
+ */
+static void __syncDma(void)
+{
+    uint32_t* r = sim_dmaRegs;
+    uint32_t tc = 0;
+    uint32_t err = 0;
+    uint8_t ch;
+
+    r[PL080_RAWINTTCSTATUS] &= ~r[PL080_INTTCCLEAR];
+    r[PL080_INTTCCLEAR] = 0;
+    r[PL080_RAWINTERRSTATUS] &= ~r[PL080_INTERRCLR];
+    r[PL080_INTERRCLR] = 0;
+
+    for ( ch=0; ch<NR_DMA_CHANNELS; ++ch )
+    {
+        const uint32_t cfg = r[PL080_CH(ch) + PL080_CH_CONFIG];
+
+        if ( 0 != (r[PL080_CONFIG] & DMA_CONFIG_ENABLE) && 0 != (cfg & DMA_CCFG_ENABLE) )
+        {
+            __dmaTransfer(ch);
+        }
+
+        /* The interrupt masks of the channel's configuration apply */
+        tc |= ( cfg & DMA_CCFG_ITC ? r[PL080_RAWINTTCSTATUS] & (UL1 << ch) : 0 );
+        err |= ( cfg & DMA_CCFG_IE ? r[PL080_RAWINTERRSTATUS] & (UL1 << ch) : 0 );
+    }
+
+    r[PL080_INTTCSTATUS] = tc;
+    r[PL080_INTERRSTATUS] = err;
+}
+
+
+/*
+ * Updates the status and interrupts of the KMIs.
+ */
+static void __syncKmis(void)
+{
+    uint8_t i;
+
+    for ( i=0; i<BSP_NR_KMIS; ++i )
+    {
+        uint32_t* r = sim_kmiRegs[i];
+
+        r[PL050_STAT] = KMI_STAT_TXEMPTY | ( __kmiLen[i] > 0 ? KMI_STAT_RXFULL : 0 );
+        r[PL050_IR] = 0;
+
+        if ( r[PL050_CR] & KMI_CR_EN )
+        {
+            r[PL050_IR] |= ( (r[PL050_CR] & KMI_CR_RXINTREN) && __kmiLen[i] > 0 ? KMI_IR_RX : 0 );
+            r[PL050_IR] |= ( r[PL050_CR] & KMI_CR_TXINTREN ? KMI_IR_TX : 0 );
+        }
+    }
+}
+
+
+/*
+ * Updates levels of a GPIO controller's pins and latches their edges
+ * that trigger interrupts.
+ *
+ * @param nr - number of the controller
+ */
+static void __gpioUpdatePins(uint8_t nr)
+{
+    const uint32_t* r = sim_gpioRegs[nr];
+    const uint8_t dir = (uint8_t) r[PL061_DIR];
+    const uint8_t level = (uint8_t) ( (__gpioOut[nr] & dir) | (__gpioExt[nr] & ~dir) );
+    const uint8_t changed = level ^ __gpioLevel[nr];
+    uint8_t edges;
+
+    /* Single edges: rising if IEV is set, falling otherwise */
+    edges = changed & ~( level ^ (uint8_t) r[PL061_IEV] );
+    edges = ( edges & ~(uint8_t) r[PL061_IBE] ) | ( changed & (uint8_t) r[PL061_IBE] );
+
+    __gpioEdges[nr] |= edges & ~(uint8_t) r[PL061_IS];
+    __gpioLevel[nr] = level;
+}
+
+
+/*
+ * Applies writes to the GPIO controllers' registers and updates their
+ * interrupt status.
+ */
+static void __syncGpios(void)
+{
+    uint8_t i;
+
+    for ( i=0; i<BSP_NR_GPIOS; ++i )
+    {
+        uint32_t* r = sim_gpioRegs[i];
+        uint8_t levels;
+
+        /* Only 1-bits of the write only clear register have any effect */
+        __gpioEdges[i] &= ~(uint8_t) r[PL061_IC];
+        r[PL061_IC] = 0;
+
+        /* The direction of pins may have been modified */
+        __gpioUpdatePins(i);
+
+        /* Level triggered pins: high if IEV is set, low otherwise */
+        levels = (uint8_t) ( r[PL061_IS] & ~(__gpioLevel[i] ^ r[PL061_IEV]) );
+
+        r[PL061_RIS] = ( (__gpioEdges[i] & ~r[PL061_IS]) | levels ) & GPIO_ALL_PINS;
+        r[PL061_MIS] = r[PL061_RIS] & r[PL061_IE];
+    }
+}
+
+
+/*
+ * Shifts out all frames of the SSP's transmit FIFO (while it is enabled)
+ * and updates its status and interrupts.
+ */
+static void __syncSsp(void)
+{
+    uint32_t* r = sim_sspRegs;
+    const uint16_t mask = (uint16_t) ( (UL1 << ((r[PL022_CR0] & SSP_BM_DSS) + 1)) - 1 );
+    uint16_t tx;
+    uint16_t rx;
+
+    /* Only 1-bits of the write only clear register have any effect */
+    __sspOverrun &= ~r[PL022_ICR];
+    r[PL022_ICR] = 0;
+
+    while ( (r[PL022_CR1] & SSP_CR1_SSE) && __sspTxLen > 0 )
+    {
+        tx = __sspTxFifo[__sspTxHead] & mask;
+        __sspTxHead = (__sspTxHead + 1) % SSP_FIFO_DEPTH;
+        --__sspTxLen;
+
+        sim_sspTxLog[sim_sspNrFrames % SIM_SSP_LOG_SIZE] = tx;
+        ++sim_sspNrFrames;
+
+        rx = ( r[PL022_CR1] & SSP_CR1_LBM ? tx : (uint16_t) (~tx & mask) );
+
+        if ( __sspRxLen < SSP_FIFO_DEPTH )
+        {
+            __sspRxFifo[(__sspRxHead + __sspRxLen) % SSP_FIFO_DEPTH] = rx;
+            ++__sspRxLen;
+        }
+        else
+        {
+            __sspOverrun = SSP_INT_ROR;
+            ++sim_sspNrOverruns;
+        }
+    }
+
+    r[PL022_SR] = ( 0 == __sspTxLen ? SSP_SR_TFE : 0 ) |
+                  ( __sspTxLen < SSP_FIFO_DEPTH ? SSP_SR_TNF : 0 ) |
+                  ( __sspRxLen > 0 ? SSP_SR_RNE : 0 ) |
+                  ( __sspRxLen == SSP_FIFO_DEPTH ? SSP_SR_RFF : 0 );
+
+    r[PL022_RIS] = __sspOverrun |
+                   ( __sspRxLen > 0 && 0 == __sspTxLen ? SSP_INT_RT : 0 ) |
+                   ( __sspRxLen >= SSP_FIFO_DEPTH / 2 ? SSP_INT_RX : 0 ) |
+                   ( __sspTxLen <= SSP_FIFO_DEPTH / 2 ? SSP_INT_TX : 0 );
+    r[PL022_MIS] = r[PL022_RIS] & r[PL022_IMSC];
+}
+
+
+/*
+ * Applies writes to the SIC's set/clear registers and updates its status.
+ * Must be called after the MMCI and the KMIs have been synchronized.
+ */
+static void __syncSic(void)
+{
+    const uint8_t kmiIrqs[BSP_NR_KMIS] = BSP_KMI_SIC_IRQS;
+    uint32_t* r = sim_sicRegs;
+    uint32_t raw;
+    uint8_t i;
+
+    __sicPassThrough |= r[SIC_PICENABLE];
+    __sicPassThrough &= ~r[SIC_PICENCLR] & SIC_BM_PASS_THROUGH;
+    r[SIC_PICENCLR] = 0;
+    r[SIC_PICENABLE] = __sicPassThrough;
+
+    /* Only 1-bits of the set and clear registers have any effect */
+    __sicEnable |= r[SIC_ENABLE];
+    __sicEnable &= ~r[SIC_ENCLR];
+    r[SIC_ENCLR] = 0;
+    r[SIC_ENABLE] = __sicEnable;
+
+    __sicSoft |= r[SIC_SOFTINTSET];
+    __sicSoft &= ~r[SIC_SOFTINTCLR];
+    r[SIC_SOFTINTCLR] = 0;
+    r[SIC_SOFTINTSET] = __sicSoft;
+
+    raw = __sicSoft;
+
+    if ( sim_mmciRegs[PL181_STATUS] & sim_mmciRegs[PL181_MASK0] )
+    {
+        raw |= UL1 << BSP_MMCI_IRQ;
+    }
+
+    for ( i=0; i<BSP_NR_KMIS; ++i )
+    {
+        if ( sim_kmiRegs[i][PL050_IR] )
+        {
+            raw |= UL1 << kmiIrqs[i];
+        }
+    }
+
+    r[SIC_RAWSTAT] = raw;
+    r[SIC_STATUS] = raw & __sicEnable;
+}
+
+
+/*
+ * Sets a field of the simulated card's CSD register within a long response
+ * (word 0 contains bits 127:96, word 3 bits 31:0).
+ */
+static void __sdSetCsd(uint32_t* csd, uint8_t lsb, uint8_t width, uint32_t val)
+{
+    uint8_t i;
+
+    for ( i=0; i<width; ++i, val >>= 1 )
+    {
+        csd[3 - ((lsb+i) >> 5)] |= (val & UL1) << ((lsb+i) & 0x1F);
+    }
+}
+
+
+/*
+ * @return the card status (R1 response), error bits are cleared afterwards
+ */
+static uint32_t __sdR1(void)
+{
+    uint32_t r1 = __sdErrors | ( (uint32_t) __sdState << 9 );
+
+    if ( SD_STATE_TRAN == __sdState || SD_STATE_RCV == __sdState )
+    {
+        r1 |= SD_R1_READY_FOR_DATA;
+    }
+
+    if ( __sdAppCmd )
+    {
+        r1 |= SD_R1_APP_CMD;
+    }
+
+    __sdErrors = 0;
+
+    return r1;
+}
+
+
+/*
+ * Starts a data transfer of the card at the command's address.
+ *
+ * @return the command's response (SD_RSP_NONE or SD_RSP_SHORT)
+ */
+static int8_t __sdStartData(uint8_t idx, uint32_t arg, uint32_t* resp)
+{
+    uint32_t addr;
+
+    if ( SD_STATE_TRAN != __sdState )
+    {
+        return SD_RSP_NONE;
+    }
+
+    if ( sim_sdHighCapacity )
+    {
+        __sdErrors |= ( arg >= SIM_SD_NR_BLOCKS ? SD_R1_OUT_OF_RANGE : 0 );
+        addr = arg * SIM_SD_BLOCK_SIZE;
+    }
+    else
+    {
+        __sdErrors |= ( arg >= SD_CAPACITY ? SD_R1_OUT_OF_RANGE : 0 );
+        __sdErrors |= ( 0 != (arg % SIM_SD_BLOCK_SIZE) ? SD_R1_ADDRESS_ERROR : 0 );
+        addr = arg;
+    }
+
+    if ( 0 != __sdErrors )
+    {
+        resp[0] = __sdR1();
+        return SD_RSP_SHORT;
+    }
+
+    resp[0] = __sdR1();
+    __sdAddr = addr;
+    __sdMultiple = ( 18 == idx || 25 == idx ? 1 : 0 );
+    __sdState = ( 17 == idx || 18 == idx ? SD_STATE_DATA : SD_STATE_RCV );
+
+    return SD_RSP_SHORT;
+}
+
+
+/*
+ * Executes a command of the simulated SD card.
+ *
+ * @param idx - command index
+ * @param arg - command's argument
+ * @param resp - buffer for the response (4 words)
+ *
+ * @return one of SD_RSP_*
+ */
+static int8_t __sdCommand(uint8_t idx, uint32_t arg, uint32_t* resp)
+{
+    const int8_t app = __sdAppCmd;
+
+    __sdAppCmd = 0;
+    ++sim_sdNrCommands[idx & MMCI_BM_CMD_INDEX];
+    memset(resp, 0, 4 * sizeof(uint32_t));
+
+    if ( 0 == sim_sdInserted )
+    {
+        return SD_RSP_NONE;
+    }
+
+    if ( app && 41 == idx )
+    {
+        if ( SD_STATE_IDLE != __sdState )
+        {
+            return SD_RSP_NONE;
+        }
+
+        /* The card reports its power up as completed at the second poll */
+        resp[0] = SD_OCR;
+        if ( ++__sdOpCondPolls > 1 )
+        {
+            resp[0] |= SD_OCR_BUSY | ( sim_sdHighCapacity && (arg & SD_OCR_CCS) ? SD_OCR_CCS : 0 );
+            __sdState = SD_STATE_READY;
+        }
+
+        return SD_RSP_SHORT;
+    }
+
+    switch ( idx )
+    {
+        case 0:
+            __sdState = SD_STATE_IDLE;
+            __sdOpCondPolls = 0;
+            return SD_RSP_ACCEPTED;
+
+        case 2:
+            if ( SD_STATE_READY != __sdState )
+            {
+                return SD_RSP_NONE;
+            }
+            __sdState = SD_STATE_IDENT;
+            resp[0] = 0x1D414453;   /* manufacturer, "ADS" */
+            resp[1] = 0x494D2020;   /* product name "SIM  " */
+            resp[2] = 0x10000001;   /* revision, serial number */
+            resp[3] = 0x00011001;   /* manufacturing date */
+            return SD_RSP_LONG;
+
+        case 3:
+            if ( SD_STATE_IDENT != __sdState && SD_STATE_STBY != __sdState )
+            {
+                return SD_RSP_NONE;
+            }
+            __sdState = SD_STATE_STBY;
+            resp[0] = ( (uint32_t) SD_RCA << 16 ) | ( (uint32_t) __sdState << 9 );
+            return SD_RSP_SHORT;
+
+        case 7:
+            if ( SD_RCA != (arg >> 16) || SD_STATE_STBY != __sdState )
+            {
+                return SD_RSP_NONE;
+            }
+            resp[0] = __sdR1();
+            __sdState = SD_STATE_TRAN;
+            return SD_RSP_SHORT;
+
+        case 8:
+            if ( SD_STATE_IDLE != __sdState )
+            {
+                return SD_RSP_NONE;
+            }
+            resp[0] = arg & 0x00000FFF;
+            return SD_RSP_SHORT;
+
+        case 9:
+            if ( SD_RCA != (arg >> 16) || SD_STATE_STBY != __sdState )
+            {
+                return SD_RSP_NONE;
+            }
+            __sdSetCsd(resp, 80, 4, 9);            /* READ_BL_LEN: 512 bytes */
+            if ( sim_sdHighCapacity )
+            {
+                /* CSD version 2.0, C_SIZE+1 units of 512 kB */
+                __sdSetCsd(resp, 126, 2, 1);
+                __sdSetCsd(resp, 48, 22, SIM_SD_NR_BLOCKS / 1024 - 1);
+            }
+            else
+            {
+                /* CSD version 1.0, (C_SIZE+1) * 2^(C_SIZE_MULT+2) blocks */
+                __sdSetCsd(resp, 47, 3, 7);
+                __sdSetCsd(resp, 62, 12, SIM_SD_NR_BLOCKS / 512 - 1);
+            }
+            return SD_RSP_LONG;
+
+        case 12:
+            if ( SD_STATE_DATA != __sdState && SD_STATE_RCV != __sdState )
+            {
+                return SD_RSP_NONE;
+            }
+            resp[0] = __sdR1();
+            __sdState = SD_STATE_TRAN;
+            return SD_RSP_SHORT;
+
+        case 13:
+            if ( SD_RCA != (arg >> 16) )
+            {
+                return SD_RSP_NONE;
+            }
+            resp[0] = __sdR1();
+            return SD_RSP_SHORT;
+
+        case 16:
+            if ( SD_STATE_TRAN != __sdState )
+            {
+                return SD_RSP_NONE;
+            }
+            __sdErrors |= ( SIM_SD_BLOCK_SIZE != arg ? SD_R1_BLOCK_LEN_ERROR : 0 );
+            resp[0] = __sdR1();
+            return SD_RSP_SHORT;
+
+        case 17:
+        case 18:
+        case 24:
+        case 25:
+            return __sdStartData(idx, arg, resp);
+
+        case 55:
+            resp[0] = __sdR1() | SD_R1_APP_CMD;
+            __sdAppCmd = 1;
+            return SD_RSP_SHORT;
+
+        default:
+            return SD_RSP_NONE;
+    }
+}
+
+
+/*
+ * Advances the card's address after a byte has been transferred.
+ * A single block transfer ends with the block.
+ */
+static void __sdNextByte(void)
+{
+    ++__sdAddr;
+
+    if ( 0 == (__sdAddr % SIM_SD_BLOCK_SIZE) && 0 == __sdMultiple )
+    {
+        __sdState = SD_STATE_TRAN;
+    }
+}
+
+
+/*
+ * Moves data between the card and the MMCI's FIFO: as long as the FIFO is not
+ * full when reading, and not empty when writing.
+ */
+static void __mmciPump(void)
+{
+    uint32_t* r = sim_mmciRegs;
+    uint32_t w;
+    uint8_t i;
+
+    if ( 0 == __mmciDataActive )
+    {
+        return;
+    }
+
+    /*
+     * An injected error aborts the transfer as soon as the card is ready to
+     * transfer data. The card completes a single block transfer, multiple
+     * block transfers are stopped by CMD12.
+     */
+    if ( 0 != sim_mmciDataErrors && ( SD_STATE_DATA == __sdState || SD_STATE_RCV == __sdState ) )
+    {
+        r[PL181_STATUS] |= sim_mmciDataErrors;
+        r[PL181_DATACTRL] &= ~MMCI_DCTRL_ENABLE;
+        __mmciDataActive = 0;
+        __mmciDataCnt = 0;
+        __mmciFifoLen = 0;
+        __sdState = ( 0 == __sdMultiple ? SD_STATE_TRAN : __sdState );
+        sim_mmciDataErrors = 0;
+        return;
+    }
+
+    if ( r[PL181_DATACTRL] & MMCI_DCTRL_DIRECTION )
+    {
+        while ( __mmciDataCnt > 0 && __mmciFifoLen < MMCI_FIFO_WORDS && SD_STATE_DATA == __sdState )
+        {
+            for ( w=0, i=0; i<4; ++i )
+            {
+                w |= (uint32_t) ( __sdAddr < SD_CAPACITY ? sim_sdData[__sdAddr] : 0 ) << (8*i);
+                __sdNextByte();
+            }
+
+            __mmciFifo[(__mmciFifoHead + __mmciFifoLen) % MMCI_FIFO_WORDS] = w;
+            ++__mmciFifoLen;
+            __mmciDataCnt -= 4;
+        }
+    }
+    else
+    {
+        while ( __mmciDataCnt > 0 && __mmciFifoLen > 0 && SD_STATE_RCV == __sdState )
+        {
+            w = __mmciFifo[__mmciFifoHead];
+            __mmciFifoHead = (__mmciFifoHead + 1) % MMCI_FIFO_WORDS;
+            --__mmciFifoLen;
+
+            for ( i=0; i<4; ++i, w >>= 8 )
+            {
+                if ( __sdAddr < SD_CAPACITY )
+                {
+                    sim_sdData[__sdAddr] = (uint8_t) w;
+                }
+                __sdNextByte();
+            }
+
+            __mmciDataCnt -= 4;
+        }
+    }
+
+    if ( 0 == __mmciDataCnt )
+    {
+        r[PL181_STATUS] |= MMCI_ST_DATA_END | MMCI_ST_BLOCK_END;
+
+        if ( 0 == __mmciFifoLen )
+        {
+            /* The data path becomes idle */
+            __mmciDataActive = 0;
+            r[PL181_DATACTRL] &= ~MMCI_DCTRL_ENABLE;
+        }
+    }
+}
+
+
+/*
+ * Applies writes to the MMCI's registers: executes a command, starts or
+ * aborts a data transfer, moves data and updates the Status Register.
+ */
+static void __syncMmci(void)
+{
+    uint32_t* r = sim_mmciRegs;
+    uint32_t resp[4];
+    uint32_t st;
+    int8_t rsp;
+    uint8_t i;
+
+    r[PL181_STATUS] &= ~(r[PL181_CLEAR] & MMCI_BM_CLEAR);
+    r[PL181_CLEAR] = 0;
+
+    if ( r[PL181_COMMAND] & MMCI_CMD_ENABLE )
+    {
+        r[PL181_COMMAND] &= ~MMCI_CMD_ENABLE;
+        rsp = __sdCommand(r[PL181_COMMAND] & MMCI_BM_CMD_INDEX, r[PL181_ARGUMENT], resp);
+
+        if ( 0 == (r[PL181_COMMAND] & MMCI_CMD_RESPONSE) )
+        {
+            r[PL181_STATUS] |= MMCI_ST_CMD_SENT;
+        }
+        else if ( rsp <= SD_RSP_ACCEPTED )
+        {
+            r[PL181_STATUS] |= MMCI_ST_CMD_TIMEOUT;
+        }
+        else
+        {
+            r[PL181_RESPCMD] = r[PL181_COMMAND] & MMCI_BM_CMD_INDEX;
+            for ( i=0; i<4; ++i )
+            {
+                r[PL181_RESPONSE + i] = resp[i];
+            }
+            r[PL181_STATUS] |= MMCI_ST_CMD_RESP_END;
+        }
+    }
+
+    if ( (r[PL181_DATACTRL] & MMCI_DCTRL_ENABLE) && 0 == __mmciDataActive )
+    {
+        __mmciDataActive = 1;
+        __mmciDataCnt = r[PL181_DATALENGTH];
+        __mmciFifoHead = 0;
+        __mmciFifoLen = 0;
+    }
+    else if ( 0 == (r[PL181_DATACTRL] & MMCI_DCTRL_ENABLE) && 0 != __mmciDataActive )
+    {
+        /* Transfer aborted by the driver */
+        __mmciDataActive = 0;
+        __mmciFifoLen = 0;
+    }
+
+    __mmciPump();
+
+    st = 0;
+    if ( __mmciDataActive && (r[PL181_DATACTRL] & MMCI_DCTRL_DIRECTION) )
+    {
+        st |= MMCI_ST_RX_ACTIVE;
+        st |= ( __mmciFifoLen > 0 ? MMCI_ST_RX_AVLBL : MMCI_ST_RX_EMPTY );
+        st |= ( __mmciFifoLen >= MMCI_FIFO_WORDS / 2 ? MMCI_ST_RX_HALF_FULL : 0 );
+        st |= ( __mmciFifoLen == MMCI_FIFO_WORDS ? MMCI_ST_RX_FULL : 0 );
+    }
+    else if ( __mmciDataActive )
+    {
+        st |= MMCI_ST_TX_ACTIVE;
+        st |= ( __mmciFifoLen > 0 ? MMCI_ST_TX_AVLBL : MMCI_ST_TX_EMPTY );
+        st |= ( __mmciFifoLen <= MMCI_FIFO_WORDS / 2 ? MMCI_ST_TX_HALF_EMPTY : 0 );
+        st |= ( __mmciFifoLen == MMCI_FIFO_WORDS ? MMCI_ST_TX_FULL : 0 );
+    }
+
+    r[PL181_STATUS] = (r[PL181_STATUS] & ~MMCI_BM_ST_FIFO) | st;
+    r[PL181_FIFOCNT] = (__mmciDataCnt + 3) >> 2;
+    r[PL181_DATACNT] = __mmciDataCnt;
+}
+
+
+/*
+ * Applies writes to the CLCD's Interrupt Clear Register and updates
+ * its masked interrupt status.
+ */
+static void __syncClcd(void)
+{
+    uint32_t* r = sim_clcdRegs;
+
+    r[PL110_RIS] &= ~r[PL110_ICR];
+    r[PL110_ICR] = 0;
+    r[PL110_MIS] = r[PL110_RIS] & r[PL110_IMSC];
+}
+
+
+/*
+ * Advances the CLCD's frames (if it is enabled) by the specified number
+ * of timer ticks.
+ *
+ * @param ticks - number of timer clock ticks
+ */
+static void __clcdAdvance(uint32_t ticks)
+{
+    uint32_t* r = sim_clcdRegs;
+
+    if ( 0 == (r[PL110_CONTROL] & CLCD_CTRL_ENABLE) )
+    {
+        __clcdTicks = 0;
+        return;
+    }
+
+    for ( __clcdTicks += ticks; __clcdTicks >= SIM_CLCD_FRAME_US; __clcdTicks -= SIM_CLCD_FRAME_US )
+    {
+        r[PL110_UPCURR] = r[PL110_UPBASE];
+        r[PL110_RIS] |= CLCD_INT_BASE_UPDATE | CLCD_INT_VCOMP;
+        ++sim_clcdNrFrames;
+    }
+}
+
+
+/*
+ * Applies writes to the VIC's registers and updates its status registers
+ * and the vector address of the highest priority active vectored IRQ.
+ *
+ * Must be called after all peripherals have been synchronized.
+ */
+static void __syncVic(void)
+{
+    uint32_t* r = sim_picRegs;
+    uint32_t lines;
+    uint8_t i;
+
+    /* Only 1-bits of the write only clear registers have any effect */
+    r[VIC_INTENABLE] &= ~r[VIC_INTENCLEAR];
+    r[VIC_INTENCLEAR] = 0;
+    r[VIC_SOFTINT] &= ~r[VIC_SOFTINTCLEAR];
+    r[VIC_SOFTINTCLEAR] = 0;
+
+    lines = __extLines;
+    for ( i=0; i<BSP_NR_TIMERS; ++i )
+    {
+        const uint8_t irqs[BSP_NR_TIMERS] = BSP_TIMER_IRQS;
+
+        if ( sim_timerRegs[i][SP804_CNTR(0)+SP804_MIS] || sim_timerRegs[i][SP804_CNTR(1)+SP804_MIS] )
+        {
+            lines |= UL1 << irqs[i];
+        }
+    }
+
+    if ( sim_rtcRegs[PL031_MIS] )
+    {
+        lines |= UL1 << BSP_RTC_IRQ;
+    }
+
+    if ( sim_dmaRegs[PL080_INTTCSTATUS] || sim_dmaRegs[PL080_INTERRSTATUS] )
+    {
+        lines |= UL1 << BSP_DMA_IRQ;
+    }
+
+    if ( sim_clcdRegs[PL110_MIS] )
+    {
+        lines |= UL1 << BSP_CLCD_IRQ;
+    }
+
+    if ( sim_sicRegs[SIC_STATUS] )
+    {
+        lines |= UL1 << BSP_SIC_IRQ;
+    }
+
+    if ( sim_sspRegs[PL022_MIS] )
+    {
+        lines |= UL1 << BSP_SSP_IRQ;
+    }
+
+    {
+        const uint8_t irqs[BSP_NR_GPIOS] = BSP_GPIO_IRQS;
+
+        for ( i=0; i<BSP_NR_GPIOS; ++i )
+        {
+            if ( sim_gpioRegs[i][PL061_MIS] )
+            {
+                lines |= UL1 << irqs[i];
+            }
+        }
+    }
+
+    /* The MMCI is a source of the SIC */
+    if ( (sim_mmciRegs[PL181_STATUS] & sim_mmciRegs[PL181_MASK0]) &&
+         (__sicPassThrough & (UL1 << BSP_MMCI_IRQ)) )
+    {
+        lines |= UL1 << BSP_MMCI_IRQ;
+    }
+
+    {
+        const uint8_t irqs[BSP_NR_UARTS] = BSP_UART_IRQS;
+
+        for ( i=0; i<BSP_NR_UARTS; ++i )
+        {
+            if ( sim_uartRegs[i][PL011_MIS] )
+            {
+                lines |= UL1 << irqs[i];
+            }
+        }
+    }
+
+    r[VIC_RAWINTR] = lines | r[VIC_SOFTINT];
+    r[VIC_IRQSTATUS] = r[VIC_RAWINTR] & r[VIC_INTENABLE] & ~r[VIC_INTSELECT];
+    r[VIC_FIQSTATUS] = r[VIC_RAWINTR] & r[VIC_INTENABLE] & r[VIC_INTSELECT];
+
+    /* Vector slot 0 has the highest priority */
+    r[VIC_VECTADDR] = r[VIC_DEFVECTADDR];
+    for ( i=0; i<NR_VECTORS; ++i )
+    {
+        const uint32_t cntl = r[VIC_VECTCNTLn + i];
+
+        if ( (cntl & VECT_ENABLE) && (r[VIC_IRQSTATUS] & (UL1 << (cntl & BM_VECT_IRQ))) )
+        {
+            r[VIC_VECTADDR] = r[VIC_VECTADDRn + i];
+            break;  /* out of for i */
+        }
+    }
+}
+
+
+/**
+ * Applies side effects of all register writes since the previous call
+ * and updates status registers of all simulated peripherals.
+ */
+void sim_sync(void)
+{
+    __syncTimers();
+    __syncUarts();
+    __syncRtc();
+    __syncDma();
+    __syncMmci();
+    __syncKmis();
+    __syncGpios();
+    __syncSsp();
+    __syncSic();
+    __syncClcd();
+    __syncVic();
+}
+
+
+/**
+ * Sets the level of an interrupt request line of a peripheral
+ * without its own model (e.g. the watchdog).
+ *
+ * @param irq - interrupt request line (between 0 and 31)
+ * @param level - nonzero to assert the line, 0 to deassert it
+ */
+void sim_setIrqLine(uint8_t irq, int8_t level)
+{
+    if ( irq >= 32 )
+    {
+        return;
+    }
+
+    if ( level )
+    {
+        __extLines |= UL1 << irq;
+    }
+    else
+    {
+        __extLines &= ~(UL1 << irq);
+    }
+
+    sim_sync();
+}
+
+
+/**
+ * Advances all enabled timer counters by the specified number of ticks.
+ * The free running counters of the system registers are advanced
+ * accordingly (SYS_24MHZ by 24 per tick), as well as the CLCD's frames.
+ *
+ * When a counter reaches 0, its raw interrupt is set. The next tick reloads
+ * it from the Load Register (periodic mode) or to 0xFFFFFFFF (free running
+ * mode), in one shot mode the counter remains at 0.
+ *
+ * @param ticks - number of timer clock ticks
+ */
+void sim_timerAdvance(uint32_t ticks)
+{
+    uint8_t t;
+    uint8_t c;
+    uint32_t* r;
+    uint32_t left;
+    uint32_t step;
+
+    sim_sync();
+
+    sim_sysRegs[SYS_24MHZ] += ticks * SYS_24MHZ_PER_TICK;
+    __sys100HzTicks += ticks;
+    while ( __sys100HzTicks >= SYS_TICKS_PER_100HZ )
+    {
+        ++sim_sysRegs[SYS_100HZ];
+        __sys100HzTicks -= SYS_TICKS_PER_100HZ;
+    }
+
+    for ( t=0; t<BSP_NR_TIMERS; ++t )
+    {
+        for ( c=0; c<NR_COUNTERS; ++c )
+        {
+            r = &sim_timerRegs[t][SP804_CNTR(c)];
+
+            if ( 0 == (r[SP804_CONTROL] & TIM_CTL_ENABLE) )
+            {
+                continue;
+            }
+
+            left = ticks;
+            while ( left > 0 )
+            {
+                if ( 0 == r[SP804_VALUE] )
+                {
+                    if ( r[SP804_CONTROL] & TIM_CTL_ONESHOT )
+                    {
+                        break;  /* out of while */
+                    }
+
+                    r[SP804_VALUE] = ( r[SP804_CONTROL] & TIM_CTL_MODE ? r[SP804_LOAD] : 0xFFFFFFFF );
+                    --left;
+                    continue;
+                }
+
+                step = ( left < r[SP804_VALUE] ? left : r[SP804_VALUE] );
+                r[SP804_VALUE] -= step;
+                left -= step;
+
+                if ( 0 == r[SP804_VALUE] )
+                {
+                    r[SP804_RIS] = 1;
+                }
+            }
+        }
+    }
+
+    __clcdAdvance(ticks);
+
+    sim_sync();
+}
+
+
+/**
+ * Advances the RTC (if started) by the specified number of seconds.
+ * The raw interrupt is set when the counter matches the Match Register.
+ *
+ * @param seconds - number of seconds
+ */
+void sim_rtcAdvance(uint32_t seconds)
+{
+    sim_sync();
+
+    if ( 0 == (sim_rtcRegs[PL031_CR] & RTC_START) )
+    {
+        return;
+    }
+
+    for ( ; seconds>0; --seconds )
+    {
+        ++sim_rtcRegs[PL031_DR];
+
+        if ( sim_rtcRegs[PL031_DR] == sim_rtcRegs[PL031_MR] )
+        {
+            sim_rtcRegs[PL031_RIS] = RTC_INT;
+        }
+    }
+
+    sim_sync();
+}
+
+
+/**
+ * @return nonzero if the simulated CPU's IRQ mode is enabled, 0 otherwise
+ */
+int8_t sim_isIrqModeEnabled(void)
+{
+    return __irqMode;
+}
+
+
+/**
+ * Simulates the CPU's response to an IRQ exception: if the IRQ mode is
+ * enabled and the VIC signals an IRQ, the IRQ handler is called once.
+ *
+ * @return 1 if the IRQ handler has been called, 0 otherwise
+ */
+uint32_t sim_dispatchIrq(void)
+{
+    sim_sync();
+
+    if ( 0 == __irqMode || 0 == sim_picRegs[VIC_IRQSTATUS] )
+    {
+        return 0;
+    }
+
+    /* As on the real CPU, the IRQ mode is disabled during the handler */
+    __irqMode = 0;
+    _pic_IrqHandler();
+    __irqMode = 1;
+
+    sim_sync();
+
+    return 1;
+}
+
+
+/**
+ * Simulates the CPU's "wait for interrupt" state: the timers are advanced
+ * until the VIC signals an IRQ, regardless of the CPU's IRQ mode (as on
+ * the ARM926EJ-S). The IRQ itself is not handled, see sim_dispatchIrq().
+ *
+ * The function returns immediately if no timer counter is enabled or an IRQ
+ * is already signaled, it gives up after SIM_WFI_MAX_TICKS ticks.
+ */
+void sim_cpu_wfi(void)
+{
+    uint8_t t;
+    uint8_t c;
+    const uint32_t* r;
+    uint32_t step;
+    uint32_t total = 0;
+
+    sim_sync();
+
+    while ( 0 == sim_picRegs[VIC_IRQSTATUS] && total < SIM_WFI_MAX_TICKS )
+    {
+        /* Advance to the nearest expiration of any enabled counter */
+        step = 0;
+        for ( t=0; t<BSP_NR_TIMERS; ++t )
+        {
+            for ( c=0; c<NR_COUNTERS; ++c )
+            {
+                r = &sim_timerRegs[t][SP804_CNTR(c)];
+
+                if ( 0 != (r[SP804_CONTROL] & TIM_CTL_ENABLE) &&
+                     ( 0 == step || ( r[SP804_VALUE] > 0 && r[SP804_VALUE] < step ) ) )
+                {
+                    step = ( r[SP804_VALUE] > 0 ? r[SP804_VALUE] : 1 );
+                }
+            }
+        }
+
+        if ( 0 == step )
+        {
+            break;  /* out of while, nothing would wake the CPU */
+        }
+
+        sim_timerAdvance(step);
+        total += step;
+    }
+}
+
+
+/**
+ * Simulates software interrupts (see swi_handler in exception.c).
+ *
+ * As on the real CPU, a pending IRQ is taken as soon as the IRQ mode
+ * is enabled (see sim_dispatchIrq()).
+ *
+ * @param nr - 0 disables the IRQ mode, 1 enables it, 2 waits for an interrupt (see _cpuload_idleHandler())
+ */
+void sim_cpu_swi(uint32_t nr)
+{
+    int8_t irqMode;
+
+    if ( 2 == nr )
+    {
+        /* As in the Supervisor mode, IRQs are masked within the handler */
+        irqMode = __irqMode;
+        __irqMode = 0;
+        _cpuload_idleHandler();
+        __irqMode = irqMode;
+    }
+    else
+    {
+        __irqMode = ( 0 != nr ? 1 : 0 );
+    }
+
+    if ( __irqMode )
+    {
+        sim_dispatchIrq();
+    }
+}
+
+
+/**
+ * Simulates a read of the MMCI's data FIFO (any address of its range).
+ * 0 is returned if the FIFO is empty.
+ *
+ * @return the oldest word of the FIFO
+ */
+uint32_t sim_mmciFifoRead(void)
+{
+    uint32_t w = 0;
+
+    sim_sync();
+
+    if ( __mmciFifoLen > 0 )
+    {
+        w = __mmciFifo[__mmciFifoHead];
+        __mmciFifoHead = (__mmciFifoHead + 1) % MMCI_FIFO_WORDS;
+        --__mmciFifoLen;
+    }
+
+    sim_sync();
+
+    return w;
+}
+
+
+/**
+ * Simulates a write into the MMCI's data FIFO (any address of its range).
+ * The word is discarded if the FIFO is full.
+ *
+ * @param val - word, written into the FIFO
+ */
+void sim_mmciFifoWrite(uint32_t val)
+{
+    sim_sync();
+
+    if ( __mmciFifoLen < MMCI_FIFO_WORDS )
+    {
+        __mmciFifo[(__mmciFifoHead + __mmciFifoLen) % MMCI_FIFO_WORDS] = val;
+        ++__mmciFifoLen;
+    }
+
+    sim_sync();
+}
+
+
+/*
+ * @return nonzero if the flash's current operation has not completed yet
+ */
+static int8_t __flashBusy(void)
+{
+    return ( (int32_t) (sim_sysRegs[SYS_24MHZ] - __flashBusyUntil) < 0 ? 1 : 0 );
+}
+
+
+/*
+ * Starts the flash's busy period.
+ *
+ * @param us - duration in micro seconds
+ */
+static void __flashSetBusy(uint32_t us)
+{
+    __flashBusyUntil = sim_sysRegs[SYS_24MHZ] + us * SYS_24MHZ_PER_TICK;
+}
+
+
+/*
+ * Executes the confirmed write to buffer command. Programming can only
+ * clear bits.
+ */
+static void __flashProgramBuffer(void)
+{
+    const uint32_t sector = __flashBufOffset / SIM_FLASH_SECTOR_SIZE;
+    uint32_t i;
+
+    ++sim_flashNrBuffers;
+
+    if ( sim_flashLocked & (UL1 << sector) )
+    {
+        __flashStatus |= FLASH_SR_PROGRAM_ERR | FLASH_SR_LOCKED;
+        return;
+    }
+
+    __flashSetBusy(UL1 << SIM_FLASH_BUFFER_LOG2_US);
+
+    if ( 0 != sim_flashFailNext )
+    {
+        __flashStatus |= sim_flashFailNext;
+        sim_flashFailNext = 0;
+        return;
+    }
+
+    for ( i=0; i<__flashBufWords; ++i )
+    {
+        sim_flashData[__flashBufOffset / 4 + i] &= __flashBuf[i];
+    }
+}
+
+
+/*
+ * Executes the confirmed erase command.
+ *
+ * @param offset - offset within the sector
+ */
+static void __flashErase(uint32_t offset)
+{
+    const uint32_t sector = offset / SIM_FLASH_SECTOR_SIZE;
+
+    ++sim_flashNrErases;
+
+    if ( sim_flashLocked & (UL1 << sector) )
+    {
+        __flashStatus |= FLASH_SR_ERASE_ERR | FLASH_SR_LOCKED;
+        return;
+    }
+
+    __flashSetBusy((UL1 << SIM_FLASH_ERASE_LOG2_MS) * 1000);
+
+    if ( 0 != sim_flashFailNext )
+    {
+        __flashStatus |= sim_flashFailNext;
+        sim_flashFailNext = 0;
+        return;
+    }
+
+    memset(&sim_flashData[sector * SIM_FLASH_SECTOR_SIZE / 4], 0xFF, SIM_FLASH_SECTOR_SIZE);
+}
+
+
+/**
+ * Simulates a read of a word of the flash bank. Depending on the read mode,
+ * array data, the status register or the CFI table is returned.
+ *
+ * @param offset - byte offset of the word within the flash
+ *
+ * @return value of the word
+ */
+uint32_t sim_flashRead(uint32_t offset)
+{
+    uint32_t st;
+    uint32_t idx;
+
+    if ( offset >= SIM_FLASH_SIZE )
+    {
+        return 0;
+    }
+
+    switch ( __flashMode )
+    {
+        case FLASH_MODE_ARRAY:
+            return sim_flashData[offset / 4];
+
+        case FLASH_MODE_QUERY:
+            idx = offset / 4;
+            return ( idx >= 0x10 && idx < 0x10 + sizeof(__flashCfi) ? __flashCfi[idx - 0x10] : 0 );
+
+        default:
+            st = __flashStatus & ~FLASH_SR_READY;
+            if ( 0 == __flashBusy() )
+            {
+                st |= FLASH_SR_READY;
+            }
+            return st | (st << 16);
+    }
+}
+
+
+/**
+ * Simulates a write of a word of the flash bank, i.e. a command or data
+ * of a write to buffer command. Commands must be replicated into both
+ * halfwords, no command (except reading the status) may be written while
+ * the device is busy. Violations are counted by sim_flashProtocolErrors.
+ *
+ * @param offset - byte offset of the word within the flash
+ * @param val - value of the word
+ */
+void sim_flashWrite(uint32_t offset, uint32_t val)
+{
+    const uint8_t cmd = (uint8_t) val;
+    const uint8_t mode = __flashMode;
+    const int8_t cmdExpected = ( FLASH_MODE_COUNT != mode && FLASH_MODE_DATA != mode ? 1 : 0 );
+
+    if ( offset >= SIM_FLASH_SIZE || ( cmdExpected && (val >> 16) != (val & 0xFFFF) ) ||
+         ( __flashBusy() && 0x70 != cmd ) )
+    {
+        ++sim_flashProtocolErrors;
+        return;
+    }
+
+    __flashMode = FLASH_MODE_STATUS;
+
+    switch ( mode )
+    {
+        case FLASH_MODE_ERASE:
+            if ( 0xD0 == cmd )
+            {
+                __flashErase(offset);
+            }
+            else
+            {
+                __flashStatus |= FLASH_SR_ERASE_ERR | FLASH_SR_PROGRAM_ERR;
+            }
+            return;
+
+        case FLASH_MODE_LOCK:
+            if ( 0xD0 == cmd )
+            {
+                sim_flashLocked &= ~(UL1 << (offset / SIM_FLASH_SECTOR_SIZE));
+            }
+            else if ( 0x01 == cmd )
+            {
+                sim_flashLocked |= UL1 << (offset / SIM_FLASH_SECTOR_SIZE);
+            }
+            else
+            {
+                __flashStatus |= FLASH_SR_ERASE_ERR | FLASH_SR_PROGRAM_ERR;
+            }
+            return;
+
+        case FLASH_MODE_COUNT:
+            __flashBufWords = val + 1;
+            __flashBufLoaded = 0;
+            __flashBufOffset = offset & ~(SIM_FLASH_BUFFER_SIZE - 1);
+            if ( __flashBufWords > SIM_FLASH_BUFFER_SIZE / 4 )
+            {
+                __flashStatus |= FLASH_SR_ERASE_ERR | FLASH_SR_PROGRAM_ERR;
+                return;
+            }
+            __flashMode = FLASH_MODE_DATA;
+            return;
+
+        case FLASH_MODE_DATA:
+            /* All words must be within the same buffer sized block, in order */
+            if ( 0 == __flashBufLoaded )
+            {
+                __flashBufOffset = offset;
+            }
+
+            if ( offset != __flashBufOffset + 4 * __flashBufLoaded ||
+                 (offset & ~(SIM_FLASH_BUFFER_SIZE - 1)) != (__flashBufOffset & ~(SIM_FLASH_BUFFER_SIZE - 1)) )
+            {
+                ++sim_flashProtocolErrors;
+                __flashStatus |= FLASH_SR_PROGRAM_ERR;
+                return;
+            }
+
+            __flashBuf[__flashBufLoaded++] = val;
+            __flashMode = ( __flashBufLoaded < __flashBufWords ? FLASH_MODE_DATA : FLASH_MODE_CONFIRM );
+            return;
+
+        case FLASH_MODE_CONFIRM:
+            if ( 0xD0 == cmd )
+            {
+                __flashProgramBuffer();
+            }
+            else
+            {
+                __flashStatus |= FLASH_SR_ERASE_ERR | FLASH_SR_PROGRAM_ERR;
+            }
+            return;
+
+        default:
+            break;
+    }
+
+    switch ( cmd )
+    {
+        case 0xFF:
+            __flashMode = FLASH_MODE_ARRAY;
+            break;
+
+        case 0x98:
+            __flashMode = FLASH_MODE_QUERY;
+            break;
+
+        case 0x50:
+            __flashStatus = FLASH_SR_READY;
+            __flashMode = mode;
+            break;
+
+        case 0x20:
+            __flashMode = FLASH_MODE_ERASE;
+            break;
+
+        case 0x60:
+            __flashMode = FLASH_MODE_LOCK;
+            break;
+
+        case 0xE8:
+            /* The write buffer is always available */
+            __flashMode = FLASH_MODE_COUNT;
+            break;
+
+        case 0x70:
+            break;
+
+        default:
+            __flashStatus |= FLASH_SR_ERASE_ERR | FLASH_SR_PROGRAM_ERR;
+            break;
+    }
+}
+
+
+/**
+ * Simulates characters, sent by the device to the UART, which are appended
+ * to its receive FIFO. Characters that do not fit into the FIFO are lost
+ * and the overrun interrupt is raised.
+ *
+ * @param nr - number of the UART
+ * @param bytes - characters to be sent
+ * @param count - number of characters
+ *
+ * @return number of characters, appended to the FIFO
+ */
+uint32_t sim_uartInject(uint8_t nr, const uint8_t* bytes, uint32_t count)
+{
+    uint32_t i;
+
+    if ( nr >= BSP_NR_UARTS )
+    {
+        return 0;
+    }
+
+    sim_sync();
+
+    for ( i=0; i<count && __uartRxLen[nr]<SIM_UART_FIFO_DEPTH; ++i )
+    {
+        __uartRxFifo[nr][(__uartRxHead[nr] + __uartRxLen[nr]) % SIM_UART_FIFO_DEPTH] = bytes[i];
+        ++__uartRxLen[nr];
+    }
+
+    if ( i < count )
+    {
+        sim_uartRegs[nr][PL011_RIS] |= UART_INT_OE;
+    }
+
+    sim_sync();
+
+    return i;
+}
+
+
+/**
+ * Simulates a read of the UART's data register, which pops the oldest
+ * character of the receive FIFO. 0 is returned if it is empty.
+ *
+ * @param nr - number of the UART
+ *
+ * @return the oldest received character
+ */
+uint32_t sim_uartRead(uint8_t nr)
+{
+    uint32_t ch = 0;
+
+    if ( nr >= BSP_NR_UARTS )
+    {
+        return 0;
+    }
+
+    sim_sync();
+
+    if ( __uartRxLen[nr] > 0 )
+    {
+        ch = __uartRxFifo[nr][__uartRxHead[nr]];
+        __uartRxHead[nr] = (__uartRxHead[nr] + 1) % SIM_UART_FIFO_DEPTH;
+        --__uartRxLen[nr];
+    }
+
+    sim_sync();
+
+    return ch;
+}
+
+
+/**
+ * Simulates bytes, sent by the device, connected to a KMI (e.g. scancodes
+ * of a keyboard). Bytes that do not fit into the receive queue are
+ * discarded.
+ *
+ * @param nr - number of the KMI
+ * @param bytes - bytes to be sent
+ * @param count - number of bytes
+ *
+ * @return number of queued bytes
+ */
+uint32_t sim_kmiInject(uint8_t nr, const uint8_t* bytes, uint32_t count)
+{
+    uint32_t i;
+
+    if ( nr >= BSP_NR_KMIS )
+    {
+        return 0;
+    }
+
+    for ( i=0; i<count && __kmiLen[nr]<SIM_KMI_QUEUE_SIZE; ++i )
+    {
+        __kmiQueue[nr][(__kmiHead[nr] + __kmiLen[nr]) % SIM_KMI_QUEUE_SIZE] = bytes[i];
+        ++__kmiLen[nr];
+    }
+
+    sim_sync();
+
+    return i;
+}
+
+
+/**
+ * Simulates a read of the KMI's data register, which removes the
+ * oldest received byte from the queue. 0 is returned if it is empty.
+ *
+ * @param nr - number of the KMI
+ *
+ * @return the oldest received byte
+ */
+uint32_t sim_kmiRead(uint8_t nr)
+{
+    uint32_t b = 0;
+
+    if ( nr >= BSP_NR_KMIS )
+    {
+        return 0;
+    }
+
+    sim_sync();
+
+    if ( __kmiLen[nr] > 0 )
+    {
+        b = __kmiQueue[nr][__kmiHead[nr]];
+        __kmiHead[nr] = (__kmiHead[nr] + 1) % SIM_KMI_QUEUE_SIZE;
+        --__kmiLen[nr];
+    }
+
+    sim_kmiRegs[nr][PL050_DATA] = b;
+    sim_sync();
+
+    return b;
+}
+
+
+/**
+ * Simulates a write into the KMI's data register, i.e. a byte sent to
+ * the device. The device acknowledges it immediately.
+ *
+ * @param nr - number of the KMI
+ * @param val - the written value (only its lowest byte is sent)
+ */
+void sim_kmiWrite(uint8_t nr, uint32_t val)
+{
+    const uint8_t ack = KMI_ACK;
+
+    if ( nr >= BSP_NR_KMIS )
+    {
+        return;
+    }
+
+    sim_kmiTxLast[nr] = (uint8_t) val;
+    ++sim_kmiNrTx[nr];
+
+    sim_kmiInject(nr, &ack, 1);
+}
+
+
+/**
+ * Sets levels of a GPIO controller's pins, driven by the device.
+ * They are only visible on pins, configured as inputs.
+ *
+ * @param nr - number of the controller
+ * @param pins - bit mask of pins to be modified
+ * @param levels - new levels of pins (bit n is the level of pin n)
+ */
+void sim_gpioSetInputs(uint8_t nr, uint8_t pins, uint8_t levels)
+{
+    if ( nr >= BSP_NR_GPIOS )
+    {
+        return;
+    }
+
+    sim_sync();
+    __gpioExt[nr] = (__gpioExt[nr] & ~pins) | (levels & pins);
+    __gpioUpdatePins(nr);
+    sim_sync();
+}
+
+
+/**
+ * @param nr - number of the controller
+ *
+ * @return current levels of all pins of the GPIO controller
+ */
+uint8_t sim_gpioGetPins(uint8_t nr)
+{
+    if ( nr >= BSP_NR_GPIOS )
+    {
+        return 0;
+    }
+
+    sim_sync();
+
+    return __gpioLevel[nr];
+}
+
+
+/**
+ * Simulates a read of the GPIO controller's data register at the
+ * address, masked by 'pins'.
+ *
+ * @param nr - number of the controller
+ * @param pins - bit mask of pins (bits [9:2] of the address)
+ *
+ * @return levels of pins of the mask, other bits are 0
+ */
+uint32_t sim_gpioRead(uint8_t nr, uint8_t pins)
+{
+    if ( nr >= BSP_NR_GPIOS )
+    {
+        return 0;
+    }
+
+    sim_sync();
+    ++sim_gpioNrReads[nr];
+
+    return __gpioLevel[nr] & pins;
+}
+
+
+/**
+ * Simulates a write into the GPIO controller's data register at the
+ * address, masked by 'pins'. Only output pins of the mask are modified.
+ *
+ * @param nr - number of the controller
+ * @param pins - bit mask of pins (bits [9:2] of the address)
+ * @param val - the written value
+ */
+void sim_gpioWrite(uint8_t nr, uint8_t pins, uint32_t val)
+{
+    uint8_t mask;
+
+    if ( nr >= BSP_NR_GPIOS )
+    {
+        return;
+    }
+
+    sim_sync();
+    ++sim_gpioNrWrites[nr];
+
+    mask = pins & (uint8_t) sim_gpioRegs[nr][PL061_DIR];
+    __gpioOut[nr] = (__gpioOut[nr] & ~mask) | ((uint8_t) val & mask);
+    __gpioUpdatePins(nr);
+    sim_sync();
+}
+
+
+/**
+ * Simulates a read of the SSP's data register, which pops the oldest
+ * frame of the receive FIFO. 0 is returned if it is empty.
+ *
+ * @return the oldest received frame
+ */
+uint32_t sim_sspRead(void)
+{
+    uint32_t val = 0;
+
+    sim_sync();
+
+    if ( __sspRxLen > 0 )
+    {
+        val = __sspRxFifo[__sspRxHead];
+        __sspRxHead = (__sspRxHead + 1) % SSP_FIFO_DEPTH;
+        --__sspRxLen;
+    }
+
+    sim_sspRegs[PL022_DR] = val;
+    sim_sync();
+
+    return val;
+}
+
+
+/**
+ * Simulates a write into the SSP's data register, which pushes the frame
+ * into the transmit FIFO. The frame is lost if the FIFO is full.
+ *
+ * @param val - the written frame
+ */
+void sim_sspWrite(uint32_t val)
+{
+    sim_sync();
+
+    if ( __sspTxLen < SSP_FIFO_DEPTH )
+    {
+        __sspTxFifo[(__sspTxHead + __sspTxLen) % SSP_FIFO_DEPTH] = (uint16_t) val;
+        ++__sspTxLen;
+    }
+
+    sim_sync();
+}
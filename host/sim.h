@@ -0,0 +1,321 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of functions that drive behavioral models of simulated
+ * peripherals (system registers, PL190 with the SIC, SP804,
+ * PL011, PL031, PL080, PL181 with a SD card, PL110, PL050, PL061 and PL022)
+ * and of the CPU's IRQ mode.
+ *
+ * Drivers access simulated registers as plain memory, so side effects of
+ * register accesses (e.g. writes to "write only" clear registers) are only
+ * applied when sim_sync() is called. Tests should call it after driver calls
+ * whose effect they check.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <stdint.h>
+
+#include "bsp.h"
+
+
+/* Word offsets of the PL190 registers (see page 3-3 of DDI0181): */
+#define VIC_IRQSTATUS            0
+#define VIC_FIQSTATUS            1
+#define VIC_RAWINTR              2
+#define VIC_INTSELECT            3
+#define VIC_INTENABLE            4
+#define VIC_INTENCLEAR           5
+#define VIC_SOFTINT              6
+#define VIC_SOFTINTCLEAR         7
+#define VIC_VECTADDR            12
+#define VIC_DEFVECTADDR         13
+#define VIC_VECTADDRn           64
+#define VIC_VECTCNTLn          128
+
+/* Word offsets of the SIC registers (see page 4-49 of DUI0225D): */
+#define SIC_STATUS               0
+#define SIC_RAWSTAT              1
+#define SIC_ENABLE               2
+#define SIC_ENCLR                3
+#define SIC_SOFTINTSET           4
+#define SIC_SOFTINTCLR           5
+#define SIC_PICENABLE            8
+#define SIC_PICENCLR             9
+
+/* Word offsets of the SP804 counter registers (see page 3-2 of DDI0271): */
+#define SP804_CNTR(n)          ( 8 * (n) )
+#define SP804_LOAD               0
+#define SP804_VALUE              1
+#define SP804_CONTROL            2
+#define SP804_INTCLR             3
+#define SP804_RIS                4
+#define SP804_MIS                5
+#define SP804_BGLOAD             6
+
+/* Word offsets of the PL011 registers (see page 3-3 of DDI0183): */
+#define PL011_DR                 0
+#define PL011_FR                 6
+#define PL011_LCRH              11
+#define PL011_CR                12
+#define PL011_IFLS              13
+#define PL011_IMSC              14
+#define PL011_RIS               15
+#define PL011_MIS               16
+#define PL011_ICR               17
+
+/* Word offsets of the PL031 registers (see page 3-3 of DDI0224): */
+#define PL031_DR                 0
+#define PL031_MR                 1
+#define PL031_LR                 2
+#define PL031_CR                 3
+#define PL031_IMSC               4
+#define PL031_RIS                5
+#define PL031_MIS                6
+#define PL031_ICR                7
+
+/* Word offsets of the system registers (see section 4.3 of DUI0225D): */
+#define SYS_ID                   0
+#define SYS_SW                   1
+#define SYS_LED                  2
+#define SYS_OSC(n)              ( 3 + (n) )
+#define SYS_LOCK                 8
+#define SYS_100HZ                9
+#define SYS_CLCD                20
+#define SYS_24MHZ               23
+
+/* Word offsets of the PL080 registers (see chapter 3 of DDI0196): */
+#define PL080_INTTCSTATUS        1
+#define PL080_INTTCCLEAR         2
+#define PL080_INTERRSTATUS       3
+#define PL080_INTERRCLR          4
+#define PL080_RAWINTTCSTATUS     5
+#define PL080_RAWINTERRSTATUS    6
+#define PL080_CONFIG            12
+#define PL080_CH(n)             ( 64 + 8*(n) )
+#define PL080_CH_SRC             0
+#define PL080_CH_DST             1
+#define PL080_CH_LLI             2
+#define PL080_CH_CONTROL         3
+#define PL080_CH_CONFIG          4
+
+/* Word offsets of the PL181 registers (see page 3-3 of DDI0172): */
+#define PL181_POWER              0
+#define PL181_CLOCK              1
+#define PL181_ARGUMENT           2
+#define PL181_COMMAND            3
+#define PL181_RESPCMD            4
+#define PL181_RESPONSE           5
+#define PL181_DATATIMER          9
+#define PL181_DATALENGTH        10
+#define PL181_DATACTRL          11
+#define PL181_DATACNT           12
+#define PL181_STATUS            13
+#define PL181_CLEAR             14
+#define PL181_MASK0             15
+#define PL181_MASK1             16
+#define PL181_FIFOCNT           18
+#define PL181_FIFO              32
+
+/* Word offsets of the PL110 registers (the Versatile's layout, see page 3-3 of DDI0161): */
+#define PL110_TIMING(n)         ( n )
+#define PL110_UPBASE             4
+#define PL110_LPBASE             5
+#define PL110_CONTROL            6
+#define PL110_IMSC               7
+#define PL110_RIS                8
+#define PL110_MIS                9
+#define PL110_ICR               10
+#define PL110_UPCURR            11
+
+/* Word offsets of the PL050 registers (see page 3-3 of DDI0143): */
+#define PL050_CR                 0
+#define PL050_STAT               1
+#define PL050_DATA               2
+#define PL050_CLKDIV             3
+#define PL050_IR                 4
+
+/* Word offsets of the PL061 registers (see page 3-3 of DDI0190), the data register spans 256 words: */
+#define PL061_DATA               0
+#define PL061_DIR            0x100
+#define PL061_IS             0x101
+#define PL061_IBE            0x102
+#define PL061_IEV            0x103
+#define PL061_IE             0x104
+#define PL061_RIS            0x105
+#define PL061_MIS            0x106
+#define PL061_IC             0x107
+#define PL061_AFSEL          0x108
+
+/* Word offsets of the PL022 registers (see page 3-3 of DDI0194): */
+#define PL022_CR0                0
+#define PL022_CR1                1
+#define PL022_DR                 2
+#define PL022_SR                 3
+#define PL022_CPSR               4
+#define PL022_IMSC               5
+#define PL022_RIS                6
+#define PL022_MIS                7
+#define PL022_ICR                8
+#define PL022_DMACR              9
+
+/* Bits of the PL181 Status Register that report errors of data transfers: */
+#define PL181_ST_DATA_CRC_FAIL   0x00000002
+#define PL181_ST_DATA_TIMEOUT    0x00000008
+
+
+/* Capacity of the simulated SD card in blocks of 512 bytes (1 MB): */
+#define SIM_SD_NR_BLOCKS        2048
+#define SIM_SD_BLOCK_SIZE       512
+
+/* Contents of the simulated SD card: */
+extern uint8_t sim_sdData[SIM_SD_NR_BLOCKS * SIM_SD_BLOCK_SIZE];
+
+/* Nonzero if the card is inserted (default), set before the card is initialized: */
+extern int8_t sim_sdInserted;
+
+/* Nonzero for a high capacity card (default), 0 for a standard capacity one: */
+extern int8_t sim_sdHighCapacity;
+
+/* Number of commands, received by the card, per command index: */
+extern uint32_t sim_sdNrCommands[64];
+
+/* Error flags (PL181_ST_DATA_*), raised by the next data transfer instead of transferring its data: */
+extern uint32_t sim_mmciDataErrors;
+
+
+/* Geometry and typical times of the simulated flash (its size is SIM_FLASH_SIZE, see sim_bsp.h): */
+#define SIM_FLASH_SIZE_LOG2         19
+#define SIM_FLASH_SECTOR_SIZE       0x00010000
+#define SIM_FLASH_BUFFER_LOG2       6
+#define SIM_FLASH_BUFFER_SIZE       ( 1 << SIM_FLASH_BUFFER_LOG2 )
+#define SIM_FLASH_BUFFER_LOG2_US    8
+#define SIM_FLASH_ERASE_LOG2_MS     5
+
+/* Status register bits of flash errors: */
+#define SIM_FLASH_ERASE_ERR         0x20
+#define SIM_FLASH_PROGRAM_ERR       0x10
+
+/* Bit mask of locked sectors (all of them are locked at reset): */
+extern uint32_t sim_flashLocked;
+
+/* Numbers of erase and write to buffer commands, received by the flash: */
+extern uint32_t sim_flashNrErases;
+extern uint32_t sim_flashNrBuffers;
+
+/* Error bits (SIM_FLASH_*_ERR), reported by the next erase or program instead of performing it: */
+extern uint32_t sim_flashFailNext;
+
+/* Invalid accesses: unreplicated commands, commands while busy, invalid buffer addresses */
+extern uint32_t sim_flashProtocolErrors;
+
+
+/* Period of the simulated display's frames in timer ticks (60 Hz): */
+#define SIM_CLCD_FRAME_US       16667
+
+/* Number of frames, displayed by the simulated CLCD (the base address is loaded at each): */
+extern uint32_t sim_clcdNrFrames;
+
+
+/* Depth of each simulated UART's receive FIFO: */
+#define SIM_UART_FIFO_DEPTH     16
+
+
+/* Capacity of each simulated KMI's receive queue (bytes, sent by the device): */
+#define SIM_KMI_QUEUE_SIZE      256
+
+/* Last byte, written to each KMI (i.e. sent to the device), and number of written bytes: */
+extern uint8_t sim_kmiTxLast[BSP_NR_KMIS];
+extern uint32_t sim_kmiNrTx[BSP_NR_KMIS];
+
+
+/* Number of accesses of each GPIO controller's data register: */
+extern uint32_t sim_gpioNrWrites[BSP_NR_GPIOS];
+extern uint32_t sim_gpioNrReads[BSP_NR_GPIOS];
+
+
+/*
+ * Frames, shifted out by the SSP, and the number of receive overruns.
+ * Unless the loop back mode is enabled, the simulated device responds
+ * to each frame by its complement.
+ */
+#define SIM_SSP_LOG_SIZE        64
+extern uint16_t sim_sspTxLog[SIM_SSP_LOG_SIZE];
+extern uint32_t sim_sspNrFrames;
+extern uint32_t sim_sspNrOverruns;
+
+
+/* Max. number of timer ticks, simulated by sim_cpu_wfi(): */
+#define SIM_WFI_MAX_TICKS       100000000UL
+
+
+void sim_reset(void);
+
+void sim_sync(void);
+
+void sim_setIrqLine(uint8_t irq, int8_t level);
+
+void sim_timerAdvance(uint32_t ticks);
+
+void sim_rtcAdvance(uint32_t seconds);
+
+int8_t sim_isIrqModeEnabled(void);
+
+uint32_t sim_dispatchIrq(void);
+
+void sim_cpu_swi(uint32_t nr);
+
+void sim_cpu_wfi(void);
+
+uint32_t sim_mmciFifoRead(void);
+
+void sim_mmciFifoWrite(uint32_t val);
+
+uint32_t sim_flashRead(uint32_t offset);
+
+void sim_flashWrite(uint32_t offset, uint32_t val);
+
+uint32_t sim_uartInject(uint8_t nr, const uint8_t* bytes, uint32_t count);
+
+uint32_t sim_uartRead(uint8_t nr);
+
+uint32_t sim_kmiInject(uint8_t nr, const uint8_t* bytes, uint32_t count);
+
+uint32_t sim_kmiRead(uint8_t nr);
+
+void sim_kmiWrite(uint8_t nr, uint32_t val);
+
+void sim_gpioSetInputs(uint8_t nr, uint8_t pins, uint8_t levels);
+
+uint8_t sim_gpioGetPins(uint8_t nr);
+
+uint32_t sim_gpioRead(uint8_t nr, uint8_t pins);
+
+void sim_gpioWrite(uint8_t nr, uint8_t pins, uint32_t val);
+
+uint32_t sim_sspRead(void);
+
+void sim_sspWrite(uint32_t val);
+
+#endif  /* _SIM_H_ */
@@ -0,0 +1,116 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Base addresses of simulated peripherals for the host (unit test) build.
+ *
+ * The header is included by bsp.h when BSP_HOST_SIM is defined. It replaces
+ * base addresses of all simulated controllers by addresses of register
+ * blocks in the host's memory (see sim.c). IRQs are not modified.
+ *
+ * Each register block is as large as a PrimeCell's address space (4 kB),
+ * so drivers' register maps fit into it.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _SIM_BSP_H_
+#define _SIM_BSP_H_
+
+#include <stdint.h>
+
+
+/* Number of 32-bit words of each simulated register block: */
+#define SIM_REG_WORDS       1024
+
+
+extern uint32_t sim_sysRegs[SIM_REG_WORDS];
+extern uint32_t sim_picRegs[SIM_REG_WORDS];
+extern uint32_t sim_sicRegs[SIM_REG_WORDS];
+extern uint32_t sim_uartRegs[BSP_NR_UARTS][SIM_REG_WORDS];
+extern uint32_t sim_timerRegs[BSP_NR_TIMERS][SIM_REG_WORDS];
+extern uint32_t sim_rtcRegs[SIM_REG_WORDS];
+extern uint32_t sim_dmaRegs[SIM_REG_WORDS];
+extern uint32_t sim_mmciRegs[SIM_REG_WORDS];
+extern uint32_t sim_clcdRegs[SIM_REG_WORDS];
+extern uint32_t sim_kmiRegs[BSP_NR_KMIS][SIM_REG_WORDS];
+extern uint32_t sim_gpioRegs[BSP_NR_GPIOS][SIM_REG_WORDS];
+extern uint32_t sim_sspRegs[SIM_REG_WORDS];
+
+/* Size of the simulated flash bank in bytes (8 sectors of 64 kB): */
+#define SIM_FLASH_SIZE      0x00080000
+
+extern uint32_t sim_flashData[SIM_FLASH_SIZE / 4];
+
+
+#undef BSP_SYSREG_BASE_ADDRESS
+#define BSP_SYSREG_BASE_ADDRESS     ( sim_sysRegs )
+
+#undef BSP_PIC_BASE_ADDRESS
+#define BSP_PIC_BASE_ADDRESS        ( sim_picRegs )
+
+#undef BSP_SIC_BASE_ADDRESS
+#define BSP_SIC_BASE_ADDRESS        ( sim_sicRegs )
+
+#undef BSP_UART_BASE_ADDRESSES
+#define BSP_UART_BASE_ADDRESSES(CAST) \
+    CAST(sim_uartRegs[0]) \
+    CAST(sim_uartRegs[1]) \
+    CAST(sim_uartRegs[2])
+
+#undef BSP_TIMER_BASE_ADDRESSES
+#define BSP_TIMER_BASE_ADDRESSES(CAST) \
+    CAST(sim_timerRegs[0]) \
+    CAST(sim_timerRegs[1])
+
+#undef BSP_RTC_BASE_ADDRESS
+#define BSP_RTC_BASE_ADDRESS        ( sim_rtcRegs )
+
+#undef BSP_DMA_BASE_ADDRESS
+#define BSP_DMA_BASE_ADDRESS        ( sim_dmaRegs )
+
+#undef BSP_MMCI_BASE_ADDRESS
+#define BSP_MMCI_BASE_ADDRESS       ( sim_mmciRegs )
+
+#undef BSP_KMI_BASE_ADDRESSES
+#define BSP_KMI_BASE_ADDRESSES(CAST) \
+    CAST(sim_kmiRegs[0]) \
+    CAST(sim_kmiRegs[1])
+
+#undef BSP_GPIO_BASE_ADDRESSES
+#define BSP_GPIO_BASE_ADDRESSES(CAST) \
+    CAST(sim_gpioRegs[0]) \
+    CAST(sim_gpioRegs[1]) \
+    CAST(sim_gpioRegs[2]) \
+    CAST(sim_gpioRegs[3])
+
+#undef BSP_SSP_BASE_ADDRESS
+#define BSP_SSP_BASE_ADDRESS        ( sim_sspRegs )
+
+#undef BSP_CLCD_BASE_ADDRESS
+#define BSP_CLCD_BASE_ADDRESS       ( sim_clcdRegs )
+
+#undef BSP_FLASH_BASE_ADDRESS
+#define BSP_FLASH_BASE_ADDRESS      ( sim_flashData )
+
+#undef BSP_FLASH_SIZE
+#define BSP_FLASH_SIZE              SIM_FLASH_SIZE
+
+#endif  /* _SIM_BSP_H_ */
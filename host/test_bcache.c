@@ -0,0 +1,369 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the block cache (bcache.c) on top of the simulated SD card.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bcache.h"
+#include "blk.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+static uint8_t __buf[2 * BCACHE_NR_BUFFERS * BLK_SIZE];
+
+
+/* Value of a byte of the card's initial contents */
+static uint8_t __pattern(uint32_t addr)
+{
+    return (uint8_t) ( (addr >> 9) * 11 + addr * 3 + 5 );
+}
+
+
+/* @return number of bytes of 'buf' that differ from the pattern, starting at 'lba' */
+static uint32_t __cmpPattern(const uint8_t* buf, uint32_t lba, uint32_t count)
+{
+    uint32_t i;
+    uint32_t diff = 0;
+
+    for ( i=0; i<count*BLK_SIZE; ++i )
+    {
+        diff += ( __pattern(lba * BLK_SIZE + i) != buf[i] ? 1 : 0 );
+    }
+
+    return diff;
+}
+
+
+/* @return number of read and write commands, received by the card */
+static uint32_t __nrDevCommands(void)
+{
+    return sim_sdNrCommands[17] + sim_sdNrCommands[18] +
+           sim_sdNrCommands[24] + sim_sdNrCommands[25];
+}
+
+
+/* Initializes the card with the pattern, the block device and the cache */
+static void __init(void)
+{
+    uint32_t i;
+
+    for ( i=0; i<sizeof(sim_sdData); ++i )
+    {
+        sim_sdData[i] = __pattern(i);
+    }
+
+    pic_init();
+    sim_sync();
+    CHECK_EQ(BLK_OK, blk_init(10));
+    bcache_init();
+}
+
+
+static void testInvalidParams(void)
+{
+    pic_init();
+    sim_sync();
+    sim_sdInserted = 0;
+    blk_init(10);
+    bcache_init();
+    CHECK_EQ(BLK_ERR_NODEV, bcache_read(0, __buf, 1));
+
+    sim_sdInserted = 1;
+    __init();
+    CHECK_EQ(BLK_ERR_PARAM, bcache_read(0, NULL, 1));
+    CHECK_EQ(BLK_ERR_PARAM, bcache_read(0, __buf, 0));
+    CHECK_EQ(BLK_ERR_PARAM, bcache_read(SIM_SD_NR_BLOCKS, __buf, 1));
+    CHECK_EQ(BLK_ERR_PARAM, bcache_write(SIM_SD_NR_BLOCKS - 1, __buf, 2));
+    CHECK_EQ(0, __nrDevCommands());
+}
+
+
+static void testHits(void)
+{
+    bcacheStats stats;
+    uint32_t i;
+
+    __init();
+
+    /* repeated reads of the same (metadata) blocks only read them once */
+    for ( i=0; i<10; ++i )
+    {
+        CHECK_EQ(BLK_OK, bcache_read(100, __buf, 1));
+        CHECK_EQ(0, __cmpPattern(__buf, 100, 1));
+        CHECK_EQ(BLK_OK, bcache_read(7, __buf, 2));
+        CHECK_EQ(0, __cmpPattern(__buf, 7, 2));
+    }
+
+    bcache_getStats(&stats);
+    CHECK_EQ(27, stats.hits);
+    CHECK_EQ(3, stats.misses);
+    CHECK_EQ(0, stats.readAhead);
+    CHECK_EQ(2, stats.devReads);
+    CHECK_EQ(2, __nrDevCommands());
+
+    bcache_resetStats();
+    bcache_getStats(&stats);
+    CHECK_EQ(0, stats.hits);
+    CHECK_EQ(0, stats.devReads);
+}
+
+
+static void testLruReplacement(void)
+{
+    bcacheStats stats;
+    uint32_t i;
+
+    __init();
+
+    /* fill the cache, then keep the block 0 recently used */
+    for ( i=0; i<BCACHE_NR_BUFFERS; ++i )
+    {
+        CHECK_EQ(BLK_OK, bcache_read(i * 10, __buf, 1));
+    }
+    CHECK_EQ(BLK_OK, bcache_read(0, __buf, 1));
+
+    /* replaces the block 10, the least recently used one */
+    CHECK_EQ(BLK_OK, bcache_read(1000, __buf, 1));
+    bcache_resetStats();
+
+    CHECK_EQ(BLK_OK, bcache_read(0, __buf, 1));
+    CHECK_EQ(BLK_OK, bcache_read(20, __buf, 1));
+    bcache_getStats(&stats);
+    CHECK_EQ(2, stats.hits);
+
+    CHECK_EQ(BLK_OK, bcache_read(10, __buf, 1));
+    CHECK_EQ(0, __cmpPattern(__buf, 10, 1));
+    bcache_getStats(&stats);
+    CHECK_EQ(1, stats.misses);
+}
+
+
+static void testReadAhead(void)
+{
+    bcacheStats stats;
+    uint32_t i;
+
+    __init();
+
+    /* the first request is not sequential */
+    CHECK_EQ(BLK_OK, bcache_read(200, __buf, 2));
+    bcache_getStats(&stats);
+    CHECK_EQ(0, stats.readAhead);
+
+    /* the second one continues it, following blocks are read by the same command */
+    CHECK_EQ(BLK_OK, bcache_read(202, __buf, 2));
+    CHECK_EQ(0, __cmpPattern(__buf, 202, 2));
+    bcache_getStats(&stats);
+    CHECK_EQ(BCACHE_READ_AHEAD, stats.readAhead);
+    CHECK_EQ(2, stats.devReads);
+    CHECK_EQ(2, sim_sdNrCommands[18]);
+
+    /* so the following sequential requests hit */
+    for ( i=204; i<204+BCACHE_READ_AHEAD; ++i )
+    {
+        CHECK_EQ(BLK_OK, bcache_read(i, __buf, 1));
+        CHECK_EQ(0, __cmpPattern(__buf, i, 1));
+    }
+    bcache_getStats(&stats);
+    CHECK_EQ(BCACHE_READ_AHEAD, stats.hits);
+    CHECK_EQ(2, stats.devReads);
+
+    /* no read-ahead beyond the device's end */
+    CHECK_EQ(BLK_OK, bcache_read(SIM_SD_NR_BLOCKS - 3, __buf, 1));
+    CHECK_EQ(BLK_OK, bcache_read(SIM_SD_NR_BLOCKS - 2, __buf, 1));
+    bcache_getStats(&stats);
+    CHECK_EQ(BCACHE_READ_AHEAD + 1, stats.readAhead);
+}
+
+
+static void testLargeRead(void)
+{
+    bcacheStats stats;
+
+    __init();
+
+    /* more blocks than buffers, transferred in runs of max. BCACHE_MAX_RUN blocks */
+    CHECK_EQ(BLK_OK, bcache_read(300, __buf, 2 * BCACHE_NR_BUFFERS));
+    CHECK_EQ(0, __cmpPattern(__buf, 300, 2 * BCACHE_NR_BUFFERS));
+    bcache_getStats(&stats);
+    CHECK_EQ(2 * BCACHE_NR_BUFFERS, stats.misses);
+    CHECK_EQ(2 * BCACHE_NR_BUFFERS / BCACHE_MAX_RUN, stats.devReads);
+}
+
+
+static void testWriteBack(void)
+{
+    bcacheStats stats;
+    uint32_t i;
+
+    __init();
+
+    for ( i=0; i<3*BLK_SIZE; ++i )
+    {
+        __buf[i] = (uint8_t) (i ^ 0xA5);
+    }
+
+    /* small writes remain in the cache */
+    for ( i=0; i<5; ++i )
+    {
+        CHECK_EQ(BLK_OK, bcache_write(50, __buf, 3));
+    }
+    CHECK_EQ(BLK_OK, bcache_write(60, __buf, 1));
+    CHECK_EQ(4, bcache_getNrDirty());
+    CHECK_EQ(0, __nrDevCommands());
+    CHECK_EQ(0, __cmpPattern(&sim_sdData[50 * BLK_SIZE], 50, 3));
+
+    /* written blocks are read from the cache */
+    CHECK_EQ(BLK_OK, bcache_read(51, __buf + 3*BLK_SIZE, 1));
+    CHECK_EQ(0, __nrDevCommands());
+    CHECK_EQ((uint8_t) (BLK_SIZE ^ 0xA5), __buf[3*BLK_SIZE]);
+
+    /* not yet old enough */
+    sim_timerAdvance(BCACHE_WRITEBACK_MS * 1000 / 2);
+    CHECK_EQ(BLK_OK, bcache_poll());
+    CHECK_EQ(4, bcache_getNrDirty());
+
+    /* consecutive blocks are written by a single command */
+    sim_timerAdvance(BCACHE_WRITEBACK_MS * 1000);
+    CHECK_EQ(BLK_OK, bcache_poll());
+    CHECK_EQ(0, bcache_getNrDirty());
+    CHECK_EQ(1, sim_sdNrCommands[25]);
+    CHECK_EQ(1, sim_sdNrCommands[24]);
+    for ( i=0; i<3*BLK_SIZE; ++i )
+    {
+        CHECK_EQ((uint8_t) (i ^ 0xA5), sim_sdData[50 * BLK_SIZE + i]);
+    }
+    CHECK_EQ(0xA5, sim_sdData[60 * BLK_SIZE]);
+
+    bcache_getStats(&stats);
+    CHECK_EQ(4, stats.writeBacks);
+    CHECK_EQ(2, stats.devWrites);
+
+    /* nothing to do */
+    CHECK_EQ(BLK_OK, bcache_poll());
+    CHECK_EQ(BLK_OK, bcache_flush());
+    CHECK_EQ(2, __nrDevCommands());
+}
+
+
+static void testEvictDirty(void)
+{
+    uint32_t i;
+
+    __init();
+
+    for ( i=0; i<BLK_SIZE; ++i )
+    {
+        __buf[i] = 0x3C;
+    }
+
+    CHECK_EQ(BLK_OK, bcache_write(5, __buf, 1));
+
+    /* the dirty block is written back when its buffer is reused */
+    CHECK_EQ(BLK_OK, bcache_read(500, __buf + BLK_SIZE, BCACHE_NR_BUFFERS));
+    CHECK_EQ(0, bcache_getNrDirty());
+    CHECK_EQ(1, sim_sdNrCommands[24]);
+    CHECK_EQ(0x3C, sim_sdData[5 * BLK_SIZE]);
+    CHECK_EQ(0x3C, sim_sdData[6 * BLK_SIZE - 1]);
+}
+
+
+static void testFlushInvalidate(void)
+{
+    bcacheStats stats;
+    uint32_t i;
+
+    __init();
+
+    for ( i=0; i<BLK_SIZE; ++i )
+    {
+        __buf[i] = 0x77;
+    }
+
+    /* written out of order, flushed in ascending order by 2 commands */
+    CHECK_EQ(BLK_OK, bcache_write(12, __buf, 1));
+    CHECK_EQ(BLK_OK, bcache_write(10, __buf, 1));
+    CHECK_EQ(BLK_OK, bcache_write(11, __buf, 1));
+    CHECK_EQ(BLK_OK, bcache_write(30, __buf, 1));
+    CHECK_EQ(BLK_OK, bcache_flush());
+    CHECK_EQ(0, bcache_getNrDirty());
+    CHECK_EQ(1, sim_sdNrCommands[25]);
+    CHECK_EQ(1, sim_sdNrCommands[24]);
+    CHECK_EQ(0x77, sim_sdData[10 * BLK_SIZE]);
+    CHECK_EQ(0x77, sim_sdData[13 * BLK_SIZE - 1]);
+    CHECK_EQ(__pattern(13 * BLK_SIZE), sim_sdData[13 * BLK_SIZE]);
+
+    /* after the invalidation, blocks are read from the device again */
+    CHECK_EQ(BLK_OK, bcache_write(40, __buf, 1));
+    CHECK_EQ(BLK_OK, bcache_invalidate());
+    CHECK_EQ(0x77, sim_sdData[40 * BLK_SIZE]);
+    sim_sdData[10 * BLK_SIZE] = 0x12;
+    CHECK_EQ(BLK_OK, bcache_read(10, __buf, 1));
+    CHECK_EQ(0x12, __buf[0]);
+
+    /* statistics are preserved */
+    bcache_getStats(&stats);
+    CHECK_EQ(5, stats.writeBacks);
+    CHECK_EQ(1, stats.misses);
+}
+
+
+static void testDeviceError(void)
+{
+    __init();
+
+    sim_mmciDataErrors = PL181_ST_DATA_CRC_FAIL;
+    CHECK_EQ(BLK_ERR_IO, bcache_read(3, __buf, 1));
+
+    /* the failed block was not cached */
+    CHECK_EQ(BLK_OK, bcache_read(3, __buf, 1));
+    CHECK_EQ(0, __cmpPattern(__buf, 3, 1));
+
+    /* a failed write-back keeps the block dirty */
+    CHECK_EQ(BLK_OK, bcache_write(8, __buf, 1));
+    sim_mmciDataErrors = PL181_ST_DATA_CRC_FAIL;
+    CHECK_EQ(BLK_ERR_IO, bcache_flush());
+    CHECK_EQ(1, bcache_getNrDirty());
+    CHECK_EQ(BLK_OK, bcache_flush());
+    CHECK_EQ(0, bcache_getNrDirty());
+    CHECK_EQ(0, __cmpPattern(&sim_sdData[8 * BLK_SIZE], 3, 1));
+}
+
+
+void test_bcache(void)
+{
+    RUN_TEST(testInvalidParams);
+    RUN_TEST(testHits);
+    RUN_TEST(testLruReplacement);
+    RUN_TEST(testReadAhead);
+    RUN_TEST(testLargeRead);
+    RUN_TEST(testWriteBack);
+    RUN_TEST(testEvictDirty);
+    RUN_TEST(testFlushInvalidate);
+    RUN_TEST(testDeviceError);
+}
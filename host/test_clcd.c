@@ -0,0 +1,461 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the PL110 CLCD driver (clcd.c).
+ *
+ * Framebuffers are static, so their addresses fit into the controllers'
+ * 32-bit registers (the test executable is linked at a low address).
+ * Drawing functions are checked pixel by pixel against straightforward
+ * reference implementations.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "clcd.h"
+#include "dma.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define VGA_WIDTH      640
+#define VGA_HEIGHT     480
+#define VGA_PIXELS     ( VGA_WIDTH * VGA_HEIGHT )
+#define QVGA_WIDTH     320
+#define QVGA_HEIGHT    240
+
+static uint16_t __fb0[VGA_PIXELS] __attribute__((aligned(8)));
+static uint16_t __fb1[VGA_PIXELS] __attribute__((aligned(8)));
+static uint16_t __ref[VGA_PIXELS];
+static uint16_t __before[VGA_PIXELS];
+
+static uint32_t __nrCalls;
+static int8_t __status;
+static void* __param;
+
+static void __callback(int8_t status, void* param)
+{
+    ++__nrCalls;
+    __status = status;
+    __param = param;
+}
+
+
+/* Initializes the interrupt controller and the CLCD */
+static void __init(uint8_t mode, int8_t doubleBuffered)
+{
+    pic_init();
+    sim_sync();
+    CHECK_EQ(CLCD_OK, clcd_init(mode, __fb0, ( doubleBuffered ? __fb1 : NULL ), 5));
+    sim_sync();
+
+    __nrCalls = 0;
+    __status = 1;
+    __param = NULL;
+}
+
+
+/* Fills 'n' pixels with a pattern, different for each 'seed' */
+static void __pattern(uint16_t* p, uint32_t n, uint32_t seed)
+{
+    uint32_t i;
+
+    for ( i=0; i<n; ++i )
+    {
+        p[i] = (uint16_t) ((i + seed) * 2654435761UL >> 9);
+    }
+}
+
+
+/* Reference implementation of clcd_blit(), reads pixels from 'src' */
+static void __refBlit(uint16_t* dst, uint16_t dw, uint16_t dh, uint16_t dx, uint16_t dy,
+                      const uint16_t* src, uint16_t sw, uint16_t sh, uint16_t sx, uint16_t sy,
+                      uint16_t w, uint16_t h)
+{
+    uint32_t x;
+    uint32_t y;
+
+    for ( y=0; y<h; ++y )
+    {
+        for ( x=0; x<w; ++x )
+        {
+            if ( dx+x < dw && dy+y < dh && sx+x < sw && sy+y < sh )
+            {
+                dst[(dy+y)*dw + dx+x] = src[(sy+y)*sw + sx+x];
+            }
+        }
+    }
+}
+
+
+/* Number of pixels that differ */
+static uint32_t __nrDiffs(const uint16_t* a, const uint16_t* b, uint32_t n)
+{
+    uint32_t i;
+    uint32_t diffs = 0;
+
+    for ( i=0; i<n; ++i )
+    {
+        diffs += ( a[i] != b[i] ? 1 : 0 );
+    }
+
+    return diffs;
+}
+
+
+static void testInit(void)
+{
+    const clcdSurface* front;
+    uint32_t i;
+
+    pic_init();
+    sim_sync();
+
+    /* Invalid modes or buffers */
+    CHECK_EQ(CLCD_ERR_PARAM, clcd_init(CLCD_NR_MODES, __fb0, NULL, 5));
+    CHECK_EQ(CLCD_ERR_PARAM, clcd_init(CLCD_MODE_VGA, NULL, __fb1, 5));
+    CHECK_EQ(CLCD_ERR_PARAM, clcd_init(CLCD_MODE_VGA, __fb0 + 1, NULL, 5));
+    CHECK_EQ(CLCD_ERR_PARAM, clcd_init(CLCD_MODE_VGA, __fb0, __fb1 + 2, 5));
+
+    memset(__fb0, 0xFF, sizeof(__fb0));
+    __init(CLCD_MODE_VGA, 0);
+
+    /* OSC4 at 25.17 MHz, the oscillators are locked again */
+    CHECK_EQ(0x000258B9, sim_sysRegs[SYS_OSC(4)]);
+    CHECK_EQ(0, sim_sysRegs[SYS_LOCK]);
+
+    /* RGB 5:6:5, blue at LSB, the display's I/O and power are switched on */
+    CHECK_EQ(0x00000017, sim_sysRegs[SYS_CLCD]);
+
+    CHECK_EQ((39UL << 24) | (23UL << 16) | (95UL << 8) | (39UL << 2), sim_clcdRegs[PL110_TIMING(0)]);
+    CHECK_EQ((32UL << 24) | (11UL << 16) | (1UL << 10) | 479UL, sim_clcdRegs[PL110_TIMING(1)]);
+    CHECK_EQ(0x04000000UL | (639UL << 16) | 0x1800UL, sim_clcdRegs[PL110_TIMING(2)]);
+    CHECK_EQ((uint32_t) __fb0, sim_clcdRegs[PL110_UPBASE]);
+
+    /* Enabled and powered, TFT, 16 bpp */
+    CHECK_EQ(0x00000829, sim_clcdRegs[PL110_CONTROL]);
+    CHECK_EQ(0, sim_clcdRegs[PL110_IMSC]);
+    CHECK( 0 != (sim_picRegs[VIC_INTENABLE] & (1UL << BSP_CLCD_IRQ)) );
+
+    /* The buffer is cleared */
+    for ( i=0; i<VGA_PIXELS && 0==__fb0[i]; ++i );
+    CHECK_EQ(VGA_PIXELS, i);
+
+    /* A single buffer is both the front and the back buffer */
+    front = clcd_getFront();
+    CHECK(NULL != front);
+    CHECK(__fb0 == front->pixels);
+    CHECK_EQ(VGA_WIDTH, front->width);
+    CHECK_EQ(VGA_HEIGHT, front->height);
+    CHECK(front == clcd_getBack());
+
+    CHECK_EQ(CLCD_OK, clcd_swap());
+    CHECK_EQ(0, clcd_isSwapPending());
+    clcd_waitSwap();
+
+    clcd_disable();
+    sim_sync();
+    CHECK_EQ(0, sim_clcdRegs[PL110_CONTROL] & 0x801);
+    CHECK( 0 == (sim_picRegs[VIC_INTENABLE] & (1UL << BSP_CLCD_IRQ)) );
+}
+
+
+static void testFillRect(void)
+{
+    /* x, y, w, h, partially or completely outside of the surface, both alignments */
+    static const uint16_t rects[][4] =
+    {
+        { 1, 1, 5, 3 }, { 2, 10, 7, 4 }, { 3, 20, 16, 2 }, { 0, 30, 1, 1 },
+        { 5, 40, 33, 9 }, { 300, 230, 50, 50 }, { 319, 0, 1, 240 },
+        { 0, 0, 320, 1 }, { 400, 0, 5, 5 }, { 0, 300, 5, 5 }, { 17, 60, 0, 10 }
+    };
+    clcdSurface* s;
+    uint32_t i;
+    uint32_t x;
+    uint32_t y;
+
+    __init(CLCD_MODE_QVGA, 0);
+    s = clcd_getBack();
+    CHECK_EQ(QVGA_WIDTH, s->width);
+    CHECK_EQ(QVGA_HEIGHT, s->height);
+
+    __pattern(s->pixels, QVGA_WIDTH * QVGA_HEIGHT, 0);
+    memcpy(__ref, s->pixels, QVGA_WIDTH * QVGA_HEIGHT * 2);
+
+    for ( i=0; i<sizeof(rects)/sizeof(rects[0]); ++i )
+    {
+        const uint16_t color = (uint16_t) (0x1234 * (i + 1));
+
+        CHECK_EQ(CLCD_OK, clcd_fillRect(s, rects[i][0], rects[i][1], rects[i][2], rects[i][3], color));
+
+        for ( y=rects[i][1]; y<(uint32_t) rects[i][1]+rects[i][3] && y<QVGA_HEIGHT; ++y )
+        {
+            for ( x=rects[i][0]; x<(uint32_t) rects[i][0]+rects[i][2] && x<QVGA_WIDTH; ++x )
+            {
+                __ref[y*QVGA_WIDTH + x] = color;
+            }
+        }
+
+        CHECK_EQ(0, __nrDiffs(__ref, s->pixels, QVGA_WIDTH * QVGA_HEIGHT));
+    }
+
+    CHECK_EQ(CLCD_ERR_PARAM, clcd_fillRect(NULL, 0, 0, 1, 1, 0));
+}
+
+
+static void testBlit(void)
+{
+    /* dx, dy, sx, sy, w, h; rows of the source are 37 pixels, so their alignment alternates */
+    static const uint16_t blits[][6] =
+    {
+        { 4, 4, 0, 0, 37, 20 }, { 5, 30, 0, 0, 37, 20 }, { 6, 60, 1, 0, 10, 5 },
+        { 7, 90, 2, 3, 30, 10 }, { 8, 110, 0, 1, 36, 19 }, { 310, 235, 0, 0, 37, 20 },
+        { 100, 100, 30, 15, 100, 100 }, { 0, 0, 40, 0, 5, 5 }
+    };
+    static uint16_t srcPixels[37 * 20];
+    clcdSurface src = { srcPixels, 37, 20 };
+    clcdSurface* dst;
+    uint32_t i;
+
+    __init(CLCD_MODE_QVGA, 0);
+    dst = clcd_getBack();
+
+    __pattern(srcPixels, 37 * 20, 1000);
+    __pattern(dst->pixels, QVGA_WIDTH * QVGA_HEIGHT, 0);
+    memcpy(__ref, dst->pixels, QVGA_WIDTH * QVGA_HEIGHT * 2);
+
+    for ( i=0; i<sizeof(blits)/sizeof(blits[0]); ++i )
+    {
+        const uint16_t* b = blits[i];
+
+        CHECK_EQ(CLCD_OK, clcd_blit(dst, b[0], b[1], &src, b[2], b[3], b[4], b[5]));
+        __refBlit(__ref, QVGA_WIDTH, QVGA_HEIGHT, b[0], b[1], srcPixels, 37, 20, b[2], b[3], b[4], b[5]);
+        CHECK_EQ(0, __nrDiffs(__ref, dst->pixels, QVGA_WIDTH * QVGA_HEIGHT));
+    }
+
+    /* and back into the source */
+    __pattern(__ref, 37 * 20, 1000);
+    CHECK_EQ(CLCD_OK, clcd_blit(&src, 3, 2, dst, 50, 50, 20, 10));
+    __refBlit(__ref, 37, 20, 3, 2, dst->pixels, QVGA_WIDTH, QVGA_HEIGHT, 50, 50, 20, 10);
+    CHECK_EQ(0, __nrDiffs(__ref, srcPixels, 37 * 20));
+
+    CHECK_EQ(CLCD_ERR_PARAM, clcd_blit(dst, 0, 0, NULL, 0, 0, 1, 1));
+    CHECK_EQ(CLCD_ERR_PARAM, clcd_blit(NULL, 0, 0, &src, 0, 0, 1, 1));
+}
+
+
+static void testBlitOverlap(void)
+{
+    /* dx, dy, sx, sy, w, h: scrolling in all directions */
+    static const uint16_t blits[][6] =
+    {
+        { 0, 0, 0, 10, 320, 230 }, { 0, 10, 0, 0, 320, 230 }, { 5, 3, 2, 3, 100, 50 },
+        { 2, 3, 5, 3, 100, 50 }, { 11, 12, 10, 10, 50, 50 }, { 10, 10, 11, 12, 50, 50 },
+        { 1, 100, 0, 100, 319, 1 }
+    };
+    clcdSurface* s;
+    uint32_t i;
+
+    __init(CLCD_MODE_QVGA, 0);
+    s = clcd_getBack();
+
+    for ( i=0; i<sizeof(blits)/sizeof(blits[0]); ++i )
+    {
+        const uint16_t* b = blits[i];
+
+        __pattern(s->pixels, QVGA_WIDTH * QVGA_HEIGHT, i);
+        memcpy(__before, s->pixels, QVGA_WIDTH * QVGA_HEIGHT * 2);
+        memcpy(__ref, s->pixels, QVGA_WIDTH * QVGA_HEIGHT * 2);
+
+        CHECK_EQ(CLCD_OK, clcd_blit(s, b[0], b[1], s, b[2], b[3], b[4], b[5]));
+        __refBlit(__ref, QVGA_WIDTH, QVGA_HEIGHT, b[0], b[1], __before, QVGA_WIDTH, QVGA_HEIGHT, b[2], b[3], b[4], b[5]);
+        CHECK_EQ(0, __nrDiffs(__ref, s->pixels, QVGA_WIDTH * QVGA_HEIGHT));
+    }
+}
+
+
+static void testSwap(void)
+{
+    const clcdSurface* front;
+    clcdSurface* back;
+
+    __init(CLCD_MODE_QVGA, 1);
+    irq_enableIrqMode();
+
+    front = clcd_getFront();
+    back = clcd_getBack();
+    CHECK(__fb0 == front->pixels);
+    CHECK(__fb1 == back->pixels);
+    CHECK_EQ(0, clcd_getNrSwaps());
+
+    CHECK_EQ(CLCD_OK, clcd_swap());
+    CHECK_EQ(1, clcd_isSwapPending());
+    CHECK_EQ(CLCD_ERR_BUSY, clcd_swap());
+    CHECK_EQ((uint32_t) __fb1, sim_clcdRegs[PL110_UPBASE]);
+
+    /* Nothing happens until the next frame */
+    CHECK_EQ(0, sim_dispatchIrq());
+    sim_timerAdvance(SIM_CLCD_FRAME_US - 1);
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK(__fb0 == clcd_getFront()->pixels);
+
+    sim_timerAdvance(1);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(0, clcd_isSwapPending());
+    CHECK_EQ(1, clcd_getNrSwaps());
+    CHECK(__fb1 == clcd_getFront()->pixels);
+    CHECK(__fb0 == clcd_getBack()->pixels);
+    CHECK_EQ((uint32_t) __fb1, sim_clcdRegs[PL110_UPCURR]);
+
+    /* No interrupts without a pending swap */
+    CHECK_EQ(0, sim_clcdRegs[PL110_IMSC]);
+    sim_timerAdvance(2 * SIM_CLCD_FRAME_US);
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    /* A base update before the swap (raw status is set by the frames above) does not complete it */
+    CHECK( 0 != (sim_clcdRegs[PL110_RIS] & 0x04) );
+    CHECK_EQ(CLCD_OK, clcd_swap());
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(1, clcd_isSwapPending());
+
+    sim_timerAdvance(SIM_CLCD_FRAME_US);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(0, clcd_isSwapPending());
+    CHECK_EQ(2, clcd_getNrSwaps());
+    CHECK(__fb0 == clcd_getFront()->pixels);
+    CHECK_EQ((uint32_t) __fb0, sim_clcdRegs[PL110_UPCURR]);
+}
+
+
+static void testWaitSwap(void)
+{
+    uint32_t frames;
+
+    __init(CLCD_MODE_QVGA, 1);
+
+    /* The IRQ mode is disabled, so the interrupt status is polled */
+    frames = sim_clcdNrFrames;
+    CHECK_EQ(CLCD_OK, clcd_swap());
+    clcd_waitSwap();
+    CHECK_EQ(0, clcd_isSwapPending());
+    CHECK_EQ(1, sim_clcdNrFrames - frames);
+    CHECK(__fb1 == clcd_getFront()->pixels);
+    CHECK_EQ((uint32_t) __fb1, sim_clcdRegs[PL110_UPCURR]);
+
+    /* Nothing to wait for */
+    frames = sim_clcdNrFrames;
+    clcd_waitSwap();
+    CHECK_EQ(0, sim_clcdNrFrames - frames);
+}
+
+
+/* Waits until the asynchronous copy completes, DMA interrupts are serviced meanwhile */
+static void __waitBlit(void)
+{
+    uint32_t i;
+
+    for ( i=0; i<100 && 0!=clcd_isBlitBusy(); ++i )
+    {
+        sim_dispatchIrq();
+    }
+
+    CHECK_EQ(0, clcd_isBlitBusy());
+}
+
+
+static void testBlitAsync(void)
+{
+    clcdSurface front = { __fb0, VGA_WIDTH, VGA_HEIGHT };
+    clcdSurface* back;
+    int8_t ch[8];
+    uint8_t i;
+
+    __init(CLCD_MODE_VGA, 1);
+    CHECK_EQ(0, dma_init(10));
+    sim_sync();
+    irq_enableIrqMode();
+    back = clcd_getBack();
+
+    /* The whole buffer is copied by several transfers */
+    __pattern(back->pixels, VGA_PIXELS, 7);
+    CHECK_EQ(CLCD_OK, clcd_blitAsync(&front, 0, 0, back, 0, 0, VGA_WIDTH, VGA_HEIGHT, &__callback, &front));
+    CHECK_EQ(1, clcd_isBlitBusy());
+    CHECK_EQ(CLCD_ERR_BUSY, clcd_blitAsync(&front, 0, 0, back, 0, 0, 1, 1, &__callback, NULL));
+    __waitBlit();
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(CLCD_OK, __status);
+    CHECK(&front == __param);
+    CHECK_EQ(0, __nrDiffs(__fb0, __fb1, VGA_PIXELS));
+
+    /* A rectangle, row by row, with differently aligned rows */
+    __pattern(back->pixels, VGA_PIXELS, 99);
+    memcpy(__ref, __fb0, sizeof(__ref));
+    CHECK_EQ(CLCD_OK, clcd_blitAsync(&front, 3, 5, back, 10, 7, 101, 13, &__callback, NULL));
+    __waitBlit();
+    CHECK_EQ(2, __nrCalls);
+    CHECK_EQ(CLCD_OK, __status);
+    __refBlit(__ref, VGA_WIDTH, VGA_HEIGHT, 3, 5, __fb1, VGA_WIDTH, VGA_HEIGHT, 10, 7, 101, 13);
+    CHECK_EQ(0, __nrDiffs(__ref, __fb0, VGA_PIXELS));
+
+    /* Overlapping rectangles are rejected, the callback is not called */
+    CHECK_EQ(CLCD_ERR_PARAM, clcd_blitAsync(back, 0, 0, back, 5, 5, 10, 10, &__callback, NULL));
+    CHECK_EQ(2, __nrCalls);
+
+    /* Nothing to copy, the callback is called immediately */
+    CHECK_EQ(CLCD_OK, clcd_blitAsync(&front, VGA_WIDTH, 0, back, 0, 0, 10, 10, &__callback, NULL));
+    CHECK_EQ(3, __nrCalls);
+    CHECK_EQ(0, clcd_isBlitBusy());
+
+    /* No DMA channel is available, the CPU copies */
+    for ( i=0; i<8; ++i )
+    {
+        ch[i] = dma_allocChannel();
+        CHECK(ch[i] >= 0);
+    }
+
+    __pattern(back->pixels, VGA_PIXELS, 5);
+    CHECK_EQ(CLCD_OK, clcd_blitAsync(&front, 0, 0, back, 0, 0, VGA_WIDTH, VGA_HEIGHT, &__callback, NULL));
+    CHECK_EQ(0, clcd_isBlitBusy());
+    CHECK_EQ(4, __nrCalls);
+    CHECK_EQ(CLCD_OK, __status);
+    CHECK_EQ(0, __nrDiffs(__fb0, __fb1, VGA_PIXELS));
+
+    for ( i=0; i<8; ++i )
+    {
+        dma_freeChannel(ch[i]);
+    }
+}
+
+
+void test_clcd(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testFillRect);
+    RUN_TEST(testBlit);
+    RUN_TEST(testBlitOverlap);
+    RUN_TEST(testSwap);
+    RUN_TEST(testWaitSwap);
+    RUN_TEST(testBlitAsync);
+}
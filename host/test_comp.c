@@ -0,0 +1,281 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the dirty rectangle compositor (comp.c).
+ *
+ * The compositor copies between two small off-screen surfaces, the
+ * front surface is checked against the back surface after each frame.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "comp.h"
+#include "clcd.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define WIDTH       64
+#define HEIGHT      48
+#define NR_PIXELS   ( WIDTH * HEIGHT )
+
+static uint16_t __frontPixels[NR_PIXELS] __attribute__((aligned(8)));
+static uint16_t __backPixels[NR_PIXELS] __attribute__((aligned(8)));
+static clcdSurface __front = { __frontPixels, WIDTH, HEIGHT };
+static clcdSurface __back = { __backPixels, WIDTH, HEIGHT };
+
+
+/* Initializes both surfaces and the compositor, the initial full frame is presented */
+static void __init(void)
+{
+    memset(__frontPixels, 0, sizeof(__frontPixels));
+    memset(__backPixels, 0, sizeof(__backPixels));
+    CHECK_EQ(COMP_OK, comp_init(&__front, &__back));
+    CHECK_EQ(NR_PIXELS, comp_present());
+    comp_resetStats();
+}
+
+
+/* Draws into the back surface and marks the rectangle dirty */
+static void __draw(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+{
+    clcd_fillRect(&__back, x, y, w, h, color);
+    CHECK_EQ(COMP_OK, comp_markDirty(x, y, w, h));
+}
+
+
+/* Checks the single dirty rectangle */
+static void __checkSingle(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    compRect r;
+
+    CHECK_EQ(1, comp_getDirty(&r, 1));
+    CHECK_EQ(x, r.x);
+    CHECK_EQ(y, r.y);
+    CHECK_EQ(w, r.w);
+    CHECK_EQ(h, r.h);
+}
+
+
+static void testInit(void)
+{
+    clcdSurface small = { __backPixels, WIDTH, HEIGHT - 1 };
+    clcdSurface none = { NULL, WIDTH, HEIGHT };
+    compStats stats;
+
+    CHECK_EQ(COMP_ERR_PARAM, comp_init(NULL, &__back));
+    CHECK_EQ(COMP_ERR_PARAM, comp_init(&__front, &small));
+    CHECK_EQ(COMP_ERR_PARAM, comp_init(&__front, &none));
+    CHECK_EQ(COMP_ERR_PARAM, comp_init(&__front, &__front));
+
+    /* The first frame is copied completely */
+    memset(__backPixels, 0x5A, sizeof(__backPixels));
+    CHECK_EQ(COMP_OK, comp_init(&__front, &__back));
+    __checkSingle(0, 0, WIDTH, HEIGHT);
+    CHECK_EQ(NR_PIXELS, comp_present());
+    CHECK(0 == memcmp(__frontPixels, __backPixels, sizeof(__frontPixels)));
+
+    /* Nothing is copied without changes */
+    CHECK_EQ(0, comp_getDirty(NULL, 0));
+    CHECK_EQ(0, comp_present());
+
+    comp_getStats(&stats);
+    CHECK_EQ(2, stats.frames);
+    CHECK_EQ(1, stats.rects);
+    CHECK_EQ(NR_PIXELS, stats.pixels);
+    CHECK_EQ(0, stats.lastPixels);
+    CHECK_EQ(NR_PIXELS, stats.maxPixels);
+}
+
+
+static void testPartialUpdate(void)
+{
+    compStats stats;
+    uint32_t x;
+    uint32_t y;
+
+    __init();
+
+    /* Two distant rectangles are not merged */
+    __draw(1, 2, 5, 3, 0x1111);
+    __draw(40, 30, 7, 9, 0x2222);
+    CHECK_EQ(2, comp_getDirty(NULL, 0));
+
+    /* Pixels outside of the dirty rectangles are not copied */
+    __backPixels[20 * WIDTH + 20] = 0xFFFF;
+
+    CHECK_EQ(5 * 3 + 7 * 9, comp_present());
+    CHECK_EQ(0, __frontPixels[20 * WIDTH + 20]);
+    __frontPixels[20 * WIDTH + 20] = 0xFFFF;
+    CHECK(0 == memcmp(__frontPixels, __backPixels, sizeof(__frontPixels)));
+
+    /* Rectangles are clipped */
+    __draw(60, 45, 10, 10, 0x3333);
+    __checkSingle(60, 45, 4, 3);
+    CHECK_EQ(COMP_OK, comp_markDirty(WIDTH, 0, 5, 5));
+    CHECK_EQ(COMP_OK, comp_markDirty(0, 0, 0, 5));
+    CHECK_EQ(1, comp_getDirty(NULL, 0));
+    CHECK_EQ(12, comp_present());
+
+    for ( y=0; y<HEIGHT; ++y )
+    {
+        for ( x=0; x<WIDTH; ++x )
+        {
+            CHECK_EQ(__backPixels[y*WIDTH + x], __frontPixels[y*WIDTH + x]);
+        }
+    }
+
+    comp_getStats(&stats);
+    CHECK_EQ(2, stats.frames);
+    CHECK_EQ(3, stats.rects);
+    CHECK_EQ(5 * 3 + 7 * 9 + 12, stats.pixels);
+    CHECK_EQ(12, stats.lastPixels);
+    CHECK_EQ(5 * 3 + 7 * 9, stats.maxPixels);
+    CHECK_EQ(0, stats.merges);
+}
+
+
+static void testMerge(void)
+{
+    compRect r[4];
+    compStats stats;
+
+    __init();
+
+    /* Contained rectangles */
+    CHECK_EQ(COMP_OK, comp_markDirty(10, 10, 20, 20));
+    CHECK_EQ(COMP_OK, comp_markDirty(15, 15, 5, 5));
+    __checkSingle(10, 10, 20, 20);
+    CHECK_EQ(COMP_OK, comp_markDirty(5, 5, 40, 30));
+    __checkSingle(5, 5, 40, 30);
+    CHECK_EQ(40 * 30, comp_present());
+
+    /* Adjacent rectangles of the same height or width */
+    CHECK_EQ(COMP_OK, comp_markDirty(0, 0, 8, 4));
+    CHECK_EQ(COMP_OK, comp_markDirty(8, 0, 8, 4));
+    CHECK_EQ(COMP_OK, comp_markDirty(0, 4, 16, 2));
+    __checkSingle(0, 0, 16, 6);
+    CHECK_EQ(16 * 6, comp_present());
+
+    /* Overlapping rectangles, the bounding box is smaller than both together */
+    CHECK_EQ(COMP_OK, comp_markDirty(0, 0, 10, 10));
+    CHECK_EQ(COMP_OK, comp_markDirty(2, 2, 10, 10));
+    __checkSingle(0, 0, 12, 12);
+    CHECK_EQ(144, comp_present());
+
+    /* Overlapping rectangles are always merged, so no pixel is copied twice */
+    CHECK_EQ(COMP_OK, comp_markDirty(20, 0, 2, 40));
+    CHECK_EQ(COMP_OK, comp_markDirty(0, 20, 60, 2));
+    __checkSingle(0, 0, 60, 40);
+    CHECK_EQ(60 * 40, comp_present());
+    CHECK_EQ(COMP_OK, comp_markDirty(0, 0, 4, 30));
+    CHECK_EQ(COMP_OK, comp_markDirty(2, 26, 30, 4));
+    __checkSingle(0, 0, 32, 30);
+    CHECK_EQ(32 * 30, comp_present());
+
+    /* Distant rectangles remain separate */
+    CHECK_EQ(COMP_OK, comp_markDirty(0, 0, 2, 2));
+    CHECK_EQ(COMP_OK, comp_markDirty(10, 10, 2, 2));
+    CHECK_EQ(2, comp_getDirty(r, 4));
+    CHECK_EQ(4 + 4, comp_present());
+
+    /* A bridge joins two rectangles, the union is then merged with the third one */
+    CHECK_EQ(COMP_OK, comp_markDirty(0, 0, 4, 4));
+    CHECK_EQ(COMP_OK, comp_markDirty(8, 0, 4, 4));
+    CHECK_EQ(2, comp_getDirty(NULL, 0));
+    CHECK_EQ(COMP_OK, comp_markDirty(4, 0, 4, 4));
+    __checkSingle(0, 0, 12, 4);
+    CHECK_EQ(48, comp_present());
+
+    comp_getStats(&stats);
+    CHECK_EQ(2 + 2 + 1 + 1 + 1 + 2, stats.merges);
+    CHECK_EQ(0, stats.overflows);
+}
+
+
+static void testOverflow(void)
+{
+    compRect r[COMP_MAX_RECTS];
+    compStats stats;
+    uint8_t i;
+    uint8_t n;
+
+    __init();
+
+    /* A grid of single pixels, none of them can be merged */
+    for ( i=0; i<COMP_MAX_RECTS; ++i )
+    {
+        __draw((uint16_t) (i % 4) * 10, (uint16_t) (i / 4) * 10, 1, 1, (uint16_t) (i + 1));
+    }
+    CHECK_EQ(COMP_MAX_RECTS, comp_getDirty(NULL, 0));
+
+    /* The next one is merged with the nearest pixel */
+    __draw(32, 31, 1, 1, 0x7777);
+    n = comp_getDirty(r, COMP_MAX_RECTS);
+    CHECK_EQ(COMP_MAX_RECTS, n);
+
+    for ( i=0; i<n; ++i )
+    {
+        if ( r[i].w > 1 || r[i].h > 1 )
+        {
+            CHECK_EQ(30, r[i].x);
+            CHECK_EQ(30, r[i].y);
+            CHECK_EQ(3, r[i].w);
+            CHECK_EQ(2, r[i].h);
+        }
+    }
+
+    CHECK_EQ(COMP_MAX_RECTS - 1 + 6, comp_present());
+    CHECK(0 == memcmp(__frontPixels, __backPixels, sizeof(__frontPixels)));
+
+    comp_getStats(&stats);
+    CHECK_EQ(1, stats.overflows);
+
+    /* Many random rectangles, the front surface always equals the back surface */
+    for ( i=0; i<200; ++i )
+    {
+        __draw((uint16_t) ((i * 37) % WIDTH), (uint16_t) ((i * 23) % HEIGHT),
+               (uint16_t) (1 + (i * 7) % 13), (uint16_t) (1 + (i * 11) % 9), (uint16_t) (i * 0x123));
+        CHECK(comp_getDirty(NULL, 0) <= COMP_MAX_RECTS);
+
+        if ( 0 == (i % 25) )
+        {
+            comp_present();
+            CHECK(0 == memcmp(__frontPixels, __backPixels, sizeof(__frontPixels)));
+        }
+    }
+
+    comp_present();
+    CHECK(0 == memcmp(__frontPixels, __backPixels, sizeof(__frontPixels)));
+}
+
+
+void test_comp(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testPartialUpdate);
+    RUN_TEST(testMerge);
+    RUN_TEST(testOverflow);
+}
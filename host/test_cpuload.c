@@ -0,0 +1,202 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the CPU load accounting (cpuload.c).
+ *
+ * The simulated CPU does not consume any time by itself, so the time spent
+ * in each context is simulated by advancing the timers.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cpuload.h"
+#include "timer.h"
+#include "clocksource.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+/* Simulated duration of the ISR in timer (1 MHz) ticks: */
+static uint32_t __isrTicks;
+
+static void __tickIsr(void* param)
+{
+    timer_clearInterrupt(0, 0);
+    sim_timerAdvance(__isrTicks);
+}
+
+
+/* Converts microseconds (timer ticks) into clock ticks */
+static uint32_t __us(uint32_t us)
+{
+    return us * (clocksource_getFrequency() / 1000000);
+}
+
+
+/*
+ * Initializes the accounting. The clock is started (and its registers synced)
+ * first, otherwise the initial timestamp would be read before the counter is loaded.
+ */
+static void __init(void)
+{
+    clocksource_init();
+    sim_sync();
+    cpuload_init();
+}
+
+
+/* Prepares the timer 0, counter 0 to trigger IRQ 4 each 'load'+1 ticks */
+static void __startTick(uint32_t load)
+{
+    pic_init();
+    sim_sync();
+    pic_registerNonVectoredIrq(4, &__tickIsr, NULL, 10);
+    pic_enableInterrupt(4);
+
+    timer_init(0, 0);
+    timer_setLoad(0, 0, load);
+    timer_enableInterrupt(0, 0);
+    timer_start(0, 0);
+    irq_enableIrqMode();
+}
+
+
+static void testInvalidParams(void)
+{
+    cpuloadStats stats;
+
+    __init();
+    CHECK_EQ(-1, cpuload_getStats(CPULOAD_WINDOW_1S, NULL));
+    CHECK_EQ(-1, cpuload_getStats(5, &stats));
+    CHECK_EQ(0, cpuload_getStats(CPULOAD_WINDOW_10S, &stats));
+
+    /* no bucket completed yet */
+    CHECK_EQ(0, stats.window);
+    CHECK_EQ(0, cpuload_getLoad(CPULOAD_WINDOW_1S));
+}
+
+
+static void testTaskOnly(void)
+{
+    cpuloadStats stats;
+
+    __init();
+
+    sim_timerAdvance(1500000);
+    CHECK_EQ(0, cpuload_getStats(CPULOAD_WINDOW_1S, &stats));
+    CHECK_EQ(__us(1000000), stats.window);
+    CHECK_EQ(__us(1000000), stats.task);
+    CHECK_EQ(0, stats.idle);
+    CHECK_EQ(0, stats.irq);
+    CHECK_EQ(1000, cpuload_getLoad(CPULOAD_WINDOW_1S));
+
+    /* until 10 seconds elapse, the window is shorter */
+    CHECK_EQ(0, cpuload_getStats(CPULOAD_WINDOW_10S, &stats));
+    CHECK_EQ(__us(1500000), stats.window);
+
+    sim_timerAdvance(12000000);
+    CHECK_EQ(0, cpuload_getStats(CPULOAD_WINDOW_10S, &stats));
+    CHECK_EQ(__us(10000000), stats.window);
+    CHECK_EQ(__us(10000000), stats.task);
+    CHECK_EQ(1000, cpuload_getLoad(CPULOAD_WINDOW_10S));
+}
+
+
+static void testPeriodicLoad(void)
+{
+    cpuloadStats stats;
+    uint32_t i;
+
+    __init();
+
+    /* each period of 10 ms: 1 ms in the ISR, 1 ms in the task, the rest is idle */
+    __isrTicks = 1000;
+    __startTick(10000 - 1);
+
+    for ( i=0; i<300; ++i )
+    {
+        sim_timerAdvance(1000);
+        /* the IRQ is serviced as soon as the IRQ mode is restored */
+        cpuload_idle();
+        CHECK(irq_isIrqModeEnabled());
+        CHECK_EQ(0, sim_dispatchIrq());
+    }
+
+    CHECK_EQ(0, cpuload_getStats(CPULOAD_WINDOW_1S, &stats));
+    CHECK_EQ(__us(1000000), stats.window);
+    CHECK_EQ(__us(100000), stats.irq);
+    CHECK_EQ(__us(100000), stats.task);
+    CHECK_EQ(__us(800000), stats.idle);
+    CHECK_EQ(200, cpuload_getLoad(CPULOAD_WINDOW_1S));
+
+    /*
+     * The counter first reaches 0 after 9999 ticks, so the ISR k runs from
+     * 10000*k-1. 299 ISRs and the first tick of the 300th one are in the window.
+     */
+    CHECK_EQ(0, cpuload_getStats(CPULOAD_WINDOW_10S, &stats));
+    CHECK_EQ(__us(3000000), stats.window);
+    CHECK_EQ(__us(299 * 1000 + 1), stats.irq);
+
+    irq_disableIrqMode();
+}
+
+
+static void testLongIdle(void)
+{
+    cpuloadStats stats;
+
+    __init();
+
+    /* the first interrupt after 3.5 s */
+    __isrTicks = 0;
+    __startTick(3500000);
+
+    cpuload_idle();
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    /* the idle period is split among 35 buckets */
+    CHECK_EQ(0, cpuload_getStats(CPULOAD_WINDOW_10S, &stats));
+    CHECK_EQ(__us(3500000), stats.window);
+    CHECK_EQ(__us(3500000), stats.idle);
+    CHECK_EQ(0, stats.task);
+    CHECK_EQ(0, cpuload_getLoad(CPULOAD_WINDOW_1S));
+    CHECK_EQ(0, cpuload_getLoad(CPULOAD_WINDOW_10S));
+
+    /* busy for 0.5 s, the 1 s window slides */
+    sim_timerAdvance(500000);
+    CHECK_EQ(500, cpuload_getLoad(CPULOAD_WINDOW_1S));
+    CHECK_EQ(125, cpuload_getLoad(CPULOAD_WINDOW_10S));
+
+    irq_disableIrqMode();
+}
+
+
+void test_cpuload(void)
+{
+    RUN_TEST(testInvalidParams);
+    RUN_TEST(testTaskOnly);
+    RUN_TEST(testPeriodicLoad);
+    RUN_TEST(testLongIdle);
+}
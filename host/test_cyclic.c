@@ -0,0 +1,301 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the cyclic executive (cyclic.c).
+ *
+ * Jobs consume (simulated) time by advancing the timers by their costs,
+ * which are measured by the clocksource (SYS_24MHZ).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cyclic.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define MINOR_US       1000
+
+
+/* Indices of called jobs, in order of calls: */
+static uint8_t __calls[32];
+static uint32_t __nrCalls;
+
+/* Execution times of jobs in timer ticks: */
+static uint32_t __cost[3];
+
+
+/* A job, its parameter is its index */
+static void __job(void* param)
+{
+    const uint8_t idx = (uint8_t) (uintptr_t) param;
+
+    if ( __nrCalls < sizeof(__calls) )
+    {
+        __calls[__nrCalls] = idx;
+    }
+    ++__nrCalls;
+
+    if ( __cost[idx] > 0 )
+    {
+        sim_timerAdvance(__cost[idx]);
+    }
+}
+
+
+static const cyclicJob __jobs[3] =
+{
+    { &__job, (void*) 0 },
+    { &__job, (void*) 1 },
+    { &__job, (void*) 2 }
+};
+
+static const uint8_t __f0[] = { 0, 1 };
+static const uint8_t __f1[] = { 0 };
+static const uint8_t __f2[] = { 0, 2 };
+
+static const cyclicFrame __frames[4] =
+{
+    { __f0, 2 },
+    { __f1, 1 },
+    { __f2, 2 },
+    { __f1, 1 }
+};
+
+static const cyclicSchedule __sched = { __jobs, 3, __frames, 4, MINOR_US };
+
+
+/* Initializes the PIC and starts the executive by timer 1, counter 0, the IRQ mode is enabled */
+static void __start(void)
+{
+    pic_init();
+    sim_sync();
+    CHECK_EQ(CYCLIC_OK, cyclic_init(&__sched, 1, 0, 20));
+    CHECK_EQ(CYCLIC_OK, cyclic_start());
+    irq_enableIrqMode();
+
+    __nrCalls = 0;
+    __cost[0] = 0;
+    __cost[1] = 0;
+    __cost[2] = 0;
+}
+
+
+/* Advances the time to the next expiration of the counter and executes its frame */
+static void __frame(uint32_t ticks)
+{
+    sim_timerAdvance(ticks);
+    CHECK_EQ(1, sim_dispatchIrq());
+}
+
+
+static void testInit(void)
+{
+    static const uint8_t badJobs[] = { 0, 3 };
+    static const cyclicFrame badFrames[1] = { { badJobs, 2 } };
+    const cyclicSchedule badIndex = { __jobs, 3, badFrames, 1, MINOR_US };
+    const cyclicSchedule noFrames = { __jobs, 3, __frames, 0, MINOR_US };
+    const cyclicSchedule noLength = { __jobs, 3, __frames, 4, 1 };
+    cyclicJobStats js;
+
+    pic_init();
+    sim_sync();
+
+    CHECK_EQ(CYCLIC_ERR_NOINIT, cyclic_start());
+    CHECK_EQ(CYCLIC_ERR_NOINIT, cyclic_getJobStats(0, &js));
+    CHECK_EQ(CYCLIC_ERR_PARAM, cyclic_init(NULL, 1, 0, 20));
+    CHECK_EQ(CYCLIC_ERR_PARAM, cyclic_init(&badIndex, 1, 0, 20));
+    CHECK_EQ(CYCLIC_ERR_PARAM, cyclic_init(&noFrames, 1, 0, 20));
+    CHECK_EQ(CYCLIC_ERR_PARAM, cyclic_init(&noLength, 1, 0, 20));
+    CHECK_EQ(CYCLIC_ERR_PARAM, cyclic_init(&__sched, BSP_NR_TIMERS, 0, 20));
+    CHECK_EQ(CYCLIC_ERR_PARAM, cyclic_init(&__sched, 1, timer_countersPerTimer(), 20));
+    CHECK_EQ(CYCLIC_ERR_PARAM, cyclic_getStats(NULL));
+
+    CHECK_EQ(CYCLIC_OK, cyclic_init(&__sched, 1, 0, 20));
+    CHECK_EQ(0, cyclic_isRunning());
+    CHECK_EQ(CYCLIC_ERR_PARAM, cyclic_getJobStats(3, &js));
+    CHECK_EQ(CYCLIC_ERR_PARAM, cyclic_getJobStats(0, NULL));
+
+    CHECK_EQ(CYCLIC_OK, cyclic_start());
+    CHECK_EQ(1, cyclic_isRunning());
+    CHECK( 0 != timer_isEnabled(1, 0) );
+
+    cyclic_stop();
+    CHECK_EQ(0, cyclic_isRunning());
+    CHECK_EQ(0, timer_isEnabled(1, 0));
+}
+
+
+static void testSchedule(void)
+{
+    static const uint8_t expected[] = { 0, 1, 0, 0, 2, 0, 0, 1 };
+    cyclicStats stats;
+    uint32_t i;
+
+    __start();
+
+    /* The first frame starts after a minor frame */
+    sim_timerAdvance(MINOR_US - 2);
+    CHECK_EQ(0, sim_dispatchIrq());
+    __frame(1);
+    CHECK_EQ(1, cyclic_getMinorFrame());
+
+    for ( i=0; i<4; ++i )
+    {
+        CHECK_EQ(0, sim_dispatchIrq());
+        __frame(MINOR_US);
+    }
+
+    CHECK_EQ(sizeof(expected), __nrCalls);
+    for ( i=0; i<sizeof(expected); ++i )
+    {
+        CHECK_EQ(expected[i], __calls[i]);
+    }
+
+    CHECK_EQ(CYCLIC_OK, cyclic_getStats(&stats));
+    CHECK_EQ(5, stats.minorFrames);
+    CHECK_EQ(1, stats.majorFrames);
+    CHECK_EQ(0, stats.overruns);
+    CHECK_EQ(0, stats.skipped);
+    CHECK_EQ(0, stats.maxJitterUs);
+
+    /* A late start is reported as jitter */
+    sim_timerAdvance(MINOR_US + 50);
+    CHECK_EQ(1, sim_dispatchIrq());
+    __frame(MINOR_US - 50);
+    cyclic_getStats(&stats);
+    CHECK_EQ(50, stats.maxJitterUs);
+
+    /* A stopped executive does not execute any frames */
+    cyclic_stop();
+    sim_timerAdvance(10 * MINOR_US);
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(7, stats.minorFrames);
+    irq_disableIrqMode();
+}
+
+
+static void testExecutionTimes(void)
+{
+    cyclicJobStats js;
+    uint32_t i;
+
+    __start();
+
+    __cost[1] = 300;
+    __cost[2] = 150;
+
+    __frame(MINOR_US - 1);
+    for ( i=0; i<3; ++i )
+    {
+        __frame(MINOR_US);
+    }
+
+    CHECK_EQ(CYCLIC_OK, cyclic_getJobStats(0, &js));
+    CHECK_EQ(4, js.runs);
+    CHECK_EQ(0, js.wcetUs);
+    cyclic_getJobStats(1, &js);
+    CHECK_EQ(1, js.runs);
+    CHECK_EQ(300, js.lastUs);
+    CHECK_EQ(300, js.wcetUs);
+    cyclic_getJobStats(2, &js);
+    CHECK_EQ(1, js.runs);
+    CHECK_EQ(150, js.wcetUs);
+
+    /* The max. execution time is retained */
+    __cost[1] = 100;
+    __frame(MINOR_US);
+    cyclic_getJobStats(1, &js);
+    CHECK_EQ(2, js.runs);
+    CHECK_EQ(100, js.lastUs);
+    CHECK_EQ(300, js.wcetUs);
+
+    cyclic_resetStats();
+    cyclic_getJobStats(1, &js);
+    CHECK_EQ(0, js.runs + js.lastUs + js.wcetUs);
+
+    cyclic_stop();
+    irq_disableIrqMode();
+}
+
+
+static void testOverrun(void)
+{
+    cyclicStats stats;
+
+    __start();
+
+    /* Frame 2 overruns by more than a frame, frame 3 is skipped */
+    __cost[2] = 2 * MINOR_US + 500;
+    __frame(MINOR_US - 1);
+    __frame(MINOR_US);
+    __nrCalls = 0;
+    __frame(MINOR_US);
+    CHECK_EQ(2, __nrCalls);
+    CHECK_EQ(0, cyclic_getMinorFrame());
+
+    /* The pending expiration starts frame 0 at once */
+    __cost[2] = 0;
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(4, __nrCalls);
+    CHECK_EQ(0, __calls[2]);
+    CHECK_EQ(1, __calls[3]);
+
+    /* Frame 1 starts at the counter's next expiration */
+    sim_timerAdvance(MINOR_US / 2 - 1);
+    CHECK_EQ(0, sim_dispatchIrq());
+    __frame(1);
+    CHECK_EQ(2, cyclic_getMinorFrame());
+
+    /* A shorter overrun only delays the next frame */
+    __cost[2] = MINOR_US + 200;
+    __frame(MINOR_US);
+    __cost[2] = 0;
+    CHECK_EQ(3, cyclic_getMinorFrame());
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(0, cyclic_getMinorFrame());
+    __frame(MINOR_US - 200);
+    __frame(MINOR_US);
+
+    cyclic_getStats(&stats);
+    CHECK_EQ(2, stats.overruns);
+    CHECK_EQ(1, stats.skipped);
+    CHECK_EQ(9, stats.minorFrames);
+    CHECK_EQ(2, stats.majorFrames);
+    CHECK_EQ(0, stats.maxJitterUs);
+
+    cyclic_stop();
+    irq_disableIrqMode();
+}
+
+
+void test_cyclic(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testSchedule);
+    RUN_TEST(testExecutionTimes);
+    RUN_TEST(testOverrun);
+}
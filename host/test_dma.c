@@ -0,0 +1,241 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the PL080 driver (dma.c).
+ *
+ * Buffers are static, so their addresses fit into the controller's
+ * 32-bit registers (the test executable is linked at a low address).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "dma.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define BUF_SIZE      50000
+
+static uint8_t __src[BUF_SIZE];
+static uint8_t __dst[BUF_SIZE + 4];
+
+static uint32_t __nrCalls;
+static int8_t __status;
+static void* __param;
+
+static void __callback(int8_t status, void* param)
+{
+    ++__nrCalls;
+    __status = status;
+    __param = param;
+}
+
+
+/* Initializes the interrupt and DMA controllers and fills the buffers */
+static void __init(void)
+{
+    uint32_t i;
+
+    pic_init();
+    sim_sync();
+    CHECK_EQ(0, dma_init(10));
+    irq_enableIrqMode();
+
+    for ( i=0; i<BUF_SIZE; ++i )
+    {
+        __src[i] = (uint8_t) (i * 7 + 3);
+    }
+    for ( i=0; i<BUF_SIZE+4; ++i )
+    {
+        __dst[i] = 0;
+    }
+
+    __nrCalls = 0;
+    __status = 1;
+    __param = NULL;
+}
+
+
+/* Checks that 'size' bytes were copied to 'dst' and the surrounding bytes were not touched */
+static void __checkCopy(const uint8_t* dst, const uint8_t* src, uint32_t size)
+{
+    uint32_t i;
+    uint32_t bad = 0;
+
+    for ( i=0; i<size; ++i )
+    {
+        bad += ( dst[i] != src[i] ? 1 : 0 );
+    }
+    CHECK_EQ(0, bad);
+
+    if ( dst > __dst )
+    {
+        CHECK_EQ(0, dst[-1]);
+    }
+    CHECK_EQ(0, dst[size]);
+}
+
+
+static void testWordCopy(void)
+{
+    int8_t ch;
+
+    __init();
+
+    /* 3 LLIs of word transfers */
+    ch = dma_memcpyAsync(__dst, __src, 40000, &__callback, (void*) __dst);
+    CHECK_EQ(0, ch);
+    CHECK(dma_isBusy(ch));
+    CHECK_EQ(2, (sim_dmaRegs[PL080_CH(0) + PL080_CH_CONTROL] >> 18) & 0x07);
+
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(DMA_STATUS_OK, __status);
+    CHECK(__param == (void*) __dst);
+    CHECK(!dma_isBusy(ch));
+    __checkCopy(__dst, __src, 40000);
+
+    /* the interrupt was cleared by the ISR */
+    CHECK_EQ(0, sim_dmaRegs[PL080_INTTCSTATUS]);
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    /* the channel was released */
+    CHECK_EQ(0, dma_allocChannel());
+
+    irq_disableIrqMode();
+}
+
+
+static void testUnalignedCopy(void)
+{
+    __init();
+
+    /* halfword transfers */
+    CHECK_EQ(0, dma_memcpyAsync(__dst+2, __src, 1002, &__callback, NULL));
+    CHECK_EQ(1, (sim_dmaRegs[PL080_CH(0) + PL080_CH_CONTROL] >> 18) & 0x07);
+    sim_dispatchIrq();
+    CHECK_EQ(1, __nrCalls);
+    __checkCopy(__dst+2, __src, 1002);
+
+    /* byte transfers, 2 LLIs */
+    CHECK_EQ(0, dma_memcpyAsync(__dst+1, __src+2, 5001, &__callback, NULL));
+    CHECK_EQ(0, (sim_dmaRegs[PL080_CH(0) + PL080_CH_CONTROL] >> 18) & 0x07);
+    sim_dispatchIrq();
+    CHECK_EQ(2, __nrCalls);
+    CHECK_EQ(DMA_STATUS_OK, __status);
+    CHECK_EQ(__src[2], __dst[1]);
+    CHECK_EQ(__src[5002], __dst[5001]);
+    CHECK_EQ(0, __dst[5002]);
+
+    irq_disableIrqMode();
+}
+
+
+static void testInvalidParams(void)
+{
+    __init();
+
+    CHECK_EQ(8, dma_nrChannels());
+    CHECK_EQ(16 * 4095 * 4, dma_maxTransferSize());
+
+    CHECK(dma_memcpyAsync(__dst, __src, 0, &__callback, NULL) < 0);
+    CHECK(dma_memcpyAsync(NULL, __src, 4, &__callback, NULL) < 0);
+    CHECK(dma_memcpyAsync(__dst, NULL, 4, &__callback, NULL) < 0);
+    CHECK(dma_memcpyAsync(__dst, __src, dma_maxTransferSize() + 4, &__callback, NULL) < 0);
+    /* byte transfers are limited to a quarter of the size */
+    CHECK(dma_memcpyAsync(__dst+1, __src, 16 * 4095 + 1, &__callback, NULL) < 0);
+
+    CHECK(!dma_isBusy(8));
+    dma_freeChannel(8);
+
+    sim_sync();
+    CHECK_EQ(0, sim_dmaRegs[PL080_RAWINTTCSTATUS]);
+    CHECK_EQ(0, __nrCalls);
+
+    irq_disableIrqMode();
+}
+
+
+static void testChannelAllocation(void)
+{
+    uint8_t i;
+
+    __init();
+
+    for ( i=0; i<8; ++i )
+    {
+        CHECK_EQ(i, dma_allocChannel());
+    }
+    CHECK(dma_allocChannel() < 0);
+    CHECK(dma_memcpyAsync(__dst, __src, 4, &__callback, NULL) < 0);
+
+    /* the free channel with the highest priority is used */
+    dma_freeChannel(5);
+    dma_freeChannel(3);
+    CHECK_EQ(3, dma_memcpyAsync(__dst, __src, 4, &__callback, NULL));
+
+    /* a busy channel cannot be freed */
+    dma_freeChannel(3);
+    CHECK(dma_isBusy(3));
+    sim_dispatchIrq();
+    CHECK(!dma_isBusy(3));
+    CHECK_EQ(3, dma_allocChannel());
+
+    irq_disableIrqMode();
+}
+
+
+static void testError(void)
+{
+    int8_t ch;
+
+    __init();
+
+    /* with the controller disabled, the transfer does not start */
+    sim_dmaRegs[PL080_CONFIG] = 0;
+    ch = dma_memcpyAsync(__dst, __src, 64, &__callback, NULL);
+    CHECK_EQ(0, ch);
+    sim_sync();
+
+    sim_dmaRegs[PL080_RAWINTERRSTATUS] = 1UL << ch;
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(DMA_STATUS_ERROR, __status);
+    CHECK(!dma_isBusy(ch));
+    CHECK_EQ(0, sim_dmaRegs[PL080_CH(ch) + PL080_CH_CONFIG] & 0x01);
+    CHECK_EQ(0, sim_dmaRegs[PL080_INTERRSTATUS]);
+
+    irq_disableIrqMode();
+}
+
+
+void test_dma(void)
+{
+    RUN_TEST(testWordCopy);
+    RUN_TEST(testUnalignedCopy);
+    RUN_TEST(testInvalidParams);
+    RUN_TEST(testChannelAllocation);
+    RUN_TEST(testError);
+}
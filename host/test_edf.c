@@ -0,0 +1,340 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the EDF dispatcher (edf.c).
+ *
+ * Jobs consume (simulated) time by advancing the timers by their costs,
+ * the tick's ISR is dispatched meanwhile, as it would preempt the job.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "edf.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "trace.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define TICK_US        100
+
+
+/* Indices of called tasks, in order of calls: */
+static uint8_t __calls[32];
+static uint32_t __nrCalls;
+
+/* Execution times of tasks in timer ticks: */
+static uint32_t __cost[3];
+
+
+/* A task, its parameter is its index */
+static void __task(void* param)
+{
+    const uint8_t idx = (uint8_t) (uintptr_t) param;
+
+    if ( __nrCalls < sizeof(__calls) )
+    {
+        __calls[__nrCalls] = idx;
+    }
+    ++__nrCalls;
+
+    if ( __cost[idx] > 0 )
+    {
+        sim_timerAdvance(__cost[idx]);
+        sim_dispatchIrq();
+    }
+}
+
+
+/* Implicit deadline, constrained deadlines: */
+static const edfTask __tasks[3] =
+{
+    { &__task, (void*) 0, 4000, 0 },
+    { &__task, (void*) 1, 2000, 1000 },
+    { &__task, (void*) 2, 8000, 3000 }
+};
+
+
+/* Initializes the PIC and starts the dispatcher by timer 1, counter 0, the IRQ mode is enabled */
+static void __start(const edfTask* tasks, uint8_t nrTasks)
+{
+    pic_init();
+    sim_sync();
+    CHECK_EQ(EDF_OK, edf_init(tasks, nrTasks, TICK_US, 1, 0, 20));
+    CHECK_EQ(EDF_OK, edf_start());
+    irq_enableIrqMode();
+
+    __nrCalls = 0;
+    __cost[0] = 0;
+    __cost[1] = 0;
+    __cost[2] = 0;
+}
+
+
+/* Advances the time and dispatches the tick */
+static void __advance(uint32_t ticks)
+{
+    sim_timerAdvance(ticks);
+    CHECK_EQ(1, sim_dispatchIrq());
+}
+
+
+/* Executes all ready jobs, returns their number */
+static uint32_t __runAll(void)
+{
+    uint32_t n = 0;
+
+    while ( 1 == edf_runNext() )
+    {
+        ++n;
+    }
+
+    return n;
+}
+
+
+static void testInit(void)
+{
+    const edfTask noFunc[1] = { { NULL, NULL, 1000, 0 } };
+    const edfTask shortPeriod[1] = { { &__task, NULL, TICK_US - 1, 0 } };
+    const edfTask longDeadline[1] = { { &__task, NULL, 1000, 1001 } };
+    edfTaskStats ts;
+    edfStats stats;
+
+    pic_init();
+    sim_sync();
+
+    CHECK_EQ(EDF_ERR_NOINIT, edf_start());
+    CHECK_EQ(EDF_ERR_NOINIT, edf_runNext());
+    CHECK_EQ(EDF_ERR_NOINIT, edf_getTaskStats(0, &ts));
+    CHECK_EQ(0, edf_getUtilization());
+
+    CHECK_EQ(EDF_ERR_PARAM, edf_init(NULL, 1, TICK_US, 1, 0, 20));
+    CHECK_EQ(EDF_ERR_PARAM, edf_init(__tasks, 0, TICK_US, 1, 0, 20));
+    CHECK_EQ(EDF_ERR_PARAM, edf_init(__tasks, EDF_MAX_TASKS + 1, TICK_US, 1, 0, 20));
+    CHECK_EQ(EDF_ERR_PARAM, edf_init(__tasks, 3, 1, 1, 0, 20));
+    CHECK_EQ(EDF_ERR_PARAM, edf_init(noFunc, 1, TICK_US, 1, 0, 20));
+    CHECK_EQ(EDF_ERR_PARAM, edf_init(shortPeriod, 1, TICK_US, 1, 0, 20));
+    CHECK_EQ(EDF_ERR_PARAM, edf_init(longDeadline, 1, TICK_US, 1, 0, 20));
+    CHECK_EQ(EDF_ERR_PARAM, edf_init(__tasks, 3, TICK_US, BSP_NR_TIMERS, 0, 20));
+    CHECK_EQ(EDF_ERR_PARAM, edf_init(__tasks, 3, TICK_US, 1, timer_countersPerTimer(), 20));
+    CHECK_EQ(EDF_ERR_PARAM, edf_getStats(NULL));
+
+    CHECK_EQ(EDF_OK, edf_init(__tasks, 3, TICK_US, 1, 0, 20));
+    CHECK_EQ(0, edf_isRunning());
+    CHECK_EQ(0, edf_runNext());
+    CHECK_EQ(EDF_ERR_PARAM, edf_getTaskStats(3, &ts));
+    CHECK_EQ(EDF_ERR_PARAM, edf_getTaskStats(0, NULL));
+
+    CHECK_EQ(EDF_OK, edf_start());
+    CHECK_EQ(1, edf_isRunning());
+    CHECK_EQ(3, edf_getNrReady());
+    CHECK( 0 != timer_isEnabled(1, 0) );
+
+    /* Ready jobs are discarded when the dispatcher is stopped */
+    edf_stop();
+    CHECK_EQ(0, edf_isRunning());
+    CHECK_EQ(0, edf_getNrReady());
+    CHECK_EQ(0, timer_isEnabled(1, 0));
+    CHECK_EQ(0, edf_runNext());
+
+    edf_getStats(&stats);
+    CHECK_EQ(3, stats.released);
+    CHECK_EQ(0, stats.completed);
+}
+
+
+static void testOrder(void)
+{
+    static const uint16_t expected[] = { TRACE_CTX_EDF(1), TRACE_CTX_EDF(2), TRACE_CTX_EDF(0) };
+    edfStats stats;
+    const traceRecord* rec;
+    uint32_t i;
+    uint32_t n;
+
+    __start(__tasks, 3);
+
+    /* Jobs are executed in order of their absolute deadlines: 1000, 3000, 4000 */
+    trace_init();
+    trace_enable();
+    CHECK_EQ(3, __runAll());
+    trace_disable();
+    CHECK_EQ(1, __calls[0]);
+    CHECK_EQ(2, __calls[1]);
+    CHECK_EQ(0, __calls[2]);
+
+    /* Each dispatched job is traced as a context switch */
+    n = 0;
+    for ( i=0; i<trace_getNrRecords(); ++i )
+    {
+        rec = trace_getRecord(i);
+        if ( TRACE_EV_CTX_SWITCH == rec->event )
+        {
+            CHECK(n < sizeof(expected)/sizeof(expected[0]));
+            CHECK_EQ(expected[n], rec->arg);
+            ++n;
+        }
+    }
+    CHECK_EQ(3, n);
+
+    /* The second job of task 1 is released at the first tick after 2000 */
+    __advance(1999);
+    CHECK_EQ(0, edf_getNrReady());
+    __advance(TICK_US);
+    CHECK_EQ(1, edf_getNrReady());
+    CHECK_EQ(1, __runAll());
+    CHECK_EQ(1, __calls[3]);
+
+    /* Deadlines 5000 (task 1) and 8000 (task 0) */
+    __advance(2000);
+    CHECK_EQ(2, edf_getNrReady());
+    CHECK_EQ(2, __runAll());
+    CHECK_EQ(1, __calls[4]);
+    CHECK_EQ(0, __calls[5]);
+
+    /* Deadlines 7000 (task 1) and 11000 (task 2), released at 6000 and 8000 */
+    __advance(2000);
+    CHECK_EQ(1, __runAll());
+    __advance(2000);
+    CHECK_EQ(3, edf_getNrReady());
+    CHECK_EQ(3, __runAll());
+    CHECK_EQ(1, __calls[7]);
+    CHECK_EQ(2, __calls[8]);
+    CHECK_EQ(0, __calls[9]);
+
+    edf_getStats(&stats);
+    CHECK_EQ(10, stats.released);
+    CHECK_EQ(10, stats.completed);
+    CHECK_EQ(0, stats.misses);
+    CHECK_EQ(0, stats.dropped);
+
+    edf_stop();
+    irq_disableIrqMode();
+}
+
+
+static void testMisses(void)
+{
+    edfTaskStats ts;
+    edfStats stats;
+
+    __start(__tasks, 3);
+
+    /* Task 1 overruns its deadline (1000) by 200, task 2 is still in time */
+    __cost[1] = 1200;
+    CHECK_EQ(3, __runAll());
+    CHECK_EQ(1, __calls[0]);
+
+    edf_getStats(&stats);
+    CHECK_EQ(3, stats.completed);
+    CHECK_EQ(1, stats.misses);
+    CHECK_EQ(200, stats.maxLatenessUs);
+
+    CHECK_EQ(EDF_OK, edf_getTaskStats(1, &ts));
+    CHECK_EQ(1, ts.runs);
+    CHECK_EQ(1, ts.misses);
+    CHECK_EQ(1200, ts.wcetUs);
+    CHECK_EQ(1200, ts.maxResponseUs);
+    edf_getTaskStats(2, &ts);
+    CHECK_EQ(0, ts.misses);
+    CHECK_EQ(1200, ts.maxResponseUs);
+
+    /* Task 1 is released at 2000 and runs till 4500, its release at 4000 is dropped */
+    __cost[1] = 2500;
+    __advance(900);
+    CHECK_EQ(1, edf_runNext());
+    CHECK_EQ(1, __calls[3]);
+
+    edf_getStats(&stats);
+    CHECK_EQ(1, stats.dropped);
+    CHECK_EQ(2, stats.misses);
+    edf_getTaskStats(1, &ts);
+    CHECK_EQ(1, ts.dropped);
+    CHECK_EQ(2, ts.misses);
+    CHECK_EQ(2500, ts.wcetUs);
+
+    /* Task 0 is released at 4000, its job is pending */
+    CHECK_EQ(1, edf_getNrReady());
+
+    /* Task 1 uses more than its period, i.e. more than the CPU */
+    CHECK( edf_getUtilization() >= 1000 );
+
+    edf_resetStats();
+    edf_getStats(&stats);
+    CHECK_EQ(0, stats.misses + stats.dropped + stats.maxLatenessUs);
+    CHECK_EQ(0, edf_getUtilization());
+
+    edf_stop();
+    irq_disableIrqMode();
+}
+
+
+static void testHighUtilization(void)
+{
+    /*
+     * U = 350/1000 + 500/1500 + 600/3000 = 0.883, the rest covers
+     * delays of releases by the tick.
+     */
+    static const edfTask tasks[3] =
+    {
+        { &__task, (void*) 0, 1000, 0 },
+        { &__task, (void*) 1, 1500, 0 },
+        { &__task, (void*) 2, 3000, 0 }
+    };
+    edfStats stats;
+    uint32_t t;
+
+    __start(tasks, 3);
+
+    __cost[0] = 350;
+    __cost[1] = 500;
+    __cost[2] = 600;
+
+    /* Two hyperperiods, the ready queue is drained at each tick */
+    for ( t=0; t<60; ++t )
+    {
+        __runAll();
+        __advance(TICK_US);
+    }
+
+    edf_getStats(&stats);
+    CHECK_EQ(0, stats.misses);
+    CHECK_EQ(0, stats.dropped);
+    CHECK( stats.completed >= 11 );
+    CHECK_EQ(883, edf_getUtilization());
+
+    edf_stop();
+    irq_disableIrqMode();
+}
+
+
+void test_edf(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testOrder);
+    RUN_TEST(testMisses);
+    RUN_TEST(testHighUtilization);
+}
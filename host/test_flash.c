@@ -0,0 +1,277 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the CFI flash driver (flash.c) on top of the simulated flash.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "flash.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "sim.h"
+#include "unit.h"
+
+
+static uint8_t __buf[1024];
+static uint8_t __rd[1024];
+
+static uint32_t __nrCallbacks;
+static int8_t __cbStatus;
+static void* __cbParam;
+
+
+static void __callback(int8_t status, void* param)
+{
+    ++__nrCallbacks;
+    __cbStatus = status;
+    __cbParam = param;
+}
+
+
+/* Initializes the driver, all words of the flash are cleared */
+static void __init(void)
+{
+    uint32_t i;
+
+    memset(sim_flashData, 0, sizeof(sim_flashData));
+    for ( i=0; i<sizeof(__buf); ++i )
+    {
+        __buf[i] = (uint8_t) (i * 13 + 7);
+    }
+
+    __nrCallbacks = 0;
+    __cbStatus = FLASH_BUSY;
+    __cbParam = NULL;
+
+    CHECK_EQ(FLASH_OK, flash_init());
+}
+
+
+static void testQuery(void)
+{
+    const flashInfo* info;
+
+    CHECK_EQ(FLASH_OK, flash_init());
+    info = flash_getInfo();
+    CHECK(NULL != info);
+    CHECK_EQ(SIM_FLASH_SIZE, info->size);
+    CHECK_EQ(SIM_FLASH_SECTOR_SIZE, info->sectorSize);
+    CHECK_EQ(SIM_FLASH_SIZE / SIM_FLASH_SECTOR_SIZE, info->nrSectors);
+    CHECK_EQ(SIM_FLASH_BUFFER_SIZE, info->bufferSize);
+    CHECK_EQ((1 << SIM_FLASH_BUFFER_LOG2_US) << 3, info->programTimeoutUs);
+    CHECK_EQ(((1 << SIM_FLASH_ERASE_LOG2_MS) << 3) * 1000, info->eraseTimeoutUs);
+
+    /* the flash was returned to the read array mode */
+    sim_flashData[5] = 0x12345678;
+    CHECK_EQ(FLASH_OK, flash_read(20, __rd, 4));
+    CHECK_EQ(0x78, __rd[0]);
+    CHECK_EQ(0x12, __rd[3]);
+    CHECK_EQ(0, sim_flashProtocolErrors);
+}
+
+
+static void testInvalidParams(void)
+{
+    const uint32_t size = SIM_FLASH_SIZE;
+    const uint32_t sector = SIM_FLASH_SECTOR_SIZE;
+
+    __init();
+
+    CHECK_EQ(FLASH_ERR_PARAM, flash_eraseAsync(4, sector, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_eraseAsync(0, sector + 4, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_eraseAsync(0, 0, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_eraseAsync(size - sector, 2 * sector, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_programAsync(2, __buf, 4, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_programAsync(0, __buf, 6, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_programAsync(0, NULL, 4, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_programAsync(size - 4, __buf, 8, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_programAsync(0, (const uint8_t*) BSP_FLASH_BASE_ADDRESS + sector, 4, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_programAsync(0, (const uint8_t*) BSP_FLASH_BASE_ADDRESS - 2, 4, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_read(size - 2, __rd, 4));
+    CHECK_EQ(FLASH_ERR_PARAM, flash_usePollTimer(BSP_NR_TIMERS, 0, 10));
+    CHECK_EQ(0, sim_flashNrErases + sim_flashNrBuffers);
+
+    /* one operation at a time, the flash cannot be read meanwhile */
+    CHECK_EQ(FLASH_OK, flash_eraseAsync(0, sector, NULL, NULL));
+    CHECK_EQ(1, flash_isBusy());
+    CHECK_EQ(FLASH_ERR_BUSY, flash_eraseAsync(sector, sector, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_BUSY, flash_programAsync(sector, __buf, 4, NULL, NULL));
+    CHECK_EQ(FLASH_ERR_BUSY, flash_read(sector, __rd, 4));
+    CHECK_EQ(FLASH_ERR_BUSY, flash_init());
+    CHECK_EQ(FLASH_OK, flash_wait());
+    CHECK_EQ(0, sim_flashProtocolErrors);
+}
+
+
+static void testPolledErase(void)
+{
+    const uint32_t sector = SIM_FLASH_SECTOR_SIZE;
+    const uint32_t eraseUs = (1 << SIM_FLASH_ERASE_LOG2_MS) * 1000;
+    uint32_t i;
+
+    __init();
+
+    CHECK_EQ(FLASH_OK, flash_eraseAsync(sector, 2 * sector, &__callback, &__nrCallbacks));
+    CHECK_EQ(1, sim_flashNrErases);
+    CHECK_EQ(FLASH_BUSY, flash_poll());
+
+    /* sectors are erased one by one, each of them when the previous one completes */
+    sim_timerAdvance(eraseUs - FLASH_POLL_US);
+    CHECK_EQ(FLASH_BUSY, flash_poll());
+    CHECK_EQ(1, sim_flashNrErases);
+    sim_timerAdvance(FLASH_POLL_US);
+    CHECK_EQ(FLASH_BUSY, flash_poll());
+    CHECK_EQ(2, sim_flashNrErases);
+    CHECK_EQ(0, __nrCallbacks);
+
+    sim_timerAdvance(eraseUs);
+    CHECK_EQ(FLASH_OK, flash_poll());
+    CHECK_EQ(0, flash_isBusy());
+    CHECK_EQ(1, __nrCallbacks);
+    CHECK_EQ(FLASH_OK, __cbStatus);
+    CHECK(&__nrCallbacks == __cbParam);
+
+    for ( i=0; i<SIM_FLASH_SIZE/4; ++i )
+    {
+        if ( sim_flashData[i] != ( i >= sector/4 && i < 3*sector/4 ? 0xFFFFFFFF : 0 ) )
+        {
+            break;  /* out of for */
+        }
+    }
+    CHECK_EQ(SIM_FLASH_SIZE/4, i);
+
+    /* only the erased sectors were unlocked */
+    CHECK_EQ(0xF9, sim_flashLocked);
+    CHECK_EQ(0, sim_flashProtocolErrors);
+}
+
+
+static void testBufferedProgram(void)
+{
+    const uint32_t offset = SIM_FLASH_SECTOR_SIZE + 8;
+    const uint32_t size = 200;
+
+    __init();
+
+    CHECK_EQ(FLASH_OK, flash_eraseAsync(SIM_FLASH_SECTOR_SIZE, SIM_FLASH_SECTOR_SIZE, NULL, NULL));
+    CHECK_EQ(FLASH_OK, flash_wait());
+
+    /* the first and the last buffer are partial, the source is unaligned */
+    CHECK_EQ(FLASH_OK, flash_programAsync(offset, __buf + 1, size, &__callback, NULL));
+    CHECK_EQ(FLASH_OK, flash_wait());
+    CHECK_EQ(4, sim_flashNrBuffers);
+    CHECK_EQ(1, __nrCallbacks);
+    CHECK_EQ(FLASH_OK, __cbStatus);
+
+    CHECK_EQ(FLASH_OK, flash_read(offset - 4, __rd, size + 8));
+    CHECK_EQ(0xFF, __rd[0]);
+    CHECK_EQ(0, memcmp(__rd + 4, __buf + 1, size));
+    CHECK_EQ(0xFF, __rd[size + 4]);
+
+    /* programming can only clear bits */
+    CHECK_EQ(FLASH_OK, flash_programAsync(offset, __buf + 2, 4, NULL, NULL));
+    CHECK_EQ(FLASH_OK, flash_wait());
+    CHECK_EQ(FLASH_OK, flash_read(offset, __rd, 4));
+    CHECK_EQ(__buf[1] & __buf[2], __rd[0]);
+    CHECK_EQ(0, sim_flashProtocolErrors);
+}
+
+
+static void testPollTimer(void)
+{
+    uint32_t n;
+
+    __init();
+    pic_init();
+    sim_sync();
+    CHECK_EQ(FLASH_OK, flash_usePollTimer(1, 0, 10));
+    irq_enableIrqMode();
+
+    CHECK_EQ(FLASH_OK, flash_eraseAsync(0, SIM_FLASH_SECTOR_SIZE, &__callback, NULL));
+    CHECK_EQ(1, timer_isEnabled(1, 0));
+
+    /* the timer's ISR completes the operation */
+    for ( n=0; n<10000 && 0 == __nrCallbacks; ++n )
+    {
+        sim_timerAdvance(FLASH_POLL_US);
+        sim_dispatchIrq();
+    }
+
+    CHECK_EQ((1 << SIM_FLASH_ERASE_LOG2_MS) * 1000 / FLASH_POLL_US, n);
+    CHECK_EQ(FLASH_OK, __cbStatus);
+    CHECK_EQ(0, flash_isBusy());
+    CHECK_EQ(0, timer_isEnabled(1, 0));
+    CHECK_EQ(0xFFFFFFFF, sim_flashData[0]);
+
+    /* a program of several buffers */
+    CHECK_EQ(FLASH_OK, flash_programAsync(0, __buf, sizeof(__buf), &__callback, NULL));
+    for ( n=0; n<10000 && 1 == __nrCallbacks; ++n )
+    {
+        sim_timerAdvance(FLASH_POLL_US);
+        sim_dispatchIrq();
+    }
+    CHECK_EQ(2, __nrCallbacks);
+    CHECK_EQ(FLASH_OK, __cbStatus);
+    CHECK_EQ(sizeof(__buf) / SIM_FLASH_BUFFER_SIZE, sim_flashNrBuffers);
+    CHECK_EQ(0, memcmp(sim_flashData, __buf, sizeof(__buf)));
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(0, sim_flashProtocolErrors);
+}
+
+
+static void testDeviceError(void)
+{
+    __init();
+
+    CHECK_EQ(FLASH_OK, flash_eraseAsync(0, SIM_FLASH_SECTOR_SIZE, NULL, NULL));
+    CHECK_EQ(FLASH_OK, flash_wait());
+
+    /* the operation stops at the failed buffer */
+    sim_flashFailNext = SIM_FLASH_PROGRAM_ERR;
+    CHECK_EQ(FLASH_OK, flash_programAsync(0, __buf, 4 * SIM_FLASH_BUFFER_SIZE, &__callback, NULL));
+    CHECK_EQ(FLASH_ERR_DEVICE, flash_wait());
+    CHECK_EQ(FLASH_ERR_DEVICE, __cbStatus);
+    CHECK_EQ(1, sim_flashNrBuffers);
+    CHECK_EQ(FLASH_ERR_DEVICE, flash_poll());
+
+    /* the error was cleared */
+    CHECK_EQ(FLASH_OK, flash_programAsync(0, __buf, 4, NULL, NULL));
+    CHECK_EQ(FLASH_OK, flash_wait());
+    CHECK_EQ(FLASH_OK, flash_read(0, __rd, 4));
+    CHECK_EQ(0, memcmp(__rd, __buf, 4));
+    CHECK_EQ(0, sim_flashProtocolErrors);
+}
+
+
+void test_flash(void)
+{
+    RUN_TEST(testQuery);
+    RUN_TEST(testInvalidParams);
+    RUN_TEST(testPolledErase);
+    RUN_TEST(testBufferedProgram);
+    RUN_TEST(testPollTimer);
+    RUN_TEST(testDeviceError);
+}
@@ -0,0 +1,288 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the PL061 GPIO driver (gpio.c).
+ *
+ * Input pins are driven by sim_gpioSetInputs(), levels of output pins
+ * are checked by sim_gpioGetPins().
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "gpio.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+/* Pins, passed to callbacks, in order of calls: */
+static uint8_t __pins[16];
+static uint32_t __nrCalls;
+
+
+/* Logs the pin, 'param' points to a counter that is incremented */
+static void __callback(uint8_t pin, void* param)
+{
+    if ( __nrCalls < sizeof(__pins) )
+    {
+        __pins[__nrCalls] = pin;
+    }
+
+    ++__nrCalls;
+
+    if ( NULL != param )
+    {
+        ++(*(uint32_t*) param);
+    }
+}
+
+
+/* Removes the condition of a level triggered pin by driving it low */
+static void __levelCallback(uint8_t pin, void* param)
+{
+    __callback(pin, param);
+    sim_gpioSetInputs(0, (uint8_t) (1 << pin), 0);
+}
+
+
+/* Initializes the PIC and the first controller, the IRQ mode is enabled */
+static void __init(void)
+{
+    pic_init();
+    sim_sync();
+    CHECK_EQ(GPIO_OK, gpio_init(0, 3));
+    sim_sync();
+    irq_enableIrqMode();
+    __nrCalls = 0;
+}
+
+
+static void testInit(void)
+{
+    const uint8_t irqs[BSP_NR_GPIOS] = BSP_GPIO_IRQS;
+
+    CHECK_EQ(GPIO_ERR_PARAM, gpio_init(BSP_NR_GPIOS, 3));
+    CHECK_EQ(GPIO_ERR_PARAM, gpio_registerIrq(0, GPIO_NR_PINS, GPIO_IRQ_RISING, &__callback, NULL));
+    CHECK_EQ(GPIO_ERR_PARAM, gpio_registerIrq(0, 0, GPIO_IRQ_LOW + 1, &__callback, NULL));
+    CHECK_EQ(GPIO_ERR_PARAM, gpio_registerIrq(0, 0, GPIO_IRQ_RISING, NULL, NULL));
+    CHECK_EQ(GPIO_ERR_PARAM, gpio_registerIrq(BSP_NR_GPIOS, 0, GPIO_IRQ_RISING, &__callback, NULL));
+    CHECK_EQ(0, gpio_read(BSP_NR_GPIOS, 0xFF));
+    CHECK_EQ(0, gpio_getNrIrqs(BSP_NR_GPIOS));
+
+    sim_gpioRegs[0][PL061_DIR] = 0xFF;
+    sim_gpioRegs[0][PL061_IE] = 0xFF;
+    sim_gpioRegs[0][PL061_AFSEL] = 0x0F;
+    __init();
+
+    CHECK_EQ(0, sim_gpioRegs[0][PL061_DIR]);
+    CHECK_EQ(0, sim_gpioRegs[0][PL061_IE]);
+    CHECK_EQ(0, sim_gpioRegs[0][PL061_AFSEL]);
+    CHECK( 0 != (sim_picRegs[VIC_INTENABLE] & (1UL << irqs[0])) );
+    CHECK( 0 == (sim_picRegs[VIC_INTENABLE] & (1UL << irqs[1])) );
+    CHECK_EQ(0, gpio_getNrIrqs(0));
+
+    gpio_disable(0);
+    sim_sync();
+    CHECK( 0 == (sim_picRegs[VIC_INTENABLE] & (1UL << irqs[0])) );
+}
+
+
+static void testDirection(void)
+{
+    __init();
+
+    gpio_setOutputs(0, 0x0F);
+    gpio_setOutputs(0, 0x30);
+    gpio_setInputs(0, 0x01);
+    sim_sync();
+    CHECK_EQ(0x3E, sim_gpioRegs[0][PL061_DIR]);
+
+    /* Only input pins are driven by the device */
+    sim_gpioSetInputs(0, 0xFF, 0xC3);
+    CHECK_EQ(0xC1, gpio_read(0, 0xFF));
+    CHECK_EQ(0x41, gpio_read(0, 0x7F));
+
+    /* Writes do not affect input pins */
+    gpio_write(0, 0xFF, 0x3C);
+    CHECK_EQ(0xFD, sim_gpioGetPins(0));
+    CHECK_EQ(0xFD, gpio_read(0, 0xFF));
+}
+
+
+static void testMaskedWrites(void)
+{
+    __init();
+
+    gpio_setOutputs(0, 0xFF);
+    gpio_setOutputs(1, 0xFF);
+    sim_sync();
+
+    gpio_set(0, 0x81);
+    CHECK_EQ(0x81, sim_gpioGetPins(0));
+    gpio_set(0, 0x18);
+    CHECK_EQ(0x99, sim_gpioGetPins(0));
+    gpio_clear(0, 0x11);
+    CHECK_EQ(0x88, sim_gpioGetPins(0));
+
+    /* Pins are set and cleared by a single store, without reading the pins */
+    sim_gpioNrWrites[0] = 0;
+    sim_gpioNrReads[0] = 0;
+    gpio_modify(0, 0x07, 0x88);
+    CHECK_EQ(0x07, sim_gpioGetPins(0));
+    CHECK_EQ(1, sim_gpioNrWrites[0]);
+    CHECK_EQ(0, sim_gpioNrReads[0]);
+
+    /* A pin in both masks is set */
+    gpio_modify(0, 0x10, 0x13);
+    CHECK_EQ(0x14, sim_gpioGetPins(0));
+
+    /* Values outside of the mask are ignored */
+    gpio_write(0, 0x0F, 0xFA);
+    CHECK_EQ(0x1A, sim_gpioGetPins(0));
+    CHECK_EQ(0x0A, gpio_read(0, 0x0F));
+
+    /* Other controllers are not affected */
+    CHECK_EQ(0, sim_gpioGetPins(1));
+    gpio_set(1, 0x40);
+    CHECK_EQ(0x40, sim_gpioGetPins(1));
+    CHECK_EQ(0x1A, sim_gpioGetPins(0));
+}
+
+
+static void testEdgeIrqs(void)
+{
+    uint32_t cntr = 0;
+
+    __init();
+
+    CHECK_EQ(GPIO_OK, gpio_registerIrq(0, 1, GPIO_IRQ_RISING, &__callback, &cntr));
+    CHECK_EQ(GPIO_OK, gpio_registerIrq(0, 2, GPIO_IRQ_FALLING, &__callback, &cntr));
+    CHECK_EQ(GPIO_OK, gpio_registerIrq(0, 5, GPIO_IRQ_BOTH, &__callback, &cntr));
+    sim_sync();
+    CHECK_EQ(0x26, sim_gpioRegs[0][PL061_IE]);
+    CHECK_EQ(0x00, sim_gpioRegs[0][PL061_IS]);
+    CHECK_EQ(0x20, sim_gpioRegs[0][PL061_IBE]);
+    CHECK_EQ(0x02, sim_gpioRegs[0][PL061_IEV]);
+
+    /* Rising edges of pins 1, 2 and 5 */
+    sim_gpioSetInputs(0, 0x26, 0x26);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(2, __nrCalls);
+    CHECK_EQ(1, __pins[0]);
+    CHECK_EQ(5, __pins[1]);
+    CHECK_EQ(2, cntr);
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    /* Falling edges */
+    __nrCalls = 0;
+    sim_gpioSetInputs(0, 0x26, 0x00);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(2, __nrCalls);
+    CHECK_EQ(2, __pins[0]);
+    CHECK_EQ(5, __pins[1]);
+
+    /* An edge is latched until it is handled */
+    __nrCalls = 0;
+    irq_disableIrqMode();
+    sim_gpioSetInputs(0, 0x02, 0x02);
+    sim_gpioSetInputs(0, 0x02, 0x00);
+    CHECK_EQ(0x02, sim_gpioRegs[0][PL061_MIS]);
+    irq_enableIrqMode();
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    /* Edges of disabled pins are ignored */
+    gpio_disableIrq(0, 1);
+    sim_gpioSetInputs(0, 0x02, 0x02);
+    CHECK_EQ(0, sim_dispatchIrq());
+    sim_gpioSetInputs(0, 0x02, 0x00);
+
+    /* Edges of output pins trigger interrupts as well */
+    __nrCalls = 0;
+    gpio_setOutputs(0, 0x20);
+    gpio_set(0, 0x20);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(5, __pins[0]);
+
+    /* Unregistered pins do not trigger interrupts */
+    gpio_unregisterIrq(0, 5);
+    gpio_clear(0, 0x20);
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    CHECK_EQ(4, gpio_getNrIrqs(0));
+}
+
+
+static void testLevelIrqs(void)
+{
+    uint32_t cntr = 0;
+
+    __init();
+
+    CHECK_EQ(GPIO_OK, gpio_registerIrq(0, 3, GPIO_IRQ_HIGH, &__levelCallback, &cntr));
+    CHECK_EQ(GPIO_OK, gpio_registerIrq(0, 6, GPIO_IRQ_LOW, &__callback, &cntr));
+    sim_sync();
+    CHECK_EQ(0x48, sim_gpioRegs[0][PL061_IS]);
+    CHECK_EQ(0x08, sim_gpioRegs[0][PL061_IEV]);
+
+    /* Pin 6 is low, its callback is called while it is disabled */
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(6, __pins[0]);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(2, __nrCalls);
+    gpio_disableIrq(0, 6);
+
+    /* The callback of pin 3 drives it low, so it is called once */
+    __nrCalls = 0;
+    sim_gpioSetInputs(0, 0x08, 0x08);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(3, __pins[0]);
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(3, cntr);
+
+    /* Triggers may be reconfigured */
+    __nrCalls = 0;
+    CHECK_EQ(GPIO_OK, gpio_registerIrq(0, 6, GPIO_IRQ_RISING, &__callback, NULL));
+    sim_sync();
+    CHECK_EQ(0x08, sim_gpioRegs[0][PL061_IS]);
+    CHECK_EQ(0, sim_dispatchIrq());
+    sim_gpioSetInputs(0, 0x40, 0x40);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(6, __pins[0]);
+}
+
+
+void test_gpio(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testDirection);
+    RUN_TEST(testMaskedWrites);
+    RUN_TEST(testEdgeIrqs);
+    RUN_TEST(testLevelIrqs);
+}
@@ -0,0 +1,808 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the PL190 driver (interrupt.c): registration, priority
+ * sorting and shifting of nonvectored and vectored ISRs, IRQ dispatching,
+ * rate limiting and a randomized comparison of the priority tables against a reference model.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "interrupt.h"
+#include "timer.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define NR_IRQS            32
+#define NR_VECTORS         16
+#define VECT_ENABLE        0x00000020
+
+/* Number of random operations of each fuzz test: */
+#define FUZZ_OPS           200000
+
+
+/* Defined in interrupt.c: */
+extern void _pic_set_irq_vector_mode(int8_t mode);
+
+
+/* IRQs of called ISRs, in the order of calls: */
+static uint8_t __calls[2*NR_IRQS];
+static uint8_t __nrCalls;
+
+
+static void __logCall(uint8_t irq)
+{
+    if ( __nrCalls < sizeof(__calls) )
+    {
+        __calls[__nrCalls] = irq;
+    }
+    ++__nrCalls;
+}
+
+
+/* A nonvectored ISR, its parameter is the IRQ: */
+static void __nvIsr(void* param)
+{
+    __logCall( (uint8_t) (uintptr_t) param );
+}
+
+
+/* ISR of a SIC's software triggered source, its parameter is the source: */
+static void __sicIsr(void* param)
+{
+    const uint8_t irq = (uint8_t) (uintptr_t) param;
+
+    __logCall(irq);
+    pic_clearSicSwInterrupt(irq);
+    sim_sync();
+}
+
+
+/* As above, but also triggers the next source: */
+static void __sicChainIsr(void* param)
+{
+    const uint8_t irq = (uint8_t) (uintptr_t) param;
+
+    __sicIsr(param);
+    pic_setSicSwInterrupt(irq + 1);
+    sim_sync();
+}
+
+
+/* A distinct vectored ISR for each IRQ: */
+#define VECT_ISR(N)      static void __vIsr##N(void) { __logCall(N); }
+
+VECT_ISR(0)  VECT_ISR(1)  VECT_ISR(2)  VECT_ISR(3)  VECT_ISR(4)  VECT_ISR(5)  VECT_ISR(6)  VECT_ISR(7)
+VECT_ISR(8)  VECT_ISR(9)  VECT_ISR(10) VECT_ISR(11) VECT_ISR(12) VECT_ISR(13) VECT_ISR(14) VECT_ISR(15)
+VECT_ISR(16) VECT_ISR(17) VECT_ISR(18) VECT_ISR(19) VECT_ISR(20) VECT_ISR(21) VECT_ISR(22) VECT_ISR(23)
+VECT_ISR(24) VECT_ISR(25) VECT_ISR(26) VECT_ISR(27) VECT_ISR(28) VECT_ISR(29) VECT_ISR(30) VECT_ISR(31)
+
+#undef VECT_ISR
+
+static const pVectoredIsrPrototype __vIsr[NR_IRQS] =
+{
+    __vIsr0,  __vIsr1,  __vIsr2,  __vIsr3,  __vIsr4,  __vIsr5,  __vIsr6,  __vIsr7,
+    __vIsr8,  __vIsr9,  __vIsr10, __vIsr11, __vIsr12, __vIsr13, __vIsr14, __vIsr15,
+    __vIsr16, __vIsr17, __vIsr18, __vIsr19, __vIsr20, __vIsr21, __vIsr22, __vIsr23,
+    __vIsr24, __vIsr25, __vIsr26, __vIsr27, __vIsr28, __vIsr29, __vIsr30, __vIsr31
+};
+
+
+/*
+ * Reference model of a priority table: entries sorted by descending priority,
+ * a (re)registered entry is placed after all entries with equal priority.
+ */
+typedef struct _refTable
+{
+    uint8_t n;
+    uint8_t irq[NR_IRQS];
+    uint8_t prio[NR_IRQS];
+} refTable;
+
+
+static void __refRemove(refTable* t, uint8_t irq)
+{
+    uint8_t i;
+
+    for ( i=0; i<t->n && t->irq[i]!=irq; ++i );
+
+    if ( i == t->n )
+    {
+        return;
+    }
+
+    for ( --t->n; i<t->n; ++i )
+    {
+        t->irq[i] = t->irq[i+1];
+        t->prio[i] = t->prio[i+1];
+    }
+}
+
+
+static uint8_t __refInsert(refTable* t, uint8_t irq, uint8_t priority)
+{
+    const uint8_t prio = ( priority > 127 ? 127 : priority );
+    uint8_t pos;
+    uint8_t i;
+
+    __refRemove(t, irq);
+
+    for ( pos=0; pos<t->n && t->prio[pos]>=prio; ++pos );
+
+    for ( i=t->n; i>pos; --i )
+    {
+        t->irq[i] = t->irq[i-1];
+        t->prio[i] = t->prio[i-1];
+    }
+
+    t->irq[pos] = irq;
+    t->prio[pos] = prio;
+    ++t->n;
+
+    return pos;
+}
+
+
+/* A simple deterministic pseudo random generator (LCG from "Numerical Recipes"): */
+static uint32_t __seed;
+
+static uint32_t __rand(void)
+{
+    __seed = __seed * 1664525 + 1013904223;
+    return __seed >> 8;
+}
+
+
+/*
+ * Triggers all IRQs in nonvectored mode and returns the number of called ISRs.
+ * Their IRQs (i.e. the order of the priority table) are in __calls.
+ */
+static uint8_t __dispatchAllNv(void)
+{
+    _pic_set_irq_vector_mode(0);
+    sim_picRegs[VIC_INTENABLE] = 0xFFFFFFFF;
+    sim_picRegs[VIC_SOFTINT] = 0xFFFFFFFF;
+
+    /* the IRQ is taken as soon as the IRQ mode is enabled */
+    __nrCalls = 0;
+    irq_enableIrqMode();
+    irq_disableIrqMode();
+
+    sim_picRegs[VIC_SOFTINTCLEAR] = 0xFFFFFFFF;
+    sim_sync();
+
+    return __nrCalls;
+}
+
+
+static void __checkVectorRegs(const refTable* t)
+{
+    uint8_t i;
+
+    for ( i=0; i<NR_VECTORS; ++i )
+    {
+        if ( i < t->n )
+        {
+            CHECK_EQ(t->irq[i] | VECT_ENABLE, sim_picRegs[VIC_VECTCNTLn + i]);
+            CHECK_EQ((uint32_t) (uintptr_t) __vIsr[t->irq[i]], sim_picRegs[VIC_VECTADDRn + i]);
+        }
+        else
+        {
+            CHECK_EQ(0, sim_picRegs[VIC_VECTCNTLn + i]);
+        }
+    }
+}
+
+
+static void testInit(void)
+{
+    uint8_t i;
+
+    sim_picRegs[VIC_INTENABLE] = 0x1234;
+    sim_picRegs[VIC_SOFTINT] = 0x10;
+    sim_picRegs[VIC_INTSELECT] = 0x20;
+
+    pic_init();
+    sim_sync();
+
+    CHECK_EQ(0, sim_picRegs[VIC_INTENABLE]);
+    CHECK_EQ(0, sim_picRegs[VIC_SOFTINT]);
+    CHECK_EQ(0, sim_picRegs[VIC_INTSELECT]);
+    CHECK(0 != sim_picRegs[VIC_DEFVECTADDR]);
+
+    for ( i=0; i<NR_VECTORS; ++i )
+    {
+        CHECK_EQ(0, sim_picRegs[VIC_VECTCNTLn + i]);
+        CHECK_EQ(sim_picRegs[VIC_VECTADDRn], sim_picRegs[VIC_VECTADDRn + i]);
+    }
+
+    CHECK_EQ(0, __dispatchAllNv());
+}
+
+
+static void testEnableDisable(void)
+{
+    pic_init();
+    sim_sync();
+
+    pic_enableInterrupt(4);
+    pic_enableInterrupt(12);
+    pic_enableInterrupt(32);
+    sim_sync();
+    CHECK_EQ(0x1010, sim_picRegs[VIC_INTENABLE]);
+    CHECK(pic_isInterruptEnabled(4));
+    CHECK(!pic_isInterruptEnabled(5));
+    CHECK(!pic_isInterruptEnabled(32));
+
+    pic_disableInterrupt(4);
+    sim_sync();
+    CHECK_EQ(0x1000, sim_picRegs[VIC_INTENABLE]);
+
+    pic_setInterruptType(12, 0);
+    CHECK_EQ(0x1000, sim_picRegs[VIC_INTSELECT]);
+    CHECK_EQ(0, pic_getInterruptType(12));
+    pic_setInterruptType(12, 1);
+    CHECK_EQ(0, sim_picRegs[VIC_INTSELECT]);
+    CHECK_EQ(1, pic_getInterruptType(12));
+
+    pic_disableAllInterrupts();
+    sim_sync();
+    CHECK_EQ(0, sim_picRegs[VIC_INTENABLE]);
+}
+
+
+static void testSoftwareInterrupts(void)
+{
+    pic_init();
+    sim_sync();
+
+    CHECK_EQ(BSP_SOFTWARE_IRQ, pic_setSoftwareInterrupt());
+    sim_sync();
+    CHECK_EQ(1 << BSP_SOFTWARE_IRQ, sim_picRegs[VIC_RAWINTR]);
+    CHECK_EQ(0, sim_picRegs[VIC_IRQSTATUS]);
+
+    pic_enableInterrupt(BSP_SOFTWARE_IRQ);
+    sim_sync();
+    CHECK_EQ(1 << BSP_SOFTWARE_IRQ, sim_picRegs[VIC_IRQSTATUS]);
+
+    CHECK_EQ(BSP_SOFTWARE_IRQ, pic_clearSoftwareInterrupt());
+    sim_sync();
+    CHECK_EQ(0, sim_picRegs[VIC_RAWINTR]);
+
+    /* not active anymore */
+    CHECK(pic_clearSoftwareInterrupt() < 0);
+    CHECK(pic_setSwInterruptNr(32) < 0);
+    CHECK(pic_clearSwInterruptNr(32) < 0);
+}
+
+
+static void testIrqMode(void)
+{
+    irq_enableIrqMode();
+    CHECK(sim_isIrqModeEnabled());
+    irq_disableIrqMode();
+    CHECK(!sim_isIrqModeEnabled());
+}
+
+
+static void testNvPriorityOrder(void)
+{
+    pic_init();
+    sim_sync();
+
+    CHECK_EQ(0, pic_registerNonVectoredIrq(3, &__nvIsr, (void*) 3, 10));
+    CHECK_EQ(0, pic_registerNonVectoredIrq(7, &__nvIsr, (void*) 7, 50));
+    CHECK_EQ(2, pic_registerNonVectoredIrq(1, &__nvIsr, (void*) 1, 10));
+    CHECK_EQ(1, pic_registerNonVectoredIrq(20, &__nvIsr, (void*) 20, 50));
+    /* priorities above 127 are truncated to 127 */
+    CHECK_EQ(0, pic_registerNonVectoredIrq(9, &__nvIsr, (void*) 9, 200));
+    CHECK_EQ(1, pic_registerNonVectoredIrq(8, &__nvIsr, (void*) 8, 127));
+
+    CHECK_EQ(6, __dispatchAllNv());
+    CHECK_EQ(9, __calls[0]);
+    CHECK_EQ(8, __calls[1]);
+    CHECK_EQ(7, __calls[2]);
+    CHECK_EQ(20, __calls[3]);
+    CHECK_EQ(3, __calls[4]);
+    CHECK_EQ(1, __calls[5]);
+
+    /* invalid parameters */
+    CHECK(pic_registerNonVectoredIrq(32, &__nvIsr, NULL, 1) < 0);
+    CHECK(pic_registerNonVectoredIrq(5, NULL, NULL, 1) < 0);
+    CHECK_EQ(6, __dispatchAllNv());
+}
+
+
+static void testNvReregisterAndUnregister(void)
+{
+    pic_init();
+    sim_sync();
+
+    pic_registerNonVectoredIrq(1, &__nvIsr, (void*) 1, 30);
+    pic_registerNonVectoredIrq(2, &__nvIsr, (void*) 2, 20);
+    pic_registerNonVectoredIrq(3, &__nvIsr, (void*) 3, 10);
+
+    /* moved down, behind the entry with equal priority */
+    CHECK_EQ(1, pic_registerNonVectoredIrq(1, &__nvIsr, (void*) 1, 20));
+    /* moved up */
+    CHECK_EQ(0, pic_registerNonVectoredIrq(3, &__nvIsr, (void*) 3, 40));
+
+    CHECK_EQ(3, __dispatchAllNv());
+    CHECK_EQ(3, __calls[0]);
+    CHECK_EQ(2, __calls[1]);
+    CHECK_EQ(1, __calls[2]);
+
+    pic_unregisterNonVectoredIrq(2);
+    pic_unregisterNonVectoredIrq(2);
+    pic_unregisterNonVectoredIrq(32);
+
+    CHECK_EQ(2, __dispatchAllNv());
+    CHECK_EQ(3, __calls[0]);
+    CHECK_EQ(1, __calls[1]);
+}
+
+
+static void testNvOnlyActiveIrqs(void)
+{
+    pic_init();
+    sim_sync();
+
+    pic_registerNonVectoredIrq(4, &__nvIsr, (void*) 4, 5);
+    pic_registerNonVectoredIrq(5, &__nvIsr, (void*) 5, 5);
+    pic_enableInterrupt(4);
+    pic_enableInterrupt(5);
+
+    pic_setSwInterruptNr(5);
+    irq_enableIrqMode();
+    __nrCalls = 0;
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(5, __calls[0]);
+
+    /* disabled IRQs are not dispatched */
+    pic_disableInterrupt(5);
+    __nrCalls = 0;
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(0, __nrCalls);
+    irq_disableIrqMode();
+}
+
+
+static void testSicCascade(void)
+{
+    pic_init();
+    sim_sync();
+
+    CHECK(pic_enableSicCascade(5) >= 0);
+    CHECK_EQ(-1, pic_registerSicIrq(32, &__sicIsr, NULL));
+    CHECK_EQ(-1, pic_registerSicIrq(3, NULL, NULL));
+    CHECK_EQ(3, pic_registerSicIrq(3, &__sicIsr, (void*) 3));
+    CHECK_EQ(7, pic_registerSicIrq(7, &__sicIsr, (void*) 7));
+    pic_enableSicInterrupt(3);
+    pic_enableSicInterrupt(7);
+    pic_enableSicInterrupt(9);
+    sim_sync();
+    CHECK_EQ(0x00000288, sim_sicRegs[SIC_ENABLE]);
+    CHECK( 0 != (sim_picRegs[VIC_INTENABLE] & (1UL << BSP_SIC_IRQ)) );
+
+    /* Pending sources are dispatched in ascending order by a single IRQ */
+    pic_setSicSwInterrupt(7);
+    pic_setSicSwInterrupt(3);
+    pic_setSicSwInterrupt(12);
+    sim_sync();
+    CHECK_EQ(0x00001088, sim_sicRegs[SIC_RAWSTAT]);
+    CHECK_EQ(0x00000088, sim_sicRegs[SIC_STATUS]);
+    CHECK( 0 != (sim_picRegs[VIC_IRQSTATUS] & (1UL << BSP_SIC_IRQ)) );
+
+    /* The pending IRQ is taken as soon as the IRQ mode is enabled */
+    __nrCalls = 0;
+    irq_enableIrqMode();
+    CHECK_EQ(2, __nrCalls);
+    CHECK_EQ(3, __calls[0]);
+    CHECK_EQ(7, __calls[1]);
+
+    /* A disabled source does not trigger the cascade */
+    CHECK_EQ(0, sim_dispatchIrq());
+    pic_clearSicSwInterrupt(12);
+
+    /* An enabled source without an ISR is disabled */
+    pic_setSicSwInterrupt(9);
+    sim_sync();
+    __nrCalls = 0;
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(0, __nrCalls);
+    sim_sync();
+    CHECK_EQ(0x00000088, sim_sicRegs[SIC_ENABLE]);
+    CHECK_EQ(0, sim_dispatchIrq());
+    pic_clearSicSwInterrupt(9);
+
+    /* Sources, triggered while the cascade is active, are serviced by the same IRQ */
+    CHECK_EQ(3, pic_registerSicIrq(3, &__sicChainIsr, (void*) 3));
+    CHECK_EQ(4, pic_registerSicIrq(4, &__sicIsr, (void*) 4));
+    pic_enableSicInterrupt(4);
+    pic_setSicSwInterrupt(3);
+    sim_sync();
+    __nrCalls = 0;
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(2, __nrCalls);
+    CHECK_EQ(3, __calls[0]);
+    CHECK_EQ(4, __calls[1]);
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    /* Unregistered sources are disabled */
+    pic_unregisterSicIrq(7);
+    sim_sync();
+    CHECK_EQ(0x00000018, sim_sicRegs[SIC_ENABLE]);
+
+    pic_disableSicCascade();
+    sim_sync();
+    CHECK( 0 == (sim_picRegs[VIC_INTENABLE] & (1UL << BSP_SIC_IRQ)) );
+    pic_setSicSwInterrupt(4);
+    sim_sync();
+    CHECK_EQ(0, sim_dispatchIrq());
+    irq_disableIrqMode();
+
+    /* pic_init() disables all sources and clears software interrupts */
+    pic_init();
+    sim_sync();
+    CHECK_EQ(0, sim_sicRegs[SIC_ENABLE]);
+    CHECK_EQ(0, sim_sicRegs[SIC_RAWSTAT]);
+}
+
+
+static void testRateLimit(void)
+{
+    picIrqLimitStats stats;
+    uint8_t i;
+
+    pic_init();
+    sim_sync();
+
+    CHECK_EQ(-1, pic_setIrqRateLimit(0, 3, 1000));
+    CHECK_EQ(-1, pic_useRateLimitTimer(BSP_NR_TIMERS, 0, 20));
+    CHECK_EQ(-1, pic_useRateLimitTimer(1, timer_countersPerTimer(), 20));
+    CHECK_EQ(0, pic_useRateLimitTimer(1, 1, 20));
+    CHECK_EQ(-1, pic_setIrqRateLimit(NR_IRQS, 3, 1000));
+    CHECK_EQ(-1, pic_setIrqRateLimit(0, 3, 0));
+    CHECK_EQ(-1, pic_getIrqLimitStats(0, NULL));
+    CHECK_EQ(0, pic_setIrqRateLimit(0, 3, 1000));
+    CHECK_EQ(-1, pic_useRateLimitTimer(1, 1, 20));
+
+    /* Line 0 storms, i.e. its ISR never deasserts it, line 2 is not limited */
+    CHECK(pic_registerNonVectoredIrq(0, &__nvIsr, (void*) 0, 5) >= 0);
+    CHECK(pic_registerNonVectoredIrq(2, &__nvIsr, (void*) 2, 5) >= 0);
+    pic_enableInterrupt(0);
+    pic_enableInterrupt(2);
+    irq_enableIrqMode();
+    sim_setIrqLine(0, 1);
+
+    __nrCalls = 0;
+    for ( i=0; i<3; ++i )
+    {
+        CHECK_EQ(1, sim_dispatchIrq());
+    }
+    CHECK_EQ(3, __nrCalls);
+    CHECK_EQ(0, pic_isIrqThrottled(0));
+
+    /* The 4th request within the window masks the line */
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(3, __nrCalls);
+    CHECK_EQ(1, pic_isIrqThrottled(0));
+    CHECK_EQ(0, pic_isInterruptEnabled(0));
+    CHECK( 0 != timer_isEnabled(1, 1) );
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    /* Other lines are serviced meanwhile */
+    sim_setIrqLine(2, 1);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(4, __nrCalls);
+    CHECK_EQ(2, __calls[3]);
+    sim_setIrqLine(2, 0);
+
+    /* The line is re-enabled after the window (or a tick before), pending requests are coalesced */
+    sim_timerAdvance(998);
+    CHECK_EQ(0, sim_dispatchIrq());
+    sim_timerAdvance(1);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(0, pic_isIrqThrottled(0));
+    CHECK_EQ(1, pic_isInterruptEnabled(0));
+    CHECK_EQ(0, timer_isEnabled(1, 1));
+    CHECK_EQ(4, __nrCalls);
+
+    /* A new window starts at the release */
+    for ( i=0; i<4; ++i )
+    {
+        CHECK_EQ(1, sim_dispatchIrq());
+    }
+    CHECK_EQ(7, __nrCalls);
+    CHECK_EQ(1, pic_isIrqThrottled(0));
+
+    CHECK_EQ(0, pic_getIrqLimitStats(0, &stats));
+    CHECK_EQ(6, stats.serviced);
+    CHECK_EQ(2, stats.throttled);
+    CHECK_EQ(0, pic_getIrqLimitStats(2, &stats));
+    CHECK_EQ(0, stats.serviced + stats.throttled);
+
+    /* A line, disabled by the application, is not re-enabled (the counter stopped at 0 reloads at its first tick) */
+    pic_disableInterrupt(0);
+    CHECK_EQ(0, pic_isIrqThrottled(0));
+    sim_timerAdvance(1001);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(0, pic_isInterruptEnabled(0));
+    CHECK_EQ(0, timer_isEnabled(1, 1));
+
+    /* Removing the limit releases a throttled line */
+    pic_enableInterrupt(0);
+    for ( i=0; i<4; ++i )
+    {
+        CHECK_EQ(1, sim_dispatchIrq());
+    }
+    CHECK_EQ(1, pic_isIrqThrottled(0));
+    irq_disableIrqMode();
+    CHECK_EQ(0, pic_setIrqRateLimit(0, 0, 0));
+    CHECK_EQ(0, pic_isIrqThrottled(0));
+    CHECK_EQ(1, pic_isInterruptEnabled(0));
+    irq_enableIrqMode();
+
+    __nrCalls = 0;
+    for ( i=0; i<10; ++i )
+    {
+        sim_dispatchIrq();
+    }
+    CHECK_EQ(10, __nrCalls);
+
+    pic_resetIrqLimitStats(0);
+    pic_getIrqLimitStats(0, &stats);
+    CHECK_EQ(0, stats.serviced + stats.throttled);
+
+    /* Limits are not applied in the vectored mode, switching to it removes them */
+    CHECK_EQ(0, pic_setIrqRateLimit(0, 3, 1000));
+    for ( i=0; i<4; ++i )
+    {
+        CHECK_EQ(1, sim_dispatchIrq());
+    }
+    CHECK_EQ(1, pic_isIrqThrottled(0));
+    _pic_set_irq_vector_mode(1);
+    CHECK_EQ(0, pic_isIrqThrottled(0));
+    CHECK_EQ(1, pic_isInterruptEnabled(0));
+    CHECK_EQ(0, timer_isEnabled(1, 1));
+    CHECK_EQ(-1, pic_setIrqRateLimit(0, 3, 1000));
+    CHECK_EQ(0, pic_setIrqRateLimit(0, 0, 0));
+    _pic_set_irq_vector_mode(0);
+
+    sim_setIrqLine(0, 0);
+    irq_disableIrqMode();
+}
+
+
+static void testVectorRegisters(void)
+{
+    refTable ref = { 0 };
+    uint8_t i;
+
+    pic_init();
+    sim_sync();
+
+    /* more IRQs than vector slots, with increasing priority */
+    for ( i=0; i<20; ++i )
+    {
+        CHECK_EQ(0, pic_registerVectorIrq(i, __vIsr[i], i));
+        __refInsert(&ref, i, i);
+    }
+    __checkVectorRegs(&ref);
+
+    pic_unregisterVectorIrq(19);
+    __refRemove(&ref, 19);
+    pic_unregisterVectorIrq(0);
+    __refRemove(&ref, 0);
+    __checkVectorRegs(&ref);
+
+    CHECK_EQ(2, pic_enableVectorIrq(16));
+    pic_disableVectorIrq(16);
+    CHECK_EQ(16, sim_picRegs[VIC_VECTCNTLn + 2]);
+    /* only the first 16 entries occupy vector slots */
+    CHECK(pic_enableVectorIrq(2) < 0);
+
+    pic_disableAllVectorIrqs();
+    for ( i=0; i<NR_VECTORS; ++i )
+    {
+        CHECK_EQ(0, sim_picRegs[VIC_VECTCNTLn + i] & VECT_ENABLE);
+    }
+
+    pic_unregisterAllVectorIrqs();
+    ref.n = 0;
+    __checkVectorRegs(&ref);
+
+    /* no stale entries must remain beyond the vector slots */
+    CHECK_EQ(0, pic_registerVectorIrq(5, __vIsr[5], 1));
+    ref.n = 0;
+    __refInsert(&ref, 5, 1);
+    __checkVectorRegs(&ref);
+}
+
+
+static void testVectorDispatch(void)
+{
+    uint8_t i;
+
+    pic_init();
+    sim_sync();
+
+    /* IRQ i gets priority 31-i, IRQs 16..31 are serviced by the default vector ISR */
+    for ( i=0; i<NR_IRQS; ++i )
+    {
+        pic_registerVectorIrq(i, __vIsr[i], 31-i);
+    }
+
+    _pic_set_irq_vector_mode(1);
+    irq_enableIrqMode();
+
+    for ( i=0; i<NR_IRQS; ++i )
+    {
+        pic_disableAllInterrupts();
+        sim_sync();
+        pic_enableInterrupt(i);
+        pic_setSwInterruptNr(i);
+
+        __nrCalls = 0;
+        CHECK_EQ(1, sim_dispatchIrq());
+        CHECK_EQ(1, __nrCalls);
+        CHECK_EQ(i, __calls[0]);
+
+        pic_clearSwInterruptNr(i);
+    }
+
+    /* the highest priority active vectored IRQ is serviced first */
+    pic_disableAllInterrupts();
+    sim_sync();
+    pic_enableInterrupt(3);
+    pic_enableInterrupt(9);
+    pic_setSwInterruptNr(9);
+    pic_setSwInterruptNr(3);
+    __nrCalls = 0;
+    sim_dispatchIrq();
+    CHECK_EQ(1, __nrCalls);
+    CHECK_EQ(3, __calls[0]);
+
+    irq_disableIrqMode();
+    _pic_set_irq_vector_mode(0);
+}
+
+
+/*
+ * Random sequences of registrations and unregistrations of nonvectored IRQs,
+ * the resulting dispatch order is compared against the reference model.
+ */
+static void testNvFuzz(void)
+{
+    refTable ref = { 0 };
+    uint32_t op;
+    uint8_t irq;
+    uint8_t prio;
+    uint8_t i;
+    unsigned long failures = unit_nrFailures;
+
+    __seed = 0x5EED0001;
+    pic_init();
+    sim_sync();
+
+    for ( op=0; op<FUZZ_OPS && failures==unit_nrFailures; ++op )
+    {
+        irq = __rand() % NR_IRQS;
+        prio = __rand() % 256;
+
+        if ( __rand() % 3 )
+        {
+            CHECK_EQ(__refInsert(&ref, irq, prio),
+                     pic_registerNonVectoredIrq(irq, &__nvIsr, (void*) (uintptr_t) irq, prio));
+        }
+        else
+        {
+            pic_unregisterNonVectoredIrq(irq);
+            __refRemove(&ref, irq);
+        }
+
+        /* Dispatching is relatively slow, so it is only checked periodically */
+        if ( 0 == (op & 0x0F) )
+        {
+            CHECK_EQ(ref.n, __dispatchAllNv());
+            for ( i=0; i<ref.n; ++i )
+            {
+                CHECK_EQ(ref.irq[i], __calls[i]);
+            }
+        }
+    }
+
+    if ( failures != unit_nrFailures )
+    {
+        printf("    failed at operation %u\n", op - 1);
+    }
+}
+
+
+/*
+ * Random sequences of registrations and unregistrations of vectored IRQs,
+ * the resulting vector registers are compared against the reference model.
+ */
+static void testVectorFuzz(void)
+{
+    refTable ref = { 0 };
+    uint32_t op;
+    uint8_t irq;
+    uint8_t prio;
+    uint32_t r;
+    unsigned long failures = unit_nrFailures;
+
+    __seed = 0x5EED0002;
+    pic_init();
+    sim_sync();
+
+    for ( op=0; op<FUZZ_OPS && failures==unit_nrFailures; ++op )
+    {
+        irq = __rand() % NR_IRQS;
+        prio = __rand() % 256;
+        r = __rand() % 64;
+
+        if ( 0 == r )
+        {
+            pic_unregisterAllVectorIrqs();
+            ref.n = 0;
+        }
+        else if ( r < 40 )
+        {
+            CHECK_EQ(__refInsert(&ref, irq, prio), pic_registerVectorIrq(irq, __vIsr[irq], prio));
+        }
+        else
+        {
+            pic_unregisterVectorIrq(irq);
+            __refRemove(&ref, irq);
+        }
+
+        __checkVectorRegs(&ref);
+    }
+
+    if ( failures != unit_nrFailures )
+    {
+        printf("    failed at operation %u\n", op - 1);
+    }
+}
+
+
+void test_interrupt(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testEnableDisable);
+    RUN_TEST(testSoftwareInterrupts);
+    RUN_TEST(testIrqMode);
+    RUN_TEST(testNvPriorityOrder);
+    RUN_TEST(testNvReregisterAndUnregister);
+    RUN_TEST(testNvOnlyActiveIrqs);
+    RUN_TEST(testSicCascade);
+    RUN_TEST(testRateLimit);
+    RUN_TEST(testVectorRegisters);
+    RUN_TEST(testVectorDispatch);
+    RUN_TEST(testNvFuzz);
+    RUN_TEST(testVectorFuzz);
+}
@@ -0,0 +1,331 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the PL050 KMI driver (kmi.c).
+ *
+ * Bytes, sent by the simulated devices, are injected into the KMIs'
+ * receive queues, they reach the driver's ISRs via the SIC's cascade.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "kmi.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+/* Initializes the PIC and the KMI, the IRQ mode is enabled */
+static void __init(uint8_t nr)
+{
+    pic_init();
+    sim_sync();
+    CHECK_EQ(KMI_OK, kmi_init(nr, 3));
+    sim_sync();
+    irq_enableIrqMode();
+}
+
+
+/* Injects bytes into the keyboard's queue and handles the triggered IRQ */
+static void __inject(const uint8_t* bytes, uint32_t count)
+{
+    CHECK_EQ(count, sim_kmiInject(0, bytes, count));
+    CHECK_EQ(1, sim_dispatchIrq());
+}
+
+
+/* Checks the next key event of the keyboard */
+static void __checkKey(uint8_t code, uint8_t flags, uint8_t modifiers, char ascii)
+{
+    kmiKeyEvent ev;
+
+    CHECK_EQ(1, kmi_getKey(0, &ev));
+    CHECK_EQ(code, ev.code);
+    CHECK_EQ(flags, ev.flags);
+    CHECK_EQ(modifiers, ev.modifiers);
+    CHECK_EQ(ascii, ev.ascii);
+}
+
+
+static void testInit(void)
+{
+    const uint8_t kmiIrqs[BSP_NR_KMIS] = BSP_KMI_SIC_IRQS;
+    kmiStats stats;
+
+    CHECK_EQ(KMI_ERR_PARAM, kmi_init(BSP_NR_KMIS, 3));
+    CHECK_EQ(KMI_ERR_NOINIT, kmi_write(0, 0xFF));
+    CHECK_EQ(KMI_ERR_PARAM, kmi_getStats(0, NULL));
+    CHECK_EQ(-1, kmi_readByte(BSP_NR_KMIS));
+    CHECK_EQ(0, kmi_available(BSP_NR_KMIS));
+
+    __init(0);
+
+    CHECK_EQ(0x14, sim_kmiRegs[0][PL050_CR]);
+    CHECK_EQ(2, sim_kmiRegs[0][PL050_CLKDIV]);
+    CHECK_EQ(0, sim_kmiRegs[1][PL050_CR]);
+    CHECK_EQ(1UL << kmiIrqs[0], sim_sicRegs[SIC_ENABLE]);
+    CHECK( 0 != (sim_picRegs[VIC_INTENABLE] & (1UL << BSP_SIC_IRQ)) );
+
+    CHECK_EQ(0, kmi_available(0));
+    CHECK_EQ(-1, kmi_readByte(0));
+    CHECK_EQ(KMI_OK, kmi_getStats(0, &stats));
+    CHECK_EQ(0, stats.irqs);
+    CHECK_EQ(0, stats.bytes);
+}
+
+
+static void testReceive(void)
+{
+    const uint8_t bytes[] = { 0x1C, 0xF0, 0x1C, 0x00 };
+    kmiStats stats;
+
+    __init(0);
+
+    __inject(bytes, sizeof(bytes));
+    CHECK_EQ(0, sim_kmiRegs[0][PL050_IR]);
+    CHECK_EQ(sizeof(bytes), kmi_available(0));
+    CHECK_EQ(0x1C, kmi_readByte(0));
+    CHECK_EQ(0xF0, kmi_readByte(0));
+    CHECK_EQ(0x1C, kmi_readByte(0));
+    CHECK_EQ(0x00, kmi_readByte(0));
+    CHECK_EQ(-1, kmi_readByte(0));
+
+    /* No IRQ without received bytes */
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    CHECK_EQ(KMI_OK, kmi_getStats(0, &stats));
+    CHECK_EQ(1, stats.irqs);
+    CHECK_EQ(sizeof(bytes), stats.bytes);
+    CHECK_EQ(sizeof(bytes), stats.maxLevel);
+    CHECK_EQ(0, stats.overruns);
+
+    kmi_resetStats(0);
+    CHECK_EQ(KMI_OK, kmi_getStats(0, &stats));
+    CHECK_EQ(0, stats.irqs);
+    CHECK_EQ(0, stats.maxLevel);
+}
+
+
+static void testTranslate(void)
+{
+    /* a, Shift+a, Caps, a, Shift+a, Caps */
+    const uint8_t letters[] =
+        { 0x1C, 0xF0, 0x1C,
+          0x12, 0x1C, 0xF0, 0x1C, 0xF0, 0x12,
+          0x58, 0xF0, 0x58, 0x1C, 0xF0, 0x1C,
+          0x59, 0x1C, 0xF0, 0x1C, 0xF0, 0x59,
+          0x58, 0xF0, 0x58 };
+    /* Shift+1, Ctrl (right)+c, keypad Enter, an acknowledge, Pause, Esc */
+    const uint8_t others[] =
+        { 0x12, 0x16, 0xF0, 0x16, 0xF0, 0x12,
+          0xE0, 0x14, 0x21, 0xE0, 0xF0, 0x14,
+          0xE0, 0x5A, 0xE0, 0xF0, 0x5A,
+          0xFA,
+          0xE1, 0x14, 0x77, 0xE1, 0xF0, 0x14, 0xF0, 0x77,
+          0x76 };
+    kmiKeyEvent ev;
+
+    __init(0);
+    CHECK_EQ(KMI_ERR_PARAM, kmi_getKey(0, NULL));
+    CHECK_EQ(0, kmi_getKey(0, &ev));
+
+    __inject(letters, sizeof(letters));
+
+    __checkKey(0x1C, 0, 0, 'a');
+    __checkKey(0x1C, KMI_KEY_RELEASED, 0, 0);
+
+    __checkKey(0x12, 0, KMI_MOD_SHIFT, 0);
+    __checkKey(0x1C, 0, KMI_MOD_SHIFT, 'A');
+    __checkKey(0x1C, KMI_KEY_RELEASED, KMI_MOD_SHIFT, 0);
+    __checkKey(0x12, KMI_KEY_RELEASED, 0, 0);
+
+    __checkKey(0x58, 0, KMI_MOD_CAPS, 0);
+    __checkKey(0x58, KMI_KEY_RELEASED, KMI_MOD_CAPS, 0);
+    __checkKey(0x1C, 0, KMI_MOD_CAPS, 'A');
+    __checkKey(0x1C, KMI_KEY_RELEASED, KMI_MOD_CAPS, 0);
+
+    __checkKey(0x59, 0, KMI_MOD_CAPS | KMI_MOD_SHIFT, 0);
+    __checkKey(0x1C, 0, KMI_MOD_CAPS | KMI_MOD_SHIFT, 'a');
+    __checkKey(0x1C, KMI_KEY_RELEASED, KMI_MOD_CAPS | KMI_MOD_SHIFT, 0);
+    __checkKey(0x59, KMI_KEY_RELEASED, KMI_MOD_CAPS, 0);
+
+    __checkKey(0x58, 0, 0, 0);
+    __checkKey(0x58, KMI_KEY_RELEASED, 0, 0);
+    CHECK_EQ(0, kmi_getKey(0, &ev));
+
+    __inject(others, sizeof(others));
+
+    __checkKey(0x12, 0, KMI_MOD_SHIFT, 0);
+    __checkKey(0x16, 0, KMI_MOD_SHIFT, '!');
+    __checkKey(0x16, KMI_KEY_RELEASED, KMI_MOD_SHIFT, 0);
+    __checkKey(0x12, KMI_KEY_RELEASED, 0, 0);
+
+    __checkKey(0x14, KMI_KEY_EXTENDED, KMI_MOD_CTRL, 0);
+    __checkKey(0x21, 0, KMI_MOD_CTRL, 0x03);
+    __checkKey(0x14, KMI_KEY_EXTENDED | KMI_KEY_RELEASED, 0, 0);
+
+    __checkKey(0x5A, KMI_KEY_EXTENDED, 0, '\r');
+    __checkKey(0x5A, KMI_KEY_EXTENDED | KMI_KEY_RELEASED, 0, 0);
+
+    /* The acknowledge and the Pause sequence are skipped */
+    __checkKey(0x76, 0, 0, 0x1B);
+    CHECK_EQ(0, kmi_getKey(0, &ev));
+}
+
+
+static void testPartialSequence(void)
+{
+    const uint8_t prefixes[] = { 0xE0, 0xF0 };
+    const uint8_t code[] = { 0x4A };
+    kmiKeyEvent ev;
+
+    __init(0);
+
+    /* Prefixes are kept until the scancode is received */
+    __inject(prefixes, sizeof(prefixes));
+    CHECK_EQ(0, kmi_getKey(0, &ev));
+    __inject(code, sizeof(code));
+    __checkKey(0x4A, KMI_KEY_EXTENDED | KMI_KEY_RELEASED, 0, 0);
+}
+
+
+static void testOverrun(void)
+{
+    uint8_t bytes[KMI_RX_BUF_SIZE + 10];
+    kmiStats stats;
+    uint32_t i;
+
+    for ( i=0; i<sizeof(bytes); ++i )
+    {
+        bytes[i] = (uint8_t) i;
+    }
+
+    __init(0);
+
+    /* All bytes are read from the controller, the excessive ones are discarded */
+    __inject(bytes, sizeof(bytes));
+    CHECK_EQ(0, sim_kmiRegs[0][PL050_IR]);
+    CHECK_EQ(KMI_RX_BUF_SIZE, kmi_available(0));
+
+    CHECK_EQ(KMI_OK, kmi_getStats(0, &stats));
+    CHECK_EQ(sizeof(bytes), stats.bytes);
+    CHECK_EQ(10, stats.overruns);
+    CHECK_EQ(KMI_RX_BUF_SIZE, stats.maxLevel);
+
+    for ( i=0; i<KMI_RX_BUF_SIZE; ++i )
+    {
+        CHECK_EQ(i, kmi_readByte(0));
+    }
+    CHECK_EQ(-1, kmi_readByte(0));
+
+    /* The buffer wraps */
+    __inject(bytes, 10);
+    for ( i=0; i<10; ++i )
+    {
+        CHECK_EQ(i, kmi_readByte(0));
+    }
+}
+
+
+static void testBothKmis(void)
+{
+    const uint8_t key[] = { 0x1C };
+    const uint8_t mouse[] = { 0x08, 0x01, 0xFF };
+    kmiStats stats;
+
+    __init(0);
+    CHECK_EQ(KMI_OK, kmi_init(1, 3));
+    sim_sync();
+    CHECK_EQ(0x14, sim_kmiRegs[1][PL050_CR]);
+
+    /* Both KMIs are serviced by a single IRQ */
+    CHECK_EQ(1, sim_kmiInject(0, key, sizeof(key)));
+    CHECK_EQ(3, sim_kmiInject(1, mouse, sizeof(mouse)));
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    CHECK_EQ(1, kmi_available(0));
+    CHECK_EQ(3, kmi_available(1));
+    CHECK_EQ(0x1C, kmi_readByte(0));
+    CHECK_EQ(0x08, kmi_readByte(1));
+    CHECK_EQ(0x01, kmi_readByte(1));
+    CHECK_EQ(0xFF, kmi_readByte(1));
+
+    CHECK_EQ(KMI_OK, kmi_getStats(1, &stats));
+    CHECK_EQ(1, stats.irqs);
+    CHECK_EQ(3, stats.bytes);
+}
+
+
+static void testWrite(void)
+{
+    __init(0);
+
+    CHECK_EQ(KMI_OK, kmi_write(0, 0xED));
+    CHECK_EQ(0xED, sim_kmiTxLast[0]);
+    CHECK_EQ(1, sim_kmiNrTx[0]);
+
+    /* The device's acknowledge is received */
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(1, kmi_available(0));
+    CHECK_EQ(0xFA, kmi_readByte(0));
+}
+
+
+static void testDisable(void)
+{
+    const uint8_t bytes[] = { 0x1C, 0x1B };
+    const uint8_t kmiIrqs[BSP_NR_KMIS] = BSP_KMI_SIC_IRQS;
+
+    __init(0);
+
+    __inject(bytes, sizeof(bytes));
+    CHECK_EQ(2, kmi_available(0));
+
+    kmi_disable(0);
+    sim_sync();
+    CHECK_EQ(0, sim_kmiRegs[0][PL050_CR]);
+    CHECK_EQ(0, sim_sicRegs[SIC_ENABLE] & (1UL << kmiIrqs[0]));
+    CHECK_EQ(0, kmi_available(0));
+    CHECK_EQ(KMI_ERR_NOINIT, kmi_write(0, 0xFF));
+
+    /* Received bytes do not trigger any IRQ */
+    CHECK_EQ(2, sim_kmiInject(0, bytes, sizeof(bytes)));
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(0, kmi_available(0));
+}
+
+
+void test_kmi(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testReceive);
+    RUN_TEST(testTranslate);
+    RUN_TEST(testPartialSequence);
+    RUN_TEST(testOverrun);
+    RUN_TEST(testBothKmis);
+    RUN_TEST(testWrite);
+    RUN_TEST(testDisable);
+}
@@ -0,0 +1,83 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Runner of all host unit test suites.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdio.h>
+
+#include "sim.h"
+#include "unit.h"
+
+
+unsigned long unit_nrChecks = 0;
+unsigned long unit_nrFailures = 0;
+
+
+int main(void)
+{
+    printf("interrupt:\n");
+    test_interrupt();
+    printf("timer:\n");
+    test_timer();
+    printf("uart:\n");
+    test_uart();
+    printf("rtc:\n");
+    test_rtc();
+    printf("sysreg:\n");
+    test_sysreg();
+    printf("trace:\n");
+    test_trace();
+    printf("cpuload:\n");
+    test_cpuload();
+    printf("dma:\n");
+    test_dma();
+    printf("mmci:\n");
+    test_mmci();
+    printf("bcache:\n");
+    test_bcache();
+    printf("tlog:\n");
+    test_tlog();
+    printf("flash:\n");
+    test_flash();
+    printf("clcd:\n");
+    test_clcd();
+    printf("comp:\n");
+    test_comp();
+    printf("kmi:\n");
+    test_kmi();
+    printf("gpio:\n");
+    test_gpio();
+    printf("ssp:\n");
+    test_ssp();
+    printf("cyclic:\n");
+    test_cyclic();
+    printf("edf:\n");
+    test_edf();
+    printf("sync:\n");
+    test_sync();
+
+    printf("%lu checks, %lu failures\n", unit_nrChecks, unit_nrFailures);
+
+    return ( 0 == unit_nrFailures ? 0 : 1 );
+}
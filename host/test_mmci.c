@@ -0,0 +1,338 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the PL181 SD card driver (mmci.c) and of the block
+ * device API (blk.c).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mmci.h"
+#include "blk.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define BUF_BLOCKS    200
+
+static uint8_t __buf[BUF_BLOCKS * MMCI_BLOCK_SIZE + 4];
+
+
+/* Value of a byte of the card's pattern */
+static uint8_t __pattern(uint32_t addr)
+{
+    return (uint8_t) ( (addr >> 9) * 13 + addr * 7 + 1 );
+}
+
+
+/* Fills the simulated card with the pattern */
+static void __fillCard(void)
+{
+    uint32_t i;
+
+    for ( i=0; i<sizeof(sim_sdData); ++i )
+    {
+        sim_sdData[i] = __pattern(i);
+    }
+}
+
+
+/* @return number of bytes of 'buf' that differ from the card's pattern, starting at 'block' */
+static uint32_t __cmpPattern(const uint8_t* buf, uint32_t block, uint32_t count)
+{
+    const uint32_t addr = block * MMCI_BLOCK_SIZE;
+    uint32_t i;
+    uint32_t diff = 0;
+
+    for ( i=0; i<count*MMCI_BLOCK_SIZE; ++i )
+    {
+        diff += ( __pattern(addr + i) != buf[i] ? 1 : 0 );
+    }
+
+    return diff;
+}
+
+
+/* Initializes the interrupt controller, the MMCI and the card */
+static void __init(void)
+{
+    uint32_t i;
+
+    pic_init();
+    sim_sync();
+    CHECK_EQ(MMCI_OK, mmci_init(10));
+    CHECK_EQ(MMCI_OK, mmci_initCard());
+
+    for ( i=0; i<sizeof(__buf); ++i )
+    {
+        __buf[i] = 0;
+    }
+}
+
+
+static void testInitHighCapacity(void)
+{
+    pic_init();
+    sim_sync();
+    CHECK(!mmci_isCardReady());
+    CHECK_EQ(MMCI_ERR_PARAM, mmci_readBlocks(0, __buf, 1));
+
+    CHECK_EQ(MMCI_OK, mmci_init(10));
+    CHECK_EQ(MMCI_OK, mmci_initCard());
+    CHECK(mmci_isCardReady());
+    CHECK(mmci_isHighCapacity());
+    CHECK_EQ(SIM_SD_NR_BLOCKS, mmci_getNrBlocks());
+
+    /* the ACMD41 is repeated until the card's power up completes */
+    CHECK_EQ(2, sim_sdNrCommands[41]);
+    CHECK_EQ(1, sim_sdNrCommands[7]);
+
+    /* the MMCI's IRQ is passed through the SIC */
+    CHECK(pic_isInterruptEnabled(BSP_MMCI_IRQ));
+    CHECK_EQ(1UL << BSP_MMCI_IRQ, sim_sicRegs[SIC_PICENABLE]);
+}
+
+
+static void testInitStandardCapacity(void)
+{
+    sim_sdHighCapacity = 0;
+    __fillCard();
+    __init();
+
+    CHECK(mmci_isCardReady());
+    CHECK(!mmci_isHighCapacity());
+    CHECK_EQ(SIM_SD_NR_BLOCKS, mmci_getNrBlocks());
+
+    /* blocks are addressed by bytes */
+    CHECK_EQ(MMCI_OK, mmci_readBlocks(5, __buf, 2));
+    CHECK_EQ(0, __cmpPattern(__buf, 5, 2));
+}
+
+
+static void testNoCard(void)
+{
+    sim_sdInserted = 0;
+
+    pic_init();
+    sim_sync();
+    CHECK_EQ(MMCI_OK, mmci_init(10));
+    CHECK_EQ(MMCI_ERR_TIMEOUT, mmci_initCard());
+    CHECK(!mmci_isCardReady());
+    CHECK_EQ(0, mmci_getNrBlocks());
+    CHECK_EQ(MMCI_ERR_PARAM, mmci_readBlocks(0, __buf, 1));
+
+    CHECK_EQ(BLK_ERR_NODEV, blk_init(10));
+    CHECK_EQ(0, blk_getNrBlocks());
+    CHECK_EQ(BLK_ERR_NODEV, blk_read(0, __buf, 1));
+}
+
+
+static void testInvalidParams(void)
+{
+    __init();
+
+    CHECK_EQ(MMCI_ERR_PARAM, mmci_readBlocks(0, NULL, 1));
+    CHECK_EQ(MMCI_ERR_PARAM, mmci_readBlocks(0, __buf, 0));
+    CHECK_EQ(MMCI_ERR_PARAM, mmci_readBlocks(0, __buf, MMCI_MAX_BLOCKS + 1));
+    CHECK_EQ(MMCI_ERR_PARAM, mmci_readBlocks(SIM_SD_NR_BLOCKS, __buf, 1));
+    CHECK_EQ(MMCI_ERR_PARAM, mmci_writeBlocks(SIM_SD_NR_BLOCKS - 1, __buf, 2));
+
+    /* no command was sent to the card */
+    CHECK_EQ(0, sim_sdNrCommands[17] + sim_sdNrCommands[18] +
+                sim_sdNrCommands[24] + sim_sdNrCommands[25]);
+}
+
+
+static void testPolledRead(void)
+{
+    __fillCard();
+    __init();
+
+    CHECK_EQ(MMCI_OK, mmci_readBlocks(3, __buf, 1));
+    CHECK_EQ(0, __cmpPattern(__buf, 3, 1));
+    CHECK_EQ(1, sim_sdNrCommands[17]);
+    CHECK_EQ(0, sim_sdNrCommands[12]);
+
+    /* a single multiple block command, terminated by CMD12 */
+    CHECK_EQ(MMCI_OK, mmci_readBlocks(100, __buf, MMCI_MAX_BLOCKS));
+    CHECK_EQ(0, __cmpPattern(__buf, 100, MMCI_MAX_BLOCKS));
+    CHECK_EQ(1, sim_sdNrCommands[18]);
+    CHECK_EQ(1, sim_sdNrCommands[12]);
+
+    /* the last block */
+    CHECK_EQ(MMCI_OK, mmci_readBlocks(SIM_SD_NR_BLOCKS - 1, __buf, 1));
+    CHECK_EQ(0, __cmpPattern(__buf, SIM_SD_NR_BLOCKS - 1, 1));
+
+    /* the controller is idle afterwards */
+    CHECK_EQ(0, sim_mmciRegs[PL181_MASK0]);
+    CHECK_EQ(0, sim_mmciRegs[PL181_DATACTRL]);
+}
+
+
+static void testPolledWrite(void)
+{
+    uint32_t i;
+
+    __init();
+
+    for ( i=0; i<10*MMCI_BLOCK_SIZE; ++i )
+    {
+        __buf[i] = __pattern((20 * MMCI_BLOCK_SIZE) + i);
+    }
+
+    CHECK_EQ(MMCI_OK, mmci_writeBlocks(20, __buf, 1));
+    CHECK_EQ(1, sim_sdNrCommands[24]);
+    CHECK_EQ(0, __cmpPattern(&sim_sdData[20 * MMCI_BLOCK_SIZE], 20, 1));
+    CHECK_EQ(0, sim_sdData[21 * MMCI_BLOCK_SIZE]);
+
+    CHECK_EQ(MMCI_OK, mmci_writeBlocks(20, __buf, 10));
+    CHECK_EQ(1, sim_sdNrCommands[25]);
+    CHECK_EQ(1, sim_sdNrCommands[12]);
+    CHECK_EQ(0, __cmpPattern(&sim_sdData[20 * MMCI_BLOCK_SIZE], 20, 10));
+    CHECK_EQ(0, sim_sdData[19 * MMCI_BLOCK_SIZE + MMCI_BLOCK_SIZE - 1]);
+    CHECK_EQ(0, sim_sdData[30 * MMCI_BLOCK_SIZE]);
+}
+
+
+static void testUnaligned(void)
+{
+    uint32_t i;
+
+    __fillCard();
+    __init();
+
+    CHECK_EQ(MMCI_OK, mmci_readBlocks(7, __buf + 1, 3));
+    CHECK_EQ(0, __cmpPattern(__buf + 1, 7, 3));
+    CHECK_EQ(0, __buf[0]);
+    CHECK_EQ(0, __buf[3 * MMCI_BLOCK_SIZE + 1]);
+
+    for ( i=0; i<2*MMCI_BLOCK_SIZE; ++i )
+    {
+        __buf[i+3] = (uint8_t) (i ^ 0x5A);
+    }
+
+    CHECK_EQ(MMCI_OK, mmci_writeBlocks(40, __buf + 3, 2));
+    for ( i=0; i<2*MMCI_BLOCK_SIZE; ++i )
+    {
+        CHECK_EQ((uint8_t) (i ^ 0x5A), sim_sdData[40 * MMCI_BLOCK_SIZE + i]);
+    }
+}
+
+
+static void testIrqDriven(void)
+{
+    uint32_t i;
+
+    __fillCard();
+    __init();
+    irq_enableIrqMode();
+
+    CHECK_EQ(MMCI_OK, mmci_readBlocks(50, __buf, 64));
+    CHECK(irq_isIrqModeEnabled());
+    CHECK_EQ(0, __cmpPattern(__buf, 50, 64));
+
+    for ( i=0; i<64*MMCI_BLOCK_SIZE; ++i )
+    {
+        __buf[i] = (uint8_t) ~__buf[i];
+    }
+
+    CHECK_EQ(MMCI_OK, mmci_writeBlocks(50, __buf, 64));
+    for ( i=0; i<64*MMCI_BLOCK_SIZE; ++i )
+    {
+        CHECK_EQ((uint8_t) ~__pattern(50 * MMCI_BLOCK_SIZE + i), sim_sdData[50 * MMCI_BLOCK_SIZE + i]);
+    }
+
+    /* no IRQ remains pending */
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(0, sim_picRegs[VIC_RAWINTR] & (1UL << BSP_MMCI_IRQ));
+
+    irq_disableIrqMode();
+}
+
+
+static void testDataErrors(void)
+{
+    __fillCard();
+    __init();
+
+    sim_mmciDataErrors = PL181_ST_DATA_CRC_FAIL;
+    CHECK_EQ(MMCI_ERR_DATA, mmci_readBlocks(0, __buf, 1));
+
+    sim_mmciDataErrors = PL181_ST_DATA_TIMEOUT;
+    CHECK_EQ(MMCI_ERR_DATA, mmci_readBlocks(0, __buf, 4));
+    CHECK_EQ(1, sim_sdNrCommands[12]);
+
+    irq_enableIrqMode();
+    sim_mmciDataErrors = PL181_ST_DATA_CRC_FAIL;
+    CHECK_EQ(MMCI_ERR_DATA, mmci_writeBlocks(0, __buf, 2));
+    irq_disableIrqMode();
+
+    /* the card is usable afterwards */
+    CHECK_EQ(MMCI_OK, mmci_readBlocks(9, __buf, 2));
+    CHECK_EQ(0, __cmpPattern(__buf, 9, 2));
+}
+
+
+static void testBlk(void)
+{
+    pic_init();
+    sim_sync();
+    __fillCard();
+
+    CHECK_EQ(BLK_OK, blk_init(10));
+    CHECK_EQ(SIM_SD_NR_BLOCKS, blk_getNrBlocks());
+
+    CHECK_EQ(BLK_ERR_PARAM, blk_read(0, NULL, 1));
+    CHECK_EQ(BLK_ERR_PARAM, blk_read(0, __buf, 0));
+    CHECK_EQ(BLK_ERR_PARAM, blk_read(SIM_SD_NR_BLOCKS, __buf, 1));
+    CHECK_EQ(BLK_ERR_PARAM, blk_write(SIM_SD_NR_BLOCKS - 2, __buf, 3));
+
+    /* split into transfers of max. MMCI_MAX_BLOCKS blocks */
+    CHECK_EQ(BLK_OK, blk_read(SIM_SD_NR_BLOCKS - BUF_BLOCKS, __buf, BUF_BLOCKS));
+    CHECK_EQ(0, __cmpPattern(__buf, SIM_SD_NR_BLOCKS - BUF_BLOCKS, BUF_BLOCKS));
+    CHECK_EQ(2, sim_sdNrCommands[18]);
+
+    CHECK_EQ(BLK_OK, blk_write(0, __buf, BUF_BLOCKS));
+    CHECK_EQ(2, sim_sdNrCommands[25]);
+    CHECK_EQ(0, __cmpPattern(sim_sdData, SIM_SD_NR_BLOCKS - BUF_BLOCKS, BUF_BLOCKS));
+
+    sim_mmciDataErrors = PL181_ST_DATA_CRC_FAIL;
+    CHECK_EQ(BLK_ERR_IO, blk_read(0, __buf, 1));
+}
+
+
+void test_mmci(void)
+{
+    RUN_TEST(testInitHighCapacity);
+    RUN_TEST(testInitStandardCapacity);
+    RUN_TEST(testNoCard);
+    RUN_TEST(testInvalidParams);
+    RUN_TEST(testPolledRead);
+    RUN_TEST(testPolledWrite);
+    RUN_TEST(testUnaligned);
+    RUN_TEST(testIrqDriven);
+    RUN_TEST(testDataErrors);
+    RUN_TEST(testBlk);
+}
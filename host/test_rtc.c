@@ -0,0 +1,119 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the PL031 driver (rtc.c).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rtc.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+static uint32_t __nrAlarms;
+
+static void __alarmIsr(void* param)
+{
+    ++__nrAlarms;
+    rtc_clearInterrupt();
+    rtc_setMatch(rtc_getValue() + 5);
+}
+
+
+static void testLoadAndCount(void)
+{
+    sim_rtcRegs[PL031_IMSC] = 1;
+
+    rtc_init();
+    CHECK_EQ(0, sim_rtcRegs[PL031_IMSC]);
+    CHECK(!rtc_isRunning());
+
+    rtc_setLoad(1000);
+    sim_sync();
+    CHECK_EQ(1000, rtc_getValue());
+
+    /* not started yet */
+    sim_rtcAdvance(3);
+    CHECK_EQ(1000, rtc_getValue());
+
+    rtc_start();
+    CHECK(rtc_isRunning());
+    sim_rtcAdvance(3);
+    CHECK_EQ(1003, rtc_getValue());
+    CHECK_EQ(1003, *rtc_getValueAddr());
+}
+
+
+static void testMatchInterrupt(void)
+{
+    uint32_t i;
+
+    pic_init();
+    sim_sync();
+    pic_registerNonVectoredIrq(BSP_RTC_IRQ, &__alarmIsr, NULL, 1);
+    pic_enableInterrupt(BSP_RTC_IRQ);
+
+    rtc_init();
+    rtc_setLoad(0);
+    rtc_setMatch(10);
+    CHECK_EQ(10, rtc_getMatch());
+    rtc_start();
+
+    /* the raw interrupt is set even if it is masked */
+    sim_rtcAdvance(10);
+    CHECK_EQ(1, sim_rtcRegs[PL031_RIS]);
+    CHECK_EQ(0, sim_rtcRegs[PL031_MIS]);
+    rtc_clearInterrupt();
+    sim_sync();
+    CHECK_EQ(0, sim_rtcRegs[PL031_RIS]);
+
+    rtc_setMatch(20);
+    rtc_enableInterrupt();
+    irq_enableIrqMode();
+
+    __nrAlarms = 0;
+    for ( i=0; i<50; ++i )
+    {
+        sim_rtcAdvance(1);
+        sim_dispatchIrq();
+    }
+
+    /* alarms at 20, 25, ..., 60 */
+    CHECK_EQ(9, __nrAlarms);
+
+    rtc_disableInterrupt();
+    sim_rtcAdvance(5);
+    CHECK_EQ(0, sim_dispatchIrq());
+
+    irq_disableIrqMode();
+}
+
+
+void test_rtc(void)
+{
+    RUN_TEST(testLoadAndCount);
+    RUN_TEST(testMatchInterrupt);
+}
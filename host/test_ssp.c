@@ -0,0 +1,324 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the PL022 SSP driver (ssp.c).
+ *
+ * The simulated device responds to each frame by its complement, in the
+ * loop back mode each frame is received as it has been sent. Receive
+ * overruns of the simulated controller would reveal more than
+ * SSP_FIFO_DEPTH frames in flight.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bsp.h"
+#include "ssp.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define NR_FRAMES        100
+
+static uint8_t __tx[NR_FRAMES];
+static uint8_t __rx[NR_FRAMES];
+
+/* Parameters of completed transfers' callbacks, in order of calls: */
+static uintptr_t __done[8];
+static int8_t __statuses[8];
+static uint32_t __nrDone;
+
+
+/* Logs the completed transfer */
+static void __callback(int8_t status, void* param)
+{
+    if ( __nrDone < 8 )
+    {
+        __done[__nrDone] = (uintptr_t) param;
+        __statuses[__nrDone] = status;
+    }
+
+    ++__nrDone;
+}
+
+
+/* Another transfer, submitted by __chainCallback(): */
+static sspTransfer __chained;
+
+/* Logs the completed transfer and submits __chained */
+static void __chainCallback(int8_t status, void* param)
+{
+    __callback(status, param);
+    CHECK_EQ(SSP_OK, ssp_submit(&__chained));
+}
+
+
+/* Initializes the PIC and the SSP (1 MHz, 8-bit frames) */
+static void __init(void)
+{
+    uint32_t i;
+
+    for ( i=0; i<NR_FRAMES; ++i )
+    {
+        __tx[i] = (uint8_t) (i * 7 + 3);
+    }
+
+    memset(__rx, 0, sizeof(__rx));
+    __nrDone = 0;
+
+    pic_init();
+    sim_sync();
+    CHECK_EQ(SSP_OK, ssp_init(1000000, 8, SSP_MODE_0, 3));
+    sim_sync();
+}
+
+
+/* Initializes a transfer descriptor */
+static void __setTransfer(sspTransfer* t, const void* tx, void* rx, uint32_t count, sspCallback cb, uintptr_t param)
+{
+    t->tx = tx;
+    t->rx = rx;
+    t->count = count;
+    t->callback = cb;
+    t->param = (void*) param;
+}
+
+
+/* Dispatches IRQs until the queue is empty */
+static void __runQueue(void)
+{
+    uint32_t i;
+
+    for ( i=0; i<1000 && 0!=ssp_isBusy(); ++i )
+    {
+        CHECK_EQ(1, sim_dispatchIrq());
+    }
+
+    CHECK_EQ(0, ssp_isBusy());
+    CHECK_EQ(0, sim_dispatchIrq());
+}
+
+
+static void testInit(void)
+{
+    CHECK_EQ(SSP_ERR_NOINIT, ssp_transfer(__tx, __rx, 1));
+    CHECK_EQ(0, ssp_getBitRate());
+    CHECK_EQ(SSP_ERR_PARAM, ssp_init(0, 8, SSP_MODE_0, 3));
+    CHECK_EQ(SSP_ERR_PARAM, ssp_init(1000000, 3, SSP_MODE_0, 3));
+    CHECK_EQ(SSP_ERR_PARAM, ssp_init(1000000, 17, SSP_MODE_0, 3));
+    CHECK_EQ(SSP_ERR_PARAM, ssp_init(1000000, 8, SSP_MODE_3 + 1, 3));
+
+    /* Too slow for the max. prescaler and serial clock rate */
+    CHECK_EQ(SSP_ERR_PARAM, ssp_init(100, 8, SSP_MODE_0, 3));
+
+    pic_init();
+    sim_sync();
+
+    CHECK_EQ(SSP_OK, ssp_init(1000000, 8, SSP_MODE_3, 3));
+    sim_sync();
+    CHECK_EQ(1000000, ssp_getBitRate());
+    CHECK_EQ(0x0BC7, sim_sspRegs[PL022_CR0]);
+    CHECK_EQ(2, sim_sspRegs[PL022_CPSR]);
+    CHECK_EQ(0x02, sim_sspRegs[PL022_CR1]);
+    CHECK_EQ(0, sim_sspRegs[PL022_IMSC]);
+    CHECK( 0 != (sim_picRegs[VIC_INTENABLE] & (1UL << BSP_SSP_IRQ)) );
+
+    /* The bit rate never exceeds the requested one */
+    CHECK_EQ(SSP_OK, ssp_init(30000000, 16, SSP_MODE_1, 3));
+    sim_sync();
+    CHECK_EQ(12000000, ssp_getBitRate());
+    CHECK_EQ(0x008F, sim_sspRegs[PL022_CR0]);
+
+    CHECK_EQ(SSP_OK, ssp_init(1000, 4, SSP_MODE_2, 3));
+    sim_sync();
+    CHECK_EQ(997, ssp_getBitRate());
+    CHECK_EQ(0xFF43, sim_sspRegs[PL022_CR0]);
+    CHECK_EQ(94, sim_sspRegs[PL022_CPSR]);
+
+    ssp_disable();
+    sim_sync();
+    CHECK_EQ(0, sim_sspRegs[PL022_CR1]);
+    CHECK( 0 == (sim_picRegs[VIC_INTENABLE] & (1UL << BSP_SSP_IRQ)) );
+    CHECK_EQ(SSP_ERR_NOINIT, ssp_transfer(__tx, __rx, 1));
+}
+
+
+static void testPolled(void)
+{
+    uint16_t wideTx[16];
+    uint16_t wideRx[16];
+    sspStats stats;
+    uint32_t i;
+
+    __init();
+
+    /* Response of the device */
+    CHECK_EQ(SSP_OK, ssp_transfer(__tx, __rx, NR_FRAMES));
+    for ( i=0; i<NR_FRAMES; ++i )
+    {
+        CHECK_EQ((uint8_t) ~__tx[i], __rx[i]);
+    }
+    CHECK_EQ(NR_FRAMES, sim_sspNrFrames);
+    CHECK_EQ(__tx[NR_FRAMES-1], sim_sspTxLog[(NR_FRAMES-1) % SIM_SSP_LOG_SIZE]);
+    CHECK_EQ(0, sim_sspNrOverruns);
+
+    /* Loop back */
+    ssp_setLoopback(1);
+    sim_sync();
+    CHECK_EQ(0x03, sim_sspRegs[PL022_CR1]);
+    CHECK_EQ(SSP_OK, ssp_transfer(__tx, __rx, NR_FRAMES));
+    CHECK(0 == memcmp(__tx, __rx, NR_FRAMES));
+    ssp_setLoopback(0);
+
+    /* Zeros are sent without a transmit buffer, received frames may be discarded */
+    CHECK_EQ(SSP_OK, ssp_transfer(NULL, __rx, 10));
+    CHECK_EQ(0xFF, __rx[0]);
+    CHECK_EQ(0xFF, __rx[9]);
+    CHECK_EQ(0, sim_sspTxLog[(NR_FRAMES * 2 + 9) % SIM_SSP_LOG_SIZE]);
+    CHECK_EQ(SSP_OK, ssp_transfer(__tx, NULL, 20));
+    CHECK_EQ(SSP_OK, ssp_transfer(__tx, __rx, 0));
+    CHECK_EQ(0, sim_sspNrOverruns);
+
+    ssp_getStats(&stats);
+    CHECK_EQ(5, stats.transfers);
+    CHECK_EQ(NR_FRAMES * 2 + 30, stats.frames);
+    CHECK_EQ(0, stats.irqs);
+
+    /* Frames larger than 8 bits */
+    CHECK_EQ(SSP_OK, ssp_init(1000000, 12, SSP_MODE_0, 3));
+    for ( i=0; i<16; ++i )
+    {
+        wideTx[i] = (uint16_t) (0x0100 * i + i);
+    }
+    CHECK_EQ(SSP_OK, ssp_transfer(wideTx, wideRx, 16));
+    for ( i=0; i<16; ++i )
+    {
+        CHECK_EQ((uint16_t) (~wideTx[i] & 0x0FFF), wideRx[i]);
+    }
+}
+
+
+static void testQueued(void)
+{
+    sspTransfer t[3];
+    uint8_t rx2[NR_FRAMES];
+    sspStats stats;
+
+    __init();
+    ssp_setLoopback(1);
+    irq_enableIrqMode();
+
+    CHECK_EQ(SSP_ERR_PARAM, ssp_submit(NULL));
+    __setTransfer(&t[0], __tx, __rx, 0, &__callback, 0);
+    CHECK_EQ(SSP_ERR_PARAM, ssp_submit(&t[0]));
+
+    __setTransfer(&t[0], __tx, __rx, NR_FRAMES, &__callback, 1);
+    __setTransfer(&t[1], __tx, NULL, 5, NULL, 2);
+    __setTransfer(&t[2], NULL, rx2, 3, &__callback, 3);
+    memset(rx2, 0x55, sizeof(rx2));
+
+    /* The first transfer is started at once */
+    CHECK_EQ(SSP_OK, ssp_submit(&t[0]));
+    CHECK_EQ(SSP_OK, ssp_submit(&t[1]));
+    CHECK_EQ(SSP_OK, ssp_submit(&t[2]));
+    CHECK_EQ(1, ssp_isBusy());
+    CHECK_EQ(SSP_FIFO_DEPTH, sim_sspNrFrames);
+    CHECK_EQ(SSP_ERR_BUSY, ssp_transfer(__tx, __rx, 1));
+
+    __runQueue();
+
+    CHECK_EQ(2, __nrDone);
+    CHECK_EQ(1, __done[0]);
+    CHECK_EQ(SSP_STATUS_OK, __statuses[0]);
+    CHECK_EQ(3, __done[1]);
+    CHECK_EQ(SSP_STATUS_OK, __statuses[1]);
+    CHECK(0 == memcmp(__tx, __rx, NR_FRAMES));
+    CHECK_EQ(0, rx2[0]);
+    CHECK_EQ(0, rx2[2]);
+    CHECK_EQ(0x55, rx2[3]);
+    CHECK_EQ(NR_FRAMES + 8, sim_sspNrFrames);
+    CHECK_EQ(0, sim_sspNrOverruns);
+    CHECK_EQ(0, sim_sspRegs[PL022_IMSC]);
+
+    /* A FIFO of frames per IRQ, the following transfers need no extra IRQs */
+    ssp_getStats(&stats);
+    CHECK_EQ(3, stats.transfers);
+    CHECK_EQ(NR_FRAMES + 8, stats.frames);
+    CHECK_EQ((NR_FRAMES + SSP_FIFO_DEPTH - 1) / SSP_FIFO_DEPTH - 1, stats.irqs);
+    CHECK_EQ(0, stats.overruns);
+
+    irq_disableIrqMode();
+}
+
+
+static void testChained(void)
+{
+    sspTransfer t;
+
+    __init();
+    irq_enableIrqMode();
+
+    /* A transfer, submitted by a callback, follows within the same IRQ */
+    __setTransfer(&t, __tx, __rx, 20, &__chainCallback, 1);
+    __setTransfer(&__chained, __tx + 20, __rx + 20, 30, &__callback, 2);
+    CHECK_EQ(SSP_OK, ssp_submit(&t));
+    __runQueue();
+
+    CHECK_EQ(2, __nrDone);
+    CHECK_EQ(1, __done[0]);
+    CHECK_EQ(2, __done[1]);
+    CHECK_EQ((uint8_t) ~__tx[0], __rx[0]);
+    CHECK_EQ((uint8_t) ~__tx[49], __rx[49]);
+    CHECK_EQ(0, __rx[50]);
+    CHECK_EQ(50, sim_sspNrFrames);
+
+    /* Transfers may also be submitted while IRQs are disabled */
+    irq_disableIrqMode();
+    __setTransfer(&t, __tx, __rx, 16, &__callback, 5);
+    CHECK_EQ(SSP_OK, ssp_submit(&t));
+    irq_enableIrqMode();
+    __runQueue();
+    CHECK_EQ(3, __nrDone);
+    CHECK_EQ(5, __done[2]);
+
+    /* Queued transfers are discarded */
+    __setTransfer(&t, __tx, __rx, NR_FRAMES, &__callback, 6);
+    CHECK_EQ(SSP_OK, ssp_submit(&t));
+    ssp_disable();
+    CHECK_EQ(0, ssp_isBusy());
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(3, __nrDone);
+    CHECK_EQ(SSP_ERR_NOINIT, ssp_submit(&t));
+    irq_disableIrqMode();
+}
+
+
+void test_ssp(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testPolled);
+    RUN_TEST(testQueued);
+    RUN_TEST(testChained);
+}
@@ -0,0 +1,334 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of synchronization primitives (sync.c).
+ *
+ * Waiting functions sleep by sim_cpu_wfi(), which advances the time till
+ * the next expiration of a counter, whose ISR gives semaphores or sets
+ * event flags.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "sync.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "clocksource.h"
+#include "sim.h"
+#include "unit.h"
+
+
+/* Actions of the counter's ISR: */
+#define ACTION_NONE        0
+#define ACTION_GIVE        1
+#define ACTION_SET         2
+
+static uint8_t __action;
+static uint32_t __ticks;
+static syncSem __sem;
+static syncEvents __events;
+
+/* Results of the software interrupt's ISR: */
+static int8_t __isrResult;
+static uint32_t __isrCalls;
+
+
+/* ISR of timer 1, counter 0, performs __action */
+static void __timerIsr(void* param)
+{
+    if ( 0 == timer_isInterruptPending(1, 0) )
+    {
+        return;
+    }
+
+    timer_clearInterrupt(1, 0);
+    ++__ticks;
+
+    if ( ACTION_GIVE == __action )
+    {
+        sync_semGive(&__sem);
+    }
+    else if ( ACTION_SET == __action )
+    {
+        /* Flag 0 at the first tick, flag 1 at the second one, etc. */
+        sync_eventsSet(&__events, 1UL << (__ticks - 1));
+    }
+}
+
+
+/* ISR of the software interrupt, locks and unlocks the mutex 'param' */
+static void __swIsr(void* param)
+{
+    syncMutex* m = (syncMutex*) param;
+
+    ++__isrCalls;
+    __isrResult = sync_mutexLock(m);
+    if ( SYNC_OK == __isrResult )
+    {
+        /* The simulated VIC applies VICINTENCLEAR at synchronization, the real one immediately */
+        sim_sync();
+        sync_mutexUnlock(m);
+    }
+
+    pic_clearSwInterruptNr(BSP_SOFTWARE_IRQ);
+}
+
+
+/* Starts timer 1, counter 0, with the given period, the IRQ mode is enabled */
+static void __startTimer(uint32_t period, uint8_t action)
+{
+    const uint8_t irqs[BSP_NR_TIMERS] = BSP_TIMER_IRQS;
+
+    pic_init();
+    sim_sync();
+    clocksource_init();
+    CHECK_EQ(0, pic_registerNonVectoredIrq(irqs[1], &__timerIsr, NULL, 10));
+    pic_enableInterrupt(irqs[1]);
+
+    __action = action;
+    __ticks = 0;
+
+    timer_init(1, 0);
+    timer_setLoad(1, 0, period - 1);
+    timer_enableInterrupt(1, 0);
+    timer_start(1, 0);
+    sim_sync();
+    irq_enableIrqMode();
+}
+
+
+/* Stops timer 1, counter 0 and disables the IRQ mode */
+static void __stopTimer(void)
+{
+    timer_stop(1, 0);
+    timer_disableInterrupt(1, 0);
+    irq_disableIrqMode();
+}
+
+
+static void testSemaphore(void)
+{
+    uint32_t start;
+    uint32_t us;
+
+    CHECK_EQ(SYNC_ERR_PARAM, sync_semInit(NULL, 0, 1));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_semInit(&__sem, 0, 0));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_semInit(&__sem, 3, 2));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_semGive(NULL));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_semTake(NULL, SYNC_NO_WAIT));
+    CHECK_EQ(0, sync_semGetCount(NULL));
+
+    CHECK_EQ(SYNC_OK, sync_semInit(&__sem, 1, 2));
+    CHECK_EQ(SYNC_OK, sync_semTake(&__sem, SYNC_NO_WAIT));
+    CHECK_EQ(SYNC_ERR_TIMEOUT, sync_semTake(&__sem, SYNC_NO_WAIT));
+    CHECK_EQ(SYNC_OK, sync_semGive(&__sem));
+    CHECK_EQ(SYNC_OK, sync_semGive(&__sem));
+    CHECK_EQ(SYNC_ERR_FULL, sync_semGive(&__sem));
+    CHECK_EQ(2, sync_semGetCount(&__sem));
+
+    /* Nothing could give the semaphore */
+    sync_semInit(&__sem, 0, 1);
+    irq_disableIrqMode();
+    CHECK_EQ(SYNC_ERR_IRQ, sync_semTake(&__sem, SYNC_WAIT_FOREVER));
+
+    /* The CPU sleeps till the counter's ISR gives the semaphore */
+    __startTimer(500, ACTION_GIVE);
+    start = clocksource_read();
+    CHECK_EQ(SYNC_OK, sync_semTake(&__sem, SYNC_WAIT_FOREVER));
+    us = clocksource_ticksToUs(clocksource_read() - start);
+    CHECK_EQ(1, __ticks);
+    CHECK( us >= 499 && us < 600 );
+    CHECK_EQ(0, sync_semGetCount(&__sem));
+
+    /* The timeout expires at the first tick after it */
+    __action = ACTION_NONE;
+    start = clocksource_read();
+    CHECK_EQ(SYNC_ERR_TIMEOUT, sync_semTake(&__sem, 1200));
+    us = clocksource_ticksToUs(clocksource_read() - start);
+    CHECK( us >= 1200 && us < 1700 );
+    CHECK_EQ(4, __ticks);
+
+    __stopTimer();
+}
+
+
+static void testEvents(void)
+{
+    uint32_t result;
+
+    CHECK_EQ(SYNC_ERR_PARAM, sync_eventsInit(NULL));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_eventsSet(NULL, 1));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_eventsClear(NULL, 1));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_eventsWait(NULL, 1, SYNC_EVENTS_ANY, SYNC_NO_WAIT, NULL));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_eventsWait(&__events, 0, SYNC_EVENTS_ANY, SYNC_NO_WAIT, NULL));
+    CHECK_EQ(0, sync_eventsGet(NULL));
+
+    CHECK_EQ(SYNC_OK, sync_eventsInit(&__events));
+    CHECK_EQ(0, sync_eventsGet(&__events));
+
+    CHECK_EQ(SYNC_OK, sync_eventsSet(&__events, 0x05));
+    CHECK_EQ(0x05, sync_eventsGet(&__events));
+
+    /* Any flag is sufficient, flags are retained */
+    CHECK_EQ(SYNC_OK, sync_eventsWait(&__events, 0x06, SYNC_EVENTS_ANY, SYNC_NO_WAIT, &result));
+    CHECK_EQ(0x04, result);
+    CHECK_EQ(0x05, sync_eventsGet(&__events));
+
+    /* All flags are required */
+    CHECK_EQ(SYNC_ERR_TIMEOUT, sync_eventsWait(&__events, 0x06, SYNC_EVENTS_ALL, SYNC_NO_WAIT, &result));
+    CHECK_EQ(0, result);
+
+    /* Only awaited flags are cleared */
+    sync_eventsSet(&__events, 0x10);
+    CHECK_EQ(SYNC_OK, sync_eventsWait(&__events, 0x05, SYNC_EVENTS_ALL | SYNC_EVENTS_CLEAR, SYNC_NO_WAIT, &result));
+    CHECK_EQ(0x05, result);
+    CHECK_EQ(0x10, sync_eventsGet(&__events));
+    CHECK_EQ(SYNC_OK, sync_eventsClear(&__events, 0x30));
+    CHECK_EQ(0, sync_eventsGet(&__events));
+
+    /* Flags 0 and 1 are set by two ticks of the counter */
+    __startTimer(300, ACTION_SET);
+    CHECK_EQ(SYNC_OK, sync_eventsWait(&__events, 0x03, SYNC_EVENTS_ALL | SYNC_EVENTS_CLEAR, SYNC_WAIT_FOREVER, &result));
+    CHECK_EQ(2, __ticks);
+    CHECK_EQ(0x03, result);
+    CHECK_EQ(0, sync_eventsGet(&__events));
+
+    /* The third tick is sufficient for any flag */
+    CHECK_EQ(SYNC_OK, sync_eventsWait(&__events, 0x0C, SYNC_EVENTS_ANY, 1000, &result));
+    CHECK_EQ(3, __ticks);
+    CHECK_EQ(0x04, result);
+
+    __stopTimer();
+}
+
+
+static void testMutex(void)
+{
+    const uint8_t irqs[BSP_NR_TIMERS] = BSP_TIMER_IRQS;
+    const uint8_t irq = BSP_SOFTWARE_IRQ;
+    syncMutex m;
+    syncMutex other;
+
+    CHECK_EQ(SYNC_ERR_PARAM, sync_mutexInit(NULL, 0));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_mutexLock(NULL));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_mutexUnlock(NULL));
+    CHECK_EQ(0, sync_mutexIsLocked(NULL));
+
+    pic_init();
+    sim_sync();
+    CHECK_EQ(0, pic_registerNonVectoredIrq(irq, &__swIsr, (void*) &m, 10));
+    pic_enableInterrupt(irq);
+    sim_sync();
+    irq_enableIrqMode();
+    __isrCalls = 0;
+
+    /* The timer's line is not enabled, so it is not masked */
+    CHECK_EQ(SYNC_OK, sync_mutexInit(&m, (1UL << irq) | (1UL << irqs[1])));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_mutexUnlock(&m));
+
+    CHECK_EQ(SYNC_OK, sync_mutexLock(&m));
+    sim_sync();
+    CHECK_EQ(1, sync_mutexIsLocked(&m));
+    CHECK_EQ(0, sim_picRegs[VIC_INTENABLE] & (1UL << irq));
+    CHECK_EQ(1UL << irq, m.masked);
+
+    /* The ISR is deferred while the mutex is locked */
+    pic_setSwInterruptNr(irq);
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(0, __isrCalls);
+    CHECK_EQ(SYNC_ERR_BUSY, sync_mutexLock(&m));
+    CHECK_EQ(1, m.contentions);
+
+    sim_timerAdvance(200);
+
+    /* The deferred ISR is serviced when the mutex is unlocked, then it finds the mutex unlocked */
+    CHECK_EQ(SYNC_OK, sync_mutexUnlock(&m));
+    sim_dispatchIrq();
+    CHECK_EQ(1, __isrCalls);
+    CHECK_EQ(SYNC_OK, __isrResult);
+    CHECK_EQ(0, sync_mutexIsLocked(&m));
+    CHECK( m.maxHoldUs >= 200 );
+    sim_sync();
+    CHECK( 0 != (sim_picRegs[VIC_INTENABLE] & (1UL << irq)) );
+    CHECK_EQ(0, sim_picRegs[VIC_INTENABLE] & (1UL << irqs[1]));
+
+    /* An ISR outside of the ceiling may find the mutex locked */
+    CHECK_EQ(SYNC_OK, sync_mutexInit(&other, 0));
+    pic_registerNonVectoredIrq(irq, &__swIsr, (void*) &other, 10);
+    CHECK_EQ(SYNC_OK, sync_mutexLock(&other));
+    pic_setSwInterruptNr(irq);
+    sim_dispatchIrq();
+    CHECK_EQ(2, __isrCalls);
+    CHECK_EQ(SYNC_ERR_BUSY, __isrResult);
+    CHECK_EQ(1, other.contentions);
+    CHECK_EQ(SYNC_OK, sync_mutexUnlock(&other));
+
+    irq_disableIrqMode();
+}
+
+
+static void testTimeoutTimer(void)
+{
+    uint32_t start;
+    uint32_t us;
+
+    pic_init();
+    sim_sync();
+    clocksource_init();
+    CHECK_EQ(SYNC_ERR_PARAM, sync_useTimeoutTimer(BSP_NR_TIMERS, 0, 10));
+    CHECK_EQ(SYNC_ERR_PARAM, sync_useTimeoutTimer(0, 2, 10));
+    CHECK_EQ(SYNC_OK, sync_useTimeoutTimer(0, 0, 10));
+    sim_sync();
+    irq_enableIrqMode();
+
+    /* No other interrupt occurs, the counter wakes the CPU when the timeout expires */
+    sync_semInit(&__sem, 0, 1);
+    start = clocksource_read();
+    CHECK_EQ(SYNC_ERR_TIMEOUT, sync_semTake(&__sem, 1200));
+    us = clocksource_ticksToUs(clocksource_read() - start);
+    CHECK( us >= 1200 && us < 1210 );
+    CHECK_EQ(0, timer_isEnabled(0, 0));
+
+    /* The counter is armed for the remaining time after another interrupt (pic_init() unregistered it) */
+    __startTimer(500, ACTION_NONE);
+    CHECK_EQ(SYNC_OK, sync_useTimeoutTimer(0, 0, 10));
+    sim_sync();
+    start = clocksource_read();
+    CHECK_EQ(SYNC_ERR_TIMEOUT, sync_eventsWait(&__events, 0x01, SYNC_EVENTS_ANY, 1200, NULL));
+    us = clocksource_ticksToUs(clocksource_read() - start);
+    CHECK( us >= 1200 && us < 1210 );
+    CHECK_EQ(2, __ticks);
+
+    __stopTimer();
+}
+
+
+void test_sync(void)
+{
+    RUN_TEST(testSemaphore);
+    RUN_TEST(testEvents);
+    RUN_TEST(testMutex);
+    RUN_TEST(testTimeoutTimer);
+}
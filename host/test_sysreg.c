@@ -0,0 +1,103 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the system registers' driver (sysreg.c).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sysreg.h"
+#include "sim.h"
+#include "unit.h"
+
+
+static void testIdAndSwitches(void)
+{
+    CHECK_EQ(0x41007004, sysreg_getId());
+
+    /* only 8 switches are implemented */
+    sim_sysRegs[SYS_SW] = 0xFFFFFF5A;
+    CHECK_EQ(0x5A, sysreg_getSwitches());
+}
+
+
+static void testLeds(void)
+{
+    sysreg_setLeds(0x1A5);
+    CHECK_EQ(0xA5, sim_sysRegs[SYS_LED]);
+    CHECK_EQ(0xA5, sysreg_getLeds());
+
+    sysreg_setLeds(0);
+    CHECK_EQ(0, sysreg_getLeds());
+}
+
+
+static void testCounters(void)
+{
+    uint32_t start24;
+    uint32_t start100;
+
+    CHECK(&sim_sysRegs[SYS_24MHZ] == sysreg_get24MHzAddr());
+
+    start24 = sysreg_get24MHz();
+    start100 = sysreg_get100Hz();
+
+    /* 25 ms */
+    sim_timerAdvance(25000);
+    CHECK_EQ(25000 * 24, sysreg_get24MHz() - start24);
+    CHECK_EQ(2, sysreg_get100Hz() - start100);
+
+    /* fractions of 10 ms are accumulated */
+    sim_timerAdvance(5000);
+    CHECK_EQ(3, sysreg_get100Hz() - start100);
+    CHECK_EQ(SYSREG_24MHZ_FREQUENCY / SYSREG_100HZ_FREQUENCY * 3,
+             sysreg_get24MHz() - start24);
+}
+
+
+static void testOscillatorsAndClcd(void)
+{
+    sysreg_setOscillator(SYSREG_OSC_CLCD, 0xFFF2C2A);
+    CHECK_EQ(0x72C2A, sim_sysRegs[SYS_OSC(4)]);
+    CHECK_EQ(0x72C2A, sysreg_getOscillator(SYSREG_OSC_CLCD));
+    CHECK_EQ(0, sim_sysRegs[SYS_LOCK]);
+
+    /* invalid oscillators are ignored */
+    sysreg_setOscillator(SYSREG_NR_OSCILLATORS, 0x1234);
+    CHECK_EQ(0, sysreg_getOscillator(SYSREG_NR_OSCILLATORS));
+    CHECK_EQ(0, sim_sysRegs[SYS_LOCK]);
+
+    sysreg_setClcdControl(SYSREG_CLCD_MODE_565_BLSB | SYSREG_CLCD_NLCDIOON | 0x3F00);
+    CHECK_EQ(0x07, sim_sysRegs[SYS_CLCD]);
+    CHECK_EQ(0x07, sysreg_getClcdControl());
+}
+
+
+void test_sysreg(void)
+{
+    RUN_TEST(testIdAndSwitches);
+    RUN_TEST(testLeds);
+    RUN_TEST(testCounters);
+    RUN_TEST(testOscillatorsAndClcd);
+}
@@ -0,0 +1,281 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the SP804 driver (timer.c) and of the clock source
+ * (clocksource.c, SYS_24MHZ backend), including counter arithmetic
+ * across wrap-arounds.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "timer.h"
+#include "clocksource.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define CTL_ENABLE          0x00000080
+#define CTL_MODE            0x00000040
+#define CTL_INTR            0x00000020
+#define CTL_PRESCALE        0x0000000C
+#define CTL_CTRLEN          0x00000002
+#define CTL_ONESHOT         0x00000001
+
+
+/* Pointer to the simulated registers of a timer's counter: */
+static uint32_t* __cntr(uint8_t timer, uint8_t counter)
+{
+    return &sim_timerRegs[timer][SP804_CNTR(counter)];
+}
+
+
+static uint32_t __nrTicks;
+
+static void __tickIsr(void* param)
+{
+    ++__nrTicks;
+    timer_clearInterrupt(0, 1);
+}
+
+
+static uint32_t __nrCalls[2];
+
+static void __counterCallback(void* param)
+{
+    ++__nrCalls[(uintptr_t) param];
+}
+
+
+static void testInit(void)
+{
+    uint32_t* r = __cntr(1, 0);
+
+    /* reserved bits must remain unmodified */
+    r[SP804_CONTROL] = 0x00000100 | CTL_ENABLE | CTL_INTR | CTL_PRESCALE | CTL_ONESHOT;
+
+    timer_init(1, 0);
+    CHECK_EQ(0x00000100 | CTL_MODE | CTL_CTRLEN, r[SP804_CONTROL]);
+    CHECK(!timer_isEnabled(1, 0));
+
+    timer_start(1, 0);
+    CHECK(timer_isEnabled(1, 0));
+    CHECK(!timer_isEnabled(1, 1));
+    CHECK(!timer_isEnabled(0, 0));
+    timer_stop(1, 0);
+    CHECK(!timer_isEnabled(1, 0));
+
+    timer_enableInterrupt(1, 0);
+    CHECK_EQ(CTL_INTR, r[SP804_CONTROL] & CTL_INTR);
+    timer_disableInterrupt(1, 0);
+    CHECK_EQ(0, r[SP804_CONTROL] & CTL_INTR);
+
+    CHECK_EQ(2, timer_countersPerTimer());
+}
+
+
+static void testInvalidParams(void)
+{
+    timer_init(2, 0);
+    timer_init(0, 2);
+    timer_start(2, 0);
+    timer_setLoad(0, 2, 1234);
+
+    CHECK(!timer_isEnabled(2, 0));
+    CHECK_EQ(0, timer_getValue(0, 2));
+    CHECK(NULL == timer_getValueAddr(2, 0));
+    CHECK(NULL == timer_getValueAddr(0, 2));
+    CHECK(&sim_timerRegs[1][SP804_CNTR(1) + SP804_VALUE] == timer_getValueAddr(1, 1));
+}
+
+
+static void testPeriodicCounting(void)
+{
+    timer_init(0, 1);
+    timer_setLoad(0, 1, 1000);
+    sim_sync();
+    CHECK_EQ(1000, timer_getValue(0, 1));
+
+    /* a stopped counter does not count */
+    sim_timerAdvance(10);
+    CHECK_EQ(1000, timer_getValue(0, 1));
+
+    timer_start(0, 1);
+    sim_timerAdvance(999);
+    CHECK_EQ(1, timer_getValue(0, 1));
+    CHECK_EQ(0, __cntr(0, 1)[SP804_RIS]);
+
+    sim_timerAdvance(1);
+    CHECK_EQ(0, timer_getValue(0, 1));
+    CHECK_EQ(1, __cntr(0, 1)[SP804_RIS]);
+    /* interrupts not enabled */
+    CHECK_EQ(0, __cntr(0, 1)[SP804_MIS]);
+    CHECK(!timer_isInterruptPending(0, 1));
+    timer_enableInterrupt(0, 1);
+    sim_sync();
+    CHECK(timer_isInterruptPending(0, 1));
+    CHECK(!timer_isInterruptPending(0, 0));
+    CHECK(!timer_isInterruptPending(0, 2));
+    timer_disableInterrupt(0, 1);
+
+    /* reloaded at the next tick */
+    sim_timerAdvance(1);
+    CHECK_EQ(1000, timer_getValue(0, 1));
+
+    timer_clearInterrupt(0, 1);
+    sim_sync();
+    CHECK_EQ(0, __cntr(0, 1)[SP804_RIS]);
+
+    /* a period equals load+1 ticks */
+    sim_timerAdvance(3 * 1001);
+    CHECK_EQ(1000, timer_getValue(0, 1));
+}
+
+
+static void testInterrupts(void)
+{
+    uint32_t i;
+
+    pic_init();
+    sim_sync();
+    pic_registerNonVectoredIrq(4, &__tickIsr, NULL, 10);
+    pic_enableInterrupt(4);
+
+    timer_init(0, 1);
+    timer_setLoad(0, 1, 99);
+    timer_enableInterrupt(0, 1);
+    timer_start(0, 1);
+    irq_enableIrqMode();
+
+    __nrTicks = 0;
+    for ( i=0; i<1000; ++i )
+    {
+        sim_timerAdvance(1);
+        sim_dispatchIrq();
+    }
+
+    /* 1000 ticks, a period of 100 ticks */
+    CHECK_EQ(10, __nrTicks);
+
+    /* the interrupt was cleared by the ISR */
+    CHECK_EQ(0, sim_picRegs[VIC_RAWINTR]);
+
+    irq_disableIrqMode();
+}
+
+
+static void testCallbacks(void)
+{
+    uint32_t i;
+
+    pic_init();
+    sim_sync();
+
+    CHECK(timer_registerCallback(1, 2, &__counterCallback, NULL, 10) < 0);
+    CHECK(timer_registerCallback(1, 0, NULL, NULL, 10) < 0);
+
+    /* Both counters of a timer are used independently */
+    CHECK_EQ(0, timer_registerCallback(1, 0, &__counterCallback, (void*) 0, 10));
+    CHECK_EQ(0, timer_registerCallback(1, 1, &__counterCallback, (void*) 1, 10));
+    for ( i=0; i<2; ++i )
+    {
+        timer_init(1, i);
+        timer_setLoad(1, i, ( 0==i ? 99 : 249 ));
+        timer_enableInterrupt(1, i);
+        timer_start(1, i);
+    }
+    sim_sync();
+    CHECK(0 != pic_isInterruptEnabled(5));
+    irq_enableIrqMode();
+
+    __nrCalls[0] = 0;
+    __nrCalls[1] = 0;
+    for ( i=0; i<1000; ++i )
+    {
+        sim_timerAdvance(1);
+        sim_dispatchIrq();
+    }
+
+    /* 1000 ticks, periods of 100 and 250 ticks, interrupts are cleared by the timer's ISR */
+    CHECK_EQ(10, __nrCalls[0]);
+    CHECK_EQ(4, __nrCalls[1]);
+    CHECK_EQ(0, sim_picRegs[VIC_RAWINTR]);
+
+    /* The other counter's callback remains registered */
+    timer_unregisterCallback(1, 0);
+    sim_sync();
+    CHECK(0 != pic_isInterruptEnabled(5));
+    for ( i=0; i<500; ++i )
+    {
+        sim_timerAdvance(1);
+        sim_dispatchIrq();
+    }
+    CHECK_EQ(10, __nrCalls[0]);
+    CHECK_EQ(6, __nrCalls[1]);
+
+    /* The timer's IRQ is disabled with the last callback */
+    timer_unregisterCallback(1, 1);
+    sim_sync();
+    CHECK_EQ(0, pic_isInterruptEnabled(5));
+
+    irq_disableIrqMode();
+    timer_stop(1, 0);
+    timer_stop(1, 1);
+}
+
+
+static void testClocksourceWrap(void)
+{
+    uint32_t start;
+
+    clocksource_init();
+    sim_sync();
+    CHECK_EQ(24000000, clocksource_getFrequency());
+    CHECK_EQ(0, clocksource_getCounterMask());
+    CHECK(&sim_sysRegs[SYS_24MHZ] == clocksource_getCounterAddr());
+
+    /* SYS_24MHZ counts 24 ticks per timer (1 MHz) tick */
+    start = clocksource_read();
+    sim_timerAdvance(12345);
+    CHECK_EQ(24 * 12345, clocksource_read() - start);
+    CHECK_EQ(12345, clocksource_ticksToUs(clocksource_read() - start));
+
+    /* the counter wraps from 0xFFFFFFFF to 0, the difference must remain correct */
+    sim_sysRegs[SYS_24MHZ] = 0xFFFFFFF0;
+    start = clocksource_read();
+    sim_timerAdvance(10);
+    CHECK_EQ(0x000000E0, sim_sysRegs[SYS_24MHZ]);
+    CHECK_EQ(240, clocksource_read() - start);
+}
+
+
+void test_timer(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testInvalidParams);
+    RUN_TEST(testPeriodicCounting);
+    RUN_TEST(testInterrupts);
+    RUN_TEST(testCallbacks);
+    RUN_TEST(testClocksourceWrap);
+}
@@ -0,0 +1,383 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the telemetry log (tlog.c) on top of the simulated SD card.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "tlog.h"
+#include "blk.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+/* Records per page: (BLK_SIZE - page header) / sizeof(tlogRecord) */
+#define RECS            41
+
+/* The log's region */
+#define FIRST           100
+#define NR_BLOCKS       301
+
+
+/* @return number of write commands, received by the card */
+static uint32_t __nrWrites(void)
+{
+    return sim_sdNrCommands[24] + sim_sdNrCommands[25];
+}
+
+
+/* Clears the card and initializes the block device */
+static void __init(void)
+{
+    memset(sim_sdData, 0, sizeof(sim_sdData));
+
+    pic_init();
+    sim_sync();
+    CHECK_EQ(BLK_OK, blk_init(10));
+}
+
+
+/* Appends records with timestamps 10*i, i from 'first' to 'last' - 1 */
+static void __append(uint32_t first, uint32_t last)
+{
+    uint32_t i;
+
+    for ( i=first; i<last; ++i )
+    {
+        CHECK_EQ(TLOG_OK, tlog_append(10 * i, (uint16_t) (i & 7), 0, i));
+    }
+}
+
+
+/*
+ * Queries the range and checks that consecutive records with values from 'first'
+ * on are returned.
+ *
+ * @return number of returned records
+ */
+static uint32_t __query(uint32_t from, uint32_t to, uint32_t first)
+{
+    tlogCursor cur;
+    tlogRecord rec;
+    uint32_t n = 0;
+
+    CHECK_EQ(TLOG_OK, tlog_seek(&cur, from, to));
+    while ( TLOG_OK == tlog_next(&cur, &rec) )
+    {
+        CHECK_EQ(first + n, rec.value);
+        CHECK_EQ(10 * rec.value, rec.ts);
+        CHECK_EQ(rec.value & 7, rec.channel);
+        ++n;
+    }
+
+    return n;
+}
+
+
+static void testInvalidParams(void)
+{
+    tlogCursor cur;
+    tlogRecord rec;
+
+    __init();
+
+    CHECK_EQ(TLOG_ERR_PARAM, tlog_format(FIRST, TLOG_MIN_BLOCKS - 1));
+    CHECK_EQ(TLOG_ERR_PARAM, tlog_format(SIM_SD_NR_BLOCKS - 10, 11));
+    CHECK_EQ(TLOG_ERR_NOLOG, tlog_append(1, 0, 0, 0));
+    CHECK_EQ(TLOG_ERR_NOLOG, tlog_sync());
+    CHECK_EQ(TLOG_ERR_NOLOG, tlog_seek(&cur, 0, 10));
+
+    /* no log on an empty card */
+    CHECK_EQ(TLOG_ERR_NOLOG, tlog_mount(FIRST, NR_BLOCKS));
+
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+    CHECK_EQ(TLOG_ERR_PARAM, tlog_seek(NULL, 0, 10));
+    CHECK_EQ(TLOG_ERR_PARAM, tlog_seek(&cur, 11, 10));
+    CHECK_EQ(TLOG_OK, tlog_seek(&cur, 0, 10));
+    CHECK_EQ(TLOG_ERR_PARAM, tlog_next(&cur, NULL));
+    CHECK_EQ(TLOG_END, tlog_next(&cur, &rec));
+
+    /* the size of the region must match */
+    CHECK_EQ(TLOG_ERR_NOLOG, tlog_mount(FIRST, NR_BLOCKS + 1));
+}
+
+
+static void testDecreasingTimestamp(void)
+{
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+
+    CHECK_EQ(TLOG_OK, tlog_append(100, 0, 0, 0));
+    CHECK_EQ(TLOG_OK, tlog_append(100, 0, 0, 1));
+    CHECK_EQ(TLOG_ERR_PARAM, tlog_append(99, 0, 0, 2));
+    CHECK_EQ(TLOG_OK, tlog_append(101, 0, 0, 3));
+}
+
+
+static void testAppendQuery(void)
+{
+    tlogCursor cur;
+    tlogRecord rec;
+
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+    __append(0, 1000);
+
+    /* ranges within pages on the device, in RAM and both */
+    CHECK_EQ(100, __query(2000, 2990, 200));
+    CHECK_EQ(30, __query(9700, 100000, 970));
+    CHECK_EQ(1000, __query(0, 9990, 0));
+    CHECK_EQ(1, __query(5, 10, 1));
+    CHECK_EQ(0, __query(10000, 20000, 0));
+
+    /* records appended after the end are returned by further calls */
+    CHECK_EQ(TLOG_OK, tlog_seek(&cur, 9990, 10010));
+    CHECK_EQ(TLOG_OK, tlog_next(&cur, &rec));
+    CHECK_EQ(999, rec.value);
+    CHECK_EQ(TLOG_END, tlog_next(&cur, &rec));
+    __append(1000, 1003);
+    CHECK_EQ(TLOG_OK, tlog_next(&cur, &rec));
+    CHECK_EQ(1000, rec.value);
+    CHECK_EQ(TLOG_OK, tlog_next(&cur, &rec));
+    CHECK_EQ(1001, rec.value);
+    CHECK_EQ(TLOG_END, tlog_next(&cur, &rec));
+    CHECK_EQ(TLOG_END, tlog_next(&cur, &rec));
+}
+
+
+static void testBatchedWrites(void)
+{
+    tlogStats stats;
+
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+    CHECK_EQ(1, sim_sdNrCommands[24]);
+
+    /* nothing is written until the batch is full */
+    __append(0, TLOG_BATCH_PAGES * RECS - 1);
+    CHECK_EQ(1, __nrWrites());
+
+    /* the full batch is written by a single command */
+    __append(TLOG_BATCH_PAGES * RECS - 1, TLOG_BATCH_PAGES * RECS);
+    CHECK_EQ(1, sim_sdNrCommands[25]);
+    CHECK_EQ(2, __nrWrites());
+
+    tlog_getStats(&stats);
+    CHECK_EQ(TLOG_BATCH_PAGES * RECS, stats.records);
+    CHECK_EQ(TLOG_BATCH_PAGES, stats.pageWrites);
+    CHECK_EQ(2, stats.devWrites);
+    CHECK_EQ(1, stats.checkpoints);
+
+    /* the checkpoint is written after TLOG_CHECKPOINT_PAGES pages */
+    __append(TLOG_BATCH_PAGES * RECS, TLOG_CHECKPOINT_PAGES * RECS);
+    tlog_getStats(&stats);
+    CHECK_EQ(TLOG_CHECKPOINT_PAGES, stats.pageWrites);
+    CHECK_EQ(2, stats.checkpoints);
+    CHECK_EQ(TLOG_CHECKPOINT_PAGES / TLOG_BATCH_PAGES + 2, __nrWrites());
+}
+
+
+static void testWrapAround(void)
+{
+    /* the ring of 38 pages is not a multiple of the batch */
+    const uint32_t nrPages = 38;
+    const uint32_t total = 5 * nrPages * RECS + 7;
+    /* the oldest page within the ring, pages (and records) are numbered from 0 here */
+    const uint32_t oldest = total / RECS - nrPages + 1;
+
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, nrPages + 1));
+    __append(0, total);
+
+    CHECK_EQ(total - oldest * RECS, __query(0, 10 * total, oldest * RECS));
+    CHECK_EQ(100, __query(10 * (total - 100), 10 * total, total - 100));
+
+    /* the data on the device is consistent as well */
+    CHECK_EQ(TLOG_OK, tlog_sync());
+    CHECK_EQ(TLOG_OK, tlog_mount(FIRST, nrPages + 1));
+    CHECK_EQ(total - oldest * RECS, __query(0, 10 * total, oldest * RECS));
+
+    /* nothing beyond the region was written */
+    CHECK_EQ(0, sim_sdData[(FIRST + nrPages + 1) * BLK_SIZE]);
+    CHECK_EQ(0, sim_sdData[FIRST * BLK_SIZE - 1]);
+}
+
+
+static void testSmallRingMount(void)
+{
+    /* the ring of 38 pages is smaller than TLOG_CHECKPOINT_PAGES */
+    const uint32_t nrPages = 38;
+    const uint32_t total = 5 * nrPages * RECS + 7;
+    /* pages of full batches are on the device, numbered from 0 */
+    const uint32_t written = total / RECS / TLOG_BATCH_PAGES * TLOG_BATCH_PAGES;
+    const uint32_t oldest = written - nrPages + 1;
+
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, nrPages + 1));
+    __append(0, total);
+
+    /* the ring has wrapped several times, the mount must not start at an overwritten page */
+    CHECK_EQ(TLOG_OK, tlog_mount(FIRST, nrPages + 1));
+    CHECK_EQ((written - oldest) * RECS, __query(0, 10 * total, oldest * RECS));
+
+    /* appending continues after the last written page */
+    __append(written * RECS, (written + 1) * RECS);
+    CHECK_EQ((written - oldest) * RECS, __query(0, 10 * total, (oldest + 1) * RECS));
+}
+
+
+static void testMountScansTail(void)
+{
+    tlogStats stats;
+    const uint32_t total = 200 * RECS + 5;
+
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+    __append(0, total);
+    CHECK_EQ(TLOG_OK, tlog_sync());
+
+    /* only the head page is scanned after a sync */
+    CHECK_EQ(TLOG_OK, tlog_mount(FIRST, NR_BLOCKS));
+    tlog_getStats(&stats);
+    CHECK_EQ(1, stats.mountScanned);
+    CHECK_EQ(total, __query(0, 10 * total, 0));
+    CHECK_EQ(20, __query(10 * 3000, 10 * 3019, 3000));
+
+    /* appending continues, records of unwritten batches are lost without a sync */
+    __append(total, total + 10 * RECS);
+    CHECK_EQ(TLOG_OK, tlog_mount(FIRST, NR_BLOCKS));
+    tlog_getStats(&stats);
+    CHECK(stats.mountScanned <= TLOG_CHECKPOINT_PAGES + TLOG_BATCH_PAGES + 1);
+    CHECK_EQ(total - 5 + 8 * RECS, __query(0, 10 * total + 100000, 0));
+
+    /* timestamps of lost records may be reused */
+    CHECK_EQ(TLOG_OK, tlog_append(10 * (total - 5 + 8 * RECS), 0, 0, total - 5 + 8 * RECS));
+}
+
+
+static void testPartialPageSync(void)
+{
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+
+    __append(0, 10);
+    CHECK_EQ(TLOG_OK, tlog_sync());
+    CHECK_EQ(TLOG_OK, tlog_mount(FIRST, NR_BLOCKS));
+    CHECK_EQ(10, __query(0, 100000, 0));
+
+    /* the partial page is completed and rewritten */
+    __append(10, 2 * RECS + 3);
+    CHECK_EQ(TLOG_OK, tlog_sync());
+    __append(2 * RECS + 3, 2 * RECS + 4);
+    CHECK_EQ(TLOG_OK, tlog_mount(FIRST, NR_BLOCKS));
+    CHECK_EQ(2 * RECS + 3, __query(0, 100000, 0));
+
+    __append(2 * RECS + 3, 6 * RECS);
+    CHECK_EQ(TLOG_OK, tlog_sync());
+    CHECK_EQ(TLOG_OK, tlog_mount(FIRST, NR_BLOCKS));
+    CHECK_EQ(6 * RECS, __query(0, 100000, 0));
+}
+
+
+static void testCrcError(void)
+{
+    tlogStats stats;
+    tlogCursor cur;
+    tlogRecord rec;
+    uint32_t n = 0;
+
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+    __append(0, 20 * RECS);
+    CHECK_EQ(TLOG_OK, tlog_sync());
+
+    /* corrupt a record of the 6th page */
+    sim_sdData[(FIRST + 6) * BLK_SIZE + 100] ^= 0x01;
+
+    CHECK_EQ(TLOG_OK, tlog_seek(&cur, 0, 100000));
+    while ( TLOG_OK == tlog_next(&cur, &rec) )
+    {
+        CHECK(rec.value < 5 * RECS || rec.value >= 6 * RECS);
+        ++n;
+    }
+    CHECK_EQ(19 * RECS, n);
+
+    tlog_getStats(&stats);
+    CHECK_EQ(1, stats.crcErrors);
+
+    /* a corrupted checkpoint */
+    sim_sdData[FIRST * BLK_SIZE + 40] ^= 0x80;
+    CHECK_EQ(TLOG_ERR_NOLOG, tlog_mount(FIRST, NR_BLOCKS));
+}
+
+
+static void testFormatDiscardsLog(void)
+{
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+    __append(0, 10 * RECS + 1);
+    CHECK_EQ(TLOG_OK, tlog_sync());
+
+    /* pages of the previous log are not recognized */
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+    CHECK_EQ(TLOG_OK, tlog_mount(FIRST, NR_BLOCKS));
+    CHECK_EQ(0, __query(0, 100000, 0));
+    CHECK_EQ(TLOG_OK, tlog_append(0, 0, 0, 0));
+}
+
+
+static void testDeviceError(void)
+{
+    __init();
+    CHECK_EQ(TLOG_OK, tlog_format(FIRST, NR_BLOCKS));
+    __append(0, TLOG_BATCH_PAGES * RECS - 1);
+
+    /* the full batch is retried by the next append */
+    sim_mmciDataErrors = PL181_ST_DATA_CRC_FAIL;
+    CHECK_EQ(TLOG_ERR_IO, tlog_append(10 * (TLOG_BATCH_PAGES * RECS - 1), (TLOG_BATCH_PAGES * RECS - 1) & 7, 0, TLOG_BATCH_PAGES * RECS - 1));
+    __append(TLOG_BATCH_PAGES * RECS, TLOG_BATCH_PAGES * RECS + 1);
+    CHECK_EQ(TLOG_OK, tlog_sync());
+
+    CHECK_EQ(TLOG_OK, tlog_mount(FIRST, NR_BLOCKS));
+    CHECK_EQ(TLOG_BATCH_PAGES * RECS + 1, __query(0, 100000, 0));
+}
+
+
+void test_tlog(void)
+{
+    RUN_TEST(testInvalidParams);
+    RUN_TEST(testDecreasingTimestamp);
+    RUN_TEST(testAppendQuery);
+    RUN_TEST(testBatchedWrites);
+    RUN_TEST(testWrapAround);
+    RUN_TEST(testSmallRingMount);
+    RUN_TEST(testMountScansTail);
+    RUN_TEST(testPartialPageSync);
+    RUN_TEST(testCrcError);
+    RUN_TEST(testFormatDiscardsLog);
+    RUN_TEST(testDeviceError);
+}
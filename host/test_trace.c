@@ -0,0 +1,189 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the event trace buffer (trace.c) and of the trace points
+ * in the interrupt and timer drivers.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "trace.h"
+#include "clocksource.h"
+#include "timer.h"
+#include "interrupt.h"
+#include "sim.h"
+#include "unit.h"
+
+
+/* Defined in interrupt.c: */
+extern void _pic_set_irq_vector_mode(int8_t mode);
+
+
+static void __tickIsr(void* param)
+{
+    timer_clearInterrupt(0, 0);
+}
+
+static void __vectTickIsr(void)
+{
+    timer_clearInterrupt(0, 0);
+}
+
+
+static void testDisabled(void)
+{
+    trace_init();
+    sim_sync();
+    CHECK(!trace_isEnabled());
+
+    trace_marker(1);
+    CHECK_EQ(0, trace_getNrRecords());
+    CHECK(NULL == trace_getRecord(0));
+
+    trace_enable();
+    CHECK(trace_isEnabled());
+    trace_marker(2);
+    trace_disable();
+    trace_marker(3);
+
+    CHECK_EQ(1, trace_getNrRecords());
+    CHECK_EQ(TRACE_EV_MARKER, trace_getRecord(0)->event);
+    CHECK_EQ(2, trace_getRecord(0)->arg);
+    CHECK(NULL == trace_getRecord(1));
+
+    trace_clear();
+    CHECK_EQ(0, trace_getNrRecords());
+}
+
+
+static void testTimestamps(void)
+{
+    uint32_t ticksPerUs;
+    uint32_t i;
+
+    trace_init();
+    sim_sync();
+    trace_enable();
+    ticksPerUs = clocksource_getFrequency() / 1000000;
+
+    for ( i=0; i<10; ++i )
+    {
+        trace_event(TRACE_EV_USER, (uint16_t) i);
+        sim_timerAdvance(100);
+    }
+
+    CHECK_EQ(10, trace_getNrRecords());
+    for ( i=1; i<10; ++i )
+    {
+        CHECK_EQ(100 * ticksPerUs, trace_getRecord(i)->ts - trace_getRecord(i-1)->ts);
+        CHECK_EQ(TRACE_EV_USER, trace_getRecord(i)->event);
+        CHECK_EQ(i, trace_getRecord(i)->arg);
+    }
+
+    trace_disable();
+}
+
+
+static void testWrap(void)
+{
+    const uint32_t total = 3 * TRACE_NR_RECORDS + 17;
+    uint32_t i;
+
+    trace_init();
+    sim_sync();
+    trace_enable();
+
+    for ( i=0; i<total; ++i )
+    {
+        trace_marker((uint16_t) i);
+    }
+
+    /* only the newest records are kept, the oldest one has index 0 */
+    CHECK_EQ(TRACE_NR_RECORDS, trace_getNrRecords());
+    for ( i=0; i<TRACE_NR_RECORDS; ++i )
+    {
+        CHECK_EQ((uint16_t) (total - TRACE_NR_RECORDS + i), trace_getRecord(i)->arg);
+    }
+    CHECK(NULL == trace_getRecord(TRACE_NR_RECORDS));
+
+    trace_disable();
+}
+
+
+static void testIrqEvents(void)
+{
+    pic_init();
+    sim_sync();
+    trace_init();
+    sim_sync();
+
+    pic_registerNonVectoredIrq(4, &__tickIsr, NULL, 10);
+    pic_enableInterrupt(4);
+    timer_init(0, 0);
+    timer_setLoad(0, 0, 9);
+    timer_enableInterrupt(0, 0);
+    timer_start(0, 0);
+    irq_enableIrqMode();
+
+    trace_enable();
+    sim_timerAdvance(10);
+    CHECK_EQ(1, sim_dispatchIrq());
+
+    CHECK_EQ(3, trace_getNrRecords());
+    CHECK_EQ(TRACE_EV_IRQ_ENTRY, trace_getRecord(0)->event);
+    CHECK_EQ(4, trace_getRecord(0)->arg);
+    CHECK_EQ(TRACE_EV_TIMER, trace_getRecord(1)->event);
+    CHECK_EQ(0, trace_getRecord(1)->arg);
+    CHECK_EQ(TRACE_EV_IRQ_EXIT, trace_getRecord(2)->event);
+    CHECK_EQ(4, trace_getRecord(2)->arg);
+
+    /* vectored ISRs are identified by their addresses */
+    pic_unregisterNonVectoredIrq(4);
+    pic_registerVectorIrq(4, &__vectTickIsr, 0);
+    pic_enableInterrupt(4);
+    _pic_set_irq_vector_mode(1);
+    trace_clear();
+
+    sim_timerAdvance(10);
+    CHECK_EQ(1, sim_dispatchIrq());
+
+    CHECK_EQ(3, trace_getNrRecords());
+    CHECK_EQ(TRACE_EV_IRQ_ENTRY, trace_getRecord(0)->event);
+    CHECK_EQ(4, trace_getRecord(0)->arg);
+    CHECK_EQ(TRACE_EV_IRQ_EXIT, trace_getRecord(2)->event);
+    CHECK_EQ(4, trace_getRecord(2)->arg);
+
+    trace_disable();
+    irq_disableIrqMode();
+    _pic_set_irq_vector_mode(0);
+}
+
+
+void test_trace(void)
+{
+    RUN_TEST(testDisabled);
+    RUN_TEST(testTimestamps);
+    RUN_TEST(testWrap);
+    RUN_TEST(testIrqEvents);
+}
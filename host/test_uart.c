@@ -0,0 +1,328 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Unit tests of the PL011 driver (uart.c).
+ *
+ * Received characters are sent by sim_uartInject(), the poll timer
+ * is advanced by sim_timerAdvance().
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "uart.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "sim.h"
+#include "unit.h"
+
+
+#define CTL_UARTEN     0x00000001
+#define CTL_LBE        0x00000080
+#define CTL_TXE        0x00000100
+#define CTL_RXE        0x00000200
+#define CTL_RTSEn      0x00004000
+
+#define INT_RXIM       0x00000010
+#define INT_RTIM       0x00000040
+#define LCRH_FEN       0x00000010
+
+/* Period of the poll timer in ticks (a periodic counter reloads at the tick after reaching 0): */
+#define POLL_TICKS     101
+
+
+/* Initializes the PIC and the receive path of UART 0, the IRQ mode is enabled */
+static void __initRx(void)
+{
+    pic_init();
+    sim_sync();
+    uart_init(0);
+    CHECK_EQ(UART_OK, uart_enableRxInterrupt(0, 1));
+    sim_sync();
+    irq_enableIrqMode();
+}
+
+
+/* Sends 'count' characters, starting by 'first' and incremented by 1 */
+static void __send(uint8_t first, uint32_t count)
+{
+    uint8_t buf[32];
+    uint32_t i;
+
+    for ( i=0; i<count && i<sizeof(buf); ++i )
+    {
+        buf[i] = (uint8_t) (first + i);
+    }
+
+    sim_uartInject(0, buf, i);
+}
+
+
+static void testInit(void)
+{
+    uint32_t* r = sim_uartRegs[1];
+
+    r[PL011_CR] = 0x00010000 | CTL_LBE | CTL_RXE | CTL_RTSEn;
+    r[PL011_IMSC] = 0x00010000 | 0x7FF;
+
+    uart_init(1);
+
+    /* reserved bits remain unmodified */
+    CHECK_EQ(0x00010000 | CTL_TXE | CTL_UARTEN, r[PL011_CR]);
+    CHECK_EQ(0x00010000, r[PL011_IMSC]);
+
+    /* other UARTs are not touched */
+    CHECK_EQ(0, sim_uartRegs[0][PL011_CR]);
+    CHECK_EQ(0, sim_uartRegs[2][PL011_CR]);
+
+    /* invalid UART */
+    uart_init(3);
+}
+
+
+static void testEnableDisable(void)
+{
+    uint32_t* r = sim_uartRegs[2];
+
+    uart_init(2);
+
+    uart_enableRx(2);
+    CHECK_EQ(CTL_RXE | CTL_TXE | CTL_UARTEN, r[PL011_CR]);
+    uart_disableTx(2);
+    CHECK_EQ(CTL_RXE | CTL_UARTEN, r[PL011_CR]);
+
+    /* Rx/Tx settings do not enable a disabled UART */
+    uart_disableUart(2);
+    CHECK_EQ(CTL_RXE, r[PL011_CR]);
+    uart_enableTx(2);
+    uart_disableRx(2);
+    CHECK_EQ(CTL_TXE, r[PL011_CR]);
+
+    uart_enableUart(2);
+    CHECK_EQ(CTL_TXE | CTL_UARTEN, r[PL011_CR]);
+
+    uart_setLoopback(2, 1);
+    CHECK_EQ(CTL_LBE | CTL_TXE | CTL_UARTEN, r[PL011_CR]);
+    uart_setLoopback(2, 0);
+    CHECK_EQ(CTL_TXE | CTL_UARTEN, r[PL011_CR]);
+
+    uart_enableRx(3);
+    uart_disableUart(3);
+}
+
+
+static void testPrint(void)
+{
+    uart_init(0);
+
+    uart_printChar(0, 'x');
+    CHECK_EQ('x', sim_uartRegs[0][PL011_DR] & 0xFF);
+
+    /* the last character remains in the (simulated) Data Register */
+    uart_print(0, "abc");
+    CHECK_EQ('c', sim_uartRegs[0][PL011_DR] & 0xFF);
+
+    uart_printChar(3, 'y');
+    uart_print(3, "z");
+    CHECK_EQ('c', sim_uartRegs[0][PL011_DR] & 0xFF);
+}
+
+
+static void testRxInterrupt(void)
+{
+    const uint8_t irqs[BSP_NR_UARTS] = BSP_UART_IRQS;
+    uartRxStats stats;
+    uint32_t i;
+
+    CHECK_EQ(UART_ERR_PARAM, uart_enableRxInterrupt(BSP_NR_UARTS, 1));
+    CHECK_EQ(UART_ERR_PARAM, uart_getRxStats(0, NULL));
+    CHECK_EQ(-1, uart_readChar(BSP_NR_UARTS));
+    CHECK_EQ(UART_RX_OFF, uart_getRxMode(0));
+    CHECK_EQ(UART_ERR_NOINIT, uart_rxUsePollTimer(0, 1, 0, 2));
+
+    __initRx();
+
+    CHECK_EQ(UART_RX_IRQ, uart_getRxMode(0));
+    CHECK_EQ(INT_RXIM | INT_RTIM, sim_uartRegs[0][PL011_IMSC]);
+    CHECK_EQ(LCRH_FEN, sim_uartRegs[0][PL011_LCRH]);
+    CHECK_EQ(0x10, sim_uartRegs[0][PL011_IFLS]);
+    CHECK_EQ(CTL_RXE | CTL_TXE | CTL_UARTEN, sim_uartRegs[0][PL011_CR]);
+    CHECK( 0 != (sim_picRegs[VIC_INTENABLE] & (1UL << irqs[0])) );
+
+    /* A few characters raise the receive timeout */
+    __send('a', 5);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(0, sim_dispatchIrq());
+    CHECK_EQ(5, uart_rxAvailable(0));
+    for ( i=0; i<5; ++i )
+    {
+        CHECK_EQ('a' + i, uart_readChar(0));
+    }
+    CHECK_EQ(-1, uart_readChar(0));
+
+    /* Characters that do not fit into the FIFO are lost */
+    irq_disableIrqMode();
+    __send(0, 20);
+    CHECK_EQ(INT_RXIM | INT_RTIM, sim_uartRegs[0][PL011_MIS]);
+    irq_enableIrqMode();
+    CHECK_EQ(0, sim_uartRegs[0][PL011_MIS]);
+    CHECK_EQ(SIM_UART_FIFO_DEPTH, uart_rxAvailable(0));
+
+    CHECK_EQ(UART_OK, uart_getRxStats(0, &stats));
+    CHECK_EQ(5 + SIM_UART_FIFO_DEPTH, stats.bytes);
+    CHECK_EQ(2, stats.irqs);
+    CHECK_EQ(1, stats.overruns);
+    CHECK_EQ(0, stats.polls);
+    CHECK_EQ(0, stats.toPoll);
+
+    /* Without a poll timer, the receive path never switches to polling */
+    for ( i=0; i<100; ++i )
+    {
+        __send(0, 8);
+        CHECK_EQ(1, sim_dispatchIrq());
+    }
+    CHECK_EQ(UART_RX_IRQ, uart_getRxMode(0));
+    CHECK_EQ(UART_RX_BUF_SIZE, uart_rxAvailable(0));
+    uart_getRxStats(0, &stats);
+    CHECK_EQ(1 + (SIM_UART_FIFO_DEPTH + 800 - UART_RX_BUF_SIZE), stats.overruns);
+
+    uart_resetRxStats(0);
+    uart_getRxStats(0, &stats);
+    CHECK_EQ(0, stats.bytes + stats.irqs + stats.overruns);
+
+    /* Unread characters are discarded */
+    uart_disableRxInterrupt(0);
+    sim_sync();
+    CHECK_EQ(UART_RX_OFF, uart_getRxMode(0));
+    CHECK_EQ(0, uart_rxAvailable(0));
+    CHECK_EQ(0, sim_uartRegs[0][PL011_IMSC]);
+    __send(0, 8);
+    CHECK_EQ(0, sim_dispatchIrq());
+}
+
+
+static void testRxAdaptive(void)
+{
+    const uartRxConfig config = { 4, 1000, 100, 8, 3 };
+    uartRxConfig bad = config;
+    uartRxStats stats;
+    uint32_t i;
+
+    __initRx();
+
+    CHECK_EQ(UART_ERR_PARAM, uart_rxUsePollTimer(0, BSP_NR_TIMERS, 0, 2));
+    CHECK_EQ(UART_ERR_PARAM, uart_rxUsePollTimer(0, 1, timer_countersPerTimer(), 2));
+    CHECK_EQ(UART_OK, uart_rxUsePollTimer(0, 1, 0, 2));
+    bad.budget = 0;
+    CHECK_EQ(UART_ERR_PARAM, uart_setRxConfig(0, &bad));
+    CHECK_EQ(UART_ERR_PARAM, uart_setRxConfig(BSP_NR_UARTS, &config));
+    CHECK_EQ(UART_OK, uart_setRxConfig(0, &config));
+
+    /* Low rate: windows expire before the threshold is exceeded */
+    for ( i=0; i<20; ++i )
+    {
+        __send(0, 8);
+        CHECK_EQ(1, sim_dispatchIrq());
+        sim_timerAdvance(300);
+    }
+    CHECK_EQ(UART_RX_IRQ, uart_getRxMode(0));
+    CHECK_EQ(0, timer_isEnabled(1, 0));
+
+    while ( uart_readChar(0) >= 0 );
+    uart_resetRxStats(0);
+    sim_timerAdvance(1000);
+
+    /* The 5th interrupt within the window switches to polling */
+    for ( i=0; i<5; ++i )
+    {
+        __send((uint8_t) (8 * i), 8);
+        CHECK_EQ(1, sim_dispatchIrq());
+    }
+    CHECK_EQ(UART_RX_POLL, uart_getRxMode(0));
+    CHECK_EQ(0, sim_uartRegs[0][PL011_IMSC] & (INT_RXIM | INT_RTIM));
+    CHECK( 0 != timer_isEnabled(1, 0) );
+
+    /* Received characters do not interrupt, polls drain at most 'budget' of them */
+    __send(40, 16);
+    CHECK_EQ(0, sim_dispatchIrq());
+    sim_timerAdvance(POLL_TICKS);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(48, uart_rxAvailable(0));
+    sim_timerAdvance(POLL_TICKS);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(56, uart_rxAvailable(0));
+
+    /* Polls without characters switch back to interrupts */
+    for ( i=0; i<3; ++i )
+    {
+        CHECK_EQ(UART_RX_POLL, uart_getRxMode(0));
+        sim_timerAdvance(POLL_TICKS);
+        CHECK_EQ(1, sim_dispatchIrq());
+    }
+    CHECK_EQ(UART_RX_IRQ, uart_getRxMode(0));
+    CHECK_EQ(INT_RXIM | INT_RTIM, sim_uartRegs[0][PL011_IMSC]);
+    CHECK_EQ(0, timer_isEnabled(1, 0));
+
+    /* Characters are received in order */
+    for ( i=0; i<56; ++i )
+    {
+        CHECK_EQ((int16_t) i, uart_readChar(0));
+    }
+
+    uart_getRxStats(0, &stats);
+    CHECK_EQ(56, stats.bytes);
+    CHECK_EQ(5, stats.irqs);
+    CHECK_EQ(5, stats.polls);
+    CHECK_EQ(0, stats.overruns);
+    CHECK_EQ(1, stats.toPoll);
+    CHECK_EQ(1, stats.toIrq);
+
+    /* Interrupts are counted in a new window */
+    __send(0, 1);
+    CHECK_EQ(1, sim_dispatchIrq());
+    CHECK_EQ(UART_RX_IRQ, uart_getRxMode(0));
+    CHECK_EQ(1, uart_rxAvailable(0));
+
+    /* Disabling while polling stops the timer */
+    for ( i=0; i<5; ++i )
+    {
+        __send(0, 1);
+        sim_dispatchIrq();
+    }
+    CHECK_EQ(UART_RX_POLL, uart_getRxMode(0));
+    uart_disableRxInterrupt(0);
+    CHECK_EQ(0, timer_isEnabled(1, 0));
+    sim_timerAdvance(POLL_TICKS);
+    CHECK_EQ(0, sim_dispatchIrq());
+}
+
+
+void test_uart(void)
+{
+    RUN_TEST(testInit);
+    RUN_TEST(testEnableDisable);
+    RUN_TEST(testPrint);
+    RUN_TEST(testRxInterrupt);
+    RUN_TEST(testRxAdaptive);
+}
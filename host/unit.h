@@ -0,0 +1,101 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * A minimal unit test framework for the host (unit test) build.
+ *
+ * A failed check is reported with its file and line, the test continues.
+ * The test runner (test_main.c) exits with a nonzero status if any check failed.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _UNIT_H_
+#define _UNIT_H_
+
+#include <stdio.h>
+
+
+extern unsigned long unit_nrChecks;
+extern unsigned long unit_nrFailures;
+
+
+#define CHECK(COND) \
+    do { \
+        ++unit_nrChecks; \
+        if ( !(COND) ) \
+        { \
+            ++unit_nrFailures; \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #COND); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(EXPECTED, ACTUAL) \
+    do { \
+        const unsigned long __exp = (unsigned long) (EXPECTED); \
+        const unsigned long __act = (unsigned long) (ACTUAL); \
+        ++unit_nrChecks; \
+        if ( __exp != __act ) \
+        { \
+            ++unit_nrFailures; \
+            printf("%s:%d: CHECK_EQ(%s, %s) failed: expected 0x%lX, got 0x%lX\n", \
+                   __FILE__, __LINE__, #EXPECTED, #ACTUAL, __exp, __act); \
+        } \
+    } while (0)
+
+#define RUN_TEST(FUNC) \
+    do { \
+        printf("  %s\n", #FUNC); \
+        sim_reset(); \
+        FUNC(); \
+    } while (0)
+
+
+/* Test suites, implemented in test_*.c: */
+void test_interrupt(void);
+void test_timer(void);
+void test_uart(void);
+void test_rtc(void);
+void test_sysreg(void);
+void test_trace(void);
+void test_cpuload(void);
+void test_dma(void);
+void test_mmci(void);
+void test_bcache(void);
+void test_tlog(void);
+void test_flash(void);
+
+void test_clcd(void);
+
+void test_comp(void);
+
+void test_kmi(void);
+
+void test_gpio(void);
+
+void test_ssp(void);
+
+void test_cyclic(void);
+
+void test_edf(void);
+
+void test_sync(void);
+
+#endif  /* _UNIT_H_ */
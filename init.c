@@ -33,6 +33,7 @@ limitations under the License.
  #include "timer.h"
  #include "uart.h"
  #include "rtc.h"
+ #include "pmlog.h"
  
  /*
   * Performs initialization of all supported hardware.
@@ -67,5 +68,11 @@ limitations under the License.
      
      /* Init the real time clock */
      rtc_init();
+     
+     /*
+      * Emit the post-mortem log (and a crash dump) of the previous boot
+      * to the UART0, before anything else is logged.
+      */
+     pmlog_init(0);
 }
  
\ No newline at end of file
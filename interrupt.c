@@ -19,7 +19,16 @@ limitations under the License.
  * 
  * Implementation of the board's Primary Interrupt Controller (PIC) functionality.
  * 
- * Secondary Interrupt Controller (SIC) is currently not supported.
+ * Sources of the Secondary Interrupt Controller (SIC) are either passed
+ * through directly to the same interrupt request lines of the PIC (only
+ * sources between 21 and 30), or cascaded: the SIC triggers the PIC's
+ * line 31 and its ISR dispatches all pending sources to their own ISRs
+ * (see pic_enableSicCascade()).
+ *
+ * Nonvectored interrupt request lines may be rate limited (see
+ * pic_setIrqRateLimit()). When a line exceeds its rate, it is masked and
+ * re-enabled by a SP804 counter after its window, so requests of a faulty
+ * peripheral, raised meanwhile, are coalesced into a single ISR call.
  *
  * More info about the board and the PIC controller:
  * - Versatile Application Baseboard for ARM926EJ-S, HBI 0118 (DUI0225D):
@@ -41,6 +50,10 @@ limitations under the License.
 
 /* For public definitions of types: */
 #include "interrupt.h"
+#include "trace.h"
+#include "cpuload.h"
+#include "timer.h"
+#include "clocksource.h"
 
 
 
@@ -77,11 +90,6 @@ typedef struct _ARM926EJS_PIC_REGS
 } ARM926EJS_PIC_REGS;
 
 
-/* 
- * Register map of the SIC is provided, but it is commented out
- * until the SIC is actually supported.
- */
-#if 0
 /*
  * 32-bit Registers of the Secondary Interrupt Controller,
  * relative to the controller's base address:
@@ -114,7 +122,13 @@ typedef struct _ARM926EJS_SIC_REGS
 /* SIC_PICENSET (Set interrupt pass through bits) shares its address with SIC_PICENABLE. */
 #define SIC_PICENSET    SIC_PICENABLE
 
-#endif /* if 0 */
+/* SIC's interrupt sources that may be passed through to the PIC: */
+#define SIC_FIRST_PASS_THROUGH    21
+#define SIC_LAST_PASS_THROUGH     30
+
+
+/* Max. number of rescans of SIC_STATUS per cascaded IRQ: */
+#define SIC_MAX_ROUNDS            4
 
 
 #define UL1                    0x00000001
@@ -126,7 +140,7 @@ typedef struct _ARM926EJS_SIC_REGS
 
 
 static volatile ARM926EJS_PIC_REGS* const pPicReg = (ARM926EJS_PIC_REGS*) (BSP_PIC_BASE_ADDRESS);
-/* static volatile ARM926EJS_SIC_REGS* const pSicReg = (ARM926EJS_SIC_REGS*) (BSP_SIC_BASE_ADDRESS); */
+static volatile ARM926EJS_SIC_REGS* const pSicReg = (ARM926EJS_SIC_REGS*) (BSP_SIC_BASE_ADDRESS);
 
 
 /*
@@ -161,6 +175,61 @@ typedef struct _isrVectRecord
 static isrVectRecord __irqVect[NR_INTERRUPTS];
 
 
+/*
+ * A table with ISRs of the SIC's cascaded sources. Sources without
+ * an ISR (NULL) are disabled when they are triggered.
+ */
+typedef struct _isrSicRecord
+{
+    pNonVectoredIsrPrototype isr;    /* address of the ISR */
+    void* param;                     /* void* casted pointer to isr's paramter (if applicable) */
+} isrSicRecord;
+
+static isrSicRecord __isrSic[NR_INTERRUPTS];
+
+
+/*
+ * Rate limits of interrupt request lines, only applied to nonvectored
+ * IRQ handling. The window of a masked (throttled) line starts when
+ * it is masked.
+ */
+typedef struct _irqLimitRecord
+{
+    uint32_t maxEvents;              /* max. number of serviced requests within a window */
+    uint32_t windowUs;               /* length of the window in micro seconds */
+    uint32_t windowStart;            /* clocksource's time of the current window's start */
+    uint32_t count;                  /* requests within the current window */
+    int8_t throttled;                /* nonzero while the line is masked by the limit */
+    picIrqLimitStats stats;
+} irqLimitRecord;
+
+static irqLimitRecord __irqLimit[NR_INTERRUPTS];
+
+/* Bit mask of rate limited interrupt request lines: */
+static uint32_t __limitedIrqs = 0;
+
+/* The SP804 counter that re-enables throttled lines: */
+static int8_t __limitUseTimer = 0;
+static uint8_t __limitTimerNr;
+static uint8_t __limitCounterNr;
+
+
+/*
+ * The CPU's IRQ mode is switched by software interrupts (see exception.c).
+ * In the host (unit test) build, the simulated CPU is notified instead.
+ */
+#ifdef BSP_HOST_SIM
+extern void sim_cpu_swi(uint32_t nr);
+extern int8_t sim_isIrqModeEnabled(void);
+#define SWI(NR)         sim_cpu_swi(NR)
+#else
+#define SWI(NR)         __asm volatile("SWI #" #NR)
+#endif
+
+/* I bit of the CPSR, when set, IRQ requests are masked: */
+#define CPSR_I_BIT      0x00000080
+
+
 /*
  * IRQ handling mode:
  * - 0: nonvectored mode
@@ -178,6 +247,24 @@ static volatile int8_t __irq_vector_mode = 0;
  */
 void _pic_set_irq_vector_mode(int8_t mode)
 {
+    uint8_t i;
+
+    /* Rate limits are only applied to nonvectored IRQ handling, they are removed */
+    if ( 0 != mode && 0 != __limitUseTimer )
+    {
+        for ( i=0; i<NR_INTERRUPTS; ++i )
+        {
+            if ( 0 != (__limitedIrqs & (UL1 << i)) )
+            {
+                pic_setIrqRateLimit(i, 0, 0);
+            }
+        }
+
+        timer_stop(__limitTimerNr, __limitCounterNr);
+        timer_disableInterrupt(__limitTimerNr, __limitCounterNr);
+        timer_clearInterrupt(__limitTimerNr, __limitCounterNr);
+    }
+
     /* just set a variable to the requested mode */
     __irq_vector_mode = mode;
 }
@@ -200,7 +287,7 @@ void irq_enableIrqMode(void)
      * Any non zero immediate value appended to the SWI instruction will
      * enable the IRQ mode.
      */
-    __asm volatile("SWI #1");
+    SWI(1);
 }
 
 
@@ -221,7 +308,58 @@ void irq_disableIrqMode(void)
      * A zero immediate value appended to the SWI instruction will
      * disable the IRQ mode.
      */
-    __asm volatile("SWI #0");
+    SWI(0);
+}
+
+
+/**
+ * @return a nonzero value (typically 1) if the CPU's IRQ mode is enabled, 0 otherwise
+ */
+int8_t irq_isIrqModeEnabled(void)
+{
+#ifdef BSP_HOST_SIM
+    return ( 0 != sim_isIrqModeEnabled() ? 1 : 0 );
+#else
+    uint32_t cpsr;
+
+    /* Unlike its modification, reading of the CPSR is permitted in the User mode */
+    __asm volatile("MRS %0, cpsr" : "=r" (cpsr));
+
+    return ( 0 == (cpsr & CPSR_I_BIT) ? 1 : 0 );
+#endif
+}
+
+
+/**
+ * Disables the CPU's IRQ mode (if enabled), typically to protect data
+ * that are shared with ISRs.
+ *
+ * @return previous state of the IRQ mode, to be passed to irq_restoreIrqMode()
+ */
+int8_t irq_saveIrqMode(void)
+{
+    const int8_t irqMode = irq_isIrqModeEnabled();
+
+    if ( 0 != irqMode )
+    {
+        irq_disableIrqMode();
+    }
+
+    return irqMode;
+}
+
+
+/**
+ * Restores the CPU's IRQ mode, saved by irq_saveIrqMode().
+ *
+ * @param irqMode - state of the IRQ mode, returned by irq_saveIrqMode()
+ */
+void irq_restoreIrqMode(int8_t irqMode)
+{
+    if ( 0 != irqMode )
+    {
+        irq_enableIrqMode();
+    }
 }
 
 
@@ -298,6 +436,195 @@ static void __defaultVectorIsr(void)
 }
 
 
+/*
+ * Finds the IRQ, serviced by a vectored ISR. Only needed for tracing.
+ *
+ * @param isr - address of the ISR
+ *
+ * @return IRQ, serviced by 'isr' or TRACE_IRQ_UNKNOWN if not found (e.g. the default ISR)
+ */
+static uint16_t __vectIsrIrq(pVectoredIsrPrototype isr)
+{
+    uint8_t i;
+
+    for ( i=0; i<NR_VECTORS && __irqVect[i].irq>=0; ++i )
+    {
+        if ( isr == __irqVect[i].isr )
+        {
+            return __irqVect[i].irq;
+        }
+    }
+
+    return TRACE_IRQ_UNKNOWN;
+}
+
+
+/*
+ * ISR of the PIC's line, triggered by the SIC. Pending sources are
+ * dispatched in ascending order of their numbers. SIC_STATUS is read
+ * again after all of them have been serviced, so sources, triggered
+ * meanwhile (e.g. under a high load of keyboard and mouse input), are
+ * serviced without another exception, up to SIC_MAX_ROUNDS times.
+ *
+ * @param param - unused
+ */
+static void __sicCascadeIsr(void* param)
+{
+    uint32_t status;
+    uint8_t round;
+    uint8_t i;
+
+    for ( round=0; round<SIC_MAX_ROUNDS; ++round )
+    {
+        status = pSicReg->SIC_STATUS;
+        if ( 0 == status )
+        {
+            break;  /* out of for round */
+        }
+
+        for ( i=0; 0!=status && i<NR_INTERRUPTS; ++i )
+        {
+            if ( 0 == (status & (UL1 << i)) )
+            {
+                continue;
+            }
+
+            status &= ~(UL1 << i);
+
+            if ( NULL == __isrSic[i].isr )
+            {
+                /* Nobody would clear the source, disable it instead */
+                pSicReg->SIC_ENCLR = ( UL1 << i );
+                continue;
+            }
+
+            trace_event(TRACE_EV_IRQ_ENTRY, TRACE_IRQ_SIC(i));
+            ( *__isrSic[i].isr )( __isrSic[i].param );
+            trace_event(TRACE_EV_IRQ_EXIT, TRACE_IRQ_SIC(i));
+        }
+    }
+}
+
+
+/*
+ * Re-enables throttled lines whose windows have expired.
+ *
+ * @param now - current time of the clocksource
+ *
+ * @return micro seconds till the nearest expiration of a remaining window, 0 if none remains
+ */
+static uint32_t __releaseThrottled(uint32_t now)
+{
+    irqLimitRecord* l;
+    uint32_t next = 0;
+    uint32_t elapsed;
+    uint8_t i;
+
+    for ( i=0; i<NR_INTERRUPTS; ++i )
+    {
+        l = &__irqLimit[i];
+
+        if ( 0 == l->throttled )
+        {
+            continue;
+        }
+
+        /* The counter may expire a tick before the window's end (see __scheduleRelease()) */
+        elapsed = clocksource_ticksToUs(now - l->windowStart);
+        if ( elapsed + 1 >= l->windowUs )
+        {
+            l->throttled = 0;
+            l->windowStart = now;
+            l->count = 0;
+            pic_enableInterrupt(i);
+            continue;
+        }
+
+        if ( 0 == next || l->windowUs - elapsed < next )
+        {
+            next = l->windowUs - elapsed;
+        }
+    }
+
+    return next;
+}
+
+
+/*
+ * Starts the rate limit's counter to expire in 'us' micro seconds,
+ * or stops it if 'us' equals 0.
+ *
+ * Like any other period, 'us' is loaded as 'us - 1' (see timer_setLoad()). As
+ * the first expiration after a (re)start does not include the reload's tick,
+ * it may come a tick earlier.
+ *
+ * @param us - micro seconds till the nearest expiration of a window
+ */
+static void __scheduleRelease(uint32_t us)
+{
+    if ( 0 == us )
+    {
+        timer_stop(__limitTimerNr, __limitCounterNr);
+        timer_disableInterrupt(__limitTimerNr, __limitCounterNr);
+        timer_clearInterrupt(__limitTimerNr, __limitCounterNr);
+        return;
+    }
+
+    timer_setLoad(__limitTimerNr, __limitCounterNr, ( us > 1 ? us - 1 : 1 ));
+    timer_enableInterrupt(__limitTimerNr, __limitCounterNr);
+    timer_start(__limitTimerNr, __limitCounterNr);
+}
+
+
+/*
+ * Callback of the rate limit counter's expiration, re-enables throttled
+ * lines whose windows have expired.
+ *
+ * @param param - unused
+ */
+static void __limitTimerIsr(void* param)
+{
+    __scheduleRelease(__releaseThrottled(clocksource_read()));
+}
+
+
+/*
+ * Accounts a request of a rate limited line. If the line exceeds its
+ * rate, it is masked until its window expires.
+ *
+ * @param irq - interrupt request line (must be smaller than 32)
+ *
+ * @return 1 if the request may be serviced, 0 if it is deferred
+ */
+static int8_t __admitIrq(uint8_t irq)
+{
+    irqLimitRecord* const l = &__irqLimit[irq];
+    const uint32_t now = clocksource_read();
+
+    if ( clocksource_ticksToUs(now - l->windowStart) >= l->windowUs )
+    {
+        l->windowStart = now;
+        l->count = 0;
+    }
+
+    if ( ++l->count <= l->maxEvents )
+    {
+        ++l->stats.serviced;
+        return 1;
+    }
+
+    /* The line remains masked until its window (starting now) expires */
+    pic_disableInterrupt(irq);
+    l->throttled = 1;
+    l->windowStart = now;
+    ++l->stats.throttled;
+
+    __scheduleRelease(__releaseThrottled(now));
+
+    return 0;
+}
+
+
 /*
  * IRQ handler routine, called directly from the IRQ vector, implemented in exception.c
  * Prototype of this function is not public and should not be exposed in a .h file. Instead,
@@ -313,6 +640,8 @@ static void __defaultVectorIsr(void)
  */
 void _pic_IrqHandler(void)
 {
+    cpuload_irqEnter();
+
     if ( !__irq_vector_mode )
     {
         /*
@@ -337,12 +666,15 @@ void _pic_IrqHandler(void)
             }
             
 
-            if ( pPicReg->VICIRQSTATUS & (UL1<<__isrNV[i].irq) )
+            if ( (pPicReg->VICIRQSTATUS & (UL1<<__isrNV[i].irq)) &&
+                 ( 0 == (__limitedIrqs & (UL1<<__isrNV[i].irq)) || 0 != __admitIrq(__isrNV[i].irq) ) )
             {
 	        /*
                  * The irq'th bit is set, call its service routine:
                  */ 
+                trace_event(TRACE_EV_IRQ_ENTRY, __isrNV[i].irq);
                 ( *__isrNV[i].isr )( __isrNV[i].param );
+                trace_event(TRACE_EV_IRQ_EXIT, __isrNV[i].irq);
             }
         }  /* for i */
         
@@ -361,6 +693,7 @@ void _pic_IrqHandler(void)
          */
 
         pVectoredIsrPrototype isrAddr;
+        uint16_t irq = TRACE_IRQ_UNKNOWN;
         
         /* 
          * Reads the Vector Address Register with the ISR address of the currently active interrupt.
@@ -369,8 +702,16 @@ void _pic_IrqHandler(void)
          */
         isrAddr = (pVectoredIsrPrototype) pPicReg->VICVECTADDR;
 	
+        /* The IRQ is only looked up if it is actually traced */
+        if ( trace_isEnabled() )
+        {
+            irq = __vectIsrIrq(isrAddr);
+        }
+
         /* Execute the routine at the vector address */
+        trace_event(TRACE_EV_IRQ_ENTRY, irq);
         (*isrAddr)();
+        trace_event(TRACE_EV_IRQ_EXIT, irq);
         
         /* 
          * Writes an arbitrary value to the Vector Address Register. This indicates to the
@@ -378,6 +719,8 @@ void _pic_IrqHandler(void)
          */
         pPicReg->VICVECTADDR = 0xFFFFFFFF;
     } /* else */
+
+    cpuload_irqExit();
 }
 
 
@@ -411,7 +754,7 @@ int8_t pic_registerNonVectoredIrq(
                                  void* param,
                                  uint8_t priority )
 {
-    const uint8_t prior = priority & 0x7F;
+    const uint8_t prior = ( priority > 0x7F ? 0x7F : priority );
     int8_t irqPos = -1;
     int8_t prPos = -1;
     int8_t i;
@@ -583,6 +926,26 @@ void pic_init(void)
         __isrNV[i].priority = -1;            /* lowest priority */
     }
     
+    /* clear all ISRs of the SIC's cascaded sources and disable them: */
+    for ( i=0; i<NR_INTERRUPTS; ++i )
+    {
+        __isrSic[i].isr = NULL;
+        __isrSic[i].param = NULL;
+    }
+
+    pSicReg->SIC_ENCLR = 0xFFFFFFFF;
+    pSicReg->SIC_SOFTINTCLR = 0xFFFFFFFF;
+
+    /* remove all rate limits, the counter's ISR has been unregistered as well */
+    for ( i=0; i<NR_INTERRUPTS; ++i )
+    {
+        __irqLimit[i].maxEvents = 0;
+        __irqLimit[i].throttled = 0;
+    }
+
+    __limitedIrqs = 0;
+    __limitUseTimer = 0;
+
     /* set IRQ handling to non vectored mode */
     __irq_vector_mode = 0;
 }
@@ -620,6 +983,9 @@ void pic_disableInterrupt(uint8_t irq)
 {
     if ( irq < NR_INTERRUPTS )
     {
+        /* The line will not be re-enabled by its rate limit */
+        __irqLimit[irq].throttled = 0;
+
         /* 
          * VICINTENCLEAR is a write only register and any attempt of reading it
          * will result in a crash. For that reason, operators as |=, &=, etc.
@@ -635,16 +1001,218 @@ void pic_disableInterrupt(uint8_t irq)
 }
 
 
+/**
+ * Enables the SIC's pass-through of the specified interrupt source, i.e.
+ * the source directly triggers the PIC's interrupt request line with
+ * the same number. The line must still be enabled by pic_enableInterrupt().
+ *
+ * Nothing is done if 'irq' is not between 21 and 30 (only these
+ * sources of the SIC may be passed through).
+ *
+ * @param irq - interrupt number (between 21 and 30)
+ */
+void pic_enableSicPassThrough(uint8_t irq)
+{
+    if ( irq >= SIC_FIRST_PASS_THROUGH && irq <= SIC_LAST_PASS_THROUGH )
+    {
+        /* See description of SIC_PICENSET, page 4-50 of DUI0225D: */
+        pSicReg->SIC_PICENSET = ( UL1 << irq );
+    }
+}
+
+
+/**
+ * Disables the SIC's pass-through of the specified interrupt source.
+ *
+ * Nothing is done if 'irq' is not between 21 and 30.
+ *
+ * @param irq - interrupt number (between 21 and 30)
+ */
+void pic_disableSicPassThrough(uint8_t irq)
+{
+    if ( irq >= SIC_FIRST_PASS_THROUGH && irq <= SIC_LAST_PASS_THROUGH )
+    {
+        /* SIC_PICENCLR is write only, only 1-bits have any effect */
+        pSicReg->SIC_PICENCLR = ( UL1 << irq );
+    }
+}
+
+
+/**
+ * Registers the cascade of the SIC, i.e. a nonvectored ISR of the PIC's
+ * interrupt request line BSP_SIC_IRQ, that dispatches all pending sources
+ * of the SIC to their ISRs (see pic_registerSicIrq()), and enables the line.
+ *
+ * @note Cascaded sources are only serviced in nonvectored mode.
+ *
+ * @param priority - priority of the cascade among nonvectored IRQs (see pic_registerNonVectoredIrq())
+ *
+ * @return position of the cascade's entry within the internal table, a negative value if registration was unsuccessful
+ */
+int8_t pic_enableSicCascade(uint8_t priority)
+{
+    const int8_t pos = pic_registerNonVectoredIrq(BSP_SIC_IRQ, &__sicCascadeIsr, NULL, priority);
+
+    if ( pos >= 0 )
+    {
+        pic_enableInterrupt(BSP_SIC_IRQ);
+    }
+
+    return pos;
+}
+
+
+/**
+ * Disables the PIC's interrupt request line BSP_SIC_IRQ and unregisters
+ * its ISR. ISRs of the SIC's sources remain registered.
+ */
+void pic_disableSicCascade(void)
+{
+    pic_disableInterrupt(BSP_SIC_IRQ);
+    pic_unregisterNonVectoredIrq(BSP_SIC_IRQ);
+}
+
+
+/**
+ * Registers an ISR of the SIC's interrupt source. It is called by the
+ * cascade (see pic_enableSicCascade()) when the source is pending and
+ * enabled by pic_enableSicInterrupt().
+ *
+ * If 'irq' has already been registered, its ISR is replaced.
+ *
+ * @note IRQ handling should be completely disabled prior to calling this function!
+ *
+ * @param irq - SIC's interrupt source (must be smaller than 32)
+ * @param addr - address of the ISR that services the source
+ * @param param - void* casted pointer to function's parameter(s) (may be NULL if not applicable)
+ *
+ * @return 'irq' on success, a negative value (typically -1) if either 'irq' or 'addr' is invalid
+ */
+int8_t pic_registerSicIrq(uint8_t irq, pNonVectoredIsrPrototype addr, void* param)
+{
+    if ( irq>=NR_INTERRUPTS || NULL==addr )
+    {
+        return -1;
+    }
+
+    __isrSic[irq].isr = addr;
+    __isrSic[irq].param = param;
+
+    return irq;
+}
+
+
+/**
+ * Disables the SIC's interrupt source and unregisters its ISR.
+ *
+ * Nothing is done if 'irq' is invalid (equal or greater than 32).
+ *
+ * @param irq - SIC's interrupt source (must be smaller than 32)
+ */
+void pic_unregisterSicIrq(uint8_t irq)
+{
+    if ( irq < NR_INTERRUPTS )
+    {
+        pic_disableSicInterrupt(irq);
+        __isrSic[irq].isr = NULL;
+        __isrSic[irq].param = NULL;
+    }
+}
+
+
+/**
+ * Enables the SIC's interrupt source, i.e. the source triggers the
+ * PIC's interrupt request line BSP_SIC_IRQ.
+ *
+ * Nothing is done if 'irq' is invalid (equal or greater than 32).
+ *
+ * @param irq - SIC's interrupt source (must be smaller than 32)
+ */
+void pic_enableSicInterrupt(uint8_t irq)
+{
+    if ( irq < NR_INTERRUPTS )
+    {
+        /* SIC_ENSET reads the current mask, see page 4-49 of DUI0225D: */
+        pSicReg->SIC_ENSET |= ( UL1 << irq );
+    }
+}
+
+
+/**
+ * Disables the SIC's interrupt source.
+ *
+ * Nothing is done if 'irq' is invalid (equal or greater than 32).
+ *
+ * @param irq - SIC's interrupt source (must be smaller than 32)
+ */
+void pic_disableSicInterrupt(uint8_t irq)
+{
+    if ( irq < NR_INTERRUPTS )
+    {
+        /* SIC_ENCLR is write only, only 1-bits have any effect */
+        pSicReg->SIC_ENCLR = ( UL1 << irq );
+    }
+}
+
+
+/**
+ * Triggers the SIC's interrupt source via software.
+ *
+ * @param irq - SIC's interrupt source (must be smaller than 32)
+ *
+ * @return 'irq' if the interrupt has been triggered, a negative value (typically -1) otherwise
+ */
+int8_t pic_setSicSwInterrupt(uint8_t irq)
+{
+    if ( irq >= NR_INTERRUPTS )
+    {
+        return -1;
+    }
+
+    /* SIC_SOFTINTSET reads the current software interrupts, see page 4-50 of DUI0225D */
+    pSicReg->SIC_SOFTINTSET |= ( UL1 << irq );
+
+    return irq;
+}
+
+
+/**
+ * Clears the SIC's software triggered interrupt source.
+ *
+ * @param irq - SIC's interrupt source (must be smaller than 32)
+ *
+ * @return 'irq' if the interrupt has been cleared, a negative value (typically -1) otherwise
+ */
+int8_t pic_clearSicSwInterrupt(uint8_t irq)
+{
+    if ( irq >= NR_INTERRUPTS )
+    {
+        return -1;
+    }
+
+    pSicReg->SIC_SOFTINTCLR = ( UL1 << irq );
+
+    return irq;
+}
+
+
 /**
  * Disable all interrupt request lines of the PIC.
  */
 void pic_disableAllInterrupts(void)
 {
+    uint8_t i;
+
     /* 
      * See description of VICINTENCLEAR, page 3-7 of DDI0181.
      * All 32 bits of this register are set to 1.     
      */
     pPicReg->VICINTENCLEAR = 0xFFFFFFFF;
+
+    for ( i=0; i<NR_INTERRUPTS; ++i )
+    {
+        __irqLimit[i].throttled = 0;
+    }
 }
 
 
@@ -766,7 +1334,7 @@ int8_t pic_registerVectorIrq(
                               pVectoredIsrPrototype addr,
                               uint8_t priority )
 {
-    const prior = priority & 0x7F;
+    const int8_t prior = ( priority > 0x7F ? 0x7F : priority );
     int8_t irqPos = -1;
     int8_t prPos = -1;
     int8_t i;
@@ -1026,7 +1594,7 @@ void pic_unregisterAllVectorIrqs(void)
     uint8_t i;
     
     /* Clear all entries in the priority table */
-    for ( i=0; i<NR_VECTORS; ++i )
+    for ( i=0; i<NR_INTERRUPTS; ++i )
     {
         __irqVect[i].irq = -1;
         __irqVect[i].isr = &__irq_dummyISR;
@@ -1160,3 +1728,152 @@ int8_t pic_clearSoftwareInterrupt(void)
 {
     return pic_clearSwInterruptNr(BSP_SOFTWARE_IRQ);
 }
+
+
+/**
+ * Assigns a SP804 counter that re-enables rate limited lines after
+ * their windows (see pic_setIrqRateLimit()). The counter only runs
+ * while any line is masked by its limit.
+ *
+ * @note pic_init() removes the counter's assignment.
+ *
+ * @param timerNr - number of the timer
+ * @param counterNr - number of the timer's counter
+ * @param priority - priority of the timer's IRQ (see timer_registerCallback())
+ *
+ * @return 0 on success, a negative value (typically -1) if any parameter is invalid or any line is rate limited
+ */
+int8_t pic_useRateLimitTimer(uint8_t timerNr, uint8_t counterNr, uint8_t priority)
+{
+    if ( timerNr >= BSP_NR_TIMERS || counterNr >= timer_countersPerTimer() || 0 != __limitedIrqs )
+    {
+        return -1;
+    }
+
+    __limitUseTimer = 0;
+    __limitTimerNr = timerNr;
+    __limitCounterNr = counterNr;
+
+    timer_init(timerNr, counterNr);
+    clocksource_init();
+
+    if ( timer_registerCallback(timerNr, counterNr, &__limitTimerIsr, NULL, priority) < 0 )
+    {
+        return -1;
+    }
+
+    __limitUseTimer = 1;
+
+    return 0;
+}
+
+
+/**
+ * Limits the rate of a nonvectored interrupt request line. If more than
+ * 'maxEvents' requests occur within 'windowUs' micro seconds, the line is
+ * masked (see pic_disableInterrupt()) and re-enabled after 'windowUs' micro
+ * seconds. If the peripheral still requests an interrupt, its ISR is called
+ * once, i.e. requests, raised meanwhile, are coalesced.
+ *
+ * If 'maxEvents' equals 0, the limit is removed and the line is re-enabled
+ * if it is currently masked by the limit.
+ *
+ * @note Limits are only applied to nonvectored IRQ handling. They cannot be
+ * set in the vectored mode and switching to the vectored mode removes them.
+ * @note A counter must be assigned by pic_useRateLimitTimer() first.
+ * @note The line's statistics are reset.
+ * @note IRQ handling should be disabled prior to calling this function!
+ *
+ * @param irq - interrupt number (must be smaller than 32)
+ * @param maxEvents - max. number of serviced requests within a window, 0 removes the limit
+ * @param windowUs - length of the window in micro seconds
+ *
+ * @return 0 on success, a negative value (typically -1) if any parameter is invalid, no counter is assigned or the vectored mode is on
+ */
+int8_t pic_setIrqRateLimit(uint8_t irq, uint32_t maxEvents, uint32_t windowUs)
+{
+    irqLimitRecord* l;
+    int8_t throttled;
+
+    if ( irq >= NR_INTERRUPTS || 0 == __limitUseTimer ||
+         ( 0 != maxEvents && ( 0 == windowUs || 0 != __irq_vector_mode ) ) )
+    {
+        return -1;
+    }
+
+    l = &__irqLimit[irq];
+    throttled = l->throttled;
+
+    l->throttled = 0;
+    l->maxEvents = maxEvents;
+    l->windowUs = windowUs;
+    l->windowStart = clocksource_read();
+    l->count = 0;
+    pic_resetIrqLimitStats(irq);
+
+    if ( 0 != maxEvents )
+    {
+        __limitedIrqs |= ( UL1 << irq );
+    }
+    else
+    {
+        __limitedIrqs &= ~( UL1 << irq );
+    }
+
+    /* A throttled line is released, the counter stops at its next expiration if no line remains throttled */
+    if ( 0 != throttled )
+    {
+        pic_enableInterrupt(irq);
+    }
+
+    return 0;
+}
+
+
+/**
+ * @param irq - interrupt number (must be smaller than 32)
+ *
+ * @return 1 if the line is currently masked by its rate limit, 0 otherwise
+ */
+int8_t pic_isIrqThrottled(uint8_t irq)
+{
+    return ( irq < NR_INTERRUPTS && 0 != __irqLimit[irq].throttled ? 1 : 0 );
+}
+
+
+/**
+ * Copies statistics of a rate limited interrupt request line.
+ *
+ * @param irq - interrupt number (must be smaller than 32)
+ * @param stats - the statistics are copied here
+ *
+ * @return 0 on success, a negative value (typically -1) if 'irq' is invalid or 'stats' is NULL
+ */
+int8_t pic_getIrqLimitStats(uint8_t irq, picIrqLimitStats* stats)
+{
+    if ( irq >= NR_INTERRUPTS || NULL == stats )
+    {
+        return -1;
+    }
+
+    *stats = __irqLimit[irq].stats;
+
+    return 0;
+}
+
+
+/**
+ * Resets statistics of a rate limited interrupt request line.
+ *
+ * Nothing is done if 'irq' is invalid (equal or greater than 32).
+ *
+ * @param irq - interrupt number (must be smaller than 32)
+ */
+void pic_resetIrqLimitStats(uint8_t irq)
+{
+    if ( irq < NR_INTERRUPTS )
+    {
+        __irqLimit[irq].stats.serviced = 0;
+        __irqLimit[irq].stats.throttled = 0;
+    }
+}
@@ -43,10 +43,27 @@ typedef void (*pVectoredIsrPrototype)(void);
 typedef void (*pNonVectoredIsrPrototype)(void* param);
 
 
+/**
+ * Statistics of a rate limited interrupt request line (see pic_setIrqRateLimit()),
+ * all counters start at 0 when the limit is set or the statistics are reset.
+ */
+typedef struct _picIrqLimitStats
+{
+    uint32_t serviced;            /* requests, passed to the line's ISR */
+    uint32_t throttled;           /* times the line was masked for exceeding its limit */
+} picIrqLimitStats;
+
+
 void irq_enableIrqMode(void);
 
 void irq_disableIrqMode(void);
 
+int8_t irq_isIrqModeEnabled(void);
+
+int8_t irq_saveIrqMode(void);
+
+void irq_restoreIrqMode(int8_t irqMode);
+
 int8_t pic_registerNonVectoredIrq( 
                                  uint8_t irq, 
                                  pNonVectoredIsrPrototype addr, 
@@ -63,6 +80,26 @@ void pic_disableInterrupt(uint8_t irq);
 
 void pic_disableAllInterrupts(void);
 
+void pic_enableSicPassThrough(uint8_t irq);
+
+void pic_disableSicPassThrough(uint8_t irq);
+
+int8_t pic_enableSicCascade(uint8_t priority);
+
+void pic_disableSicCascade(void);
+
+int8_t pic_registerSicIrq(uint8_t irq, pNonVectoredIsrPrototype addr, void* param);
+
+void pic_unregisterSicIrq(uint8_t irq);
+
+void pic_enableSicInterrupt(uint8_t irq);
+
+void pic_disableSicInterrupt(uint8_t irq);
+
+int8_t pic_setSicSwInterrupt(uint8_t irq);
+
+int8_t pic_clearSicSwInterrupt(uint8_t irq);
+
 int8_t pic_isInterruptEnabled(uint8_t irq);
 
 int8_t pic_getInterruptType(uint8_t irq);
@@ -94,6 +131,16 @@ int8_t pic_setSoftwareInterrupt(void);
 
 int8_t pic_clearSoftwareInterrupt(void);
 
+int8_t pic_useRateLimitTimer(uint8_t timerNr, uint8_t counterNr, uint8_t priority);
+
+int8_t pic_setIrqRateLimit(uint8_t irq, uint32_t maxEvents, uint32_t windowUs);
+
+int8_t pic_isIrqThrottled(uint8_t irq);
+
+int8_t pic_getIrqLimitStats(uint8_t irq, picIrqLimitStats* stats);
+
+void pic_resetIrqLimitStats(uint8_t irq);
+
 
 #endif  /* _INTERRUPT_H_ */
  
\ No newline at end of file
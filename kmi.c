@@ -0,0 +1,602 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the PL050 keyboard/mouse interface (KMI) driver.
+ *
+ * The receive interrupt of each KMI is a source of the SIC, dispatched by
+ * its cascade (see pic_enableSicCascade()). The ISR moves all received
+ * bytes into a ring buffer. The ring is indexed by free running counters:
+ * the head is only modified by the ISR and the tail only by readers, so
+ * no locking is necessary.
+ *
+ * Key events are translated from scancode set 2. The translation state
+ * (pending prefixes and modifiers) is kept per KMI, so partially received
+ * sequences are completed by subsequent calls of kmi_getKey().
+ *
+ * More info about the controller and the keyboard:
+ * - ARM PrimeCell PS2 Keyboard/Mouse Interface (PL050) Technical Reference Manual (DDI0143):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.ddi0143c/DDI0143.pdf
+ * - Versatile Application Baseboard for ARM926EJ-S, HBI 0118 (DUI0225D):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.dui0225d/DUI0225D_versatile_application_baseboard_arm926ej_s_ug.pdf
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "kmi.h"
+#include "interrupt.h"
+
+
+#if ( 0 != (KMI_RX_BUF_SIZE & (KMI_RX_BUF_SIZE - 1)) )
+#error KMI_RX_BUF_SIZE must be a power of 2
+#endif
+
+
+/*
+ * Accesses of the data register: a read pops the received byte, a write
+ * starts its transmission.
+ *
+ * In the host (unit test) build, reads and writes of plain memory have no
+ * side effects, so the simulated controller is notified instead.
+ */
+#ifdef BSP_HOST_SIM
+extern uint32_t sim_kmiRead(uint8_t nr);
+extern void sim_kmiWrite(uint8_t nr, uint32_t val);
+#define DATA_READ(NR)         sim_kmiRead(NR)
+#define DATA_WRITE(NR, VAL)   sim_kmiWrite((NR), (VAL))
+#else
+#define DATA_READ(NR)         ( pReg[(NR)]->KMIDATA )
+#define DATA_WRITE(NR, VAL)   ( pReg[(NR)]->KMIDATA = (VAL) )
+#endif
+
+
+/*
+ * 32-bit registers of the PL050, relative to the controller's base address.
+ * See page 3-3 of DDI0143.
+ */
+typedef struct _ARM926EJS_KMI_REGS
+{
+    uint32_t KMICR;                    /* Control Register */
+    const uint32_t KMISTAT;            /* Status Register, read only */
+    uint32_t KMIDATA;                  /* Received data (read), data to be transmitted (write) */
+    uint32_t KMICLKDIV;                /* Clock Divisor Register */
+    const uint32_t KMIIR;              /* Interrupt Identification Register, read only */
+} ARM926EJS_KMI_REGS;
+
+
+/*
+ * Bit masks of the Control Register (KMICR), see page 3-4 of DDI0143:
+ *
+ *   5: KmiType (0: PS2/AT mode)
+ *   4: KMIRXINTREn (receiver interrupt enable)
+ *   3: KMITXINTREn (transmitter interrupt enable)
+ *   2: KmiEn (enable)
+ *   1: FKMID (force the data line low)
+ *   0: FKMIC (force the clock line low)
+ */
+#define CR_RXINTREN          0x00000010
+#define CR_EN                0x00000004
+
+/*
+ * Bit masks of the Status Register (KMISTAT), see page 3-5 of DDI0143:
+ *
+ *   6: TXEMPTY
+ *   5: TXBUSY
+ *   4: RXFULL
+ *   3: RXBUSY
+ *   2: RXPARITY (parity of the last received byte)
+ */
+#define STAT_TXEMPTY         0x00000040
+#define STAT_RXFULL          0x00000010
+
+/*
+ * KMIREFCLK of the Versatile baseboard is 24 MHz, the internal
+ * clock must be 8 MHz: KMICLKDIV = 24 MHz / 8 MHz - 1
+ */
+#define CLKDIV_8MHZ          2
+
+/* Max. number of Status Register polls, waiting for an empty transmitter: */
+#define TX_POLLS             100000
+
+
+/* Scancode set 2 prefixes and device responses: */
+#define SC_EXTENDED          0xE0
+#define SC_PAUSE             0xE1
+#define SC_BREAK             0xF0
+#define SC_ACK               0xFA
+#define SC_BAT_OK            0xAA
+#define SC_ECHO              0xEE
+#define SC_RESEND            0xFE
+#define SC_ERROR0            0x00
+#define SC_ERROR1            0xFF
+
+/* Scancodes of modifiers: */
+#define SC_LSHIFT            0x12
+#define SC_RSHIFT            0x59
+#define SC_CTRL              0x14      /* left, right if extended */
+#define SC_ALT               0x11      /* left, right if extended */
+#define SC_CAPS              0x58
+#define SC_KP_ENTER          0x5A      /* extended */
+#define SC_KP_SLASH          0x4A      /* extended */
+
+/* Remaining bytes of the Pause key's sequence (E1 14 77 E1 F0 14 F0 77): */
+#define PAUSE_TAIL           7
+
+/* Number of entries of translation tables: */
+#define NR_SCANCODES         0x80
+
+
+/* Characters of scancodes (set 2), without and with Shift: */
+static const char __scLower[NR_SCANCODES] =
+{
+    [0x0D] = '\t', [0x0E] = '`',  [0x15] = 'q',  [0x16] = '1',  [0x1A] = 'z',  [0x1B] = 's',
+    [0x1C] = 'a',  [0x1D] = 'w',  [0x1E] = '2',  [0x21] = 'c',  [0x22] = 'x',  [0x23] = 'd',
+    [0x24] = 'e',  [0x25] = '4',  [0x26] = '3',  [0x29] = ' ',  [0x2A] = 'v',  [0x2B] = 'f',
+    [0x2C] = 't',  [0x2D] = 'r',  [0x2E] = '5',  [0x31] = 'n',  [0x32] = 'b',  [0x33] = 'h',
+    [0x34] = 'g',  [0x35] = 'y',  [0x36] = '6',  [0x3A] = 'm',  [0x3B] = 'j',  [0x3C] = 'u',
+    [0x3D] = '7',  [0x3E] = '8',  [0x41] = ',',  [0x42] = 'k',  [0x43] = 'i',  [0x44] = 'o',
+    [0x45] = '0',  [0x46] = '9',  [0x49] = '.',  [0x4A] = '/',  [0x4B] = 'l',  [0x4C] = ';',
+    [0x4D] = 'p',  [0x4E] = '-',  [0x52] = '\'', [0x54] = '[',  [0x55] = '=',  [0x5A] = '\r',
+    [0x5B] = ']',  [0x5D] = '\\', [0x66] = '\b', [0x76] = 0x1B
+};
+
+static const char __scUpper[NR_SCANCODES] =
+{
+    [0x0D] = '\t', [0x0E] = '~',  [0x15] = 'Q',  [0x16] = '!',  [0x1A] = 'Z',  [0x1B] = 'S',
+    [0x1C] = 'A',  [0x1D] = 'W',  [0x1E] = '@',  [0x21] = 'C',  [0x22] = 'X',  [0x23] = 'D',
+    [0x24] = 'E',  [0x25] = '$',  [0x26] = '#',  [0x29] = ' ',  [0x2A] = 'V',  [0x2B] = 'F',
+    [0x2C] = 'T',  [0x2D] = 'R',  [0x2E] = '%',  [0x31] = 'N',  [0x32] = 'B',  [0x33] = 'H',
+    [0x34] = 'G',  [0x35] = 'Y',  [0x36] = '^',  [0x3A] = 'M',  [0x3B] = 'J',  [0x3C] = 'U',
+    [0x3D] = '&',  [0x3E] = '*',  [0x41] = '<',  [0x42] = 'K',  [0x43] = 'I',  [0x44] = 'O',
+    [0x45] = ')',  [0x46] = '(',  [0x49] = '>',  [0x4A] = '?',  [0x4B] = 'L',  [0x4C] = ':',
+    [0x4D] = 'P',  [0x4E] = '_',  [0x52] = '"',  [0x54] = '{',  [0x55] = '+',  [0x5A] = '\r',
+    [0x5B] = '}',  [0x5D] = '|',  [0x66] = '\b', [0x76] = 0x1B
+};
+
+
+/*
+ * State of a KMI: its receive buffer, statistics and
+ * the state of the scancode translation.
+ */
+typedef struct _kmiState
+{
+    uint8_t buf[KMI_RX_BUF_SIZE];
+    volatile uint32_t head;            /* number of bytes, written by the ISR */
+    volatile uint32_t tail;            /* number of bytes, read by the application */
+    kmiStats stats;
+    uint8_t nr;
+    uint8_t initialized;
+    uint8_t prefix;                    /* KMI_KEY_* flags of pending prefixes */
+    uint8_t modifiers;                 /* KMI_MOD_* */
+    uint8_t skip;                      /* remaining bytes of the Pause sequence */
+    uint8_t shiftKeys;                 /* pressed shift keys (1: left, 2: right) */
+    uint8_t ctrlKeys;                  /* pressed Ctrl keys (1: left, 2: right) */
+    uint8_t altKeys;                   /* pressed Alt keys (1: left, 2: right) */
+} kmiState;
+
+static kmiState __kmi[BSP_NR_KMIS];
+
+static const uint8_t __sicIrqs[BSP_NR_KMIS] = BSP_KMI_SIC_IRQS;
+
+
+#define GEN_CAST_ADDR(ADDR)    (ARM926EJS_KMI_REGS*) (ADDR),
+
+static volatile ARM926EJS_KMI_REGS* const  pReg[BSP_NR_KMIS]=
+                         {
+                             BSP_KMI_BASE_ADDRESSES(GEN_CAST_ADDR)
+                         };
+
+#undef GEN_CAST_ADDR
+
+
+/*
+ * ISR of a KMI, moves all received bytes into its ring buffer.
+ * Bytes that do not fit into the buffer are discarded.
+ *
+ * The parity of received bytes is not checked (the RXPARITY flag
+ * of Qemu's model refers to the previously read byte).
+ *
+ * @param param - pointer to the KMI's state
+ */
+static void __kmiIsr(void* param)
+{
+    kmiState* const k = (kmiState*) param;
+    uint32_t level;
+    uint8_t b;
+
+    ++k->stats.irqs;
+
+    while ( pReg[k->nr]->KMISTAT & STAT_RXFULL )
+    {
+        b = (uint8_t) DATA_READ(k->nr);
+        ++k->stats.bytes;
+
+        level = k->head - k->tail;
+        if ( level >= KMI_RX_BUF_SIZE )
+        {
+            ++k->stats.overruns;
+            continue;
+        }
+
+        k->buf[k->head & (KMI_RX_BUF_SIZE - 1)] = b;
+        ++k->head;
+
+        k->stats.maxLevel = ( level + 1 > k->stats.maxLevel ? level + 1 : k->stats.maxLevel );
+    }
+}
+
+
+/**
+ * Initializes a KMI: its clock is set, the controller and its receive
+ * interrupt are enabled, its ISR is registered as a cascaded source of
+ * the SIC, and the SIC's cascade is enabled (see pic_enableSicCascade()).
+ * The receive buffer, statistics and the translation state are cleared.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param nr - number of the KMI (0: keyboard, 1: mouse)
+ * @param priority - priority of the SIC's cascade (see pic_registerNonVectoredIrq())
+ *
+ * @return KMI_OK on success, KMI_ERR_PARAM if 'nr' is invalid or the ISR could not be registered
+ */
+int8_t kmi_init(uint8_t nr, uint8_t priority)
+{
+    kmiState* k;
+
+    if ( nr >= BSP_NR_KMIS )
+    {
+        return KMI_ERR_PARAM;
+    }
+
+    k = &__kmi[nr];
+
+    pReg[nr]->KMICR = 0;
+    pReg[nr]->KMICLKDIV = CLKDIV_8MHZ;
+
+    k->head = 0;
+    k->tail = 0;
+    k->nr = nr;
+    k->prefix = 0;
+    k->modifiers = 0;
+    k->skip = 0;
+    k->shiftKeys = 0;
+    k->ctrlKeys = 0;
+    k->altKeys = 0;
+    kmi_resetStats(nr);
+
+    if ( pic_registerSicIrq(__sicIrqs[nr], &__kmiIsr, (void*) k) < 0 ||
+         pic_enableSicCascade(priority) < 0 )
+    {
+        k->initialized = 0;
+        return KMI_ERR_PARAM;
+    }
+
+    pic_enableSicInterrupt(__sicIrqs[nr]);
+    k->initialized = 1;
+
+    pReg[nr]->KMICR = CR_EN | CR_RXINTREN;
+
+    return KMI_OK;
+}
+
+
+/**
+ * Disables a KMI and its interrupt source. Unread bytes are discarded.
+ *
+ * Nothing is done if 'nr' is invalid.
+ *
+ * @param nr - number of the KMI
+ */
+void kmi_disable(uint8_t nr)
+{
+    if ( nr >= BSP_NR_KMIS )
+    {
+        return;
+    }
+
+    pReg[nr]->KMICR = 0;
+    pic_unregisterSicIrq(__sicIrqs[nr]);
+
+    __kmi[nr].initialized = 0;
+    __kmi[nr].tail = __kmi[nr].head;
+}
+
+
+/**
+ * @param nr - number of the KMI
+ *
+ * @return number of received bytes, not read yet (0 if 'nr' is invalid)
+ */
+uint32_t kmi_available(uint8_t nr)
+{
+    return ( nr < BSP_NR_KMIS ? __kmi[nr].head - __kmi[nr].tail : 0 );
+}
+
+
+/**
+ * Reads the oldest received byte.
+ *
+ * @param nr - number of the KMI
+ *
+ * @return the byte, a negative value if no byte is available or 'nr' is invalid
+ */
+int16_t kmi_readByte(uint8_t nr)
+{
+    kmiState* k;
+    uint8_t b;
+
+    if ( nr >= BSP_NR_KMIS || __kmi[nr].head == __kmi[nr].tail )
+    {
+        return -1;
+    }
+
+    k = &__kmi[nr];
+    b = k->buf[k->tail & (KMI_RX_BUF_SIZE - 1)];
+    ++k->tail;
+
+    return b;
+}
+
+
+/**
+ * Sends a byte (e.g. a command) to the device. Its response (typically an
+ * acknowledge, 0xFA) is received into the buffer as any other byte.
+ *
+ * @param nr - number of the KMI
+ * @param byte - the byte to be sent
+ *
+ * @return KMI_OK on success, KMI_ERR_NOINIT if the KMI is not initialized, KMI_ERR_TIMEOUT if the transmitter is busy
+ */
+int8_t kmi_write(uint8_t nr, uint8_t byte)
+{
+    uint32_t i;
+
+    if ( nr >= BSP_NR_KMIS || 0 == __kmi[nr].initialized )
+    {
+        return KMI_ERR_NOINIT;
+    }
+
+    for ( i=0; i<TX_POLLS && 0==(pReg[nr]->KMISTAT & STAT_TXEMPTY); ++i );
+
+    if ( 0 == (pReg[nr]->KMISTAT & STAT_TXEMPTY) )
+    {
+        return KMI_ERR_TIMEOUT;
+    }
+
+    DATA_WRITE(nr, byte);
+
+    return KMI_OK;
+}
+
+
+/*
+ * Updates the state of a modifier key.
+ *
+ * @param keys - bit mask of pressed keys of the modifier
+ * @param key - bit of the key (1: left, 2: right)
+ * @param released - nonzero if the key has been released
+ *
+ * @return nonzero if any key of the modifier remains pressed
+ */
+static uint8_t __modifierKey(uint8_t* keys, uint8_t key, uint8_t released)
+{
+    *keys = ( 0 != released ? *keys & ~key : *keys | key );
+
+    return *keys;
+}
+
+
+/*
+ * Translates a pressed key into a character.
+ *
+ * @param k - the KMI's state
+ * @param ev - the event with the key's scancode and flags
+ *
+ * @return the character, 0 if the key does not produce any
+ */
+static char __translate(const kmiState* k, const kmiKeyEvent* ev)
+{
+    uint8_t upper;
+    char c;
+
+    if ( 0 != (ev->flags & KMI_KEY_EXTENDED) )
+    {
+        /* Only the keypad's Enter and '/' produce characters */
+        return ( SC_KP_ENTER == ev->code ? '\r' : ( SC_KP_SLASH == ev->code ? '/' : 0 ) );
+    }
+
+    if ( ev->code >= NR_SCANCODES )
+    {
+        return 0;
+    }
+
+    upper = ( 0 != (k->modifiers & KMI_MOD_SHIFT) ? 1 : 0 );
+    c = ( 0 != upper ? __scUpper[ev->code] : __scLower[ev->code] );
+
+    /* Caps Lock only affects letters */
+    if ( 0 != (k->modifiers & KMI_MOD_CAPS) && __scLower[ev->code] >= 'a' && __scLower[ev->code] <= 'z' )
+    {
+        c = ( 0 != upper ? __scLower[ev->code] : __scUpper[ev->code] );
+    }
+
+    if ( 0 != (k->modifiers & KMI_MOD_CTRL) && __scLower[ev->code] >= 'a' && __scLower[ev->code] <= 'z' )
+    {
+        c = (char) (__scLower[ev->code] & 0x1F);
+    }
+
+    return c;
+}
+
+
+/**
+ * Translates received scancodes (set 2) into the next key event. Prefixes
+ * of incomplete sequences are kept until the rest of the sequence is
+ * received. Device responses (e.g. acknowledges) and the Pause key's
+ * sequence are skipped.
+ *
+ * @param nr - number of the KMI
+ * @param ev - address where the event will be written to
+ *
+ * @return 1 if an event has been written, 0 if no complete event is available, KMI_ERR_PARAM if any parameter is invalid
+ */
+int8_t kmi_getKey(uint8_t nr, kmiKeyEvent* ev)
+{
+    kmiState* k;
+    int16_t b;
+    uint8_t released;
+    uint8_t side;
+
+    if ( nr >= BSP_NR_KMIS || NULL == ev )
+    {
+        return KMI_ERR_PARAM;
+    }
+
+    k = &__kmi[nr];
+
+    while ( (b = kmi_readByte(nr)) >= 0 )
+    {
+        if ( k->skip > 0 )
+        {
+            --k->skip;
+            continue;
+        }
+
+        switch ( b )
+        {
+            case SC_EXTENDED:
+                k->prefix |= KMI_KEY_EXTENDED;
+                continue;
+
+            case SC_BREAK:
+                k->prefix |= KMI_KEY_RELEASED;
+                continue;
+
+            case SC_PAUSE:
+                k->skip = PAUSE_TAIL;
+                k->prefix = 0;
+                continue;
+
+            case SC_ACK:
+            case SC_BAT_OK:
+            case SC_ECHO:
+            case SC_RESEND:
+            case SC_ERROR0:
+            case SC_ERROR1:
+                /* Responses of the device, never prefixed */
+                if ( 0 == k->prefix )
+                {
+                    continue;
+                }
+                break;
+        }
+
+        ev->code = (uint8_t) b;
+        ev->flags = k->prefix;
+        k->prefix = 0;
+
+        released = ev->flags & KMI_KEY_RELEASED;
+        side = ( 0 != (ev->flags & KMI_KEY_EXTENDED) ? 2 : 1 );
+
+        switch ( ev->code )
+        {
+            case SC_LSHIFT:
+            case SC_RSHIFT:
+                if ( 0 == (ev->flags & KMI_KEY_EXTENDED) )
+                {
+                    /* E0 12 and E0 59 are "fake shifts" of some extended keys */
+                    side = ( SC_LSHIFT == ev->code ? 1 : 2 );
+                    k->modifiers = ( 0 != __modifierKey(&k->shiftKeys, side, released) ?
+                                     k->modifiers | KMI_MOD_SHIFT : k->modifiers & ~KMI_MOD_SHIFT );
+                }
+                break;
+
+            case SC_CTRL:
+                k->modifiers = ( 0 != __modifierKey(&k->ctrlKeys, side, released) ?
+                                 k->modifiers | KMI_MOD_CTRL : k->modifiers & ~KMI_MOD_CTRL );
+                break;
+
+            case SC_ALT:
+                k->modifiers = ( 0 != __modifierKey(&k->altKeys, side, released) ?
+                                 k->modifiers | KMI_MOD_ALT : k->modifiers & ~KMI_MOD_ALT );
+                break;
+
+            case SC_CAPS:
+                if ( 0 == released && 0 == (ev->flags & KMI_KEY_EXTENDED) )
+                {
+                    k->modifiers ^= KMI_MOD_CAPS;
+                }
+                break;
+        }
+
+        ev->modifiers = k->modifiers;
+        ev->ascii = ( 0 == released ? __translate(k, ev) : 0 );
+
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Copies statistics of a KMI.
+ *
+ * @param nr - number of the KMI
+ * @param stats - address where the statistics will be copied to
+ *
+ * @return KMI_OK on success, KMI_ERR_PARAM if any parameter is invalid
+ */
+int8_t kmi_getStats(uint8_t nr, kmiStats* stats)
+{
+    if ( nr >= BSP_NR_KMIS || NULL == stats )
+    {
+        return KMI_ERR_PARAM;
+    }
+
+    *stats = __kmi[nr].stats;
+
+    return KMI_OK;
+}
+
+
+/**
+ * Resets all counters of a KMI's statistics.
+ *
+ * Nothing is done if 'nr' is invalid.
+ *
+ * @param nr - number of the KMI
+ */
+void kmi_resetStats(uint8_t nr)
+{
+    if ( nr >= BSP_NR_KMIS )
+    {
+        return;
+    }
+
+    __kmi[nr].stats.irqs = 0;
+    __kmi[nr].stats.bytes = 0;
+    __kmi[nr].stats.overruns = 0;
+    __kmi[nr].stats.maxLevel = 0;
+}
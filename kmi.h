@@ -0,0 +1,103 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the PL050 keyboard/mouse
+ * interface (KMI) driver.
+ *
+ * Received bytes (e.g. scancodes of a keyboard) are read by the KMI's ISR,
+ * a cascaded source of the SIC, into a ring buffer of each KMI, so the
+ * application never polls the controller. They can be read either as
+ * raw bytes or translated into key events (scancode set 2, as sent by
+ * a PS/2 keyboard without i8042 translation).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _KMI_H_
+#define _KMI_H_
+
+#include <stdint.h>
+
+
+/* Size of each KMI's receive buffer in bytes, must be a power of 2: */
+#define KMI_RX_BUF_SIZE          64
+
+
+/* Return values of kmi_* functions: */
+#define KMI_OK                   0
+#define KMI_ERR_PARAM           -1     /* invalid KMI or the ISR could not be registered */
+#define KMI_ERR_NOINIT          -2     /* the KMI is not initialized */
+#define KMI_ERR_TIMEOUT         -3     /* the transmitter did not become empty */
+
+
+/* Flags of key events: */
+#define KMI_KEY_RELEASED         0x01  /* the key has been released (a "break" code) */
+#define KMI_KEY_EXTENDED         0x02  /* the scancode was prefixed by 0xE0 */
+
+/* State of modifiers: */
+#define KMI_MOD_SHIFT            0x01
+#define KMI_MOD_CTRL             0x02
+#define KMI_MOD_ALT              0x04
+#define KMI_MOD_CAPS             0x08  /* Caps Lock is toggled on */
+
+
+/**
+ * A key, pressed or released.
+ */
+typedef struct _kmiKeyEvent
+{
+    uint8_t code;                 /* scancode (set 2) without prefixes */
+    uint8_t flags;                /* KMI_KEY_* */
+    uint8_t modifiers;            /* KMI_MOD_*, after the event has been applied */
+    char ascii;                   /* translated character of a pressed key, 0 if none */
+} kmiKeyEvent;
+
+
+/**
+ * Statistics of a KMI, all counters start at 0 when the KMI is
+ * initialized or its statistics are reset.
+ */
+typedef struct _kmiStats
+{
+    uint32_t irqs;                /* invocations of the KMI's ISR */
+    uint32_t bytes;               /* received bytes */
+    uint32_t overruns;            /* received bytes, discarded because the buffer was full */
+    uint32_t maxLevel;            /* max. number of bytes in the buffer */
+} kmiStats;
+
+
+int8_t kmi_init(uint8_t nr, uint8_t priority);
+
+void kmi_disable(uint8_t nr);
+
+uint32_t kmi_available(uint8_t nr);
+
+int16_t kmi_readByte(uint8_t nr);
+
+int8_t kmi_write(uint8_t nr, uint8_t byte);
+
+int8_t kmi_getKey(uint8_t nr, kmiKeyEvent* ev);
+
+int8_t kmi_getStats(uint8_t nr, kmiStats* stats);
+
+void kmi_resetStats(uint8_t nr);
+
+#endif  /* _KMI_H_ */
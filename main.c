@@ -32,6 +32,26 @@ limitations under the License.
 #include "uart.h"
 #include "timer.h"
 #include "rtc.h"
+#include "pmlog.h"
+#include "bench.h"
+#include "mem.h"
+#include "trace.h"
+#include "arith.h"
+#include "clocksource.h"
+#include "cpuload.h"
+#include "dma.h"
+#include "blk.h"
+#include "bcache.h"
+#include "tlog.h"
+#include "flash.h"
+#include "clcd.h"
+#include "comp.h"
+#include "kmi.h"
+#include "gpio.h"
+#include "ssp.h"
+#include "cyclic.h"
+#include "edf.h"
+#include "sync.h"
 
 /* A convenience buffer for strings */
 #define BUFLEN       25
@@ -79,52 +99,6 @@ static void ul2hex(char* buf, uint32_t val)
 }
 
 
-/*
- * Converts an unsigned long value into a string with its decimal representation.
- * 
- * The output will be prepended by spaces, so its entire length will be 20 characters.
- * 
- * @param buf - pointer to a string buffer (at least 20 characters)
- * 
- * @param val - unsigned long (4 bytes) value to be converted
- */
-static void ul2dec(char* buf, uint32_t val)
-{
-    int8_t i;
-    uint8_t digit;
-    
-    /* fill the buffer with spaces*/
-    for ( i=0; i<19; ++i )
-    {
-        buf[i] = ' ';
-    }
-    /* and set the zero terminator: */
-    buf[19] = '\0';
-    
-    /* No more than 19 digits will be appended to buffer */
-    for ( i=18; i>0; --i )
-    {
-        /* Ekstract the least significant digit of val */
-        digit = val % 10;
-        /* write it into the buffer */
-        buf[i] = '0' + digit;
-        
-        /* integer division of val by 10, i.e. shift it one digit to the right */
-        val /= 10;
-        
-        /* No need to continue the loop if no digits remain */
-        if ( 0 == val )
-        {
-            break;
-        }
-    }
-    
-    /*
-     * TODO: move digits to start of the buffer??
-     */
-}
-
-
 /*
  * Checks control registers of all timers and display
  * whether they are enabled
@@ -242,7 +216,10 @@ static void timerVectIrqTest(void)
     
     
     /* just wait until IRQ4 is triggered 10 times */
-    while ( __tick_cntr<10 );
+    while ( __tick_cntr<10 )
+    {
+        cpuload_idle();
+    }
     
     /* Cleanup. Reset the counter, disable interrupts, stop the Timer... */
     __tick_cntr = 0;
@@ -263,16 +240,14 @@ static void timerVectIrqTest(void)
 /*
  * An ISR routine, invoked when the RTC triggers the IRQ 10
  * 
- * @param param - a void* casted pointer to a uint32_t counter that will be incremented 
+ * @param param - a void* casted pointer to a semaphore that will be given
  */
 static void rtcISR(void* param)
 {
-    uint32_t* pCntr = (uint32_t*) param;
-
-    /* If 'param' is specified, increase the counter of "ticks" */
-    if ( NULL != pCntr )
+    /* If 'param' is specified, wake up the waiter */
+    if ( NULL != param )
     {
-        ++(*pCntr); 
+        sync_semGive((syncSem*) param);
     }
     
     /* And acknowledge the interrupt, i.e. clear it in the RTC */
@@ -282,46 +257,44 @@ static void rtcISR(void* param)
 
 /*
  * A test function for testing nonvectored IRQ handling from the RTC.
- * The RTC and a timer are prepared, IRQ10 is enabled, when a "tick" occurs
- * after 7 seconds and is verified by the timer, everything is cleaned up.
+ * The RTC is prepared, IRQ10 is enabled, when a "tick" occurs
+ * after 7 seconds and is verified by the clock, everything is cleaned up.
  */
 static void rtcTest(void)
 {
     const uint32_t period = 7;   /* in seconds */
-    const uint32_t initTimerVal = 100000000; /* 100,000,000 us = 100 sec. */
+    syncSem alarm;
+    uint32_t start;
+    uint32_t elapsed;
     
     uart_print(0, "\r\n=RTC test:=\r\n\r\n");
     
     /* Init all necessary peripherals */
     rtc_init();
-    timer_init(1, 1);
+    clocksource_init();
     pic_init();
     
     uart_print(0, "Expecting a RTC interrupt in 7 seconds...\r\n");
     
     /* Enable necessary controllers: */
-    pic_registerNonVectoredIrq(BSP_RTC_IRQ, &rtcISR, (void*) &__tick_cntr, 10);
+    sync_semInit(&alarm, 0, 1);
+    pic_registerNonVectoredIrq(BSP_RTC_IRQ, &rtcISR, (void*) &alarm, 10);
     irq_enableIrqMode();    
     pic_enableInterrupt(BSP_RTC_IRQ);
     rtc_enableInterrupt();
     
     /* Start the RTC */
     rtc_start();
-    /* Load the timer with an initial value */
-    timer_setLoad(1, 1, initTimerVal);
     /* Set an "alarm" at "now()" + 7 seconds:*/
     rtc_setMatch(rtc_getValue()+period);
-    /* Start a timer for verification of the RTC: */
-    timer_start(1, 1);
+    /* Read the clock for verification of the RTC: */
+    start = clocksource_read();
     
-    /* Reset the counter of "ticks" */
-    __tick_cntr = 0;
-    
-    /* Wait for the ISR to finish (i.e. update of a counter) */
-    while ( 0 == __tick_cntr );
+    /* Sleep until the ISR gives the semaphore */
+    sync_semTake(&alarm, SYNC_WAIT_FOREVER);
     
-    /* Stop the timer (and preserve its value) immediately after the interrupt */
-    timer_stop(1, 1);
+    /* Read the clock immediately after the interrupt */
+    elapsed = clocksource_read() - start;
     
     /* Clean up, disable controllers, etc. */
     rtc_disableInterrupt();
@@ -329,7 +302,7 @@ static void rtcTest(void)
     irq_disableIrqMode();
     
     /* Finally verify that the RTC indeed triggered an IRQ after approx. 7 seconds */
-    ul2dec(strbuf, initTimerVal - timer_getValue(1, 1) );
+    bench_ul2dec(strbuf, clocksource_ticksToUs(elapsed));
     uart_print(0, "RTC interrupt triggered after: ");
     uart_print(0, strbuf);
     uart_print(0, " micro seconds.\r\n");
@@ -432,35 +405,1401 @@ static void swIntTest(void)
 
 
 /*
- * Starting point of the application.
- * 
- * Currently it only executes a few simple test tasks that output
- * something to the serial port.
- */ 
-void main(void)
+ * Interrupt storm and throughput stress test.
+ *
+ * All four SP804 counters and software interrupts are driven at the same,
+ * increasing rate. The RTC triggers an interrupt every second in the
+ * background. Each step lasts
+ * STRESS_WINDOW micro seconds, afterwards the numbers of serviced interrupts are
+ * compared to the numbers of expected ones. The highest rate without missed
+ * ticks is the maximum sustainable interrupt rate.
+ */
+
+/* Periods of all interrupt sources in micro seconds, one per step: */
+static const uint32_t stressPeriods[] = { 1000, 500, 200, 100, 50, 40, 30, 20, 15, 10 };
+#define STRESS_NR_STEPS        ( sizeof(stressPeriods) / sizeof(uint32_t) )
+
+/* Duration of each step in micro seconds: */
+#define STRESS_WINDOW          250000UL
+
+/* Number of counters, driven by the test (the clock is not a SP804 counter, see clocksource.h): */
+#define STRESS_NR_COUNTERS     4
+
+/* Start, end of the current step and the "step completed" flag: */
+static volatile uint32_t __stressStart;
+static volatile uint32_t __stressEnd;
+
+/* Clock ticks per micro second and the duration of each step in clock ticks: */
+static uint32_t __stressTicksPerUs;
+static uint32_t __stressWindow;
+static volatile int8_t __stressDone;
+
+/* Counters of serviced interrupts: */
+static volatile uint32_t __stressTicks[STRESS_NR_COUNTERS];
+static volatile uint32_t __stressSwCntr;
+static volatile uint32_t __stressRtcCntr;
+
+
+/*
+ * Outputs " key=value" to the UART0, the value is in decimal format.
+ *
+ * @param key - name of the value
+ * @param val - value to be printed
+ */
+static void printKeyVal(const char* key, uint32_t val)
 {
-    uart_init(0);
+    bench_ul2dec(strbuf, val);
+
+    uart_print(0, " ");
+    uart_print(0, key);
+    uart_print(0, "=");
+    uart_print(0, strbuf);
+}
+
+
+/*
+ * Outputs the CPU load over both windows (in per mille) to the UART0:
+ *
+ *     CPULOAD load_1s=<n> load_10s=<n> idle_10s=<us> irq_10s=<us>
+ */
+static void cpuloadReport(void)
+{
+    cpuloadStats stats;
+
+    uart_print(0, "CPULOAD");
+    printKeyVal("load_1s", cpuload_getLoad(CPULOAD_WINDOW_1S));
+    printKeyVal("load_10s", cpuload_getLoad(CPULOAD_WINDOW_10S));
+    if ( 0 == cpuload_getStats(CPULOAD_WINDOW_10S, &stats) )
+    {
+        printKeyVal("idle_10s", clocksource_ticksToUs(stats.idle));
+        printKeyVal("irq_10s", clocksource_ticksToUs(stats.irq));
+    }
+    uart_print(0, "\r\n");
+}
+
+
+/*
+ * Stops all counters, driven by the stress test, and marks the step as completed.
+ */
+static void stressStop(void)
+{
+    uint8_t i;
+
+    for ( i=0; i<STRESS_NR_COUNTERS; ++i )
+    {
+        timer_disableInterrupt(i/2, i%2);
+        timer_stop(i/2, i%2);
+        timer_clearInterrupt(i/2, i%2);
+    }
+
+    __stressEnd = clocksource_read();
+    __stressDone = 1;
+}
+
+
+/*
+ * Services interrupts of both counters of a timer. The end of the step is
+ * also detected here, so the step completes even if the CPU is saturated
+ * by interrupts and the main loop does not get any time to run.
+ *
+ * @param nr - timer number (between 0 and 1)
+ */
+static void stressTimerTick(uint8_t nr)
+{
+    uint8_t c;
+    uint8_t idx;
+
+    for ( c=0; c<2; ++c )
+    {
+        idx = 2*nr + c;
+        if ( idx<STRESS_NR_COUNTERS && timer_isInterruptPending(nr, c) )
+        {
+            ++__stressTicks[idx];
+            timer_clearInterrupt(nr, c);
+        }
+    }
+
+    if ( 0==__stressDone && (clocksource_read() - __stressStart) >= __stressWindow )
+    {
+        stressStop();
+    }
+}
+
+
+/*
+ * Services the RTC interrupt and sets the next "alarm" one second later.
+ */
+static void stressRtcTick(void)
+{
+    ++__stressRtcCntr;
+    rtc_clearInterrupt();
+    rtc_setMatch(rtc_getValue() + 1);
+}
+
+
+/*
+ * Services the software interrupt.
+ */
+static void stressSwTick(void)
+{
+    ++__stressSwCntr;
+    pic_clearSwInterruptNr(BSP_SOFTWARE_IRQ);
+}
+
+
+/* Non vectored ISRs, 'param' of the timer ISR is the timer number: */
+static void stressTimerISR(void* param)
+{
+    stressTimerTick( (uint8_t) (uint32_t) param );
+}
+
+static void stressRtcISR(void* param)
+{
+    stressRtcTick();
+}
+
+static void stressSwISR(void* param)
+{
+    stressSwTick();
+}
+
+
+/* Vectored ISRs: */
+static void stressVectTimer0ISR(void)
+{
+    stressTimerTick(0);
+}
+
+static void stressVectTimer1ISR(void)
+{
+    stressTimerTick(1);
+}
+
+static void stressVectRtcISR(void)
+{
+    stressRtcTick();
+}
+
+static void stressVectSwISR(void)
+{
+    stressSwTick();
+}
+
+
+/*
+ * Runs a single step of the stress test: all counters and software interrupts
+ * are triggered with the same period for STRESS_WINDOW micro seconds.
+ *
+ * Reports a machine readable line:
+ *   STRESS mode=<nonvect|vect> period=<us> rate=<requested IRQs/s> irqs=<serviced> missed=<missed ticks>
+ *
+ * @param vect - 0 for non vectored mode, any other value for vectored mode
+ * @param period - period of each interrupt source in micro seconds
+ *
+ * @return number of missed ticks
+ */
+static uint32_t stressStep(int8_t vect, uint32_t period)
+{
+    const uint32_t periodTicks = period * __stressTicksPerUs;
+    uint8_t i;
+    uint32_t now;
+    uint32_t next;
+    uint32_t triggered = 0;
+    uint32_t expected;
+    uint32_t serviced;
+    uint32_t missed = 0;
+
+    __stressDone = 0;
+    __stressSwCntr = 0;
+    for ( i=0; i<STRESS_NR_COUNTERS; ++i )
+    {
+        __stressTicks[i] = 0;
+        timer_init(i/2, i%2);
+        /* the counter's period equals its load value + 1 */
+        timer_setLoad(i/2, i%2, period-1);
+        timer_enableInterrupt(i/2, i%2);
+    }
+
+    __stressStart = clocksource_read();
+    for ( i=0; i<STRESS_NR_COUNTERS; ++i )
+    {
+        timer_start(i/2, i%2);
+    }
 
-    uart_print(0, "* * * T E S T   S T A R T * * *\r\n");
-    
-    timersEnabledTest();
-    
     /*
-     * W A R N I N G :
-     * Early versions of Qemu implement vectored IRQ handling improperly. In such a case,
-     * this function MUST NOT BE RUN as wrong ISR routines may be run due ti this bug!
-     *
-     * This defect was fixed at Qemu 1.3 (released in September 2012). More details:
-     * - https://lists.gnu.org/archive/html/qemu-devel/2012-08/msg03354.html
-     * - https://github.com/qemu/qemu/commit/14c126baf1c38607c5bd988878de85a06cefd8cf
+     * Software interrupts are triggered by the main loop at their deadlines.
+     * If the previous one has not been serviced yet, the new one would be
+     * merged with it, so it is not triggered (and will be counted as missed).
      */
-    timerVectIrqTest();
-    
-    rtcTest();
-    swIntTest();
-    
-    uart_print(0, "\r\n* * * T E S T   C O M P L E T E D * * *\r\n");
-    
-    /* End in an infinite loop */
-    for ( ; ; );
+    next = __stressStart + periodTicks;
+    while ( 0 == __stressDone )
+    {
+        now = clocksource_read();
+        if ( (now - next) < 0x80000000UL )
+        {
+            if ( triggered == __stressSwCntr )
+            {
+                ++triggered;
+                pic_setSwInterruptNr(BSP_SOFTWARE_IRQ);
+            }
+            next += periodTicks;
+        }
+    }
+
+    /* The last triggered software interrupt might be still pending */
+    pic_clearSwInterruptNr(BSP_SOFTWARE_IRQ);
+
+    /* One tick per source is tolerated as counters are not started simultaneously */
+    expected = arith_udiv(__stressEnd - __stressStart, periodTicks);
+    serviced = __stressSwCntr;
+    missed += ( expected > __stressSwCntr + 1 ? expected - __stressSwCntr - 1 : 0 );
+    for ( i=0; i<STRESS_NR_COUNTERS; ++i )
+    {
+        serviced += __stressTicks[i];
+        missed += ( expected > __stressTicks[i] + 1 ? expected - __stressTicks[i] - 1 : 0 );
+    }
+
+    uart_print(0, "STRESS mode=");
+    uart_print(0, ( vect ? "vect" : "nonvect" ) );
+    printKeyVal("period", period);
+    printKeyVal("rate", arith_udiv(1000000UL, period) * (STRESS_NR_COUNTERS + 1));
+    printKeyVal("irqs", serviced);
+    printKeyVal("missed", missed);
+    uart_print(0, "\r\n");
+
+    return missed;
+}
+
+
+/*
+ * Runs all steps of the stress test in the selected IRQ handling mode
+ * and reports the maximum sustainable interrupt rate:
+ *   STRESS mode=<nonvect|vect> max_rate=<IRQs/s> rtc_ticks=<n>
+ *
+ * @param vect - 0 for non vectored mode, any other value for vectored mode
+ */
+static void stressRun(int8_t vect)
+{
+    const uint8_t tirqs[BSP_NR_TIMERS] = BSP_TIMER_IRQS;
+    uint8_t i;
+    uint32_t maxRate = 0;
+
+    pic_init();
+    _pic_set_irq_vector_mode(vect);
+
+    /* Timers have higher priority than the RTC and software interrupts */
+    if ( vect )
+    {
+        pic_registerVectorIrq(tirqs[0], &stressVectTimer0ISR, 30);
+        pic_registerVectorIrq(tirqs[1], &stressVectTimer1ISR, 30);
+        pic_registerVectorIrq(BSP_RTC_IRQ, &stressVectRtcISR, 20);
+        pic_registerVectorIrq(BSP_SOFTWARE_IRQ, &stressVectSwISR, 10);
+    }
+    else
+    {
+        pic_registerNonVectoredIrq(tirqs[0], &stressTimerISR, (void*) 0, 30);
+        pic_registerNonVectoredIrq(tirqs[1], &stressTimerISR, (void*) 1, 30);
+        pic_registerNonVectoredIrq(BSP_RTC_IRQ, &stressRtcISR, NULL, 20);
+        pic_registerNonVectoredIrq(BSP_SOFTWARE_IRQ, &stressSwISR, NULL, 10);
+    }
+
+    pic_enableInterrupt(tirqs[0]);
+    pic_enableInterrupt(tirqs[1]);
+    pic_enableInterrupt(BSP_RTC_IRQ);
+    pic_enableInterrupt(BSP_SOFTWARE_IRQ);
+
+    __stressRtcCntr = 0;
+    rtc_init();
+    rtc_start();
+    rtc_setMatch(rtc_getValue() + 1);
+    rtc_enableInterrupt();
+
+    irq_enableIrqMode();
+
+    /* Rates increase with each step, the remaining steps are skipped after the first failed one */
+    for ( i=0; i<STRESS_NR_STEPS; ++i )
+    {
+        if ( 0 != stressStep(vect, stressPeriods[i]) )
+        {
+            break;  /* out of for i */
+        }
+
+        maxRate = arith_udiv(1000000UL, stressPeriods[i]) * (STRESS_NR_COUNTERS + 1);
+    }
+
+    irq_disableIrqMode();
+    rtc_disableInterrupt();
+    pic_disableAllInterrupts();
+    _pic_set_irq_vector_mode(0);
+
+    uart_print(0, "STRESS mode=");
+    uart_print(0, ( vect ? "vect" : "nonvect" ) );
+    printKeyVal("max_rate", maxRate);
+    printKeyVal("rtc_ticks", __stressRtcCntr);
+    uart_print(0, "\r\n");
+}
+
+
+/*
+ * Interrupt storm test in both IRQ handling modes.
+ */
+static void stressTest(void)
+{
+    uart_print(0, "\r\n=Interrupt stress test:=\r\n\r\n");
+
+    clocksource_init();
+    __stressTicksPerUs = arith_udiv(clocksource_getFrequency(), 1000000UL);
+    __stressWindow = STRESS_WINDOW * __stressTicksPerUs;
+
+    stressRun(0);
+    stressRun(1);
+
+    uart_print(0, "\r\n=Interrupt stress test completed=\r\n");
+}
+
+
+/*
+ * A "quiet" ISR routine for benchmarking of non vectored IRQ dispatching,
+ * invoked when an IRQ is triggered by software.
+ *
+ * @param param - a void* casted pointer to a uint32_t counter that will be incremented
+ */
+static void benchSwISR(void* param)
+{
+    ++(*( (uint32_t*) param ));
+    pic_clearSwInterruptNr(BSP_SOFTWARE_IRQ);
+}
+
+
+/*
+ * A "quiet" ISR routine for benchmarking of vectored IRQ dispatching,
+ * invoked when an IRQ is triggered by software.
+ */
+static void benchVectSwISR(void)
+{
+    ++__tick_cntr;
+    pic_clearSwInterruptNr(BSP_SOFTWARE_IRQ);
+}
+
+
+/*
+ * A "quiet" ISR routine for benchmarking of the SIC's cascade,
+ * invoked when the SIC's source is triggered by software.
+ *
+ * @param param - a void* casted pointer to a uint32_t counter that will be incremented
+ */
+static void benchSicSwISR(void* param)
+{
+    ++(*( (uint32_t*) param ));
+    pic_clearSicSwInterrupt(BSP_SOFTWARE_IRQ);
+}
+
+
+/* Sizes of blocks, copied by the CPU and by the DMA controller: */
+#define DMA_BENCH_NR_SIZES      6
+#define DMA_BENCH_MAX_SIZE      65536
+
+/* Set by the DMA's completion callback: */
+static volatile uint32_t __dmaDone;
+
+
+/*
+ * Completion callback of DMA benchmarks.
+ *
+ * @param status - status of the transfer (ignored)
+ * @param param - unused
+ */
+static void benchDmaDone(int8_t status, void* param)
+{
+    __dmaDone = 1;
+}
+
+
+/*
+ * Compares copying of memory blocks of increasing sizes by the CPU (memcpy)
+ * and by the DMA controller, including setup of the transfer and its completion
+ * IRQ. The smallest size, where the DMA is faster, is reported as:
+ *
+ *     DMACOPY crossover=<bytes>
+ *
+ * 0 is reported if the DMA is never faster.
+ */
+static void benchDma(void)
+{
+    static uint8_t src[DMA_BENCH_MAX_SIZE];
+    static uint8_t dst[DMA_BENCH_MAX_SIZE];
+    static const uint32_t sizes[DMA_BENCH_NR_SIZES] = { 64, 256, 1024, 4096, 16384, 65536 };
+    static const char* const cpuNames[DMA_BENCH_NR_SIZES] =
+        { "copy_cpu_64", "copy_cpu_256", "copy_cpu_1k", "copy_cpu_4k", "copy_cpu_16k", "copy_cpu_64k" };
+    static const char* const dmaNames[DMA_BENCH_NR_SIZES] =
+        { "copy_dma_64", "copy_dma_256", "copy_dma_1k", "copy_dma_4k", "copy_dma_16k", "copy_dma_64k" };
+    uint32_t cpuTime;
+    uint32_t crossover = 0;
+    uint8_t i;
+
+    pic_init();
+    dma_init(10);
+    irq_enableIrqMode();
+
+    for ( i=0; i<DMA_BENCH_NR_SIZES; ++i )
+    {
+        BENCH(cpuNames[i], 16, memcpy(dst, src, sizes[i]));
+        cpuTime = bench_getLastMedian();
+
+        BENCH(dmaNames[i], 16,
+              __dmaDone = 0;
+              if ( dma_memcpyAsync(dst, src, sizes[i], &benchDmaDone, NULL) >= 0 )
+              {
+                  while ( 0 == __dmaDone );
+              } );
+
+        if ( 0 == crossover && bench_getLastMedian() < cpuTime )
+        {
+            crossover = sizes[i];
+        }
+    }
+
+    pic_disableInterrupt(BSP_DMA_IRQ);
+    irq_disableIrqMode();
+
+    uart_print(0, "DMACOPY");
+    printKeyVal("crossover", crossover);
+    uart_print(0, "\r\n");
+}
+
+
+/* Number of blocks, transferred by SD card benchmarks: */
+#define SD_BENCH_NR_BLOCKS      64
+
+/* Number of blocks of the telemetry log, preceding the scratch area: */
+#define TLOG_BENCH_NR_BLOCKS    128
+
+
+/*
+ * Initializes the SD card (if inserted) and compares reading of
+ * SD_BENCH_NR_BLOCKS blocks by single block commands and by a single
+ * multiple block command, as well as repeated reads of a block via the
+ * block cache, and appends to a telemetry log, formatted just before the
+ * scratch area. Finally the last blocks of the card are overwritten and
+ * read back. The results are reported as:
+ *
+ *     SD blocks=<capacity in blocks>
+ *     SDCHECK ok=<1 if the written blocks were read back, 0 otherwise>
+ *
+ * Nothing but "No SD card" is reported if no card is inserted.
+ */
+static void benchSd(void)
+{
+    static uint8_t buf[SD_BENCH_NR_BLOCKS * BLK_SIZE];
+    uint32_t nr;
+    uint32_t i;
+    uint32_t lba;
+    uint32_t ts = 0;
+    int8_t ok;
+
+    pic_init();
+    if ( BLK_OK != blk_init(10) || blk_getNrBlocks() < SD_BENCH_NR_BLOCKS + TLOG_BENCH_NR_BLOCKS )
+    {
+        uart_print(0, "No SD card\r\n");
+        return;
+    }
+
+    nr = blk_getNrBlocks();
+    uart_print(0, "SD");
+    printKeyVal("blocks", nr);
+    uart_print(0, "\r\n");
+
+    irq_enableIrqMode();
+
+    BENCH("sd_read_1block", 16, blk_read(0, buf, 1));
+    BENCH("sd_read_32k_single", 4,
+          for ( i=0; i<SD_BENCH_NR_BLOCKS; ++i )
+          {
+              blk_read(i, buf + i*BLK_SIZE, 1);
+          } );
+    BENCH("sd_read_32k_multi", 4, blk_read(0, buf, SD_BENCH_NR_BLOCKS));
+
+    bcache_init();
+    BENCH("sd_read_1block_cached", 16, bcache_read(0, buf, 1));
+
+    /* Most appends only copy a record, every few pages a batch is written */
+    if ( TLOG_OK == tlog_format(nr - SD_BENCH_NR_BLOCKS - TLOG_BENCH_NR_BLOCKS, TLOG_BENCH_NR_BLOCKS) )
+    {
+        BENCH("tlog_append", 128, ++ts; tlog_append(ts, 1, 0, ts));
+        BENCH("tlog_sync", 4, tlog_sync());
+    }
+
+    /* The last blocks of the card are used as a scratch area */
+    lba = nr - SD_BENCH_NR_BLOCKS;
+    for ( i=0; i<sizeof(buf); ++i )
+    {
+        buf[i] = (uint8_t) (i * 7 + 3);
+    }
+
+    BENCH("sd_write_32k_multi", 4, blk_write(lba, buf, SD_BENCH_NR_BLOCKS));
+
+    for ( i=0; i<sizeof(buf); ++i )
+    {
+        buf[i] = 0;
+    }
+
+    ok = ( BLK_OK == blk_read(lba, buf, SD_BENCH_NR_BLOCKS) ? 1 : 0 );
+    for ( i=0; i<sizeof(buf) && 0!=ok; ++i )
+    {
+        ok = ( (uint8_t) (i * 7 + 3) == buf[i] ? 1 : 0 );
+    }
+
+    pic_disableInterrupt(BSP_MMCI_IRQ);
+    irq_disableIrqMode();
+
+    uart_print(0, "SDCHECK");
+    printKeyVal("ok", ok);
+    uart_print(0, "\r\n");
+}
+
+
+/* Number of bytes, programmed by the flash benchmark: */
+#define FLASH_BENCH_SIZE        4096
+
+
+/*
+ * Erases the last sector of the NOR flash, programs FLASH_BENCH_SIZE bytes
+ * into it by write buffer commands and reads them back. The results are
+ * reported as:
+ *
+ *     FLASH sectors=<number of sectors> sector_size=<bytes>
+ *     FLASHCHECK ok=<1 if the programmed bytes were read back, 0 otherwise>
+ *
+ * Nothing but "No flash" is reported if no CFI flash is found.
+ */
+static void benchFlash(void)
+{
+    static uint8_t buf[FLASH_BENCH_SIZE];
+    const flashInfo* info;
+    uint32_t offset;
+    uint32_t i;
+    int8_t ok;
+
+    if ( FLASH_OK != flash_init() )
+    {
+        uart_print(0, "No flash\r\n");
+        return;
+    }
+
+    info = flash_getInfo();
+    uart_print(0, "FLASH");
+    printKeyVal("sectors", info->nrSectors);
+    printKeyVal("sector_size", info->sectorSize);
+    uart_print(0, "\r\n");
+
+    offset = info->size - info->sectorSize;
+    for ( i=0; i<sizeof(buf); ++i )
+    {
+        buf[i] = (uint8_t) (i * 5 + 1);
+    }
+
+    /* Programming the same data again does not modify them */
+    BENCH("flash_erase_sector", 4, flash_eraseAsync(offset, info->sectorSize, NULL, NULL); flash_wait());
+    BENCH("flash_program_4k", 4, flash_programAsync(offset, buf, sizeof(buf), NULL, NULL); flash_wait());
+
+    for ( i=0; i<sizeof(buf); ++i )
+    {
+        buf[i] = 0;
+    }
+
+    ok = ( FLASH_OK == flash_read(offset, buf, sizeof(buf)) ? 1 : 0 );
+    for ( i=0; i<sizeof(buf) && 0!=ok; ++i )
+    {
+        ok = ( (uint8_t) (i * 5 + 1) == buf[i] ? 1 : 0 );
+    }
+
+    uart_print(0, "FLASHCHECK");
+    printKeyVal("ok", ok);
+    uart_print(0, "\r\n");
+}
+
+
+/* Display mode of CLCD benchmarks: */
+#define CLCD_BENCH_WIDTH        640
+#define CLCD_BENCH_HEIGHT       480
+
+/* Longest wait for a swap (approx. 6 frames) in microseconds: */
+#define CLCD_BENCH_SWAP_US      100000
+
+static volatile uint8_t __blitDone;
+
+
+/*
+ * Completion callback of the asynchronous blit benchmark.
+ *
+ * @param status - status of the copy (ignored)
+ * @param param - unused
+ */
+static void benchBlitDone(int8_t status, void* param)
+{
+    __blitDone = 1;
+}
+
+
+/*
+ * Waits until a pending swap of framebuffers completes or
+ * CLCD_BENCH_SWAP_US elapses (Qemu does not refresh the display,
+ * and thus does not load new base addresses, with '-nographic').
+ *
+ * @return 1 if the swap completed, 0 otherwise
+ */
+static uint8_t benchWaitSwap(void)
+{
+    const uint32_t start = clocksource_read();
+
+    while ( 0 != clcd_isSwapPending() &&
+            clocksource_ticksToUs(clocksource_read() - start) < CLCD_BENCH_SWAP_US );
+
+    return ( 0 == clcd_isSwapPending() ? 1 : 0 );
+}
+
+
+/*
+ * Fills and copies rectangles of VGA framebuffers by the CPU's bursts and
+ * by the DMA controller, and swaps the framebuffers several times. The
+ * number of completed swaps and pixels, copied by the dirty rectangle
+ * compositor per frame, are reported as:
+ *
+ *     CLCD swaps=<completed swaps out of 4>
+ *     COMP frames=<presented frames> pixels_per_frame=<pixels> full_frame=<pixels>
+ */
+static void benchClcd(void)
+{
+    static uint16_t fb[2][CLCD_BENCH_WIDTH * CLCD_BENCH_HEIGHT]
+        __attribute__((section(".noinit"), aligned(8)));
+    clcdSurface front;
+    clcdSurface* back;
+    compStats stats;
+    uint8_t swaps = 0;
+    uint8_t i;
+
+    pic_init();
+    dma_init(10);
+
+    if ( CLCD_OK != clcd_init(CLCD_MODE_VGA, fb[0], fb[1], 5) )
+    {
+        uart_print(0, "No CLCD\r\n");
+        return;
+    }
+
+    irq_enableIrqMode();
+    back = clcd_getBack();
+    front = *clcd_getFront();
+
+    BENCH("clcd_fill_screen", 8, clcd_fillRect(back, 0, 0, back->width, back->height, CLCD_RGB(0, 0, 255)));
+    BENCH("clcd_fill_64x64_odd", 32, clcd_fillRect(back, 1, 1, 64, 64, CLCD_RGB(255, 0, 0)));
+    BENCH("clcd_blit_64x64", 32, clcd_blit(back, 100, 100, &front, 0, 0, 64, 64));
+    BENCH("clcd_blit_64x64_unaligned", 32, clcd_blit(back, 101, 100, &front, 0, 0, 64, 64));
+    BENCH("clcd_scroll_8", 8, clcd_blit(back, 0, 0, back, 0, 8, back->width, back->height - 8));
+
+    BENCH("clcd_blit_screen_cpu", 8, clcd_blit(&front, 0, 0, back, 0, 0, back->width, back->height));
+    BENCH("clcd_blit_screen_dma", 8,
+          __blitDone = 0;
+          if ( CLCD_OK == clcd_blitAsync(&front, 0, 0, back, 0, 0, back->width, back->height, &benchBlitDone, NULL) )
+          {
+              while ( 0 == __blitDone );
+          } );
+
+    /* Partial updates of the front buffer: 8 sprites of 32x32 pixels move by a pixel */
+    comp_init(&front, back);
+    comp_present();
+    comp_resetStats();
+    BENCH("comp_present_8x32x32", 16,
+          for ( i=0; i<8; ++i )
+          {
+              comp_markDirty((uint16_t) (i * 64 + 1), (uint16_t) (i * 48), 33, 32);
+          }
+          comp_present() );
+    comp_getStats(&stats);
+
+    for ( i=0; i<4; ++i )
+    {
+        clcd_swap();
+        swaps += benchWaitSwap();
+    }
+
+    clcd_disable();
+    pic_disableInterrupt(BSP_DMA_IRQ);
+    irq_disableIrqMode();
+
+    uart_print(0, "CLCD");
+    printKeyVal("swaps", swaps);
+    uart_print(0, "\r\n");
+
+    uart_print(0, "COMP");
+    printKeyVal("frames", stats.frames);
+    printKeyVal("pixels_per_frame", stats.lastPixels);
+    printKeyVal("full_frame", CLCD_BENCH_WIDTH * CLCD_BENCH_HEIGHT);
+    uart_print(0, "\r\n");
+}
+
+
+/* Max. time to wait for the keyboard's response in microseconds: */
+#define KMI_BENCH_RESPONSE_US   20000
+
+
+/*
+ * Sends "echo" commands to the keyboard and waits for its responses, i.e.
+ * a round trip via the KMI's receive interrupt and the SIC's cascade.
+ * The number of received responses and the KMI's statistics are reported as:
+ *
+ *     KMI responses=<responses out of 8> irqs=<ISR invocations> overruns=<discarded bytes>
+ */
+static void benchKmi(void)
+{
+    kmiStats stats;
+    uint32_t start;
+    uint8_t responses = 0;
+    uint8_t i;
+
+    pic_init();
+
+    if ( KMI_OK != kmi_init(0, 10) )
+    {
+        uart_print(0, "No KMI\r\n");
+        return;
+    }
+
+    irq_enableIrqMode();
+
+    for ( i=0; i<8; ++i )
+    {
+        if ( KMI_OK != kmi_write(0, 0xEE) )
+        {
+            continue;
+        }
+
+        start = clocksource_read();
+        while ( 0 == kmi_available(0) &&
+                clocksource_ticksToUs(clocksource_read() - start) < KMI_BENCH_RESPONSE_US );
+
+        if ( kmi_readByte(0) >= 0 )
+        {
+            ++responses;
+        }
+    }
+
+    kmi_getStats(0, &stats);
+    kmi_disable(0);
+    pic_disableSicCascade();
+    irq_disableIrqMode();
+
+    uart_print(0, "KMI");
+    printKeyVal("responses", responses);
+    printKeyVal("irqs", stats.irqs);
+    printKeyVal("overruns", stats.overruns);
+    uart_print(0, "\r\n");
+}
+
+
+/* Set by the GPIO's callback: */
+static volatile uint32_t __gpioEdges;
+
+
+/*
+ * Callback of the GPIO benchmark's edge interrupt.
+ *
+ * @param pin - number of the pin (ignored)
+ * @param param - unused
+ */
+static void benchGpioEdge(uint8_t pin, void* param)
+{
+    ++__gpioEdges;
+}
+
+
+/*
+ * Sets and clears pins of the first GPIO controller by masked stores, and
+ * measures the time from a rising edge of an output pin till its callback
+ * completes. The number of handled edges is reported as:
+ *
+ *     GPIO edges=<handled edges> irqs=<ISR invocations>
+ */
+static void benchGpio(void)
+{
+    uint32_t i;
+
+    pic_init();
+
+    if ( GPIO_OK != gpio_init(0, 10) )
+    {
+        uart_print(0, "No GPIO\r\n");
+        return;
+    }
+
+    gpio_setOutputs(0, 0xFF);
+    irq_enableIrqMode();
+
+    BENCH("gpio_modify", 64, gpio_modify(0, 0x55, 0xAA); gpio_modify(0, 0xAA, 0x55));
+
+    /* Read-modify-write of the whole port for comparison */
+    BENCH("gpio_rmw", 64,
+          gpio_write(0, 0xFF, (uint8_t) ((gpio_read(0, 0xFF) & ~0xAA) | 0x55));
+          gpio_write(0, 0xFF, (uint8_t) ((gpio_read(0, 0xFF) & ~0x55) | 0xAA)) );
+
+    gpio_clear(0, 0xFF);
+    __gpioEdges = 0;
+    gpio_registerIrq(0, 0, GPIO_IRQ_RISING, &benchGpioEdge, NULL);
+
+    BENCH("gpio_irq_edge", 64,
+          i = __gpioEdges; gpio_set(0, 0x01); while ( i == __gpioEdges ); gpio_clear(0, 0x01) );
+
+    gpio_disable(0);
+    irq_disableIrqMode();
+
+    uart_print(0, "GPIO");
+    printKeyVal("edges", __gpioEdges);
+    printKeyVal("irqs", gpio_getNrIrqs(0));
+    uart_print(0, "\r\n");
+}
+
+
+/* Number of frames of SSP benchmarks' transfers: */
+#define SSP_BENCH_FRAMES        256
+
+/* Number of queued SSP transfers, completed by the ISR: */
+static volatile uint32_t __sspDone;
+
+
+/*
+ * Completion callback of queued SSP transfers.
+ *
+ * @param status - status of the transfer (ignored)
+ * @param param - unused
+ */
+static void benchSspDone(int8_t status, void* param)
+{
+    ++__sspDone;
+}
+
+
+/*
+ * Transfers frames by the SSP in the loop back mode, polled and queued
+ * (4 transfers of a quarter of the block each, chained by the ISR). The
+ * SSP's statistics and the number of mismatched frames are reported as:
+ *
+ *     SSP frames=<frames> irqs=<ISR invocations> overruns=<receive overruns> errors=<mismatched frames>
+ */
+static void benchSsp(void)
+{
+    static uint8_t tx[SSP_BENCH_FRAMES];
+    static uint8_t rx[SSP_BENCH_FRAMES];
+    sspTransfer t[4];
+    sspStats stats;
+    uint32_t errors = 0;
+    uint32_t i;
+
+    pic_init();
+
+    if ( SSP_OK != ssp_init(12000000, 8, SSP_MODE_0, 10) )
+    {
+        uart_print(0, "No SSP\r\n");
+        return;
+    }
+
+    ssp_setLoopback(1);
+    irq_enableIrqMode();
+
+    for ( i=0; i<SSP_BENCH_FRAMES; ++i )
+    {
+        tx[i] = (uint8_t) (i * 13 + 1);
+    }
+
+    BENCH("ssp_transfer_256", 16, ssp_transfer(tx, rx, SSP_BENCH_FRAMES));
+
+    BENCH("ssp_queue_4x64", 16,
+          __sspDone = 0;
+          for ( i=0; i<4; ++i )
+          {
+              t[i].tx = tx + i * (SSP_BENCH_FRAMES / 4);
+              t[i].rx = rx + i * (SSP_BENCH_FRAMES / 4);
+              t[i].count = SSP_BENCH_FRAMES / 4;
+              t[i].callback = &benchSspDone;
+              t[i].param = NULL;
+              ssp_submit(&t[i]);
+          }
+          while ( __sspDone < 4 ) );
+
+    for ( i=0; i<SSP_BENCH_FRAMES; ++i )
+    {
+        errors += ( tx[i] != rx[i] ? 1 : 0 );
+    }
+
+    ssp_getStats(&stats);
+    ssp_disable();
+    irq_disableIrqMode();
+
+    uart_print(0, "SSP");
+    printKeyVal("frames", stats.frames);
+    printKeyVal("irqs", stats.irqs);
+    printKeyVal("overruns", stats.overruns);
+    printKeyVal("errors", errors);
+    uart_print(0, "\r\n");
+}
+
+
+/* Max. time to wait for the remaining looped back characters in microseconds: */
+#define UART_BENCH_WAIT_US      20000
+
+
+/*
+ * Sends bursts of 16 characters by UART1 in the loop back mode and drains
+ * them by its receive path, which switches to polling by timer 1 (counter 0)
+ * when the rate of receive interrupts exceeds the default threshold.
+ * The received characters and the receive path's statistics are reported as:
+ *
+ *     UARTRX bytes=<received> irqs=<ISR invocations> polls=<timer polls> overruns=<lost characters> toPoll=<switches to polling> toIrq=<switches back to interrupts>
+ */
+static void benchUartRx(void)
+{
+    uartRxStats stats;
+    uint32_t start;
+    uint32_t received = 0;
+
+    pic_init();
+    uart_init(1);
+
+    if ( UART_OK != uart_enableRxInterrupt(1, 10) ||
+         UART_OK != uart_rxUsePollTimer(1, 1, 0, 9) )
+    {
+        uart_print(0, "No UART receive path\r\n");
+        return;
+    }
+
+    uart_setLoopback(1, 1);
+    irq_enableIrqMode();
+
+    BENCH("uart_rx_burst16", 32,
+          uart_print(1, "0123456789ABCDEF");
+          while ( uart_readChar(1) >= 0 )
+          {
+              ++received;
+          } );
+
+    /* Let the line go quiet, so the receive path returns to interrupts */
+    start = clocksource_read();
+    while ( clocksource_ticksToUs(clocksource_read() - start) < UART_BENCH_WAIT_US )
+    {
+        received += ( uart_readChar(1) >= 0 ? 1 : 0 );
+    }
+
+    uart_getRxStats(1, &stats);
+    uart_disableRxInterrupt(1);
+    uart_setLoopback(1, 0);
+    uart_disableRx(1);
+    irq_disableIrqMode();
+
+    uart_print(0, "UARTRX");
+    printKeyVal("bytes", received);
+    printKeyVal("irqs", stats.irqs);
+    printKeyVal("polls", stats.polls);
+    printKeyVal("overruns", stats.overruns);
+    printKeyVal("toPoll", stats.toPoll);
+    printKeyVal("toIrq", stats.toIrq);
+    uart_print(0, "\r\n");
+}
+
+
+/* Duration of the interrupt storm in microseconds: */
+#define IRQ_STORM_US            100000
+
+
+/*
+ * ISR of the interrupt storm, it never clears the request.
+ *
+ * @param param - unused
+ */
+static void benchStormISR(void* param)
+{
+}
+
+
+/*
+ * Storms the software interrupt line, whose ISR never clears the request,
+ * while the line is limited to 10 requests per 10 ms (re-enabled by timer 1,
+ * counter 1). Progress of the application meanwhile and the line's
+ * statistics are reported as:
+ *
+ *     IRQSTORM serviced=<ISR calls> throttled=<times the line was masked> loops=<iterations of the application's loop>
+ */
+static void benchIrqStorm(void)
+{
+    const uint8_t irq = BSP_SOFTWARE_IRQ;
+    picIrqLimitStats stats;
+    uint32_t loops = 0;
+    uint32_t start;
+
+    pic_init();
+
+    if ( pic_useRateLimitTimer(1, 1, 20) < 0 ||
+         pic_registerNonVectoredIrq(irq, &benchStormISR, NULL, 10) < 0 ||
+         pic_setIrqRateLimit(irq, 10, 10000) < 0 )
+    {
+        uart_print(0, "No IRQ rate limit\r\n");
+        return;
+    }
+
+    pic_enableInterrupt(irq);
+    irq_enableIrqMode();
+    pic_setSwInterruptNr(irq);
+
+    start = clocksource_read();
+    while ( clocksource_ticksToUs(clocksource_read() - start) < IRQ_STORM_US )
+    {
+        ++loops;
+    }
+
+    irq_disableIrqMode();
+    pic_clearSwInterruptNr(irq);
+    pic_getIrqLimitStats(irq, &stats);
+    pic_init();
+
+    uart_print(0, "IRQSTORM");
+    printKeyVal("serviced", stats.serviced);
+    printKeyVal("throttled", stats.throttled);
+    printKeyVal("loops", loops);
+    uart_print(0, "\r\n");
+}
+
+
+/* Duration of the cyclic executive's benchmark in microseconds: */
+#define CYCLIC_BENCH_US         100000
+
+
+/*
+ * A job of the cyclic executive, it busy waits.
+ *
+ * @param param - duration of the job in microseconds
+ */
+static void benchCyclicJob(void* param)
+{
+    const uint32_t us = (uint32_t) param;
+    const uint32_t start = clocksource_read();
+
+    while ( clocksource_ticksToUs(clocksource_read() - start) < us );
+}
+
+
+/*
+ * Runs a cyclic executive with 1 ms minor frames and a 4 ms major frame
+ * (driven by timer 1, counter 0) while the application idles, and reports
+ * its statistics as:
+ *
+ *     CYCLIC frames=<minor frames> overruns=<overruns> skipped=<skipped frames> jitter=<max. jitter in us> wcet=<max. execution time of the longest job in us>
+ */
+static void benchCyclic(void)
+{
+    static const cyclicJob jobs[3] =
+    {
+        { &benchCyclicJob, (void*) 100 },
+        { &benchCyclicJob, (void*) 300 },
+        { &benchCyclicJob, (void*) 600 }
+    };
+    static const uint8_t f0[] = { 0, 1 };
+    static const uint8_t f1[] = { 0 };
+    static const uint8_t f2[] = { 0, 2 };
+    static const cyclicFrame frames[4] =
+    {
+        { f0, 2 }, { f1, 1 }, { f2, 2 }, { f1, 1 }
+    };
+    static const cyclicSchedule sched = { jobs, 3, frames, 4, 1000 };
+
+    cyclicStats stats;
+    cyclicJobStats js;
+    uint32_t start;
+
+    pic_init();
+
+    if ( cyclic_init(&sched, 1, 0, 20) < 0 )
+    {
+        uart_print(0, "No cyclic executive\r\n");
+        return;
+    }
+
+    irq_enableIrqMode();
+    cyclic_start();
+
+    start = clocksource_read();
+    while ( clocksource_ticksToUs(clocksource_read() - start) < CYCLIC_BENCH_US );
+
+    cyclic_stop();
+    irq_disableIrqMode();
+    cyclic_getStats(&stats);
+    cyclic_getJobStats(2, &js);
+    pic_init();
+
+    uart_print(0, "CYCLIC");
+    printKeyVal("frames", stats.minorFrames);
+    printKeyVal("overruns", stats.overruns);
+    printKeyVal("skipped", stats.skipped);
+    printKeyVal("jitter", stats.maxJitterUs);
+    printKeyVal("wcet", js.wcetUs);
+    uart_print(0, "\r\n");
+}
+
+
+/* Duration of the EDF dispatcher's benchmark in microseconds: */
+#define EDF_BENCH_US            100000
+
+
+/*
+ * Dispatches three periodic tasks (busy waiting by benchCyclicJob()) with
+ * the total utilization of 0.88 by the EDF dispatcher, whose releases are
+ * checked every 100 us by timer 1, counter 0. Results are reported as:
+ *
+ *     EDF released=<released jobs> completed=<completed jobs> misses=<missed deadlines> dropped=<dropped releases> lateness=<max. lateness in us> util=<measured utilization in per mille>
+ */
+static void benchEdf(void)
+{
+    static const edfTask tasks[3] =
+    {
+        { &benchCyclicJob, (void*) 350, 1000, 0 },
+        { &benchCyclicJob, (void*) 500, 1500, 0 },
+        { &benchCyclicJob, (void*) 600, 3000, 0 }
+    };
+
+    edfStats stats;
+    uint32_t start;
+
+    pic_init();
+
+    if ( edf_init(tasks, 3, 100, 1, 0, 20) < 0 )
+    {
+        uart_print(0, "No EDF dispatcher\r\n");
+        return;
+    }
+
+    irq_enableIrqMode();
+    edf_start();
+
+    start = clocksource_read();
+    while ( clocksource_ticksToUs(clocksource_read() - start) < EDF_BENCH_US )
+    {
+        edf_runNext();
+    }
+
+    edf_stop();
+    irq_disableIrqMode();
+    edf_getStats(&stats);
+    pic_init();
+
+    uart_print(0, "EDF");
+    printKeyVal("released", stats.released);
+    printKeyVal("completed", stats.completed);
+    printKeyVal("misses", stats.misses);
+    printKeyVal("dropped", stats.dropped);
+    printKeyVal("lateness", stats.maxLatenessUs);
+    printKeyVal("util", edf_getUtilization());
+    uart_print(0, "\r\n");
+}
+
+
+/*
+ * ISR of the software interrupt, gives the semaphore.
+ *
+ * @param param - a void* casted pointer to the semaphore
+ */
+static void benchSemISR(void* param)
+{
+    sync_semGive((syncSem*) param);
+    pic_clearSwInterruptNr(BSP_SOFTWARE_IRQ);
+}
+
+
+/*
+ * Overhead of semaphores, without and with waking up by an ISR
+ * (compare to irq_dispatch_nonvect).
+ */
+static void benchSync(void)
+{
+    const uint8_t irq = BSP_SOFTWARE_IRQ;
+    syncSem sem;
+
+    sync_semInit(&sem, 0, 1);
+
+    BENCH("sem_give_take", 64,
+          sync_semGive(&sem); sync_semTake(&sem, SYNC_NO_WAIT) );
+
+    pic_init();
+    pic_registerNonVectoredIrq(irq, &benchSemISR, (void*) &sem, 10);
+    irq_enableIrqMode();
+    pic_enableInterrupt(irq);
+
+    BENCH("sem_wake_swi", 64,
+          pic_setSwInterruptNr(irq); sync_semTake(&sem, SYNC_WAIT_FOREVER) );
+
+    pic_disableInterrupt(irq);
+    irq_disableIrqMode();
+    pic_init();
+}
+
+
+/*
+ * Micro benchmarks of drivers and frequently used functions.
+ * Results are reported as machine readable lines (see bench.h).
+ */
+static void benchTest(void)
+{
+    static uint8_t src[1024];
+    static uint8_t dst[1024];
+    const uint8_t irq = BSP_SOFTWARE_IRQ;
+
+    uart_print(0, "\r\n=Benchmarks:=\r\n\r\n");
+
+    bench_init(0);
+
+    BENCH("timer_read", 64, timer_getValue(0, 0));
+
+    /* UART1 is used to keep the console readable */
+    BENCH("uart_write_char", 64, uart_printChar(1, 'x'));
+    BENCH("uart_write_str16", 32, uart_print(1, "0123456789ABCDEF"));
+
+    BENCH("memcpy_64", 64, memcpy(dst, src, 64));
+    BENCH("memcpy_1k", 32, memcpy(dst, src, 1024));
+    BENCH("memcpy_1k_unaligned", 32, memcpy(dst+1, src, 1023));
+
+    BENCH("ul2dec", 64, bench_ul2dec(strbuf, 0xFFFFFFFF));
+    BENCH("ul2hex", 64, ul2hex(strbuf, 0xDEADBEEF));
+
+    /* IRQ dispatch, i.e. the time from triggering a SW interrupt till its ISR completes */
+    pic_init();
+    pic_registerNonVectoredIrq(irq, &benchSwISR, (void*) &__tick_cntr, 10);
+    irq_enableIrqMode();
+    pic_enableInterrupt(irq);
+
+    BENCH("irq_dispatch_nonvect", 64,
+          __tick_cntr = 0; pic_setSwInterruptNr(irq); while ( 0 == __tick_cntr ) );
+
+    pic_disableInterrupt(irq);
+    pic_init();
+    _pic_set_irq_vector_mode(1);
+    pic_registerVectorIrq(irq, &benchVectSwISR, 10);
+    pic_enableInterrupt(irq);
+
+    BENCH("irq_dispatch_vect", 64,
+          __tick_cntr = 0; pic_setSwInterruptNr(irq); while ( 0 == __tick_cntr ) );
+
+    pic_disableInterrupt(irq);
+    _pic_set_irq_vector_mode(0);
+
+    /* The same via the SIC's cascade, the SIC has its own software interrupt register */
+    pic_init();
+    pic_registerSicIrq(irq, &benchSicSwISR, (void*) &__tick_cntr);
+    pic_enableSicCascade(10);
+    pic_enableSicInterrupt(irq);
+
+    BENCH("irq_dispatch_sic", 64,
+          __tick_cntr = 0; pic_setSicSwInterrupt(irq); while ( 0 == __tick_cntr ) );
+
+    /* Cleanup */
+    pic_disableSicInterrupt(irq);
+    pic_disableSicCascade();
+    irq_disableIrqMode();
+    __tick_cntr = 0;
+
+    /* CPU vs. DMA copying of memory blocks */
+    benchDma();
+
+    /* Single vs. multiple block transfers of the SD card */
+    benchSd();
+
+    /* Erasing and buffered programming of the NOR flash */
+    benchFlash();
+
+    /* Drawing into framebuffers and swapping them */
+    benchClcd();
+
+    /* Round trips to the keyboard via the SIC's cascade */
+    benchKmi();
+
+    /* Masked GPIO writes and edge interrupts */
+    benchGpio();
+
+    /* Polled and queued SPI transfers */
+    benchSsp();
+
+    /* Switching of the UART's receive path between interrupts and polling */
+    benchUartRx();
+
+    /* Responsiveness under an interrupt storm, limited by the PIC */
+    benchIrqStorm();
+
+    /* Frame timing of the cyclic executive */
+    benchCyclic();
+
+    /* Deadline misses of periodic tasks, dispatched by EDF */
+    benchEdf();
+
+    /* Semaphores, given by ISRs */
+    benchSync();
+
+    uart_print(0, "\r\n=Benchmarks completed=\r\n");
+}
+
+
+/*
+ * Starting point of the application.
+ * 
+ * Currently it only executes a few simple test tasks that output
+ * something to the serial port.
+ */ 
+void main(void)
+{
+    uart_init(0);
+
+    uart_print(0, "* * * T E S T   S T A R T * * *\r\n");
+    pmlog_write("test start");
+    
+    timersEnabledTest();
+    
+    /*
+     * Functional tests are traced, the trace is dumped before
+     * the stress test and benchmarks that must not be disturbed by it.
+     * Both the trace and the CPU load accounting are initialized after
+     * the test above, as it (re)initializes all timers, including the clock
+     * if it is based on a SP804 counter (see clocksource.h).
+     */
+    cpuload_init();
+    trace_init();
+    trace_enable();
+    
+    
+    /*
+     * W A R N I N G :
+     * Early versions of Qemu implement vectored IRQ handling improperly. In such a case,
+     * this function MUST NOT BE RUN as wrong ISR routines may be run due ti this bug!
+     *
+     * This defect was fixed at Qemu 1.3 (released in September 2012). More details:
+     * - https://lists.gnu.org/archive/html/qemu-devel/2012-08/msg03354.html
+     * - https://github.com/qemu/qemu/commit/14c126baf1c38607c5bd988878de85a06cefd8cf
+     */
+    trace_marker(1);
+    timerVectIrqTest();
+    
+    trace_marker(2);
+    rtcTest();
+    cpuloadReport();
+    trace_marker(3);
+    swIntTest();
+    
+    trace_disable();
+    trace_dump(0);
+    
+    stressTest();
+    
+    benchTest();
+    
+    pmlog_write("test completed");
+    uart_print(0, "\r\n* * * T E S T   C O M P L E T E D * * *\r\n");
+    
+    /* End in an infinite loop */
+    for ( ; ; )
+    {
+        cpuload_idle();
+    }
 } 
@@ -0,0 +1,122 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of memory block functions.
+ *
+ * When both blocks are word aligned, data are copied in blocks of 4 words
+ * (the compiler typically turns them into LDM/STM instructions), the rest is
+ * copied byte by byte.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mem.h"
+
+
+/**
+ * Copies 'n' bytes from 'src' to 'dst'. The blocks must not overlap.
+ *
+ * @param dst - destination address
+ * @param src - source address
+ * @param n - number of bytes to be copied
+ *
+ * @return 'dst'
+ */
+void* memcpy(void* dst, const void* src, size_t n)
+{
+    uint8_t* d = (uint8_t*) dst;
+    const uint8_t* s = (const uint8_t*) src;
+    uint32_t* dw;
+    const uint32_t* sw;
+
+    if ( 0 == ( ((uint32_t) d | (uint32_t) s) & 0x03 ) )
+    {
+        dw = (uint32_t*) d;
+        sw = (const uint32_t*) s;
+
+        for ( ; n>=16; n-=16 )
+        {
+            dw[0] = sw[0];
+            dw[1] = sw[1];
+            dw[2] = sw[2];
+            dw[3] = sw[3];
+            dw += 4;
+            sw += 4;
+        }
+
+        for ( ; n>=4; n-=4 )
+        {
+            *dw++ = *sw++;
+        }
+
+        d = (uint8_t*) dw;
+        s = (const uint8_t*) sw;
+    }
+
+    for ( ; n>0; --n )
+    {
+        *d++ = *s++;
+    }
+
+    return dst;
+}
+
+
+/**
+ * Fills 'n' bytes at 'dst' with the value of 'c' (converted to an unsigned char).
+ *
+ * @param dst - destination address
+ * @param c - value to be set
+ * @param n - number of bytes to be set
+ *
+ * @return 'dst'
+ */
+void* memset(void* dst, int c, size_t n)
+{
+    uint8_t* d = (uint8_t*) dst;
+    uint32_t* dw;
+    uint32_t w;
+
+    /* Fill the unaligned head byte by byte */
+    for ( ; n>0 && 0!=((uint32_t) d & 0x03); --n )
+    {
+        *d++ = (uint8_t) c;
+    }
+
+    w = (uint8_t) c;
+    w |= w << 8;
+    w |= w << 16;
+
+    for ( dw = (uint32_t*) d; n>=4; n-=4 )
+    {
+        *dw++ = w;
+    }
+
+    for ( d = (uint8_t*) dw; n>0; --n )
+    {
+        *d++ = (uint8_t) c;
+    }
+
+    return dst;
+}
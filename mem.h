@@ -0,0 +1,39 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of memory block functions. The application is not linked
+ * to any standard C library, so the functions are provided here (with
+ * standard names and prototypes as the compiler may also call them).
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _MEM_H_
+#define _MEM_H_
+
+#include <stddef.h>
+
+
+void* memcpy(void* dst, const void* src, size_t n);
+
+void* memset(void* dst, int c, size_t n);
+
+#endif  /* _MEM_H_ */
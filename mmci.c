@@ -0,0 +1,952 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the PL181 multimedia card interface (MMCI) driver
+ * that accesses a SD memory card (SDSC or SDHC) in the 1-bit bus mode.
+ *
+ * Commands are short, so their completion is polled. Data blocks are moved
+ * between the controller's FIFO and the buffer by the driver's ISR (when
+ * the FIFO is half full/empty), the calling task waits in the CPU's low
+ * power state meanwhile. If the IRQ mode is disabled, the FIFO is polled.
+ * Transfers of more than one block use the multiple block commands
+ * (CMD18 and CMD25, terminated by CMD12), so the commands' overhead is
+ * paid once per transfer instead of once per block.
+ *
+ * The PL181's DMA requests are not used as Qemu does not emulate them.
+ *
+ * More info about the board and the controller:
+ * - Versatile Application Baseboard for ARM926EJ-S, HBI 0118 (DUI0225D):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.dui0225d/DUI0225D_versatile_application_baseboard_arm926ej_s_ug.pdf
+ * - ARM PrimeCell Multimedia Card Interface (PL180) Technical Reference Manual (DDI0172):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.ddi0172a/DDI0172.pdf
+ * - SD Specifications, Part 1, Physical Layer Simplified Specification:
+ *   https://www.sdcard.org/downloads/pls/
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "mmci.h"
+#include "interrupt.h"
+#include "clocksource.h"
+#include "cpuload.h"
+
+
+/*
+ * Accesses of the data FIFO: any address within the FIFO's range pops
+ * (or pushes) a word. Status registers are polled between accesses.
+ *
+ * In the host (unit test) build, reads and writes of plain memory have no
+ * side effects, so the simulated controller is notified instead. It also
+ * applies register writes only when notified, so each write into the
+ * (write only) Clear Register is applied before it can be overwritten.
+ */
+#ifdef BSP_HOST_SIM
+extern void sim_sync(void);
+extern uint32_t sim_mmciFifoRead(void);
+extern void sim_mmciFifoWrite(uint32_t val);
+#define SYNC()               sim_sync()
+#define FIFO_READ()          sim_mmciFifoRead()
+#define FIFO_WRITE(VAL)      sim_mmciFifoWrite(VAL)
+#define CLEAR_STATUS(FLAGS)  do { pReg->MCICLEAR = (FLAGS); sim_sync(); } while (0)
+#else
+#define SYNC()
+#define FIFO_READ()          ( pReg->MCIFIFO[0] )
+#define FIFO_WRITE(VAL)      ( pReg->MCIFIFO[0] = (VAL) )
+#define CLEAR_STATUS(FLAGS)  ( pReg->MCICLEAR = (FLAGS) )
+#endif
+
+
+/* Number of words of the data FIFO: */
+#define FIFO_WORDS           16
+
+/* log2 of MMCI_BLOCK_SIZE: */
+#define BLOCK_SHIFT          9
+
+
+/*
+ * Bit masks of the Power Control Register (MCIPower), see page 3-5 of DDI0172:
+ *
+ *   7: Rod (rod control)
+ *   6: OpenDrain (MCICMD output control, used by MMC cards only)
+ *  5:2 output voltage
+ *  1:0 Ctrl (00: power off, 10: power up, 11: power on)
+ */
+#define PWR_ON               0x00000003
+
+
+/*
+ * Bit masks of the Clock Control Register (MCIClock), see page 3-6 of DDI0172:
+ *
+ *   11: wide bus mode (PL181 only)
+ *   10: bypass the divider
+ *    9: power saving (the clock is only enabled when the bus is active)
+ *    8: enable
+ *  7:0 ClkDiv (MCICLK = MCLK / (2*(ClkDiv+1)))
+ *
+ * MCLK of the Versatile baseboard is 24 MHz. Cards are identified
+ * at 400 kHz, data are transferred at 24 MHz (max. 25 MHz by the SD spec).
+ */
+#define CLK_ENABLE           0x00000100
+#define CLK_BYPASS           0x00000400
+#define CLK_DIV_IDENT        29
+
+
+/*
+ * Bit masks of the Command Register (MMCCommand), see page 3-7 of DDI0172:
+ *
+ *   10: enable the command path state machine
+ *    9: wait for the CmdPend signal before sending the command
+ *    8: disable the command timer and wait for an interrupt request
+ *    7: long (136-bit) response
+ *    6: wait for a response
+ *  5:0 command index
+ */
+#define CMD_ENABLE           0x00000400
+#define CMD_LONG_RSP         0x00000080
+#define CMD_RESPONSE         0x00000040
+#define BM_CMD_INDEX         0x0000003F
+
+/* Flags of __command(), the lower ones are equal to the bits above: */
+#define RSP_NONE             0x00000000
+#define RSP_SHORT            CMD_RESPONSE
+#define RSP_LONG             ( CMD_RESPONSE | CMD_LONG_RSP )
+#define RSP_NO_CRC           0x00010000      /* the response is not protected by a CRC (R3) */
+
+
+/*
+ * Bit masks of the Data Control Register (MCIDataCtrl), see page 3-10 of DDI0172:
+ *
+ *  7:4 block size (log2 of the number of bytes)
+ *   3: DMA enable
+ *   2: mode (0: block transfer)
+ *   1: direction (1: from the card to the controller)
+ *   0: enable the data path state machine
+ */
+#define DCTRL_BLOCKSIZE      ( BLOCK_SHIFT << 4 )
+#define DCTRL_DIRECTION      0x00000002
+#define DCTRL_ENABLE         0x00000001
+
+
+/*
+ * Bit masks of the Status Register (MCIStatus), also valid for the
+ * Clear (MCIClear, only bits 10:0) and Mask Registers (MCIMask0/1),
+ * see page 3-12 of DDI0172:
+ */
+#define ST_CMD_CRC_FAIL      0x00000001
+#define ST_DATA_CRC_FAIL     0x00000002
+#define ST_CMD_TIMEOUT       0x00000004
+#define ST_DATA_TIMEOUT      0x00000008
+#define ST_TX_UNDERRUN       0x00000010
+#define ST_RX_OVERRUN        0x00000020
+#define ST_CMD_RESP_END      0x00000040
+#define ST_CMD_SENT          0x00000080
+#define ST_DATA_END          0x00000100
+#define ST_START_BIT_ERR     0x00000200
+#define ST_DATA_BLOCK_END    0x00000400
+#define ST_TX_HALF_EMPTY     0x00004000
+#define ST_RX_HALF_FULL      0x00008000
+#define ST_TX_EMPTY          0x00040000
+
+#define ST_CMD_DONE          ( ST_CMD_CRC_FAIL | ST_CMD_TIMEOUT | ST_CMD_RESP_END | ST_CMD_SENT )
+#define ST_DATA_ERRORS       ( ST_DATA_CRC_FAIL | ST_DATA_TIMEOUT | ST_TX_UNDERRUN | ST_RX_OVERRUN | ST_START_BIT_ERR )
+#define CLEAR_ALL            0x000007FF
+
+
+/* Timeout of data transfers in MCICLK periods (approx. 0.7 s at 24 MHz): */
+#define DATA_TIMEOUT         0x00FFFFFF
+
+
+/* SD commands, used by the driver (ACMD* must be preceded by CMD55): */
+#define CMD_GO_IDLE_STATE            0
+#define CMD_ALL_SEND_CID             2
+#define CMD_SEND_RELATIVE_ADDR       3
+#define CMD_SELECT_CARD              7
+#define CMD_SEND_IF_COND             8
+#define CMD_SEND_CSD                 9
+#define CMD_STOP_TRANSMISSION       12
+#define CMD_SEND_STATUS             13
+#define CMD_SET_BLOCKLEN            16
+#define CMD_READ_SINGLE_BLOCK       17
+#define CMD_READ_MULTIPLE_BLOCK     18
+#define CMD_WRITE_BLOCK             24
+#define CMD_WRITE_MULTIPLE_BLOCK    25
+#define CMD_APP_CMD                 55
+#define ACMD_SD_SEND_OP_COND        41
+
+/* Argument of CMD8: 2.7-3.6 V and the check pattern */
+#define IF_COND_ARG          0x000001AA
+#define BM_IF_COND           0x00000FFF
+
+/* Bits of the OCR register (ACMD41's argument and response): */
+#define OCR_BUSY             0x80000000      /* set when the card's power up is completed */
+#define OCR_HCS              0x40000000      /* host (card) capacity support (status) */
+#define OCR_VOLTAGE          0x00FF8000      /* 2.7-3.6 V */
+
+/*
+ * Bits of the card status (R1 response), see section 4.10.1 of the SD spec:
+ * all error bits, the current state (bits 12:9) and READY_FOR_DATA.
+ */
+#define R1_ERRORS            0xFDF98008
+#define R1_READY_FOR_DATA    0x00000100
+#define R1_STATE_SHIFT       9
+#define BM_R1_STATE          0x0000000F
+#define R1_STATE_TRAN        4
+
+/* Time, the card is given to complete its power up or programming, in ms: */
+#define POWER_UP_TIMEOUT     1000
+#define BUSY_TIMEOUT         1000
+
+
+/*
+ * 32-bit registers of the MMCI,
+ * relative to the controller's base address.
+ * See page 3-3 of DDI0172:
+ */
+typedef struct _ARM926EJS_MMCI_REGS
+{
+    uint32_t MCIPOWER;                   /* Power Control Register */
+    uint32_t MCICLOCK;                   /* Clock Control Register */
+    uint32_t MCIARGUMENT;                /* Argument Register */
+    uint32_t MCICOMMAND;                 /* Command Register */
+    const uint32_t MCIRESPCMD;           /* Response Command Register, read only */
+    const uint32_t MCIRESPONSE[4];       /* Response Registers, read only */
+    uint32_t MCIDATATIMER;               /* Data Timer Register */
+    uint32_t MCIDATALENGTH;              /* Data Length Register */
+    uint32_t MCIDATACTRL;                /* Data Control Register */
+    const uint32_t MCIDATACNT;           /* Data Counter Register, read only */
+    const uint32_t MCISTATUS;            /* Status Register, read only */
+    uint32_t MCICLEAR;                   /* Clear Register, write only */
+    uint32_t MCIMASK0;                   /* Interrupt 0 Mask Register */
+    uint32_t MCIMASK1;                   /* Interrupt 1 Mask Register */
+    const uint32_t Reserved1;            /* Reserved, should not be modified */
+    const uint32_t MCIFIFOCNT;           /* FIFO Counter Register, read only */
+    const uint32_t Reserved2[13];        /* Reserved, should not be modified */
+    uint32_t MCIFIFO[FIFO_WORDS];        /* Data FIFO Register */
+    const uint32_t Reserved3[968];       /* Reserved, should not be modified */
+    const uint32_t MCIPERIPHID[4];       /* Peripheral Identification Registers, read only */
+    const uint32_t MCIPCELLID[4];        /* PrimeCell Identification Registers, read only */
+} ARM926EJS_MMCI_REGS;
+
+/*
+ * Pointer to the MMCI's base address:
+ */
+static volatile ARM926EJS_MMCI_REGS* const pReg = (ARM926EJS_MMCI_REGS*) (BSP_MMCI_BASE_ADDRESS);
+
+
+/* States of a data transfer: */
+#define XFER_IDLE            0
+#define XFER_BUSY            1
+#define XFER_DONE            2
+#define XFER_ERROR           3
+
+/* State of the current data transfer, shared with the ISR: */
+typedef struct _mmciXfer
+{
+    uint8_t* buf;                    /* next byte of the buffer */
+    uint32_t remaining;              /* words, not transferred via the FIFO yet */
+    uint8_t read;                    /* nonzero if data are read from the card */
+    uint8_t aligned;                 /* nonzero if 'buf' is word aligned */
+    volatile uint8_t state;          /* one of XFER_* */
+} mmciXfer;
+
+static mmciXfer __xfer;
+
+
+/* Properties of the initialized card: */
+static int8_t __cardReady = 0;
+static int8_t __highCapacity = 0;    /* blocks are addressed by their numbers instead of bytes */
+static uint32_t __rca = 0;           /* relative card address, shifted into the upper half */
+static uint32_t __nrBlocks = 0;
+
+
+/*
+ * Sends a command and polls its completion.
+ *
+ * @param idx - command index
+ * @param arg - command's argument
+ * @param flags - expected response (one of RSP_NONE, RSP_SHORT, RSP_LONG), optionally RSP_NO_CRC
+ * @param resp - buffer for the response (1 word for short, 4 words for long responses, may be NULL)
+ *
+ * @return MMCI_OK, MMCI_ERR_TIMEOUT if the card did not respond, MMCI_ERR_CMD on a CRC error
+ */
+static int8_t __command(uint8_t idx, uint32_t arg, uint32_t flags, uint32_t* resp)
+{
+    uint32_t status;
+    uint8_t i;
+
+    CLEAR_STATUS(ST_CMD_DONE);
+    pReg->MCIARGUMENT = arg;
+    pReg->MCICOMMAND = (idx & BM_CMD_INDEX) | (flags & RSP_LONG) | CMD_ENABLE;
+
+    /* The command path state machine always ends with one of these flags */
+    do
+    {
+        SYNC();
+        status = pReg->MCISTATUS;
+    }
+    while ( 0 == (status & ST_CMD_DONE) );
+
+    CLEAR_STATUS(ST_CMD_DONE);
+
+    if ( status & ST_CMD_TIMEOUT )
+    {
+        return MMCI_ERR_TIMEOUT;
+    }
+
+    if ( (status & ST_CMD_CRC_FAIL) && 0 == (flags & RSP_NO_CRC) )
+    {
+        return MMCI_ERR_CMD;
+    }
+
+    if ( NULL != resp && (flags & CMD_RESPONSE) )
+    {
+        for ( i=0; i < ( (flags & CMD_LONG_RSP) ? 4 : 1 ); ++i )
+        {
+            resp[i] = pReg->MCIRESPONSE[i];
+        }
+    }
+
+    return MMCI_OK;
+}
+
+
+/*
+ * Sends a command with a R1 response (the card status) and checks
+ * the status for errors.
+ *
+ * @param idx - command index
+ * @param arg - command's argument
+ * @param status - the card status is written here (may be NULL)
+ *
+ * @return MMCI_OK, MMCI_ERR_TIMEOUT or MMCI_ERR_CMD
+ */
+static int8_t __commandR1(uint8_t idx, uint32_t arg, uint32_t* status)
+{
+    uint32_t r1;
+    int8_t rc;
+
+    rc = __command(idx, arg, RSP_SHORT, &r1);
+    if ( MMCI_OK != rc )
+    {
+        return rc;
+    }
+
+    if ( NULL != status )
+    {
+        *status = r1;
+    }
+
+    return ( 0 == (r1 & R1_ERRORS) ? MMCI_OK : MMCI_ERR_CMD );
+}
+
+
+/*
+ * @param start - clock value at the start of a wait
+ * @param ms - timeout in milliseconds
+ *
+ * @return a nonzero value (typically 1) if more than 'ms' milliseconds elapsed since 'start'
+ */
+static int8_t __isTimeout(uint32_t start, uint32_t ms)
+{
+    return ( clocksource_read() - start > ms * (clocksource_getFrequency() / 1000) ? 1 : 0 );
+}
+
+
+/*
+ * Waits until the card completes programming of written data
+ * and returns into the transfer state.
+ *
+ * @return MMCI_OK, MMCI_ERR_TIMEOUT if the card remains busy or does not respond, MMCI_ERR_CMD on errors
+ */
+static int8_t __waitReady(void)
+{
+    const uint32_t start = clocksource_read();
+    uint32_t status;
+    int8_t rc;
+
+    for ( ; ; )
+    {
+        rc = __commandR1(CMD_SEND_STATUS, __rca, &status);
+        if ( MMCI_OK != rc )
+        {
+            return rc;
+        }
+
+        if ( (status & R1_READY_FOR_DATA) &&
+             R1_STATE_TRAN == ((status >> R1_STATE_SHIFT) & BM_R1_STATE) )
+        {
+            return MMCI_OK;
+        }
+
+        if ( __isTimeout(start, BUSY_TIMEOUT) )
+        {
+            return MMCI_ERR_TIMEOUT;
+        }
+    }
+}
+
+
+/*
+ * Extracts a field of the CSD register from a long response.
+ * MCIResponse0 contains bits 127:96 of the CSD, MCIResponse3 bits 31:0.
+ *
+ * @param csd - long response to CMD9
+ * @param lsb - the field's lowest bit
+ * @param width - number of the field's bits (max. 32)
+ *
+ * @return value of the field
+ */
+static uint32_t __csdField(const uint32_t* csd, uint8_t lsb, uint8_t width)
+{
+    uint32_t val = 0;
+    uint8_t bit;
+
+    for ( bit = lsb + width; bit > lsb; --bit )
+    {
+        val = (val << 1) | ( (csd[3 - ((bit-1) >> 5)] >> ((bit-1) & 0x1F)) & 0x01 );
+    }
+
+    return val;
+}
+
+
+/*
+ * Moves data from the FIFO into the buffer. The number of words in the FIFO
+ * equals the number of words remaining to be read minus the number of words
+ * that have not been received into the FIFO yet (MCIFifoCnt).
+ */
+static void __readFifo(void)
+{
+    uint32_t n;
+    uint32_t w;
+
+    while ( __xfer.remaining > 0 )
+    {
+        n = __xfer.remaining - pReg->MCIFIFOCNT;
+        if ( 0 == n || n > FIFO_WORDS )
+        {
+            break;  /* out of while */
+        }
+
+        __xfer.remaining -= n;
+
+        if ( __xfer.aligned )
+        {
+            for ( ; n>0; --n, __xfer.buf += 4 )
+            {
+                *( (uint32_t*) __xfer.buf ) = FIFO_READ();
+            }
+        }
+        else
+        {
+            for ( ; n>0; --n )
+            {
+                w = FIFO_READ();
+                *(__xfer.buf++) = (uint8_t) w;
+                *(__xfer.buf++) = (uint8_t) (w >> 8);
+                *(__xfer.buf++) = (uint8_t) (w >> 16);
+                *(__xfer.buf++) = (uint8_t) (w >> 24);
+            }
+        }
+    }
+}
+
+
+/*
+ * Moves data from the buffer into the FIFO, as long as it is at least half empty.
+ */
+static void __writeFifo(void)
+{
+    uint32_t status;
+    uint32_t n;
+    uint32_t w;
+
+    while ( __xfer.remaining > 0 )
+    {
+        status = pReg->MCISTATUS;
+        if ( status & ST_TX_EMPTY )
+        {
+            n = FIFO_WORDS;
+        }
+        else if ( status & ST_TX_HALF_EMPTY )
+        {
+            n = FIFO_WORDS / 2;
+        }
+        else
+        {
+            break;  /* out of while */
+        }
+
+        n = ( n < __xfer.remaining ? n : __xfer.remaining );
+        __xfer.remaining -= n;
+
+        if ( __xfer.aligned )
+        {
+            for ( ; n>0; --n, __xfer.buf += 4 )
+            {
+                FIFO_WRITE( *( (const uint32_t*) __xfer.buf ) );
+            }
+        }
+        else
+        {
+            for ( ; n>0; --n, __xfer.buf += 4 )
+            {
+                w = (uint32_t) __xfer.buf[0] | ( (uint32_t) __xfer.buf[1] << 8 ) |
+                    ( (uint32_t) __xfer.buf[2] << 16 ) | ( (uint32_t) __xfer.buf[3] << 24 );
+                FIFO_WRITE(w);
+            }
+        }
+    }
+}
+
+
+/*
+ * Services the data path: moves data between the FIFO and the buffer and
+ * detects the end of the transfer. Called by the ISR or, when the IRQ mode
+ * is disabled, directly by the waiting task.
+ */
+static void __service(void)
+{
+    if ( XFER_BUSY != __xfer.state )
+    {
+        /* Nothing to do, just make sure the controller does not trigger IRQs anymore */
+        pReg->MCIMASK0 = 0;
+        return;
+    }
+
+    if ( pReg->MCISTATUS & ST_DATA_ERRORS )
+    {
+        pReg->MCIMASK0 = 0;
+        __xfer.state = XFER_ERROR;
+        return;
+    }
+
+    if ( __xfer.read )
+    {
+        __readFifo();
+    }
+    else
+    {
+        __writeFifo();
+    }
+
+    if ( 0 == __xfer.remaining )
+    {
+        /* Only the end of the transfer (or an error) is waited for */
+        pReg->MCIMASK0 = ST_DATA_END | ST_DATA_ERRORS;
+
+        if ( pReg->MCISTATUS & ST_DATA_END )
+        {
+            pReg->MCIMASK0 = 0;
+            __xfer.state = XFER_DONE;
+        }
+    }
+}
+
+
+/*
+ * ISR, triggered by the MMCI when its FIFO is half full (half empty),
+ * a data transfer completes or fails.
+ *
+ * @param param - unused
+ */
+static void __mmciIsr(void* param)
+{
+    __service();
+}
+
+
+/*
+ * Waits until the current data transfer completes.
+ *
+ * If the IRQ mode is enabled, the CPU waits in its low power state. The
+ * state is checked with the IRQ mode disabled, so an IRQ that completes
+ * the transfer cannot be serviced between the check and the wait (the
+ * CPU is woken by the pending IRQ and services it afterwards).
+ */
+static void __waitTransfer(void)
+{
+    if ( 0 == irq_isIrqModeEnabled() )
+    {
+        while ( XFER_BUSY == __xfer.state )
+        {
+            SYNC();
+            __service();
+        }
+
+        return;
+    }
+
+    for ( ; ; )
+    {
+        irq_disableIrqMode();
+
+        if ( XFER_BUSY != __xfer.state )
+        {
+            break;  /* out of for */
+        }
+
+        cpuload_idle();
+        irq_enableIrqMode();
+    }
+
+    irq_enableIrqMode();
+}
+
+
+/*
+ * Transfers blocks between the card and the buffer.
+ *
+ * @param block - number of the first block
+ * @param buf - buffer
+ * @param count - number of blocks (between 1 and MMCI_MAX_BLOCKS)
+ * @param read - nonzero to read from the card, 0 to write to it
+ *
+ * @return MMCI_OK or one of MMCI_ERR_*
+ */
+static int8_t __transfer(uint32_t block, uint8_t* buf, uint32_t count, uint8_t read)
+{
+    const uint32_t addr = ( __highCapacity ? block : block << BLOCK_SHIFT );
+    uint8_t cmd;
+    int8_t rc;
+    int8_t rcStop;
+
+    if ( 0 == __cardReady )
+    {
+        return MMCI_ERR_PARAM;
+    }
+
+    if ( NULL == buf || 0 == count || count > MMCI_MAX_BLOCKS ||
+         block >= __nrBlocks || count > __nrBlocks - block )
+    {
+        return MMCI_ERR_PARAM;
+    }
+
+    __xfer.buf = buf;
+    __xfer.remaining = count << (BLOCK_SHIFT - 2);
+    __xfer.read = read;
+    __xfer.aligned = ( 0 == ((uint32_t) buf & 0x03) ? 1 : 0 );
+    __xfer.state = XFER_BUSY;
+
+    pReg->MCIMASK0 = 0;
+    CLEAR_STATUS(CLEAR_ALL);
+    pReg->MCIDATATIMER = DATA_TIMEOUT;
+    pReg->MCIDATALENGTH = count << BLOCK_SHIFT;
+
+    /*
+     * When reading, the data path must wait for the card's data before the
+     * command is sent. When writing, the FIFO is only filled after the card
+     * has accepted the command.
+     */
+    if ( read )
+    {
+        pReg->MCIDATACTRL = DCTRL_BLOCKSIZE | DCTRL_DIRECTION | DCTRL_ENABLE;
+        cmd = ( count > 1 ? CMD_READ_MULTIPLE_BLOCK : CMD_READ_SINGLE_BLOCK );
+        rc = __commandR1(cmd, addr, NULL);
+    }
+    else
+    {
+        cmd = ( count > 1 ? CMD_WRITE_MULTIPLE_BLOCK : CMD_WRITE_BLOCK );
+        rc = __commandR1(cmd, addr, NULL);
+        if ( MMCI_OK == rc )
+        {
+            pReg->MCIDATACTRL = DCTRL_BLOCKSIZE | DCTRL_ENABLE;
+        }
+    }
+
+    if ( MMCI_OK != rc )
+    {
+        pReg->MCIDATACTRL = 0;
+        __xfer.state = XFER_IDLE;
+        return rc;
+    }
+
+    pReg->MCIMASK0 = ( read ? ST_RX_HALF_FULL : ST_TX_HALF_EMPTY ) | ST_DATA_END | ST_DATA_ERRORS;
+
+    __waitTransfer();
+
+    rc = ( XFER_DONE == __xfer.state ? MMCI_OK : MMCI_ERR_DATA );
+    __xfer.state = XFER_IDLE;
+
+    pReg->MCIMASK0 = 0;
+    pReg->MCIDATACTRL = 0;
+    CLEAR_STATUS(CLEAR_ALL);
+
+    /* Multiple block transfers are terminated by CMD12, also when they fail */
+    if ( count > 1 )
+    {
+        rcStop = __commandR1(CMD_STOP_TRANSMISSION, 0, NULL);
+        rc = ( MMCI_OK == rc ? rcStop : rc );
+    }
+
+    /* The card is busy while it programs written data */
+    if ( 0 == read )
+    {
+        rcStop = __waitReady();
+        rc = ( MMCI_OK == rc ? rcStop : rc );
+    }
+
+    return rc;
+}
+
+
+/**
+ * Initializes the MMCI: the controller is powered on, its clock is set
+ * to the identification frequency, all interrupts are masked and its ISR
+ * is registered (as a nonvectored IRQ) and enabled at the interrupt
+ * controller (including the SIC's pass-through).
+ *
+ * The card must be initialized by mmci_initCard() afterwards.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param priority - priority of the MMCI's IRQ (see pic_registerNonVectoredIrq())
+ *
+ * @return MMCI_OK on success, MMCI_ERR_PARAM if the ISR could not be registered
+ */
+int8_t mmci_init(uint8_t priority)
+{
+    __cardReady = 0;
+    __highCapacity = 0;
+    __rca = 0;
+    __nrBlocks = 0;
+    __xfer.state = XFER_IDLE;
+
+    clocksource_init();
+
+    pReg->MCIMASK0 = 0;
+    pReg->MCIMASK1 = 0;
+    pReg->MCIDATACTRL = 0;
+    pReg->MCICOMMAND = 0;
+    CLEAR_STATUS(CLEAR_ALL);
+
+    pReg->MCIPOWER = PWR_ON;
+    pReg->MCICLOCK = CLK_ENABLE | CLK_DIV_IDENT;
+
+    if ( pic_registerNonVectoredIrq(BSP_MMCI_IRQ, &__mmciIsr, NULL, priority) < 0 )
+    {
+        return MMCI_ERR_PARAM;
+    }
+
+    pic_enableSicPassThrough(BSP_MMCI_IRQ);
+    pic_enableInterrupt(BSP_MMCI_IRQ);
+
+    return MMCI_OK;
+}
+
+
+/**
+ * Identifies and initializes the inserted SD card (see section 4.2 of the
+ * SD spec): the card is reset, its operating conditions are negotiated,
+ * its relative address and capacity are obtained, it is selected and
+ * the block length is set to MMCI_BLOCK_SIZE. Finally the clock is
+ * switched to the data transfer frequency.
+ *
+ * @return MMCI_OK on success, MMCI_ERR_TIMEOUT if no card responds, another MMCI_ERR_* otherwise
+ */
+int8_t mmci_initCard(void)
+{
+    uint32_t resp[4];
+    uint32_t hcs = 0;
+    uint32_t start;
+    uint32_t shift;
+    int8_t rc;
+
+    __cardReady = 0;
+    pReg->MCICLOCK = CLK_ENABLE | CLK_DIV_IDENT;
+
+    __command(CMD_GO_IDLE_STATE, 0, RSP_NONE, NULL);
+
+    /* Only cards, compliant with the version 2.00 or later, respond to CMD8 */
+    rc = __command(CMD_SEND_IF_COND, IF_COND_ARG, RSP_SHORT, resp);
+    if ( MMCI_OK == rc )
+    {
+        if ( IF_COND_ARG != (resp[0] & BM_IF_COND) )
+        {
+            return MMCI_ERR_CARD;
+        }
+
+        hcs = OCR_HCS;
+    }
+
+    /* Repeat ACMD41 until the card completes its power up */
+    start = clocksource_read();
+    for ( ; ; )
+    {
+        /* The status may report CMD8 as illegal (version 1.x cards), so it is not checked */
+        rc = __command(CMD_APP_CMD, 0, RSP_SHORT, NULL);
+        if ( MMCI_OK != rc )
+        {
+            return rc;
+        }
+
+        rc = __command(ACMD_SD_SEND_OP_COND, OCR_VOLTAGE | hcs, RSP_SHORT | RSP_NO_CRC, resp);
+        if ( MMCI_OK != rc )
+        {
+            return rc;
+        }
+
+        if ( resp[0] & OCR_BUSY )
+        {
+            break;  /* out of for */
+        }
+
+        if ( __isTimeout(start, POWER_UP_TIMEOUT) )
+        {
+            return MMCI_ERR_TIMEOUT;
+        }
+    }
+
+    __highCapacity = ( (resp[0] & OCR_HCS) ? 1 : 0 );
+
+    rc = __command(CMD_ALL_SEND_CID, 0, RSP_LONG, resp);
+    if ( MMCI_OK != rc )
+    {
+        return rc;
+    }
+
+    /* R6 response: the RCA is in the upper half */
+    rc = __command(CMD_SEND_RELATIVE_ADDR, 0, RSP_SHORT, resp);
+    if ( MMCI_OK != rc )
+    {
+        return rc;
+    }
+    __rca = resp[0] & 0xFFFF0000;
+
+    rc = __command(CMD_SEND_CSD, __rca, RSP_LONG, resp);
+    if ( MMCI_OK != rc )
+    {
+        return rc;
+    }
+
+    /* See section 5.3 of the SD spec */
+    switch ( __csdField(resp, 126, 2) )
+    {
+        case 0:
+            /* CSD version 1.0: (C_SIZE+1) * 2^(C_SIZE_MULT+2) blocks of 2^READ_BL_LEN bytes */
+            shift = __csdField(resp, 47, 3) + 2 + __csdField(resp, 80, 4);
+            if ( shift < BLOCK_SHIFT )
+            {
+                return MMCI_ERR_CARD;
+            }
+            __nrBlocks = (__csdField(resp, 62, 12) + 1) << (shift - BLOCK_SHIFT);
+            break;
+
+        case 1:
+            /* CSD version 2.0: (C_SIZE+1) * 512 kB */
+            __nrBlocks = (__csdField(resp, 48, 22) + 1) << 10;
+            break;
+
+        default:
+            return MMCI_ERR_CARD;
+    }
+
+    rc = __commandR1(CMD_SELECT_CARD, __rca, NULL);
+    if ( MMCI_OK == rc )
+    {
+        rc = __waitReady();
+    }
+    if ( MMCI_OK != rc )
+    {
+        return rc;
+    }
+
+    /* Ignored by high capacity cards, their block length is always 512 bytes */
+    rc = __commandR1(CMD_SET_BLOCKLEN, MMCI_BLOCK_SIZE, NULL);
+    if ( MMCI_OK != rc )
+    {
+        return rc;
+    }
+
+    pReg->MCICLOCK = CLK_ENABLE | CLK_BYPASS;
+    __cardReady = 1;
+
+    return MMCI_OK;
+}
+
+
+/**
+ * @return a nonzero value (typically 1) if the card has been initialized, 0 otherwise
+ */
+int8_t mmci_isCardReady(void)
+{
+    return __cardReady;
+}
+
+
+/**
+ * @return capacity of the card in blocks (of MMCI_BLOCK_SIZE bytes), 0 if the card is not initialized
+ */
+uint32_t mmci_getNrBlocks(void)
+{
+    return ( __cardReady ? __nrBlocks : 0 );
+}
+
+
+/**
+ * @return a nonzero value (typically 1) for high capacity (SDHC) cards, 0 otherwise
+ */
+int8_t mmci_isHighCapacity(void)
+{
+    return __highCapacity;
+}
+
+
+/**
+ * Reads consecutive blocks from the card. More than one block is read by
+ * a single multiple block command.
+ *
+ * The buffer need not be word aligned, but aligned buffers are faster.
+ *
+ * @param block - number of the first block
+ * @param buf - buffer (at least count*MMCI_BLOCK_SIZE bytes)
+ * @param count - number of blocks (between 1 and MMCI_MAX_BLOCKS)
+ *
+ * @return MMCI_OK on success, one of MMCI_ERR_* otherwise
+ */
+int8_t mmci_readBlocks(uint32_t block, void* buf, uint32_t count)
+{
+    return __transfer(block, (uint8_t*) buf, count, 1);
+}
+
+
+/**
+ * Writes consecutive blocks to the card. More than one block is written by
+ * a single multiple block command. The function returns when the card
+ * completes programming of the blocks.
+ *
+ * The buffer need not be word aligned, but aligned buffers are faster.
+ *
+ * @param block - number of the first block
+ * @param buf - buffer (at least count*MMCI_BLOCK_SIZE bytes)
+ * @param count - number of blocks (between 1 and MMCI_MAX_BLOCKS)
+ *
+ * @return MMCI_OK on success, one of MMCI_ERR_* otherwise
+ */
+int8_t mmci_writeBlocks(uint32_t block, const void* buf, uint32_t count)
+{
+    return __transfer(block, (uint8_t*) buf, count, 0);
+}
@@ -0,0 +1,64 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions of the PL181 multimedia card interface
+ * (MMCI) driver that accesses a SD memory card.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _MMCI_H_
+#define _MMCI_H_
+
+#include <stdint.h>
+
+
+/* Size of a data block in bytes: */
+#define MMCI_BLOCK_SIZE           512
+
+/* Max. number of blocks, transferred by a single command (limited by the 16-bit MCIDataLength): */
+#define MMCI_MAX_BLOCKS           127
+
+
+/* Return values of mmci_* functions: */
+#define MMCI_OK                   0
+#define MMCI_ERR_PARAM           -1    /* invalid parameter or the card is not initialized */
+#define MMCI_ERR_TIMEOUT         -2    /* the card did not respond (e.g. no card is inserted) */
+#define MMCI_ERR_CMD             -3    /* a command failed (CRC error or an error reported by the card) */
+#define MMCI_ERR_DATA            -4    /* a data transfer failed (CRC error, timeout, FIFO under/overrun) */
+#define MMCI_ERR_CARD            -5    /* the card is not supported */
+
+
+int8_t mmci_init(uint8_t priority);
+
+int8_t mmci_initCard(void);
+
+int8_t mmci_isCardReady(void);
+
+uint32_t mmci_getNrBlocks(void);
+
+int8_t mmci_isHighCapacity(void);
+
+int8_t mmci_readBlocks(uint32_t block, void* buf, uint32_t count);
+
+int8_t mmci_writeBlocks(uint32_t block, const void* buf, uint32_t count);
+
+#endif  /* _MMCI_H_ */
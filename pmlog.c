@@ -0,0 +1,257 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the persistent post-mortem log buffer.
+ *
+ * The last PMLOG_NR_RECORDS log records are kept in a ring, placed into the
+ * section .noinit (see qemu.ld) that is not touched by the startup code, so
+ * the records survive a warm (e.g. watchdog) reset. The ring's header and each
+ * record are protected by a magic number and CRC checksums.
+ *
+ * At the next boot, pmlog_init() validates the ring and emits the previous boot's
+ * records and a crash dump (if available) before the ring is reused.
+ *
+ * @note The log is not protected against concurrent writes, pmlog_write() should
+ * not be called from ISRs if it can also be called from a task.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "pmlog.h"
+#include "crash.h"
+#include "crc.h"
+#include "uart.h"
+
+
+/* A "signature" of a valid header: */
+#define PMLOG_MAGIC         0x504D4C47
+
+/* PMLOG_NR_RECORDS must be a power of 2, so the record's index is obtained by masking: */
+#define BM_IDX              ( PMLOG_NR_RECORDS - 1 )
+
+#if ( 0 != (PMLOG_NR_RECORDS & BM_IDX) )
+#error PMLOG_NR_RECORDS must be a power of 2
+#endif
+
+
+/*
+ * Header of the ring. Sequence numbers are never reset, so records of
+ * previous boots can never be mistaken for the current ones.
+ */
+typedef struct _pmlogHeader
+{
+    uint32_t magic;                      /* PMLOG_MAGIC if the header is valid */
+    uint32_t crc;                        /* CRC-32 of all subsequent fields */
+    uint32_t bootCount;                  /* number of boots since the last cold boot */
+    uint32_t firstSeq;                   /* sequence number of the first record of this boot */
+    uint32_t nextSeq;                    /* sequence number of the next record */
+} pmlogHeader;
+
+
+/*
+ * A log record, its index within the ring equals 'seq & BM_IDX'.
+ */
+typedef struct _pmlogRecord
+{
+    uint32_t seq;                        /* sequence number of the record */
+    uint32_t crc;                        /* CRC-32 of 'text' and 'seq' */
+    char text[PMLOG_RECORD_LEN];         /* text of the record, zero terminated and padded */
+} pmlogRecord;
+
+
+/* Both structures are placed into the section that is never initialized (see qemu.ld): */
+static pmlogHeader __hdr __attribute__((section(".noinit")));
+static pmlogRecord __rec[PMLOG_NR_RECORDS] __attribute__((section(".noinit")));
+
+
+/*
+ * @param rec - pointer to a record
+ *
+ * @return CRC-32 checksum of the record's sequence number and text
+ */
+static inline uint32_t __recordCrc(const pmlogRecord* rec)
+{
+    return crc32( crc32(CRC32_INIT, &(rec->seq), sizeof(uint32_t)),
+                  rec->text, PMLOG_RECORD_LEN );
+}
+
+
+/*
+ * Updates the header's checksum and marks it as valid.
+ * Must be called after each modification of the header.
+ */
+static inline void __sealHeader(void)
+{
+    __hdr.magic = PMLOG_MAGIC;
+    __hdr.crc = crc32(CRC32_INIT, &(__hdr.bootCount), sizeof(pmlogHeader) - 2*sizeof(uint32_t) );
+}
+
+
+/*
+ * @return a nonzero value (typically 1) if the header is valid, 0 otherwise
+ */
+static int8_t __isHeaderValid(void)
+{
+    return ( PMLOG_MAGIC == __hdr.magic &&
+             __hdr.crc == crc32(CRC32_INIT, &(__hdr.bootCount), sizeof(pmlogHeader) - 2*sizeof(uint32_t)) &&
+             (__hdr.nextSeq - __hdr.firstSeq) <= 0x7FFFFFFF ? 1 : 0 );
+}
+
+
+/*
+ * Outputs all valid records of the boot, described by the header, to the specified UART.
+ * Records with invalid checksums or unexpected sequence numbers are skipped.
+ *
+ * As the function is "private", it trusts its caller functions that the header is valid.
+ *
+ * @param uart - number of the UART (between 0 and 2)
+ */
+static void __printRecords(uint8_t uart)
+{
+    uint32_t seq;
+    const pmlogRecord* rec;
+
+    /* Older records have already been overwritten */
+    seq = __hdr.firstSeq;
+    if ( (__hdr.nextSeq - seq) > PMLOG_NR_RECORDS )
+    {
+        seq = __hdr.nextSeq - PMLOG_NR_RECORDS;
+        uart_print(uart, "  ...\r\n");
+    }
+
+    for ( ; seq != __hdr.nextSeq; ++seq )
+    {
+        rec = &__rec[seq & BM_IDX];
+
+        if ( seq == rec->seq && rec->crc == __recordCrc(rec) )
+        {
+            uart_print(uart, "  ");
+            uart_print(uart, rec->text);
+            uart_print(uart, "\r\n");
+        }
+    }
+}
+
+
+/**
+ * Validates the post-mortem buffer, left by the previous boot, emits its records
+ * and a crash dump (if either of them is valid) to the specified UART and prepares
+ * the buffer for the current boot.
+ *
+ * The function should be called at startup, after the UART has been initialized
+ * and before anything else is logged.
+ *
+ * @param uart - number of the UART (between 0 and 2) where the previous boot's data are emitted
+ */
+void pmlog_init(uint8_t uart)
+{
+    if ( __isHeaderValid() )
+    {
+        uart_print(uart, "\r\n*** POST-MORTEM LOG OF THE PREVIOUS BOOT ***\r\n");
+        __printRecords(uart);
+        uart_print(uart, "*** END OF POST-MORTEM LOG ***\r\n");
+    }
+    else
+    {
+        /* A cold boot or a corrupted header, start from scratch */
+        __hdr.bootCount = 0;
+        __hdr.nextSeq = 0;
+    }
+
+    if ( crash_isDumpValid() )
+    {
+        crash_printDump(uart);
+        crash_clearDump();
+    }
+
+    /* Records of previous boots are still there but will not be emitted anymore */
+    ++__hdr.bootCount;
+    __hdr.firstSeq = __hdr.nextSeq;
+    __sealHeader();
+}
+
+
+/**
+ * Appends a record to the post-mortem buffer. The oldest record is
+ * overwritten when the buffer is full.
+ *
+ * Texts, longer than PMLOG_RECORD_LEN-1 characters, are truncated.
+ * Nothing is done if 'str' is NULL.
+ *
+ * @param str - text of the record, must be '\0' terminated
+ */
+void pmlog_write(const char* str)
+{
+    pmlogRecord* rec;
+    uint8_t i;
+
+    if ( NULL == str )
+    {
+        return;
+    }
+
+    rec = &__rec[__hdr.nextSeq & BM_IDX];
+
+    /* Copy the text, the rest of the record is padded by zeros */
+    for ( i=0; i<PMLOG_RECORD_LEN-1 && '\0'!=str[i]; ++i )
+    {
+        rec->text[i] = str[i];
+    }
+
+    for ( ; i<PMLOG_RECORD_LEN; ++i )
+    {
+        rec->text[i] = '\0';
+    }
+
+    /*
+     * The record is completed before the header is updated. If a reset occurs
+     * in between, the record is just lost, the buffer remains consistent.
+     */
+    rec->seq = __hdr.nextSeq;
+    rec->crc = __recordCrc(rec);
+
+    ++__hdr.nextSeq;
+    __sealHeader();
+}
+
+
+/**
+ * @return number of boots since the last cold boot (1 after a cold boot)
+ */
+uint32_t pmlog_getBootCount(void)
+{
+    return __hdr.bootCount;
+}
+
+
+/**
+ * Outputs all records of the current boot, still available in the
+ * post-mortem buffer, to the specified UART.
+ *
+ * @param uart - number of the UART (between 0 and 2)
+ */
+void pmlog_print(uint8_t uart)
+{
+    __printRecords(uart);
+}
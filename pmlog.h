@@ -0,0 +1,49 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions that handle the persistent
+ * post-mortem log buffer.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _PMLOG_H_
+#define _PMLOG_H_
+
+#include <stdint.h>
+
+
+/* Number of log records, kept in the ring: */
+#define PMLOG_NR_RECORDS       32
+
+/* Max. length of a log record's text (including the zero terminator): */
+#define PMLOG_RECORD_LEN       56
+
+
+void pmlog_init(uint8_t uart);
+
+void pmlog_write(const char* str);
+
+uint32_t pmlog_getBootCount(void);
+
+void pmlog_print(uint8_t uart);
+
+#endif  /* _PMLOG_H_ */
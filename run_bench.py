@@ -0,0 +1,387 @@
+#!/usr/bin/env python3
+#
+# Copyright 2013, Jernej Kovacic
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Usage: run_bench.py [options] [image_file]
+
+Boots the firmware image (image.bin by default) in "qemu-system-arm -M versatilepb"
+without any human interaction and collects benchmark results.
+
+- Qemu is run with "-icount", so the emulated time depends on the number of executed
+  instructions only and timings are deterministic.
+- The board's UART0 is captured into a file (bench_output.txt by default).
+- Qemu is terminated as soon as the test application prints its "test completed"
+  marker, or when it exits by itself (e.g. via semihosting SYS_EXIT when run with
+  --semihosting), or when the timeout expires.
+- All "BENCH name=... key=value ..." lines (see bench.h) are parsed into a JSON
+  report (bench_report.json by default).
+- Maximum sustainable interrupt rates, reported by the interrupt stress test
+  ("STRESS mode=... max_rate=..."), are added to the report for information,
+  as well as the CPU load report ("CPULOAD load_1s=... load_10s=...", in per mille)
+  and the block size where DMA copying beats the CPU ("DMACOPY crossover=...").
+- A raw SD card image (sd.img by default) is attached to the board's MMCI. If it
+  does not exist, a zero filled image (16 MB) is created. The card's capacity and
+  the result of its write/read back check ("SD blocks=...", "SDCHECK ok=...") are
+  added to the report, a failed check is treated as a failed run.
+- A raw NOR flash image (flash.img by default, 64 MB) is attached to the board's
+  flash bank and created if it does not exist. Its geometry and the result of its
+  program/read back check ("FLASH sectors=...", "FLASHCHECK ok=...") are treated
+  the same way.
+- If a baseline exists (bench_baseline.json by default), each benchmark's metric
+  (the median by default) is compared against it. A benchmark regresses if its
+  metric exceeds the baseline by more than the threshold. A --threshold given on
+  the command line applies to all benchmarks, otherwise the benchmark's own
+  "threshold" in the baseline, the baseline's global one or 10 % is used. The
+  baseline must have been recorded with the same --metric.
+
+Exit status: 0 on success, 1 if any benchmark regressed, 2 if the run itself failed
+(timeout, missing marker, crash dump, Qemu could not be started, ...).
+
+Use --update-baseline to store the current report as the new baseline.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import threading
+import time
+
+
+# Printed by main() when all tests are completed:
+END_MARKER = "* * * T E S T   C O M P L E T E D * * *"
+
+# Size of a created SD card image (Qemu requires a power of 2):
+SD_IMAGE_SIZE = 16 * 1024 * 1024
+
+# Size of a created flash image (must match the Versatile's flash bank):
+FLASH_IMAGE_SIZE = 64 * 1024 * 1024
+
+# Printed by the crash dump handler (see crash.c):
+CRASH_MARKER = "*** CRASH:"
+CRASH_END_MARKER = "*** END OF CRASH DUMP ***"
+
+# Allowed relative regression unless specified otherwise:
+DEFAULT_THRESHOLD = 0.10
+
+BENCH_RE = re.compile(r"^BENCH name=(\S+)((?: \w+=\d+)*)\s*$")
+STRESS_RE = re.compile(r"^STRESS mode=(\S+)((?: \w+=\d+)*)\s*$")
+CPULOAD_RE = re.compile(r"^CPULOAD((?: \w+=\d+)*)\s*$")
+DMACOPY_RE = re.compile(r"^DMACOPY crossover=(\d+)\s*$")
+SD_RE = re.compile(r"^SD(?:CHECK)?((?: \w+=\d+)+)\s*$")
+FLASH_RE = re.compile(r"^FLASH(?:CHECK)?((?: \w+=\d+)+)\s*$")
+KEYVAL_RE = re.compile(r"(\w+)=(\d+)")
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Runs the firmware in Qemu and checks benchmark results for regressions.")
+    parser.add_argument("image", nargs="?", default="image.bin",
+                        help="firmware image (default: %(default)s)")
+    parser.add_argument("--qemu", default=os.environ.get("QEMUBIN", "qemu-system-arm"),
+                        help="Qemu executable (default: $QEMUBIN or %(default)s)")
+    parser.add_argument("--icount", type=int, default=2, metavar="SHIFT",
+                        help="each instruction takes 2^SHIFT ns of emulated time (default: %(default)s)")
+    parser.add_argument("--semihosting", action="store_true",
+                        help="enable semihosting, so the firmware may exit via SYS_EXIT")
+    parser.add_argument("--sd", default="sd.img",
+                        help="raw SD card image, created if missing (default: %(default)s)")
+    parser.add_argument("--flash", default="flash.img",
+                        help="raw NOR flash image, created if missing (default: %(default)s)")
+    parser.add_argument("--timeout", type=float, default=600.0,
+                        help="max. run time in seconds (default: %(default)s)")
+    parser.add_argument("--uart-log", default="bench_output.txt",
+                        help="file with captured UART0 output (default: %(default)s)")
+    parser.add_argument("--report", default="bench_report.json",
+                        help="JSON report (default: %(default)s)")
+    parser.add_argument("--baseline", default="bench_baseline.json",
+                        help="JSON baseline (default: %(default)s)")
+    parser.add_argument("--metric", default="med", choices=("min", "med", "max"),
+                        help="compared metric (default: %(default)s)")
+    parser.add_argument("--threshold", type=float, default=None,
+                        help="allowed relative regression, overrides the baseline's "
+                             "thresholds (default: %.2f)" % DEFAULT_THRESHOLD)
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="store the report as the new baseline")
+    return parser.parse_args()
+
+
+def prepare_image(path, size):
+    """
+    Creates a zero filled image (of a SD card or flash) if it does not exist yet.
+    """
+
+    if not os.path.exists(path):
+        with open(path, "wb") as f:
+            f.truncate(size)
+
+
+def run_qemu(args):
+    """
+    Runs Qemu, captures UART0 into args.uart_log and returns a tuple
+    (list of captured lines, reason of termination).
+    """
+
+    cmd = [args.qemu, "-M", "versatilepb", "-m", "128",
+           "-display", "none", "-monitor", "none", "-serial", "stdio",
+           "-icount", "shift=%d,align=off" % args.icount,
+           "-drive", "if=sd,format=raw,file=%s" % args.sd,
+           "-drive", "if=pflash,format=raw,file=%s" % args.flash,
+           "-kernel", args.image]
+    if args.semihosting:
+        cmd.append("-semihosting")
+
+    try:
+        proc = subprocess.Popen(cmd, stdin=subprocess.DEVNULL, stdout=subprocess.PIPE,
+                                stderr=subprocess.STDOUT)
+    except OSError as ex:
+        return [], "cannot start %s: %s" % (args.qemu, ex)
+
+    lines = []
+    result = {"reason": None}
+
+    def reader():
+        with open(args.uart_log, "w") as log:
+            for raw in iter(proc.stdout.readline, b""):
+                line = raw.decode("ascii", errors="replace").rstrip("\r\n")
+                log.write(line + "\n")
+                log.flush()
+                lines.append(line)
+                if END_MARKER in line:
+                    result["reason"] = "completed"
+                    break
+                if CRASH_MARKER in line and result["reason"] is None:
+                    # keep reading, the rest of the dump is still useful
+                    result["reason"] = "crashed"
+                if CRASH_END_MARKER in line and result["reason"] == "crashed":
+                    # the application is halted, no need to wait for the timeout
+                    break
+
+    thread = threading.Thread(target=reader, daemon=True)
+    thread.start()
+
+    deadline = time.time() + args.timeout
+    while thread.is_alive() and proc.poll() is None and time.time() < deadline:
+        thread.join(0.2)
+
+    if result["reason"] == "completed":
+        reason = "completed"
+    elif proc.poll() is not None:
+        thread.join(1.0)
+        reason = result["reason"] or "exited"
+        if reason == "exited" and proc.returncode != 0:
+            reason = "qemu exited with status %d" % proc.returncode
+    elif result["reason"] == "crashed":
+        reason = "crashed"
+    else:
+        reason = "timeout"
+
+    if proc.poll() is None:
+        proc.terminate()
+        try:
+            proc.wait(5)
+        except subprocess.TimeoutExpired:
+            proc.kill()
+            proc.wait()
+
+    return lines, reason
+
+
+def parse_benchmarks(lines):
+    """
+    Parses all "BENCH ..." lines into a dictionary: name -> {key: value}
+    """
+
+    benchmarks = {}
+    for line in lines:
+        match = BENCH_RE.match(line.strip())
+        if match:
+            benchmarks[match.group(1)] = {key: int(val) for key, val in KEYVAL_RE.findall(match.group(2))}
+    return benchmarks
+
+
+def parse_stress(lines):
+    """
+    Parses summaries of the interrupt stress test ("STRESS mode=... max_rate=...")
+    into a dictionary: mode -> {key: value}
+    """
+
+    stress = {}
+    for line in lines:
+        match = STRESS_RE.match(line.strip())
+        if match:
+            values = {key: int(val) for key, val in KEYVAL_RE.findall(match.group(2))}
+            if "max_rate" in values:
+                stress[match.group(1)] = values
+    return stress
+
+
+def parse_cpuload(lines):
+    """
+    Parses the CPU load report ("CPULOAD load_1s=... load_10s=...") into
+    a dictionary: key -> value. The last report is used.
+    """
+
+    cpuload = {}
+    for line in lines:
+        match = CPULOAD_RE.match(line.strip())
+        if match:
+            cpuload = {key: int(val) for key, val in KEYVAL_RE.findall(match.group(1))}
+    return cpuload
+
+
+def parse_dma_crossover(lines):
+    """
+    Parses the smallest block size where the DMA copy beats the CPU copy
+    ("DMACOPY crossover=..."). Returns None if not reported.
+    """
+
+    crossover = None
+    for line in lines:
+        match = DMACOPY_RE.match(line.strip())
+        if match:
+            crossover = int(match.group(1))
+    return crossover
+
+
+def parse_keyvals(lines, regex):
+    """
+    Parses key=value pairs of all lines, matched by the regex (e.g. the SD card's
+    capacity and the result of its check: "SD blocks=...", "SDCHECK ok=...")
+    into a dictionary: key -> value. The dictionary is empty if no line matched.
+    """
+
+    result = {}
+    for line in lines:
+        match = regex.match(line.strip())
+        if match:
+            result.update({key: int(val) for key, val in KEYVAL_RE.findall(match.group(1))})
+    return result
+
+
+def compare(report, baseline, args):
+    """
+    Compares the report against the baseline and prints the results.
+
+    Returns a list of names of regressed benchmarks.
+    """
+
+    regressed = []
+    base_benchmarks = baseline.get("benchmarks", {})
+    threshold = baseline.get("threshold", DEFAULT_THRESHOLD)
+
+    for name in sorted(set(base_benchmarks) | set(report["benchmarks"])):
+        base = base_benchmarks.get(name)
+        cur = report["benchmarks"].get(name)
+
+        if base is None:
+            print("  NEW      %-28s %s=%d" % (name, args.metric, cur.get(args.metric, 0)))
+            continue
+        if cur is None:
+            print("  MISSING  %-28s" % name)
+            regressed.append(name)
+            continue
+
+        old = base.get(args.metric, 0)
+        new = cur.get(args.metric, 0)
+        if args.threshold is not None:
+            limit = old * (1.0 + args.threshold)
+        else:
+            limit = old * (1.0 + base.get("threshold", threshold))
+        change = (float(new - old) / old * 100.0) if old > 0 else 0.0
+        status = "OK"
+        # An increase of a single tick is always tolerated (clock resolution)
+        if new > limit and new > old + 1:
+            status = "REGRESS"
+            regressed.append(name)
+        print("  %-8s %-28s %s: %d -> %d (%+.1f%%)" % (status, name, args.metric, old, new, change))
+
+    return regressed
+
+
+def main():
+    args = parse_args()
+
+    prepare_image(args.sd, SD_IMAGE_SIZE)
+    prepare_image(args.flash, FLASH_IMAGE_SIZE)
+    lines, reason = run_qemu(args)
+
+    report = {
+        "image": args.image,
+        "icount_shift": args.icount,
+        "status": reason,
+        "benchmarks": parse_benchmarks(lines),
+        "stress": parse_stress(lines),
+        "cpuload": parse_cpuload(lines),
+        "dma_crossover": parse_dma_crossover(lines),
+        "sd": parse_keyvals(lines, SD_RE),
+        "flash": parse_keyvals(lines, FLASH_RE),
+    }
+
+    with open(args.report, "w") as f:
+        json.dump(report, f, indent=2, sort_keys=True)
+        f.write("\n")
+
+    print("Run status: %s, %d benchmark(s), report written to %s"
+          % (reason, len(report["benchmarks"]), args.report))
+
+    if reason != "completed" and not (reason == "exited" and args.semihosting):
+        print("ERROR: the test application did not complete, see %s" % args.uart_log)
+        return 2
+
+    if report["sd"].get("ok", 1) == 0:
+        print("ERROR: data read back from the SD card differ from written ones")
+        return 2
+
+    if report["flash"].get("ok", 1) == 0:
+        print("ERROR: data read back from the flash differ from programmed ones")
+        return 2
+
+    if args.update_baseline:
+        threshold = DEFAULT_THRESHOLD if args.threshold is None else args.threshold
+        baseline = {"metric": args.metric, "threshold": threshold,
+                    "benchmarks": report["benchmarks"]}
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("Baseline updated: %s" % args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print("No baseline (%s) found, nothing to compare" % args.baseline)
+        return 0
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    if baseline.get("metric", args.metric) != args.metric:
+        print("ERROR: the baseline (%s) was recorded with --metric %s, not %s"
+              % (args.baseline, baseline["metric"], args.metric))
+        return 2
+
+    regressed = compare(report, baseline, args)
+    if regressed:
+        print("ERROR: %d benchmark(s) regressed: %s" % (len(regressed), ", ".join(regressed)))
+        return 1
+
+    print("No regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
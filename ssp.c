@@ -0,0 +1,589 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the PL022 SSP driver (SPI master, Motorola frame format).
+ *
+ * Both polled and queued transfers keep the transmit FIFO as full as
+ * possible, but never have more than SSP_FIFO_DEPTH frames in flight
+ * (transmitted, but not read from the receive FIFO yet), so the receive
+ * FIFO cannot overflow.
+ *
+ * Queued transfers are processed by the ISR: it drains the receive FIFO,
+ * refills the transmit FIFO and, when a transfer completes, calls its
+ * callback and immediately starts the next transfer of the queue. The
+ * transmit interrupt (FIFO half empty) is only enabled while frames
+ * remain to be sent, the tail of a transfer is collected by the receive
+ * (FIFO half full) and receive timeout interrupts.
+ *
+ * Frames are not moved by the DMA controller: Qemu's PL022 does not
+ * raise DMA requests and its PL080 does not implement peripheral flow
+ * control, while the ISR moves up to SSP_FIFO_DEPTH frames per IRQ.
+ *
+ * More info about the controller:
+ * - ARM PrimeCell Synchronous Serial Port (PL022) Technical Reference Manual (DDI0194):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.ddi0194g/DDI0194G_ssp_pl022_r1p4_trm.pdf
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "ssp.h"
+#include "interrupt.h"
+#include "arith.h"
+
+
+/*
+ * Accesses of the data register: a read pops the oldest frame of the
+ * receive FIFO, a write pushes a frame into the transmit FIFO.
+ *
+ * In the host (unit test) build, reads and writes of plain memory have no
+ * side effects, so the simulated controller is notified instead.
+ */
+#ifdef BSP_HOST_SIM
+extern uint32_t sim_sspRead(void);
+extern void sim_sspWrite(uint32_t val);
+#define DATA_READ()           sim_sspRead()
+#define DATA_WRITE(VAL)       sim_sspWrite(VAL)
+#else
+#define DATA_READ()           ( pReg->SSPDR )
+#define DATA_WRITE(VAL)       ( pReg->SSPDR = (VAL) )
+#endif
+
+
+/*
+ * 32-bit registers of the PL022, relative to the controller's base address.
+ * See page 3-3 of DDI0194.
+ */
+typedef struct _ARM926EJS_SSP_REGS
+{
+    uint32_t SSPCR0;                   /* Control Register 0 */
+    uint32_t SSPCR1;                   /* Control Register 1 */
+    uint32_t SSPDR;                    /* Receive FIFO (read), transmit FIFO (write) */
+    const uint32_t SSPSR;              /* Status Register, read only */
+    uint32_t SSPCPSR;                  /* Clock Prescale Register */
+    uint32_t SSPIMSC;                  /* Interrupt Mask Set or Clear Register */
+    const uint32_t SSPRIS;             /* Raw Interrupt Status Register, read only */
+    const uint32_t SSPMIS;             /* Masked Interrupt Status Register, read only */
+    uint32_t SSPICR;                   /* Interrupt Clear Register, write only */
+    uint32_t SSPDMACR;                 /* DMA Control Register */
+} ARM926EJS_SSP_REGS;
+
+
+/*
+ * Bit masks of Control Register 0 (SSPCR0), see page 3-4 of DDI0194:
+ *
+ * 15-8: SCR (serial clock rate)
+ *    7: SPH (clock phase)
+ *    6: SPO (clock polarity)
+ *  5-4: FRF (frame format, 00: Motorola SPI)
+ *  3-0: DSS (data size select, number of bits minus 1)
+ */
+#define CR0_SPH              0x00000080
+#define CR0_SPO              0x00000040
+#define CR0_SCR_SHIFT        8
+
+/*
+ * Bit masks of Control Register 1 (SSPCR1), see page 3-5 of DDI0194:
+ *
+ * 3: SOD (slave mode output disable)
+ * 2: MS (0: master)
+ * 1: SSE (enable)
+ * 0: LBM (loop back mode)
+ */
+#define CR1_SSE              0x00000002
+#define CR1_LBM              0x00000001
+
+/*
+ * Bit masks of the Status Register (SSPSR), see page 3-7 of DDI0194:
+ *
+ * 4: BSY
+ * 3: RFF (receive FIFO full)
+ * 2: RNE (receive FIFO not empty)
+ * 1: TNF (transmit FIFO not full)
+ * 0: TFE (transmit FIFO empty)
+ */
+#define SR_BSY               0x00000010
+#define SR_RNE               0x00000004
+#define SR_TNF               0x00000002
+#define SR_TFE               0x00000001
+
+/*
+ * Bits of interrupt registers (SSPIMSC, SSPRIS, SSPMIS, SSPICR),
+ * see pp. 3-9 to 3-12 of DDI0194:
+ *
+ * 3: TX (transmit FIFO half empty or less)
+ * 2: RX (receive FIFO half full or more)
+ * 1: RT (receive timeout)
+ * 0: ROR (receive overrun)
+ */
+#define INT_TX               0x00000008
+#define INT_RX               0x00000004
+#define INT_RT               0x00000002
+#define INT_ROR              0x00000001
+
+/* SSPCLK of the Versatile baseboard: */
+#define SSPCLK_HZ            24000000
+
+/* Limits of the clock prescaler (even values only) and the serial clock rate: */
+#define CPSDVSR_MIN          2
+#define CPSDVSR_MAX          254
+#define SCR_MAX              255
+
+/* Limits of the frame size: */
+#define BITS_MIN             4
+#define BITS_MAX             16
+
+
+static volatile ARM926EJS_SSP_REGS* const pReg = (ARM926EJS_SSP_REGS*) (BSP_SSP_BASE_ADDRESS);
+
+/* Configuration: */
+static uint8_t __initialized = 0;
+static uint8_t __wide = 0;             /* nonzero if frames are stored as uint16_t */
+static uint32_t __bitRate = 0;
+
+/* The queue of transfers, the first one is in progress: */
+static sspTransfer* volatile __head = NULL;
+static sspTransfer* __tail = NULL;
+static uint32_t __txPos;               /* frames of the current transfer, written into the transmit FIFO */
+static uint32_t __rxPos;               /* frames of the current transfer, read from the receive FIFO */
+static int8_t __status;
+static uint8_t __inIsr = 0;
+
+static sspStats __stats;
+
+
+/*
+ * @param buf - buffer of frames, NULL for zeros
+ * @param i - index of the frame
+ *
+ * @return the frame
+ */
+static inline uint32_t __getFrame(const void* buf, uint32_t i)
+{
+    if ( NULL == buf )
+    {
+        return 0;
+    }
+
+    return ( 0 != __wide ? ((const uint16_t*) buf)[i] : ((const uint8_t*) buf)[i] );
+}
+
+
+/*
+ * Stores a received frame, nothing is done if 'buf' equals NULL.
+ *
+ * @param buf - buffer of frames
+ * @param i - index of the frame
+ * @param val - the frame
+ */
+static inline void __putFrame(void* buf, uint32_t i, uint32_t val)
+{
+    if ( NULL == buf )
+    {
+        return;
+    }
+
+    if ( 0 != __wide )
+    {
+        ((uint16_t*) buf)[i] = (uint16_t) val;
+    }
+    else
+    {
+        ((uint8_t*) buf)[i] = (uint8_t) val;
+    }
+}
+
+
+/*
+ * Writes frames into the transmit FIFO while it is not full, frames remain
+ * to be sent, and less than SSP_FIFO_DEPTH frames are in flight.
+ *
+ * @param tx - frames to be sent
+ * @param count - number of frames
+ * @param txPos - number of already written frames, updated
+ * @param rxPos - number of already received frames
+ */
+static void __fill(const void* tx, uint32_t count, uint32_t* txPos, uint32_t rxPos)
+{
+    while ( *txPos < count && (*txPos - rxPos) < SSP_FIFO_DEPTH && 0 != (pReg->SSPSR & SR_TNF) )
+    {
+        DATA_WRITE(__getFrame(tx, *txPos));
+        ++(*txPos);
+    }
+}
+
+
+/*
+ * Reads all frames from the receive FIFO.
+ *
+ * @param rx - buffer for received frames
+ * @param count - number of frames of the transfer
+ * @param rxPos - number of already received frames, updated
+ */
+static void __drain(void* rx, uint32_t count, uint32_t* rxPos)
+{
+    uint32_t val;
+
+    while ( 0 != (pReg->SSPSR & SR_RNE) )
+    {
+        val = DATA_READ();
+
+        if ( *rxPos < count )
+        {
+            __putFrame(rx, *rxPos, val);
+            ++(*rxPos);
+        }
+    }
+}
+
+
+/*
+ * Frames, lost by a receive overrun, are never received, so a transfer
+ * is also complete when all its frames have been sent and the controller
+ * is idle.
+ *
+ * @param t - the current transfer
+ *
+ * @return nonzero if the transfer is complete
+ */
+static inline uint8_t __isComplete(const sspTransfer* t)
+{
+    if ( __rxPos >= t->count )
+    {
+        return 1;
+    }
+
+    return ( SSP_STATUS_OVERRUN == __status && __txPos >= t->count &&
+             SR_TFE == (pReg->SSPSR & (SR_TFE | SR_BSY | SR_RNE)) ? 1 : 0 );
+}
+
+
+/*
+ * Processes the queue: the current transfer is continued, completed
+ * transfers are removed from the queue and the next ones started.
+ * Interrupts, needed by the current transfer, are enabled.
+ */
+static void __process(void)
+{
+    sspTransfer* t;
+
+    while ( NULL != (t = __head) )
+    {
+        __drain(t->rx, t->count, &__rxPos);
+        __fill(t->tx, t->count, &__txPos, __rxPos);
+        __drain(t->rx, t->count, &__rxPos);
+
+        if ( 0 == __isComplete(t) )
+        {
+            pReg->SSPIMSC = INT_RX | INT_RT | INT_ROR | ( __txPos < t->count ? INT_TX : 0 );
+            return;
+        }
+
+        __head = t->next;
+        __tail = ( NULL == __head ? NULL : __tail );
+        ++__stats.transfers;
+        __stats.frames += t->count;
+
+        /* The next transfer must start from the beginning */
+        __txPos = 0;
+        __rxPos = 0;
+
+        if ( NULL != t->callback )
+        {
+            const int8_t status = __status;
+
+            __status = SSP_STATUS_OK;
+            ( *t->callback )( status, t->param );
+        }
+
+        __status = SSP_STATUS_OK;
+    }
+
+    pReg->SSPIMSC = 0;
+}
+
+
+/*
+ * ISR of the SSP, processes the queue of transfers.
+ *
+ * @param param - unused
+ */
+static void __sspIsr(void* param)
+{
+    ++__stats.irqs;
+
+    if ( 0 != (pReg->SSPRIS & INT_ROR) )
+    {
+        ++__stats.overruns;
+        __status = SSP_STATUS_OVERRUN;
+    }
+
+    pReg->SSPICR = INT_ROR | INT_RT;
+
+    __inIsr = 1;
+    __process();
+    __inIsr = 0;
+}
+
+
+/**
+ * Initializes the SSP as a SPI master with Motorola frames, the ISR of
+ * queued transfers is registered and its IRQ enabled. The bit rate is the
+ * highest one, achievable by the controller, that does not exceed 'bitRate'.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param bitRate - max. bit rate in Hz
+ * @param bits - number of bits per frame (between 4 and 16)
+ * @param mode - SPI mode (SSP_MODE_*)
+ * @param priority - priority of the SSP's IRQ (see pic_registerNonVectoredIrq())
+ *
+ * @return SSP_OK on success, SSP_ERR_PARAM if any parameter is invalid or the ISR could not be registered
+ */
+int8_t ssp_init(uint32_t bitRate, uint8_t bits, uint8_t mode, uint8_t priority)
+{
+    uint32_t cpsdvsr;
+    uint32_t scr = 0;
+
+    if ( 0 == bitRate || bits < BITS_MIN || bits > BITS_MAX || mode > SSP_MODE_3 )
+    {
+        return SSP_ERR_PARAM;
+    }
+
+    /* The smallest prescaler gives the finest resolution of the serial clock rate */
+    for ( cpsdvsr=CPSDVSR_MIN; cpsdvsr<=CPSDVSR_MAX; cpsdvsr+=2 )
+    {
+        scr = arith_udiv(SSPCLK_HZ + cpsdvsr * bitRate - 1, cpsdvsr * bitRate) - 1;
+        if ( scr <= SCR_MAX )
+        {
+            break;  /* out of for */
+        }
+    }
+
+    if ( cpsdvsr > CPSDVSR_MAX )
+    {
+        return SSP_ERR_PARAM;
+    }
+
+    __initialized = 0;
+    pReg->SSPCR1 = 0;
+    pReg->SSPIMSC = 0;
+    pReg->SSPDMACR = 0;
+    pReg->SSPICR = INT_ROR | INT_RT;
+
+    pReg->SSPCR0 = (uint32_t) (bits - 1) | ( scr << CR0_SCR_SHIFT ) |
+                   ( 0 != (mode & 0x01) ? CR0_SPH : 0 ) |
+                   ( 0 != (mode & 0x02) ? CR0_SPO : 0 );
+    pReg->SSPCPSR = cpsdvsr;
+
+    __wide = ( bits > 8 ? 1 : 0 );
+    __bitRate = arith_udiv(SSPCLK_HZ, cpsdvsr * (scr + 1));
+    __head = NULL;
+    __tail = NULL;
+    __txPos = 0;
+    __rxPos = 0;
+    __status = SSP_STATUS_OK;
+    ssp_resetStats();
+
+    if ( pic_registerNonVectoredIrq(BSP_SSP_IRQ, &__sspIsr, NULL, priority) < 0 )
+    {
+        return SSP_ERR_PARAM;
+    }
+
+    pic_enableInterrupt(BSP_SSP_IRQ);
+
+    pReg->SSPCR1 = CR1_SSE;
+
+    /* Discard any stale frames of the receive FIFO */
+    while ( 0 != (pReg->SSPSR & SR_RNE) )
+    {
+        (void) DATA_READ();
+    }
+
+    __initialized = 1;
+
+    return SSP_OK;
+}
+
+
+/**
+ * Disables the SSP and its IRQ. Queued transfers are discarded
+ * without calling their callbacks.
+ */
+void ssp_disable(void)
+{
+    pReg->SSPIMSC = 0;
+    pReg->SSPCR1 = 0;
+    pic_disableInterrupt(BSP_SSP_IRQ);
+    pic_unregisterNonVectoredIrq(BSP_SSP_IRQ);
+
+    __head = NULL;
+    __tail = NULL;
+    __initialized = 0;
+}
+
+
+/**
+ * @return the actual bit rate in Hz, 0 if the SSP is not initialized
+ */
+uint32_t ssp_getBitRate(void)
+{
+    return ( 0 != __initialized ? __bitRate : 0 );
+}
+
+
+/**
+ * Enables or disables the loop back mode: the output of the transmit
+ * shift register is connected to the input of the receive shift register.
+ *
+ * @param enable - nonzero enables the loop back mode, 0 disables it
+ */
+void ssp_setLoopback(uint8_t enable)
+{
+    pReg->SSPCR1 = ( 0 != enable ? pReg->SSPCR1 | CR1_LBM : pReg->SSPCR1 & ~CR1_LBM );
+}
+
+
+/**
+ * Transfers frames by polling the controller, i.e. the function returns
+ * when all frames have been received.
+ *
+ * @param tx - frames to be sent, NULL sends zeros
+ * @param rx - buffer for received frames, NULL discards them
+ * @param count - number of frames
+ *
+ * @return SSP_OK on success, SSP_ERR_NOINIT if the SSP is not initialized, SSP_ERR_BUSY if queued transfers are in progress
+ */
+int8_t ssp_transfer(const void* tx, void* rx, uint32_t count)
+{
+    uint32_t txPos = 0;
+    uint32_t rxPos = 0;
+
+    if ( 0 == __initialized )
+    {
+        return SSP_ERR_NOINIT;
+    }
+
+    if ( NULL != __head )
+    {
+        return SSP_ERR_BUSY;
+    }
+
+    while ( rxPos < count )
+    {
+        __fill(tx, count, &txPos, rxPos);
+        __drain(rx, count, &rxPos);
+    }
+
+    ++__stats.transfers;
+    __stats.frames += count;
+
+    return SSP_OK;
+}
+
+
+/**
+ * Appends a transfer to the queue. If the queue is empty, the transfer
+ * is started immediately. The function may also be called from callbacks
+ * of completed transfers.
+ *
+ * @param t - descriptor of the transfer
+ *
+ * @return SSP_OK on success, SSP_ERR_PARAM if 't' is invalid, SSP_ERR_NOINIT if the SSP is not initialized
+ */
+int8_t ssp_submit(sspTransfer* t)
+{
+    uint32_t imsc;
+
+    if ( NULL == t || 0 == t->count )
+    {
+        return SSP_ERR_PARAM;
+    }
+
+    if ( 0 == __initialized )
+    {
+        return SSP_ERR_NOINIT;
+    }
+
+    /* The ISR must not modify the queue meanwhile */
+    imsc = pReg->SSPIMSC;
+    pReg->SSPIMSC = 0;
+
+    t->next = NULL;
+
+    if ( NULL == __head )
+    {
+        __head = t;
+        __tail = t;
+
+        if ( 0 == __inIsr )
+        {
+            __process();
+        }
+
+        return SSP_OK;
+    }
+
+    __tail->next = t;
+    __tail = t;
+    pReg->SSPIMSC = imsc;
+
+    return SSP_OK;
+}
+
+
+/**
+ * @return 1 if any queued transfer is in progress, 0 otherwise
+ */
+int8_t ssp_isBusy(void)
+{
+    return ( NULL != __head ? 1 : 0 );
+}
+
+
+/**
+ * Copies statistics of the SSP.
+ *
+ * @param stats - address where the statistics will be copied to
+ */
+void ssp_getStats(sspStats* stats)
+{
+    if ( NULL != stats )
+    {
+        *stats = __stats;
+    }
+}
+
+
+/**
+ * Resets all counters of the SSP's statistics.
+ */
+void ssp_resetStats(void)
+{
+    __stats.transfers = 0;
+    __stats.frames = 0;
+    __stats.irqs = 0;
+    __stats.overruns = 0;
+}
@@ -0,0 +1,119 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the PL022 synchronous
+ * serial port (SSP) driver, configured as a SPI master.
+ *
+ * Transfers are full duplex: a frame is received for each transmitted
+ * one. Frames of up to 8 bits are stored in buffers of uint8_t, larger
+ * ones in buffers of uint16_t.
+ *
+ * ssp_transfer() polls the controller, ssp_submit() appends a transfer
+ * to a queue that is processed by the SSP's ISR, so transfers of the
+ * queue follow each other without any involvement of the application.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _SSP_H_
+#define _SSP_H_
+
+#include <stdint.h>
+
+
+/* Depth of the controller's transmit and receive FIFOs (frames): */
+#define SSP_FIFO_DEPTH           8
+
+
+/* Return values of ssp_* functions: */
+#define SSP_OK                   0
+#define SSP_ERR_PARAM           -1     /* invalid parameter or the ISR could not be registered */
+#define SSP_ERR_NOINIT          -2     /* the SSP is not initialized */
+#define SSP_ERR_BUSY            -3     /* queued transfers are in progress */
+
+/* SPI modes, i.e. clock polarity (CPOL) and phase (CPHA): */
+#define SSP_MODE_0               0     /* CPOL=0, CPHA=0 */
+#define SSP_MODE_1               1     /* CPOL=0, CPHA=1 */
+#define SSP_MODE_2               2     /* CPOL=1, CPHA=0 */
+#define SSP_MODE_3               3     /* CPOL=1, CPHA=1 */
+
+/* Status of a completed transfer, passed to its callback: */
+#define SSP_STATUS_OK            0
+#define SSP_STATUS_OVERRUN      -1     /* received frames were lost */
+
+
+/**
+ * Required prototype of callbacks, called (from the SSP's ISR) when
+ * a queued transfer completes.
+ *
+ * @param status - SSP_STATUS_OK if the transfer completed successfully, SSP_STATUS_OVERRUN otherwise
+ * @param param - parameter of the transfer
+ */
+typedef void (*sspCallback)(int8_t status, void* param);
+
+
+/**
+ * A queued transfer. The descriptor and its buffers are owned by the
+ * application and must remain valid until the transfer completes.
+ */
+typedef struct _sspTransfer
+{
+    const void* tx;               /* frames to be sent, NULL sends zeros */
+    void* rx;                     /* buffer for received frames, NULL discards them */
+    uint32_t count;               /* number of frames */
+    sspCallback callback;         /* called when the transfer completes, may be NULL */
+    void* param;                  /* parameter of the callback */
+    struct _sspTransfer* next;    /* used by the driver */
+} sspTransfer;
+
+
+/**
+ * Statistics of the SSP, all counters start at 0 when the SSP is
+ * initialized or its statistics are reset.
+ */
+typedef struct _sspStats
+{
+    uint32_t transfers;           /* completed transfers (polled and queued) */
+    uint32_t frames;              /* transferred frames */
+    uint32_t irqs;                /* invocations of the SSP's ISR */
+    uint32_t overruns;            /* receive overruns */
+} sspStats;
+
+
+int8_t ssp_init(uint32_t bitRate, uint8_t bits, uint8_t mode, uint8_t priority);
+
+void ssp_disable(void);
+
+uint32_t ssp_getBitRate(void);
+
+void ssp_setLoopback(uint8_t enable);
+
+int8_t ssp_transfer(const void* tx, void* rx, uint32_t count);
+
+int8_t ssp_submit(sspTransfer* t);
+
+int8_t ssp_isBusy(void);
+
+void ssp_getStats(sspStats* stats);
+
+void ssp_resetStats(void);
+
+#endif  /* _SSP_H_ */
@@ -8,7 +8,8 @@
 # and/or input.
 #
 # If no command line argument is provided, "image.bin" (as built by Makefile) is executed as
-# a firmware image file.
+# a firmware image file. If "flash.img" is provided (as built by "make XIP=1 rebuild flash_image"),
+# the board boots from the NOR flash instead, see xip.ld.
 
 # Default firmware image:
 IMAGE_FILE=image.bin
@@ -18,6 +19,16 @@ if [ $# -ge 1 ]; then
     IMAGE_FILE=$1;
 fi
 
+# SD card and NOR flash images (e.g. created by run_bench.py) are attached if they exist:
+DRIVE_OPTS=
+if [ -f sd.img ]; then
+    DRIVE_OPTS="-drive if=sd,format=raw,file=sd.img"
+fi
+
+if [ -f flash.img ]; then
+    DRIVE_OPTS="$DRIVE_OPTS -drive if=pflash,format=raw,file=flash.img"
+fi
+
 
 # NOTE:
 # The version of Qemu (1.0), delivered with my distribution of Linux, does not emulate the
@@ -32,4 +43,10 @@ fi
 #QEMUBIN=qemu-system-arm
 QEMUBIN=~/qemu/bin/qemu-system-arm
 
-$QEMUBIN -M versatilepb -nographic -m 128 -kernel $IMAGE_FILE
+# Qemu does not remap the flash to 0x00000000, so the CPU is started at its first byte:
+BOOT_OPTS="-kernel $IMAGE_FILE"
+if [ "$IMAGE_FILE" == "flash.img" ]; then
+    BOOT_OPTS="-device loader,addr=0x34000000,cpu-num=0"
+fi
+
+$QEMUBIN -M versatilepb -nographic -m 128 $DRIVE_OPTS $BOOT_OPTS
@@ -0,0 +1,618 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of synchronization primitives between the application
+ * and ISRs.
+ *
+ * The ARM926EJ-S (ARMv5) has no exclusive load/store instructions, so
+ * read-modify-write operations are protected by masking IRQs in the CPSR
+ * for a few instructions. In ISRs, IRQs are already masked, so nothing
+ * else is performed.
+ *
+ * A waiting function checks its condition with IRQs masked and, if it is
+ * not met, executes "wait for interrupt" before it unmasks them. The CPU
+ * is woken by a pending request even when IRQs are masked, so a request,
+ * raised between the check and the wait, is not lost. Its ISR is serviced
+ * as soon as IRQs are unmasked, then the condition is checked again.
+ * Timeouts are checked whenever the CPU is woken up. If a timeout counter
+ * is set by sync_useTimeoutTimer(), it is armed for the remaining time
+ * before the CPU sleeps. Otherwise a timeout expires at the first interrupt
+ * after its time.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bsp.h"
+#include "sync.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "clocksource.h"
+#include "cpuload.h"
+
+
+/* Number of the PIC's interrupt request lines: */
+#define NR_INTERRUPTS         32
+
+
+/* The counter that wakes the CPU when a timeout expires (see sync_useTimeoutTimer()): */
+static uint8_t __useTimer = 0;
+static uint8_t __timerNr;
+static uint8_t __counterNr;
+
+
+/*
+ * Prototype of functions that check a waiting function's condition
+ * and acquire the object if it is met. They are called with IRQs masked.
+ *
+ * @param ctx - context of the waiting function
+ *
+ * @return 1 if the object was acquired, 0 otherwise
+ */
+typedef uint8_t (*tryAcquireFunc)(void* ctx);
+
+
+/*
+ * Context of sync_eventsWait()
+ */
+typedef struct _eventsCtx
+{
+    syncEvents* ev;               /* the event flag group */
+    uint32_t flags;               /* awaited flags */
+    uint8_t options;              /* options of the wait */
+    uint32_t result;              /* flags, set when the condition was met */
+} eventsCtx;
+
+
+/*
+ * Callback of the timeout counter's expiration. Nothing else is needed,
+ * the interrupt has already woken up the CPU.
+ *
+ * @param param - unused
+ */
+static void __timeoutIsr(void* param)
+{
+    (void) param;
+}
+
+
+/*
+ * Arms the timeout counter (if used) to expire after the given time.
+ *
+ * @param us - remaining time in micro seconds
+ */
+static void __armTimer(uint32_t us)
+{
+    timer_setLoad(__timerNr, __counterNr, ( us > 1 ? us - 1 : 1 ));
+    timer_enableInterrupt(__timerNr, __counterNr);
+    timer_start(__timerNr, __counterNr);
+}
+
+
+/*
+ * Stops the timeout counter and discards its pending interrupt.
+ */
+static void __disarmTimer(void)
+{
+    timer_stop(__timerNr, __counterNr);
+    timer_disableInterrupt(__timerNr, __counterNr);
+    timer_clearInterrupt(__timerNr, __counterNr);
+}
+
+
+/*
+ * Sleeps until 'tryAcquire' succeeds or the timeout expires.
+ *
+ * @param tryAcquire - checks the condition and acquires the object
+ * @param ctx - context, passed to 'tryAcquire'
+ * @param timeoutUs - timeout in micro seconds, SYNC_NO_WAIT or SYNC_WAIT_FOREVER
+ *
+ * @return SYNC_OK on success, SYNC_ERR_TIMEOUT if the timeout expired, SYNC_ERR_IRQ if the condition is not met and the IRQ mode is disabled
+ */
+static int8_t __wait(tryAcquireFunc tryAcquire, void* ctx, uint32_t timeoutUs)
+{
+    const uint32_t start = clocksource_read();
+    uint32_t elapsed;
+    uint8_t armed;
+    int8_t irqMode;
+
+    for ( ; ; )
+    {
+        irqMode = irq_saveIrqMode();
+
+        if ( 0 != tryAcquire(ctx) )
+        {
+            irq_restoreIrqMode(irqMode);
+            return SYNC_OK;
+        }
+
+        elapsed = clocksource_ticksToUs(clocksource_read() - start);
+        if ( SYNC_WAIT_FOREVER != timeoutUs && elapsed >= timeoutUs )
+        {
+            irq_restoreIrqMode(irqMode);
+            return SYNC_ERR_TIMEOUT;
+        }
+
+        if ( 0 == irqMode )
+        {
+            /* No ISR could ever meet the condition */
+            return SYNC_ERR_IRQ;
+        }
+
+        /* Without the timeout counter, only another interrupt would wake the CPU */
+        armed = ( SYNC_WAIT_FOREVER != timeoutUs && 0 != __useTimer ? 1 : 0 );
+        if ( 0 != armed )
+        {
+            __armTimer(timeoutUs - elapsed);
+        }
+
+        /* Called with IRQs masked, it returns when a request is pending, serviced by irq_restoreIrqMode() */
+        cpuload_idle();
+
+        if ( 0 != armed )
+        {
+            __disarmTimer();
+        }
+
+        irq_restoreIrqMode(irqMode);
+    }
+}
+
+
+/*
+ * Takes the semaphore if its count is positive.
+ *
+ * @param ctx - the semaphore
+ *
+ * @return 1 if the semaphore was taken, 0 otherwise
+ */
+static uint8_t __semTryTake(void* ctx)
+{
+    syncSem* sem = (syncSem*) ctx;
+
+    if ( 0 == sem->count )
+    {
+        return 0;
+    }
+
+    --sem->count;
+
+    return 1;
+}
+
+
+/*
+ * Checks the awaited event flags and clears them if requested.
+ *
+ * @param ctx - context of the wait (eventsCtx)
+ *
+ * @return 1 if the condition was met, 0 otherwise
+ */
+static uint8_t __eventsTryWait(void* ctx)
+{
+    eventsCtx* c = (eventsCtx*) ctx;
+    const uint32_t set = c->ev->flags & c->flags;
+
+    if ( 0 == set || ( 0 != (c->options & SYNC_EVENTS_ALL) && set != c->flags ) )
+    {
+        return 0;
+    }
+
+    c->result = set;
+
+    if ( 0 != (c->options & SYNC_EVENTS_CLEAR) )
+    {
+        c->ev->flags &= ~set;
+    }
+
+    return 1;
+}
+
+
+/**
+ * A SP804 counter will wake the CPU when the timeout of a waiting function
+ * expires. Without it, timeouts expire at the first interrupt after their
+ * time, i.e. never if no interrupt occurs.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param timerNr - timer number (between 0 and 1)
+ * @param counterNr - counter number of the selected timer (between 0 and 1)
+ * @param priority - priority of the timer's IRQ (see timer_registerCallback())
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if the timer is invalid or its ISR could not be registered
+ */
+int8_t sync_useTimeoutTimer(uint8_t timerNr, uint8_t counterNr, uint8_t priority)
+{
+    if ( timerNr >= BSP_NR_TIMERS || counterNr >= timer_countersPerTimer() )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    __useTimer = 0;
+    __timerNr = timerNr;
+    __counterNr = counterNr;
+
+    timer_init(timerNr, counterNr);
+
+    if ( timer_registerCallback(timerNr, counterNr, &__timeoutIsr, NULL, priority) < 0 )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    __useTimer = 1;
+
+    return SYNC_OK;
+}
+
+
+/**
+ * Initializes a counting semaphore.
+ *
+ * @param sem - the semaphore
+ * @param initial - initial count
+ * @param max - max. count (1 for a binary semaphore)
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if any parameter is invalid
+ */
+int8_t sync_semInit(syncSem* sem, uint32_t initial, uint32_t max)
+{
+    if ( NULL == sem || 0 == max || initial > max )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    clocksource_init();
+
+    sem->count = initial;
+    sem->max = max;
+
+    return SYNC_OK;
+}
+
+
+/**
+ * Gives (increments) a semaphore, waking up its waiter.
+ *
+ * The function may be called from ISRs.
+ *
+ * @param sem - the semaphore
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if 'sem' is NULL, SYNC_ERR_FULL if the count is already at its max.
+ */
+int8_t sync_semGive(syncSem* sem)
+{
+    int8_t irqMode;
+    int8_t retVal = SYNC_ERR_FULL;
+
+    if ( NULL == sem )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    irqMode = irq_saveIrqMode();
+
+    if ( sem->count < sem->max )
+    {
+        ++sem->count;
+        retVal = SYNC_OK;
+    }
+
+    irq_restoreIrqMode(irqMode);
+
+    return retVal;
+}
+
+
+/**
+ * Takes (decrements) a semaphore. If its count is 0, the CPU sleeps
+ * until the semaphore is given or the timeout expires.
+ *
+ * With SYNC_NO_WAIT, the function may be called from ISRs.
+ *
+ * @param sem - the semaphore
+ * @param timeoutUs - timeout in micro seconds, SYNC_NO_WAIT or SYNC_WAIT_FOREVER (see sync_useTimeoutTimer())
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if 'sem' is NULL, SYNC_ERR_TIMEOUT if the timeout expired, SYNC_ERR_IRQ if the count is 0 and the IRQ mode is disabled
+ */
+int8_t sync_semTake(syncSem* sem, uint32_t timeoutUs)
+{
+    if ( NULL == sem )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    return __wait(&__semTryTake, (void*) sem, timeoutUs);
+}
+
+
+/**
+ * @param sem - the semaphore
+ *
+ * @return current count of the semaphore, 0 if 'sem' is NULL
+ */
+uint32_t sync_semGetCount(const syncSem* sem)
+{
+    return ( NULL != sem ? sem->count : 0 );
+}
+
+
+/**
+ * Initializes a mutex.
+ *
+ * @param m - the mutex
+ * @param ceiling - bit mask of interrupt lines whose ISRs use the mutex
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if 'm' is NULL
+ */
+int8_t sync_mutexInit(syncMutex* m, uint32_t ceiling)
+{
+    if ( NULL == m )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    clocksource_init();
+
+    m->ceiling = ceiling;
+    m->masked = 0;
+    m->locked = 0;
+    m->start = 0;
+    m->contentions = 0;
+    m->maxHoldUs = 0;
+
+    return SYNC_OK;
+}
+
+
+/**
+ * Locks a mutex and masks interrupt lines of its ceiling, so their ISRs
+ * are deferred until the mutex is unlocked.
+ *
+ * The mutex can only be found locked by a context that has interrupted
+ * its holder (an ISR, not included in the ceiling), or by the holder
+ * itself. Waiting would never end in either case, so the function
+ * returns immediately, it may also be called from ISRs.
+ *
+ * @param m - the mutex
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if 'm' is NULL, SYNC_ERR_BUSY if the mutex is already locked
+ */
+int8_t sync_mutexLock(syncMutex* m)
+{
+    int8_t irqMode;
+    uint8_t i;
+
+    if ( NULL == m )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    irqMode = irq_saveIrqMode();
+
+    if ( 0 != m->locked )
+    {
+        ++m->contentions;
+        irq_restoreIrqMode(irqMode);
+        return SYNC_ERR_BUSY;
+    }
+
+    m->locked = 1;
+    m->masked = 0;
+
+    /* Lines, disabled by the application, must remain disabled after the mutex is unlocked */
+    for ( i=0; i<NR_INTERRUPTS; ++i )
+    {
+        if ( 0 != (m->ceiling & (1UL << i)) && 0 != pic_isInterruptEnabled(i) )
+        {
+            m->masked |= (1UL << i);
+            pic_disableInterrupt(i);
+        }
+    }
+
+    m->start = clocksource_read();
+
+    irq_restoreIrqMode(irqMode);
+
+    return SYNC_OK;
+}
+
+
+/**
+ * Unlocks a mutex and unmasks interrupt lines, masked by its lock.
+ * Requests, raised meanwhile, are serviced immediately.
+ *
+ * @param m - the mutex
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if 'm' is NULL or the mutex is not locked
+ */
+int8_t sync_mutexUnlock(syncMutex* m)
+{
+    int8_t irqMode;
+    uint32_t us;
+    uint8_t i;
+
+    if ( NULL == m || 0 == m->locked )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    irqMode = irq_saveIrqMode();
+
+    us = clocksource_ticksToUs(clocksource_read() - m->start);
+    m->maxHoldUs = ( us > m->maxHoldUs ? us : m->maxHoldUs );
+    m->locked = 0;
+
+    for ( i=0; i<NR_INTERRUPTS; ++i )
+    {
+        if ( 0 != (m->masked & (1UL << i)) )
+        {
+            pic_enableInterrupt(i);
+        }
+    }
+
+    m->masked = 0;
+
+    irq_restoreIrqMode(irqMode);
+
+    return SYNC_OK;
+}
+
+
+/**
+ * @param m - the mutex
+ *
+ * @return 1 if the mutex is locked, 0 otherwise
+ */
+int8_t sync_mutexIsLocked(const syncMutex* m)
+{
+    return ( NULL != m && 0 != m->locked ? 1 : 0 );
+}
+
+
+/**
+ * Initializes an event flag group, all flags are cleared.
+ *
+ * @param ev - the event flag group
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if 'ev' is NULL
+ */
+int8_t sync_eventsInit(syncEvents* ev)
+{
+    if ( NULL == ev )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    clocksource_init();
+
+    ev->flags = 0;
+
+    return SYNC_OK;
+}
+
+
+/**
+ * Sets event flags, waking up their waiter.
+ *
+ * The function may be called from ISRs.
+ *
+ * @param ev - the event flag group
+ * @param flags - bit mask of flags to be set
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if 'ev' is NULL
+ */
+int8_t sync_eventsSet(syncEvents* ev, uint32_t flags)
+{
+    int8_t irqMode;
+
+    if ( NULL == ev )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    irqMode = irq_saveIrqMode();
+    ev->flags |= flags;
+    irq_restoreIrqMode(irqMode);
+
+    return SYNC_OK;
+}
+
+
+/**
+ * Clears event flags.
+ *
+ * The function may be called from ISRs.
+ *
+ * @param ev - the event flag group
+ * @param flags - bit mask of flags to be cleared
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if 'ev' is NULL
+ */
+int8_t sync_eventsClear(syncEvents* ev, uint32_t flags)
+{
+    int8_t irqMode;
+
+    if ( NULL == ev )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    irqMode = irq_saveIrqMode();
+    ev->flags &= ~flags;
+    irq_restoreIrqMode(irqMode);
+
+    return SYNC_OK;
+}
+
+
+/**
+ * @param ev - the event flag group
+ *
+ * @return currently set flags, 0 if 'ev' is NULL
+ */
+uint32_t sync_eventsGet(const syncEvents* ev)
+{
+    return ( NULL != ev ? ev->flags : 0 );
+}
+
+
+/**
+ * Waits until any or all of the given event flags are set or the timeout
+ * expires. The CPU sleeps meanwhile.
+ *
+ * With SYNC_NO_WAIT, the function may be called from ISRs.
+ *
+ * @param ev - the event flag group
+ * @param flags - bit mask of awaited flags
+ * @param options - SYNC_EVENTS_ANY or SYNC_EVENTS_ALL, optionally ORed with SYNC_EVENTS_CLEAR
+ * @param timeoutUs - timeout in micro seconds, SYNC_NO_WAIT or SYNC_WAIT_FOREVER (see sync_useTimeoutTimer())
+ * @param result - if not NULL, the awaited flags that were set are written here
+ *
+ * @return SYNC_OK on success, SYNC_ERR_PARAM if 'ev' is NULL or 'flags' is 0, SYNC_ERR_TIMEOUT if the timeout expired, SYNC_ERR_IRQ if the condition is not met and the IRQ mode is disabled
+ */
+int8_t sync_eventsWait(syncEvents* ev, uint32_t flags, uint8_t options, uint32_t timeoutUs, uint32_t* result)
+{
+    eventsCtx ctx;
+    int8_t retVal;
+
+    if ( NULL == ev || 0 == flags )
+    {
+        return SYNC_ERR_PARAM;
+    }
+
+    ctx.ev = ev;
+    ctx.flags = flags;
+    ctx.options = options;
+    ctx.result = 0;
+
+    retVal = __wait(&__eventsTryWait, (void*) &ctx, timeoutUs);
+
+    if ( NULL != result )
+    {
+        *result = ctx.result;
+    }
+
+    return retVal;
+}
@@ -0,0 +1,129 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of synchronization
+ * primitives between the application and ISRs: counting semaphores,
+ * mutexes and event flag groups.
+ *
+ * Waiting functions put the CPU to sleep (see cpuload_idle()) until an
+ * interrupt occurs, instead of spinning. Giving a semaphore and setting
+ * event flags may be performed by ISRs. A timeout can only expire when
+ * the CPU is woken up, so a SP804 counter should be dedicated to it by
+ * sync_useTimeoutTimer().
+ *
+ * A mutex is shared by the application and ISRs of the given interrupt
+ * lines. While it is locked, these lines are masked, i.e. the holder
+ * immediately inherits the priority of the highest of these ISRs
+ * (the priority ceiling), so an ISR never finds the mutex locked.
+ *
+ * All objects are owned by the application and must be initialized
+ * before they are used.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _SYNC_H_
+#define _SYNC_H_
+
+#include <stdint.h>
+
+
+/* Timeouts of waiting functions: */
+#define SYNC_NO_WAIT             0
+#define SYNC_WAIT_FOREVER        0xFFFFFFFFUL
+
+/* Options of sync_eventsWait(): */
+#define SYNC_EVENTS_ANY          0x00  /* any of the flags is sufficient */
+#define SYNC_EVENTS_ALL          0x01  /* all flags are required */
+#define SYNC_EVENTS_CLEAR        0x02  /* the awaited flags are cleared on success */
+
+
+/* Return values of sync_* functions: */
+#define SYNC_OK                  0
+#define SYNC_ERR_PARAM          -1     /* invalid parameter or the mutex is not locked */
+#define SYNC_ERR_TIMEOUT        -2     /* the timeout expired */
+#define SYNC_ERR_BUSY           -3     /* the mutex is already locked */
+#define SYNC_ERR_FULL           -4     /* the semaphore's count is already at its max. */
+#define SYNC_ERR_IRQ            -5     /* waiting is not possible while the IRQ mode is disabled */
+
+
+/**
+ * A counting semaphore.
+ */
+typedef struct _syncSem
+{
+    volatile uint32_t count;      /* current count */
+    uint32_t max;                 /* max. count */
+} syncSem;
+
+
+/**
+ * A mutex, shared with ISRs of the given interrupt lines.
+ */
+typedef struct _syncMutex
+{
+    uint32_t ceiling;             /* bit mask of interrupt lines, masked while the mutex is locked */
+    uint32_t masked;              /* lines, actually masked by the current lock */
+    volatile uint8_t locked;      /* 1 if the mutex is locked */
+    uint32_t start;               /* clocksource's time of the current lock */
+    uint32_t contentions;         /* attempts to lock the locked mutex */
+    uint32_t maxHoldUs;           /* max. time the mutex was locked */
+} syncMutex;
+
+
+/**
+ * A group of 32 event flags.
+ */
+typedef struct _syncEvents
+{
+    volatile uint32_t flags;      /* currently set flags */
+} syncEvents;
+
+
+int8_t sync_useTimeoutTimer(uint8_t timerNr, uint8_t counterNr, uint8_t priority);
+
+int8_t sync_semInit(syncSem* sem, uint32_t initial, uint32_t max);
+
+int8_t sync_semGive(syncSem* sem);
+
+int8_t sync_semTake(syncSem* sem, uint32_t timeoutUs);
+
+uint32_t sync_semGetCount(const syncSem* sem);
+
+int8_t sync_mutexInit(syncMutex* m, uint32_t ceiling);
+
+int8_t sync_mutexLock(syncMutex* m);
+
+int8_t sync_mutexUnlock(syncMutex* m);
+
+int8_t sync_mutexIsLocked(const syncMutex* m);
+
+int8_t sync_eventsInit(syncEvents* ev);
+
+int8_t sync_eventsSet(syncEvents* ev, uint32_t flags);
+
+int8_t sync_eventsClear(syncEvents* ev, uint32_t flags);
+
+uint32_t sync_eventsGet(const syncEvents* ev);
+
+int8_t sync_eventsWait(syncEvents* ev, uint32_t flags, uint8_t options, uint32_t timeoutUs, uint32_t* result);
+
+#endif  /* _SYNC_H_ */
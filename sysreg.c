@@ -0,0 +1,218 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the system registers driver.
+ *
+ * The status and system control registers of the board provide its ID, user
+ * switches and LEDs and two free running counters that require no setup:
+ * - SYS_100HZ, incremented at 100 Hz
+ * - SYS_24MHZ, incremented at 24 MHz, it wraps around after approx. 179 seconds
+ *
+ * The oscillators' registers are protected by SYS_LOCK, they are unlocked
+ * just before they are written and locked again immediately.
+ *
+ * More info about the board and its system registers:
+ * - Versatile Application Baseboard for ARM926EJ-S, HBI 0118 (DUI0225D):
+ *   http://infocenter.arm.com/help/topic/com.arm.doc.dui0225d/DUI0225D_versatile_application_baseboard_arm926ej_s_ug.pdf
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+
+#include "bsp.h"
+#include "sysreg.h"
+
+
+/* Only 8 bits of SYS_SW and SYS_LED are implemented: */
+#define BM_SWITCHES          0x000000FF
+#define BM_LEDS              0x000000FF
+
+/* Writable bits of SYS_OSCx and SYS_CLCD: */
+#define BM_OSC               0x0007FFFF
+#define BM_CLCD              0x000000FF
+
+/* Unlocks the locked registers when written into SYS_LOCK, any other value locks them: */
+#define LOCK_KEY             0x0000A05F
+
+
+/*
+ * 32-bit status and system control registers,
+ * relative to the base address.
+ * See section 4.3 of DUI0225D:
+ */
+typedef struct _ARM926EJS_SYSREG_REGS
+{
+    const uint32_t SYS_ID;               /* System identification, read only */
+    const uint32_t SYS_SW;               /* User switches, read only */
+    uint32_t SYS_LED;                    /* User LEDs */
+    uint32_t SYS_OSC[5];                 /* Oscillator settings (locked by SYS_LOCK) */
+    uint32_t SYS_LOCK;                   /* Lock of the configuration registers */
+    const uint32_t SYS_100HZ;            /* 100 Hz counter, read only */
+    uint32_t SYS_CFGDATA[2];             /* Configuration data */
+    uint32_t SYS_FLAGS;                  /* Flags (set on write) */
+    uint32_t SYS_FLAGSCLR;               /* Flags clear, write only */
+    uint32_t SYS_NVFLAGS;                /* Nonvolatile flags (set on write) */
+    uint32_t SYS_NVFLAGSCLR;             /* Nonvolatile flags clear, write only */
+    uint32_t SYS_RESETCTL;               /* Reset control */
+    uint32_t SYS_PCICTL;                 /* PCI control */
+    const uint32_t SYS_MCI;              /* MCI status, read only */
+    uint32_t SYS_FLASH;                  /* Flash control */
+    uint32_t SYS_CLCD;                   /* CLCD control */
+    uint32_t SYS_CLCDSER;                /* CLCD serial control */
+    const uint32_t SYS_BOOTCS;           /* Boot select, read only */
+    const uint32_t SYS_24MHZ;            /* 24 MHz counter, read only */
+    const uint32_t SYS_MISC;             /* Miscellaneous status, read only */
+    uint32_t SYS_DMAPSR[3];              /* DMA peripheral mapping */
+} ARM926EJS_SYSREG_REGS;
+
+/*
+ * Pointer to the system registers' base address:
+ */
+static volatile ARM926EJS_SYSREG_REGS* const pReg = (ARM926EJS_SYSREG_REGS*) (BSP_SYSREG_BASE_ADDRESS);
+
+
+/**
+ * @return contents of the system identification register (SYS_ID)
+ */
+uint32_t sysreg_getId(void)
+{
+    return pReg->SYS_ID;
+}
+
+
+/**
+ * @return states of the user switches, one bit per switch (1 if the switch is on)
+ */
+uint32_t sysreg_getSwitches(void)
+{
+    return pReg->SYS_SW & BM_SWITCHES;
+}
+
+
+/**
+ * Sets states of the user LEDs.
+ *
+ * @param leds - one bit per LED (1 to turn the LED on), only the lowest 8 bits are considered
+ */
+void sysreg_setLeds(uint32_t leds)
+{
+    pReg->SYS_LED = leds & BM_LEDS;
+}
+
+
+/**
+ * @return states of the user LEDs, one bit per LED
+ */
+uint32_t sysreg_getLeds(void)
+{
+    return pReg->SYS_LED & BM_LEDS;
+}
+
+
+/**
+ * @return current value of the 100 Hz counter (SYS_100HZ)
+ */
+uint32_t sysreg_get100Hz(void)
+{
+    return pReg->SYS_100HZ;
+}
+
+
+/**
+ * @return current value of the 24 MHz counter (SYS_24MHZ)
+ */
+uint32_t sysreg_get24MHz(void)
+{
+    return pReg->SYS_24MHZ;
+}
+
+
+/**
+ * Address of the 24 MHz counter, allows time critical code to
+ * read it without the overhead of a function call.
+ *
+ * @note Contents at this address are read only and should not be modified.
+ *
+ * @return read-only address of the SYS_24MHZ register
+ */
+const volatile uint32_t* sysreg_get24MHzAddr(void)
+{
+    return &(pReg->SYS_24MHZ);
+}
+
+
+/**
+ * Sets an oscillator's divider. The oscillators are ICST307 clock
+ * generators with the 24 MHz reference, the output frequency is:
+ *
+ *     f = 48 MHz * (VDW + 8) / ((RDW + 2) * OD)
+ *
+ * where VDW are bits 8:0 of 'val', RDW are bits 15:9 and bits 18:16
+ * select the output divider OD (0: 10, 1: 2, 2: 8, 3: 4, 4: 5, 5: 7, 6: 3, 7: 6).
+ *
+ * @param osc - oscillator (between 0 and SYSREG_NR_OSCILLATORS-1)
+ * @param val - divider settings as described above
+ */
+void sysreg_setOscillator(uint8_t osc, uint32_t val)
+{
+    if ( osc >= SYSREG_NR_OSCILLATORS )
+    {
+        return;
+    }
+
+    pReg->SYS_LOCK = LOCK_KEY;
+    pReg->SYS_OSC[osc] = val & BM_OSC;
+    pReg->SYS_LOCK = 0;
+}
+
+
+/**
+ * @param osc - oscillator (between 0 and SYSREG_NR_OSCILLATORS-1)
+ *
+ * @return divider settings of the oscillator (see sysreg_setOscillator()), 0 if 'osc' is invalid
+ */
+uint32_t sysreg_getOscillator(uint8_t osc)
+{
+    return ( osc < SYSREG_NR_OSCILLATORS ? pReg->SYS_OSC[osc] & BM_OSC : 0 );
+}
+
+
+/**
+ * Sets the CLCD control register that selects the pixel format,
+ * multiplexed to the CLCD's outputs, and switches the display's
+ * power supplies.
+ *
+ * @param val - a combination of SYSREG_CLCD_*
+ */
+void sysreg_setClcdControl(uint32_t val)
+{
+    pReg->SYS_CLCD = val & BM_CLCD;
+}
+
+
+/**
+ * @return contents of the CLCD control register (only the bits, set by sysreg_setClcdControl())
+ */
+uint32_t sysreg_getClcdControl(void)
+{
+    return pReg->SYS_CLCD & BM_CLCD;
+}
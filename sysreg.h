@@ -0,0 +1,77 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions of the system registers driver.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _SYSREG_H_
+#define _SYSREG_H_
+
+#include <stdint.h>
+
+
+/* Frequency of the SYS_24MHZ counter in Hz: */
+#define SYSREG_24MHZ_FREQUENCY      24000000UL
+
+/* Frequency of the SYS_100HZ counter in Hz: */
+#define SYSREG_100HZ_FREQUENCY      100UL
+
+/* Number of programmable oscillators (SYS_OSC0 to SYS_OSC4): */
+#define SYSREG_NR_OSCILLATORS       5
+
+/* The oscillator that provides the CLCD's clock (CLCDCLK): */
+#define SYSREG_OSC_CLCD             4
+
+/* Bits of the CLCD control register (SYS_CLCD), see page 4-27 of DUI0225D: */
+#define SYSREG_CLCD_MODE_888        0x00000000     /* 24 bpp */
+#define SYSREG_CLCD_MODE_5551       0x00000001     /* 16 bpp, 5:5:5 */
+#define SYSREG_CLCD_MODE_565_RLSB   0x00000002     /* 16 bpp, 5:6:5, red at LSB */
+#define SYSREG_CLCD_MODE_565_BLSB   0x00000003     /* 16 bpp, 5:6:5, blue at LSB */
+#define SYSREG_CLCD_NLCDIOON        0x00000004     /* enables the display's I/O */
+#define SYSREG_CLCD_VDDPOSSWITCH    0x00000008     /* switches the display's positive supply on */
+#define SYSREG_CLCD_PWR3V5SWITCH    0x00000010     /* switches the display's 3.5 V supply on */
+
+
+uint32_t sysreg_getId(void);
+
+uint32_t sysreg_getSwitches(void);
+
+void sysreg_setLeds(uint32_t leds);
+
+uint32_t sysreg_getLeds(void);
+
+uint32_t sysreg_get100Hz(void);
+
+uint32_t sysreg_get24MHz(void);
+
+const volatile uint32_t* sysreg_get24MHzAddr(void);
+
+void sysreg_setOscillator(uint8_t osc, uint32_t val);
+
+uint32_t sysreg_getOscillator(uint8_t osc);
+
+void sysreg_setClcdControl(uint32_t val);
+
+uint32_t sysreg_getClcdControl(void);
+
+#endif  /* _SYSREG_H_ */
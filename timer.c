@@ -34,6 +34,9 @@ limitations under the License.
 #include <stddef.h>
 
 #include "bsp.h"
+#include "timer.h"
+#include "interrupt.h"
+#include "trace.h"
 
 
 /* Number of counters per timer: */
@@ -64,6 +67,13 @@ limitations under the License.
 #define CTL_ONESHOT         0x00000001
 
 
+/*
+ * Bit mask of the Masked Interrupt Status Register (TimerXMIS),
+ * see page 3-6 of DDI0271.
+ */
+#define MIS_INT             0x00000001
+
+
 /*
  * 32-bit registers of each counter within a timer controller.
  * See page 3-2 of DDI0271:
@@ -110,6 +120,54 @@ static volatile ARM926EJS_TIMER_REGS* const  pReg[BSP_NR_TIMERS]=
 
 #undef GEN_CAST_ADDR
 
+
+/*
+ * Callbacks of counters, called by the timer's ISR when the counter
+ * expires (see timer_registerCallback()):
+ */
+typedef struct _timerCallbackRecord
+{
+    timerCallback callback;          /* address of the callback, NULL if not registered */
+    void* param;                     /* parameter, passed to the callback */
+} timerCallbackRecord;
+
+static timerCallbackRecord __callbacks[BSP_NR_TIMERS][NR_COUNTERS];
+
+
+/*
+ * ISR of a timer's IRQ, shared by both its counters. The interrupt
+ * of each expired counter is cleared and its callback is called.
+ *
+ * @param param - timer number, casted to void*
+ */
+static void __timerIsr(void* param)
+{
+    const uint8_t timerNr = (uint8_t) (uint32_t) param;
+    const timerCallbackRecord* rec;
+    uint8_t i;
+
+    for ( i=0; i<NR_COUNTERS; ++i )
+    {
+        if ( 0 == (pReg[timerNr]->CNTR[i].MIS & MIS_INT) )
+        {
+            continue;
+        }
+
+        rec = &__callbacks[timerNr][i];
+
+        if ( NULL == rec->callback )
+        {
+            /* Nobody would handle the expiration, disable the counter's interrupt instead */
+            timer_disableInterrupt(timerNr, i);
+            continue;
+        }
+
+        timer_clearInterrupt(timerNr, i);
+        ( *rec->callback )( rec->param );
+    }
+}
+
+
 /**
  * Initializes the specified timer's counter controller.
  * The following parameters are set:
@@ -304,6 +362,37 @@ void timer_clearInterrupt(uint8_t timerNr, uint8_t counterNr)
      * See page 3-6 of DDI0271.
      */
     pReg[timerNr]->CNTR[counterNr].INTCLR = 0xFFFFFFFF;
+
+    /* The interrupt is cleared when the counter's expiry has been handled */
+    trace_event(TRACE_EV_TIMER, NR_COUNTERS*timerNr + counterNr);
+}
+
+
+/**
+ * Checks whether the specified timer's counter has a pending interrupt, i.e.
+ * it has reached 0 with interrupt triggering enabled and its interrupt has
+ * not been cleared yet.
+ *
+ * As both counters of a timer share the same IRQ, it may be used by ISRs to
+ * find out which counter(s) triggered the interrupt.
+ *
+ * Zero is returned if either 'timerNr' or 'counterNr' is invalid.
+ *
+ * @param timerNr - timer number (between 0 and 1)
+ * @param counterNr - counter number of the selected timer (between 0 and 1)
+ *
+ * @return a nonzero value (typically 1) if the interrupt is pending, 0 otherwise
+ */
+int8_t timer_isInterruptPending(uint8_t timerNr, uint8_t counterNr)
+{
+
+    /* sanity check: */
+    if ( timerNr >= BSP_NR_TIMERS || counterNr >= NR_COUNTERS )
+    {
+        return 0;
+    }
+
+    return ( pReg[timerNr]->CNTR[counterNr].MIS & MIS_INT ? 1 : 0 );
 }
 
 
@@ -313,6 +402,9 @@ void timer_clearInterrupt(uint8_t timerNr, uint8_t counterNr)
  * When the timer runs in periodic mode and its counter reaches 0,
  * the counter is reloaded to this value.
  * 
+ * As the reload takes one tick, a periodic counter expires every
+ * value+1 ticks, i.e. a period of N micro seconds is set by loading N-1.
+ * 
  * For more details, see page 3-4 of DDI0271.
  * 
  * Nothing is done if either 'timerNr' or 'counterNr' is invalid.
@@ -385,6 +477,88 @@ const volatile uint32_t* timer_getValueAddr(uint8_t timerNr, uint8_t counterNr)
 }
 
 
+/**
+ * Registers a callback, called whenever the specified counter expires
+ * (with interrupt triggering enabled), and enables the timer's IRQ.
+ *
+ * Both counters of a timer share a single IRQ. Its ISR is implemented
+ * by this driver, it clears the interrupt of each expired counter and
+ * calls the counter's callback, so each counter may be used by another
+ * driver. The priority of the latest registration applies to the IRQ.
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param timerNr - timer number (between 0 and 1)
+ * @param counterNr - counter number of the selected timer (between 0 and 1)
+ * @param callback - address of the callback
+ * @param param - parameter, passed to the callback
+ * @param priority - priority of the timer's IRQ (see pic_registerNonVectoredIrq())
+ *
+ * @return 0 on success, a negative value if any parameter is invalid or the timer's ISR could not be registered
+ */
+int8_t timer_registerCallback(uint8_t timerNr, uint8_t counterNr, timerCallback callback, void* param, uint8_t priority)
+{
+    const uint8_t irqs[BSP_NR_TIMERS] = BSP_TIMER_IRQS;
+
+    /* sanity check: */
+    if ( timerNr >= BSP_NR_TIMERS || counterNr >= NR_COUNTERS || NULL == callback )
+    {
+        return -1;
+    }
+
+    __callbacks[timerNr][counterNr].callback = callback;
+    __callbacks[timerNr][counterNr].param = param;
+
+    if ( pic_registerNonVectoredIrq(irqs[timerNr], &__timerIsr, (void*) (uint32_t) timerNr, priority) < 0 )
+    {
+        __callbacks[timerNr][counterNr].callback = NULL;
+        return -1;
+    }
+
+    pic_enableInterrupt(irqs[timerNr]);
+
+    return 0;
+}
+
+
+/**
+ * Unregisters the specified counter's callback and disables its interrupt
+ * triggering. The timer's IRQ is disabled when neither counter has a callback.
+ *
+ * Nothing is done if either 'timerNr' or 'counterNr' is invalid.
+ *
+ * @param timerNr - timer number (between 0 and 1)
+ * @param counterNr - counter number of the selected timer (between 0 and 1)
+ */
+void timer_unregisterCallback(uint8_t timerNr, uint8_t counterNr)
+{
+    const uint8_t irqs[BSP_NR_TIMERS] = BSP_TIMER_IRQS;
+    uint8_t i;
+
+    /* sanity check: */
+    if ( timerNr >= BSP_NR_TIMERS || counterNr >= NR_COUNTERS )
+    {
+        return;
+    }
+
+    timer_disableInterrupt(timerNr, counterNr);
+    __callbacks[timerNr][counterNr].callback = NULL;
+    __callbacks[timerNr][counterNr].param = NULL;
+
+    for ( i=0; i<NR_COUNTERS; ++i )
+    {
+        if ( NULL != __callbacks[timerNr][i].callback )
+        {
+            return;
+        }
+    }
+
+    pic_disableInterrupt(irqs[timerNr]);
+    pic_unregisterNonVectoredIrq(irqs[timerNr]);
+}
+
+
 /**
  * @return number of counters per timer
  */
@@ -31,6 +31,14 @@ limitations under the License.
 #include <stdint.h>
 
 
+/**
+ * Callback, called by the timer's ISR when a counter expires
+ * (see timer_registerCallback()). The counter's interrupt is
+ * already cleared when it is called.
+ */
+typedef void (*timerCallback)(void* param);
+
+
 void timer_init(uint8_t timerNr, uint8_t counterNr);
 
 void timer_start(uint8_t timerNr, uint8_t counterNr);
@@ -45,12 +53,18 @@ void timer_disableInterrupt(uint8_t timerNr, uint8_t counterNr);
 
 void timer_clearInterrupt(uint8_t timerNr, uint8_t counterNr);
 
+int8_t timer_isInterruptPending(uint8_t timerNr, uint8_t counterNr);
+
 void timer_setLoad(uint8_t timerNr, uint8_t counterNr, uint32_t value);
 
 uint32_t timer_getValue(uint8_t timerNr, uint8_t counterNr);
 
 const volatile uint32_t* timer_getValueAddr(uint8_t timerNr, uint8_t counterNr);
 
+int8_t timer_registerCallback(uint8_t timerNr, uint8_t counterNr, timerCallback callback, void* param, uint8_t priority);
+
+void timer_unregisterCallback(uint8_t timerNr, uint8_t counterNr);
+
 uint8_t timer_countersPerTimer(void);
 
 #endif  /* _TIMER_H_*/
@@ -0,0 +1,827 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the telemetry log.
+ *
+ * Pages are numbered by increasing sequence numbers (the first one is 1),
+ * a page's position within the ring follows from its sequence number.
+ * Pages of the last, incomplete batch are kept in RAM, the page being
+ * filled (the head) is always the batch's last page. tlog_sync() writes
+ * the incomplete batch, including the partially filled head, that is
+ * rewritten when further records are appended.
+ *
+ * The checkpoint stores the sequence number and the position of the first
+ * page that may not be complete on the device. The mount continues from
+ * there while pages with expected sequence numbers and valid CRCs are found.
+ * Pages of an older log in the same region are recognized by a different
+ * generation number, assigned by tlog_format().
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "tlog.h"
+#include "blk.h"
+#include "crc.h"
+#include "clocksource.h"
+#include "mem.h"
+
+
+#if ( 0 != (TLOG_INDEX_ENTRIES & (TLOG_INDEX_ENTRIES - 1)) )
+#error TLOG_INDEX_ENTRIES must be a power of 2
+#endif
+
+
+#define PAGE_MAGIC           0x544C4750      /* "TLGP" */
+#define CKPT_MAGIC           0x544C4743      /* "TLGC" */
+
+/* Sizes of headers of pages and of the checkpoint in bytes: */
+#define PAGE_HDR_SIZE        20
+#define CKPT_HDR_SIZE        32
+
+#define RECORDS_PER_PAGE     ( (BLK_SIZE - PAGE_HDR_SIZE) / sizeof(tlogRecord) )
+
+
+/*
+ * A page of records, occupies exactly one block.
+ */
+typedef struct _tlogPage
+{
+    uint32_t magic;                  /* PAGE_MAGIC */
+    uint32_t gen;                    /* generation of the log */
+    uint32_t seq;                    /* sequence number of the page */
+    uint16_t nrRecords;              /* number of valid records */
+    uint16_t reserved;
+    uint32_t crc;                    /* CRC-32 of the block, calculated with this field set to 0 */
+    tlogRecord rec[RECORDS_PER_PAGE];
+} tlogPage;
+
+
+/*
+ * An entry of the sparse index.
+ */
+typedef struct _tlogIndexEntry
+{
+    uint32_t seq;                    /* sequence number of a page, 0 if the entry is not used */
+    uint32_t ts;                     /* timestamp of its first record */
+} tlogIndexEntry;
+
+
+/*
+ * The checkpoint, occupies exactly one block.
+ */
+typedef struct _tlogCheckpoint
+{
+    uint32_t magic;                  /* CKPT_MAGIC */
+    uint32_t gen;                    /* generation of the log */
+    uint32_t nrPages;                /* number of pages in the ring */
+    uint32_t seq;                    /* the first page that may not be complete on the device */
+    uint32_t pos;                    /* its position within the ring */
+    uint32_t lastTs;                 /* timestamp of the last record in complete pages */
+    uint32_t strideShift;            /* each 2^strideShift-th page is indexed */
+    uint32_t crc;                    /* CRC-32 of the block, calculated with this field set to 0 */
+    tlogIndexEntry index[TLOG_INDEX_ENTRIES];
+    uint8_t pad[BLK_SIZE - CKPT_HDR_SIZE - TLOG_INDEX_ENTRIES * sizeof(tlogIndexEntry)];
+} tlogCheckpoint;
+
+
+/* Both structures must occupy exactly one block: */
+typedef char __tlogPageSizeCheck[ sizeof(tlogPage) == BLK_SIZE ? 1 : -1 ];
+typedef char __tlogCkptSizeCheck[ sizeof(tlogCheckpoint) == BLK_SIZE ? 1 : -1 ];
+
+
+static int8_t __mounted = 0;
+static uint32_t __base;              /* block of the checkpoint, pages follow it */
+static uint32_t __nrPages;
+static uint32_t __gen;
+static uint32_t __strideShift;
+static uint32_t __batchSeq;          /* sequence number of __batch[0] */
+static uint32_t __batchPos;          /* its position within the ring */
+static uint32_t __headSeq;           /* sequence number of the page being filled */
+static uint32_t __ckptSeq;           /* __batchSeq when the checkpoint was written */
+static uint32_t __lastTs;
+static tlogIndexEntry __index[TLOG_INDEX_ENTRIES];
+static tlogPage __batch[TLOG_BATCH_PAGES];
+static tlogPage __page;              /* the last page, read from the device */
+static uint32_t __pageSeq;           /* its sequence number, 0 if none */
+static tlogCheckpoint __ckpt;
+static tlogStats __stats;
+
+
+/*
+ * Calculates a block's CRC with its CRC field set to 0.
+ *
+ * @param blk - the block (BLK_SIZE bytes)
+ * @param crc - the block's CRC field
+ *
+ * @return CRC-32 of the block
+ */
+static uint32_t __blockCrc(const void* blk, uint32_t* crc)
+{
+    const uint32_t saved = *crc;
+    uint32_t val;
+
+    *crc = 0;
+    val = crc32(CRC32_INIT, blk, BLK_SIZE);
+    *crc = saved;
+
+    return val;
+}
+
+
+/*
+ * @param pos - a position, smaller than 2*__nrPages
+ *
+ * @return the position, wrapped into the ring
+ */
+static uint32_t __wrap(uint32_t pos)
+{
+    return ( pos >= __nrPages ? pos - __nrPages : pos );
+}
+
+
+/*
+ * @param seq - sequence number of a page within the ring
+ *
+ * @return position of the page within the ring
+ */
+static uint32_t __posOf(uint32_t seq)
+{
+    uint32_t diff;
+
+    if ( seq >= __batchSeq )
+    {
+        return __wrap(__batchPos + (seq - __batchSeq));
+    }
+
+    diff = __batchSeq - seq;
+    return ( __batchPos >= diff ? __batchPos - diff : __batchPos + __nrPages - diff );
+}
+
+
+/*
+ * @return sequence number of the oldest page within the ring
+ */
+static uint32_t __oldest(void)
+{
+    return ( __headSeq > __nrPages ? __headSeq - __nrPages + 1 : 1 );
+}
+
+
+/*
+ * Records the first timestamp of a page into the index if the page is indexed.
+ *
+ * @param seq - sequence number of the page
+ * @param ts - timestamp of its first record
+ */
+static void __setIndex(uint32_t seq, uint32_t ts)
+{
+    tlogIndexEntry* e;
+
+    if ( 0 == (seq & ((UINT32_C(1) << __strideShift) - 1)) )
+    {
+        e = &__index[(seq >> __strideShift) & (TLOG_INDEX_ENTRIES - 1)];
+        e->seq = seq;
+        e->ts = ts;
+    }
+}
+
+
+/*
+ * Prepares an empty page.
+ *
+ * @param p - the page
+ * @param seq - its sequence number
+ */
+static void __startPage(tlogPage* p, uint32_t seq)
+{
+    memset(p, 0, sizeof(tlogPage));
+    p->magic = PAGE_MAGIC;
+    p->gen = __gen;
+    p->seq = seq;
+}
+
+
+/*
+ * Reads a page from the device and checks its validity.
+ *
+ * @param seq - sequence number of the page
+ * @param page - pointer to the page is written here, NULL if the page is not valid
+ *
+ * @return TLOG_OK or TLOG_ERR_IO
+ */
+static int8_t __loadPage(uint32_t seq, const tlogPage** page)
+{
+    *page = NULL;
+
+    if ( __pageSeq != seq )
+    {
+        __pageSeq = 0;
+
+        if ( BLK_OK != blk_read(__base + 1 + __posOf(seq), &__page, 1) )
+        {
+            return TLOG_ERR_IO;
+        }
+
+        if ( PAGE_MAGIC != __page.magic || __gen != __page.gen || seq != __page.seq ||
+             0 == __page.nrRecords || __page.nrRecords > RECORDS_PER_PAGE ||
+             __page.crc != __blockCrc(&__page, &__page.crc) )
+        {
+            return TLOG_OK;
+        }
+
+        __pageSeq = seq;
+    }
+
+    *page = &__page;
+    return TLOG_OK;
+}
+
+
+/*
+ * Writes the first pages of the batch by one command (two if the ring
+ * wraps around).
+ *
+ * @param n - number of pages (max. TLOG_BATCH_PAGES)
+ *
+ * @return TLOG_OK or TLOG_ERR_IO
+ */
+static int8_t __writePages(uint32_t n)
+{
+    uint32_t i;
+    uint32_t first;
+
+    for ( i=0; i<n; ++i )
+    {
+        __batch[i].crc = __blockCrc(&__batch[i], &__batch[i].crc);
+    }
+
+    /* A page, read by a query, may be rewritten */
+    __pageSeq = 0;
+
+    first = ( n < __nrPages - __batchPos ? n : __nrPages - __batchPos );
+
+    ++__stats.devWrites;
+    if ( BLK_OK != blk_write(__base + 1 + __batchPos, __batch, first) )
+    {
+        return TLOG_ERR_IO;
+    }
+
+    if ( first < n )
+    {
+        ++__stats.devWrites;
+        if ( BLK_OK != blk_write(__base + 1, &__batch[first], n - first) )
+        {
+            return TLOG_ERR_IO;
+        }
+    }
+
+    __stats.pageWrites += n;
+
+    return TLOG_OK;
+}
+
+
+/*
+ * Removes the first pages from the batch, the remaining ones are moved
+ * to its beginning.
+ *
+ * @param n - number of removed pages
+ */
+static void __dropPages(uint32_t n)
+{
+    uint32_t i;
+
+    for ( i=n; i <= __headSeq - __batchSeq; ++i )
+    {
+        memcpy(&__batch[i-n], &__batch[i], sizeof(tlogPage));
+    }
+
+    __batchSeq += n;
+    __batchPos = __wrap(__batchPos + n);
+}
+
+
+/*
+ * Writes the checkpoint.
+ *
+ * @return TLOG_OK or TLOG_ERR_IO
+ */
+static int8_t __writeCheckpoint(void)
+{
+    memset(&__ckpt, 0, sizeof(__ckpt));
+    __ckpt.magic = CKPT_MAGIC;
+    __ckpt.gen = __gen;
+    __ckpt.nrPages = __nrPages;
+    __ckpt.seq = __batchSeq;
+    __ckpt.pos = __batchPos;
+    __ckpt.lastTs = __lastTs;
+    __ckpt.strideShift = __strideShift;
+    memcpy(__ckpt.index, __index, sizeof(__index));
+    __ckpt.crc = __blockCrc(&__ckpt, &__ckpt.crc);
+
+    ++__stats.devWrites;
+    if ( BLK_OK != blk_write(__base, &__ckpt, 1) )
+    {
+        return TLOG_ERR_IO;
+    }
+
+    ++__stats.checkpoints;
+    __ckptSeq = __batchSeq;
+
+    return TLOG_OK;
+}
+
+
+/*
+ * Reads the checkpoint and checks its validity.
+ *
+ * @param firstBlock - the checkpoint's block
+ *
+ * @return TLOG_OK if the checkpoint is valid, TLOG_ERR_NOLOG if it is not, TLOG_ERR_IO
+ */
+static int8_t __readCheckpoint(uint32_t firstBlock)
+{
+    if ( BLK_OK != blk_read(firstBlock, &__ckpt, 1) )
+    {
+        return TLOG_ERR_IO;
+    }
+
+    if ( CKPT_MAGIC != __ckpt.magic || __ckpt.crc != __blockCrc(&__ckpt, &__ckpt.crc) )
+    {
+        return TLOG_ERR_NOLOG;
+    }
+
+    return TLOG_OK;
+}
+
+
+/*
+ * Completes the head page: the batch is written if it is full, and the
+ * next page becomes the head.
+ *
+ * @return TLOG_OK or TLOG_ERR_IO (the head remains full, the write is retried later)
+ */
+static int8_t __completeHead(void)
+{
+    int8_t rc = TLOG_OK;
+    uint32_t ckptPages;
+
+    if ( TLOG_BATCH_PAGES - 1 == __headSeq - __batchSeq )
+    {
+        if ( TLOG_OK != __writePages(TLOG_BATCH_PAGES) )
+        {
+            return TLOG_ERR_IO;
+        }
+
+        __dropPages(TLOG_BATCH_PAGES);
+
+        /*
+         * In a small ring, the checkpoint must be written before the next
+         * batch overwrites its page, the mount's scan starts there.
+         */
+        ckptPages = __nrPages - TLOG_BATCH_PAGES;
+        if ( ckptPages > TLOG_CHECKPOINT_PAGES )
+        {
+            ckptPages = TLOG_CHECKPOINT_PAGES;
+        }
+
+        if ( __batchSeq - __ckptSeq >= ckptPages )
+        {
+            rc = __writeCheckpoint();
+        }
+    }
+
+    ++__headSeq;
+    __startPage(&__batch[__headSeq - __batchSeq], __headSeq);
+
+    return rc;
+}
+
+
+/*
+ * Checks the size of a log's region.
+ *
+ * @return TLOG_OK or TLOG_ERR_PARAM
+ */
+static int8_t __checkRegion(uint32_t firstBlock, uint32_t nrBlocks)
+{
+    const uint32_t nr = blk_getNrBlocks();
+
+    if ( nrBlocks < TLOG_MIN_BLOCKS || firstBlock >= nr || nrBlocks > nr - firstBlock )
+    {
+        return TLOG_ERR_PARAM;
+    }
+
+    return TLOG_OK;
+}
+
+
+/**
+ * Creates an empty log in the region and mounts it. Any previous log in
+ * the region is discarded.
+ *
+ * @param firstBlock - the region's first block
+ * @param nrBlocks - number of the region's blocks (at least TLOG_MIN_BLOCKS)
+ *
+ * @return TLOG_OK on success, TLOG_ERR_PARAM or TLOG_ERR_IO
+ */
+int8_t tlog_format(uint32_t firstBlock, uint32_t nrBlocks)
+{
+    uint32_t i;
+    int8_t rc;
+
+    __mounted = 0;
+
+    rc = __checkRegion(firstBlock, nrBlocks);
+    if ( TLOG_OK != rc )
+    {
+        return rc;
+    }
+
+    /* Pages of the previous log must not be recognized as pages of the new one */
+    rc = __readCheckpoint(firstBlock);
+    if ( TLOG_ERR_IO == rc )
+    {
+        return rc;
+    }
+
+    clocksource_init();
+    __gen = ( TLOG_OK == rc ? __ckpt.gen + 1 : clocksource_read() );
+
+    __base = firstBlock;
+    __nrPages = nrBlocks - 1;
+    for ( __strideShift=0; ((uint32_t) TLOG_INDEX_ENTRIES << __strideShift) < __nrPages; ++__strideShift );
+
+    for ( i=0; i<TLOG_INDEX_ENTRIES; ++i )
+    {
+        __index[i].seq = 0;
+        __index[i].ts = 0;
+    }
+
+    __batchSeq = 1;
+    __batchPos = 0;
+    __headSeq = 1;
+    __lastTs = 0;
+    __pageSeq = 0;
+    __startPage(&__batch[0], __headSeq);
+    memset(&__stats, 0, sizeof(__stats));
+
+    rc = __writeCheckpoint();
+    __mounted = ( TLOG_OK == rc ? 1 : 0 );
+
+    return rc;
+}
+
+
+/**
+ * Mounts the log in the region. Pages, written after the last checkpoint,
+ * are scanned. Records that were not written to the device (see tlog_sync())
+ * are lost.
+ *
+ * @param firstBlock - the region's first block
+ * @param nrBlocks - number of the region's blocks (must be equal to the one, passed to tlog_format())
+ *
+ * @return TLOG_OK on success, TLOG_ERR_NOLOG if no valid log is found, TLOG_ERR_PARAM or TLOG_ERR_IO
+ */
+int8_t tlog_mount(uint32_t firstBlock, uint32_t nrBlocks)
+{
+    const tlogPage* pg;
+    uint32_t i;
+    int8_t rc;
+
+    __mounted = 0;
+    memset(&__stats, 0, sizeof(__stats));
+
+    rc = __checkRegion(firstBlock, nrBlocks);
+    if ( TLOG_OK == rc )
+    {
+        rc = __readCheckpoint(firstBlock);
+    }
+    if ( TLOG_OK != rc )
+    {
+        return rc;
+    }
+
+    if ( __ckpt.nrPages != nrBlocks - 1 || __ckpt.pos >= __ckpt.nrPages ||
+         0 == __ckpt.seq || __ckpt.strideShift > 31 )
+    {
+        return TLOG_ERR_NOLOG;
+    }
+
+    __base = firstBlock;
+    __nrPages = __ckpt.nrPages;
+    __gen = __ckpt.gen;
+    __strideShift = __ckpt.strideShift;
+    __batchSeq = __ckpt.seq;
+    __batchPos = __ckpt.pos;
+    __headSeq = __ckpt.seq;
+    __ckptSeq = __ckpt.seq;
+    __lastTs = __ckpt.lastTs;
+    __pageSeq = 0;
+
+    /* Pages from the checkpoint on are indexed again by the scan */
+    for ( i=0; i<TLOG_INDEX_ENTRIES; ++i )
+    {
+        __index[i] = __ckpt.index[i];
+        if ( __index[i].seq >= __ckpt.seq )
+        {
+            __index[i].seq = 0;
+        }
+    }
+
+    /* Scan complete pages after the checkpoint */
+    for ( ; ; )
+    {
+        rc = __loadPage(__headSeq, &pg);
+        ++__stats.mountScanned;
+        if ( TLOG_OK != rc )
+        {
+            return rc;
+        }
+
+        if ( NULL == pg || pg->nrRecords < RECORDS_PER_PAGE )
+        {
+            break;  /* out of for */
+        }
+
+        __setIndex(__headSeq, pg->rec[0].ts);
+        __lastTs = pg->rec[RECORDS_PER_PAGE - 1].ts;
+        ++__headSeq;
+        __dropPages(1);
+    }
+
+    /* A partially filled page becomes the head */
+    if ( NULL != pg )
+    {
+        memcpy(&__batch[0], pg, sizeof(tlogPage));
+        __setIndex(__headSeq, pg->rec[0].ts);
+        __lastTs = pg->rec[pg->nrRecords - 1].ts;
+    }
+    else
+    {
+        __startPage(&__batch[0], __headSeq);
+    }
+
+    __mounted = 1;
+
+    return TLOG_OK;
+}
+
+
+/**
+ * Appends a record to the log. The record is only written to the device
+ * when its batch of pages is full or by tlog_sync().
+ *
+ * @param ts - timestamp, must not be smaller than the previous one
+ * @param channel - source of the value
+ * @param flags - application defined flags
+ * @param value - the value
+ *
+ * @return TLOG_OK on success, one of TLOG_ERR_* otherwise (TLOG_ERR_IO if the full batch could not be written, the record is appended nevertheless)
+ */
+int8_t tlog_append(uint32_t ts, uint16_t channel, uint16_t flags, uint32_t value)
+{
+    tlogPage* p;
+    tlogRecord* r;
+
+    if ( 0 == __mounted )
+    {
+        return TLOG_ERR_NOLOG;
+    }
+
+    if ( ts < __lastTs )
+    {
+        return TLOG_ERR_PARAM;
+    }
+
+    /* Retry a batch that could not be written */
+    p = &__batch[__headSeq - __batchSeq];
+    if ( RECORDS_PER_PAGE == p->nrRecords )
+    {
+        if ( TLOG_ERR_IO == __completeHead() && RECORDS_PER_PAGE == __batch[__headSeq - __batchSeq].nrRecords )
+        {
+            return TLOG_ERR_IO;
+        }
+
+        p = &__batch[__headSeq - __batchSeq];
+    }
+
+    if ( 0 == p->nrRecords )
+    {
+        __setIndex(__headSeq, ts);
+    }
+
+    r = &p->rec[p->nrRecords++];
+    r->ts = ts;
+    r->channel = channel;
+    r->flags = flags;
+    r->value = value;
+
+    __lastTs = ts;
+    ++__stats.records;
+
+    return ( RECORDS_PER_PAGE == p->nrRecords ? __completeHead() : TLOG_OK );
+}
+
+
+/**
+ * Writes all appended records to the device, followed by the checkpoint.
+ *
+ * @return TLOG_OK on success, TLOG_ERR_NOLOG or TLOG_ERR_IO
+ */
+int8_t tlog_sync(void)
+{
+    uint32_t full;
+    uint32_t n;
+    int8_t rc;
+
+    if ( 0 == __mounted )
+    {
+        return TLOG_ERR_NOLOG;
+    }
+
+    full = __headSeq - __batchSeq;
+    n = full + ( __batch[full].nrRecords > 0 ? 1 : 0 );
+    if ( n > 0 )
+    {
+        rc = __writePages(n);
+        if ( TLOG_OK != rc )
+        {
+            return rc;
+        }
+    }
+
+    /* The (partially filled) head remains in the batch */
+    __dropPages(full);
+
+    return __writeCheckpoint();
+}
+
+
+/**
+ * Starts a query of records with timestamps within a range. The first
+ * page to read is found by the sparse index.
+ *
+ * @param cursor - the query's state
+ * @param from - the lowest timestamp
+ * @param to - the highest timestamp
+ *
+ * @return TLOG_OK on success, TLOG_ERR_PARAM or TLOG_ERR_NOLOG
+ */
+int8_t tlog_seek(tlogCursor* cursor, uint32_t from, uint32_t to)
+{
+    const uint32_t oldest = __oldest();
+    uint32_t start = oldest;
+    uint32_t i;
+
+    if ( 0 == __mounted )
+    {
+        return TLOG_ERR_NOLOG;
+    }
+
+    if ( NULL == cursor || from > to )
+    {
+        return TLOG_ERR_PARAM;
+    }
+
+    /*
+     * Start at the latest indexed page whose first record is older than 'from'.
+     * All records of preceding pages are older as well.
+     */
+    for ( i=0; i<TLOG_INDEX_ENTRIES; ++i )
+    {
+        if ( __index[i].seq > start && __index[i].seq <= __headSeq && __index[i].ts < from )
+        {
+            start = __index[i].seq;
+        }
+    }
+
+    cursor->seq = start;
+    cursor->idx = 0;
+    cursor->from = from;
+    cursor->to = to;
+
+    return TLOG_OK;
+}
+
+
+/**
+ * Returns the next record of a query. Records, appended after the end of
+ * the log was reached, are returned by further calls (if they are within
+ * the range).
+ *
+ * Pages with invalid CRCs are skipped.
+ *
+ * @param cursor - the query's state, initialized by tlog_seek()
+ * @param rec - the record is copied here
+ *
+ * @return TLOG_OK if a record was found, TLOG_END if there are no more records, one of TLOG_ERR_* otherwise
+ */
+int8_t tlog_next(tlogCursor* cursor, tlogRecord* rec)
+{
+    const tlogPage* pg;
+    const tlogRecord* r;
+    int8_t rc;
+
+    if ( 0 == __mounted )
+    {
+        return TLOG_ERR_NOLOG;
+    }
+
+    if ( NULL == cursor || NULL == rec )
+    {
+        return TLOG_ERR_PARAM;
+    }
+
+    for ( ; ; )
+    {
+        /* The page may have been overwritten in the meantime */
+        if ( cursor->seq < __oldest() )
+        {
+            cursor->seq = __oldest();
+            cursor->idx = 0;
+        }
+
+        if ( cursor->seq >= __batchSeq )
+        {
+            pg = &__batch[cursor->seq - __batchSeq];
+        }
+        else
+        {
+            rc = __loadPage(cursor->seq, &pg);
+            if ( TLOG_OK != rc )
+            {
+                return rc;
+            }
+
+            if ( NULL == pg )
+            {
+                ++__stats.crcErrors;
+                ++cursor->seq;
+                cursor->idx = 0;
+                continue;
+            }
+        }
+
+        if ( cursor->idx >= pg->nrRecords )
+        {
+            if ( cursor->seq == __headSeq )
+            {
+                return TLOG_END;
+            }
+
+            ++cursor->seq;
+            cursor->idx = 0;
+            continue;
+        }
+
+        r = &pg->rec[cursor->idx];
+        if ( r->ts > cursor->to )
+        {
+            return TLOG_END;
+        }
+
+        ++cursor->idx;
+        if ( r->ts >= cursor->from )
+        {
+            *rec = *r;
+            return TLOG_OK;
+        }
+    }
+}
+
+
+/**
+ * Copies the log's statistics. They are reset when the log is formatted
+ * or mounted.
+ *
+ * @param stats - the statistics are copied here
+ */
+void tlog_getStats(tlogStats* stats)
+{
+    if ( NULL != stats )
+    {
+        *stats = __stats;
+    }
+}
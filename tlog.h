@@ -0,0 +1,124 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the telemetry log, an
+ * append-only, log-structured store of fixed-size records.
+ *
+ * The log occupies a region of consecutive blocks of the block device
+ * (see blk.h), that must not be accessed by anything else (including
+ * the block cache). The region's first block is a checkpoint, all other
+ * blocks are pages of a ring. Records are collected into pages, protected
+ * by a CRC, and TLOG_BATCH_PAGES full pages are written by a single
+ * command. When the ring is full, the oldest pages are overwritten.
+ *
+ * A sparse index (the first timestamp of every n-th page) is kept in RAM
+ * and saved into the checkpoint every TLOG_CHECKPOINT_PAGES pages (before
+ * the ring wraps over it in smaller rings) and by tlog_sync(). When the
+ * log is mounted, only pages written after the last checkpoint are scanned.
+ *
+ * Timestamps of appended records must not decrease, so records within a
+ * time range can be found by the index. The log is not reentrant and
+ * must not be accessed from ISRs.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _TLOG_H_
+#define _TLOG_H_
+
+#include <stdint.h>
+
+
+/* Number of full pages, written to the device by a single command: */
+#define TLOG_BATCH_PAGES         4
+
+/* Number of entries of the sparse index, must be a power of 2: */
+#define TLOG_INDEX_ENTRIES       32
+
+/* The checkpoint is written after (at least) this number of pages: */
+#define TLOG_CHECKPOINT_PAGES    64
+
+/* Min. number of blocks of the log's region: */
+#define TLOG_MIN_BLOCKS          ( 2 * TLOG_BATCH_PAGES + 1 )
+
+
+/* Return values of tlog_* functions: */
+#define TLOG_OK                  0
+#define TLOG_END                 1     /* no more records within the range (tlog_next()) */
+#define TLOG_ERR_PARAM          -1     /* invalid parameter, e.g. a decreasing timestamp */
+#define TLOG_ERR_NOLOG          -2     /* the log is not mounted or no (valid) log found */
+#define TLOG_ERR_IO             -3     /* the block device reported an error */
+
+
+/**
+ * A record of the log.
+ */
+typedef struct _tlogRecord
+{
+    uint32_t ts;                  /* timestamp, must not decrease */
+    uint16_t channel;             /* source of the value (application defined) */
+    uint16_t flags;               /* application defined */
+    uint32_t value;               /* e.g. a counter or a sample */
+} tlogRecord;
+
+
+/**
+ * Position of a query of records within a time range (see tlog_seek()).
+ * Should only be accessed via tlog_* functions.
+ */
+typedef struct _tlogCursor
+{
+    uint32_t seq;                 /* sequence number of the current page */
+    uint32_t idx;                 /* index of the next record within the page */
+    uint32_t from;                /* range of timestamps */
+    uint32_t to;
+} tlogCursor;
+
+
+/**
+ * Statistics of the log.
+ */
+typedef struct _tlogStats
+{
+    uint32_t records;             /* appended records */
+    uint32_t pageWrites;          /* pages, written to the device (including rewrites of partial pages) */
+    uint32_t devWrites;           /* write commands, issued to the device (including checkpoints) */
+    uint32_t checkpoints;         /* written checkpoints */
+    uint32_t mountScanned;        /* pages, read when the log was mounted */
+    uint32_t crcErrors;           /* pages with invalid CRCs, skipped by queries */
+} tlogStats;
+
+
+int8_t tlog_format(uint32_t firstBlock, uint32_t nrBlocks);
+
+int8_t tlog_mount(uint32_t firstBlock, uint32_t nrBlocks);
+
+int8_t tlog_append(uint32_t ts, uint16_t channel, uint16_t flags, uint32_t value);
+
+int8_t tlog_sync(void);
+
+int8_t tlog_seek(tlogCursor* cursor, uint32_t from, uint32_t to);
+
+int8_t tlog_next(tlogCursor* cursor, tlogRecord* rec);
+
+void tlog_getStats(tlogStats* stats);
+
+#endif  /* _TLOG_H_ */
@@ -0,0 +1,230 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Implementation of the event trace buffer.
+ *
+ * Records are logged by the inline function trace_event() (see trace.h),
+ * this file implements initialization, control and output of the buffer.
+ *
+ * The ring index is never reset (except by trace_init() and trace_clear()),
+ * so the number of overwritten records is known. The CPU has a single core,
+ * so a single ring is sufficient.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "trace.h"
+#include "clocksource.h"
+#include "uart.h"
+
+
+#define BM_IDX            ( TRACE_NR_RECORDS - 1 )
+
+#if ( 0 != (TRACE_NR_RECORDS & BM_IDX) )
+#error TRACE_NR_RECORDS must be a power of 2
+#endif
+
+
+/* State of the buffer, accessed by trace_event(): */
+traceRecord _trace_ring[TRACE_NR_RECORDS];
+volatile uint32_t _trace_head = 0;
+volatile int8_t _trace_enabled = 0;
+const volatile uint32_t* _trace_clock = NULL;
+uint32_t _trace_clockMask = 0;
+
+
+/*
+ * Converts the lowest 'digits' nibbles of a value into HEX digits.
+ * The string is not terminated.
+ *
+ * @param buf - pointer to a string buffer (at least 'digits' characters)
+ * @param val - value to be converted
+ * @param digits - number of HEX digits
+ */
+static void __toHex(char* buf, uint32_t val, uint8_t digits)
+{
+    uint8_t digit;
+
+    while ( digits > 0 )
+    {
+        digit = (uint8_t) (val & 0x0F);
+        buf[--digits] = ( digit<10 ? '0' + digit : 'A' + digit - 10 );
+        val >>= 4;
+    }
+}
+
+
+/**
+ * Initializes the trace buffer and the clock that provides timestamps.
+ * Tracing remains disabled until trace_enable() is called.
+ */
+void trace_init(void)
+{
+    _trace_enabled = 0;
+    _trace_head = 0;
+
+    clocksource_init();
+    _trace_clock = clocksource_getCounterAddr();
+    _trace_clockMask = clocksource_getCounterMask();
+}
+
+
+/**
+ * Enables logging of events.
+ *
+ * Nothing is done if the buffer has not been initialized yet.
+ */
+void trace_enable(void)
+{
+    if ( NULL != _trace_clock )
+    {
+        _trace_enabled = 1;
+    }
+}
+
+
+/**
+ * Disables logging of events. Already logged records are preserved.
+ */
+void trace_disable(void)
+{
+    _trace_enabled = 0;
+}
+
+
+/**
+ * @return a nonzero value (typically 1) if logging of events is enabled, 0 otherwise
+ */
+int8_t trace_isEnabled(void)
+{
+    return _trace_enabled;
+}
+
+
+/**
+ * Discards all logged records.
+ */
+void trace_clear(void)
+{
+    _trace_head = 0;
+}
+
+
+/**
+ * @return number of records available in the ring (max. TRACE_NR_RECORDS)
+ */
+uint32_t trace_getNrRecords(void)
+{
+    const uint32_t head = _trace_head;
+
+    return ( head > TRACE_NR_RECORDS ? TRACE_NR_RECORDS : head );
+}
+
+
+/**
+ * Returns a record from the ring, the oldest available record has index 0.
+ *
+ * NULL is returned if 'idx' is invalid, i.e. not smaller than trace_getNrRecords().
+ *
+ * @param idx - index of the record
+ *
+ * @return pointer to the record or NULL
+ */
+const traceRecord* trace_getRecord(uint32_t idx)
+{
+    const uint32_t head = _trace_head;
+    const uint32_t nr = ( head > TRACE_NR_RECORDS ? TRACE_NR_RECORDS : head );
+
+    if ( idx >= nr )
+    {
+        return NULL;
+    }
+
+    return &_trace_ring[(head - nr + idx) & BM_IDX];
+}
+
+
+/**
+ * Emits all available records to the specified UART in the following
+ * (machine readable) format:
+ *
+ *     TRACE BEGIN records=<n> lost=<n> freq=<clock frequency in Hz>
+ *     TR <timestamp> <event> <arg>
+ *     ...
+ *     TRACE END
+ *
+ * All values of "TR" lines are HEX numbers (8, 4 and 4 digits), without
+ * the "0x" prefix. Records are emitted from the oldest to the newest one.
+ *
+ * Logging is disabled during the dump and restored afterwards.
+ *
+ * @param uart - number of the UART (between 0 and 2)
+ */
+void trace_dump(uint8_t uart)
+{
+    const int8_t enabled = _trace_enabled;
+    const traceRecord* rec;
+    uint32_t nr;
+    uint32_t i;
+    char buf[24];
+
+    _trace_enabled = 0;
+
+    nr = trace_getNrRecords();
+
+    uart_print(uart, "TRACE BEGIN records=0x");
+    __toHex(buf, nr, 8);
+    buf[8] = '\0';
+    uart_print(uart, buf);
+    uart_print(uart, " lost=0x");
+    __toHex(buf, _trace_head - nr, 8);
+    uart_print(uart, buf);
+    uart_print(uart, " freq=0x");
+    __toHex(buf, clocksource_getFrequency(), 8);
+    uart_print(uart, buf);
+    uart_print(uart, "\r\n");
+
+    /* "TR tttttttt eeee aaaa\r\n" */
+    buf[0] = 'T';
+    buf[1] = 'R';
+    buf[2] = ' ';
+    buf[11] = ' ';
+    buf[16] = ' ';
+    buf[21] = '\r';
+    buf[22] = '\n';
+    buf[23] = '\0';
+
+    for ( i=0; i<nr; ++i )
+    {
+        rec = trace_getRecord(i);
+        __toHex(buf+3, rec->ts, 8);
+        __toHex(buf+12, rec->event, 4);
+        __toHex(buf+17, rec->arg, 4);
+        uart_print(uart, buf);
+    }
+
+    uart_print(uart, "TRACE END\r\n");
+
+    _trace_enabled = enabled;
+}
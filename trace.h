@@ -0,0 +1,146 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * Declaration of public functions and types of the event trace buffer.
+ *
+ * Events are logged as compact 8-byte records (timestamp, event ID and
+ * argument) into a ring buffer. When the ring is full, the oldest records
+ * are overwritten. trace_dump() emits the ring to a UART, the host script
+ * trace2chrome.py converts the output into the Chrome trace (JSON) format.
+ *
+ * A trace point is an inline function that only costs a few instructions
+ * (a check of the enable flag, an increment of the ring index, a read of
+ * the clock's counter and three stores). Trace points are compiled out
+ * completely if TRACE_DISABLE is defined.
+ *
+ * @author Jernej Kovacic
+ */
+
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+
+
+/* Number of records in the ring, must be a power of 2: */
+#define TRACE_NR_RECORDS       1024
+
+
+/* IDs of events, logged by the drivers: */
+#define TRACE_EV_IRQ_ENTRY     0x0001    /* arg: IRQ (TRACE_IRQ_UNKNOWN if not known) */
+#define TRACE_EV_IRQ_EXIT      0x0002    /* arg: IRQ (TRACE_IRQ_UNKNOWN if not known) */
+#define TRACE_EV_CTX_SWITCH    0x0003    /* arg: ID of the task being switched to (TRACE_CTX_*) */
+#define TRACE_EV_UART_QUEUED   0x0004    /* arg: UART number, a string has been queued for transmission */
+#define TRACE_EV_TIMER         0x0005    /* arg: 2*timer + counter, the counter has expired */
+#define TRACE_EV_MARKER        0x0006    /* arg: user defined */
+
+/* IDs of user defined events start at: */
+#define TRACE_EV_USER          0x0100
+
+/* Argument of IRQ events if the IRQ could not be determined: */
+#define TRACE_IRQ_UNKNOWN      0xFFFF
+
+/* Argument of IRQ events of the SIC's cascaded sources: */
+#define TRACE_IRQ_SIC(N)       ( 0x0100 | (N) )
+
+/* Argument of context switch events, the job of a cyclic executive's frame or an EDF task: */
+#define TRACE_CTX_CYCLIC(N)    ( 0x0100 | (N) )
+#define TRACE_CTX_EDF(N)       ( 0x0200 | (N) )
+
+
+/**
+ * A trace record.
+ */
+typedef struct _traceRecord
+{
+    uint32_t ts;                  /* timestamp in clock ticks (see clocksource.h) */
+    uint16_t event;               /* event ID, one of TRACE_EV_* */
+    uint16_t arg;                 /* event's argument */
+} traceRecord;
+
+
+void trace_init(void);
+
+void trace_enable(void);
+
+void trace_disable(void);
+
+int8_t trace_isEnabled(void);
+
+void trace_clear(void);
+
+uint32_t trace_getNrRecords(void);
+
+const traceRecord* trace_getRecord(uint32_t idx);
+
+void trace_dump(uint8_t uart);
+
+
+/*
+ * State of the trace buffer, only accessed directly by trace_event().
+ * It should not be accessed by any other code.
+ */
+extern traceRecord _trace_ring[TRACE_NR_RECORDS];
+extern volatile uint32_t _trace_head;
+extern volatile int8_t _trace_enabled;
+extern const volatile uint32_t* _trace_clock;
+extern uint32_t _trace_clockMask;
+
+
+/**
+ * Logs an event into the trace buffer (if tracing is enabled).
+ *
+ * @note The function may be called from ISRs and tasks. If an ISR logs an event
+ * while a task is logging another one, one of both records may be lost,
+ * however the buffer remains consistent.
+ *
+ * @param event - event ID (one of TRACE_EV_* or a user defined ID)
+ * @param arg - event's argument
+ */
+static inline void trace_event(uint16_t event, uint16_t arg)
+{
+#ifndef TRACE_DISABLE
+    traceRecord* rec;
+
+    if ( 0 == _trace_enabled )
+    {
+        return;
+    }
+
+    rec = &_trace_ring[_trace_head++ & (TRACE_NR_RECORDS - 1)];
+    rec->ts = *_trace_clock ^ _trace_clockMask;
+    rec->event = event;
+    rec->arg = arg;
+#endif
+}
+
+
+/**
+ * Logs a user defined marker.
+ *
+ * @param arg - marker's argument
+ */
+static inline void trace_marker(uint16_t arg)
+{
+    trace_event(TRACE_EV_MARKER, arg);
+}
+
+#endif  /* _TRACE_H_ */
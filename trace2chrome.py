@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+#
+# Copyright 2013, Jernej Kovacic
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Usage: trace2chrome.py [options] [uart_log]
+
+Converts an event trace, dumped by trace_dump() (see trace.h), into the Chrome
+trace (JSON) format that can be opened by chrome://tracing or Perfetto.
+
+- The trace is parsed from the captured UART output (bench_output.txt by default,
+  see run_bench.py). Anything before "TRACE BEGIN" and after "TRACE END" is ignored.
+  If the output contains several dumps, the last one is converted.
+- Timestamps are converted to microseconds using the clock frequency from the
+  dump's header. The 32-bit clock may wrap around during the trace, this is
+  compensated, as long as consecutive records are less than one wrap period apart.
+- IRQ entry/exit records are converted into duration events (one track per IRQ),
+  all other records into instant events.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+
+BEGIN_RE = re.compile(r"^TRACE BEGIN records=0x([0-9A-F]+) lost=0x([0-9A-F]+) freq=0x([0-9A-F]+)\s*$")
+RECORD_RE = re.compile(r"^TR ([0-9A-F]{8}) ([0-9A-F]{4}) ([0-9A-F]{4})\s*$")
+END_MARKER = "TRACE END"
+
+# Event IDs, must match TRACE_EV_* in trace.h:
+EV_IRQ_ENTRY = 0x0001
+EV_IRQ_EXIT = 0x0002
+EV_CTX_SWITCH = 0x0003
+EV_UART_QUEUED = 0x0004
+EV_TIMER = 0x0005
+EV_MARKER = 0x0006
+EV_USER = 0x0100
+
+IRQ_UNKNOWN = 0xFFFF
+
+EVENT_NAMES = {
+    EV_CTX_SWITCH: "ctx_switch",
+    EV_UART_QUEUED: "uart_queued",
+    EV_TIMER: "timer",
+    EV_MARKER: "marker",
+}
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Converts an event trace dump into the Chrome trace format.")
+    parser.add_argument("uart_log", nargs="?", default="bench_output.txt",
+                        help="captured UART output (default: %(default)s)")
+    parser.add_argument("-o", "--output", default="trace.json",
+                        help="Chrome trace file (default: %(default)s)")
+    return parser.parse_args()
+
+
+def parse_dump(lines):
+    """
+    Parses the last trace dump in 'lines' and returns a tuple
+    (frequency, number of lost records, list of (timestamp, event, arg)).
+    Returns None if no complete dump is found.
+    """
+
+    dump = None
+    current = None
+    for line in lines:
+        line = line.strip()
+        match = BEGIN_RE.match(line)
+        if match:
+            current = (int(match.group(3), 16), int(match.group(2), 16), [])
+            continue
+        if current is None:
+            continue
+        if line == END_MARKER:
+            dump = current
+            current = None
+            continue
+        match = RECORD_RE.match(line)
+        if match:
+            current[2].append(tuple(int(g, 16) for g in match.groups()))
+    return dump
+
+
+def unwrap(records):
+    """
+    Converts 32-bit timestamps into monotonic ones.
+    """
+
+    result = []
+    base = 0
+    prev = None
+    for ts, event, arg in records:
+        if prev is not None and ts < prev:
+            base += 1 << 32
+        prev = ts
+        result.append((base + ts, event, arg))
+    return result
+
+
+def irq_name(arg):
+    return "IRQ ?" if arg == IRQ_UNKNOWN else "IRQ %d" % arg
+
+
+def convert(freq, records):
+    """
+    Converts records into a list of Chrome trace events.
+    """
+
+    events = []
+    if not records:
+        return events
+
+    start = records[0][0]
+    for ts, event, arg in records:
+        us = (ts - start) * 1e6 / freq
+        common = {"ts": us, "pid": 0}
+        if event in (EV_IRQ_ENTRY, EV_IRQ_EXIT):
+            # one track (thread) per IRQ, tid 0 is reserved for instant events
+            events.append(dict(common, name=irq_name(arg), cat="irq",
+                               ph="B" if event == EV_IRQ_ENTRY else "E",
+                               tid=1 + (arg if arg != IRQ_UNKNOWN else 32)))
+        else:
+            name = EVENT_NAMES.get(event, "user_%04x" % event if event >= EV_USER else "event_%04x" % event)
+            events.append(dict(common, name=name, cat="event", ph="i", s="t", tid=0,
+                               args={"arg": arg}))
+    return events
+
+
+def main():
+    args = parse_args()
+
+    with open(args.uart_log, errors="replace") as f:
+        dump = parse_dump(f.readlines())
+
+    if dump is None:
+        print("ERROR: no complete trace dump found in %s" % args.uart_log)
+        return 2
+
+    freq, lost, records = dump
+    if 0 == freq:
+        print("ERROR: invalid clock frequency in the trace dump")
+        return 2
+
+    trace = {
+        "traceEvents": convert(freq, unwrap(records)),
+        "displayTimeUnit": "ns",
+        "otherData": {"clock_hz": freq, "lost_records": lost},
+    }
+
+    with open(args.output, "w") as f:
+        json.dump(trace, f, indent=1)
+        f.write("\n")
+
+    print("%d record(s) converted (%d lost), written to %s" % (len(records), lost, args.output))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -19,6 +19,15 @@ limitations under the License.
  * 
  * Implementation of the board's UART functionality.
  * All 3 UARTs are supported.
+ *
+ * Received characters are moved from the receive FIFO into a ring buffer
+ * of each UART. At low rates, the FIFO is drained by the UART's ISR,
+ * triggered when the FIFO is half full or a receive timeout occurs.
+ * If a poll timer is assigned (see uart_rxUsePollTimer()) and the rate
+ * of receive interrupts exceeds a threshold, the receive interrupts are
+ * masked and the FIFO is drained periodically by the timer's ISR, a
+ * limited number of characters at a time. When the line goes quiet,
+ * the timer is stopped and the receive interrupts are unmasked again.
  * 
  * More info about the board and the UART controller:
  * - Versatile Application Baseboard for ARM926EJ-S, HBI 0118 (DUI0225D):
@@ -34,6 +43,30 @@ limitations under the License.
 #include <stdbool.h>
 
 #include "bsp.h"
+#include "uart.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "clocksource.h"
+#include "trace.h"
+
+
+#if ( 0 != (UART_RX_BUF_SIZE & (UART_RX_BUF_SIZE - 1)) )
+#error UART_RX_BUF_SIZE must be a power of 2
+#endif
+
+
+/*
+ * Reads of the data register pop the oldest character of the receive FIFO.
+ *
+ * In the host (unit test) build, reads of plain memory have no side effects,
+ * so the simulated controller is notified instead.
+ */
+#ifdef BSP_HOST_SIM
+extern uint32_t sim_uartRead(uint8_t nr);
+#define DATA_READ(NR)         sim_uartRead(NR)
+#else
+#define DATA_READ(NR)         ( pReg[(NR)]->UARTDR )
+#endif
 
 
 /*
@@ -99,6 +132,38 @@ limitations under the License.
 #define INT_BEIM       0x00000200
 #define INT_OEIM       0x00000400
 
+/*
+ * Bits of the Raw/Masked Interrupt Status Registers (UARTRIS, UARTMIS) and
+ * the Interrupt Clear Register (UARTICR) match the IMSC's bits above.
+ */
+
+
+/*
+ * Bit masks of the Line Control Register (UARTLCR_H), see page 3-12 of DDI0183:
+ *   4: FEN (enable FIFOs)
+ */
+#define LCRH_FEN       0x00000010
+
+/*
+ * Bit masks of the Interrupt FIFO Level Select Register (UARTIFLS),
+ * see page 3-17 of DDI0183:
+ * 3-5: RXIFLSEL, receive interrupt FIFO level (2: 1/2 full)
+ * 0-2: TXIFLSEL, transmit interrupt FIFO level
+ */
+#define IFLS_RX_MASK   0x00000038
+#define IFLS_RX_HALF   0x00000010
+
+
+/* Depth of the receive FIFO, bounds characters drained by a single interrupt: */
+#define RX_FIFO_DEPTH  16
+
+/* Default thresholds of switching between the receive modes (see uartRxConfig): */
+#define RX_DEF_IRQ_THRESHOLD    32
+#define RX_DEF_WINDOW_US        10000
+#define RX_DEF_POLL_US          100
+#define RX_DEF_BUDGET           RX_FIFO_DEPTH
+#define RX_DEF_QUIET_POLLS      8
+
 
 /* 
  * Bitmasks for the Flag Register.
@@ -176,6 +241,32 @@ static volatile ARM926EJS_UART_REGS* const  pReg[BSP_NR_UARTS]=
 #undef GEN_CAST_ADDR
 
 
+/*
+ * State of a UART's receive path: its ring buffer, thresholds,
+ * statistics and the poll timer.
+ */
+typedef struct _uartRxState
+{
+    uint8_t buf[UART_RX_BUF_SIZE];
+    volatile uint32_t head;            /* number of characters, written by the ISRs */
+    volatile uint32_t tail;            /* number of characters, read by the application */
+    uartRxStats stats;
+    uartRxConfig config;
+    uint32_t windowStart;              /* clocksource's time of the current window's start */
+    uint32_t windowIrqs;               /* receive interrupts within the current window */
+    uint32_t emptyPolls;               /* consecutive polls without any characters */
+    volatile uint8_t mode;             /* UART_RX_* */
+    uint8_t nr;
+    uint8_t useTimer;
+    uint8_t timerNr;
+    uint8_t counterNr;
+} uartRxState;
+
+static uartRxState __rx[BSP_NR_UARTS];
+
+static const uint8_t __irqs[BSP_NR_UARTS] = BSP_UART_IRQS;
+
+
 /**
  * Initializes a UART controller.
  * It is enabled for transmission (Tx) only, receive must be enabled separately.
@@ -336,6 +427,8 @@ void uart_print(uint8_t nr, const char* str)
     {
         __printCh(nr, *cp);
     }
+
+    trace_event(TRACE_EV_UART_QUEUED, nr);
 }
 
 
@@ -480,3 +573,487 @@ void uart_disableRx(uint8_t nr)
 {
     __setCrBit(nr, false, CTL_RXE);
 }
+
+
+/**
+ * Enables or disables the loop back mode, i.e. transmitted characters
+ * are received by the same UART.
+ * UART's general enable status (UARTEN) remains unmodified.
+ *
+ * Nothing is done if 'nr' is invalid (equal or greater than 3).
+ *
+ * @param nr - number of the UART (between 0 and 2)
+ * @param enable - nonzero enables the loop back mode, 0 disables it
+ */
+void uart_setLoopback(uint8_t nr, uint8_t enable)
+{
+    __setCrBit(nr, (0 != enable), CTL_LBE);
+}
+
+
+/*
+ * Moves characters from a UART's receive FIFO into its ring buffer.
+ * Characters that do not fit into the buffer are discarded.
+ *
+ * @param u - the UART's receive state
+ * @param max - max. number of characters to be moved
+ *
+ * @return number of characters, read from the FIFO
+ */
+static uint32_t __drain(uartRxState* u, uint32_t max)
+{
+    uint32_t n;
+    uint8_t ch;
+
+    for ( n=0; n<max && 0==(pReg[u->nr]->UARTFR & FR_RXFE); ++n )
+    {
+        ch = (uint8_t) DATA_READ(u->nr);
+
+        if ( u->head - u->tail >= UART_RX_BUF_SIZE )
+        {
+            ++u->stats.overruns;
+            continue;
+        }
+
+        u->buf[u->head & (UART_RX_BUF_SIZE - 1)] = ch;
+        ++u->head;
+    }
+
+    u->stats.bytes += n;
+
+    return n;
+}
+
+
+/*
+ * Counts (and clears) the receive FIFO's overrun, i.e. characters
+ * that arrived while the FIFO was full.
+ *
+ * @param u - the UART's receive state
+ *
+ * @return bit mask of the overrun interrupt if it is pending, 0 otherwise
+ */
+static uint32_t __checkOverrun(uartRxState* u)
+{
+    if ( 0 == (pReg[u->nr]->UARTRIS & INT_OEIM) )
+    {
+        return 0;
+    }
+
+    ++u->stats.overruns;
+
+    return INT_OEIM;
+}
+
+
+/*
+ * Stops the poll timer (if used).
+ *
+ * @param u - the UART's receive state
+ */
+static void __stopTimer(const uartRxState* u)
+{
+    if ( 0 != u->useTimer )
+    {
+        timer_stop(u->timerNr, u->counterNr);
+        timer_disableInterrupt(u->timerNr, u->counterNr);
+        timer_clearInterrupt(u->timerNr, u->counterNr);
+    }
+}
+
+
+/*
+ * Switches the receive path to polling: the receive interrupts
+ * are masked and the poll timer is started.
+ *
+ * @param u - the UART's receive state
+ */
+static void __toPoll(uartRxState* u)
+{
+    pReg[u->nr]->UARTIMSC &= ~(INT_RXIM | INT_RTIM);
+
+    u->emptyPolls = 0;
+    u->mode = UART_RX_POLL;
+    ++u->stats.toPoll;
+
+    timer_setLoad(u->timerNr, u->counterNr, u->config.pollUs - 1);
+    timer_enableInterrupt(u->timerNr, u->counterNr);
+    timer_start(u->timerNr, u->counterNr);
+}
+
+
+/*
+ * Switches the receive path back to interrupts: the poll timer is stopped
+ * and the receive interrupts are unmasked. Characters, received since the
+ * last poll, raise the interrupts immediately.
+ *
+ * @param u - the UART's receive state
+ */
+static void __toIrq(uartRxState* u)
+{
+    __stopTimer(u);
+
+    u->windowStart = clocksource_read();
+    u->windowIrqs = 0;
+    u->mode = UART_RX_IRQ;
+    ++u->stats.toIrq;
+
+    pReg[u->nr]->UARTIMSC |= (INT_RXIM | INT_RTIM);
+}
+
+
+/*
+ * ISR of a UART, drains its receive FIFO. If a poll timer is assigned
+ * and the number of interrupts within the current window exceeds the
+ * threshold, the receive path is switched to polling.
+ *
+ * @param param - pointer to the UART's receive state
+ */
+static void __rxIsr(void* param)
+{
+    uartRxState* const u = (uartRxState*) param;
+    uint32_t now;
+
+    ++u->stats.irqs;
+
+    __drain(u, RX_FIFO_DEPTH);
+    pReg[u->nr]->UARTICR = INT_RXIM | INT_RTIM | __checkOverrun(u);
+
+    if ( 0 == u->useTimer || UART_RX_IRQ != u->mode )
+    {
+        return;
+    }
+
+    now = clocksource_read();
+    if ( clocksource_ticksToUs(now - u->windowStart) >= u->config.windowUs )
+    {
+        u->windowStart = now;
+        u->windowIrqs = 0;
+    }
+
+    if ( ++u->windowIrqs > u->config.irqThreshold )
+    {
+        __toPoll(u);
+    }
+}
+
+
+/*
+ * Callback of the poll timer's expiration, drains at most 'budget'
+ * characters of the receive FIFO. After 'quietPolls' consecutive polls
+ * without any characters, the receive path is switched back to interrupts.
+ *
+ * @param param - pointer to the UART's receive state
+ */
+static void __pollIsr(void* param)
+{
+    uartRxState* const u = (uartRxState*) param;
+    uint32_t ovr;
+
+    if ( UART_RX_POLL != u->mode )
+    {
+        return;
+    }
+
+    ++u->stats.polls;
+
+    if ( __drain(u, u->config.budget) > 0 )
+    {
+        u->emptyPolls = 0;
+    }
+    else if ( ++u->emptyPolls >= u->config.quietPolls )
+    {
+        __toIrq(u);
+    }
+
+    ovr = __checkOverrun(u);
+    if ( 0 != ovr )
+    {
+        pReg[u->nr]->UARTICR = ovr;
+    }
+}
+
+
+/**
+ * Enables the receive path of a UART: its FIFOs and receiver are enabled
+ * and received characters are buffered by the UART's ISR. The receive
+ * buffer and statistics are cleared, thresholds are set to their defaults
+ * and no poll timer is assigned (see uart_rxUsePollTimer()).
+ *
+ * @note Must be called after the interrupt controller has been initialized
+ * (pic_init() unregisters all ISRs).
+ *
+ * @param nr - number of the UART (between 0 and 2)
+ * @param priority - priority of the UART's IRQ (see pic_registerNonVectoredIrq())
+ *
+ * @return UART_OK on success, UART_ERR_PARAM if 'nr' is invalid or the ISR could not be registered
+ */
+int8_t uart_enableRxInterrupt(uint8_t nr, uint8_t priority)
+{
+    uartRxState* u;
+    uint32_t enabled;
+
+    if ( nr >= BSP_NR_UARTS )
+    {
+        return UART_ERR_PARAM;
+    }
+
+    u = &__rx[nr];
+
+    uart_disableRxInterrupt(nr);
+
+    u->head = 0;
+    u->tail = 0;
+    u->nr = nr;
+    u->useTimer = 0;
+    u->windowIrqs = 0;
+    uart_setRxConfig(nr, NULL);
+    uart_resetRxStats(nr);
+
+    clocksource_init();
+    u->windowStart = clocksource_read();
+
+    if ( pic_registerNonVectoredIrq(__irqs[nr], &__rxIsr, (void*) u, priority) < 0 )
+    {
+        return UART_ERR_PARAM;
+    }
+
+    /* As the Control Register, the Line Control Register may only be modified while the UART is disabled */
+    enabled = pReg[nr]->UARTCR & CTL_UARTEN;
+    pReg[nr]->UARTCR &= ~CTL_UARTEN;
+    pReg[nr]->UARTLC_H |= LCRH_FEN;
+    if ( enabled )
+    {
+        pReg[nr]->UARTCR |= CTL_UARTEN;
+    }
+
+    pReg[nr]->UARTIFLS = (pReg[nr]->UARTIFLS & ~IFLS_RX_MASK) | IFLS_RX_HALF;
+    uart_enableRx(nr);
+
+    u->mode = UART_RX_IRQ;
+    pReg[nr]->UARTIMSC |= (INT_RXIM | INT_RTIM);
+    pic_enableInterrupt(__irqs[nr]);
+
+    return UART_OK;
+}
+
+
+/**
+ * Disables the receive path of a UART: its receive interrupts are masked,
+ * its ISR is unregistered and the poll timer (if assigned) is stopped.
+ * Unread characters are discarded. The receiver itself remains enabled.
+ *
+ * Nothing is done if 'nr' is invalid.
+ *
+ * @param nr - number of the UART (between 0 and 2)
+ */
+void uart_disableRxInterrupt(uint8_t nr)
+{
+    uartRxState* u;
+
+    if ( nr >= BSP_NR_UARTS )
+    {
+        return;
+    }
+
+    u = &__rx[nr];
+
+    pReg[nr]->UARTIMSC &= ~(INT_RXIM | INT_RTIM);
+
+    if ( UART_RX_OFF == u->mode )
+    {
+        return;
+    }
+
+    u->mode = UART_RX_OFF;
+    __stopTimer(u);
+    pic_unregisterNonVectoredIrq(__irqs[nr]);
+    u->tail = u->head;
+}
+
+
+/**
+ * Assigns a SP804 counter to a UART's receive path, which enables switching
+ * to polling at high input rates (see uartRxConfig). The counter only runs
+ * while the receive path is polling.
+ *
+ * @param nr - number of the UART (between 0 and 2)
+ * @param timerNr - number of the timer
+ * @param counterNr - number of the timer's counter
+ * @param priority - priority of the timer's IRQ (see timer_registerCallback())
+ *
+ * @return UART_OK on success, UART_ERR_PARAM if any parameter is invalid or the ISR could not be registered, UART_ERR_NOINIT if the receive path is not enabled
+ */
+int8_t uart_rxUsePollTimer(uint8_t nr, uint8_t timerNr, uint8_t counterNr, uint8_t priority)
+{
+    uartRxState* u;
+
+    if ( nr >= BSP_NR_UARTS || timerNr >= BSP_NR_TIMERS || counterNr >= timer_countersPerTimer() )
+    {
+        return UART_ERR_PARAM;
+    }
+
+    u = &__rx[nr];
+
+    if ( UART_RX_OFF == u->mode )
+    {
+        return UART_ERR_NOINIT;
+    }
+
+    if ( UART_RX_POLL == u->mode )
+    {
+        __toIrq(u);
+    }
+
+    u->useTimer = 0;
+    u->timerNr = timerNr;
+    u->counterNr = counterNr;
+
+    timer_init(timerNr, counterNr);
+
+    if ( timer_registerCallback(timerNr, counterNr, &__pollIsr, (void*) u, priority) < 0 )
+    {
+        return UART_ERR_PARAM;
+    }
+
+    u->useTimer = 1;
+
+    return UART_OK;
+}
+
+
+/**
+ * Sets thresholds of switching between the receive modes. The period of
+ * polling should be shorter than the time to fill the receive FIFO
+ * (16 characters) at the line's rate, otherwise characters are lost.
+ *
+ * @param nr - number of the UART (between 0 and 2)
+ * @param config - the thresholds, NULL restores the defaults
+ *
+ * @return UART_OK on success, UART_ERR_PARAM if 'nr' is invalid or any threshold is 0
+ */
+int8_t uart_setRxConfig(uint8_t nr, const uartRxConfig* config)
+{
+    uartRxConfig* c;
+
+    if ( nr >= BSP_NR_UARTS )
+    {
+        return UART_ERR_PARAM;
+    }
+
+    c = &__rx[nr].config;
+
+    if ( NULL == config )
+    {
+        c->irqThreshold = RX_DEF_IRQ_THRESHOLD;
+        c->windowUs = RX_DEF_WINDOW_US;
+        c->pollUs = RX_DEF_POLL_US;
+        c->budget = RX_DEF_BUDGET;
+        c->quietPolls = RX_DEF_QUIET_POLLS;
+        return UART_OK;
+    }
+
+    if ( 0 == config->irqThreshold || 0 == config->windowUs || config->pollUs < 2 ||
+         0 == config->budget || 0 == config->quietPolls )
+    {
+        return UART_ERR_PARAM;
+    }
+
+    *c = *config;
+
+    return UART_OK;
+}
+
+
+/**
+ * @param nr - number of the UART (between 0 and 2)
+ *
+ * @return current mode of the receive path (UART_RX_*), UART_RX_OFF if 'nr' is invalid
+ */
+uint8_t uart_getRxMode(uint8_t nr)
+{
+    return ( nr < BSP_NR_UARTS ? __rx[nr].mode : UART_RX_OFF );
+}
+
+
+/**
+ * @param nr - number of the UART (between 0 and 2)
+ *
+ * @return number of received characters, not read yet (0 if 'nr' is invalid)
+ */
+uint32_t uart_rxAvailable(uint8_t nr)
+{
+    return ( nr < BSP_NR_UARTS ? __rx[nr].head - __rx[nr].tail : 0 );
+}
+
+
+/**
+ * Reads the oldest received character.
+ *
+ * @param nr - number of the UART (between 0 and 2)
+ *
+ * @return the character, a negative value if no character is available or 'nr' is invalid
+ */
+int16_t uart_readChar(uint8_t nr)
+{
+    uartRxState* u;
+    uint8_t ch;
+
+    if ( nr >= BSP_NR_UARTS || __rx[nr].head == __rx[nr].tail )
+    {
+        return -1;
+    }
+
+    u = &__rx[nr];
+    ch = u->buf[u->tail & (UART_RX_BUF_SIZE - 1)];
+    ++u->tail;
+
+    return ch;
+}
+
+
+/**
+ * Copies statistics of a UART's receive path.
+ *
+ * @param nr - number of the UART (between 0 and 2)
+ * @param stats - the statistics are copied here
+ *
+ * @return UART_OK on success, UART_ERR_PARAM if 'nr' is invalid or 'stats' is NULL
+ */
+int8_t uart_getRxStats(uint8_t nr, uartRxStats* stats)
+{
+    if ( nr >= BSP_NR_UARTS || NULL == stats )
+    {
+        return UART_ERR_PARAM;
+    }
+
+    *stats = __rx[nr].stats;
+
+    return UART_OK;
+}
+
+
+/**
+ * Resets all counters of a UART's receive statistics.
+ *
+ * Nothing is done if 'nr' is invalid.
+ *
+ * @param nr - number of the UART (between 0 and 2)
+ */
+void uart_resetRxStats(uint8_t nr)
+{
+    uartRxStats* s;
+
+    if ( nr >= BSP_NR_UARTS )
+    {
+        return;
+    }
+
+    s = &__rx[nr].stats;
+    s->bytes = 0;
+    s->irqs = 0;
+    s->polls = 0;
+    s->overruns = 0;
+    s->toPoll = 0;
+    s->toIrq = 0;
+}
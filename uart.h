@@ -19,6 +19,11 @@ limitations under the License.
  * 
  * Declaration of public functions that handle
  * the board's UART controllers.
+ *
+ * Received characters are buffered by the driver once the receive path
+ * is enabled by uart_enableRxInterrupt(). At high input rates, the receive
+ * path may switch itself from interrupts to polling by a timer (see
+ * uart_rxUsePollTimer() and uartRxConfig).
  * 
  * @author Jernej Kovacic
  */
@@ -26,6 +31,57 @@ limitations under the License.
 #ifndef _UART_H_
 #define _UART_H_
 
+#include <stdint.h>
+
+
+/* Return values of uart_* functions that may fail: */
+#define UART_OK                  0
+#define UART_ERR_PARAM          -1     /* invalid parameter or the ISR could not be registered */
+#define UART_ERR_NOINIT         -2     /* the receive path is not enabled */
+
+/* Size of each UART's receive buffer (must be a power of 2): */
+#define UART_RX_BUF_SIZE         256
+
+/* Modes of the receive path: */
+#define UART_RX_OFF              0     /* received characters are not buffered */
+#define UART_RX_IRQ              1     /* the receive FIFO is drained by the UART's ISR */
+#define UART_RX_POLL             2     /* the receive FIFO is drained by the poll timer's ISR */
+
+
+/**
+ * Thresholds of switching between the receive modes.
+ *
+ * The receive path switches to polling when more than 'irqThreshold'
+ * receive interrupts occur within 'windowUs' micro seconds. Then the FIFO
+ * is drained every 'pollUs' micro seconds, at most 'budget' characters
+ * at a time. After 'quietPolls' consecutive polls without any characters,
+ * the receive interrupts are enabled again.
+ */
+typedef struct _uartRxConfig
+{
+    uint32_t irqThreshold;        /* max. number of interrupts within a window */
+    uint32_t windowUs;            /* length of the window in micro seconds */
+    uint32_t pollUs;              /* period of polling in micro seconds (at least 2) */
+    uint32_t budget;              /* max. number of characters, drained by a poll */
+    uint32_t quietPolls;          /* number of empty polls that switch back to interrupts */
+} uartRxConfig;
+
+
+/**
+ * Statistics of a UART's receive path, all counters start at 0 when
+ * the receive path is enabled or its statistics are reset.
+ */
+typedef struct _uartRxStats
+{
+    uint32_t bytes;               /* received characters */
+    uint32_t irqs;                /* invocations of the UART's ISR */
+    uint32_t polls;               /* invocations of the poll timer's ISR while polling */
+    uint32_t overruns;            /* characters, lost by the FIFO or discarded because the buffer was full */
+    uint32_t toPoll;              /* switches from interrupts to polling */
+    uint32_t toIrq;               /* switches from polling back to interrupts */
+} uartRxStats;
+
+
 void uart_init(uint8_t nr);
 
 void uart_printChar(uint8_t nr, char ch);
@@ -44,5 +100,25 @@ void uart_enableRx(uint8_t nr);
 
 void uart_disableRx(uint8_t nr);
 
+void uart_setLoopback(uint8_t nr, uint8_t enable);
+
+int8_t uart_enableRxInterrupt(uint8_t nr, uint8_t priority);
+
+void uart_disableRxInterrupt(uint8_t nr);
+
+int8_t uart_rxUsePollTimer(uint8_t nr, uint8_t timerNr, uint8_t counterNr, uint8_t priority);
+
+int8_t uart_setRxConfig(uint8_t nr, const uartRxConfig* config);
+
+uint8_t uart_getRxMode(uint8_t nr);
+
+uint32_t uart_rxAvailable(uint8_t nr);
+
+int16_t uart_readChar(uint8_t nr);
+
+int8_t uart_getRxStats(uint8_t nr, uartRxStats* stats);
+
+void uart_resetRxStats(uint8_t nr);
+
 
 #endif  /* _UART_H_ */
@@ -7,6 +7,8 @@
  * For more details, see:
  * ARM9EJ-S Technical Reference Manual (DDI0222):
  * http://infocenter.arm.com/help/topic/com.arm.doc.ddi0222b/DDI0222.pdf
+ * ARM926EJ-S Technical Reference Manual (DDI0198):
+ * http://infocenter.arm.com/help/topic/com.arm.doc.ddi0198e/DDI0198E_arm926ejs_r0p5_trm.pdf
  *
  * These articles are also useful:
  * http://balau82.wordpress.com/2012/04/15/arm926-interrupts-in-qemu/
@@ -51,16 +53,41 @@ vectors_end:
 
 /*
  * Implementation of the reset handler, executed also at startup.
- * It sets stack pointers for all supported operating modes (Supervisor,
- * IRQ and User), Disables IRQ interrupts for all modes and finally it
- * switches into the User mode and jumps into the startup function.
+ * It copies RAM resident parts of the image into RAM, zeroes the .bss section,
+ * sets stack pointers for all supported operating modes (Supervisor,
+ * IRQ, Abort, Undefined and User), Disables IRQ interrupts for all modes and
+ * finally it switches into the User mode and jumps into the startup function.
  *
- * Note: 'stack_top', 'irq_stack_top' and 'svc_stack_top' are allocated in qemu.ld
+ * Note: 'stack_top', 'irq_stack_top', 'svc_stack_top', 'abt_stack_top' and
+ * 'und_stack_top' are allocated in qemu.ld (or xip.ld), as well as '__ld_Copy_*'
+ * and '__ld_Bss_*'
  */
 reset_handler:
     @ The handler is always entered in Supervisor mode
     LDR sp, =svc_stack_top                 @ stack for the supervisor mode
-    BL copy_vectors                        @ copy exception vectors to 0x00000000
+
+    @ Copy hot code and initialized data from the flash to RAM (XIP images only,
+    @ the block is empty in RAM images) and zero the .bss section
+    LDR r0, =__ld_Copy_Load
+    LDR r1, =__ld_Copy_Start
+    LDR r2, =__ld_Copy_End
+copy_loop:
+    CMP r1, r2
+    LDRLO r3, [r0], #4
+    STRLO r3, [r1], #4
+    BLO copy_loop
+
+    LDR r1, =__ld_Bss_Start
+    LDR r2, =__ld_Bss_End
+    MOV r3, #0
+zero_loop:
+    CMP r1, r2
+    STRLO r3, [r1], #4
+    BLO zero_loop
+
+    @ copy_vectors() may already be in RAM, i.e. out of the range of BL
+    LDR r0, =copy_vectors
+    BLX r0                                 @ copy exception vectors to 0x00000000
     MRS r0, cpsr                           @ copy Program Status Register (CPSR) to r0
 
     @ Disable IRQ interrupts for the Supervisor mode
@@ -76,6 +103,20 @@ reset_handler:
  
     @ When in IRQ mode, set its stack pointer
     LDR sp, =irq_stack_top                 @ stack for the IRQ mode
+
+    @ Set and switch into Abort mode, its stack is used by the crash dump handler
+    BIC r1, r0, #0x1F                      @ clear least significant 5 bits...
+    ORR r1, r1, #0x17                      @ and set them to b10111 (0x17), i.e set Abort mode
+    ORR r1, r1, #0xC0                      @ IRQ and FIQ are disabled while handling aborts
+    MSR cpsr, r1
+    LDR sp, =abt_stack_top                 @ stack for the Abort mode
+
+    @ Set and switch into Undefined mode, its stack is also used by the crash dump handler
+    BIC r1, r0, #0x1F                      @ clear least significant 5 bits...
+    ORR r1, r1, #0x1B                      @ and set them to b11011 (0x1B), i.e set Undefined mode
+    ORR r1, r1, #0xC0                      @ IRQ and FIQ are disabled while handling exceptions
+    MSR cpsr, r1
+    LDR sp, =und_stack_top                 @ stack for the Undefined mode
  
     @ Prepare and enter into User mode. This mode is configured as the last as it does
     @ not permit (direkt) switching into other operating modes.
@@ -94,7 +135,64 @@ reset_handler:
 
     BL main                                @ and finally start the application
     B .                                    @ infinite loop (if main() ever returns)
- 
+
+
+/*
+ * Entry stubs of the undefined instruction, prefetch abort and data abort handlers.
+ *
+ * Each stub stores all unbanked registers and its link register to its mode's stack
+ * and passes the type of the exception (see CRASH_* in crash.h) in r0 to the common
+ * code that further collects the CPU state and calls _crash_handler() (implemented
+ * in crash.c). None of these exceptions is ever returned from.
+ *
+ * Note: 'abt_stack_top' and 'und_stack_top' are allocated in qemu.ld
+ */
+undef_handler:
+    STMFD sp!, {r0-r12, lr}                @ save unbanked registers and the return address
+    MOV r0, #1                             @ CRASH_UNDEF
+    B crash_entry
+
+prefetch_abort_handler:
+    STMFD sp!, {r0-r12, lr}                @ save unbanked registers and the return address
+    MOV r0, #2                             @ CRASH_PREFETCH_ABORT
+    B crash_entry
+
+data_abort_handler:
+    STMFD sp!, {r0-r12, lr}                @ save unbanked registers and the return address
+    MOV r0, #3                             @ CRASH_DATA_ABORT
+    B crash_entry
+
+/*
+ * Common part of the stubs above. Pushes the following words in front of
+ * already stored registers (lowest address first): SPSR, CPSR, faulted mode's
+ * banked sp and lr, DFSR, FAR and IFSR. The layout must match 'excFrame' in crash.c.
+ */
+crash_entry:
+    MRS r2, spsr                           @ CPSR of the faulted mode
+    MRS r3, cpsr                           @ CPSR of the current (exception) mode
+
+    @ Banked sp and lr of the faulted mode can only be read in that mode
+    AND r4, r2, #0x1F                      @ faulted mode's bits
+    CMP r4, #0x10                          @ User mode cannot be switched back from...
+    MOVEQ r4, #0x1F                        @ so use the System mode that shares its registers
+    BIC r5, r3, #0x1F
+    ORR r5, r5, r4
+    ORR r5, r5, #0xC0                      @ keep IRQ and FIQ disabled
+    MSR cpsr_c, r5                         @ switch into the faulted mode...
+    MOV r6, sp                             @ obtain its stack pointer...
+    MOV r7, lr                             @ and link register...
+    MSR cpsr_c, r3                         @ and switch back to the exception mode
+
+    @ Fault status and address registers (CP15 c5 and c6), see chapter 2 of DDI0198
+    MRC p15, 0, r8, c5, c0, 0              @ Data Fault Status Register
+    MRC p15, 0, r9, c6, c0, 0              @ Fault Address Register
+    MRC p15, 0, r10, c5, c0, 1             @ Instruction Fault Status Register
+
+    STMFD sp!, {r2, r3, r6-r10}
+    MOV r1, sp                             @ pointer to the complete stack frame
+    BL _crash_handler                      @ r0 still contains the exception type
+    B .                                    @ should never return, just in case...
+
 .end
 
-@ Other handlers and auxiliary functions are implemented in exception.c.
+@ Other handlers and auxiliary functions are implemented in exception.c and crash.c.